@@ -1,4 +1,6 @@
 function(Setupcgltf)
+    # With OPTIONAL, a failed download isn't fatal and CGLTF_FOUND is set in the parent scope
+    cmake_parse_arguments(ARG "OPTIONAL" "" "" ${ARGN})
     set(CGLTF_DIR "${EXTERNAL_DIR}/cgltf")
     file(GLOB_RECURSE HEADER_PATH "${CGLTF_DIR}/cgltf.h")
     set(CGLTF_VER "1.14")
@@ -10,18 +12,32 @@ function(Setupcgltf)
         set(URL "https://github.com/jkuhlmann/cgltf/archive/refs/tags/v${CGLTF_VER}.zip")
         message(STATUS "Downloading cgltf ${CGLTF_VER} from ${URL}...")
         set(ARCHIVE_PATH "${CGLTF_DIR}/temp/cgltf.zip")
-        file(DOWNLOAD "${URL}" "${ARCHIVE_PATH}" TIMEOUT 120)
-        file(ARCHIVE_EXTRACT INPUT "${ARCHIVE_PATH}" DESTINATION "${CGLTF_DIR}/temp")
+        file(DOWNLOAD "${URL}" "${ARCHIVE_PATH}" TIMEOUT 120 STATUS DOWNLOAD_STATUS)
+        list(GET DOWNLOAD_STATUS 0 DOWNLOAD_ERROR)
+        set(HEADER "")
 
-        # copy header
-        file(GLOB_RECURSE HEADER "${CGLTF_DIR}/temp/*cgltf*.h")
-        file(COPY ${HEADER} DESTINATION ${CGLTF_DIR})
-            
-        if(HEADER STREQUAL "")
-            message(FATAL_ERROR "Setting up cgltf failed.")
+        if(DOWNLOAD_ERROR EQUAL 0)
+            file(ARCHIVE_EXTRACT INPUT "${ARCHIVE_PATH}" DESTINATION "${CGLTF_DIR}/temp")
+
+            # copy header
+            file(GLOB_RECURSE HEADER "${CGLTF_DIR}/temp/*cgltf*.h")
+            file(COPY ${HEADER} DESTINATION ${CGLTF_DIR})
         endif()
 
         # cleanup
         file(REMOVE_RECURSE "${CGLTF_DIR}/temp")
-    endif()   
+
+        if(HEADER STREQUAL "")
+            if(ARG_OPTIONAL)
+                message(WARNING "Setting up cgltf failed, glTF loading is disabled.")
+                file(REMOVE_RECURSE "${CGLTF_DIR}")
+                set(CGLTF_FOUND FALSE PARENT_SCOPE)
+                return()
+            endif()
+
+            message(FATAL_ERROR "Setting up cgltf failed.")
+        endif()
+    endif()
+
+    set(CGLTF_FOUND TRUE PARENT_SCOPE)
 endfunction()
\ No newline at end of file
@@ -1,6 +1,6 @@
 function(SetupxxHash)
     set(XXHASH_DIR "${EXTERNAL_DIR}/xxHash")
-    file(GLOB_RECURSE HEADER_PATH "${XXHASH_DIR}/xxHash.h")
+    file(GLOB_RECURSE HEADER_PATH "${XXHASH_DIR}/xxhash.h")
 
     if(HEADER_PATH STREQUAL "")
         file(MAKE_DIRECTORY ${XXHASH_DIR})
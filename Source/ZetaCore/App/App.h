@@ -12,6 +12,10 @@ namespace ZetaRay::Support
     struct alignas(64) Task;
     struct ParamVariant;
     struct Stat;
+    struct StatPercentiles;
+    struct FramePipeline;
+    struct TaskSignalStats;
+    struct CpuTopology;
 }
 
 namespace ZetaRay::App
@@ -47,6 +51,12 @@ namespace ZetaRay::App
     struct Timer;
 }
 
+namespace ZetaRay::Math
+{
+    struct float3;
+    struct float3x3;
+}
+
 namespace ZetaRay::Core
 {
     class RendererCore;
@@ -100,6 +110,7 @@ namespace ZetaRay::App
     {
         int NumPhysicalCores;
         int NumLogicalCores;
+        int NumNumaNodes;
     };
 
     enum class THREAD_PRIORITY
@@ -110,7 +121,9 @@ namespace ZetaRay::App
 
     CpuInfo GetProcessorInfo();
     ZETA_THREAD_ID_TYPE GetCurrentThreadID();
-    ZETA_THREAD_ID_TYPE GetThreadID(void* handle);
+    // Index of the calling thread in [0, ZETA_MAX_NUM_THREADS) or -1 if it's not one of 
+    // the App's threads
+    int GetCurrentThreadIdx();
     void SetThreadPriority(void* handle, THREAD_PRIORITY priority);
     void SetThreadDesc(void* handle, wchar_t* buffer);
 
@@ -124,7 +137,7 @@ namespace ZetaRay::App
     void* AllocateFrameAllocator(size_t size, 
         size_t alignment = alignof(std::max_align_t));
 
-    int RegisterTask();
+    int RegisterTask(const char* name);
     void TaskFinalizedCallback(int handle, int indegree);
     void WaitForAdjacentHeadNodes(int handle);
     void SignalAdjacentTailNodes(Util::Span<int> taskIDs);
@@ -154,6 +167,14 @@ namespace ZetaRay::App
     void AddParam(Support::ParamVariant& p);
     void TryAddParam(Support::ParamVariant& p);
     void RemoveParam(const char* group, const char* subgroup, const char* name);
+    // Copies the param, as it was at the time of the call, to given output. Returns false if
+    // not found.
+    bool FindParam(const char* group, const char* subgroup, const char* name, Support::ParamVariant& param);
+    // Value is parsed according to the param's type at the start of next frame (see
+    // ParamRegistry::SetValue()).
+    void SetParam(const char* group, const char* subgroup, const char* name, const char* value);
+    // Sets the param values from a text file with one "group/subgroup/name = value" per line
+    bool LoadParams(const char* path);
     Util::SynchronizedMutableSpan<Support::ParamVariant> GetParams();
 
     void AddShaderReloadHandler(const char* name, fastdelegate::FastDelegate0<> dlg);
@@ -169,7 +190,43 @@ namespace ZetaRay::App
     void AddFrameStat(const char* group, const char* name, uint64_t f);
     void AddFrameStat(const char* group, const char* name, uint32_t num, 
         uint32_t total);
+    // Stats can also be added by an interned ID, which skips hashing the group and name.
+    // IDs stay valid for the lifetime of the app, so callers can cache them in a static.
+    uint32_t RegisterFrameStat(const char* group, const char* name);
+    void AddFrameStat(uint32_t id, int i);
+    void AddFrameStat(uint32_t id, uint32_t u);
+    void AddFrameStat(uint32_t id, float f);
+    void AddFrameStat(uint32_t id, uint64_t u);
+    void AddFrameStat(uint32_t id, uint32_t num, uint32_t total);
+    // Stats are buffered per thread and merged once at the start of the next frame, so 
+    // this returns the previous frame's stats
     Util::SynchronizedSpan<Support::Stat> GetStats();
+    // p50/p95/p99 over a rolling window of recent frames
+    Support::StatPercentiles GetFrameStatPercentiles(uint32_t id);
+    // Number of frames the CPU can run ahead of the GPU, in [1, FramePipeline::MAX_FRAMES_IN_FLIGHT].
+    // Takes effect next frame.
+    void SetFramesInFlight(int n);
+    int GetFramesInFlight();
+    // For marking the begin and end of frame stages (see FramePipeline)
+    Support::FramePipeline& GetFramePipeline();
+    // Task counts and dependency stalls of the previous frame
+    const Support::TaskSignalStats& GetTaskSignalStats();
+    // Cores, SMT siblings and NUMA nodes that the threads were assigned to
+    const Support::CpuTopology& GetCpuTopology();
+    // Records the merged stats of every frame until EndFrameStatsDump(), which writes 
+    // them to the given path (see FrameStats::EndDump() for the layout)
+    void BeginFrameStatsDump();
+    void EndFrameStatsDump(const char* path);
+    // Records the scene inputs of every frame (camera motion, param changes, picks and
+    // transform edits) until EndFrameCapture(), which writes them to the given path. See
+    // Support::FrameCaptureWriter.
+    void BeginFrameCapture();
+    void EndFrameCapture(const char* path);
+    bool IsCapturingFrames();
+    // Thread-safe. Ignored when there's no capture in progress. With nextFrame, the edit is
+    // captured in the next frame, e.g. when the scene has already been updated in this one.
+    void CaptureTransformEdit(uint64_t instanceID, const Math::float3& tr, const Math::float3x3& rotation,
+        const Math::float3& scale, bool nextFrame = false);
     Util::Span<float> GetFrameTimeHistory();
 
     const char* GetPSOCacheDir();
@@ -16,4 +16,11 @@ namespace ZetaRay::App::Filesystem
     void CreateDirectoryIfNotExists(const char* path);
     bool Copy(const char* srcPath, const char* dstPath, bool overwrite = false);
     bool IsDirectory(const char* path);
+
+    // For repeated random-access reads from the same file. Returns nullptr on failure.
+    void* OpenFileForRead(const char* path);
+    void CloseFile(void* file);
+    // Reads data.size() bytes starting at given offset. Can be called concurrently from 
+    // multiple threads using the same handle.
+    bool ReadFromFile(void* file, size_t offset, Util::MutableSpan<uint8_t> data);
 }
\ No newline at end of file
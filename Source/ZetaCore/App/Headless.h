@@ -0,0 +1,79 @@
+#pragma once
+
+#include "App.h"
+#include "../Support/CpuTopology.h"
+#include "../Support/FrameCapture.h"
+
+//--------------------------------------------------------------------------------------
+// Headless App: The thread pools, task system, frame allocators, timer, params, stats
+// and logging without a window or a renderer, so that the CPU subsystems can be run
+// and benchmarked on their own. Implemented by the POSIX backend; GetScene() returns a
+// scene without a renderer (textures aren't loaded and nothing is uploaded to the GPU),
+// GetRenderer() and GetCamera() are not available. Frames are driven by the caller:
+//
+//  App::Headless::Init();
+//
+//  while (...)
+//  {
+//      App::Headless::BeginFrame();
+//      // Submit tasks, allocate from the frame allocator, etc.
+//      App::FlushWorkerThreadPool();
+//  }
+//
+//  App::Headless::Shutdown();
+//--------------------------------------------------------------------------------------
+
+namespace ZetaRay::App::Headless
+{
+    struct Desc
+    {
+        // Including the main thread, zero means one per physical core
+        int NumWorkerThreads = 0;
+        int NumBackgroundThreads = 2;
+        // How the main thread, workers and background threads are pinned to logical
+        // processors (see CpuTopology). Pinning only pays off when nothing else is running
+        // on the machine, so it's opt-in.
+        Support::THREAD_PINNING Pinning = Support::THREAD_PINNING::NONE;
+    };
+
+    void Init(const Desc& desc = Desc());
+    void Shutdown();
+    // Waits for the worker tasks from the previous frame, releases that frame's temporary
+    // memory and stats, advances the timer and applies the queued param updates
+    void BeginFrame();
+
+    // Without a scene, the captured inputs are passed to the caller. Empty handlers are
+    // skipped.
+    struct ReplayHandlers
+    {
+        fastdelegate::FastDelegate1<const Scene::Motion&> OnMotion;
+        fastdelegate::FastDelegate1<const Support::CapturedPick&> OnPick;
+        fastdelegate::FastDelegate1<const Support::CapturedTransform&> OnTransform;
+        // Called once per frame with the captured elapsed time, after the frame's inputs.
+        // Timed as the frame's UPDATE stage.
+        fastdelegate::FastDelegate1<double> OnUpdate;
+    };
+
+    // Totals over the replayed frames
+    struct ReplayStats
+    {
+        uint32_t NumFrames = 0;
+        // Params that didn't exist when they were replayed
+        uint32_t NumSkippedParams = 0;
+        // BeginFrame(), which also applies the frame's param changes
+        double BeginFrameMs = 0.0;
+        double InputMs = 0.0;
+        // OnUpdate() and the worker tasks that it submitted
+        double UpdateMs = 0.0;
+    };
+
+    // Replays a capture from App::BeginFrameCapture()/EndFrameCapture() as fast as
+    // possible, one frame per captured frame, regardless of the captured timestamps.
+    // Per-frame timings are also added as frame stats. Returns false if the capture
+    // couldn't be loaded.
+    bool Replay(const char* path, const ReplayHandlers& handlers, ReplayStats& stats);
+    // Same as above, but replays into GetScene() -- transform edits are applied to the
+    // scene, which is then updated with the captured elapsed time. Camera motion and picks
+    // are skipped since there's no camera or renderer.
+    bool ReplayScene(const char* path, ReplayStats& stats);
+}
\ No newline at end of file
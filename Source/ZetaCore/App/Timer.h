@@ -16,6 +16,8 @@ namespace ZetaRay::App
         ZetaInline uint64_t GetTotalFrameCount() const { return m_frameCount; }
         ZetaInline int GetFramesPerSecond() const { return m_fps; }
         ZetaInline int64_t GetCounterFreq() const { return m_counterFreqSec; }
+        // Monotonic time in nanoseconds since an unspecified point, consistent across threads
+        static int64_t NowNano();
 
         void Start();
         void Resume();
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../Utility/SmallVector.h"
+#include "../Support/DescriptorAllocator.h"
 #include "Device.h"
 
 namespace ZetaRay::Core
@@ -9,7 +9,9 @@ namespace ZetaRay::Core
 
     struct DescriptorHeap
     {
-        explicit DescriptorHeap(uint32_t BlockSize = MAX_BLOCK_SIZE);
+        explicit DescriptorHeap(const char* name = nullptr)
+            : m_allocator(name)
+        {}
         ~DescriptorHeap() = default;
 
         DescriptorHeap(const DescriptorHeap&) = delete;
@@ -19,96 +21,34 @@ namespace ZetaRay::Core
         DescriptorTable Allocate(uint32_t count);
         void Release(DescriptorTable&& descTable);
         void Recycle();
+        // Returns the descriptors cached by threads [0, numThreads) (see App::GetCurrentThreadIdx())
+        // to the heap. Those threads must be idle.
+        void FlushThreadCaches(int numThreads);
 
         ZetaInline bool IsShaderVisible() const { return m_isShaderVisible; }
         ZetaInline uint32_t GetDescriptorSize() const { return m_descriptorSize; }
-        ZetaInline uint32_t GetNumFreeDescriptors() const { return m_freeDescCount; }
+        ZetaInline uint32_t GetNumFreeDescriptors() const { return m_allocator.NumFreeEntries(); }
         ZetaInline uint64_t GetBaseGpuHandle() const { return m_baseGPUHandle.ptr; }
         ZetaInline ID3D12DescriptorHeap* GetHeap() { return m_heap.Get(); }
         ZetaInline uint32_t GetHeapSize() { return m_totalHeapSize; }
-
-    private:
-        static const uint32_t MAX_BLOCK_SIZE = 1024;
-        static const uint32_t MAX_NUM_LISTS = 11;
-        static_assert(1 << (MAX_NUM_LISTS - 1) == MAX_BLOCK_SIZE, "These must match.");
-
-        struct PendingDescTable
-        {
-            PendingDescTable() = default;
-            PendingDescTable(uint64_t fence, uint32_t offset, uint32_t count, uint32_t internalVal)
-                : ReleaseFence(fence),
-                Offset(offset),
-                Count(count),
-                Internal(internalVal)
-            {}
-
-            uint64_t ReleaseFence;
-            uint32_t Offset;
-            uint32_t Count;
-            uint32_t Internal;
-        };
-
-        struct Entry
-        {
-            uint32_t HeapOffset;
-            uint32_t Next;
-        };
-
-        struct Block
+        ZetaInline Support::DescriptorAllocator::FragmentationReport GetFragmentationReport()
         {
-            Block() = default;
-            Block(Block&&) = delete;
-            Block& operator=(Block&&) = delete;
-
-            uint32_t Head;
-            Util::SmallVector<Entry> Entries;
-        };
-
-        struct ReleasedLargeBlock
-        {
-            uint32_t Offset;
-            uint32_t Count;
-        };
-
-        ZetaInline uint32_t DescTableSizeFromListIndex(uint32_t x) const
-        {
-            return 1 << x;
-        }
-
-        ZetaInline uint32_t ListIndexFromDescTableSize(uint32_t x)
-        {
-            size_t s = Math::NextPow2(x);
-            unsigned long idx;
-            _BitScanForward64(&idx, s);
-
-            return idx;
+            return m_allocator.GetFragmentationReport();
         }
 
-        bool AllocateNewBlock(uint32_t listIdx);
-
-        SRWLOCK m_lock = SRWLOCK_INIT;
+    private:
+        static constexpr uint32_t MAX_NUM_ALLOCS = 4096;
 
         ComPtr<ID3D12DescriptorHeap> m_heap;
         D3D12_CPU_DESCRIPTOR_HANDLE m_baseCPUHandle;
         D3D12_GPU_DESCRIPTOR_HANDLE m_baseGPUHandle;
         bool m_isShaderVisible;
         ComPtr<ID3D12Fence> m_fence;
-        uint64_t m_nextFenceVal = 1;
+        std::atomic_uint64_t m_nextFenceVal = 1;
         uint32_t m_descriptorSize = 0;
         uint32_t m_totalHeapSize = 0;
-        uint32_t m_freeDescCount = 0;
-
-        Util::SmallVector<PendingDescTable> m_pending;
-
-        // Segregated free lists
-        const uint32_t m_blockSize;
-        Block m_heads[MAX_NUM_LISTS];
-#ifndef NDEBUG
-        const uint32_t m_numLists;
-#endif
 
-        uint32_t m_nextHeapIdx = 0;
-        Util::SmallVector<ReleasedLargeBlock> m_releasedBlocks;
+        Support::DescriptorAllocator m_allocator;
     };
 
     // A contiguous range of descriptors that are allocated from one DescriptorHeap
@@ -99,9 +99,11 @@ namespace
             m_hasWorkThisFrame = true;
         }
 
+        // preCopyState is the state texture is in, e.g. when updating some of its mips
         void UploadTexture(ID3D12Resource* texture, Span<D3D12_SUBRESOURCE_DATA> subResData, 
             int firstSubresourceIndex = 0,
-            D3D12_RESOURCE_STATES postCopyState = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE)
+            D3D12_RESOURCE_STATES postCopyState = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE,
+            D3D12_RESOURCE_STATES preCopyState = D3D12_RESOURCE_STATE_COPY_DEST)
         {
             Assert(m_inBeginEndBlock, "Not in begin-end block.");
             Assert(texture, "Texture was NULL.");
@@ -139,6 +141,12 @@ namespace
 
             UploadHeapBuffer uploadBuffer = GpuMemory::GetUploadHeapBuffer((uint32_t)totalSize);
 
+            if (preCopyState != D3D12_RESOURCE_STATE_COPY_DEST)
+            {
+                m_directCmdList->ResourceBarrier(texture, preCopyState, 
+                    D3D12_RESOURCE_STATE_COPY_DEST);
+            }
+
             CopyTextureFromUploadBuffer(uploadBuffer.Resource(), 
                 uploadBuffer.MappedMemory(), uploadBuffer.Offset(), texture, 
                 (uint32_t)subResData.size(), firstSubresourceIndex, subResData, 
@@ -1539,7 +1547,7 @@ LOAD_DDS_RESULT GpuMemory::GetTexture3DFromDisk(const char* texPath, Texture& te
 
 Texture GpuMemory::GetPlacedTexture2DAndInit(Texture::ID_TYPE ID, const D3D12_RESOURCE_DESC1& desc,
     ID3D12Heap* heap, uint64_t offsetInBytes, UploadHeapArena& heapArena,
-    Span<D3D12_SUBRESOURCE_DATA> subresources, const char* dbgName)
+    Span<D3D12_SUBRESOURCE_DATA> subresources, const char* dbgName, uint32_t firstSubresource)
 {
     ID3D12Resource* texture;
     auto* device = App::GetRenderer().GetDevice();
@@ -1551,11 +1559,19 @@ Texture GpuMemory::GetPlacedTexture2DAndInit(Texture::ID_TYPE ID, const D3D12_RE
         IID_PPV_ARGS(&texture)));
 
     const int idx = GetThreadIndex(g_data->m_threadIDs);
-    g_data->m_uploaders[idx].UploadTexture(heapArena, texture, subresources);
+    g_data->m_uploaders[idx].UploadTexture(heapArena, texture, subresources, (int)firstSubresource);
 
     return Texture(ID, texture, RESOURCE_HEAP_TYPE::PLACED, dbgName);
 }
 
+void GpuMemory::UploadToTexture(Texture& tex, Span<D3D12_SUBRESOURCE_DATA> subresources,
+    uint32_t firstSubresource, D3D12_RESOURCE_STATES currState)
+{
+    const int idx = GetThreadIndex(g_data->m_threadIDs);
+    g_data->m_uploaders[idx].UploadTexture(tex.Resource(), subresources, (int)firstSubresource,
+        currState, currState);
+}
+
 Texture GpuMemory::GetTexture2DAndInit(const char* name, uint64_t width, uint32_t height, 
     DXGI_FORMAT format, D3D12_RESOURCE_STATES postCopyState, uint8_t* pixels, uint32_t flags)
 {
@@ -360,7 +360,13 @@ namespace ZetaRay::Core::GpuMemory
         Texture& tex);
     Texture GetTexture2DAndInit(const char* name, uint64_t width, uint32_t height, DXGI_FORMAT format,
         D3D12_RESOURCE_STATES initialState, uint8_t* pixels, uint32_t flags = 0);
+    // Subresources [firstSubresource, firstSubresource + subresources.size()) are initialized
     Texture GetPlacedTexture2DAndInit(Texture::ID_TYPE ID, const D3D12_RESOURCE_DESC1& desc,
         ID3D12Heap* heap, uint64_t offsetInBytes, UploadHeapArena& heapArena,
-        Util::Span<D3D12_SUBRESOURCE_DATA> subresources, const char* dbgName = nullptr);
+        Util::Span<D3D12_SUBRESOURCE_DATA> subresources, const char* dbgName = nullptr,
+        uint32_t firstSubresource = 0);
+    // Updates subresources [firstSubresource, firstSubresource + subresources.size()) of
+    // a texture that's in currState, which it's left in afterwards
+    void UploadToTexture(Texture& tex, Util::Span<D3D12_SUBRESOURCE_DATA> subresources,
+        uint32_t firstSubresource, D3D12_RESOURCE_STATES currState);
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "PipelineStateLibrary.h"
 #include "RendererCore.h"
+#include "RootSignature.h"
 #include "../App/Log.h"
 #include <App/Common.h>
 #include <App/Timer.h>
 #include <Support/Task.h>
 #include <Scene/SceneCore.h>
+#include <xxHash/xxhash.h>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
@@ -45,6 +47,12 @@ namespace
 
         CloseHandle(readPipe);
     }
+
+    ZetaInline void KeyToName(uint64_t key, wchar_t (&name)[17])
+    {
+        StackStr(str, n, "%016llx", key);
+        Common::CharToWideStr(str, name);
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -52,12 +60,13 @@ namespace
 //--------------------------------------------------------------------------------------
 
 PipelineStateLibrary::PipelineStateLibrary(MutableSpan<ID3D12PipelineState*> psoCache)
-    : m_compiledPSOs(psoCache)
+    : m_compiledPSOs(psoCache),
+    m_index(psoCache.size())
 {}
 
 PipelineStateLibrary::~PipelineStateLibrary()
 {
-    ClearAndFlushToDisk();
+    FlushToDisk();
 }
 
 void PipelineStateLibrary::Init(const char* name)
@@ -66,11 +75,18 @@ void PipelineStateLibrary::Init(const char* name)
     m_psoLibPath1.Reset(App::GetPSOCacheDir());
     m_psoLibPath1.Append(filename);
 
-    m_foundOnDisk = Filesystem::Exists(m_psoLibPath1.Get()) && 
+    StackStr(indexFilename, m, "%s.idx", name);
+    m_indexPath.Reset(App::GetPSOCacheDir());
+    m_indexPath.Append(indexFilename);
+
+    LoadIndex();
+
+    const bool foundOnDisk = m_index.NumLibraryPSOs() > 0 &&
+        Filesystem::Exists(m_psoLibPath1.Get()) &&
         Filesystem::GetFileSize(m_psoLibPath1.Get()) > 0;
 
     // PSO cache exists on disk, reload it
-    if (m_foundOnDisk)
+    if (foundOnDisk)
     {
         Filesystem::LoadFromFile(m_psoLibPath1.Get(), m_cachedBlob);
 
@@ -92,74 +108,159 @@ void PipelineStateLibrary::Init(const char* name)
             Check(hr == E_INVALIDARG || hr == D3D12_ERROR_DRIVER_VERSION_MISMATCH || hr == D3D12_ERROR_ADAPTER_NOT_FOUND,
                 "CreatePipelineLibrary() failed with HRESULT %d", hr);
 
+            // Index is still useful for warm-up
             ResetToEmptyPsoLib();
+            m_cachedBlob.free_memory();
         }
     }
     else
         ResetToEmptyPsoLib();
 }
 
+void PipelineStateLibrary::LoadIndex()
+{
+    m_index.Clear();
+
+    if (!Filesystem::Exists(m_indexPath.Get()))
+        return;
+
+    SmallVector<uint8_t> data;
+    Filesystem::LoadFromFile(m_indexPath.Get(), data);
+
+    if (!m_index.Load(Span<const uint8_t>(data.data(), data.size())))
+        LOG_UI_INFO("PSO cache index %s is invalid.\n", m_indexPath.Get());
+}
+
+void PipelineStateLibrary::WriteIndex()
+{
+    SmallVector<uint8_t> data;
+    m_index.Serialize(data);
+
+    Filesystem::WriteToFile(m_indexPath.Get(), data.data(), (uint32_t)data.size());
+}
+
+void PipelineStateLibrary::WarmUp(ID3D12RootSignature* rootSig)
+{
+    Assert(!m_warmUpPending.load(std::memory_order_relaxed), "Warm-up has already been started.");
+
+    if (!m_index.HasWarmUpWork())
+        return;
+
+    m_warmUpDone.Reset();
+    m_cancelWarmUp.store(false, std::memory_order_relaxed);
+    m_warmUpPending.store(true, std::memory_order_release);
+
+    Task t("PsoWarmUp", TASK_PRIORITY::BACKGROUND, [this, rootSig]()
+        {
+#if LOGGING == 1
+            App::DeltaTimer timer;
+            timer.Start();
+            int numWarmed = 0;
+#endif
+
+            for (uint32_t i = 0; i < (uint32_t)m_index.NumPSOs(); i++)
+            {
+                if (m_cancelWarmUp.load(std::memory_order_relaxed))
+                    break;
+
+                char path[PipelineCacheIndex::MAX_PATH_LEN];
+
+                // Already compiled (or being compiled) by the render pass
+                if (!m_index.NeedsWarmUp(i, path))
+                    continue;
+
+                Filesystem::Path pCs(App::GetCompileShadersDir());
+                pCs.Append(path);
+
+                if (!Filesystem::Exists(pCs.Get()))
+                    continue;
+
+                SmallVector<uint8_t> bytecode;
+                Filesystem::LoadFromFile(pCs.Get(), bytecode);
+
+                D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+                desc.pRootSignature = rootSig;
+                desc.CS.BytecodeLength = bytecode.size();
+                desc.CS.pShaderBytecode = bytecode.data();
+
+#if LOGGING == 1
+                numWarmed += LoadOrCompileComputePSO(i, desc, path, false) != nullptr;
+#else
+                LoadOrCompileComputePSO(i, desc, path, false);
+#endif
+            }
+
+#if LOGGING == 1
+            timer.End();
+            LOG_UI_INFO("PSO warm-up finished (%d PSOs) in %u [ms].", numWarmed, 
+                (uint32_t)timer.DeltaMilli());
+#endif
+
+            m_warmUpPending.store(false, std::memory_order_release);
+            m_warmUpDone.Notify();
+        });
+
+    App::SubmitBackground(ZetaMove(t));
+}
+
+void PipelineStateLibrary::CancelWarmUp()
+{
+    if (m_warmUpPending.load(std::memory_order_acquire))
+    {
+        m_cancelWarmUp.store(true, std::memory_order_relaxed);
+        m_warmUpDone.Wait();
+    }
+}
+
 void PipelineStateLibrary::Reset()
 {
-    ClearAndFlushToDisk();
-    m_psoWasReset = false;
+    FlushToDisk();
 
     m_cachedBlob.free_memory();
     memset(m_compiledPSOs.data(), 0, m_compiledPSOs.size() * sizeof(ID3D12PipelineState*));
+    m_index.Clear();
 }
 
 void PipelineStateLibrary::ResetToEmptyPsoLib()
 {
-    // Avoid resetting twice
-    if (!m_psoWasReset)
-    {
-        auto* device = App::GetRenderer().GetDevice();
-        CheckHR(device->CreatePipelineLibrary(nullptr, 0, 
-            IID_PPV_ARGS(m_psoLibrary.ReleaseAndGetAddressOf())));
-
-        m_psoWasReset = true;
-    }
+    auto* device = App::GetRenderer().GetDevice();
+    CheckHR(device->CreatePipelineLibrary(nullptr, 0, 
+        IID_PPV_ARGS(m_psoLibrary.ReleaseAndGetAddressOf())));
 
-    m_needsRebuild.store(true, std::memory_order_relaxed);
+    m_index.OnLibraryReset();
+    m_libraryModified.store(true, std::memory_order_relaxed);
 }
 
-void PipelineStateLibrary::ClearAndFlushToDisk()
+void PipelineStateLibrary::FlushToDisk()
 {
-    // Needed when:
-    //  1. Cached library was invalid (e.g. driver mismatch)
-    //  2. One of the PSOs didn't match (e.g. modification after library was written to disk)
-    //  3. Shader hot-reload
-    if (m_needsRebuild.load(std::memory_order_relaxed))
-    {
-        // Create an empty PSO and release the existing one
-        ResetToEmptyPsoLib();
+    CancelWarmUp();
 
-        if (m_foundOnDisk)
+    if (m_psoLibrary)
+    {
+        uint32_t numInUse = 0;
+        for (auto pso : m_compiledPSOs)
+            numInUse += pso != nullptr;
+
+        // Rebuild the library from the PSOs that are in use when:
+        //  1. There was a name collision
+        //  2. Too many PSOs became stale (e.g. after shader modifications or hot-reload)
+        if (m_needsRebuild.load(std::memory_order_relaxed) ||
+            m_index.TooManyStale(numInUse))
         {
-            Filesystem::RemoveFile(m_psoLibPath1.Get());
+            ResetToEmptyPsoLib();
             m_cachedBlob.free_memory();
-            m_foundOnDisk = false;
-        }
-
-        // Store all the compiled PSOs in the new library
-        for (int idx = 0; idx < (int)m_compiledPSOs.size(); idx++)
-        {
-            if (!m_compiledPSOs[idx])
-                continue;
 
-            wchar_t nameWide[8];
-            StackStr(name, n, "%d", idx);
-            Common::CharToWideStr(name, nameWide);
+            for (uint32_t i = 0; i < (uint32_t)m_compiledPSOs.size(); i++)
+            {
+                if (m_compiledPSOs[i])
+                    m_index.SetInLibrary(i, StoreInLibrary(m_index.Key(i), m_compiledPSOs[i]));
+            }
 
-            CheckHR(m_psoLibrary->StorePipeline(nameWide, m_compiledPSOs[idx]));
+            m_needsRebuild.store(false, std::memory_order_relaxed);
         }
 
-        m_needsRebuild.store(false, std::memory_order_relaxed);
-    }
-
-    if (m_psoLibrary)
-    {
-        if (!m_foundOnDisk)
+        // Only write the library when new PSOs were added to it
+        if (m_libraryModified.load(std::memory_order_relaxed))
         {
             const size_t serializedSize = m_psoLibrary->GetSerializedSize();
             Assert(serializedSize > 0, "Serialized size was invalid.");
@@ -169,8 +270,10 @@ void PipelineStateLibrary::ClearAndFlushToDisk()
             Filesystem::WriteToFile(m_psoLibPath1.Get(), psoLib, (uint32_t)serializedSize);
 
             free(psoLib);
+            m_libraryModified.store(false, std::memory_order_relaxed);
         }
 
+        WriteIndex();
         m_psoLibrary = nullptr;
     }
 
@@ -183,6 +286,99 @@ void PipelineStateLibrary::ClearAndFlushToDisk()
     }
 }
 
+bool PipelineStateLibrary::StoreInLibrary(uint64_t key, ID3D12PipelineState* pso)
+{
+    wchar_t nameWide[17];
+    KeyToName(key, nameWide);
+
+    HRESULT hr = m_psoLibrary->StorePipeline(nameWide, pso);
+
+    if (SUCCEEDED(hr))
+    {
+        m_index.OnStoredInLibrary();
+        m_libraryModified.store(true, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    // A PSO with the same name already exists
+    Check(hr == E_INVALIDARG, "StorePipeline() failed with HRESULT %d", hr);
+    m_needsRebuild.store(true, std::memory_order_relaxed);
+
+    return false;
+}
+
+ID3D12PipelineState* PipelineStateLibrary::LoadOrCompileComputePSO(uint32_t idx, 
+    D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const char* pathToCompiledCS, bool wait)
+{
+    const uint64_t key = XXH3_64bits_withSeed(desc.CS.pShaderBytecode, desc.CS.BytecodeLength,
+        GetRootSignatureHash(desc.pRootSignature));
+
+    ID3D12PipelineState* stalePSO = nullptr;
+
+    // Warm-up task doesn't need to wait
+    if (!wait)
+    {
+        if (!m_index.TryClaim(idx))
+            return m_compiledPSOs[idx];
+    }
+    else
+    {
+        const PipelineCacheIndex::ACQUIRE res = m_index.Acquire(idx, key);
+
+        if (res == PipelineCacheIndex::ACQUIRE::HIT)
+            return m_compiledPSOs[idx];
+
+        // Warm-up compiled the PSO from the index, but the render pass is now asking for
+        // a different shader. It's not been handed out yet, so it can be safely replaced.
+        if (res == PipelineCacheIndex::ACQUIRE::STALE)
+            stalePSO = m_compiledPSOs[idx];
+    }
+
+    wchar_t nameWide[17];
+    KeyToName(key, nameWide);
+
+    // MS docs: "The pipeline library is thread-safe to use, and will internally synchronize 
+    // as necessary, with one exception: multiple threads loading the same PSO (via LoadComputePipeline, 
+    // LoadGraphicsPipeline, or LoadPipeline) should synchronize themselves, as this act may modify 
+    // the state of that pipeline within the library in a non-thread-safe manner." PSO index makes
+    // sure each PSO is loaded by one thread.
+    ID3D12PipelineState* pso = nullptr;
+    HRESULT hr = m_index.NumLibraryPSOs() == 0 ? E_INVALIDARG :
+        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
+    bool inLibrary = SUCCEEDED(hr);
+
+    // A PSO with the specified name doesn't exist, or the input desc doesn't match the data in
+    // the library. Compile the PSO and then append it to the library for next time.
+    if (hr == E_INVALIDARG)
+    {
+        auto* device = App::GetRenderer().GetDevice();
+#if LOGGING == 1
+        App::DeltaTimer timer;
+        timer.Start();
+#endif
+        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+
+#if LOGGING == 1
+        timer.End();
+        LOG_UI_INFO("Compiled shader %s in %u [ms].", pathToCompiledCS ? pathToCompiledCS : "", 
+            (uint32_t)timer.DeltaMilli());
+#endif
+
+        inLibrary = StoreInLibrary(key, pso);
+    }
+    else
+        CheckHR(hr);
+
+    m_compiledPSOs[idx] = pso;
+    m_index.Publish(idx, key, inLibrary, pathToCompiledCS);
+
+    if (stalePSO)
+        stalePSO->Release();
+
+    return pso;
+}
+
 void PipelineStateLibrary::Reload(uint64_t idx, ID3D12RootSignature* rootSig, 
     const char* pathToHlsl, bool flushGpu)
 {
@@ -245,7 +441,11 @@ void PipelineStateLibrary::Reload(uint64_t idx, ID3D12RootSignature* rootSig,
     LOG_UI_INFO("Reloaded shader %s in %u [ms].", pathToHlsl, (uint32_t)timer.DeltaMilli());
 #endif
 
-    m_needsRebuild.store(true, std::memory_order_relaxed);
+    // Append the new PSO to the library -- the old one becomes stale
+    const uint64_t key = XXH3_64bits_withSeed(bytecode.data(), bytecode.size(), 
+        GetRootSignatureHash(rootSig));
+    const bool inLibrary = key == m_index.Key((uint32_t)idx) ? m_index.InLibrary((uint32_t)idx) : 
+        StoreInLibrary(key, pso);
 
     ID3D12PipelineState* oldPSO = m_compiledPSOs[idx];
     Assert(oldPSO, "Reload was called for a shader that hasn't been loaded yet.");
@@ -286,6 +486,7 @@ void PipelineStateLibrary::Reload(uint64_t idx, ID3D12RootSignature* rootSig,
 
     // Replace the old PSO
     m_compiledPSOs[idx] = pso;
+    m_index.Publish((uint32_t)idx, key, inLibrary, csoFilename);
     
     App::GetScene().SceneModified();
 }
@@ -316,75 +517,67 @@ ID3D12PipelineState* PipelineStateLibrary::CompileGraphicsPSO(uint32_t idx,
     psoDesc.PS.pShaderBytecode = psBytecode.data();
     psoDesc.pRootSignature = rootSig;
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
+    // Hash the fixed-function state without the pointers, followed by the data they point to
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC state = psoDesc;
+    state.pRootSignature = nullptr;
+    state.VS = D3D12_SHADER_BYTECODE{};
+    state.PS = D3D12_SHADER_BYTECODE{};
+    state.InputLayout.pInputElementDescs = nullptr;
+    state.StreamOutput = D3D12_STREAM_OUTPUT_DESC{};
+    state.CachedPSO = D3D12_CACHED_PIPELINE_STATE{};
 
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG :
-        m_psoLibrary->LoadGraphicsPipeline(nameWide, &psoDesc, IID_PPV_ARGS(&pso));
+    uint64_t key = XXH3_64bits_withSeed(&state, sizeof(state), GetRootSignatureHash(rootSig));
+    key = XXH3_64bits_withSeed(vsBytecode.data(), vsBytecode.size(), key);
+    key = XXH3_64bits_withSeed(psBytecode.data(), psBytecode.size(), key);
 
-    if (hr == E_INVALIDARG)
+    for (uint32_t i = 0; i < psoDesc.InputLayout.NumElements; i++)
     {
-        m_needsRebuild.store(true, std::memory_order_relaxed);
+        D3D12_INPUT_ELEMENT_DESC e = psoDesc.InputLayout.pInputElementDescs[i];
+        const char* semantic = e.SemanticName;
+        e.SemanticName = nullptr;
 
-        auto* device = App::GetRenderer().GetDevice();
-        CheckHR(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
+        key = XXH3_64bits_withSeed(&e, sizeof(e), key);
+        key = XXH3_64bits_withSeed(semantic, strlen(semantic), key);
     }
 
-    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
-    m_compiledPSOs[idx] = pso;
-
-    return pso;
-}
+    const PipelineCacheIndex::ACQUIRE res = m_index.Acquire(idx, key);
 
-ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx, 
-    ID3D12RootSignature* rootSig, const char* pathToCompiledCS)
-{
-    Filesystem::Path pCs(App::GetCompileShadersDir());
-    pCs.Append(pathToCompiledCS);
+    if (res == PipelineCacheIndex::ACQUIRE::HIT)
+        return m_compiledPSOs[idx];
 
-    SmallVector<uint8_t> bytecode;
-    Filesystem::LoadFromFile(pCs.Get(), bytecode);
+    // Same as compute PSOs -- replaced PSO hasn't been handed out to the render pass
+    ID3D12PipelineState* stalePSO = res == PipelineCacheIndex::ACQUIRE::STALE ?
+        m_compiledPSOs[idx] : nullptr;
 
-    D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
-    desc.pRootSignature = rootSig;
-    desc.CS.BytecodeLength = bytecode.size();
-    desc.CS.pShaderBytecode = bytecode.data();
-
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
+    wchar_t nameWide[17];
+    KeyToName(key, nameWide);
 
     ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG :
-        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
+    HRESULT hr = m_index.NumLibraryPSOs() == 0 ? E_INVALIDARG :
+        m_psoLibrary->LoadGraphicsPipeline(nameWide, &psoDesc, IID_PPV_ARGS(&pso));
+    bool inLibrary = SUCCEEDED(hr);
 
     if (hr == E_INVALIDARG)
     {
-        m_needsRebuild.store(true, std::memory_order_relaxed);
-
-#if LOGGING == 1
-        App::DeltaTimer timer;
-        timer.Start();
-#endif
-
         auto* device = App::GetRenderer().GetDevice();
-        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+        CheckHR(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
 
-#if LOGGING == 1
-        timer.End();
-        LOG_UI_INFO("Compiled shader %s in %u [ms].", pathToCompiledCS, (uint32_t)timer.DeltaMilli());
-#endif
+        inLibrary = StoreInLibrary(key, pso);
     }
+    else
+        CheckHR(hr);
 
-    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
+    // Graphics PSOs aren't warmed up, so there's no need to record the shader paths
     m_compiledPSOs[idx] = pso;
+    m_index.Publish(idx, key, inLibrary, nullptr);
+
+    if (stalePSO)
+        stalePSO->Release();
 
     return pso;
 }
 
-ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO_MT(uint32_t idx, 
+ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx, 
     ID3D12RootSignature* rootSig, const char* pathToCompiledCS)
 {
     Filesystem::Path pCs(App::GetCompileShadersDir());
@@ -398,44 +591,14 @@ ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO_MT(uint32_t idx,
     desc.CS.BytecodeLength = bytecode.size();
     desc.CS.pShaderBytecode = bytecode.data();
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
-
-    // MS docs: "The pipeline library is thread-safe to use, and will internally synchronize 
-    // as necessary, with one exception: multiple threads loading the same PSO (via LoadComputePipeline, 
-    // LoadGraphicsPipeline, or LoadPipeline) should synchronize themselves, as this act may modify 
-    // the state of that pipeline within the library in a non-thread-safe manner."
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG :
-        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
-
-    // A PSO with the specified name doesn’t exist, or the input desc doesn’t match the data in
-    // the library. Compile the PSO and then store it in the library for next time.
-    if (hr == E_INVALIDARG)
-    {
-        // If some PSO is modified or not found, then the PSO library needs to be recreated.
-        m_needsRebuild.store(true, std::memory_order_relaxed);
-
-        auto* device = App::GetRenderer().GetDevice();
-#if LOGGING == 1
-        App::DeltaTimer timer;
-        timer.Start();
-#endif
-        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
-
-#if LOGGING == 1
-        timer.End();
-        LOG_UI_INFO("Compiled shader %s in %u [ms].", pathToCompiledCS, (uint32_t)timer.DeltaMilli());
-#endif
-    }
-
-    AcquireSRWLockExclusive(&m_mapLock);
-    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
-    m_compiledPSOs[idx] = pso;
-    ReleaseSRWLockExclusive(&m_mapLock);
+    return LoadOrCompileComputePSO(idx, desc, pathToCompiledCS, true);
+}
 
-    return pso;
+ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO_MT(uint32_t idx, 
+    ID3D12RootSignature* rootSig, const char* pathToCompiledCS)
+{
+    // CompileComputePSO() is thread-safe
+    return CompileComputePSO(idx, rootSig, pathToCompiledCS);
 }
 
 ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx, 
@@ -446,24 +609,6 @@ ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx,
     desc.CS.BytecodeLength = compiledBlob.size();
     desc.CS.pShaderBytecode = compiledBlob.data();
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
-
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG : 
-        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
-
-    if (hr == E_INVALIDARG)
-    {
-        m_needsRebuild.store(true, std::memory_order_relaxed);
-
-        auto* device = App::GetRenderer().GetDevice();
-        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
-    }
-
-    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
-    m_compiledPSOs[idx] = pso;
-
-    return pso;
-}
+    // Bytecode doesn't come from a file, so it can't be warmed up
+    return LoadOrCompileComputePSO(idx, desc, nullptr, true);
+}
\ No newline at end of file
@@ -2,10 +2,17 @@
 
 #include "../Core/Device.h"
 #include "../App/Path.h"
+#include "../Support/Task.h"
+#include "../Support/PipelineCacheIndex.h"
 #include <atomic>
 
 namespace ZetaRay::Core
 {
+    // Each PSO is stored in the pipeline library under the hash of its contents (shader bytecode
+    // + root signature), so modified shaders don't invalidate the rest of the library -- new PSOs
+    // are appended and the library is only rebuilt once too many stale PSOs have accumulated.
+    // An index of (PSO index, hash, path to compiled shader) is stored next to the library, which
+    // allows every known PSO to be precompiled on a background thread during startup (WarmUp()).
     class PipelineStateLibrary
     {
     public:
@@ -16,8 +23,12 @@ namespace ZetaRay::Core
         PipelineStateLibrary& operator=(PipelineStateLibrary&&) = delete;
 
         void Init(const char* name);
+        // Submits a background task that compiles (or loads from the library) every PSO
+        // in the index that hasn't been compiled yet. Root signature must remain valid until
+        // Reset() is called.
+        void WarmUp(ID3D12RootSignature* rootSig);
         void Reset();
-        void Reload(uint64_t idx, ID3D12RootSignature* rootSig, const char* pathToHlsl, 
+        void Reload(uint64_t idx, ID3D12RootSignature* rootSig, const char* pathToHlsl,
             bool flushGpu = false);
 
         ID3D12PipelineState* CompileGraphicsPSO(uint32_t idx,
@@ -41,17 +52,29 @@ namespace ZetaRay::Core
         }
 
     private:
+        ID3D12PipelineState* LoadOrCompileComputePSO(uint32_t idx,
+            D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const char* pathToCompiledCS, bool wait);
+        bool StoreInLibrary(uint64_t key, ID3D12PipelineState* pso);
+        void LoadIndex();
+        void WriteIndex();
+        void CancelWarmUp();
         void ResetToEmptyPsoLib();
-        void ClearAndFlushToDisk();
+        void FlushToDisk();
 
         App::Filesystem::Path m_psoLibPath1;
+        App::Filesystem::Path m_indexPath;
         ComPtr<ID3D12PipelineLibrary> m_psoLibrary;
         Util::MutableSpan<ID3D12PipelineState*> m_compiledPSOs;
+        Support::PipelineCacheIndex m_index;
         Util::SmallVector<uint8_t> m_cachedBlob;
 
-        SRWLOCK m_mapLock = SRWLOCK_INIT;
+        Support::WaitObject m_warmUpDone;
+        std::atomic_bool m_warmUpPending = false;
+        std::atomic_bool m_cancelWarmUp = false;
+        // Set when new PSOs were appended to the library or it was rebuilt
+        std::atomic_bool m_libraryModified = false;
+        // Set when there was a name collision in the library (e.g. same shader with a different
+        // root signature that wasn't tagged with a hash)
         std::atomic_bool m_needsRebuild = false;
-        bool m_foundOnDisk = false;
-        bool m_psoWasReset = false;
     };
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "Direct3DUtil.h"
 #include "../Support/Task.h"
 #include "../Support/Param.h"
+#include "../Support/FramePipeline.h"
 #include "../App/Timer.h"
 #include "../Assets/Font/IconsFontAwesome6.h"
 
@@ -11,15 +12,17 @@ using namespace ZetaRay::Core;
 using namespace ZetaRay::Core::GpuMemory;
 using namespace ZetaRay::Support;
 
+// Waiting for the frame that is MAX_FRAMES_IN_FLIGHT frames back also ensures its back buffer
+// is no longer in use
+static_assert(FramePipeline::MAX_FRAMES_IN_FLIGHT <= Constants::NUM_BACK_BUFFERS,
+    "Back buffers could be reused while the GPU is still using them.");
+
 //--------------------------------------------------------------------------------------
 // RendererCore
 //--------------------------------------------------------------------------------------
 
 RendererCore::RendererCore()
-    : m_cbvSrvUavDescHeapGpu(32),
-    m_cbvSrvUavDescHeapCpu(32),
-    m_rtvDescHeap(8),
-    m_directQueue(D3D12_COMMAND_LIST_TYPE_DIRECT),
+    : m_directQueue(D3D12_COMMAND_LIST_TYPE_DIRECT),
     m_computeQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE)
 {}
 
@@ -235,11 +238,29 @@ void RendererCore::WaitForSwapChainWaitableObject()
     WaitForSingleObject(m_deviceObjs.m_frameLatencyWaitableObj, 16);
 }
 
+void RendererCore::WaitForFrame(uint64_t frame)
+{
+    const uint64_t fenceVal = m_frameFenceVals[FramePipeline::Slot(frame)];
+
+    if (m_fence->GetCompletedValue() < fenceVal)
+    {
+        CheckHR(m_fence->SetEventOnCompletion(fenceVal, m_event));
+        WaitForSingleObject(m_event, INFINITE);
+    }
+}
+
 void RendererCore::BeginFrame()
 {
     if (App::GetTimer().GetTotalFrameCount() > 0)
         GpuMemory::BeginFrame();
 
+    // Worker tasks from previous frame have finished, so the main and worker threads can't
+    // be using their descriptor caches. Background threads may still be running.
+    const int numThreads = App::GetNumWorkerThreads();
+    m_cbvSrvUavDescHeapGpu.FlushThreadCaches(numThreads);
+    m_cbvSrvUavDescHeapCpu.FlushThreadCaches(numThreads);
+    m_rtvDescHeap.FlushThreadCaches(numThreads);
+
     m_gpuTimer.BeginFrame();
 }
 
@@ -253,6 +274,9 @@ void RendererCore::SubmitResourceCopies()
     App::AddFrameStat("Renderer", "Gpu Desc. Heap", 
         m_cbvSrvUavDescHeapGpu.GetHeapSize() - m_cbvSrvUavDescHeapGpu.GetNumFreeDescriptors(), 
         m_cbvSrvUavDescHeapGpu.GetHeapSize());
+
+    const auto gpuHeapReport = m_cbvSrvUavDescHeapGpu.GetFragmentationReport();
+    App::AddFrameStat("Renderer", "Gpu Desc. Heap Frag.", gpuHeapReport.Fragmentation);
 }
 
 void RendererCore::EndFrame(TaskSet& endFrameTS)
@@ -276,24 +300,15 @@ void RendererCore::EndFrame(TaskSet& endFrameTS)
                 CheckHR(hr);
             }
 
-            // Schedule a Signal command in the queue.
-            // Set the fence value for the next frame.
-            m_fenceVals[m_currBackBuffIdx] = m_nextFenceVal;
+            // Schedule a Signal command in the queue. The CPU waits on it before starting
+            // the frame that's MAX_FRAMES_IN_FLIGHT or fewer frames later (see WaitForFrame()).
+            const uint64_t frame = App::GetFramePipeline().GetCurrentFrame();
+            m_frameFenceVals[FramePipeline::Slot(frame)] = m_nextFenceVal;
             CheckHR(m_directQueue.GetCommandQueue()->Signal(m_fence.Get(), m_nextFenceVal++));
 
-            // Update the back buffer index.
-            const uint16_t nextBackBuffidx = (uint16_t)m_deviceObjs.m_dxgiSwapChain->GetCurrentBackBufferIndex();
-            const uint64_t completed = m_fence->GetCompletedValue();
-
-            if (completed < m_fenceVals[nextBackBuffidx])
-            {
-                CheckHR(m_fence->SetEventOnCompletion(m_fenceVals[nextBackBuffidx], m_event));
-                //uint64_t f = App::GetTimer().GetTotalFrameCount();
-                //printf("Frame %llu, CPU waiting for GPU...\n", f);
-                WaitForSingleObject(m_event, INFINITE);
-            }
-
-            m_currBackBuffIdx = nextBackBuffidx;
+            // Update the back buffer index. Since there are at least as many back buffers as
+            // frames in flight, its previous frame has completed once the next frame begins.
+            m_currBackBuffIdx = (uint16_t)m_deviceObjs.m_dxgiSwapChain->GetCurrentBackBufferIndex();
             m_globalDoubleBuffIdx = (m_globalDoubleBuffIdx + 1) & 0x1;
         });
 
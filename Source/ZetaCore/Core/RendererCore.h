@@ -38,6 +38,8 @@ namespace ZetaRay::Core
         void OnWindowSizeChanged(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight, 
             uint16_t displayWidth, uint16_t displayHeight);
         void WaitForSwapChainWaitableObject();
+        // Blocks until the GPU has finished the given frame (see FramePipeline)
+        void WaitForFrame(uint64_t frame);
         void BeginFrame();
         void SubmitResourceCopies();
         void EndFrame(Support::TaskSet& endFrameTS);
@@ -125,9 +127,9 @@ namespace ZetaRay::Core
         DeviceObjects m_deviceObjs;
 
         SharedShaderResources m_sharedShaderRes;
-        DescriptorHeap m_cbvSrvUavDescHeapGpu;
-        DescriptorHeap m_cbvSrvUavDescHeapCpu;
-        DescriptorHeap m_rtvDescHeap;
+        DescriptorHeap m_cbvSrvUavDescHeapGpu{ "GPU descriptor heap" };
+        DescriptorHeap m_cbvSrvUavDescHeapCpu{ "CPU descriptor heap" };
+        DescriptorHeap m_rtvDescHeap{ "RTV descriptor heap" };
         ComPtr<ID3D12DescriptorHeap> m_samplerDescHeap;
         //DescriptorHeap m_dsvDescHeap;
         CommandQueue m_directQueue;
@@ -157,7 +159,8 @@ namespace ZetaRay::Core
         D3D12_STATIC_SAMPLER_DESC m_staticSamplers[9];
 
         ComPtr<ID3D12Fence> m_fence;
-        uint64_t m_fenceVals[Constants::NUM_BACK_BUFFERS] = { 0 };
+        // Indexed by FramePipeline::Slot()
+        uint64_t m_frameFenceVals[Constants::NUM_BACK_BUFFERS] = { 0 };
         uint64_t m_nextFenceVal = 1;
         HANDLE m_event;
 
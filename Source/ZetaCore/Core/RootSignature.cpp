@@ -10,6 +10,10 @@ using namespace ZetaRay::Util;
 
 namespace
 {
+    // {6A1F4F0E-3B7C-4D52-9A61-2E8C4B13D705}
+    static constexpr GUID ROOT_SIG_HASH_GUID = { 0x6a1f4f0e, 0x3b7c, 0x4d52, 
+        { 0x9a, 0x61, 0x2e, 0x8c, 0x4b, 0x13, 0xd7, 0x5 } };
+
     template <typename T>
     requires std::same_as<T, GraphicsCmdList> || std::same_as<T, ComputeCmdList>
     void End_Internal(T& ctx, uint32_t rootCBVBitMap, uint32_t rootSRVBitMap, uint32_t rootUAVBitMap, 
@@ -142,6 +146,23 @@ namespace
 // RootSignature
 //--------------------------------------------------------------------------------------
 
+void Core::SetRootSignatureHash(ID3D12RootSignature* rootSig, const void* serializedBlob, size_t size)
+{
+    const uint64_t hash = XXH3_64bits(serializedBlob, size);
+    CheckHR(rootSig->SetPrivateData(ROOT_SIG_HASH_GUID, sizeof(hash), &hash));
+}
+
+uint64_t Core::GetRootSignatureHash(ID3D12RootSignature* rootSig)
+{
+    uint64_t hash = 0;
+    UINT size = sizeof(hash);
+
+    if (FAILED(rootSig->GetPrivateData(ROOT_SIG_HASH_GUID, &size, &hash)))
+        return 0;
+
+    return hash;
+}
+
 RootSignature::RootSignature(int nCBV, int nSRV, int nUAV, int nGlobs, int nConsts)
     : m_numParams(nCBV + nSRV + nUAV + (nConsts > 0)),
     m_numCBVs(nCBV),
@@ -283,6 +304,7 @@ void RootSignature::Finalize(const char* name, ComPtr<ID3D12RootSignature>& root
 
     Assert(name, "name was NULL");
     rootSig->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)strlen(name), name);
+    SetRootSignatureHash(rootSig.Get(), pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize());
 
     // Calculate root parameter index for root constants (if any)
     uint32_t u = (1 << m_numParams) - 1;        // set the first NumParams() bits to 1
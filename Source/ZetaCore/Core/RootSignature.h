@@ -13,6 +13,12 @@ namespace ZetaRay::Core
     class GraphicsCmdList;
     class ComputeCmdList;
 
+    // Root signatures are tagged with a hash of their serialized blob, which is used (along with the
+    // shader bytecode) to key PSOs in the on-disk PSO cache
+    void SetRootSignatureHash(ID3D12RootSignature* rootSig, const void* serializedBlob, size_t size);
+    // Returns 0 if the root signature wasn't tagged
+    uint64_t GetRootSignatureHash(ID3D12RootSignature* rootSig);
+
     // All the needed scenarios
     // 
     // 1. Upload heap buffer (read-only, GENERIC_READ)
@@ -11,7 +11,7 @@
 
 namespace ZetaRay::Math
 {
-    struct alignas(16) float4x4a;
+    struct float4x4a;
 
     class BVH
     {
@@ -29,13 +29,12 @@ namespace ZetaRay::Math
 
         for (int i = 1; i < (int)numVertices; i++)
         {
+            dataPtr += vtxStride;
             currPos = reinterpret_cast<float3*>(dataPtr);
 
             vPos = _mm_loadu_ps(reinterpret_cast<float*>(currPos));
             vMin = _mm_min_ps(vPos, vMin);
             vMax = _mm_max_ps(vPos, vMax);
-
-            dataPtr += vtxStride;
         }
 
         const __m128 vOneDivTwo = _mm_set1_ps(0.5f);
@@ -52,7 +52,7 @@ size_t Math::SubdivideRangeWithMin(size_t n, size_t maxNumGroups, MutableSpan<si
         return 0;
 
     size_t groupSize = Max(n / maxNumGroups, minNumElems);
-    size_t actualNumGroups = Max(n / groupSize, 1llu);
+    size_t actualNumGroups = Max(n / groupSize, (size_t)1);
 
     for (size_t i = 0; i < actualNumGroups; i++)
     {
@@ -118,6 +118,55 @@ namespace ZetaRay::Math
         return vRes;
     }
 
+    // Interpolates 8 pairs of quaternions at once. Quaternions are in SoA layout, i.e. vQ1[0]
+    // contains the x component of all the 8 quaternions, vQ1[1] the y component and so on.
+    ZetaInline void __vectorcall slerp(const __m256 vQ1[4], const __m256 vQ2[4], const __m256 vT,
+        __m256 vRes[4])
+    {
+        const __m256 vOne = _mm256_set1_ps(1.0f);
+        const __m256 vMinusZero = _mm256_set1_ps(-0.0f);
+
+        __m256 vCosTheta = _mm256_mul_ps(vQ1[0], vQ2[0]);
+        vCosTheta = _mm256_fmadd_ps(vQ1[1], vQ2[1], vCosTheta);
+        vCosTheta = _mm256_fmadd_ps(vQ1[2], vQ2[2], vCosTheta);
+        vCosTheta = _mm256_fmadd_ps(vQ1[3], vQ2[3], vCosTheta);
+
+        // If on opposite hemispheres, negate one of them (see scalar version above)
+        const __m256 vSign = _mm256_and_ps(vCosTheta, vMinusZero);
+        vCosTheta = _mm256_xor_ps(vCosTheta, vSign);
+
+        const __m256 vSinTheta = _mm256_sqrt_ps(_mm256_fnmadd_ps(vCosTheta, vCosTheta, vOne));
+        const __m256 vTheta = acos(vCosTheta);
+        const __m256 vS1 = sin(_mm256_mul_ps(_mm256_sub_ps(vOne, vT), vTheta));
+        const __m256 vS2 = _mm256_xor_ps(sin(_mm256_mul_ps(vT, vTheta)), vSign);
+        const __m256 vRcpSinTheta = _mm256_div_ps(vOne, vSinTheta);
+
+        // If theta is near zero, use linear interpolation followed by normalization,
+        // otherwise, there might be a divide-by-zero.
+        const __m256 vIsThetaNearZero = _mm256_cmp_ps(vCosTheta, _mm256_set1_ps(1.0f - FLT_EPSILON), 
+            _CMP_GT_OQ);
+        const __m256 vT2 = _mm256_xor_ps(vT, vSign);
+        __m256 vLerp[4];
+        __m256 vNorm2 = _mm256_setzero_ps();
+
+        for (int i = 0; i < 4; i++)
+        {
+            vLerp[i] = _mm256_fmadd_ps(vT2, vQ2[i], _mm256_fnmadd_ps(vT, vQ1[i], vQ1[i]));
+            vNorm2 = _mm256_fmadd_ps(vLerp[i], vLerp[i], vNorm2);
+        }
+
+        const __m256 vRcpNorm = _mm256_rsqrt_ps(vNorm2);
+
+        for (int i = 0; i < 4; i++)
+        {
+            __m256 vSlerp = _mm256_mul_ps(vQ1[i], vS1);
+            vSlerp = _mm256_fmadd_ps(vQ2[i], vS2, vSlerp);
+            vSlerp = _mm256_mul_ps(vSlerp, vRcpSinTheta);
+
+            vRes[i] = _mm256_blendv_ps(vSlerp, _mm256_mul_ps(vLerp[i], vRcpNorm), vIsThetaNearZero);
+        }
+    }
+
     /* TODO
     // pitch: angle of rotation around the x-axis (radians)
     // yaw: angle of rotation around the y-axis (radians)
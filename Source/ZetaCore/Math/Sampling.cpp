@@ -1,5 +1,6 @@
 #include "Sampling.h"
 #include <Utility/RNG.h>
+#include <Support/MemoryReport.h>
 #include <cmath>
 
 using namespace ZetaRay;
@@ -157,6 +158,113 @@ uint32_t Math::SampleAliasTable(Span<AliasTableEntry> table, RNG& rng, float& pd
     return s.Alias;
 }
 
+//--------------------------------------------------------------------------------------
+// DynamicDistribution
+//--------------------------------------------------------------------------------------
+
+void DynamicDistribution::Init(Span<float> weights)
+{
+    Assert(weights.size() < UINT32_MAX, "Invalid number of weights.");
+    const size_t N = weights.size();
+
+    m_weights.resize(N);
+    m_tree.resize(N + 1);
+    m_tree[0] = 0.0;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        Assert(weights[i] >= 0.0f && !IsNaN(weights[i]), "Invalid weight.");
+        m_weights[i] = weights[i];
+        m_tree[i + 1] = weights[i];
+    }
+
+    // Linear-time construction -- push each node's sum to its parent
+    for (size_t j = 1; j <= N; j++)
+    {
+        const size_t parent = j + (j & (0 - j));
+        if (parent <= N)
+            m_tree[parent] += m_tree[j];
+    }
+
+    // Largest power of 2 that is <= N
+    m_topBit = N ? (IsPow2(N) ? N : NextPow2(N) >> 1) : 0;
+    m_total = PrefixSum(N);
+}
+
+void DynamicDistribution::Clear()
+{
+    m_weights.free_memory();
+    m_tree.free_memory();
+    m_total = 0.0;
+    m_topBit = 0;
+}
+
+void DynamicDistribution::ReportMemory(Support::MemoryReport& report) const
+{
+    report.Add("DynamicDistribution", "m_weights", m_weights);
+    report.Add("DynamicDistribution", "m_tree", m_tree);
+}
+
+void DynamicDistribution::Set(size_t i, float w)
+{
+    Assert(i < m_weights.size(), "Out-of-bound access.");
+    Assert(w >= 0.0f && !IsNaN(w), "Invalid weight.");
+
+    const double delta = (double)w - (double)m_weights[i];
+    if (delta == 0.0)
+        return;
+
+    m_weights[i] = w;
+
+    for (size_t j = i + 1; j < m_tree.size(); j += j & (0 - j))
+        m_tree[j] += delta;
+
+    // Recompute rather than accumulate so that total is consistent with the tree
+    m_total = PrefixSum(m_weights.size());
+}
+
+double DynamicDistribution::PrefixSum(size_t i) const
+{
+    double sum = 0.0;
+
+    for (size_t j = i; j > 0; j -= j & (0 - j))
+        sum += m_tree[j];
+
+    return sum;
+}
+
+uint32_t DynamicDistribution::Sample(float u, float& pdf) const
+{
+    Assert(m_total > 0.0, "Distribution is empty.");
+    const size_t N = m_weights.size();
+
+    // Find the first element i such that PrefixSum(i + 1) > u * total
+    double target = u * m_total;
+    size_t pos = 0;
+
+    for (size_t step = m_topBit; step > 0; step >>= 1)
+    {
+        const size_t next = pos + step;
+
+        if (next <= N && m_tree[next] <= target)
+        {
+            pos = next;
+            target -= m_tree[next];
+        }
+    }
+
+    // Only due to floating-point errors, when u * total is (almost) equal to total
+    if (pos == N)
+        pos--;
+
+    while (pos > 0 && m_weights[pos] == 0.0f)
+        pos--;
+
+    pdf = Pdf(pos);
+
+    return (uint32_t)pos;
+}
+
 float Math::Halton(int i, int b)
 {
     float f = 1.0f;
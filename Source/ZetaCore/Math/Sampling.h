@@ -1,13 +1,20 @@
 #pragma once
 
 #include <Utility/Span.h>
+#include <Utility/SmallVector.h>
 #include <Math/Vector.h>
+#include <algorithm>
 
 namespace ZetaRay::Util
 {
     struct RNG;
 }
 
+namespace ZetaRay::Support
+{
+    struct MemoryReport;
+}
+
 namespace ZetaRay::Math
 {
     // Generates i'th index of the Halton low-discrepancy sequence for base b 
@@ -31,4 +38,283 @@ namespace ZetaRay::Math
     void AliasTable_Build(Util::MutableSpan<float> weights, Util::MutableSpan<AliasTableEntry> table);
     // Draws sample from the given alias table
     uint32_t SampleAliasTable(Util::Span<AliasTableEntry> table, Util::RNG& rng, float& pdf);
+
+    // Builds an alias table in parallel. Gives the same table as the sequential sweeping
+    // construction (Ref: Hübschle-Schneider & Sanders, "Parallel Weighted Random Sampling"),
+    // where light (p < 1) and heavy (p >= 1) elements are visited in index order and the 
+    // current heavy element fills the next light one until it becomes light itself. With 
+    // prefix sums of light elements' deficits D (1 - p) and heavy elements' excesses E (p - 1),
+    // alias of light element a is the first heavy element b where E(b + 1) >= D(a), while 
+    // heavy element b becomes light once D(a) > E(b + 1), so every element can be processed
+    // independently.
+    //
+    // Weights don't need to be normalized and aren't modified. Allocator is used for the
+    // temporary per-element storage (12 bytes per element). Usage:
+    //  1. Init()
+    //  2. Sum(chunk) for every chunk in [0, NumChunks())
+    //  3. Classify(chunk) for every chunk
+    //  4. Partition(chunk) for every chunk
+    //  5. Assign(chunk, setEntry) for every chunk
+    // Calls for different chunks of the same step can run in parallel.
+    template<Support::AllocatorType Allocator = Support::SystemAllocator>
+    struct AliasTableBuilder
+    {
+        static constexpr int MAX_NUM_CHUNKS = 16;
+
+        void Init(Util::Span<float> weights, int numChunks);
+        // Releases the temporary storage along with the allocator's state, e.g. so that
+        // a one-time allocator can be used again
+        void Clear();
+        ZetaInline int NumChunks() const { return m_numChunks; }
+        // Probability of element i (to be multiplied by 1 / N)
+        ZetaInline float NormalizedWeight(size_t i) const { return m_weights[i] * m_normalizeFactor; }
+
+        void Sum(int chunk);
+        void Classify(int chunk);
+        void Partition(int chunk);
+        // Calls setEntry(i, P_Curr, Alias) for elements of the given chunk
+        template<typename Fn>
+        void Assign(int chunk, Fn setEntry) const
+        {
+            const size_t beg = ChunkBeg(chunk);
+            const size_t end = ChunkBeg(chunk + 1);
+            // Both searches are monotone within a chunk
+            size_t b = beg < m_numLights ? FirstHeavyCovering(m_prefixSums[beg]) : 0;
+            size_t a = end > m_numLights ? FirstLightExceeding(m_prefixSums[Max(beg, m_numLights)]) : 0;
+
+            for (size_t i = beg; i < end; i++)
+            {
+                const uint32_t idx = m_partitioned[i];
+
+                if (i < m_numLights)
+                {
+                    while (b < m_numHeavies && m_prefixSums[m_numLights + b] < m_prefixSums[i])
+                        b++;
+
+                    // Only due to floating-point errors
+                    if (b == m_numHeavies)
+                        setEntry(idx, 1.0f, idx);
+                    else
+                        setEntry(idx, NormalizedWeight(idx), m_partitioned[m_numLights + b]);
+                }
+                else
+                {
+                    const double excess = m_prefixSums[i];
+                    while (a < m_numLights && m_prefixSums[a] <= excess)
+                        a++;
+
+                    // Deficit up to and including the light element that made this one light
+                    const double deficit = a < m_numLights ? m_prefixSums[a] : m_totalDeficit;
+
+                    // Last heavy element(s) are left with (roughly) 1
+                    if (excess >= deficit || i == m_partitioned.size() - 1)
+                        setEntry(idx, 1.0f, idx);
+                    else
+                    {
+                        const float pCurr = (float)(1.0 + excess - deficit);
+                        setEntry(idx, pCurr, m_partitioned[i + 1]);
+                    }
+                }
+            }
+        }
+
+    private:
+        ZetaInline size_t ChunkBeg(int chunk) const
+        {
+            return (m_weights.size() * chunk) / m_numChunks;
+        }
+        size_t FirstHeavyCovering(double deficit) const;
+        size_t FirstLightExceeding(double excess) const;
+
+        Util::Span<float> m_weights = { nullptr, 0 };
+        float m_normalizeFactor;
+        int m_numChunks;
+        size_t m_numLights;
+        size_t m_numHeavies;
+        double m_totalDeficit;
+
+        double m_chunkSum[MAX_NUM_CHUNKS];
+        size_t m_chunkNumLights[MAX_NUM_CHUNKS];
+        double m_chunkDeficit[MAX_NUM_CHUNKS];
+        double m_chunkExcess[MAX_NUM_CHUNKS];
+
+        // Indices of light elements followed by heavy ones, both in index order
+        Util::SmallVector<uint32_t, Allocator> m_partitioned;
+        // For light elements, deficit of preceding light elements (exclusive scan). For heavy
+        // elements, excess of preceding heavy elements including itself (inclusive scan).
+        Util::SmallVector<double, Allocator> m_prefixSums;
+    };
+
+    template<Support::AllocatorType Allocator>
+    void AliasTableBuilder<Allocator>::Init(Util::Span<float> weights, int numChunks)
+    {
+        Assert(numChunks > 0 && numChunks <= MAX_NUM_CHUNKS, "Invalid number of chunks.");
+        Assert(weights.size() < UINT32_MAX, "Invalid number of weights.");
+
+        m_weights = weights;
+        m_numChunks = (int)Min((size_t)numChunks, Max(weights.size(), (size_t)1));
+        m_partitioned.resize(weights.size());
+        m_prefixSums.resize(weights.size());
+    }
+
+    template<Support::AllocatorType Allocator>
+    void AliasTableBuilder<Allocator>::Clear()
+    {
+        m_weights = Util::Span<float>(nullptr, 0);
+        m_partitioned = Util::SmallVector<uint32_t, Allocator>();
+        m_prefixSums = Util::SmallVector<double, Allocator>();
+    }
+
+    template<Support::AllocatorType Allocator>
+    void AliasTableBuilder<Allocator>::Sum(int chunk)
+    {
+        double sum = 0.0;
+
+        for (size_t i = ChunkBeg(chunk); i < ChunkBeg(chunk + 1); i++)
+            sum += m_weights[i];
+
+        m_chunkSum[chunk] = sum;
+    }
+
+    template<Support::AllocatorType Allocator>
+    void AliasTableBuilder<Allocator>::Classify(int chunk)
+    {
+        double total = 0.0;
+        for (int c = 0; c < m_numChunks; c++)
+            total += m_chunkSum[c];
+
+        Assert(total > 0.0 && !IsNaN((float)total), "Invalid sum of weights.");
+
+        // Multiply each probability by N so that mean becomes 1 instead of 1 / N
+        const float normalizeFactor = (float)(m_weights.size() / total);
+        if (chunk == 0)
+            m_normalizeFactor = normalizeFactor;
+
+        size_t numLights = 0;
+        double deficit = 0.0;
+        double excess = 0.0;
+
+        for (size_t i = ChunkBeg(chunk); i < ChunkBeg(chunk + 1); i++)
+        {
+            const float p = m_weights[i] * normalizeFactor;
+
+            if (p < 1.0f)
+            {
+                numLights++;
+                deficit += 1.0 - p;
+            }
+            else
+                excess += p - 1.0;
+        }
+
+        m_chunkNumLights[chunk] = numLights;
+        m_chunkDeficit[chunk] = deficit;
+        m_chunkExcess[chunk] = excess;
+    }
+
+    template<Support::AllocatorType Allocator>
+    void AliasTableBuilder<Allocator>::Partition(int chunk)
+    {
+        size_t numLights = 0;
+        size_t lightOffset = 0;
+        size_t heavyOffset = 0;
+        double totalDeficit = 0.0;
+        double deficit = 0.0;
+        double excess = 0.0;
+
+        for (int c = 0; c < m_numChunks; c++)
+        {
+            if (c < chunk)
+            {
+                lightOffset += m_chunkNumLights[c];
+                heavyOffset += (ChunkBeg(c + 1) - ChunkBeg(c)) - m_chunkNumLights[c];
+                deficit += m_chunkDeficit[c];
+                excess += m_chunkExcess[c];
+            }
+
+            numLights += m_chunkNumLights[c];
+            totalDeficit += m_chunkDeficit[c];
+        }
+
+        if (chunk == 0)
+        {
+            m_numLights = numLights;
+            m_numHeavies = m_weights.size() - numLights;
+            m_totalDeficit = totalDeficit;
+        }
+
+        heavyOffset += numLights;
+        const float normalizeFactor = m_normalizeFactor;
+
+        for (size_t i = ChunkBeg(chunk); i < ChunkBeg(chunk + 1); i++)
+        {
+            const float p = m_weights[i] * normalizeFactor;
+
+            if (p < 1.0f)
+            {
+                m_partitioned[lightOffset] = (uint32_t)i;
+                m_prefixSums[lightOffset++] = deficit;
+                deficit += 1.0 - p;
+            }
+            else
+            {
+                excess += p - 1.0;
+                m_partitioned[heavyOffset] = (uint32_t)i;
+                m_prefixSums[heavyOffset++] = excess;
+            }
+        }
+    }
+
+    template<Support::AllocatorType Allocator>
+    size_t AliasTableBuilder<Allocator>::FirstHeavyCovering(double deficit) const
+    {
+        const double* beg = m_prefixSums.data() + m_numLights;
+        const double* end = m_prefixSums.data() + m_prefixSums.size();
+
+        return std::lower_bound(beg, end, deficit) - beg;
+    }
+
+    template<Support::AllocatorType Allocator>
+    size_t AliasTableBuilder<Allocator>::FirstLightExceeding(double excess) const
+    {
+        const double* beg = m_prefixSums.data();
+        const double* end = m_prefixSums.data() + m_numLights;
+
+        return std::upper_bound(beg, end, excess) - beg;
+    }
+
+    // Discrete distribution over weighted elements where changing the weight of an element
+    // only takes O(log N), so that updating K elements costs O(K log N) rather than rebuilding
+    // from scratch. Backed by a Fenwick tree of partial sums -- sampling descends the tree to
+    // invert the CDF in O(log N).
+    struct DynamicDistribution
+    {
+        // Weights don't need to be normalized
+        void Init(Util::Span<float> weights);
+        void Clear();
+        void Set(size_t i, float w);
+        // Returns index of the sampled element for u in [0, 1). Elements with zero weight
+        // are never sampled.
+        uint32_t Sample(float u, float& pdf) const;
+        void ReportMemory(Support::MemoryReport& report) const;
+
+        ZetaInline size_t Size() const { return m_weights.size(); }
+        ZetaInline float Weight(size_t i) const { return m_weights[i]; }
+        ZetaInline Util::Span<float> Weights() const { return m_weights; }
+        ZetaInline double Total() const { return m_total; }
+        ZetaInline float Pdf(size_t i) const
+        {
+            return m_total > 0.0 ? (float)(m_weights[i] / m_total) : 0.0f;
+        }
+
+    private:
+        // Sum of the first i elements
+        double PrefixSum(size_t i) const;
+
+        Util::SmallVector<float> m_weights;
+        // One-based, node j covers elements (j - lowbit(j), j]
+        Util::SmallVector<double> m_tree;
+        double m_total = 0.0;
+        size_t m_topBit = 0;
+    };
 }
@@ -53,6 +53,14 @@ namespace ZetaRay::Math
         return vInterpolated;
     }
 
+    ZetaInline __m256 __vectorcall lerp(const __m256 v0, const __m256 v1, __m256 vT)
+    {
+        // fma(t, v1, fma(-t, v0, v0));
+        __m256 vInterpolated = _mm256_fmadd_ps(vT, v1, _mm256_fnmadd_ps(vT, v0, v0));
+
+        return vInterpolated;
+    }
+
     ZetaInline __m128 __vectorcall length(const __m128 v)
     {
         __m128 vNorm2 = _mm_dp_ps(v, v, 0xff);
@@ -227,6 +235,32 @@ namespace ZetaRay::Math
         return t0;
     }
 
+    // 8-wide version of acos() above
+    ZetaInline __m256 __vectorcall acos(const __m256 V)
+    {
+        __m256 nonnegative = _mm256_cmp_ps(V, _mm256_setzero_ps(), _CMP_GE_OQ);
+        __m256 x = abs(V);
+
+        // Compute (1-|V|), clamp to zero to avoid sqrt of negative number.
+        __m256 oneMValue = _mm256_sub_ps(_mm256_set1_ps(1.0f), x);
+        __m256 clampOneMValue = _mm256_max_ps(_mm256_setzero_ps(), oneMValue);
+        __m256 root = _mm256_sqrt_ps(clampOneMValue);  // sqrt(1-|V|)
+
+        // Compute polynomial approximation
+        __m256 t0 = _mm256_fmadd_ps(_mm256_set1_ps(-0.0012624911f), x, _mm256_set1_ps(0.0066700901f));
+        t0 = _mm256_fmadd_ps(t0, x, _mm256_set1_ps(-0.0170881256f));
+        t0 = _mm256_fmadd_ps(t0, x, _mm256_set1_ps(0.0308918810f));
+        t0 = _mm256_fmadd_ps(t0, x, _mm256_set1_ps(-0.0501743046f));
+        t0 = _mm256_fmadd_ps(t0, x, _mm256_set1_ps(0.0889789874f));
+        t0 = _mm256_fmadd_ps(t0, x, _mm256_set1_ps(-0.2145988016f));
+        t0 = _mm256_fmadd_ps(t0, x, _mm256_set1_ps(1.5707963050f));
+        t0 = _mm256_mul_ps(t0, root);
+
+        __m256 t1 = _mm256_sub_ps(_mm256_set1_ps(PI), t0);
+
+        return _mm256_blendv_ps(t1, t0, nonnegative);
+    }
+
     // Following is ported from DirectXMath (MIT License).
     // vTheta must be in -XM_PI <= theta < XM_PI
     ZetaInline __m128 __vectorcall sin(__m128 vTheta)
@@ -279,6 +313,30 @@ namespace ZetaRay::Math
         return Result;
     }
 
+    // 8-wide version of sin() above. vTheta must be in -XM_PI <= theta < XM_PI
+    ZetaInline __m256 __vectorcall sin(__m256 vTheta)
+    {
+        // Map in [-pi/2,pi/2] with sin(y) = sin(x).
+        __m256 sign = _mm256_and_ps(vTheta, _mm256_set1_ps(-0.0f));
+        __m256 c = _mm256_or_ps(_mm256_set1_ps(PI), sign);  // pi when x >= 0, -pi when x < 0
+        __m256 absx = _mm256_andnot_ps(sign, vTheta);  // |x|
+        __m256 rflx = _mm256_sub_ps(c, vTheta);
+        __m256 comp = _mm256_cmp_ps(absx, _mm256_set1_ps(PI_OVER_2), _CMP_LE_OQ);
+        vTheta = _mm256_blendv_ps(rflx, vTheta, comp);
+
+        __m256 x2 = _mm256_mul_ps(vTheta, vTheta);
+
+        // Compute polynomial approximation
+        __m256 Result = _mm256_fmadd_ps(_mm256_set1_ps(-2.3889859e-08f), x2, _mm256_set1_ps(2.7525562e-06f));
+        Result = _mm256_fmadd_ps(Result, x2, _mm256_set1_ps(-0.00019840874f));
+        Result = _mm256_fmadd_ps(Result, x2, _mm256_set1_ps(0.0083333310f));
+        Result = _mm256_fmadd_ps(Result, x2, _mm256_set1_ps(-0.16666667f));
+        Result = _mm256_fmadd_ps(Result, x2, _mm256_set1_ps(1.0f));
+        Result = _mm256_mul_ps(Result, vTheta);
+
+        return Result;
+    }
+
     ZetaInline float4a __vectorcall store(__m128 v)
     {
         float4a f;
@@ -32,7 +32,7 @@ namespace ZetaRay::Model
             m_vtxBuffStartOffset(vtxBuffStartOffset),
             m_idxBuffStartOffset(idxBuffStartOffset)
         {
-            Assert(vertices.size() < UINT_MAX, "Number of vertices exceeded maximum allowed.");
+            Assert(vertices.size() < UINT32_MAX, "Number of vertices exceeded maximum allowed.");
 
             Math::v_AABB vBox = Math::compueMeshAABB(vertices.data(), offsetof(Core::Vertex, Position),
                 sizeof(Core::Vertex), m_numVertices);
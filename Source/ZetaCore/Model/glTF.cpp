@@ -15,13 +15,17 @@ using namespace ZetaRay;
 using namespace ZetaRay::Scene;
 using namespace ZetaRay::Math;
 using namespace ZetaRay::Core;
+#ifdef _WIN32
 using namespace ZetaRay::Core::GpuMemory;
+#endif
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Support;
 using namespace ZetaRay::Model;
 using namespace ZetaRay::App;
 using namespace ZetaRay::Model::glTF::Asset;
+#ifdef _WIN32
 using namespace ZetaRay::Core::Direct3DUtil;
+#endif
 
 #define CHECK_QUATERNION_VALID 0
 
@@ -72,7 +76,7 @@ namespace
     }
 #endif
 
-    ZetaInline Texture::ID_TYPE IDFromTexturePath(const Filesystem::Path& texPath)
+    ZetaInline TextureID IDFromTexturePath(const Filesystem::Path& texPath)
     {
         return XXH3_64_To_32(XXH3_64bits(texPath.Get(), texPath.Length()));
     }
@@ -87,6 +91,50 @@ namespace
         int MaterialIdx;
     };
 
+    // Morph targets of a mesh primitive. Delta of vertex v for target t is at
+    // [Offset + t * NumVertices + v].
+    struct MorphTargetPrim
+    {
+        uint64_t MeshID;
+        uint32_t Offset;
+        uint32_t NumVertices;
+        uint32_t NumTargets;
+        bool HasNormals;
+    };
+
+    struct MeshWorkerMorphTargets
+    {
+        SmallVector<MorphTargetPrim> Prims;
+        SmallVector<float3> PositionDeltas;
+        SmallVector<float3> NormalDeltas;
+    };
+
+    // Animation channels (index into animation's channels) targeting each node
+    struct NodeChannels
+    {
+        int Translation = -1;
+        int Rotation = -1;
+        int Scale = -1;
+        int Weights = -1;
+    };
+
+    // Keys of an animation channel. Cubic spline keys are reduced to their values and
+    // interpolated linearly.
+    struct ChannelKeys
+    {
+        SmallVector<float> Times;
+        SmallVector<float> Values;
+        int NumComponents;
+        bool Step;
+    };
+
+    struct PrivateMeshPrim
+    {
+        int NodeIdx;
+        // Into ThreadContext::Meshes
+        uint32_t MeshOffset;
+    };
+
     struct ThreadContext
     {
         const App::Filesystem::Path* glTFPath;
@@ -96,11 +144,23 @@ namespace
         SmallVector<Vertex> Vertices;
         SmallVector<uint32_t> Indices;
         SmallVector<Mesh> Meshes;
+#ifdef _WIN32
         // All unique textures that need to be loaded from disk
         SmallVector<Texture> DDSImages;
+#endif
         SmallVector<EmissiveMeshPrim> EmissiveMeshPrims;
         SmallVector<EmissiveInstance> EmissiveInstances;
         SmallVector<RT::EmissiveTriangle> RTEmissives;
+        // Same size as Vertices when model has skins, otherwise empty
+        SmallVector<VertexSkin> Skins;
+        // Channels of the (first) animation for each node
+        SmallVector<NodeChannels> AnimationChannels;
+        // Number of nodes that use each mesh
+        SmallVector<uint32_t> MeshNumNodes;
+        // Deformable instances that need a private copy of their mesh primitive (see
+        // AddPrivateMeshes())
+        SmallVector<PrivateMeshPrim> PrivateMeshPrims;
+        MeshWorkerMorphTargets* MorphTargetsPerWorker;
 
         int NumMeshWorkers;
         int NumImgWorkers;
@@ -267,11 +327,90 @@ namespace
         }
     }
 
+    void ProcessJointsAndWeights(const cgltf_accessor& joints, const cgltf_accessor& weights,
+        MutableSpan<VertexSkin> skins, uint32_t baseOffset)
+    {
+        Check(joints.type == cgltf_type_vec4, "Invalid type for JOINTS_0 attribute.");
+        Check(weights.type == cgltf_type_vec4, "Invalid type for WEIGHTS_0 attribute.");
+        Check(joints.count == weights.count, "Number of JOINTS_0 and WEIGHTS_0 elements must match.");
+
+        for (size_t i = 0; i < joints.count; i++)
+        {
+            // Handles all the allowed component types (including normalized integer weights)
+            cgltf_uint j[MAX_NUM_JOINTS_PER_VERTEX];
+            float w[MAX_NUM_JOINTS_PER_VERTEX];
+            cgltf_accessor_read_uint(&joints, i, j, MAX_NUM_JOINTS_PER_VERTEX);
+            cgltf_accessor_read_float(&weights, i, w, MAX_NUM_JOINTS_PER_VERTEX);
+
+            // Quantized weights may not exactly sum to one
+            const float sum = w[0] + w[1] + w[2] + w[3];
+            const float normalizeFactor = sum > 0 ? 1.0f / sum : 0.0f;
+            VertexSkin& s = skins[baseOffset + i];
+
+            for (int k = 0; k < MAX_NUM_JOINTS_PER_VERTEX; k++)
+            {
+                s.Joints[k] = (uint16_t)j[k];
+                s.Weights[k] = w[k] * normalizeFactor;
+            }
+        }
+    }
+
+    void ProcessMorphTargets(const cgltf_primitive& prim, uint64_t meshID, uint32_t numVertices,
+        MeshWorkerMorphTargets& morphTargets)
+    {
+        const uint32_t offset = (uint32_t)morphTargets.PositionDeltas.size();
+        const size_t numDeltas = prim.targets_count * numVertices;
+        bool hasNormals = false;
+
+        // Targets without a NORMAL (or POSITION) attribute have zero deltas
+        morphTargets.PositionDeltas.resize(offset + numDeltas, float3(0.0f));
+        morphTargets.NormalDeltas.resize(offset + numDeltas, float3(0.0f));
+
+        for (size_t t = 0; t < prim.targets_count; t++)
+        {
+            const cgltf_morph_target& target = prim.targets[t];
+
+            for (size_t attrib = 0; attrib < target.attributes_count; attrib++)
+            {
+                const cgltf_attribute& a = target.attributes[attrib];
+                const bool isPosition = strcmp(a.name, "POSITION") == 0;
+
+                // TANGENT deltas are ignored
+                if (!isPosition && strcmp(a.name, "NORMAL") != 0)
+                    continue;
+
+                Check(a.data->type == cgltf_type_vec3, "Invalid type for morph target %s attribute.", a.name);
+                Check(a.data->count == numVertices, "Invalid number of elements for morph target %s attribute.",
+                    a.name);
+
+                float3* deltas = (isPosition ? morphTargets.PositionDeltas.data() :
+                    morphTargets.NormalDeltas.data()) + offset + t * numVertices;
+
+                // Also handles sparse accessors
+                cgltf_accessor_unpack_floats(a.data, reinterpret_cast<float*>(deltas), numVertices * 3);
+
+                // glTF uses a right-handed coordinate system with +Y as up
+                for (uint32_t v = 0; v < numVertices; v++)
+                    deltas[v].z *= -1.0f;
+
+                hasNormals = hasNormals || !isPosition;
+            }
+        }
+
+        morphTargets.Prims.push_back(MorphTargetPrim{
+            .MeshID = meshID,
+            .Offset = offset,
+            .NumVertices = numVertices,
+            .NumTargets = (uint32_t)prim.targets_count,
+            .HasNormals = hasNormals });
+    }
+
     void ProcessMeshes(const cgltf_data& model, uint32_t sceneID, size_t offset, size_t size,
-        MutableSpan<Vertex> vertices, std::atomic_uint32_t& vertexCounter,
+        MutableSpan<Vertex> vertices, MutableSpan<VertexSkin> skins, std::atomic_uint32_t& vertexCounter,
         MutableSpan<uint32_t> indices, std::atomic_uint32_t& idxCounter,
         MutableSpan<Mesh> meshes, std::atomic_uint32_t& meshCounter,
-        MutableSpan<EmissiveMeshPrim> emissivesPrims, uint32_t& emissivePrimCount)
+        MutableSpan<EmissiveMeshPrim> emissivesPrims, uint32_t& emissivePrimCount,
+        MeshWorkerMorphTargets& morphTargets)
     {
         SceneCore& scene = App::GetScene();
         uint32_t totalPrims = 0;
@@ -339,6 +478,8 @@ namespace
                 int normalIt = -1;
                 int texIt = -1;
                 int tangentIt = -1;
+                int jointsIt = -1;
+                int weightsIt = -1;
 
                 for (int attrib = 0; attrib < prim.attributes_count; attrib++)
                 {
@@ -350,6 +491,10 @@ namespace
                         texIt = attrib;
                     else if (strcmp(prim.attributes[attrib].name, "TANGENT") == 0)
                         tangentIt = attrib;
+                    else if (strcmp(prim.attributes[attrib].name, "JOINTS_0") == 0)
+                        jointsIt = attrib;
+                    else if (strcmp(prim.attributes[attrib].name, "WEIGHTS_0") == 0)
+                        weightsIt = attrib;
                 }
 
                 Check(normalIt != -1, "NORMAL was not found in the vertex attributes.");
@@ -387,6 +532,19 @@ namespace
                     }
                 }
 
+                // JOINTS_0 & WEIGHTS_0
+                if (jointsIt != -1 && weightsIt != -1 && !skins.empty())
+                {
+                    ProcessJointsAndWeights(*prim.attributes[jointsIt].data, *prim.attributes[weightsIt].data,
+                        skins, currVtxOffset);
+                }
+
+                if (prim.targets_count)
+                {
+                    ProcessMorphTargets(prim, Scene::MeshID(sceneID, (int)meshIdx, primIdx), numVertices,
+                        morphTargets);
+                }
+
                 meshes[currMeshPrimOffset++] = Mesh
                     {
                         .SceneID = sceneID,
@@ -430,6 +588,7 @@ namespace
         emissivePrimCount = numEmissiveMeshPrims;
     }
 
+#ifdef _WIN32
     void LoadDDSImages(uint32_t sceneID, const Filesystem::Path& modelDir, const cgltf_data& model,
         size_t offset, size_t num, MutableSpan<Texture> ddsImages)
     {
@@ -444,11 +603,16 @@ namespace
         DDS_Data* ddsTextures = reinterpret_cast<DDS_Data*>(memArena.AllocateAligned(
             num * sizeof(DDS_Data)));
         bool hasInvalid = false;
+        // Mip tails of streamed textures
+        SmallVector<SmallVector<uint8_t>> tails;
+        tails.resize(num);
 
         // Two passes:
-        // 1. Load DDS data from disk
-        // 2. Allocate a heap large enough for all the textures, then create a placed 
-        //    texture for each
+        // 1. Load DDS data from disk. For block-compressed textures, only the mip tail is 
+        //    loaded and the rest is streamed in later by the scene (see 
+        //    SceneCore::AddStreamedTexture()).
+        // 2. Allocate a heap large enough for all the textures (including the mips that 
+        //    are streamed in later), then create a placed texture for each
 
         for (size_t m = offset; m != offset + num; m++)
         {
@@ -474,6 +638,32 @@ namespace
             }
 
             ddsTextures[idx].ID = IDFromTexturePath(path);
+
+            Streaming::DDSTextureDesc desc;
+            uint32_t firstTailMip;
+            if (App::GetScene().AddStreamedTexture(path.Get(), ddsTextures[idx].ID, desc, 
+                tails[idx], firstTailMip))
+            {
+                DDS_Data& dds = ddsTextures[idx];
+                dds.width = desc.Width;
+                dds.height = desc.Height;
+                dds.depth = 1;
+                dds.mipCount = desc.MipCount;
+                dds.format = (DXGI_FORMAT)desc.Format;
+                // Fewer subresources than mips means the first one is the first tail mip
+                dds.numSubresources = desc.MipCount - firstTailMip;
+
+                for (uint32_t mip = firstTailMip; mip < desc.MipCount; mip++)
+                {
+                    D3D12_SUBRESOURCE_DATA& s = dds.subresources[mip - firstTailMip];
+                    s.pData = tails[idx].data() + desc.MipOffset(mip) - desc.MipOffset(firstTailMip);
+                    s.RowPitch = ((desc.MipWidth(mip) + 3) / 4) * desc.BlockSize;
+                    s.SlicePitch = desc.MipSize(mip);
+                }
+
+                continue;
+            }
+
             auto err = GpuMemory::GetDDSDataFromDisk(path.Get(), ddsTextures[idx], heapArena,
                 ArenaAllocator(memArena));
 
@@ -511,7 +701,8 @@ namespace
         {
             Texture tex = GpuMemory::GetPlacedTexture2DAndInit(ddsTextures[i].ID, 
                 texDescs[i], heap.Heap(), allocInfos[i].Offset, heapArena, 
-                Span(ddsTextures[i].subresources, ddsTextures[i].numSubresources));
+                Span(ddsTextures[i].subresources, ddsTextures[i].numSubresources), nullptr,
+                ddsTextures[i].mipCount - ddsTextures[i].numSubresources);
 
             // Order of textures is not important
             ddsImages[offset + i] = ZetaMove(tex);
@@ -519,9 +710,15 @@ namespace
 
         App::GetScene().AddTextureHeap(ZetaMove(heap));
     }
+#endif
 
+    // Without a renderer, textures aren't loaded and materials only keep their constants
     void ProcessMaterials(uint32_t sceneID, const Filesystem::Path& modelDir, const cgltf_data& model,
+#ifdef _WIN32
         int offset, int size, MutableSpan<Texture> ddsImages)
+#else
+        int offset, int size)
+#endif
     {
         auto getAlphaMode = [](cgltf_alpha_mode m)
             {
@@ -638,7 +835,11 @@ namespace
             }
 
             SceneCore& scene = App::GetScene();
+#ifdef _WIN32
             scene.AddMaterial(desc, ddsImages, false);
+#else
+            scene.AddMaterial(desc, false);
+#endif
         }
     }
 
@@ -781,8 +982,32 @@ namespace
         Assert(rtEmissiveTriIdx == context.NumEmissiveTris, "these must match.");
     }
 
+    bool HasSkin(const cgltf_node& node, const cgltf_primitive& prim)
+    {
+        if (!node.skin)
+            return false;
+
+        for (int attrib = 0; attrib < prim.attributes_count; attrib++)
+        {
+            if (strcmp(prim.attributes[attrib].name, "JOINTS_0") == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    // Deformed vertices are written back to the mesh, so each deformable instance of a mesh
+    // primitive that other nodes use too gets its own copy (see AddPrivateMeshes())
+    bool NeedsPrivateMesh(const cgltf_node& node, int meshIdx, int primIdx,
+        Span<uint32_t> meshNumNodes)
+    {
+        const cgltf_primitive& prim = node.mesh->primitives[primIdx];
+        return meshNumNodes[meshIdx] > 1 && (HasSkin(node, prim) || prim.targets_count);
+    }
+
     void ProcessNodeSubtree(const cgltf_node& node, uint32_t sceneID, const cgltf_data& model,
-        uint64_t parentId)
+        Span<NodeChannels> animationChannels, Span<uint32_t> meshNumNodes, uint64_t parentId, 
+        bool isParentDynamic)
     {
         uint64_t currInstanceID = SceneCore::ROOT_ID;
 
@@ -880,6 +1105,15 @@ namespace
         const int nodeIdx = (int)(&node - model.nodes);
         Assert(nodeIdx < model.nodes_count, "Invalid node index.");
 
+        // Animated nodes, deformable meshes, and their descendants are dynamic
+        const NodeChannels& channels = animationChannels[nodeIdx];
+        const bool isAnimated = channels.Translation != -1 || channels.Rotation != -1 ||
+            channels.Scale != -1 || channels.Weights != -1;
+        const bool hasMorphTargets = node.mesh && node.mesh->primitives_count &&
+            node.mesh->primitives[0].targets_count;
+        const bool isDynamic = isParentDynamic || isAnimated || node.skin || hasMorphTargets;
+        const RT_MESH_MODE rtMeshMode = isDynamic ? RT_MESH_MODE::DYNAMIC_NO_REBUILD : RT_MESH_MODE::STATIC;
+
         if (node.mesh)
         {
             const int meshIdx = (int)(node.mesh - model.meshes);
@@ -917,9 +1151,10 @@ namespace
                     .ParentID = parentId,
                     .MeshIdx = meshIdx,
                     .MeshPrimIdx = primIdx,
-                    .RtMeshMode = RT_MESH_MODE::STATIC,
+                    .RtMeshMode = rtMeshMode,
                     .RtInstanceMask = rtInsMask,
-                    .IsOpaque = isOpaque };
+                    .IsOpaque = isOpaque,
+                    .MeshNodeIdx = NeedsPrivateMesh(node, meshIdx, primIdx, meshNumNodes) ? nodeIdx : -1 };
 
                 SceneCore& scene = App::GetScene();
                 scene.AddInstance(desc, false);
@@ -936,7 +1171,7 @@ namespace
                     .ParentID = parentId,
                     .MeshIdx = -1,
                     .MeshPrimIdx = -1,
-                    .RtMeshMode = RT_MESH_MODE::STATIC,
+                    .RtMeshMode = rtMeshMode,
                     .RtInstanceMask = RT_AS_SUBGROUP::NON_EMISSIVE,
                     .IsOpaque = true };
 
@@ -947,16 +1182,419 @@ namespace
         for (int c = 0; c < node.children_count; c++)
         {
             const cgltf_node& childNode = *node.children[c];
-            ProcessNodeSubtree(childNode, sceneID, model, currInstanceID);
+            ProcessNodeSubtree(childNode, sceneID, model, animationChannels, meshNumNodes, currInstanceID, 
+                isDynamic);
         }
     }
 
-    void ProcessNodes(const cgltf_data& model, uint32_t sceneID)
+    void ProcessNodes(const cgltf_data& model, uint32_t sceneID, Span<NodeChannels> animationChannels,
+        Span<uint32_t> meshNumNodes)
     {
         for (size_t i = 0; i < model.scene->nodes_count; i++)
         {
             const cgltf_node& node = *model.scene->nodes[i];
-            ProcessNodeSubtree(node, sceneID, model, SceneCore::ROOT_ID);
+            ProcessNodeSubtree(node, sceneID, model, animationChannels, meshNumNodes, SceneCore::ROOT_ID, 
+                false);
+        }
+    }
+
+    // Parent-child relationships are w.r.t. the last mesh primitive (see ProcessNodeSubtree())
+    uint64_t NodeInstanceID(const cgltf_data& model, uint32_t sceneID, const cgltf_node& node)
+    {
+        const int nodeIdx = (int)(&node - model.nodes);
+
+        if (node.mesh)
+        {
+            return Scene::InstanceID(sceneID, nodeIdx, (int)(node.mesh - model.meshes),
+                (int)node.mesh->primitives_count - 1);
+        }
+
+        return Scene::InstanceID(sceneID, nodeIdx, -1, -1);
+    }
+
+    // Converts a transformation matrix (row-vector convention) from the RHS coordinate system
+    // (+Y up) to LHS (+Y up). See ProcessNodeSubtree() for the derivation.
+    void ToLHS(float4x4a& M)
+    {
+        M.m[0].z *= -1.0f;
+        M.m[1].z *= -1.0f;
+        M.m[2].x *= -1.0f;
+        M.m[2].y *= -1.0f;
+        M.m[3].z *= -1.0f;
+    }
+
+    void FindAnimationChannels(const cgltf_data& model, MutableSpan<NodeChannels> nodeChannels)
+    {
+        if (model.animations_count == 0)
+            return;
+
+        if (model.animations_count > 1)
+        {
+            LOG_UI_WARNING("glTF model has %llu animations, only the first one is imported.\n",
+                (uint64_t)model.animations_count);
+        }
+
+        const cgltf_animation& anim = model.animations[0];
+
+        for (size_t c = 0; c < anim.channels_count; c++)
+        {
+            const cgltf_animation_channel& channel = anim.channels[c];
+            if (!channel.target_node)
+                continue;
+
+            NodeChannels& n = nodeChannels[channel.target_node - model.nodes];
+
+            switch (channel.target_path)
+            {
+            case cgltf_animation_path_type_translation:
+                n.Translation = (int)c;
+                break;
+            case cgltf_animation_path_type_rotation:
+                n.Rotation = (int)c;
+                break;
+            case cgltf_animation_path_type_scale:
+                n.Scale = (int)c;
+                break;
+            case cgltf_animation_path_type_weights:
+                n.Weights = (int)c;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void ReadChannelKeys(const cgltf_animation_sampler& sampler, int numComponents, ChannelKeys& keys)
+    {
+        const cgltf_accessor& input = *sampler.input;
+        const cgltf_accessor& output = *sampler.output;
+        const bool isCubic = sampler.interpolation == cgltf_interpolation_type_cubic_spline;
+        const size_t numKeys = input.count;
+        const size_t numFloats = output.count * cgltf_num_components(output.type);
+
+        Check(numKeys > 0 && numFloats == numKeys * numComponents * (isCubic ? 3 : 1),
+            "Invalid animation sampler.");
+
+        keys.Times.resize(numKeys);
+        cgltf_accessor_unpack_floats(&input, keys.Times.data(), numKeys);
+
+        // Also handles normalized integer outputs
+        keys.Values.resize(numFloats);
+        cgltf_accessor_unpack_floats(&output, keys.Values.data(), numFloats);
+
+        // Cubic spline keys are stored as (in-tangent, value, out-tangent), keep the values
+        if (isCubic)
+        {
+            for (size_t k = 0; k < numKeys; k++)
+            {
+                memcpy(keys.Values.data() + k * numComponents,
+                    keys.Values.data() + (3 * k + 1) * numComponents,
+                    sizeof(float) * numComponents);
+            }
+
+            keys.Values.resize(numKeys * numComponents);
+        }
+
+        keys.NumComponents = numComponents;
+        keys.Step = sampler.interpolation == cgltf_interpolation_type_step;
+    }
+
+    // Outside the key range, first or last key is returned
+    void SampleChannel(const ChannelKeys& keys, float t, bool isRotation, float* out)
+    {
+        const size_t numKeys = keys.Times.size();
+        const int numComponents = keys.NumComponents;
+        size_t k = 0;
+        float u = 0.0f;
+
+        if (t >= keys.Times[numKeys - 1])
+            k = numKeys - 1;
+        else if (t > keys.Times[0])
+        {
+            const int64_t idx = FindInterval(Span(keys.Times), t, [](const float& x) { return x; });
+            Assert(idx != -1, "Interval was not found.");
+
+            k = (size_t)idx;
+            u = keys.Step ? 0.0f : (t - keys.Times[k]) / (keys.Times[k + 1] - keys.Times[k]);
+        }
+
+        const float* v0 = keys.Values.data() + k * numComponents;
+
+        if (u == 0.0f)
+        {
+            memcpy(out, v0, sizeof(float) * numComponents);
+            return;
+        }
+
+        const float* v1 = v0 + numComponents;
+
+        if (isRotation)
+        {
+            float4 q0(v0[0], v0[1], v0[2], v0[3]);
+            float4 q1(v1[0], v1[1], v1[2], v1[3]);
+            _mm_storeu_ps(out, slerp(loadFloat4(q0), loadFloat4(q1), u));
+
+            return;
+        }
+
+        for (int i = 0; i < numComponents; i++)
+            out[i] = v0[i] + u * (v1[i] - v0[i]);
+    }
+
+    // Converts the TRS channels of given node to keyframes. Channels may have different key
+    // times, so all of them are resampled at the union of their key times.
+    void ProcessNodeAnimation(const ThreadContext& tc, const cgltf_node& node, int nodeIdx)
+    {
+        const NodeChannels& nodeChannels = tc.AnimationChannels[nodeIdx];
+        const int channels[3] = { nodeChannels.Translation, nodeChannels.Rotation, nodeChannels.Scale };
+
+        if (channels[0] == -1 && channels[1] == -1 && channels[2] == -1)
+            return;
+
+        const cgltf_animation& anim = tc.Model->animations[0];
+        ChannelKeys trs[3];
+        SmallVector<float> times;
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (channels[i] == -1)
+                continue;
+
+            ReadChannelKeys(*anim.channels[channels[i]].sampler, i == 1 ? 4 : 3, trs[i]);
+            times.append_range(trs[i].Times.begin(), trs[i].Times.end());
+        }
+
+        std::sort(times.begin(), times.end());
+        const size_t numKeys = std::unique(times.begin(), times.end()) - times.begin();
+
+        if (numKeys < 2)
+            return;
+
+        // Components that aren't animated keep the node's values
+        float T[3] = { 0.0f, 0.0f, 0.0f };
+        float R[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float S[3] = { 1.0f, 1.0f, 1.0f };
+
+        if (node.has_translation)
+            memcpy(T, node.translation, sizeof(T));
+        if (node.has_rotation)
+            memcpy(R, node.rotation, sizeof(R));
+        if (node.has_scale)
+            memcpy(S, node.scale, sizeof(S));
+
+        SmallVector<Keyframe> keyframes;
+        keyframes.resize(numKeys);
+
+        for (size_t k = 0; k < numKeys; k++)
+        {
+            const float t = times[k];
+
+            if (channels[0] != -1)
+                SampleChannel(trs[0], t, false, T);
+            if (channels[1] != -1)
+                SampleChannel(trs[1], t, true, R);
+            if (channels[2] != -1)
+                SampleChannel(trs[2], t, false, S);
+
+            // Convert to LHS (see ProcessNodeSubtree())
+            keyframes[k].Time = t;
+            keyframes[k].Transform.Translation = float3(T[0], T[1], -T[2]);
+            keyframes[k].Transform.Rotation = float4(-R[0], -R[1], R[2], R[3]);
+            keyframes[k].Transform.Scale = float3(S[0], S[1], S[2]);
+        }
+
+        SceneCore& scene = App::GetScene();
+
+        // A separate instance for each mesh primitive
+        if (node.mesh)
+        {
+            const int meshIdx = (int)(node.mesh - tc.Model->meshes);
+
+            for (int primIdx = 0; primIdx < node.mesh->primitives_count; primIdx++)
+            {
+                scene.AddAnimation(Scene::InstanceID(tc.SceneID, nodeIdx, meshIdx, primIdx),
+                    keyframes, 0.0f, true, true);
+            }
+        }
+        else
+            scene.AddAnimation(Scene::InstanceID(tc.SceneID, nodeIdx, -1, -1), keyframes, 0.0f, true, true);
+    }
+
+    void ProcessDeformableMesh(ThreadContext& tc, const cgltf_node& node, int nodeIdx)
+    {
+        const cgltf_data& model = *tc.Model;
+        const cgltf_mesh& mesh = *node.mesh;
+        const int meshIdx = (int)(node.mesh - model.meshes);
+        SceneCore& scene = App::GetScene();
+
+        for (int primIdx = 0; primIdx < mesh.primitives_count; primIdx++)
+        {
+            const cgltf_primitive& prim = mesh.primitives[primIdx];
+            const bool hasSkin = !tc.Skins.empty() && HasSkin(node, prim);
+
+            if (!hasSkin && !prim.targets_count)
+                continue;
+
+            const Mesh* meshPrim = nullptr;
+
+            for (auto& m : tc.Meshes)
+            {
+                if (m.MeshIdx == meshIdx && m.MeshPrimIdx == primIdx)
+                {
+                    meshPrim = &m;
+                    break;
+                }
+            }
+
+            Assert(meshPrim, "Mesh primitive was not found.");
+
+            // Bind pose is the same for the copy
+            if (NeedsPrivateMesh(node, meshIdx, primIdx, tc.MeshNumNodes))
+            {
+                tc.PrivateMeshPrims.push_back(PrivateMeshPrim{ .NodeIdx = nodeIdx,
+                    .MeshOffset = (uint32_t)(meshPrim - tc.Meshes.data()) });
+            }
+
+            SkinnedMeshDesc desc;
+            desc.InstanceID = Scene::InstanceID(tc.SceneID, nodeIdx, meshIdx, primIdx);
+            desc.Vertices = Span(tc.Vertices.data() + meshPrim->BaseVtxOffset, meshPrim->NumVertices);
+
+            SmallVector<uint64_t> jointIDs;
+            SmallVector<float4x4a> inverseBinds;
+
+            if (hasSkin)
+            {
+                const cgltf_skin& skin = *node.skin;
+                jointIDs.resize(skin.joints_count);
+                inverseBinds.resize(skin.joints_count, store(identity()));
+
+                for (size_t j = 0; j < skin.joints_count; j++)
+                    jointIDs[j] = NodeInstanceID(model, tc.SceneID, *skin.joints[j]);
+
+                if (skin.inverse_bind_matrices)
+                {
+                    Check(skin.inverse_bind_matrices->count == skin.joints_count,
+                        "Number of joints and inverse bind matrices must match.");
+
+                    for (size_t j = 0; j < skin.joints_count; j++)
+                    {
+                        float M[16];
+                        cgltf_accessor_read_float(skin.inverse_bind_matrices, j, M, 16);
+
+                        // Column-major storage of a column-vector transformation is the
+                        // row-major storage of its transpose (row-vector convention)
+                        inverseBinds[j] = float4x4a(M);
+                        ToLHS(inverseBinds[j]);
+                    }
+                }
+
+                desc.Skin = Span(tc.Skins.data() + meshPrim->BaseVtxOffset, meshPrim->NumVertices);
+                desc.JointIDs = Span(jointIDs);
+                desc.InverseBindMatrices = Span(inverseBinds);
+            }
+
+            SmallVector<float> weights;
+            ChannelKeys weightKeys;
+
+            if (prim.targets_count)
+            {
+                const uint64_t meshID = Scene::MeshID(tc.SceneID, meshIdx, primIdx);
+                const MeshWorkerMorphTargets* worker = nullptr;
+                const MorphTargetPrim* targets = nullptr;
+
+                for (int w = 0; w < tc.NumMeshWorkers && !targets; w++)
+                {
+                    for (auto& p : tc.MorphTargetsPerWorker[w].Prims)
+                    {
+                        if (p.MeshID == meshID)
+                        {
+                            worker = &tc.MorphTargetsPerWorker[w];
+                            targets = &p;
+                            break;
+                        }
+                    }
+                }
+
+                Assert(targets, "Morph targets were not found.");
+                const size_t numDeltas = targets->NumTargets * targets->NumVertices;
+
+                desc.MorphPositionDeltas = Span(worker->PositionDeltas.data() + targets->Offset, numDeltas);
+                if (targets->HasNormals)
+                    desc.MorphNormalDeltas = Span(worker->NormalDeltas.data() + targets->Offset, numDeltas);
+
+                // Default weights are given by the node, falling back to the mesh
+                weights.resize(targets->NumTargets, 0.0f);
+                const float* defaultWeights = node.weights_count ? node.weights : mesh.weights;
+                const size_t numDefaultWeights = node.weights_count ? node.weights_count : mesh.weights_count;
+                memcpy(weights.data(), defaultWeights, sizeof(float) * Min(numDefaultWeights, weights.size()));
+
+                desc.MorphWeights = Span(weights);
+
+                const int weightsChannel = tc.AnimationChannels[nodeIdx].Weights;
+                if (weightsChannel != -1)
+                {
+                    ReadChannelKeys(*model.animations[0].channels[weightsChannel].sampler,
+                        (int)targets->NumTargets, weightKeys);
+
+                    desc.MorphWeightKeyTimes = Span(weightKeys.Times);
+                    desc.MorphWeightKeys = Span(weightKeys.Values);
+                }
+            }
+
+            scene.AddSkinnedMesh(desc, false);
+        }
+    }
+
+    void ProcessAnimationsSubtree(ThreadContext& tc, const cgltf_node& node)
+    {
+        const int nodeIdx = (int)(&node - tc.Model->nodes);
+
+        if (tc.Model->animations_count)
+            ProcessNodeAnimation(tc, node, nodeIdx);
+
+        if (node.mesh)
+            ProcessDeformableMesh(tc, node, nodeIdx);
+
+        for (int c = 0; c < node.children_count; c++)
+            ProcessAnimationsSubtree(tc, *node.children[c]);
+    }
+
+    // Adds keyframe animations (first animation only) along with skinned and morphed
+    // meshes to the scene. Must run after instances and vertices are processed.
+    void ProcessAnimations(ThreadContext& tc)
+    {
+        for (size_t i = 0; i < tc.Model->scene->nodes_count; i++)
+        {
+            const cgltf_node& node = *tc.Model->scene->nodes[i];
+            ProcessAnimationsSubtree(tc, node);
+        }
+    }
+
+    // Appends a copy of the vertices of each mesh primitive in PrivateMeshPrims and a mesh
+    // that refers to them. Indices are relative to the mesh's base vertex, so they're shared.
+    void AddPrivateMeshes(ThreadContext& tc)
+    {
+        if (tc.PrivateMeshPrims.empty())
+            return;
+
+        size_t numVertices = tc.Vertices.size();
+        for (auto& p : tc.PrivateMeshPrims)
+            numVertices += tc.Meshes[p.MeshOffset].NumVertices;
+
+        // Also makes appending from the same buffer safe
+        tc.Vertices.reserve(numVertices);
+        tc.Meshes.reserve(tc.Meshes.size() + tc.PrivateMeshPrims.size());
+
+        for (auto& p : tc.PrivateMeshPrims)
+        {
+            Mesh copy = tc.Meshes[p.MeshOffset];
+            const Vertex* src = tc.Vertices.data() + copy.BaseVtxOffset;
+
+            copy.BaseVtxOffset = (uint32_t)tc.Vertices.size();
+            copy.NodeIdx = p.NodeIdx;
+
+            tc.Vertices.append_range(src, src + copy.NumVertices);
+            tc.Meshes.push_back(copy);
         }
     }
 
@@ -1105,6 +1743,7 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
     size_t meshWorkerOffset[MAX_NUM_MESH_WORKERS];
     size_t meshWorkerCount[MAX_NUM_MESH_WORKERS];
     uint32_t workerEmissiveCount[MAX_NUM_MESH_WORKERS];
+    MeshWorkerMorphTargets workerMorphTargets[MAX_NUM_MESH_WORKERS];
 
     const int numMeshWorkers = (int)SubdivideRangeWithMin(model->meshes_count,
         MAX_NUM_MESH_WORKERS,
@@ -1135,15 +1774,31 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
     tc.ImgThreadOffsets = imgWorkerOffset;
     tc.ImgThreadSizes = imgWorkerCount;
     tc.EmissiveMeshPrimCountPerWorker = workerEmissiveCount;
+    tc.MorphTargetsPerWorker = workerMorphTargets;
 
     // Preallocate
     tc.Vertices.resize(totalNumVertices);
     tc.Indices.resize(totalNumIndices);
     tc.Meshes.resize(totalNumMeshPrims);
+#ifdef _WIN32
     tc.DDSImages.resize(model->images_count);
+#endif
     tc.EmissiveMeshPrims.resize(totalNumMeshPrims);
     ResetEmissiveSubsets(tc.EmissiveMeshPrims);
 
+    if (model->skins_count)
+        tc.Skins.resize(totalNumVertices);
+
+    tc.AnimationChannels.resize(model->nodes_count);
+    FindAnimationChannels(*model, tc.AnimationChannels);
+
+    tc.MeshNumNodes.resize(model->meshes_count, 0u);
+    for (size_t i = 0; i < model->nodes_count; i++)
+    {
+        if (model->nodes[i].mesh)
+            tc.MeshNumNodes[model->nodes[i].mesh - model->meshes]++;
+    }
+
     TaskSet ts;
 
     auto procEmissiveMeshPrims = ts.EmplaceTask("gltf::EmissivePrims", [&tc]()
@@ -1178,11 +1833,12 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
             {
                 ProcessMeshes(*tc.Model, tc.SceneID, tc.MeshThreadOffsets[workerIdx],
                     tc.MeshThreadSizes[workerIdx],
-                    tc.Vertices, tc.CurrVtxOffset,
+                    tc.Vertices, tc.Skins, tc.CurrVtxOffset,
                     tc.Indices, tc.CurrIdxOffset,
                     tc.Meshes, tc.CurrMeshPrimOffset,
                     tc.EmissiveMeshPrims, 
-                    tc.EmissiveMeshPrimCountPerWorker[workerIdx]);
+                    tc.EmissiveMeshPrimCountPerWorker[workerIdx],
+                    tc.MorphTargetsPerWorker[workerIdx]);
             });
 
         ts.AddOutgoingEdge(procMesh, procEmissiveMeshPrims);
@@ -1190,6 +1846,10 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
 
     auto procMats = ts.EmplaceTask("gltf::Materials", [&tc]()
         {
+            Filesystem::Path parent(tc.glTFPath->GetView());
+            parent.ToParent();
+
+#ifdef _WIN32
             // For binary search
             std::sort(tc.DDSImages.begin(), tc.DDSImages.end(),
                 [](const Texture& lhs, const Texture& rhs)
@@ -1197,13 +1857,14 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
                     return lhs.ID() < rhs.ID();
                 });
 
-            Filesystem::Path parent(tc.glTFPath->GetView());
-            parent.ToParent();
-
             ProcessMaterials(tc.SceneID, parent, *tc.Model, 0, (int)tc.Model->materials_count, 
                 tc.DDSImages);
+#else
+            ProcessMaterials(tc.SceneID, parent, *tc.Model, 0, (int)tc.Model->materials_count);
+#endif
         });
 
+#ifdef _WIN32
     for (int i = 0; i < numImgWorkers; i++)
     {
         StackStr(tname, n, "gltf::Img_%d", i);
@@ -1221,6 +1882,7 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
         // Material processing should start after textures are loaded
         ts.AddOutgoingEdge(h, procMats);
     }
+#endif
 
     // For each node with an emissive mesh primitive, add all of its triangles to 
     // the emissives buffer
@@ -1241,13 +1903,25 @@ void glTF::Load(const App::Filesystem::Path& pathToglTF)
     ts.AddOutgoingEdge(procEmissiveMeshPrims, procEmissives);
     ts.AddOutgoingEdge(procMats, procEmissives);
 
-    ts.EmplaceTask("gltf::Nodes", [&tc]()
+    auto procNodes = ts.EmplaceTask("gltf::Nodes", [&tc]()
+        {
+            ProcessNodes(*tc.Model, tc.SceneID, tc.AnimationChannels, tc.MeshNumNodes);
+        });
+
+    auto procAnimations = ts.EmplaceTask("gltf::Animations", [&tc]()
         {
-            ProcessNodes(*tc.Model, tc.SceneID);
+            ProcessAnimations(tc);
         });
 
+    // Animations need the instances along with the vertices, skins, and morph targets (mesh 
+    // workers all precede procEmissiveMeshPrims)
+    ts.AddOutgoingEdge(procNodes, procAnimations);
+    ts.AddOutgoingEdge(procEmissiveMeshPrims, procAnimations);
+
     auto last = ts.EmplaceTask("gltf::Final", [&tc]()
         {
+            AddPrivateMeshes(tc);
+
             // Transfer ownership of mesh buffers
             SceneCore& scene = App::GetScene();
             scene.AddMeshes(ZetaMove(tc.Meshes), ZetaMove(tc.Vertices), ZetaMove(tc.Indices), false);
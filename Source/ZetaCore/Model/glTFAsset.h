@@ -1,7 +1,6 @@
 #pragma once
 
 #include "../Core/Vertex.h"
-#include "../Core/GpuMemory.h"
 #include "../Math/Matrix.h"
 #include "../App/Filesystem.h"
 #include "../Core/Material.h"
@@ -10,6 +9,10 @@
 
 namespace ZetaRay::Model::glTF::Asset
 {
+    // Same as Core::GpuMemory::Texture::ID_TYPE, which isn't available in the headless build
+    using TextureID = uint32_t;
+    static constexpr TextureID INVALID_TEXTURE_ID = UINT32_MAX;
+
     struct Mesh
     {
         uint32_t SceneID;
@@ -20,6 +23,10 @@ namespace ZetaRay::Model::glTF::Asset
         uint32_t BaseIdxOffset;
         uint32_t NumVertices;
         uint32_t NumIndices;
+        // Deformed vertices are written back to the mesh, so deformable instances of a mesh
+        // primitive that's used by other nodes too get a private copy of it, which belongs
+        // to node NodeIdx. -1 for the shared one.
+        int NodeIdx = -1;
     };
 
     struct EmissiveInstance
@@ -41,14 +48,17 @@ namespace ZetaRay::Model::glTF::Asset
         RT_MESH_MODE RtMeshMode;
         uint8_t RtInstanceMask;
         bool IsOpaque;
+        // Node that owns the instance's private copy of its mesh (see Mesh::NodeIdx), -1
+        // when the mesh is shared
+        int MeshNodeIdx = -1;
     };
 
     struct MaterialDesc
     {
-        Core::GpuMemory::Texture::ID_TYPE BaseColorTexID = Core::GpuMemory::Texture::INVALID_ID;
-        Core::GpuMemory::Texture::ID_TYPE MetallicRoughnessTexID = Core::GpuMemory::Texture::INVALID_ID;
-        Core::GpuMemory::Texture::ID_TYPE NormalTexID = Core::GpuMemory::Texture::INVALID_ID;
-        Core::GpuMemory::Texture::ID_TYPE EmissiveTexID = Core::GpuMemory::Texture::INVALID_ID;
+        TextureID BaseColorTexID = INVALID_TEXTURE_ID;
+        TextureID MetallicRoughnessTexID = INVALID_TEXTURE_ID;
+        TextureID NormalTexID = INVALID_TEXTURE_ID;
+        TextureID EmissiveTexID = INVALID_TEXTURE_ID;
 
         // Base
         Math::float4 BaseColorFactor = Math::float4(1.0f);
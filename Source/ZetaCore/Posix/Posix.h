@@ -0,0 +1,113 @@
+#pragma once
+
+// The subset of the Win32 API and MSVC intrinsics that the platform-independent parts
+// of ZetaCore use, implemented on top of pthreads and GCC/Clang builtins
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+//--------------------------------------------------------------------------------------
+// Synchronization
+//--------------------------------------------------------------------------------------
+
+using SRWLOCK = pthread_rwlock_t;
+#define SRWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+
+inline void AcquireSRWLockExclusive(SRWLOCK* lock) { pthread_rwlock_wrlock(lock); }
+inline void ReleaseSRWLockExclusive(SRWLOCK* lock) { pthread_rwlock_unlock(lock); }
+inline void AcquireSRWLockShared(SRWLOCK* lock) { pthread_rwlock_rdlock(lock); }
+inline void ReleaseSRWLockShared(SRWLOCK* lock) { pthread_rwlock_unlock(lock); }
+
+// Kernel thread ID, unique among all the threads in the system
+inline uint32_t GetCurrentThreadId()
+{
+    thread_local const uint32_t tid = (uint32_t)syscall(SYS_gettid);
+    return tid;
+}
+
+//--------------------------------------------------------------------------------------
+// Memory
+//--------------------------------------------------------------------------------------
+
+inline void* _aligned_malloc(size_t size, size_t alignment)
+{
+    void* mem = nullptr;
+    alignment = alignment < sizeof(void*) ? sizeof(void*) : alignment;
+
+    return posix_memalign(&mem, alignment, size) == 0 ? mem : nullptr;
+}
+
+inline void _aligned_free(void* mem)
+{
+    free(mem);
+}
+
+//--------------------------------------------------------------------------------------
+// Intrinsics
+//--------------------------------------------------------------------------------------
+
+inline uint16_t __popcnt16(uint16_t v) { return (uint16_t)__builtin_popcount(v); }
+inline uint32_t __popcnt(uint32_t v) { return (uint32_t)__builtin_popcount(v); }
+inline uint64_t __popcnt64(uint64_t v) { return (uint64_t)__builtin_popcountll(v); }
+
+inline unsigned char _BitScanForward(unsigned long* index, unsigned long mask)
+{
+    if (!mask)
+        return 0;
+
+    *index = (unsigned long)__builtin_ctzl(mask);
+    return 1;
+}
+
+inline unsigned char _BitScanForward64(unsigned long* index, uint64_t mask)
+{
+    if (!mask)
+        return 0;
+
+    *index = (unsigned long)__builtin_ctzll(mask);
+    return 1;
+}
+
+inline unsigned char _BitScanReverse(unsigned long* index, unsigned long mask)
+{
+    if (!mask)
+        return 0;
+
+    *index = (unsigned long)(sizeof(unsigned long) * 8 - 1 - __builtin_clzl(mask));
+    return 1;
+}
+
+inline unsigned char _BitScanReverse64(unsigned long* index, uint64_t mask)
+{
+    if (!mask)
+        return 0;
+
+    *index = (unsigned long)(63 - __builtin_clzll(mask));
+    return 1;
+}
+
+// Only touches the byte that contains the bit (long is 64 bits wide here, so callers that
+// cast a pointer to a smaller integer to long* would otherwise write past it)
+inline unsigned char _bittestandset(long* base, long bit)
+{
+    unsigned char* byte = reinterpret_cast<unsigned char*>(base) + (bit >> 3);
+    const unsigned char mask = (unsigned char)(1u << (bit & 7));
+    const unsigned char prev = (*byte & mask) != 0;
+    *byte |= mask;
+
+    return prev;
+}
+
+inline unsigned char _bittestandreset(long* base, long bit)
+{
+    unsigned char* byte = reinterpret_cast<unsigned char*>(base) + (bit >> 3);
+    const unsigned char mask = (unsigned char)(1u << (bit & 7));
+    const unsigned char prev = (*byte & mask) != 0;
+    *byte &= (unsigned char)~mask;
+
+    return prev;
+}
\ No newline at end of file
@@ -0,0 +1,1073 @@
+#include "../App/Log.h"
+#include "../App/Headless.h"
+#include "../Support/FrameMemory.h"
+#include "../Support/CpuTopology.h"
+#include "../App/Timer.h"
+#include "../App/Common.h"
+#include "../Support/ParamRegistry.h"
+#include "../Support/FrameStats.h"
+#include "../Support/FramePipeline.h"
+#include "../Support/Lock.h"
+#include "../Support/TaskSignalPool.h"
+#include "../Support/FrameCapture.h"
+#include "../Scene/SceneCore.h"
+#include "../Support/ThreadPool.h"
+#include "../Support/MemoryArena.h"
+#include "../Utility/SynchronizedView.h"
+
+#define XXH_STATIC_LINKING_ONLY
+#define XXH_IMPLEMENTATION
+#include <xxHash/xxhash.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <locale.h>
+#include <sched.h>
+#include <stdio.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::App;
+using namespace ZetaRay::App::Common;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    struct FrameTime
+    {
+        static constexpr int HIST_LEN = 60;
+        float FrameTimeHist[HIST_LEN] = { 0.0 };
+        int NextFramHistIdx = 0;
+    };
+
+    struct FrameMemoryContext
+    {
+        alignas(64) int m_threadFrameAllocIndices[ZETA_MAX_NUM_THREADS] = { -1 };
+        // Dense NUMA node of each thread, zero for threads that aren't pinned
+        int m_threadNodes[ZETA_MAX_NUM_THREADS] = { 0 };
+        // Blocks of each node are handed out separately
+        std::atomic_int32_t m_currFrameAllocIndex[CpuTopology::MAX_NUM_NODES];
+    };
+
+    struct AppData
+    {
+        inline static constexpr const char* COMPILED_SHADER_DIR = "../Assets/CSO";
+        inline static constexpr const char* PSO_CACHE_DIR = "../Assets/PsoCache";
+        inline static constexpr const char* ASSET_DIR = "../Assets";
+        inline static constexpr const char* TOOLS_DIR = "../Tools";
+        inline static constexpr const char* DXC_PATH = "../Tools/dxc/bin/dxc";
+        inline static constexpr const char* RENDER_PASS_DIR = "../Source/ZetaRenderPass";
+        static constexpr int FRAME_ALLOCATOR_BLOCK_SIZE = FRAME_ALLOCATOR_MAX_ALLOCATION_SIZE;
+
+        alignas(64) ZETA_THREAD_ID_TYPE m_threadIDs[ZETA_MAX_NUM_THREADS];
+        TaskSignalPool m_taskSignals;
+
+        FrameMemoryContext m_frameMemoryContext;
+        FrameMemory<FRAME_ALLOCATOR_BLOCK_SIZE> m_frameMemory;
+
+        ThreadPool m_workerThreadPool;
+        ThreadPool m_backgroundThreadPool;
+        CpuTopology m_cpuTopology;
+        Timer m_timer;
+
+        uint16_t m_processorCoreCount = 0;
+        uint16_t m_numBackgroundThreads = 0;
+
+        ParamRegistry m_params;
+        SmallVector<ShaderReloadHandler> m_shaderReloadHandlers;
+        FrameStats m_frameStats;
+        FramePipeline m_framePipeline;
+        FrameTime m_frameTime;
+        FrameCaptureWriter m_frameCapture;
+        int64_t m_frameCaptureBeginTime = 0;
+        Scene::SceneCore m_scene;
+
+        SRWLOCK m_stdOutLock = SRWLOCK_INIT;
+        RWLock m_paramLock{ "Params" };
+        RWLock m_shaderReloadLock{ "Shader reload" };
+        RWLock m_statsLock{ "Stats" };
+        RWLock m_logLock{ "Logs" };
+
+        MemoryArena m_logStrArena;
+        SmallVector<LogMessage> m_frameLogs;
+    };
+
+    AppData* g_app = nullptr;
+}
+
+namespace ZetaRay::AppImpl
+{
+    // Reads an integer from the given sysfs file, returns false if it doesn't exist
+    bool ReadSysfsInt(const char* path, int& val)
+    {
+        FILE* f = fopen(path, "r");
+        if (!f)
+            return false;
+
+        const bool success = fscanf(f, "%d", &val) == 1;
+        fclose(f);
+
+        return success;
+    }
+
+    // Logical processors available to this process along with their package, core, NUMA
+    // node and capacity from sysfs. Without sysfs, each one is assumed to be a core on
+    // node 0.
+    void DetectCpuTopology(CpuTopology& topology)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        const int ret = sched_getaffinity(0, sizeof(set), &set);
+        Check(ret == 0, "sched_getaffinity() failed with the following error code: %d.", errno);
+
+        SmallVector<LogicalProcessor, SystemAllocator, 64> processors;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (!CPU_ISSET(cpu, &set))
+                continue;
+
+            LogicalProcessor p{ .ID = cpu, .Package = 0, .Core = cpu, .Node = 0 };
+            char path[128];
+
+            stbsp_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+            if (!ReadSysfsInt(path, p.Package))
+                p.Package = 0;
+
+            stbsp_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+            if (!ReadSysfsInt(path, p.Core))
+                p.Core = cpu;
+
+            // Relative performance of asymmetric cores, only exposed on some architectures
+            stbsp_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu);
+            if (!ReadSysfsInt(path, p.EfficiencyClass))
+                p.EfficiencyClass = 0;
+
+            // The node is given by a "node<N>" link in the cpu's directory
+            stbsp_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+            if (DIR* dir = opendir(path))
+            {
+                while (dirent* entry = readdir(dir))
+                {
+                    if (strncmp(entry->d_name, "node", 4) == 0 && sscanf(entry->d_name + 4, "%d", &p.Node) == 1)
+                        break;
+                }
+
+                closedir(dir);
+            }
+
+            processors.push_back(p);
+        }
+
+        topology.Build(processors);
+    }
+
+    void PinThread(pthread_t thread, int cpu)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        const int ret = pthread_setaffinity_np(thread, sizeof(set), &set);
+        Check(ret == 0, "pthread_setaffinity_np() failed with the following error code: %d.", ret);
+    }
+
+    void ApplyParamUpdates()
+    {
+        g_app->m_paramLock.LockExclusive();
+        g_app->m_params.ApplyUpdates();
+        g_app->m_paramLock.UnlockExclusive();
+    }
+
+    // Scene is driven without a renderer, so every renderer callback is a no-op
+    namespace NullRenderer
+    {
+        void Init() {}
+        void Update(TaskSet&) {}
+        void Render(TaskSet&) {}
+        void Shutdown() {}
+        void OnWindowSizeChanged() {}
+        Core::RenderGraph* GetRenderGraph() { return nullptr; }
+        void DebugDrawRenderGraph() {}
+        bool IsRTASBuilt() { return false; }
+        void SceneModified() {}
+        void Pick(uint16, uint16) {}
+        void ClearPick() {}
+        void CaptureScreen() {}
+    }
+
+    // Replay handlers that drive the scene (see Headless::ReplayScene())
+    namespace SceneReplay
+    {
+        void OnTransform(const CapturedTransform& t)
+        {
+            g_app->m_scene.TransformInstance(t.InstanceID, t.Translation, t.Rotation, t.Scale);
+        }
+
+        void OnUpdate(double dt)
+        {
+            TaskSet sceneTS;
+            TaskSet sceneRendererTS;
+            g_app->m_scene.Update(dt, sceneTS, sceneRendererTS);
+
+            sceneTS.Sort();
+            sceneRendererTS.Sort();
+            sceneTS.ConnectTo(sceneRendererTS);
+            sceneTS.Finalize();
+            sceneRendererTS.Finalize();
+
+            App::Submit(ZetaMove(sceneTS));
+            App::Submit(ZetaMove(sceneRendererTS));
+        }
+    }
+
+    void UpdateStats(size_t tempMemoryUsage)
+    {
+        const float frameTimeMs = g_app->m_timer.GetTotalFrameCount() > 1 ?
+            (float)(g_app->m_timer.GetElapsedTime() * 1000.0f) :
+            0.0f;
+
+        auto& frameStats = g_app->m_frameTime;
+
+        if (frameStats.NextFramHistIdx < frameStats.HIST_LEN)
+            frameStats.FrameTimeHist[frameStats.NextFramHistIdx++] = frameTimeMs;
+        else
+        {
+            // shift left
+            for (int i = 0; i < frameStats.HIST_LEN - 1; i++)
+                frameStats.FrameTimeHist[i] = frameStats.FrameTimeHist[i + 1];
+
+            frameStats.FrameTimeHist[frameStats.HIST_LEN - 1] = frameTimeMs;
+        }
+
+        App::AddFrameStat("Frame", "FPS", g_app->m_timer.GetFramesPerSecond());
+        App::AddFrameStat("Frame", "Frame temp memory usage (kb)", tempMemoryUsage >> 10);
+
+        FrameLatencies latencies;
+        if (g_app->m_framePipeline.GetLatest(latencies))
+        {
+            for (int i = 0; i < (int)FRAME_STAGE::COUNT; i++)
+                App::AddFrameStat(FRAME_PIPELINE_STAT_GROUP, FRAME_PIPELINE_STAT_NAMES[i], latencies.StageMs[i]);
+
+            App::AddFrameStat(FRAME_PIPELINE_STAT_GROUP, FRAME_PIPELINE_STAT_NAMES[(int)FRAME_STAGE::COUNT],
+                latencies.TotalMs);
+        }
+
+        LockFrameStats lockStats[32];
+        const int numLocks = CollectLockStats(lockStats);
+
+        for (int i = 0; i < numLocks; i++)
+        {
+            char name[Stat::NAME_LEN];
+            stbsp_snprintf(name, sizeof(name), "%s contended", lockStats[i].Name);
+            App::AddFrameStat(LOCK_STAT_GROUP, name, lockStats[i].NumContended, lockStats[i].NumAcquires);
+
+            stbsp_snprintf(name, sizeof(name), "%s wait (ms)", lockStats[i].Name);
+            App::AddFrameStat(LOCK_STAT_GROUP, name, lockStats[i].WaitMs);
+        }
+
+        const TaskSignalStats& taskStats = g_app->m_taskSignals.GetFrameStats();
+        App::AddFrameStat(TASK_STAT_GROUP, TASK_STAT_NUM_TASKS, taskStats.NumTasks);
+        App::AddFrameStat(TASK_STAT_GROUP, TASK_STAT_NUM_BLOCKED, taskStats.NumBlocked);
+        App::AddFrameStat(TASK_STAT_GROUP, TASK_STAT_BLOCKED_MS, taskStats.BlockedMs);
+
+        // All of the previous frame's worker tasks (including simulation of this frame) have
+        // finished and this frame's scene tasks haven't been submitted yet, so taking the
+        // scene locks here doesn't contend with them
+        g_app->m_scene.AddMemoryStats();
+
+        // Stats that were added during the previous frame (plus the ones above) are merged
+        // once here, rather than every AddFrameStat() serializing on a lock
+        g_app->m_statsLock.LockExclusive();
+        g_app->m_frameStats.Merge(g_app->m_timer.GetTotalFrameCount());
+        g_app->m_statsLock.UnlockExclusive();
+    }
+
+    ZetaInline int FindThreadIdx()
+    {
+        const ZETA_THREAD_ID_TYPE id = GetCurrentThreadId();
+
+        int ret = -1;
+        __m256i vKey = _mm256_set1_epi32(id);
+
+        for (int i = 0; i < ZETA_MAX_NUM_THREADS; i += 8)
+        {
+            __m256i vIDs = _mm256_load_si256((__m256i*)(g_app->m_threadIDs + i));
+            __m256i vRes = _mm256_cmpeq_epi32(vIDs, vKey);
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(vRes));
+
+            if (mask != 0)
+            {
+                ret = i + _tzcnt_u32(mask);
+                break;
+            }
+        }
+
+        return ret;
+    }
+
+    ZetaInline int GetThreadIdx()
+    {
+        const int ret = FindThreadIdx();
+        Assert(ret != -1, "thread index was not found.");
+
+        return ret;
+    }
+
+    template<size_t blockSize>
+    ZetaInline void* AllocateFrameAllocator(FrameMemory<blockSize>& frameMemory, FrameMemoryContext& context,
+        size_t size, size_t alignment)
+    {
+        alignment = Math::Max(alignof(std::max_align_t), alignment);
+
+        // at most alignment - 1 extra bytes are required
+        Assert(size + alignment - 1 <= frameMemory.BLOCK_SIZE,
+            "allocations larger than FrameMemory::BLOCK_SIZE are not possible with FrameAllocator.");
+
+        const int threadIdx = GetThreadIdx();
+        Assert(threadIdx != -1, "thread idx was not found");
+        const int node = context.m_threadNodes[threadIdx];
+        const int osNodeID = g_app->m_cpuTopology.OsNodeID(node);
+
+        // current memory block has enough space
+        int allocIdx = context.m_threadFrameAllocIndices[threadIdx];
+
+        // first time in this frame
+        if (allocIdx != -1)
+        {
+            auto& block = frameMemory.GetAndInitIfEmpty(node, allocIdx, osNodeID);
+
+            const uintptr_t start = reinterpret_cast<uintptr_t>(block.Start);
+            const uintptr_t ret = Math::AlignUp(start + block.Offset, alignment);
+            const uintptr_t startOffset = ret - start;
+
+            if (startOffset + size < frameMemory.BLOCK_SIZE)
+            {
+                block.Offset = startOffset + size;
+                return reinterpret_cast<void*>(ret);
+            }
+        }
+
+        // allocate/reuse a new block
+        allocIdx = context.m_currFrameAllocIndex[node].fetch_add(1, std::memory_order_relaxed);
+        context.m_threadFrameAllocIndices[threadIdx] = allocIdx;
+        auto& block = frameMemory.GetAndInitIfEmpty(node, allocIdx, osNodeID);
+        Assert(block.Offset == 0, "block offset should be initially 0");
+
+        const uintptr_t start = reinterpret_cast<uintptr_t>(block.Start);
+        const uintptr_t ret = Math::AlignUp(start, alignment);
+        const uintptr_t startOffset = ret - start;
+
+        Assert(startOffset + size < frameMemory.BLOCK_SIZE, "should never happen.");
+        block.Offset = startOffset + size;
+
+        return reinterpret_cast<void*>(ret);
+    }
+}
+
+namespace ZetaRay
+{
+    CpuInfo App::GetProcessorInfo()
+    {
+        CpuTopology topology;
+        AppImpl::DetectCpuTopology(topology);
+
+        return CpuInfo{ .NumPhysicalCores = topology.NumPhysicalCores(),
+            .NumLogicalCores = topology.NumLogicalProcessors(),
+            .NumNumaNodes = topology.NumNodes() };
+    }
+
+    ZETA_THREAD_ID_TYPE App::GetCurrentThreadID()
+    {
+        return GetCurrentThreadId();
+    }
+
+    int App::GetCurrentThreadIdx()
+    {
+        return g_app ? AppImpl::FindThreadIdx() : -1;
+    }
+
+    void App::SetThreadPriority(void* handle, THREAD_PRIORITY priority)
+    {
+        // Linux doesn't allow lowering the priority of individual threads under the default
+        // policy without privileges, SCHED_BATCH gets close by treating them as CPU-bound
+        sched_param param{};
+        const int policy = priority == THREAD_PRIORITY::BACKGROUND ? SCHED_BATCH : SCHED_OTHER;
+        const int ret = pthread_setschedparam((pthread_t)handle, policy, &param);
+        Assert(ret == 0, "pthread_setschedparam() failed with the following error code: %d.", ret);
+    }
+
+    void App::SetThreadDesc(void* handle, wchar_t* buffer)
+    {
+        Assert(handle && buffer, "Invalid args.");
+
+        // Thread names are limited to 16 characters, including the null terminator
+        char name[64];
+        Common::WideToCharStr(buffer, name);
+        name[15] = '\0';
+
+        pthread_setname_np((pthread_t)handle, name);
+    }
+
+    ShaderReloadHandler::ShaderReloadHandler(const char* name, fastdelegate::FastDelegate0<> dlg)
+        : Dlg(dlg)
+    {
+        int n = std::min(MAX_LEN - 1, (int)strlen(name));
+        Assert(n >= 1, "Invalid arg");
+        memcpy(Name, name, n);
+        Name[n] = '\0';
+
+        ID = XXH3_64bits(Name, n);
+    }
+
+    LogMessage::LogMessage(const char* msg, LogMessage::MsgType t)
+    {
+        const char* logType = t == MsgType::INFO ? "INFO" : "WARNING";
+        Type = t;
+
+        // Compute total size first (without the null terminator)
+        const int n = stbsp_snprintf(nullptr, 0, "[Frame %04d] [tid %05d] [%s] | %s",
+            g_app->m_timer.GetTotalFrameCount(), GetCurrentThreadId(), logType, msg);
+
+        Msg = reinterpret_cast<char*>(g_app->m_logStrArena.AllocateAligned(n + 1, alignof(char)));
+        stbsp_snprintf(Msg, n + 1, "[Frame %04d] [tid %05d] [%s] | %s",
+            g_app->m_timer.GetTotalFrameCount(), GetCurrentThreadId(), logType, msg);
+    }
+
+    void App::Headless::Init(const Desc& desc)
+    {
+        Assert(!g_app, "App has already been initialized.");
+
+        const auto supported = Common::CheckIntrinsicSupport();
+        Check(supported & CPU_Intrinsic::AVX2, "AVX2 is not supported.");
+        Check(supported & CPU_Intrinsic::F16C, "F16C is not supported.");
+        Check(supported & CPU_Intrinsic::BMI1, "BMI1 is not supported.");
+
+        setlocale(LC_ALL, "C");
+
+        g_app = new (std::nothrow) AppData;
+
+        AppImpl::DetectCpuTopology(g_app->m_cpuTopology);
+        const int numPhysicalCores = g_app->m_cpuTopology.NumPhysicalCores();
+
+        Check(desc.NumBackgroundThreads > 0 && desc.NumBackgroundThreads < ZETA_MAX_NUM_THREADS,
+            "Invalid number of background threads.");
+        g_app->m_numBackgroundThreads = (uint16_t)desc.NumBackgroundThreads;
+
+        const int numWorkers = desc.NumWorkerThreads > 0 ? desc.NumWorkerThreads : numPhysicalCores;
+        g_app->m_processorCoreCount = (uint16_t)Min(numWorkers,
+            ZETA_MAX_NUM_THREADS - desc.NumBackgroundThreads);
+
+        // initialize thread pools
+        const int totalNumThreads = g_app->m_processorCoreCount + g_app->m_numBackgroundThreads;
+        g_app->m_workerThreadPool.Init(g_app->m_processorCoreCount - 1,
+            totalNumThreads,
+            L"ZetaWorker",
+            THREAD_PRIORITY::NORMAL);
+
+        g_app->m_backgroundThreadPool.Init(g_app->m_numBackgroundThreads,
+            totalNumThreads,
+            L"ZetaBackground",
+            THREAD_PRIORITY::BACKGROUND);
+
+        // Main thread and the workers each get a physical core (as long as there are
+        // enough), background threads go on the SMT siblings
+        int cpus[ZETA_MAX_NUM_THREADS];
+        g_app->m_cpuTopology.AssignThreads(desc.Pinning, g_app->m_processorCoreCount,
+            g_app->m_numBackgroundThreads, MutableSpan(cpus, totalNumThreads));
+
+        for (int i = 0; i < totalNumThreads; i++)
+        {
+            g_app->m_frameMemoryContext.m_threadNodes[i] = cpus[i] != CpuTopology::UNPINNED ?
+                g_app->m_cpuTopology.NodeOf(cpus[i]) :
+                0;
+
+            if (cpus[i] == CpuTopology::UNPINNED)
+                continue;
+
+            const int numWorkers = g_app->m_processorCoreCount;
+            pthread_t thread = i == 0 ? pthread_self() :
+                i < numWorkers ? (pthread_t)g_app->m_workerThreadPool.ThreadHandle(i - 1) :
+                (pthread_t)g_app->m_backgroundThreadPool.ThreadHandle(i - numWorkers);
+
+            AppImpl::PinThread(thread, cpus[i]);
+        }
+
+        // initialize frame allocators
+        memset(g_app->m_frameMemoryContext.m_threadFrameAllocIndices, -1, sizeof(int) * ZETA_MAX_NUM_THREADS);
+        for (int i = 0; i < CpuTopology::MAX_NUM_NODES; i++)
+            g_app->m_frameMemoryContext.m_currFrameAllocIndex[i].store(0, std::memory_order_release);
+
+        memset(g_app->m_threadIDs, 0, ZetaArrayLen(g_app->m_threadIDs) * sizeof(uint32_t));
+
+        // main thread
+        g_app->m_threadIDs[0] = GetCurrentThreadId();
+
+        // worker threads
+        auto workerThreadIDs = g_app->m_workerThreadPool.ThreadIDs();
+
+        for (int i = 0; i < workerThreadIDs.size(); i++)
+            g_app->m_threadIDs[i + 1] = workerThreadIDs[i];
+
+        // background threads
+        auto backgroundThreadIDs = g_app->m_backgroundThreadPool.ThreadIDs();
+
+        for (int i = 0; i < backgroundThreadIDs.size(); i++)
+            g_app->m_threadIDs[workerThreadIDs.size() + 1 + i] = backgroundThreadIDs[i];
+
+        g_app->m_workerThreadPool.Start(GetAllThreadIDs());
+        g_app->m_backgroundThreadPool.Start(GetAllThreadIDs());
+
+        g_app->m_timer.Start();
+
+        Scene::Renderer::Interface nullRenderer{ .Init = AppImpl::NullRenderer::Init,
+            .Update = AppImpl::NullRenderer::Update,
+            .Render = AppImpl::NullRenderer::Render,
+            .Shutdown = AppImpl::NullRenderer::Shutdown,
+            .OnWindowSizeChanged = AppImpl::NullRenderer::OnWindowSizeChanged,
+            .GetRenderGraph = AppImpl::NullRenderer::GetRenderGraph,
+            .DebugDrawRenderGraph = AppImpl::NullRenderer::DebugDrawRenderGraph,
+            .IsRTASBuilt = AppImpl::NullRenderer::IsRTASBuilt,
+            .SceneModified = AppImpl::NullRenderer::SceneModified,
+            .Pick = AppImpl::NullRenderer::Pick,
+            .ClearPick = AppImpl::NullRenderer::ClearPick,
+            .CaptureScreen = AppImpl::NullRenderer::CaptureScreen };
+        g_app->m_scene.Init(nullRenderer);
+
+        LOG_UI(INFO, "Detected %d physical CPU cores (%d logical) on %d NUMA node(s)", numPhysicalCores,
+            g_app->m_cpuTopology.NumLogicalProcessors(), g_app->m_cpuTopology.NumNodes());
+    }
+
+    void App::Headless::Shutdown()
+    {
+        App::FlushAllThreadPools();
+
+        g_app->m_scene.Shutdown();
+        g_app->m_workerThreadPool.Shutdown();
+        g_app->m_backgroundThreadPool.Shutdown();
+
+        delete g_app;
+        g_app = nullptr;
+    }
+
+    void App::Headless::BeginFrame()
+    {
+        // help out while there are (non-background) unfinished tasks from previous frame
+        App::FlushWorkerThreadPool();
+
+        // Without a GPU, a frame has completed once its tasks have finished
+        if (g_app->m_timer.GetTotalFrameCount() > 0)
+            g_app->m_framePipeline.CompleteFrame(g_app->m_framePipeline.GetCurrentFrame());
+
+        g_app->m_framePipeline.BeginFrame();
+
+        g_app->m_taskSignals.Reset();
+        const size_t tempMemoryUsed = g_app->m_frameMemory.TotalSize();
+
+        // Skip first frame
+        if (g_app->m_timer.GetTotalFrameCount() > 0)
+        {
+            for (int i = 0; i < CpuTopology::MAX_NUM_NODES; i++)
+                g_app->m_frameMemoryContext.m_currFrameAllocIndex[i].store(0, std::memory_order_release);
+            for (int i = 0; i < ZETA_MAX_NUM_THREADS; i++)
+                g_app->m_frameMemoryContext.m_threadFrameAllocIndices[i] = -1;
+            g_app->m_frameMemory.Reset();        // set the offset to 0, essentially releasing the memory
+        }
+
+        // Startup is counted as "frame" 0, so program loop starts from frame 1
+        g_app->m_timer.Tick();
+
+        AppImpl::ApplyParamUpdates();
+        AppImpl::UpdateStats(tempMemoryUsed);
+
+        if (g_app->m_frameCapture.IsRecording())
+        {
+            g_app->m_frameCapture.BeginFrame(Timer::NowNano() - g_app->m_frameCaptureBeginTime,
+                g_app->m_timer.GetElapsedTime());
+
+            g_app->m_paramLock.LockShared();
+            g_app->m_frameCapture.RecordParamChanges(g_app->m_params.Params());
+            g_app->m_paramLock.UnlockShared();
+        }
+    }
+
+    bool App::Headless::Replay(const char* path, const ReplayHandlers& handlers, ReplayStats& stats)
+    {
+        FrameCaptureReader reader;
+        if (!reader.Load(path))
+        {
+            LOG_UI_WARNING("%s is not a valid frame capture.", path);
+            return false;
+        }
+
+        stats = ReplayStats();
+        SmallVector<CapturedEvent> inputs;
+        CapturedFrame frame;
+        CapturedEvent event;
+        ParamVariant param;
+        DeltaTimer timer;
+
+        while (reader.NextFrame(frame))
+        {
+            // Param changes have to be queued before BeginFrame() applies them, the other
+            // inputs are dispatched after it
+            inputs.clear();
+            timer.Start();
+
+            while (reader.NextEvent(event))
+            {
+                if (event.Type != CAPTURE_EVENT::PARAM)
+                {
+                    inputs.push_back(event);
+                    continue;
+                }
+
+                if (!App::FindParam(event.Param.Group, event.Param.Subgroup, event.Param.Name, param))
+                {
+                    stats.NumSkippedParams++;
+                    continue;
+                }
+
+                App::SetParam(event.Param.Group, event.Param.Subgroup, event.Param.Name, event.Param.Value);
+            }
+
+            Headless::BeginFrame();
+            timer.End();
+            const double beginFrameMs = timer.DeltaMilli();
+
+            timer.Start();
+
+            for (auto& e : inputs)
+            {
+                if (e.Type == CAPTURE_EVENT::CAMERA_MOTION && handlers.OnMotion)
+                    handlers.OnMotion(e.Motion);
+                else if (e.Type == CAPTURE_EVENT::PICK && handlers.OnPick)
+                    handlers.OnPick(e.Pick);
+                else if (e.Type == CAPTURE_EVENT::TRANSFORM && handlers.OnTransform)
+                    handlers.OnTransform(e.Transform);
+            }
+
+            timer.End();
+            const double inputMs = timer.DeltaMilli();
+
+            const uint64_t f = g_app->m_framePipeline.GetCurrentFrame();
+            g_app->m_framePipeline.BeginStage(f, FRAME_STAGE::UPDATE);
+            timer.Start();
+
+            if (handlers.OnUpdate)
+                handlers.OnUpdate(frame.Dt);
+
+            App::FlushWorkerThreadPool();
+
+            timer.End();
+            g_app->m_framePipeline.EndStage(f, FRAME_STAGE::UPDATE);
+            const double updateMs = timer.DeltaMilli();
+
+            App::AddFrameStat("Replay", "Begin frame (ms)", (float)beginFrameMs);
+            App::AddFrameStat("Replay", "Inputs (ms)", (float)inputMs);
+            App::AddFrameStat("Replay", "Update (ms)", (float)updateMs);
+
+            stats.BeginFrameMs += beginFrameMs;
+            stats.InputMs += inputMs;
+            stats.UpdateMs += updateMs;
+            stats.NumFrames++;
+        }
+
+        return true;
+    }
+
+    bool App::Headless::ReplayScene(const char* path, ReplayStats& stats)
+    {
+        const ReplayHandlers handlers{
+            .OnTransform = fastdelegate::FastDelegate1<const CapturedTransform&>(&AppImpl::SceneReplay::OnTransform),
+            .OnUpdate = fastdelegate::FastDelegate1<double>(&AppImpl::SceneReplay::OnUpdate) };
+
+        return Replay(path, handlers, stats);
+    }
+
+    void App::Init(Scene::Renderer::Interface& rendererInterface, const char* name)
+    {
+        Check(false, "There's no renderer on this platform, use App::Headless::Init() instead.");
+    }
+
+    void App::InitBasic()
+    {
+        Headless::Init();
+    }
+
+    void App::ShutdownBasic()
+    {
+        Headless::Shutdown();
+    }
+
+    int App::Run()
+    {
+        Check(false, "There's no window on this platform, drive the frames with App::Headless::BeginFrame().");
+        return -1;
+    }
+
+    Scene::SceneCore& App::GetScene()
+    {
+        return g_app->m_scene;
+    }
+
+    void App::Abort()
+    {
+        Util::Exit();
+    }
+
+    void* App::AllocateFrameAllocator(size_t size, size_t alignment)
+    {
+        return AppImpl::AllocateFrameAllocator<>(g_app->m_frameMemory,
+            g_app->m_frameMemoryContext, size, alignment);
+    }
+
+    int App::RegisterTask(const char* name)
+    {
+        return g_app->m_taskSignals.Register(name);
+    }
+
+    void App::TaskFinalizedCallback(int handle, int indegree)
+    {
+        g_app->m_taskSignals.Finalize(handle, indegree);
+    }
+
+    void App::WaitForAdjacentHeadNodes(int handle)
+    {
+        g_app->m_taskSignals.Wait(handle);
+    }
+
+    void App::SignalAdjacentTailNodes(Span<int> taskIDs)
+    {
+        g_app->m_taskSignals.Signal(taskIDs);
+    }
+
+    void App::Submit(Task&& t)
+    {
+        Assert(t.GetPriority() == TASK_PRIORITY::NORMAL,
+            "Background task is not allowed to be executed on the main thread pool.");
+        g_app->m_workerThreadPool.Enqueue(ZetaMove(t));
+    }
+
+    void App::Submit(TaskSet&& ts)
+    {
+        g_app->m_workerThreadPool.Enqueue(ZetaMove(ts));
+    }
+
+    void App::SubmitBackground(Task&& t)
+    {
+        Assert(t.GetPriority() == TASK_PRIORITY::BACKGROUND,
+            "Normal-priority task is not allowed to be executed on the background thread pool.");
+        g_app->m_backgroundThreadPool.Enqueue(ZetaMove(t));
+    }
+
+    void App::FlushWorkerThreadPool()
+    {
+        bool success = false;
+        while (!success)
+            success = g_app->m_workerThreadPool.TryFlush();
+    }
+
+    void App::FlushAllThreadPools()
+    {
+        bool success = false;
+        while (!success)
+            success = g_app->m_workerThreadPool.TryFlush();
+
+        success = false;
+        while (!success)
+            success = g_app->m_backgroundThreadPool.TryFlush();
+    }
+
+    int App::GetNumWorkerThreads() { return g_app->m_processorCoreCount; }
+    int App::GetNumBackgroundThreads() { return g_app->m_numBackgroundThreads; }
+    uint32_t App::GetDPI() { return 96; }
+    float App::GetUpscalingFactor() { return 1.0f; }
+    bool App::IsFullScreen() { return false; }
+    const App::Timer& App::GetTimer() { return g_app->m_timer; }
+    const char* App::GetPSOCacheDir() { return AppData::PSO_CACHE_DIR; }
+    const char* App::GetCompileShadersDir() { return AppData::COMPILED_SHADER_DIR; }
+    const char* App::GetAssetDir() { return AppData::ASSET_DIR; }
+    const char* App::GetDXCPath() { return AppData::DXC_PATH; }
+    const char* App::GetToolsDir() { return AppData::TOOLS_DIR; }
+    const char* App::GetRenderPassDir() { return AppData::RENDER_PASS_DIR; }
+
+    void App::SetUpscaleFactor(float f)
+    {
+        Assert(f >= 1.0f, "Invalid upscale factor.");
+    }
+
+    void App::LockStdOut()
+    {
+        if (g_app)
+            AcquireSRWLockExclusive(&g_app->m_stdOutLock);
+    }
+
+    void App::UnlockStdOut()
+    {
+        if (g_app)
+            ReleaseSRWLockExclusive(&g_app->m_stdOutLock);
+    }
+
+    Span<uint32_t> App::GetWorkerThreadIDs()
+    {
+        return Span(g_app->m_threadIDs, g_app->m_processorCoreCount);
+    }
+
+    Span<uint32_t> App::GetBackgroundThreadIDs()
+    {
+        return Span(g_app->m_threadIDs + g_app->m_processorCoreCount, g_app->m_numBackgroundThreads);
+    }
+
+    Span<uint32_t> App::GetAllThreadIDs()
+    {
+        return Span(g_app->m_threadIDs, g_app->m_processorCoreCount + g_app->m_numBackgroundThreads);
+    }
+
+    SynchronizedMutableSpan<ParamVariant> App::GetParams()
+    {
+        return SynchronizedMutableSpan<ParamVariant>(g_app->m_params.Params(), g_app->m_paramLock);
+    }
+
+    SynchronizedMutableSpan<ShaderReloadHandler> App::GetShaderReloadHandlers()
+    {
+        return SynchronizedMutableSpan<ShaderReloadHandler>(g_app->m_shaderReloadHandlers, g_app->m_shaderReloadLock);
+    }
+
+    SynchronizedSpan<Stat> App::GetStats()
+    {
+        return SynchronizedSpan<Stat>(g_app->m_frameStats.GetMerged(), g_app->m_statsLock);
+    }
+
+    void App::AddParam(ParamVariant& p)
+    {
+        g_app->m_params.Add(p);
+    }
+
+    void App::TryAddParam(ParamVariant& p)
+    {
+        g_app->m_params.TryAdd(p);
+    }
+
+    void App::RemoveParam(const char* group, const char* subgroup, const char* name)
+    {
+        g_app->m_params.Remove(group, subgroup, name);
+    }
+
+    bool App::FindParam(const char* group, const char* subgroup, const char* name, ParamVariant& param)
+    {
+        // Params may be added or removed (and moved) as soon as the lock is released, so
+        // a copy is returned rather than a pointer
+        g_app->m_paramLock.LockShared();
+        const ParamVariant* p = g_app->m_params.Find(group, subgroup, name);
+        if (p)
+            param = *p;
+        g_app->m_paramLock.UnlockShared();
+
+        return p != nullptr;
+    }
+
+    void App::SetParam(const char* group, const char* subgroup, const char* name, const char* value)
+    {
+        g_app->m_params.SetValue(group, subgroup, name, value);
+    }
+
+    bool App::LoadParams(const char* path)
+    {
+        return g_app->m_params.SetValuesFromFile(path);
+    }
+
+    void App::AddShaderReloadHandler(const char* name, fastdelegate::FastDelegate0<> dlg)
+    {
+        g_app->m_shaderReloadLock.LockExclusive();
+        g_app->m_shaderReloadHandlers.emplace_back(name, dlg);
+        g_app->m_shaderReloadLock.UnlockExclusive();
+    }
+
+    void App::RemoveShaderReloadHandler(const char* name)
+    {
+        uint64_t id = XXH3_64bits(name, Math::Min(ShaderReloadHandler::MAX_LEN - 1, (int)strlen(name)));
+
+        g_app->m_shaderReloadLock.LockExclusive();
+        int i = 0;
+        bool found = false;
+
+        for (i = 0; i < (int)g_app->m_shaderReloadHandlers.size(); i++)
+        {
+            if (g_app->m_shaderReloadHandlers[i].ID == id)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (found)
+            g_app->m_shaderReloadHandlers.erase_at_index(i);
+
+        g_app->m_shaderReloadLock.UnlockExclusive();
+    }
+
+    void App::AddFrameStat(const char* group, const char* name, int i)
+    {
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, i);
+    }
+
+    void App::AddFrameStat(const char* group, const char* name, uint32_t u)
+    {
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
+    }
+
+    void App::AddFrameStat(const char* group, const char* name, float f)
+    {
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, f);
+    }
+
+    void App::AddFrameStat(const char* group, const char* name, uint64_t u)
+    {
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
+    }
+
+    void App::AddFrameStat(const char* group, const char* name, uint32_t num, uint32_t total)
+    {
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, num, total);
+    }
+
+    uint32_t App::RegisterFrameStat(const char* group, const char* name)
+    {
+        return g_app->m_frameStats.Register(group, name);
+    }
+
+    void App::AddFrameStat(uint32_t id, int i)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, i);
+    }
+
+    void App::AddFrameStat(uint32_t id, uint32_t u)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
+    }
+
+    void App::AddFrameStat(uint32_t id, float f)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, f);
+    }
+
+    void App::AddFrameStat(uint32_t id, uint64_t u)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
+    }
+
+    void App::AddFrameStat(uint32_t id, uint32_t num, uint32_t total)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, num, total);
+    }
+
+    StatPercentiles App::GetFrameStatPercentiles(uint32_t id)
+    {
+        g_app->m_statsLock.LockShared();
+        const StatPercentiles ret = g_app->m_frameStats.GetPercentiles(id);
+        g_app->m_statsLock.UnlockShared();
+
+        return ret;
+    }
+
+    void App::SetFramesInFlight(int n)
+    {
+        g_app->m_framePipeline.SetFramesInFlight(n);
+    }
+
+    int App::GetFramesInFlight()
+    {
+        return g_app->m_framePipeline.GetFramesInFlight();
+    }
+
+    FramePipeline& App::GetFramePipeline()
+    {
+        return g_app->m_framePipeline;
+    }
+
+    const TaskSignalStats& App::GetTaskSignalStats()
+    {
+        return g_app->m_taskSignals.GetFrameStats();
+    }
+
+    const CpuTopology& App::GetCpuTopology()
+    {
+        return g_app->m_cpuTopology;
+    }
+
+    void App::BeginFrameStatsDump()
+    {
+        g_app->m_statsLock.LockExclusive();
+        g_app->m_frameStats.BeginDump();
+        g_app->m_statsLock.UnlockExclusive();
+    }
+
+    void App::EndFrameStatsDump(const char* path)
+    {
+        g_app->m_statsLock.LockExclusive();
+        g_app->m_frameStats.EndDump(path);
+        g_app->m_statsLock.UnlockExclusive();
+    }
+
+    void App::BeginFrameCapture()
+    {
+        g_app->m_frameCaptureBeginTime = Timer::NowNano();
+        g_app->m_frameCapture.Begin();
+    }
+
+    void App::EndFrameCapture(const char* path)
+    {
+        g_app->m_frameCapture.End(path);
+    }
+
+    bool App::IsCapturingFrames()
+    {
+        return g_app->m_frameCapture.IsRecording();
+    }
+
+    void App::CaptureTransformEdit(uint64_t instanceID, const float3& tr, const float3x3& rotation,
+        const float3& scale, bool nextFrame)
+    {
+        if (g_app->m_frameCapture.IsRecording())
+            g_app->m_frameCapture.RecordTransform(instanceID, tr, rotation, scale, nextFrame);
+    }
+
+    Span<float> App::GetFrameTimeHistory()
+    {
+        auto& frameStats = g_app->m_frameTime;
+        return frameStats.FrameTimeHist;
+    }
+
+    void App::Log(const char* msg, LogMessage::MsgType t)
+    {
+        // Support code can log before Init(), e.g. in tests
+        if (g_app)
+        {
+            g_app->m_logLock.LockExclusive();
+            g_app->m_frameLogs.emplace_back(msg, t);
+            g_app->m_logLock.UnlockExclusive();
+        }
+
+        // There's no UI to show the logs
+        LockStdOut();
+        printf("%s\n", msg);
+        UnlockStdOut();
+    }
+
+    Util::RWSynchronizedView<Vector<App::LogMessage, SystemAllocator>> App::GetLogs()
+    {
+        return RWSynchronizedView<Vector<LogMessage>>(g_app->m_frameLogs, g_app->m_logLock);
+    }
+
+    void App::CopyToClipboard(StrView data)
+    {
+    }
+}
\ No newline at end of file
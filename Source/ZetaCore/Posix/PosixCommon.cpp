@@ -0,0 +1,218 @@
+#define STB_SPRINTF_IMPLEMENTATION
+
+#include "../App/Common.h"
+#include "../Utility/Error.h"
+#include <cpuid.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+//--------------------------------------------------------------------------------------
+// Common
+//--------------------------------------------------------------------------------------
+
+// wchar_t is UTF-32 here, so conversions are between UTF-8 and code points
+
+namespace
+{
+    // Decodes the code point starting at str and returns its length in bytes. Invalid
+    // sequences decode to U+FFFD.
+    int DecodeUtf8(const unsigned char* str, uint32_t& cp)
+    {
+        const unsigned char c = str[0];
+
+        if (c < 0x80)
+        {
+            cp = c;
+            return 1;
+        }
+
+        int len = (c & 0xe0) == 0xc0 ? 2 : (c & 0xf0) == 0xe0 ? 3 : (c & 0xf8) == 0xf0 ? 4 : 0;
+        if (len == 0)
+        {
+            cp = 0xfffd;
+            return 1;
+        }
+
+        cp = c & (0x7f >> len);
+
+        for (int i = 1; i < len; i++)
+        {
+            if ((str[i] & 0xc0) != 0x80)
+            {
+                cp = 0xfffd;
+                return i;
+            }
+
+            cp = (cp << 6) | (str[i] & 0x3f);
+        }
+
+        return len;
+    }
+
+    int EncodeUtf8(uint32_t cp, char* dst)
+    {
+        if (cp < 0x80)
+        {
+            dst[0] = (char)cp;
+            return 1;
+        }
+        if (cp < 0x800)
+        {
+            dst[0] = (char)(0xc0 | (cp >> 6));
+            dst[1] = (char)(0x80 | (cp & 0x3f));
+            return 2;
+        }
+        if (cp < 0x10000)
+        {
+            dst[0] = (char)(0xe0 | (cp >> 12));
+            dst[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+            dst[2] = (char)(0x80 | (cp & 0x3f));
+            return 3;
+        }
+
+        dst[0] = (char)(0xf0 | (cp >> 18));
+        dst[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+        dst[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        dst[3] = (char)(0x80 | (cp & 0x3f));
+        return 4;
+    }
+}
+
+int Common::WideToCharStr(const wchar_t* wideStr, MutableSpan<char> str)
+{
+    // Size includes the terminating null character
+    int size = 1;
+    char tmp[4];
+
+    for (const wchar_t* curr = wideStr; *curr; curr++)
+        size += EncodeUtf8((uint32_t)*curr, tmp);
+
+    Assert(str.size() > size, "buffer overflow");
+
+    size_t n = 0;
+    for (const wchar_t* curr = wideStr; *curr; curr++)
+    {
+        const int len = EncodeUtf8((uint32_t)*curr, tmp);
+        if (n + len >= str.size())
+            break;
+
+        memcpy(str.data() + n, tmp, len);
+        n += len;
+    }
+
+    str[n] = '\0';
+
+    return size;
+}
+
+int Common::CharToWideStrLen(const char* str)
+{
+    const unsigned char* curr = reinterpret_cast<const unsigned char*>(str);
+    int size = 1;
+    uint32_t cp;
+
+    while (*curr)
+    {
+        curr += DecodeUtf8(curr, cp);
+        size++;
+    }
+
+    return size;
+}
+
+int Common::CharToWideStr(const char* str, Util::MutableSpan<wchar_t> wideStr)
+{
+    // #size includes terminating null character
+    const int size = CharToWideStrLen(str);
+    Assert(wideStr.size() >= size, "Provided buffer is too small.");
+
+    const unsigned char* curr = reinterpret_cast<const unsigned char*>(str);
+    size_t n = 0;
+    uint32_t cp;
+
+    while (*curr && n + 1 < wideStr.size())
+    {
+        curr += DecodeUtf8(curr, cp);
+        wideStr[n++] = (wchar_t)cp;
+    }
+
+    wideStr[n] = L'\0';
+
+    return size;
+}
+
+uint32_t Common::CheckIntrinsicSupport()
+{
+    uint32_t ret = 0;
+
+    // EAX, EBX, ECX, EDX
+    unsigned int cpuInfo[4] = { 0 };
+    __get_cpuid(1, &cpuInfo[0], &cpuInfo[1], &cpuInfo[2], &cpuInfo[3]);
+
+    if ((cpuInfo[2] & (0x1 | (1 << 9))) == (0x1 | (1 << 9)))
+        ret |= CPU_Intrinsic::SSE3;
+    if ((cpuInfo[2] & ((1 << 20) | (1 << 19))) == ((1 << 20) | (1 << 19)))
+        ret |= CPU_Intrinsic::SSE4;
+    if (cpuInfo[2] & (1 << 28))
+        ret |= CPU_Intrinsic::AVX;
+    if (cpuInfo[2] & (1 << 29))
+        ret |= CPU_Intrinsic::F16C;
+
+    memset(cpuInfo, 0, ZetaArrayLen(cpuInfo) * sizeof(int));
+    __get_cpuid_count(0x7, 0, &cpuInfo[0], &cpuInfo[1], &cpuInfo[2], &cpuInfo[3]);
+
+    if (cpuInfo[1] & (1 << 5))
+        ret |= CPU_Intrinsic::AVX2;
+    if (cpuInfo[1] & (1 << 3))
+        ret |= CPU_Intrinsic::BMI1;
+
+    return ret;
+}
+
+//--------------------------------------------------------------------------------------
+// Error reporting
+//--------------------------------------------------------------------------------------
+
+// There's no message box in a headless process, so errors go to stderr along with the
+// callstack
+
+void ZetaRay::Util::ReportError(const char* title, const char* msg)
+{
+    fprintf(stderr, "%s: %s\n", title, msg);
+
+#ifndef NDEBUG
+    void* frames[32];
+    const int n = backtrace(frames, (int)ZetaArrayLen(frames));
+
+    fprintf(stderr, "Callstack:\n");
+    // Skip this function
+    backtrace_symbols_fd(frames + 1, n - 1, fileno(stderr));
+#endif
+
+    fflush(stderr);
+}
+
+void ZetaRay::Util::ReportErrorWin32(const char* file, int line, const char* call)
+{
+    char msg[256];
+    stbsp_snprintf(msg, 256, "%s: %d\nPredicate: %s\nError code: %d", file, line, call, errno);
+
+    ReportError("System call failed", msg);
+}
+
+void ZetaRay::Util::DebugBreak()
+{
+    raise(SIGTRAP);
+}
+
+void ZetaRay::Util::Exit()
+{
+    exit(EXIT_FAILURE);
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "../App/Filesystem.h"
+#include "../Support/MemoryArena.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    // Maps the whole file and copies it into fileData. Mapping avoids the intermediate
+    // kernel-to-user copies of read() and lets the kernel read ahead aggressively.
+    template<typename Allocator>
+    void LoadFromFileImpl(const char* path, Vector<uint8_t, Allocator>& fileData)
+    {
+        Assert(path, "path argument was NULL.");
+
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        Check(fd != -1, "open() for path %s failed with the following error code: %d.", path, errno);
+
+        struct stat s;
+        int ret = fstat(fd, &s);
+        Check(ret == 0, "fstat() for path %s failed with the following error code: %d.", path, errno);
+
+        const size_t size = (size_t)s.st_size;
+        fileData.resize(size);
+
+        if (size > 0)
+        {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            Check(mapped != MAP_FAILED, "mmap() for path %s failed with the following error code: %d.",
+                path, errno);
+
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            memcpy(fileData.data(), mapped, size);
+
+            munmap(mapped, size);
+        }
+
+        close(fd);
+    }
+
+    ZetaInline int ToFd(void* file)
+    {
+        // Handle is the file descriptor plus one, so that 0 is a valid descriptor
+        return (int)(reinterpret_cast<intptr_t>(file) - 1);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------------------------
+
+void Filesystem::LoadFromFile(const char* path, Vector<uint8_t>& fileData)
+{
+    LoadFromFileImpl(path, fileData);
+}
+
+void Filesystem::LoadFromFile(const char* path, Vector<uint8_t, Support::ArenaAllocator>& fileData)
+{
+    LoadFromFileImpl(path, fileData);
+}
+
+void Filesystem::WriteToFile(const char* path, uint8_t* data, uint32_t sizeInBytes)
+{
+    Assert(path, "path argument was NULL.");
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    Check(fd != -1, "open() for path %s failed with the following error code: %d.", path, errno);
+
+    size_t numWritten = 0;
+
+    while (numWritten < sizeInBytes)
+    {
+        const ssize_t n = write(fd, data + numWritten, sizeInBytes - numWritten);
+        if (n == -1 && errno == EINTR)
+            continue;
+
+        Check(n > 0, "write() for path %s failed with the following error code: %d.", path, errno);
+        numWritten += n;
+    }
+
+    close(fd);
+}
+
+void Filesystem::RemoveFile(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    const int ret = unlink(path);
+    Check(ret == 0, "unlink() for path %s failed with the following error code: %d.", path, errno);
+}
+
+bool Filesystem::Exists(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    struct stat s;
+    return stat(path, &s) == 0 && !S_ISDIR(s.st_mode);
+}
+
+size_t Filesystem::GetFileSize(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    struct stat s;
+    if (stat(path, &s) != 0)
+    {
+        Check(errno == ENOENT, "stat() for path %s failed with the following error code: %d.",
+            path, errno);
+
+        return size_t(-1);
+    }
+
+    return (size_t)s.st_size;
+}
+
+void Filesystem::CreateDirectoryIfNotExists(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    struct stat s;
+    if (stat(path, &s) == 0 && S_ISDIR(s.st_mode))
+        return;
+
+    const int ret = mkdir(path, 0755);
+    Check(ret == 0, "mkdir() for path %s failed with the following error code: %d.", path, errno);
+}
+
+bool Filesystem::Copy(const char* path, const char* newPath, bool overwrite)
+{
+    Assert(path && newPath, "path argument was NULL.");
+
+    const int src = open(path, O_RDONLY | O_CLOEXEC);
+    Check(src != -1, "open() for path %s failed with the following error code: %d.", path, errno);
+
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (overwrite ? O_TRUNC : O_EXCL);
+    const int dst = open(newPath, flags, 0644);
+
+    if (dst == -1)
+    {
+        Check(errno == EEXIST, "open() for path %s failed with the following error code: %d.",
+            newPath, errno);
+        close(src);
+
+        return false;
+    }
+
+    uint8_t buffer[64 * 1024];
+
+    while (true)
+    {
+        const ssize_t numRead = read(src, buffer, sizeof(buffer));
+        if (numRead == -1 && errno == EINTR)
+            continue;
+
+        Check(numRead >= 0, "read() for path %s failed with the following error code: %d.", path, errno);
+        if (numRead == 0)
+            break;
+
+        ssize_t numWritten = 0;
+
+        while (numWritten < numRead)
+        {
+            const ssize_t n = write(dst, buffer + numWritten, numRead - numWritten);
+            if (n == -1 && errno == EINTR)
+                continue;
+
+            Check(n > 0, "write() for path %s failed with the following error code: %d.", newPath, errno);
+            numWritten += n;
+        }
+    }
+
+    close(dst);
+    close(src);
+
+    return true;
+}
+
+bool Filesystem::IsDirectory(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    struct stat s;
+    if (stat(path, &s) != 0)
+    {
+        Check(errno == ENOENT || errno == ENOTDIR, "stat() failed with the error code: %d\n.", errno);
+        return false;
+    }
+
+    return S_ISDIR(s.st_mode);
+}
+
+void* Filesystem::OpenFileForRead(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return nullptr;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+
+    return reinterpret_cast<void*>((intptr_t)fd + 1);
+}
+
+void Filesystem::CloseFile(void* file)
+{
+    if (file)
+        close(ToFd(file));
+}
+
+bool Filesystem::ReadFromFile(void* file, size_t offset, MutableSpan<uint8_t> data)
+{
+    Assert(file, "Invalid file handle.");
+
+    // pread() doesn't use or modify the shared file offset
+    const int fd = ToFd(file);
+    size_t numRead = 0;
+
+    while (numRead < data.size())
+    {
+        const ssize_t n = pread(fd, data.data() + numRead, data.size() - numRead, offset + numRead);
+        if (n == -1 && errno == EINTR)
+            continue;
+
+        // Zero means end of file
+        if (n <= 0)
+            return false;
+
+        numRead += n;
+    }
+
+    return true;
+}
\ No newline at end of file
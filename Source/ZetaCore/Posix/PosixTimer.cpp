@@ -0,0 +1,125 @@
+#include "../App/Timer.h"
+#include <time.h>
+
+using namespace ZetaRay::App;
+
+namespace
+{
+    // CLOCK_MONOTONIC is in nanoseconds, so there are 10^9 counts per second
+    constexpr int64_t COUNTS_PER_SEC = 1'000'000'000;
+
+    ZetaInline int64_t QueryCounter()
+    {
+        timespec ts;
+        const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+        Assert(ret == 0, "clock_gettime() failed.");
+
+        return (int64_t)ts.tv_sec * COUNTS_PER_SEC + ts.tv_nsec;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Timer
+//--------------------------------------------------------------------------------------
+
+Timer::Timer()
+{
+    m_counterFreqSec = COUNTS_PER_SEC;
+}
+
+int64_t Timer::NowNano()
+{
+    return QueryCounter();
+}
+
+void Timer::Start()
+{
+    m_start = QueryCounter();
+    m_last = m_start;
+}
+
+void Timer::Resume()
+{
+    m_last = QueryCounter();
+
+    if (m_paused)
+    {
+        m_totalPausedCounts += m_last - m_pauseCount;
+        m_pauseCount = 0;
+
+        m_paused = false;
+    }
+}
+
+void Timer::Pause()
+{
+    if (m_paused)
+        return;
+
+    m_pauseCount = QueryCounter();
+
+    m_framesInLastSecond = 0;
+    m_numCountsInLastSecond = 0;
+    m_paused = true;
+}
+
+void Timer::Tick()
+{
+    if (m_paused)
+        return;
+
+    const int64_t currCount = QueryCounter();
+
+    m_elapsedCounts = currCount - m_last;
+    m_numCountsInLastSecond += m_elapsedCounts;
+    m_framesInLastSecond++;
+    m_last = currCount;
+
+    m_delta = (double)m_elapsedCounts / m_counterFreqSec;
+
+    // Number of times Tick() was called during the last second is equal to FPS
+    if (m_numCountsInLastSecond >= m_counterFreqSec)
+    {
+        m_fps = (int)m_framesInLastSecond;
+        m_framesInLastSecond = 0;
+        m_numCountsInLastSecond = 0;
+    }
+
+    m_frameCount++;
+}
+
+//--------------------------------------------------------------------------------------
+// DeltaTimer
+//--------------------------------------------------------------------------------------
+
+DeltaTimer::DeltaTimer()
+{
+    m_counterFreqSec = COUNTS_PER_SEC;
+}
+
+void DeltaTimer::Start()
+{
+    m_start = QueryCounter();
+}
+
+void DeltaTimer::End()
+{
+    m_end = QueryCounter();
+}
+
+// Counts are already in nanoseconds, so unlike QPC, there's no need to scale before dividing
+
+double DeltaTimer::DeltaNano()
+{
+    return (double)(m_end - m_start);
+}
+
+double DeltaTimer::DeltaMicro()
+{
+    return (double)(m_end - m_start) / 1'000;
+}
+
+double DeltaTimer::DeltaMilli()
+{
+    return (double)(m_end - m_start) / 1'000'000;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "BSDF.h"
+#include "../App/Filesystem.h"
+#include "../Core/dds.h"
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT::BSDF;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+using namespace ZetaRay::Core::Direct3DUtil;
+
+//--------------------------------------------------------------------------------------
+// RhoLUT
+//--------------------------------------------------------------------------------------
+
+void RhoLUT::Init(Span<uint16_t> texels)
+{
+    Assert(texels.size() == WIDTH * HEIGHT * DEPTH, "Invalid number of texels.");
+    m_texels.resize(texels.size());
+
+    for (size_t i = 0; i < texels.size(); i++)
+        m_texels[i] = texels[i] / float(UINT16_MAX);
+}
+
+bool RhoLUT::Load(const char* path)
+{
+    if (!Filesystem::Exists(path))
+        return false;
+
+    SmallVector<uint8_t> data;
+    Filesystem::LoadFromFile(path, data);
+
+    constexpr size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    constexpr size_t DATA_SIZE = WIDTH * HEIGHT * DEPTH * sizeof(uint16_t);
+    if (data.size() < HEADER_SIZE + DATA_SIZE)
+        return false;
+
+    uint32_t magic;
+    DDS_HEADER header;
+    memcpy(&magic, data.data(), sizeof(uint32_t));
+    memcpy(&header, data.data() + sizeof(uint32_t), sizeof(DDS_HEADER));
+
+    // Expects a single-channel 16-bit 3D texture without mips
+    if (magic != DDS_MAGIC || !(header.flags & DDS_HEADER_FLAGS_VOLUME) ||
+        header.width != WIDTH || header.height != HEIGHT || header.depth != DEPTH ||
+        header.ddspf.RGBBitCount != 16 || (header.ddspf.flags & DDS_FOURCC))
+    {
+        return false;
+    }
+
+    SmallVector<uint16_t> texels;
+    texels.resize(WIDTH * HEIGHT * DEPTH);
+    memcpy(texels.data(), data.data() + HEADER_SIZE, DATA_SIZE);
+    Init(texels);
+
+    return true;
+}
+
+void RhoLUT::Compute(uint32_t sqrtNumSamples)
+{
+    Assert(sqrtNumSamples > 0, "Invalid number of samples.");
+    m_texels.resize(WIDTH * HEIGHT * DEPTH);
+    const float oneOverSqrtN = 1.0f / sqrtNumSamples;
+
+    // Inverse of the mapping in GGXReflectance_Dielectric(), evaluated at texel centers
+    for (uint32_t z = 0; z < DEPTH; z++)
+    {
+        const float eta = 0.5f + (z + 0.5f) / DEPTH * (1.99f - 0.5f);
+
+        for (uint32_t y = 0; y < HEIGHT; y++)
+        {
+            const float alpha = 0.002025f + (y + 0.5f) / HEIGHT * (1.0f - 0.002025f);
+            const float alphaSq = alpha * alpha;
+
+            for (uint32_t x = 0; x < WIDTH; x++)
+            {
+                const float ndotwo = (x + 0.5f) / WIDTH;
+                const Math::float3 wo(sqrtf(1.0f - ndotwo * ndotwo), 0.0f, ndotwo);
+                float sum = 0.0f;
+
+                // With visible normals as the sampling density, estimator is F * G2 / G1(wo)
+                for (uint32_t i = 0; i < sqrtNumSamples; i++)
+                {
+                    for (uint32_t j = 0; j < sqrtNumSamples; j++)
+                    {
+                        const Math::float2 u((i + 0.5f) * oneOverSqrtN, (j + 0.5f) * oneOverSqrtN);
+                        const Math::float3 wh = SampleGGXVNDF(wo, alpha, alpha, u);
+                        const float whdotwo = wo.dot(wh);
+                        const Math::float3 wi = 2.0f * whdotwo * wh - wo;
+
+                        if (wi.z <= 0)
+                            continue;
+
+                        sum += Fresnel_Dielectric(whdotwo, 1.0f / eta) *
+                            SmithHeightCorrelatedG2OverG1(alphaSq, wi.z, ndotwo);
+                    }
+                }
+
+                m_texels[z * HEIGHT * WIDTH + y * WIDTH + x] = sum * oneOverSqrtN * oneOverSqrtN;
+            }
+        }
+    }
+}
+
+float RhoLUT::Sample(float u, float v, float w) const
+{
+    Assert(IsLoaded(), "LUT hasn't been initialized.");
+
+    // Texel centers are at (i + 0.5) / dim
+    auto coord = [](float x, uint32_t dim, uint32_t& i0, uint32_t& i1)
+        {
+            float t = Math::Min(Math::Max(x * dim - 0.5f, 0.0f), float(dim - 1));
+            i0 = Math::Min((uint32_t)t, dim - 1);
+            i1 = Math::Min(i0 + 1, dim - 1);
+
+            return t - i0;
+        };
+
+    uint32_t x0, x1, y0, y1, z0, z1;
+    const float tx = coord(u, WIDTH, x0, x1);
+    const float ty = coord(v, HEIGHT, y0, y1);
+    const float tz = coord(w, DEPTH, z0, z1);
+
+    auto texel = [this](uint32_t x, uint32_t y, uint32_t z)
+        {
+            return m_texels[z * HEIGHT * WIDTH + y * WIDTH + x];
+        };
+
+    auto bilinear = [&](uint32_t z)
+        {
+            const float a = Lerp(texel(x0, y0, z), texel(x1, y0, z), tx);
+            const float b = Lerp(texel(x0, y1, z), texel(x1, y1, z), tx);
+
+            return Lerp(a, b, ty);
+        };
+
+    return Lerp(bilinear(z0), bilinear(z1), tz);
+}
\ No newline at end of file
@@ -0,0 +1,818 @@
+// C++ port of Common/BSDF.hlsli for rendering on the CPU. Names and conventions follow the
+// shader so that the two can be compared side by side -- changes to one should be reflected
+// in the other.
+//
+// Refs:
+// 1. M. Pharr, W. Jakob, and G. Humphreys, Physically Based Rendering: From theory to implementation, Morgan Kaufmann, 2016.
+// 2. E. Heitz, "Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs," Journal of Computer Graphics Techniques, 2014.
+// 3. B. Walter, S.R. Marschner1, H. Li, K.E. Torrance, "Microfacet Models for Refraction through Rough Surfaces," in EGSR'07, 2007.
+// 4. Autodesk Standard Surface: https://autodesk.github.io/standard-surface/.
+// 5. OpenPBR Surface: https://academysoftwarefoundation.github.io/OpenPBR
+
+#pragma once
+
+#include "../Core/Material.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+// Conventions (same as the shader):
+//
+//  - All directions point out of the surface
+//  - Normal is assumed to be on the same side as wo
+//  - "metallic" property is binary
+//  - alpha = roughness^2
+//  - eta = eta_i / eta_t
+
+namespace ZetaRay::RT::BSDF
+{
+    // To check against (almost) perfect specular reflection or transmission.
+    static constexpr float MIN_N_DOT_H_SPECULAR = 0.99998f;
+    // Maximum alpha to treat surface as specular
+    static constexpr float MAX_ALPHA_SPECULAR = 0.0016f;
+
+    //--------------------------------------------------------------------------------------
+    // Directional albedo of dielectric microfacet BRDF (Assets/LUT/rho.dds)
+    //--------------------------------------------------------------------------------------
+
+    struct RhoLUT
+    {
+        // x: n.wo, y: alpha, z: eta
+        static constexpr uint32_t WIDTH = 64;
+        static constexpr uint32_t HEIGHT = 32;
+        static constexpr uint32_t DEPTH = 16;
+
+        // Expects WIDTH * HEIGHT * DEPTH UNORM16 texels
+        void Init(Util::Span<uint16_t> texels);
+        // Returns false when file doesn't exist or has an unexpected format
+        bool Load(const char* path);
+        // Integrates the LUT numerically, for when the DDS isn't available. Every texel uses
+        // sqrtNumSamples^2 stratified visible-normal samples.
+        void Compute(uint32_t sqrtNumSamples = 16);
+        // Trilinear filtering with clamp addressing, matches SampleLevel(g_samLinearClamp, uvw, 0)
+        float Sample(float u, float v, float w) const;
+        ZetaInline bool IsLoaded() const { return !m_texels.empty(); }
+
+    private:
+        Util::SmallVector<float> m_texels;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Helpers
+    //--------------------------------------------------------------------------------------
+
+    ZetaInline float Saturate(float x)
+    {
+        return Math::Min(Math::Max(x, 0.0f), 1.0f);
+    }
+
+    ZetaInline float Lerp(float a, float b, float t)
+    {
+        return std::fmaf(t, b - a, a);
+    }
+
+    ZetaInline Math::float3 Lerp(const Math::float3& a, const Math::float3& b, float t)
+    {
+        return a + t * (b - a);
+    }
+
+    ZetaInline Math::float3 Normalize(Math::float3 v)
+    {
+        v.normalize();
+        return v;
+    }
+
+    ZetaInline float Luminance(const Math::float3& rgb)
+    {
+        return rgb.dot(Math::float3(0.2126f, 0.7152f, 0.0722f));
+    }
+
+    // Same as HLSL reflect()
+    ZetaInline Math::float3 Reflect(const Math::float3& w, const Math::float3& n)
+    {
+        return w - 2.0f * w.dot(n) * n;
+    }
+
+    // Same as HLSL refract() -- returns zero in case of TIR
+    ZetaInline Math::float3 Refract(const Math::float3& w, const Math::float3& n, float eta)
+    {
+        const float ndotw = n.dot(w);
+        const float k = 1.0f - eta * eta * (1.0f - ndotw * ndotw);
+        if (k < 0)
+            return Math::float3(0.0f);
+
+        return eta * w - (eta * ndotw + sqrtf(k)) * n;
+    }
+
+    struct CoordinateSystem
+    {
+        static CoordinateSystem Build(const Math::float3& n)
+        {
+            const float s = n.z >= 0 ? 1.0f : -1.0f;
+            const float a = -1.0f / (s + n.z);
+            const float b = n.x * n.y * a;
+
+            CoordinateSystem ret;
+            ret.b1 = Math::float3(std::fmaf(n.x * a, n.x * s, 1.0f), s * b, -s * n.x);
+            ret.b2 = Math::float3(b, std::fmaf(n.y * a, n.y, s), -n.y);
+
+            return ret;
+        }
+
+        Math::float3 b1;
+        Math::float3 b2;
+    };
+
+    ZetaInline Math::float3 SampleCosineWeightedHemisphere(Math::float2 u, float& pdf)
+    {
+        const float phi = Math::TWO_PI * u.y;
+        const float sinTheta = sqrtf(u.x);
+        const float z = sqrtf(1.0f - u.x);
+        pdf = z * Math::ONE_OVER_PI;
+
+        return Math::float3(cosf(phi) * sinTheta, sinf(phi) * sinTheta, z);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Fresnel
+    //--------------------------------------------------------------------------------------
+
+    ZetaInline float DielectricF0(float eta)
+    {
+        float f0 = (eta - 1) / (eta + 1);
+        return f0 * f0;
+    }
+
+    ZetaInline Math::float3 FresnelSchlick(const Math::float3& F0, float whdotwx)
+    {
+        float tmp = 1.0f - whdotwx;
+        float tmpSq = tmp * tmp;
+        return tmpSq * tmpSq * tmp * (1.0f - F0) + F0;
+    }
+
+    ZetaInline float FresnelSchlick_Dielectric(float F0, float whdotwx)
+    {
+        float tmp = 1.0f - whdotwx;
+        float tmpSq = tmp * tmp;
+        return std::fmaf(tmpSq * tmpSq * tmp, 1 - F0, F0);
+    }
+
+    ZetaInline float Fresnel_Dielectric(float ndotwi, float eta, float cosTheta_t)
+    {
+        float r_parallel = std::fmaf(-eta, cosTheta_t, ndotwi) / std::fmaf(eta, cosTheta_t, ndotwi);
+        float r_perp = std::fmaf(eta, ndotwi, -cosTheta_t) / std::fmaf(eta, ndotwi, cosTheta_t);
+
+        return 0.5f * (r_parallel * r_parallel + r_perp * r_perp);
+    }
+
+    // eta = eta_i / eta_t
+    ZetaInline float Fresnel_Dielectric(float ndotwi, float eta)
+    {
+        float sinTheta_iSq = Saturate(std::fmaf(-ndotwi, ndotwi, 1.0f));
+        float cosTheta_tSq = std::fmaf(-eta * eta, sinTheta_iSq, 1.0f);
+
+        // TIR
+        if (cosTheta_tSq <= 0)
+            return 1;
+
+        return Fresnel_Dielectric(ndotwi, eta, sqrtf(cosTheta_tSq));
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Microfacet distribution and shadowing-masking
+    //--------------------------------------------------------------------------------------
+
+    ZetaInline float GGX(float ndotwh, float alphaSq)
+    {
+        float denom = std::fmaf(ndotwh * ndotwh, alphaSq - 1.0f, 1.0f);
+        return alphaSq / (Math::PI * denom * denom);
+    }
+
+    ZetaInline float SmithG1(float alphaSq, float ndotx)
+    {
+        float ndotxSq = ndotx * ndotx;
+        float tanThetaSq = (1.0f - ndotxSq) / ndotxSq;
+        return 2.0f / (sqrtf(std::fmaf(alphaSq, tanThetaSq, 1.0f)) + 1.0f);
+    }
+
+    // G2 / (n * ndotwi * ndotwo) for n = 1 (BRDF) and n = 4 (BTDF)
+    template<int n>
+    ZetaInline float SmithHeightCorrelatedG2_Opt(float alphaSq, float ndotwi, float ndotwo)
+    {
+        float denomWo = ndotwi * sqrtf(std::fmaf(std::fmaf(-ndotwo, alphaSq, ndotwo), ndotwo, alphaSq));
+        float denomWi = ndotwo * sqrtf(std::fmaf(std::fmaf(-ndotwi, alphaSq, ndotwi), ndotwi, alphaSq));
+
+        return (0.5f * n) / (denomWo + denomWi);
+    }
+
+    ZetaInline float SmithHeightCorrelatedG2OverG1(float alphaSq, float ndotwi, float ndotwo)
+    {
+        float G1wi = SmithG1(alphaSq, ndotwi);
+        float G1wo = SmithG1(alphaSq, ndotwo);
+
+        return G1wi / (G1wi + G1wo - G1wi * G1wo);
+    }
+
+    ZetaInline float GGXReflectance_Dielectric(const RhoLUT& lut, float alpha, float ndotwo, float eta)
+    {
+        float rho = lut.Sample(ndotwo, (alpha - 0.002025f) / (1.0f - 0.002025f),
+            (eta - 0.5f) / (1.99f - 0.5f));
+
+        return Saturate(rho);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Diffuse
+    //--------------------------------------------------------------------------------------
+
+    ZetaInline float OrenNayar_G(float cosTheta)
+    {
+        float sinThetaSq = Saturate(1 - cosTheta * cosTheta);
+        float sinTheta = sqrtf(sinThetaSq);
+        float theta = acosf(cosTheta);
+        float tanTheta = sinTheta / cosTheta;
+        float multiplier_sin = std::fmaf(-sinTheta, cosTheta, theta - (2.0f / 3.0f));
+        float multiplier_tan = (2.0f / 3.0f) * std::fmaf(-sinTheta, sinThetaSq, 1.0f);
+
+        return sinTheta * multiplier_sin + tanTheta * multiplier_tan;
+    }
+
+    ZetaInline float E_FON_approx(float cosTheta, float roughness)
+    {
+        float mucomp = 1.0f - cosTheta;
+        float mucomp2 = mucomp * mucomp;
+        float qx = 0.0571085289f * mucomp + 0.491881867f * mucomp2;
+        float qy = -0.332181442f * mucomp + 0.0714429953f * mucomp2;
+        float GoverPi = qx + qy * mucomp2;
+
+        return std::fmaf(roughness, GoverPi, 1.0f) / std::fmaf(0.287793398f, roughness, 1.0f);
+    }
+
+    template<bool AccountForMultiScattering>
+    Math::float3 OrenNayar(const Math::float3& rho, float sigma, float ndotwo, float ndotwi,
+        float wodotwi, float g_wo)
+    {
+        // Reduces to Lambertian
+        if (sigma == 0)
+            return Math::ONE_OVER_PI * ndotwi * rho;
+
+        float A = 1.0f / std::fmaf(0.287793398f, sigma, 1.0f);
+        float B = sigma * A;
+        float s_over_t = std::fmaf(-ndotwi, ndotwo, wodotwi);
+        s_over_t = s_over_t > 0 ? s_over_t / Math::Max(ndotwi, ndotwo) : s_over_t;
+        Math::float3 f(Math::ONE_OVER_PI * std::fmaf(B, s_over_t, A));
+        Math::float3 f_comp(0.0f);
+
+        if constexpr (AccountForMultiScattering)
+        {
+            float avgReflectance = std::fmaf(0.0724882111f, B, A);
+            float one_min_avgReflectance = 1 - avgReflectance;
+            float tmp = Math::ONE_OVER_PI * (avgReflectance / one_min_avgReflectance);
+            Math::float3 rho_ms_over_piSq = tmp / (1.0f - rho * one_min_avgReflectance);
+            rho_ms_over_piSq *= rho;
+
+            float E_wo = g_wo;
+            float E_wi = E_FON_approx(ndotwi, sigma);
+            f_comp = (1 - E_wo) * (1 - E_wi) * rho_ms_over_piSq;
+        }
+
+        return ndotwi * (f + f_comp) * rho;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Microfacet models
+    //--------------------------------------------------------------------------------------
+
+    // Includes multiplication by n.wi. For specular surfaces, returns the weight of the
+    // delta distribution (n.wi cancels out).
+    ZetaInline Math::float3 GGXMicrofacetBRDF(float alpha, float ndotwh, float ndotwo, float ndotwi,
+        const Math::float3& fr, bool specular)
+    {
+        if (specular)
+            return (ndotwh >= MIN_N_DOT_H_SPECULAR) * fr;
+
+        float alphaSq = alpha * alpha;
+        float NDF = GGX(ndotwh, alphaSq);
+        float G2DivDenom = SmithHeightCorrelatedG2_Opt<1>(alphaSq, ndotwi, ndotwo);
+
+        return (NDF * G2DivDenom * ndotwi) * fr;
+    }
+
+    ZetaInline float JacobianHalfVecToIncident_Tr(float eta, float whdotwo, float whdotwi)
+    {
+        float denom = std::fmaf(whdotwo, 1 / eta, whdotwi);
+        denom *= denom;
+
+        return whdotwi / denom;
+    }
+
+    // Includes multiplication by n.wi
+    ZetaInline float GGXMicrofacetBTDF(float alpha, float ndotwh, float ndotwo, float ndotwi,
+        float whdotwo, float whdotwi, float eta, float fr, bool specular)
+    {
+        if (specular)
+            return (ndotwh >= MIN_N_DOT_H_SPECULAR) * (1 - fr);
+
+        float alphaSq = alpha * alpha;
+        float NDF = GGX(ndotwh, alphaSq);
+        float G2opt = SmithHeightCorrelatedG2_Opt<4>(alphaSq, ndotwi, ndotwo);
+
+        float f = NDF * G2opt * whdotwo;
+        f *= JacobianHalfVecToIncident_Tr(eta, whdotwo, whdotwi);
+        f *= ndotwi;
+
+        return f * (1 - fr);
+    }
+
+    // Ref: J. Dupuy and A. Benyoub, "Sampling Visible GGX Normals with Spherical Caps,"
+    // High Performance Graphics, 2023.
+    ZetaInline Math::float3 SampleGGXVNDF(const Math::float3& wo, float alpha_x, float alpha_y,
+        Math::float2 u)
+    {
+        Math::float3 Vh = Normalize(Math::float3(alpha_x * wo.x, alpha_y * wo.y, wo.z));
+
+        // Sample a spherical cap in (-Vh.z, 1]
+        float phi = Math::TWO_PI * u.x;
+        float z = std::fmaf((1.0f - u.y), (1.0f + Vh.z), -Vh.z);
+        float sinTheta = sqrtf(Saturate(1.0f - z * z));
+        Math::float3 c(sinTheta * cosf(phi), sinTheta * sinf(phi), z);
+
+        Math::float3 Nh = c + Vh;
+
+        return Normalize(Math::float3(alpha_x * Nh.x, alpha_y * Nh.y, Math::Max(0.0f, Nh.z)));
+    }
+
+    ZetaInline Math::float3 SampleGGXMicrofacet(const Math::float3& wo, float alpha,
+        const Math::float3& shadingNormal, Math::float2 u)
+    {
+        CoordinateSystem onb = CoordinateSystem::Build(shadingNormal);
+        Math::float3 woLocal(onb.b1.dot(wo), onb.b2.dot(wo), shadingNormal.dot(wo));
+        Math::float3 whLocal = SampleGGXVNDF(woLocal, alpha, alpha, u);
+
+        return whLocal.x * onb.b1 + whLocal.y * onb.b2 + whLocal.z * shadingNormal;
+    }
+
+    // = D(w_h) / w_o.w_h
+    ZetaInline float GGXMicrofacetPdf(float alpha, float ndotwh, float ndotwo)
+    {
+        float alphaSq = alpha * alpha;
+        float NDF = GGX(ndotwh, alphaSq);
+        float G1 = SmithG1(alphaSq, ndotwo);
+
+        return (NDF * G1) / ndotwo;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Data needed for BSDF evaluation
+    //--------------------------------------------------------------------------------------
+
+    struct ShadingData
+    {
+        static ShadingData Init(const RhoLUT& rho, const Math::float3& shadingNormal,
+            const Math::float3& wo, bool metallic, float roughness, const Math::float3& baseColor,
+            float eta_curr = ETA_AIR, float eta_next = DEFAULT_ETA_MAT, bool specTr = false,
+            float transmissionDepth = 0, float subsurface = 0, float coat_weight = 0,
+            const Math::float3& coat_color = Math::float3(0.0f), float coat_roughness = 0,
+            float eta_coat = DEFAULT_ETA_COAT)
+        {
+            // Coat roughening
+            if (coat_weight > 0 && coat_roughness > 0)
+            {
+                float r4 = roughness * roughness;
+                r4 *= r4;
+                float c4 = coat_roughness * coat_roughness;
+                c4 *= c4;
+                float roughness_coated = Math::Min(r4 + 2 * c4, 1.0f);
+                roughness_coated = sqrtf(sqrtf(roughness_coated));
+                roughness = Lerp(roughness, roughness_coated, coat_weight);
+            }
+
+            ShadingData si;
+            si.rho = &rho;
+            si.wo = wo;
+            float ndotwo = shadingNormal.dot(wo);
+            si.backfacing_wo = ndotwo <= 0;
+            // Clamp to a small value to avoid division by zero
+            si.ndotwo = Math::Max(ndotwo, 1e-5f);
+
+            si.metallic = metallic;
+            si.alpha = roughness * roughness;
+            si.baseColor_Fr0_TrCol = baseColor;
+            si.specTr = specTr;
+            si.trDepth = transmissionDepth;
+            si.subsurface = subsurface;
+            float eta_base = eta_curr == ETA_AIR ? eta_next : eta_curr;
+            float eta_no_coat = eta_next / eta_curr;
+            // To avoid spurious TIR
+            float eta_coated = eta_base >= eta_coat ? eta_base / eta_coat : eta_coat / eta_base;
+            si.eta = Lerp(eta_no_coat, eta_coated, coat_weight);
+
+            si.g_wo = !metallic && !specTr ? E_FON_approx(Math::Max(ndotwo, 1e-4f), roughness) : 0;
+
+            si.coat_weight = coat_weight;
+            si.coat_color = coat_color;
+            si.coat_alpha = coat_roughness * coat_roughness;
+            si.coat_eta = eta_curr == ETA_AIR ? eta_coat / ETA_AIR : ETA_AIR / eta_coat;
+
+            si.ndotwi = 0;
+            si.ndotwh = 0;
+            si.whdotwi = 0;
+            si.whdotwo = 0;
+            si.wodotwi = 0;
+            si.invalid = true;
+            si.reflection = true;
+
+            return si;
+        }
+
+        void SetWi_Refl(const Math::float3& wi, const Math::float3& shadingNormal, const Math::float3& wh)
+        {
+            reflection = true;
+
+            float ndotwi_n = shadingNormal.dot(wi);
+            ndotwh = Saturate(shadingNormal.dot(wh));
+            whdotwo = Saturate(wh.dot(wo));
+            whdotwi = whdotwo;
+
+            bool isInvalid = backfacing_wo || ndotwh == 0 || whdotwo == 0;
+            invalid = isInvalid || ndotwi_n <= 0;
+
+            ndotwi = Math::Max(ndotwi_n, 1e-5f);
+            wodotwi = wo.dot(wi);
+        }
+
+        void SetWi_Refl(const Math::float3& wi, const Math::float3& shadingNormal)
+        {
+            SetWi_Refl(wi, shadingNormal, Normalize(wi + wo));
+        }
+
+        void SetWi_Tr(const Math::float3& wi, const Math::float3& shadingNormal, const Math::float3& wh)
+        {
+            reflection = false;
+
+            float ndotwi_n = shadingNormal.dot(wi);
+            ndotwh = Saturate(shadingNormal.dot(wh));
+            whdotwo = Saturate(wh.dot(wo));
+            whdotwi = fabsf(wh.dot(wi));
+
+            bool isInvalid = backfacing_wo || (specTr && (ndotwh == 0 || whdotwo == 0));
+            invalid = isInvalid || ndotwi_n >= 0 || !Transmissive() || metallic;
+
+            ndotwi = Math::Max(fabsf(ndotwi_n), 1e-5f);
+            wodotwi = wo.dot(wi);
+        }
+
+        void SetWi_Tr(const Math::float3& wi, const Math::float3& shadingNormal)
+        {
+            Math::float3 wh = Normalize(eta * wi + wo);
+            wh = eta > 1 ? -wh : wh;
+            SetWi_Tr(wi, shadingNormal, wh);
+        }
+
+        void SetWi(const Math::float3& wi, const Math::float3& shadingNormal, const Math::float3& wh)
+        {
+            float ndotwi_n = shadingNormal.dot(wi);
+            reflection = ndotwi_n >= 0;
+
+            // Backfacing half vectors are invalid
+            ndotwh = Saturate(shadingNormal.dot(wh));
+            whdotwo = Saturate(wh.dot(wo));
+
+            bool backfacing_r = ndotwi_n <= 0;
+            bool backfacing_t = ndotwi_n >= 0 || !Transmissive() || metallic;
+
+            bool isInvalid = backfacing_wo || (specTr && (ndotwh == 0 || whdotwo == 0));
+            invalid = isInvalid || (reflection && backfacing_r) || (!reflection && backfacing_t);
+
+            ndotwi = Math::Max(fabsf(ndotwi_n), 1e-5f);
+            whdotwi = fabsf(wh.dot(wi));
+            wodotwi = wo.dot(wi);
+        }
+
+        Math::float3 SetWi(const Math::float3& wi, const Math::float3& shadingNormal)
+        {
+            float ndotwi_n = shadingNormal.dot(wi);
+            reflection = ndotwi_n >= 0;
+
+            float s = reflection ? 1 : eta;
+            Math::float3 wh = Normalize(s * wi + wo);
+            wh = !reflection && eta > 1 ? -wh : wh;
+            SetWi(wi, shadingNormal, wh);
+
+            return wh;
+        }
+
+        Math::float3 Fresnel(const Math::float3& fr0, bool& tir) const
+        {
+            float cosTheta_i = whdotwo;
+            tir = false;
+
+            // Use Schlick's approximation for metals
+            if (metallic)
+                return FresnelSchlick(fr0, cosTheta_i);
+
+            float eta_relative = 1.0f / eta;
+            float sinTheta_iSq = Saturate(std::fmaf(-cosTheta_i, cosTheta_i, 1.0f));
+            float cosTheta_tSq = std::fmaf(-eta_relative * eta_relative, sinTheta_iSq, 1.0f);
+
+            tir = cosTheta_tSq <= 0;
+            if (tir)
+                return Math::float3(1.0f);
+
+            return Math::float3(Fresnel_Dielectric(cosTheta_i, eta_relative, sqrtf(cosTheta_tSq)));
+        }
+
+        Math::float3 Fresnel() const
+        {
+            Math::float3 fr0 = metallic ? baseColor_Fr0_TrCol : Math::float3(DielectricF0(eta));
+            bool unused;
+
+            return Fresnel(fr0, unused);
+        }
+
+        float Fresnel_Coat(float& cosTheta_t) const
+        {
+            cosTheta_t = 0;
+            float cosTheta_i = whdotwo;
+            float eta_relative = 1.0f / coat_eta;
+            float sinTheta_iSq = Saturate(std::fmaf(-cosTheta_i, cosTheta_i, 1.0f));
+            float cosTheta_tSq = std::fmaf(-eta_relative * eta_relative, sinTheta_iSq, 1.0f);
+
+            // Check for TIR
+            if (cosTheta_tSq <= 0)
+                return 1;
+
+            cosTheta_t = sqrtf(cosTheta_tSq);
+            float Fr0 = DielectricF0(coat_eta);
+            float cosTheta = coat_eta > 1 ? cosTheta_i : cosTheta_t;
+
+            return FresnelSchlick_Dielectric(Fr0, cosTheta);
+        }
+
+        ZetaInline Math::float3 TransmissionTint() const { return trDepth > 0 ? Math::float3(1.0f) : baseColor_Fr0_TrCol; }
+        ZetaInline bool ThinWalled() const { return subsurface > 0; }
+        ZetaInline bool Transmissive() const { return specTr || ThinWalled(); }
+        ZetaInline bool Coated() const { return coat_weight != 0; }
+        ZetaInline bool GlossSpecular() const { return alpha <= MAX_ALPHA_SPECULAR; }
+        ZetaInline bool CoatSpecular() const { return coat_alpha <= MAX_ALPHA_SPECULAR; }
+
+        const RhoLUT* rho;
+        float alpha;
+        Math::float3 wo;
+        float ndotwi;
+        float ndotwo;
+        float ndotwh;
+        float whdotwi;
+        float whdotwo;
+        float wodotwi;
+        float g_wo;
+        // Union of:
+        //  - Base color for dielectrics
+        //  - Fresnel at normal incidence for metals
+        //  - Transmission color for dielectrics with specular transmission
+        Math::float3 baseColor_Fr0_TrCol;
+        float eta;
+        bool specTr;
+        bool metallic;
+        bool backfacing_wo;
+        bool invalid;
+        bool reflection;
+        float trDepth;
+        float subsurface;
+        float coat_weight;
+        Math::float3 coat_color;
+        float coat_alpha;
+        float coat_eta;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Lobes
+    //--------------------------------------------------------------------------------------
+
+    // Includes multiplication by n.wi
+    template<bool EON>
+    ZetaInline Math::float3 EvalDiffuse(const ShadingData& surface)
+    {
+        float s = surface.subsurface == 0 ? 1 : surface.subsurface * 0.5f;
+        float diffuseRoughness = sqrtf(surface.alpha);
+        Math::float3 diffuse = OrenNayar<EON>(surface.baseColor_Fr0_TrCol, diffuseRoughness,
+            surface.ndotwo, surface.ndotwi, surface.wodotwi, surface.g_wo);
+
+        return s * diffuse;
+    }
+
+    ZetaInline Math::float3 SampleDiffuse(const Math::float3& normal, Math::float2 u, float& pdf)
+    {
+        Math::float3 wiLocal = SampleCosineWeightedHemisphere(u, pdf);
+        CoordinateSystem onb = CoordinateSystem::Build(normal);
+
+        return wiLocal.x * onb.b1 + wiLocal.y * onb.b2 + wiLocal.z * normal;
+    }
+
+    ZetaInline float DiffusePdf(const ShadingData& surface)
+    {
+        return surface.ndotwi * Math::ONE_OVER_PI;
+    }
+
+    ZetaInline Math::float3 EvalGloss(const ShadingData& surface, const Math::float3& fr)
+    {
+        return GGXMicrofacetBRDF(surface.alpha, surface.ndotwh, surface.ndotwo, surface.ndotwi,
+            fr, surface.GlossSpecular());
+    }
+
+    ZetaInline Math::float3 SampleGloss(const ShadingData& surface, const Math::float3& shadingNormal,
+        Math::float2 u)
+    {
+        if (surface.GlossSpecular())
+            return Reflect(-surface.wo, shadingNormal);
+
+        Math::float3 wh = SampleGGXMicrofacet(surface.wo, surface.alpha, shadingNormal, u);
+        return Reflect(-surface.wo, wh);
+    }
+
+    ZetaInline float GlossPdf(const ShadingData& surface)
+    {
+        if (surface.GlossSpecular())
+            return surface.ndotwh >= MIN_N_DOT_H_SPECULAR;
+
+        return GGXMicrofacetPdf(surface.alpha, surface.ndotwh, surface.ndotwo) / 4.0f;
+    }
+
+    ZetaInline float EvalTranslucentTr(const ShadingData& surface, float fr)
+    {
+        return GGXMicrofacetBTDF(surface.alpha, surface.ndotwh, surface.ndotwo, surface.ndotwi,
+            surface.whdotwo, surface.whdotwi, surface.eta, fr, surface.GlossSpecular());
+    }
+
+    ZetaInline Math::float3 SampleTranslucentTr(const ShadingData& surface,
+        const Math::float3& shadingNormal, Math::float2 u)
+    {
+        if (surface.GlossSpecular())
+            return Refract(-surface.wo, shadingNormal, 1 / surface.eta);
+
+        Math::float3 wh = SampleGGXMicrofacet(surface.wo, surface.alpha, shadingNormal, u);
+        return Refract(-surface.wo, wh, 1 / surface.eta);
+    }
+
+    ZetaInline float TranslucentTrPdf(const ShadingData& surface)
+    {
+        if (surface.GlossSpecular())
+            return surface.ndotwh >= MIN_N_DOT_H_SPECULAR;
+
+        float pdf = GGXMicrofacetPdf(surface.alpha, surface.ndotwh, surface.ndotwo);
+        pdf *= surface.whdotwo;
+        pdf *= JacobianHalfVecToIncident_Tr(surface.eta, surface.whdotwo, surface.whdotwi);
+
+        return pdf;
+    }
+
+    ZetaInline float EvalCoat(const ShadingData& surface, float Fr)
+    {
+        return surface.coat_weight * GGXMicrofacetBRDF(surface.coat_alpha, surface.ndotwh,
+            surface.ndotwo, surface.ndotwi, Math::float3(Fr), surface.CoatSpecular()).x;
+    }
+
+    ZetaInline Math::float3 SampleCoat(const ShadingData& surface, const Math::float3& shadingNormal,
+        Math::float2 u)
+    {
+        Math::float3 wh = surface.CoatSpecular() ? shadingNormal :
+            SampleGGXMicrofacet(surface.wo, surface.coat_alpha, shadingNormal, u);
+
+        return Reflect(-surface.wo, wh);
+    }
+
+    ZetaInline float CoatPdf(const ShadingData& surface)
+    {
+        if (surface.CoatSpecular())
+            return surface.ndotwh >= MIN_N_DOT_H_SPECULAR;
+
+        return GGXMicrofacetPdf(surface.coat_alpha, surface.ndotwh, surface.ndotwo) / 4.0f;
+    }
+
+    ZetaInline Math::float3 CoatTransmittance(const ShadingData& surface, float reflectance_c, float c)
+    {
+        // = coat_color^c
+        Math::float3 coat_tr(powf(surface.coat_color.x, c), powf(surface.coat_color.y, c),
+            powf(surface.coat_color.z, c));
+
+        // f = mix(base, layer(base, coat), coat_weight)
+        return Lerp(Math::float3(1.0f), (1 - reflectance_c) * coat_tr, surface.coat_weight);
+    }
+
+    ZetaInline Math::float3 BaseWeight(const ShadingData& surface)
+    {
+        if (!surface.Coated())
+            return Math::float3(1.0f);
+
+        float cosTheta_t;
+        float Fr_coat = surface.Fresnel_Coat(cosTheta_t);
+        if (cosTheta_t <= 0)
+            return Math::float3(0.0f);
+
+        float reflectance_c = surface.CoatSpecular() ? Fr_coat :
+            GGXReflectance_Dielectric(*surface.rho, surface.coat_alpha, surface.ndotwo, surface.coat_eta);
+
+        // View-dependent absorption
+        return CoatTransmittance(surface, reflectance_c, 0.5f / cosTheta_t + 0.5f / surface.whdotwo);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Surface shader
+    //--------------------------------------------------------------------------------------
+
+    struct BSDFEval
+    {
+        // Includes multiplication by n.wi
+        Math::float3 f = Math::float3(0.0f);
+        // Part of f that comes from specular lobes. These are delta distributions, so
+        // what's stored is the weight of the delta (the shader mixes the two).
+        Math::float3 f_delta = Math::float3(0.0f);
+        Math::float3 Fr_g = Math::float3(0.0f);
+        bool tir = false;
+    };
+
+    // Same as BSDF::Unified() in the shader with the specular part additionally kept
+    // separate in f_delta
+    inline BSDFEval Unified(const ShadingData& surface)
+    {
+        BSDFEval ret;
+        if (surface.invalid)
+            return ret;
+
+        // Coat
+        Math::float3 base_weight(1.0f);
+        if (surface.Coated())
+        {
+            float cosThetaT_o;
+            float Fr_coat = surface.Fresnel_Coat(cosThetaT_o);
+            bool tir_c = cosThetaT_o <= 0;
+
+            if (!surface.reflection && tir_c)
+                return ret;
+
+            if (surface.reflection)
+            {
+                ret.f = Math::float3(EvalCoat(surface, Fr_coat));
+                if (surface.CoatSpecular())
+                    ret.f_delta = ret.f;
+
+                if (tir_c)
+                    return ret;
+            }
+
+            float reflectance_c = surface.CoatSpecular() ? Fr_coat :
+                GGXReflectance_Dielectric(*surface.rho, surface.coat_alpha, surface.ndotwo, surface.coat_eta);
+            base_weight = CoatTransmittance(surface, reflectance_c, 1.0f / cosThetaT_o);
+        }
+
+        Math::float3 fr0 = surface.metallic ? surface.baseColor_Fr0_TrCol :
+            Math::float3(DielectricF0(surface.eta));
+        ret.Fr_g = surface.Fresnel(fr0, ret.tir);
+
+        Math::float3 glossyRefl = EvalGloss(surface, ret.Fr_g);
+        const bool glossSpecular = surface.GlossSpecular();
+
+        // Metal or TIR
+        if (surface.metallic || ret.tir)
+        {
+            ret.f += base_weight * glossyRefl;
+            if (glossSpecular)
+                ret.f_delta += base_weight * glossyRefl;
+
+            return ret;
+        }
+
+        float reflectance_g = glossSpecular ? ret.Fr_g.x :
+            GGXReflectance_Dielectric(*surface.rho, surface.alpha, surface.ndotwo, surface.eta);
+
+        // Opaque base, possibly in thin walled mode
+        if (!surface.specTr)
+        {
+            Math::float3 diffuse = EvalDiffuse<true>(surface);
+            Math::float3 gloss = surface.reflection ? base_weight * glossyRefl : Math::float3(0.0f);
+            ret.f += base_weight * ((1 - reflectance_g) * diffuse) + gloss;
+            if (glossSpecular)
+                ret.f_delta += gloss;
+
+            return ret;
+        }
+
+        // Translucent base
+        if (surface.reflection)
+        {
+            ret.f += glossyRefl * base_weight;
+            if (glossSpecular)
+                ret.f_delta += glossyRefl * base_weight;
+
+            return ret;
+        }
+
+        // For specular, (1 - Fresnel) factor is already accounted for
+        reflectance_g = glossSpecular ? 0 : reflectance_g;
+        float glossyTr = EvalTranslucentTr(surface, ret.Fr_g.x);
+        ret.f = ((1 - reflectance_g) * glossyTr * surface.TransmissionTint()) * base_weight;
+        if (glossSpecular)
+            ret.f_delta = ret.f;
+
+        return ret;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,761 @@
+#include "LightBVH.h"
+#include "../Support/MemoryReport.h"
+#include <algorithm>
+#include <functional>
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    // Largest float that is less than 1
+    static constexpr float ONE_MINUS_EPSILON = 0x1.fffffep-1;
+
+    ZetaInline float Component(const float3& v, int axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    ZetaInline float3 Min3(const float3& a, const float3& b)
+    {
+        return float3(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z));
+    }
+
+    ZetaInline float3 Max3(const float3& a, const float3& b)
+    {
+        return float3(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z));
+    }
+
+    ZetaInline float SafeSqrt(float x)
+    {
+        return sqrtf(Max(x, 0.0f));
+    }
+
+    // cos(max(0, a - b)) given sines and cosines of a and b
+    ZetaInline float CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+    {
+        if (cosA > cosB)
+            return 1.0f;
+
+        return cosA * cosB + sinA * sinB;
+    }
+
+    // sin(max(0, a - b)) given sines and cosines of a and b
+    ZetaInline float SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+    {
+        if (cosA > cosB)
+            return 0.0f;
+
+        return sinA * cosB - cosA * sinB;
+    }
+
+    // Smallest cone that contains both cones. Ref: [1]
+    void UnionCone(float3 axisA, float thetaA, float3 axisB, float thetaB, float3& axis, float& theta)
+    {
+        // Make a the wider cone
+        if (thetaA < thetaB)
+        {
+            std::swap(axisA, axisB);
+            std::swap(thetaA, thetaB);
+        }
+
+        if (thetaA >= PI)
+        {
+            axis = axisA;
+            theta = PI;
+
+            return;
+        }
+
+        const float cosTheta_d = axisA.dot(axisB);
+        const float theta_d = acosf(Min(Max(cosTheta_d, -1.0f), 1.0f));
+
+        // a already contains b
+        if (Min(theta_d + thetaB, PI) <= thetaA)
+        {
+            axis = axisA;
+            theta = thetaA;
+
+            return;
+        }
+
+        const float theta_o = 0.5f * (thetaA + theta_d + thetaB);
+        if (theta_o >= PI)
+        {
+            axis = axisA;
+            theta = PI;
+
+            return;
+        }
+
+        // Rotate axis of a towards axis of b
+        float3 w = axisB - axisA * cosTheta_d;
+        const float wLen = w.length();
+
+        if (wLen <= 1e-7f)
+        {
+            axis = axisA;
+            theta = PI;
+
+            return;
+        }
+
+        w /= wLen;
+        const float theta_r = theta_o - thetaA;
+        axis = axisA * cosf(theta_r) + w * sinf(theta_r);
+        axis.normalize();
+        theta = theta_o;
+    }
+
+    ZetaInline LightBounds Union(const LightBounds& a, const LightBounds& b)
+    {
+        if (a.Empty())
+            return b;
+        if (b.Empty())
+            return a;
+
+        LightBounds ret;
+        ret.BoxMin = Min3(a.BoxMin, b.BoxMin);
+        ret.BoxMax = Max3(a.BoxMax, b.BoxMax);
+        ret.Power = a.Power + b.Power;
+
+        // Emitters without any power don't need to be bounded
+        if (a.Power == 0.0f || b.Power == 0.0f)
+        {
+            const LightBounds& c = a.Power == 0.0f ? b : a;
+            ret.Axis = c.Axis;
+            ret.Theta_o = c.Theta_o;
+            ret.Theta_e = c.Theta_e;
+
+            return ret;
+        }
+
+        UnionCone(a.Axis, a.Theta_o, b.Axis, b.Theta_o, ret.Axis, ret.Theta_o);
+        ret.Theta_e = Max(a.Theta_e, b.Theta_e);
+
+        return ret;
+    }
+
+    // Surface area orientation heuristic (SAOH). Ref: [1]
+    float Cost(const LightBounds& b, float Kr)
+    {
+        if (b.Empty())
+            return 0.0f;
+
+        const float theta_w = Min(b.Theta_o + b.Theta_e, PI);
+        const float sinTheta_o = sinf(b.Theta_o);
+        const float cosTheta_o = cosf(b.Theta_o);
+        const float M_omega = TWO_PI * (1.0f - cosTheta_o) +
+            0.5f * PI * (2.0f * theta_w * sinTheta_o - cosf(b.Theta_o - 2.0f * theta_w) -
+                2.0f * b.Theta_o * sinTheta_o + cosTheta_o);
+
+        const float3 d = b.BoxMax - b.BoxMin;
+        const float M_a = 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+
+        return b.Power * M_omega * M_a * Kr;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// LightImportance
+//--------------------------------------------------------------------------------------
+
+float RT::LightImportance(const LightBounds& bounds, const float3& p, const float3& n)
+{
+    if (bounds.Power == 0.0f)
+        return 0.0f;
+
+    const float3 center = 0.5f * (bounds.BoxMin + bounds.BoxMax);
+    const float3 toP = p - center;
+    const float radius2 = 0.25f * (bounds.BoxMax - bounds.BoxMin).dot(bounds.BoxMax - bounds.BoxMin);
+    const float dist2 = toP.dot(toP);
+
+    // Clamp the distance to avoid blowing up close to the emitters
+    const float d2 = Max(dist2, radius2);
+
+    // Direction from emitters to p
+    float3 wi = dist2 > 0.0f ? toP / sqrtf(dist2) : float3(0.0f, 0.0f, 1.0f);
+
+    const float cosTheta_w = bounds.Axis.dot(wi);
+    const float sinTheta_w = SafeSqrt(1.0f - cosTheta_w * cosTheta_w);
+
+    // Angle subtended by the bounding sphere
+    float cosTheta_b = -1.0f;
+    if (dist2 > radius2)
+        cosTheta_b = SafeSqrt(1.0f - radius2 / dist2);
+    const float sinTheta_b = SafeSqrt(1.0f - cosTheta_b * cosTheta_b);
+
+    // theta' = max(0, theta_w - theta_o - theta_b)
+    const float cosTheta_o = cosf(bounds.Theta_o);
+    const float sinTheta_o = sinf(bounds.Theta_o);
+    const float cosTheta_x = CosSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+    const float sinTheta_x = SinSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+    const float cosThetap = CosSubClamped(sinTheta_x, cosTheta_x, sinTheta_b, cosTheta_b);
+
+    if (cosThetap <= cosf(bounds.Theta_e))
+        return 0.0f;
+
+    float importance = bounds.Power * cosThetap / d2;
+
+    // Cosine at the shading point, (conservatively) accounting for the subtended angle
+    if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f)
+    {
+        const float cosTheta_i = fabsf(wi.dot(n));
+        const float sinTheta_i = SafeSqrt(1.0f - cosTheta_i * cosTheta_i);
+        importance *= CosSubClamped(sinTheta_i, cosTheta_i, sinTheta_b, cosTheta_b);
+    }
+
+    return Max(importance, 0.0f);
+}
+
+//--------------------------------------------------------------------------------------
+// LightBVH
+//--------------------------------------------------------------------------------------
+
+LightBounds LightBVH::TriangleBounds(EmissiveTriangle& tri, float power)
+{
+    __m128 vV0;
+    __m128 vV1;
+    __m128 vV2;
+    tri.LoadVertices(vV0, vV1, vV2);
+
+    const float3 v0 = storeFloat3(vV0);
+    const float3 v1 = storeFloat3(vV1);
+    const float3 v2 = storeFloat3(vV2);
+
+    LightBounds b;
+    b.BoxMin = Min3(v0, Min3(v1, v2));
+    b.BoxMax = Max3(v0, Max3(v1, v2));
+
+    float3 normal = (v1 - v0).cross(v2 - v0);
+    const float len = normal.length();
+    b.Axis = len > 0.0f ? normal / len : float3(0.0f, 0.0f, 1.0f);
+    // Double-sided emitters emit in all directions
+    b.Theta_o = tri.IsDoubleSided() ? PI : 0.0f;
+    b.Theta_e = PI_OVER_2;
+    b.Power = power;
+
+    return b;
+}
+
+LightBounds LightBVH::RangeBounds(uint32_t base, uint32_t count) const
+{
+    LightBounds b = LightBounds::Init();
+
+    for (uint32_t i = base; i < base + count; i++)
+        b = Union(b, m_prims[i].Bounds);
+
+    return b;
+}
+
+LightBounds LightBVH::RangeBox(uint32_t base, uint32_t count) const
+{
+    LightBounds b = LightBounds::Init();
+
+    for (uint32_t i = base; i < base + count; i++)
+    {
+        b.BoxMin = Min3(b.BoxMin, m_prims[i].Bounds.BoxMin);
+        b.BoxMax = Max3(b.BoxMax, m_prims[i].Bounds.BoxMax);
+    }
+
+    return b;
+}
+
+uint32_t LightBVH::Split(uint32_t base, uint32_t count, const LightBounds& bounds)
+{
+    float3 centroidMin(FLT_MAX);
+    float3 centroidMax(-FLT_MAX);
+
+    for (uint32_t i = base; i < base + count; i++)
+    {
+        centroidMin = Min3(centroidMin, m_prims[i].Centroid);
+        centroidMax = Max3(centroidMax, m_prims[i].Centroid);
+    }
+
+    const float3 boundsExtents = bounds.BoxMax - bounds.BoxMin;
+    const float maxExtent = Max(boundsExtents.x, Max(boundsExtents.y, boundsExtents.z));
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float cMin = Component(centroidMin, axis);
+        const float extent = Component(centroidMax, axis) - cMin;
+        if (extent <= 0.0f)
+            continue;
+
+        LightBounds bins[NUM_BINS];
+        for (uint32_t b = 0; b < NUM_BINS; b++)
+            bins[b] = LightBounds::Init();
+
+        const float scale = NUM_BINS / extent;
+
+        for (uint32_t i = base; i < base + count; i++)
+        {
+            const float c = Component(m_prims[i].Centroid, axis);
+            const uint32_t b = Min((uint32_t)((c - cMin) * scale), NUM_BINS - 1);
+            bins[b] = Union(bins[b], m_prims[i].Bounds);
+        }
+
+        // Penalize thin slabs
+        const float axisExtent = Component(boundsExtents, axis);
+        const float Kr = axisExtent > 0.0f ? maxExtent / axisExtent : 1.0f;
+
+        // Cost of right side for splits after each bin
+        float costRight[NUM_BINS];
+        LightBounds right = LightBounds::Init();
+
+        for (int b = NUM_BINS - 1; b > 0; b--)
+        {
+            right = Union(right, bins[b]);
+            costRight[b] = Cost(right, Kr);
+        }
+
+        LightBounds left = LightBounds::Init();
+
+        for (uint32_t b = 1; b < NUM_BINS; b++)
+        {
+            left = Union(left, bins[b - 1]);
+            const float cost = Cost(left, Kr) + costRight[b];
+
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    uint32_t mid = base;
+
+    if (bestAxis != -1)
+    {
+        const float cMin = Component(centroidMin, bestAxis);
+        const float scale = NUM_BINS / (Component(centroidMax, bestAxis) - cMin);
+
+        Prim* it = std::partition(m_prims.begin() + base, m_prims.begin() + base + count,
+            [cMin, scale, bestAxis, bestSplit](const Prim& p)
+            {
+                const float c = Component(p.Centroid, bestAxis);
+                return Min((uint32_t)((c - cMin) * scale), NUM_BINS - 1) < bestSplit;
+            });
+
+        mid = (uint32_t)(it - m_prims.begin());
+    }
+
+    // Either all centroids coincide or all primitives ended up on one side -- split in the middle
+    if (mid == base || mid == base + count)
+    {
+        int axis = 0;
+        const float3 d = centroidMax - centroidMin;
+        if (d.y > d.x && d.y >= d.z)
+            axis = 1;
+        else if (d.z > d.x && d.z > d.y)
+            axis = 2;
+
+        mid = base + count / 2;
+        std::nth_element(m_prims.begin() + base, m_prims.begin() + mid, m_prims.begin() + base + count,
+            [axis](const Prim& a, const Prim& b)
+            {
+                return Component(a.Centroid, axis) < Component(b.Centroid, axis);
+            });
+    }
+
+    return mid;
+}
+
+uint32_t LightBVH::BuildNode(SmallVector<Node>& nodes, uint32_t base, uint32_t count, int parent)
+{
+    const uint32_t idx = (uint32_t)nodes.size();
+
+    if (count <= MAX_NUM_PRIMS_PER_LEAF)
+    {
+        nodes.push_back(Node{ .Bounds = RangeBounds(base, count),
+            .Offset = base,
+            .Count = count,
+            .Parent = parent });
+
+        return idx;
+    }
+
+    nodes.push_back(Node{ .Bounds = LightBounds::Init(),
+        .Offset = base,
+        .Count = count,
+        .Parent = parent });
+
+    // Only spatial extents are needed for splitting, cone is computed from the children
+    const uint32_t mid = Split(base, count, RangeBox(base, count));
+    const uint32_t left = BuildNode(nodes, base, mid - base, (int)idx);
+    Assert(left == idx + 1, "Left child must immediately follow its parent.");
+
+    const uint32_t right = BuildNode(nodes, mid, base + count - mid, (int)idx);
+    nodes[idx].Offset = right;
+    nodes[idx].Count = 0;
+    // Union of cones isn't associative -- use the same order as refit and the top levels
+    nodes[idx].Bounds = Union(nodes[left].Bounds, nodes[right].Bounds);
+
+    return idx;
+}
+
+int LightBVH::BuildTop(uint32_t base, uint32_t count, int depth, int maxDepth)
+{
+    const int idx = (int)m_topNodes.size();
+
+    if (depth == maxDepth || count <= MIN_NUM_PRIMS_PER_SUBTREE)
+    {
+        Assert(m_numSubtrees < MAX_NUM_SUBTREES, "Number of subtrees exceeded maximum.");
+        Subtree& s = m_subtrees[m_numSubtrees];
+        s.Base = base;
+        s.Count = count;
+        s.Nodes.clear();
+
+        m_topNodes.push_back(TopNode{ .Left = -1, .Right = -1, .Subtree = m_numSubtrees++ });
+
+        return idx;
+    }
+
+    m_topNodes.push_back(TopNode{ .Left = -1, .Right = -1, .Subtree = -1 });
+
+    const uint32_t mid = Split(base, count, RangeBox(base, count));
+    const int left = BuildTop(base, mid - base, depth + 1, maxDepth);
+    const int right = BuildTop(mid, base + count - mid, depth + 1, maxDepth);
+
+    m_topNodes[idx].Left = left;
+    m_topNodes[idx].Right = right;
+
+    return idx;
+}
+
+int LightBVH::BeginBuild(Span<EmissiveTriangle> tris, Span<float> power, int maxNumSubtrees)
+{
+    Assert(tris.size() == power.size(), "Every triangle must have a power estimate.");
+    Assert(tris.size() < UINT32_MAX, "Invalid number of triangles.");
+    Assert(maxNumSubtrees > 0, "Invalid number of subtrees.");
+
+    const uint32_t N = (uint32_t)tris.size();
+    m_prims.resize(N);
+    m_numSubtrees = 0;
+    m_topNodes.clear();
+    m_topRoot = -1;
+
+    if (N == 0)
+        return 0;
+
+    for (uint32_t i = 0; i < N; i++)
+    {
+        m_prims[i].Bounds = TriangleBounds(const_cast<EmissiveTriangle&>(tris[i]), power[i]);
+        m_prims[i].Centroid = 0.5f * (m_prims[i].Bounds.BoxMin + m_prims[i].Bounds.BoxMax);
+        m_prims[i].TriIdx = i;
+    }
+
+    // Every level doubles the number of subtrees
+    int maxDepth = 0;
+    while ((2 << maxDepth) <= Min(maxNumSubtrees, MAX_NUM_SUBTREES))
+        maxDepth++;
+
+    m_topRoot = BuildTop(0, N, 0, maxDepth);
+
+    return m_numSubtrees;
+}
+
+void LightBVH::BuildSubtree(int i)
+{
+    Assert(i < m_numSubtrees, "Out-of-bound access.");
+    Subtree& s = m_subtrees[i];
+    BuildNode(s.Nodes, s.Base, s.Count, -1);
+}
+
+void LightBVH::Emit(int topNode, int parent)
+{
+    const TopNode& t = m_topNodes[topNode];
+
+    if (t.Subtree != -1)
+    {
+        const uint32_t base = (uint32_t)m_nodes.size();
+
+        for (auto node : m_subtrees[t.Subtree].Nodes)
+        {
+            if (!node.IsLeaf())
+                node.Offset += base;
+
+            node.Parent = node.Parent == -1 ? parent : node.Parent + (int)base;
+            m_nodes.push_back(node);
+        }
+
+        return;
+    }
+
+    const uint32_t idx = (uint32_t)m_nodes.size();
+    m_nodes.push_back(Node{ .Bounds = LightBounds::Init(),
+        .Offset = 0,
+        .Count = 0,
+        .Parent = parent });
+
+    Emit(t.Left, (int)idx);
+    m_nodes[idx].Offset = (uint32_t)m_nodes.size();
+    Emit(t.Right, (int)idx);
+
+    m_nodes[idx].Bounds = Union(m_nodes[idx + 1].Bounds, m_nodes[m_nodes[idx].Offset].Bounds);
+}
+
+void LightBVH::EndBuild()
+{
+    m_nodes.clear();
+    const uint32_t N = (uint32_t)m_prims.size();
+
+    if (m_topRoot != -1)
+        Emit(m_topRoot, -1);
+
+    for (int i = 0; i < m_numSubtrees; i++)
+        m_subtrees[i].Nodes.free_memory();
+
+    m_topNodes.free_memory();
+    m_numSubtrees = 0;
+    m_topRoot = -1;
+
+    m_primTris.resize(N);
+    m_triToPrim.resize(N);
+    m_primToLeaf.resize(N);
+
+    for (uint32_t i = 0; i < N; i++)
+    {
+        m_primTris[i] = m_prims[i].TriIdx;
+        m_triToPrim[m_prims[i].TriIdx] = i;
+    }
+
+    m_packed.resize(m_nodes.size());
+
+    for (uint32_t i = 0; i < (uint32_t)m_nodes.size(); i++)
+    {
+        const Node& node = m_nodes[i];
+
+        for (uint32_t p = node.Offset; node.IsLeaf() && p < node.Offset + node.Count; p++)
+            m_primToLeaf[p] = i;
+
+        Pack(i);
+    }
+
+    m_isDirty.resize(m_nodes.size());
+    memset(m_isDirty.data(), 0, m_isDirty.size());
+    m_dirtyNodes.clear();
+}
+
+void LightBVH::Build(Span<EmissiveTriangle> tris, Span<float> power)
+{
+    const int numSubtrees = BeginBuild(tris, power, 1);
+
+    for (int i = 0; i < numSubtrees; i++)
+        BuildSubtree(i);
+
+    EndBuild();
+}
+
+void LightBVH::Clear()
+{
+    m_prims.free_memory();
+    m_primTris.free_memory();
+    m_triToPrim.free_memory();
+    m_primToLeaf.free_memory();
+    m_nodes.free_memory();
+    m_packed.free_memory();
+    m_topNodes.free_memory();
+    m_dirtyNodes.free_memory();
+    m_isDirty.free_memory();
+
+    for (int i = 0; i < MAX_NUM_SUBTREES; i++)
+        m_subtrees[i].Nodes.free_memory();
+
+    m_numSubtrees = 0;
+    m_topRoot = -1;
+}
+
+void LightBVH::ReportMemory(Support::MemoryReport& report) const
+{
+    report.Add("LightBVH", "m_prims", m_prims);
+    report.Add("LightBVH", "m_primTris", m_primTris);
+    report.Add("LightBVH", "m_triToPrim", m_triToPrim);
+    report.Add("LightBVH", "m_primToLeaf", m_primToLeaf);
+    report.Add("LightBVH", "m_nodes", m_nodes);
+    report.Add("LightBVH", "m_packed", m_packed);
+    report.Add("LightBVH", "m_topNodes", m_topNodes);
+    report.Add("LightBVH", "m_dirtyNodes", m_dirtyNodes);
+    report.Add("LightBVH", "m_isDirty", m_isDirty);
+
+    for (int i = 0; i < MAX_NUM_SUBTREES; i++)
+        report.Add("LightBVH", "m_subtrees[].Nodes", m_subtrees[i].Nodes);
+}
+
+void LightBVH::Pack(uint32_t node)
+{
+    const Node& n = m_nodes[node];
+    LightBVHNode& packed = m_packed[node];
+
+    packed.BoxMin = n.Bounds.BoxMin;
+    packed.Offset = n.Offset;
+    packed.BoxMax = n.Bounds.BoxMax;
+    packed.Count = n.Count;
+    packed.Axis = oct32(n.Bounds.Axis);
+    packed.CosTheta_o = half(cosf(n.Bounds.Theta_o));
+    packed.CosTheta_e = half(cosf(n.Bounds.Theta_e));
+    packed.Power = n.Bounds.Power;
+    packed.Pad = 0;
+}
+
+void LightBVH::RefitPrims(Span<EmissiveTriangle> tris, Span<float> power, uint32_t base, uint32_t count)
+{
+    Assert(base + count <= m_triToPrim.size(), "Out-of-bound access.");
+
+    for (uint32_t t = base; t < base + count; t++)
+    {
+        const uint32_t p = m_triToPrim[t];
+        m_prims[p].Bounds = TriangleBounds(const_cast<EmissiveTriangle&>(tris[t]), power[t]);
+        m_prims[p].Centroid = 0.5f * (m_prims[p].Bounds.BoxMin + m_prims[p].Bounds.BoxMax);
+
+        // Mark every ancestor, stop once an already marked node is reached
+        int node = (int)m_primToLeaf[p];
+        while (node != -1 && !m_isDirty[node])
+        {
+            m_isDirty[node] = 1;
+            m_dirtyNodes.push_back((uint32_t)node);
+            node = m_nodes[node].Parent;
+        }
+    }
+}
+
+void LightBVH::UpdateNodeBounds(uint32_t node)
+{
+    Node& n = m_nodes[node];
+
+    if (n.IsLeaf())
+        n.Bounds = RangeBounds(n.Offset, n.Count);
+    else
+        n.Bounds = Union(m_nodes[node + 1].Bounds, m_nodes[n.Offset].Bounds);
+}
+
+void LightBVH::PropagateRefit()
+{
+    // Children always come after their parent
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end(), std::greater<uint32_t>());
+
+    for (auto node : m_dirtyNodes)
+    {
+        UpdateNodeBounds(node);
+        Pack(node);
+        m_isDirty[node] = 0;
+    }
+
+    m_dirtyNodes.clear();
+}
+
+uint32_t LightBVH::Sample(const float3& p, const float3& n, float u, float& pdf) const
+{
+    pdf = 0.0f;
+
+    if (m_nodes.empty())
+        return INVALID_TRI;
+
+    uint32_t node = 0;
+    float prob = 1.0f;
+
+    // Stochastic traversal -- at each level, pick a child proportional to its importance
+    // and remap u to [0, 1) for the next level
+    while (!m_nodes[node].IsLeaf())
+    {
+        const uint32_t left = node + 1;
+        const uint32_t right = m_nodes[node].Offset;
+        const float importanceL = LightImportance(m_nodes[left].Bounds, p, n);
+        const float importanceR = LightImportance(m_nodes[right].Bounds, p, n);
+
+        if (importanceL == 0.0f && importanceR == 0.0f)
+            return INVALID_TRI;
+
+        const float pLeft = importanceL / (importanceL + importanceR);
+
+        if (u < pLeft)
+        {
+            u = Min(u / pLeft, ONE_MINUS_EPSILON);
+            prob *= pLeft;
+            node = left;
+        }
+        else
+        {
+            u = Min((u - pLeft) / (1.0f - pLeft), ONE_MINUS_EPSILON);
+            prob *= 1.0f - pLeft;
+            node = right;
+        }
+    }
+
+    // Pick a primitive in the leaf proportional to its importance
+    const Node& leaf = m_nodes[node];
+    float importance[MAX_NUM_PRIMS_PER_LEAF];
+    float sum = 0.0f;
+
+    for (uint32_t i = 0; i < leaf.Count; i++)
+    {
+        importance[i] = LightImportance(m_prims[leaf.Offset + i].Bounds, p, n);
+        sum += importance[i];
+    }
+
+    if (sum == 0.0f)
+        return INVALID_TRI;
+
+    const float target = u * sum;
+    float cdf = 0.0f;
+    uint32_t selected = 0;
+
+    for (uint32_t i = 0; i < leaf.Count; i++)
+    {
+        if (importance[i] == 0.0f)
+            continue;
+
+        selected = i;
+        cdf += importance[i];
+
+        if (target < cdf)
+            break;
+    }
+
+    pdf = prob * importance[selected] / sum;
+
+    return m_prims[leaf.Offset + selected].TriIdx;
+}
+
+float LightBVH::Pdf(const float3& p, const float3& n, uint32_t triIdx) const
+{
+    Assert(triIdx < m_triToPrim.size(), "Out-of-bound access.");
+
+    const uint32_t prim = m_triToPrim[triIdx];
+    uint32_t node = m_primToLeaf[prim];
+    const Node& leaf = m_nodes[node];
+
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < leaf.Count; i++)
+        sum += LightImportance(m_prims[leaf.Offset + i].Bounds, p, n);
+
+    const float importance = LightImportance(m_prims[prim].Bounds, p, n);
+    if (importance == 0.0f)
+        return 0.0f;
+
+    float prob = importance / sum;
+
+    while (m_nodes[node].Parent != -1)
+    {
+        const uint32_t parent = (uint32_t)m_nodes[node].Parent;
+        const uint32_t sibling = node == parent + 1 ? m_nodes[parent].Offset : parent + 1;
+        const float importanceN = LightImportance(m_nodes[node].Bounds, p, n);
+        const float importanceS = LightImportance(m_nodes[sibling].Bounds, p, n);
+
+        if (importanceN == 0.0f)
+            return 0.0f;
+
+        prob *= importanceN / (importanceN + importanceS);
+        node = parent;
+    }
+
+    return prob;
+}
\ No newline at end of file
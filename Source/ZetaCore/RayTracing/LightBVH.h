@@ -0,0 +1,197 @@
+// References:
+// 1. A. Conty Estevez and C. Kulla, "Importance Sampling of Many Lights with Adaptive Tree Splitting,"
+//    Proceedings of the ACM on Computer Graphics and Interactive Techniques, 2018.
+// 2. M. Pharr, W. Jakob, and G. Humphreys, Physically Based Rendering: From theory to implementation, 4th ed.,
+//    MIT Press, 2023.
+
+#pragma once
+
+#include "RtCommon.h"
+#include "../Math/OctahedralVector.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    struct MemoryReport;
+}
+
+namespace ZetaRay::RT
+{
+    // Bounds of a set of emitters -- spatial bounds along with a cone that bounds their
+    // normals (Theta_o) and the directions they emit in around each normal (Theta_e)
+    struct LightBounds
+    {
+        static LightBounds Init()
+        {
+            LightBounds b;
+            b.BoxMin = Math::float3(FLT_MAX);
+            b.BoxMax = Math::float3(-FLT_MAX);
+            b.Axis = Math::float3(0.0f, 0.0f, 1.0f);
+            b.Theta_o = 0.0f;
+            b.Theta_e = 0.0f;
+            b.Power = 0.0f;
+
+            return b;
+        }
+
+        ZetaInline bool Empty() const { return BoxMin.x > BoxMax.x; }
+
+        Math::float3 BoxMin;
+        Math::float3 BoxMax;
+        Math::float3 Axis;
+        float Theta_o;
+        float Theta_e;
+        float Power;
+    };
+
+    // GPU layout, 48 bytes
+    struct LightBVHNode
+    {
+        Math::float3 BoxMin;
+        // Internal nodes: index of right child (left child immediately follows its parent)
+        // Leaves: offset of first primitive
+        uint32_t Offset;
+        Math::float3 BoxMax;
+        // Number of primitives for leaves, zero for internal nodes
+        uint32_t Count;
+        Math::oct32 Axis;
+        Math::half CosTheta_o;
+        Math::half CosTheta_e;
+        float Power;
+        uint32_t Pad;
+    };
+
+    static_assert(sizeof(LightBVHNode) == 48);
+
+    // Importance of a set of emitters bounded by given bounds for shading point p with normal n.
+    // Normal can be zero (e.g. for volumes).
+    float LightImportance(const LightBounds& bounds, const Math::float3& p, const Math::float3& n);
+
+    // Bounding volume hierarchy over emissive triangles for many-light sampling. Both spatial
+    // and directional bounds (cones) are used for building the tree (SAOH) and for
+    // estimating the contribution of each subtree during traversal.
+    //
+    // Build can be split among multiple threads:
+    //  1. BeginBuild(): builds top levels of the tree and returns the number of subtrees
+    //  2. BuildSubtree(i) for every subtree -- calls can run in parallel
+    //  3. EndBuild(): links the subtrees together and packs the nodes
+    struct LightBVH
+    {
+        static constexpr int MAX_NUM_SUBTREES = 8;
+        static constexpr uint32_t INVALID_TRI = UINT32_MAX;
+
+        LightBVH() = default;
+        ~LightBVH() = default;
+
+        LightBVH(const LightBVH&) = delete;
+        LightBVH& operator=(const LightBVH&) = delete;
+
+        // Triangles are expected to be in world space. power[i] is the (estimated) power of
+        // tris[i]. Both need to stay valid until EndBuild() is called.
+        int BeginBuild(Util::Span<EmissiveTriangle> tris, Util::Span<float> power, int maxNumSubtrees);
+        void BuildSubtree(int i);
+        void EndBuild();
+        // Single-threaded build
+        void Build(Util::Span<EmissiveTriangle> tris, Util::Span<float> power);
+        void Clear();
+
+        // Updates the tree after triangles in given ranges moved or had their power changed.
+        // Topology remains the same, so quality degrades with large movements. RangeT must
+        // have Base and Count members.
+        template<typename RangeT>
+        void Refit(Util::Span<EmissiveTriangle> tris, Util::Span<float> power, Util::Span<RangeT> ranges)
+        {
+            for (auto& r : ranges)
+                RefitPrims(tris, power, r.Base, r.Count);
+
+            PropagateRefit();
+        }
+
+        // Samples an emissive triangle for shading point p with normal n using u in [0, 1).
+        // Returns INVALID_TRI when no triangle can contribute.
+        uint32_t Sample(const Math::float3& p, const Math::float3& n, float u, float& pdf) const;
+        // Probability of sampling given triangle for shading point p with normal n
+        float Pdf(const Math::float3& p, const Math::float3& n, uint32_t triIdx) const;
+        void ReportMemory(Support::MemoryReport& report) const;
+
+        ZetaInline bool IsBuilt() const { return !m_nodes.empty(); }
+        ZetaInline uint32_t NumNodes() const { return (uint32_t)m_nodes.size(); }
+        ZetaInline const LightBounds& Bounds(uint32_t node) const { return m_nodes[node].Bounds; }
+        // For uploading to GPU
+        ZetaInline Util::Span<LightBVHNode> PackedNodes() const { return m_packed; }
+        // Maps leaf primitive offsets to triangle indices
+        ZetaInline Util::Span<uint32_t> PrimTriIndices() const { return m_primTris; }
+
+    private:
+        static constexpr uint32_t MAX_NUM_PRIMS_PER_LEAF = 4;
+        static constexpr uint32_t NUM_BINS = 12;
+        static constexpr uint32_t MIN_NUM_PRIMS_PER_SUBTREE = 1024;
+
+        struct Prim
+        {
+            LightBounds Bounds;
+            Math::float3 Centroid;
+            uint32_t TriIdx;
+        };
+
+        struct Node
+        {
+            ZetaInline bool IsLeaf() const { return Count != 0; }
+
+            LightBounds Bounds;
+            uint32_t Offset;
+            uint32_t Count;
+            int Parent;
+        };
+
+        struct Subtree
+        {
+            uint32_t Base;
+            uint32_t Count;
+            // Local node indices
+            Util::SmallVector<Node> Nodes;
+        };
+
+        // Top level of the tree, either an internal node or a subtree
+        struct TopNode
+        {
+            int Left;
+            int Right;
+            int Subtree;
+        };
+
+        static LightBounds TriangleBounds(EmissiveTriangle& tri, float power);
+        // Returns split position in [base, base + count) or base if splitting failed
+        uint32_t Split(uint32_t base, uint32_t count, const LightBounds& bounds);
+        LightBounds RangeBounds(uint32_t base, uint32_t count) const;
+        // Only spatial bounds
+        LightBounds RangeBox(uint32_t base, uint32_t count) const;
+        int BuildTop(uint32_t base, uint32_t count, int depth, int maxDepth);
+        uint32_t BuildNode(Util::SmallVector<Node>& nodes, uint32_t base, uint32_t count, int parent);
+        void Emit(int topNode, int parent);
+        void Pack(uint32_t node);
+        void RefitPrims(Util::Span<EmissiveTriangle> tris, Util::Span<float> power, uint32_t base,
+            uint32_t count);
+        void PropagateRefit();
+        void UpdateNodeBounds(uint32_t node);
+
+        // In tree order
+        Util::SmallVector<Prim> m_prims;
+        Util::SmallVector<uint32_t> m_primTris;
+        // Inverse mapping from triangle index to primitive and the leaf that contains it
+        Util::SmallVector<uint32_t> m_triToPrim;
+        Util::SmallVector<uint32_t> m_primToLeaf;
+
+        Util::SmallVector<Node> m_nodes;
+        Util::SmallVector<LightBVHNode> m_packed;
+
+        Util::SmallVector<TopNode> m_topNodes;
+        Subtree m_subtrees[MAX_NUM_SUBTREES];
+        int m_numSubtrees = 0;
+        int m_topRoot = -1;
+
+        Util::SmallVector<uint32_t> m_dirtyNodes;
+        Util::SmallVector<uint8_t> m_isDirty;
+    };
+}
\ No newline at end of file
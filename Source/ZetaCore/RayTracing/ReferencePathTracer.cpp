@@ -0,0 +1,798 @@
+#include "ReferencePathTracer.h"
+#include "../App/Filesystem.h"
+#include "../App/Log.h"
+#include "../App/Path.h"
+#include "../App/Timer.h"
+#include "../Support/Task.h"
+#include "../Utility/RNG.h"
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::RT::BSDF;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::App;
+
+namespace
+{
+    static constexpr uint32_t NO_EMISSIVE = UINT32_MAX;
+    static constexpr uint32_t MIN_NUM_SEGMENTS_RUSSIAN_ROULETTE = 3;
+
+    ZetaInline float PowerHeuristic(float pdf, float otherPdf)
+    {
+        const float a = pdf * pdf;
+        const float b = otherPdf * otherPdf;
+
+        return a > 0 ? a / (a + b) : 0.0f;
+    }
+
+    // Moves the ray origin off the surface, to the side that ray direction points to
+    ZetaInline float3 OffsetRayOrigin(const float3& pos, const float3& geoNormal, const float3& dir)
+    {
+        const float scale = Max(Max(fabsf(pos.x), fabsf(pos.y)), Max(fabsf(pos.z), 1.0f));
+        const float offset = geoNormal.dot(dir) >= 0 ? 1e-4f * scale : -1e-4f * scale;
+
+        return pos + offset * geoNormal;
+    }
+
+    ZetaInline float MaxComponent(const float3& v)
+    {
+        return Max(Max(v.x, v.y), v.z);
+    }
+
+    template<typename T>
+    void Append(SmallVector<uint8_t>& buffer, const T& val)
+    {
+        const size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        memcpy(buffer.data() + offset, &val, sizeof(T));
+    }
+
+    void AppendStr(SmallVector<uint8_t>& buffer, const char* str)
+    {
+        const size_t n = strlen(str) + 1;
+        const size_t offset = buffer.size();
+        buffer.resize(offset + n);
+        memcpy(buffer.data() + offset, str, n);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// ReferencePathTracer
+//--------------------------------------------------------------------------------------
+
+void ReferencePathTracer::Init(const Options& opts)
+{
+    Assert(opts.Width > 0 && opts.Height > 0, "Invalid image dimensions.");
+    Assert(opts.SamplesPerPixel > 0, "At least one sample per pixel is required.");
+    Assert(opts.MaxDepth > 0, "Invalid max depth.");
+
+    m_opts = opts;
+    m_numTilesX = (uint32_t)CeilUnsignedIntDiv(opts.Width, TILE_SIZE);
+    m_numTilesY = (uint32_t)CeilUnsignedIntDiv(opts.Height, TILE_SIZE);
+    m_image.resize(opts.Width * opts.Height);
+    memset(m_image.data(), 0, m_image.size() * sizeof(float3));
+    m_stats = {};
+
+    m_view.Pos = float3(0.0f);
+    m_view.BasisX = float3(1.0f, 0.0f, 0.0f);
+    m_view.BasisY = float3(0.0f, 1.0f, 0.0f);
+    m_view.BasisZ = float3(0.0f, 0.0f, 1.0f);
+    m_view.TanHalfFOV = 1.0f;
+    m_view.AspectRatio = (float)opts.Width / opts.Height;
+}
+
+void ReferencePathTracer::Clear()
+{
+    m_positions.free_memory();
+    m_tris.free_memory();
+    m_materials.free_memory();
+    m_bvh.Clear();
+    m_emissives.free_memory();
+    m_triToEmissive.free_memory();
+    m_lightDist.Clear();
+    m_image.free_memory();
+}
+
+bool ReferencePathTracer::LoadRhoLUT(const char* path)
+{
+    if (path)
+        return m_rho.Load(path);
+
+    Filesystem::Path p(App::GetAssetDir());
+#ifdef _WIN32
+    p.Append("LUT\\rho.dds");
+#else
+    p.Append("LUT/rho.dds", false);
+#endif
+
+    if (m_rho.Load(p.Get()))
+        return true;
+
+    LOG_UI_WARNING("%s wasn't found, computing the rho LUT instead.", p.Get());
+    m_rho.Compute();
+
+    return true;
+}
+
+void ReferencePathTracer::AddMesh(Span<Vertex> vertices, Span<uint32_t> indices,
+    const float4x3& toWorld, const Material& mat)
+{
+    const uint32_t matIdx = (uint32_t)m_materials.size();
+    m_materials.push_back(mat);
+
+    AddTriangles(vertices, indices, toWorld, matIdx);
+}
+
+void ReferencePathTracer::AddScene(const SceneSource& source)
+{
+    const uint32_t baseMatIdx = (uint32_t)m_materials.size();
+    m_materials.append_range(source.Materials.begin(), source.Materials.end());
+
+    for (auto& instance : source.Instances)
+    {
+        Assert(instance.MeshIdx < source.Meshes.size(), "Invalid mesh index.");
+        const SceneSource::Mesh& mesh = source.Meshes[instance.MeshIdx];
+        Assert(mesh.MatIdx < source.Materials.size(), "Invalid material index.");
+        Assert(mesh.BaseVertex + mesh.NumVertices <= source.Vertices.size() &&
+            mesh.BaseIndex + mesh.NumIndices <= source.Indices.size(), "Mesh is out of bounds.");
+
+        AddTriangles(Span(source.Vertices.data() + mesh.BaseVertex, mesh.NumVertices),
+            Span(source.Indices.data() + mesh.BaseIndex, mesh.NumIndices),
+            instance.ToWorld, baseMatIdx + mesh.MatIdx);
+    }
+}
+
+void ReferencePathTracer::AddTriangles(Span<Vertex> vertices, Span<uint32_t> indices,
+    const float4x3& toWorld, uint32_t matIdx)
+{
+    Assert(indices.size() % 3 == 0, "Number of indices must be a multiple of 3.");
+
+    // Normals are transformed by the inverse transpose, which up to a scale factor, is the
+    // cofactor matrix. Sign of determinant is needed to keep the orientation.
+    const float3 c0 = toWorld.m[1].cross(toWorld.m[2]);
+    const float3 c1 = toWorld.m[2].cross(toWorld.m[0]);
+    const float3 c2 = toWorld.m[0].cross(toWorld.m[1]);
+    const float s = toWorld.m[0].dot(c0) < 0 ? -1.0f : 1.0f;
+
+    const size_t numTris = indices.size() / 3;
+    m_positions.reserve(m_positions.size() + indices.size());
+    m_tris.reserve(m_tris.size() + numTris);
+
+    for (size_t t = 0; t < numTris; t++)
+    {
+        float3 normals[3];
+
+        for (int j = 0; j < 3; j++)
+        {
+            Assert(indices[3 * t + j] < vertices.size(), "Index out of bounds.");
+            Vertex v = vertices[indices[3 * t + j]];
+
+            const float3 pos = v.Position.x * toWorld.m[0] + v.Position.y * toWorld.m[1] +
+                v.Position.z * toWorld.m[2] + toWorld.m[3];
+            m_positions.push_back(pos);
+
+            const float3 n = v.Normal.decode();
+            normals[j] = Normalize(s * (n.x * c0 + n.y * c1 + n.z * c2));
+        }
+
+        m_tris.push_back(Triangle{ .N0 = normals[0],
+            .N1 = normals[1],
+            .N2 = normals[2],
+            .MatIdx = matIdx });
+    }
+}
+
+void ReferencePathTracer::Commit()
+{
+    App::DeltaTimer timer;
+    timer.Start();
+
+    m_bvh.Build(m_positions);
+
+    // Emissive textures are ignored, so every triangle with an emissive material
+    // emits a constant radiance
+    m_emissives.clear();
+    m_triToEmissive.resize(m_tris.size());
+    SmallVector<float> power;
+
+    for (uint32_t t = 0; t < (uint32_t)m_tris.size(); t++)
+    {
+        m_triToEmissive[t] = NO_EMISSIVE;
+        const Material& mat = m_materials[m_tris[t].MatIdx];
+        const float3 Le = mat.GetEmissiveFactor() * HalfToFloat(mat.GetEmissiveStrength().x);
+
+        if (MaxComponent(Le) <= 0)
+            continue;
+
+        const float3& v0 = m_positions[3 * t];
+        const float3& v1 = m_positions[3 * t + 1];
+        const float3& v2 = m_positions[3 * t + 2];
+        const float area = 0.5f * (v1 - v0).cross(v2 - v0).length();
+
+        if (area <= 0)
+            continue;
+
+        m_triToEmissive[t] = (uint32_t)m_emissives.size();
+        m_emissives.push_back(Emissive{ .Tri = t, .Area = area, .Le = Le });
+
+        const float numSides = mat.DoubleSided() ? 2.0f : 1.0f;
+        power.push_back(Luminance(Le) * area * numSides * PI);
+    }
+
+    m_lightDist.Clear();
+    if (!power.empty())
+        m_lightDist.Init(power);
+
+    timer.End();
+    LOG_UI_INFO("Reference path tracer: BVH over %u triangles (%u nodes), %u emissive triangles -- %u [ms].",
+        m_bvh.NumTriangles(), m_bvh.NumNodes(), (uint32_t)m_emissives.size(), (uint32_t)timer.DeltaMilli());
+}
+
+void ReferencePathTracer::Render()
+{
+    Check(m_rho.IsLoaded(), "Rho LUT hasn't been initialized.");
+
+    App::DeltaTimer timer;
+    timer.Start();
+
+    const uint32_t numTiles = NumTiles();
+    m_nextTile.store(0, std::memory_order_relaxed);
+    m_numRays.store(0, std::memory_order_relaxed);
+
+    // Persistent tasks that keep pulling tiles until there's none left. Compared to one
+    // task per tile, this avoids the task-count limit and balances uneven tiles.
+    const int numTasks = (int)Min((uint32_t)Min(App::GetNumWorkerThreads() + 1, TaskSet::MAX_NUM_TASKS),
+        numTiles);
+    TaskSet ts;
+
+    for (int i = 0; i < numTasks; i++)
+    {
+        StackStr(tname, n, "ReferencePathTracer_%d", i);
+        ts.EmplaceTask(tname, [this, numTiles]()
+            {
+                uint32_t tile;
+                while ((tile = m_nextTile.fetch_add(1, std::memory_order_relaxed)) < numTiles)
+                    RenderTile(tile);
+            });
+    }
+
+    WaitObject waitObj;
+    ts.Sort();
+    ts.Finalize(&waitObj);
+    App::Submit(ZetaMove(ts));
+
+    // Help out with unfinished tasks
+    App::FlushWorkerThreadPool();
+    waitObj.Wait();
+
+    timer.End();
+
+    m_stats.NumSamples = (uint64_t)m_opts.Width * m_opts.Height * m_opts.SamplesPerPixel;
+    m_stats.NumRays = m_numRays.load(std::memory_order_relaxed);
+    m_stats.ElapsedSec = timer.DeltaMilli() / 1000.0;
+
+    LOG_UI_INFO("Reference path tracer: %ux%u, %u spp in %.2f [s] -- %.3f Msamples/s, %.3f Mrays/s.",
+        m_opts.Width, m_opts.Height, m_opts.SamplesPerPixel, m_stats.ElapsedSec,
+        m_stats.NumSamples / (m_stats.ElapsedSec * 1e6), m_stats.NumRays / (m_stats.ElapsedSec * 1e6));
+}
+
+void ReferencePathTracer::RenderTile(uint32_t tileIdx)
+{
+    Assert(tileIdx < NumTiles(), "Invalid tile index.");
+
+    const uint32_t x0 = (tileIdx % m_numTilesX) * TILE_SIZE;
+    const uint32_t y0 = (tileIdx / m_numTilesX) * TILE_SIZE;
+    const uint32_t x1 = Min(x0 + TILE_SIZE, m_opts.Width);
+    const uint32_t y1 = Min(y0 + TILE_SIZE, m_opts.Height);
+    const float tanHalfFOV = m_view.TanHalfFOV;
+    const float oneOverSpp = 1.0f / m_opts.SamplesPerPixel;
+    uint32_t numRays = 0;
+
+    for (uint32_t y = y0; y < y1; y++)
+    {
+        for (uint32_t x = x0; x < x1; x++)
+        {
+            const uint32_t pixelIdx = y * m_opts.Width + x;
+            // Every pixel uses its own stream so that the result doesn't depend on scheduling
+            RNG rng(((uint64_t)m_opts.Seed << 32) | pixelIdx);
+            float3 sum(0.0f);
+
+            for (uint32_t s = 0; s < m_opts.SamplesPerPixel; s++)
+            {
+                // Same as RT::GeneratePinholeCameraRay() in the shaders
+                const float2 u = rng.Uniform2D();
+                const float2 uv((x + u.x) / m_opts.Width, (y + u.y) / m_opts.Height);
+                const float ndcX = 2.0f * uv.x - 1.0f;
+                const float ndcY = -(2.0f * uv.y - 1.0f);
+                const float3 dirV(ndcX * m_view.AspectRatio * tanHalfFOV, ndcY * tanHalfFOV, 1.0f);
+                const float3 dirW = Normalize(dirV.x * m_view.BasisX + dirV.y * m_view.BasisY +
+                    dirV.z * m_view.BasisZ);
+
+                const float3 li = Li(Ray(m_view.Pos, dirW), rng, numRays);
+
+                // Drop invalid samples instead of poisoning the pixel
+                if (!IsNaN(li.x) && !IsNaN(li.y) && !IsNaN(li.z))
+                    sum += li;
+            }
+
+            m_image[pixelIdx] = sum * oneOverSpp;
+        }
+    }
+
+    m_numRays.fetch_add(numRays, std::memory_order_relaxed);
+}
+
+float ReferencePathTracer::LightPdf(uint32_t emissiveIdx, float t, float cosTheta_l) const
+{
+    const float pdfArea = m_lightDist.Pdf(emissiveIdx) / m_emissives[emissiveIdx].Area;
+    return pdfArea * t * t / cosTheta_l;
+}
+
+ReferencePathTracer::LobeProbs ReferencePathTracer::ComputeLobeProbs(const ShadingData& surface) const
+{
+    LobeProbs p = { .Coat = 0, .Gloss = 0, .DiffuseR = 0, .DiffuseT = 0 };
+    float remaining = 1.0f;
+
+    if (surface.Coated())
+    {
+        // Approximate coat reflectance along wo
+        const float Fr_c = FresnelSchlick_Dielectric(DielectricF0(surface.coat_eta), surface.ndotwo);
+        p.Coat = Min(Max(surface.coat_weight * Fr_c, 0.05f), 0.95f);
+        remaining = 1.0f - p.Coat;
+    }
+
+    if (surface.metallic || surface.specTr)
+    {
+        p.Gloss = remaining;
+        return p;
+    }
+
+    // Opaque dielectric -- split between gloss and diffuse based on their albedos
+    const float rho_g = surface.GlossSpecular() ? Fresnel_Dielectric(surface.ndotwo, 1.0f / surface.eta) :
+        GGXReflectance_Dielectric(*surface.rho, surface.alpha, surface.ndotwo, surface.eta);
+    const float w_g = Max(rho_g, 0.05f);
+    const float w_d = (1.0f - rho_g) * Luminance(surface.baseColor_Fr0_TrCol);
+    p.Gloss = remaining * w_g / (w_g + w_d);
+    const float diffuse = remaining - p.Gloss;
+
+    if (surface.ThinWalled())
+    {
+        p.DiffuseR = 0.5f * diffuse;
+        p.DiffuseT = 0.5f * diffuse;
+    }
+    else
+        p.DiffuseR = diffuse;
+
+    return p;
+}
+
+float ReferencePathTracer::BSDFPdf(const ShadingData& surface, const float3& normal, const float3& wi) const
+{
+    if (surface.backfacing_wo)
+        return 0;
+
+    const LobeProbs p = ComputeLobeProbs(surface);
+    const bool translucent = surface.specTr && !surface.metallic;
+    const bool roughCoat = p.Coat > 0 && !surface.CoatSpecular();
+    const bool roughGloss = p.Gloss > 0 && !surface.GlossSpecular();
+    float pdf = 0;
+
+    // Microfacet lobes can produce directions on either side of the surface, so all
+    // of them are considered regardless of which side wi is on
+    if (roughCoat || roughGloss)
+    {
+        ShadingData s = surface;
+        s.SetWi_Refl(wi, normal);
+
+        if (s.ndotwh > 0 && s.whdotwo > 0)
+        {
+            if (roughCoat)
+                pdf += p.Coat * CoatPdf(s);
+
+            if (roughGloss)
+            {
+                const float F = translucent ? Fresnel_Dielectric(s.whdotwo, 1.0f / s.eta) : 1.0f;
+                pdf += p.Gloss * GlossPdf(s) * F;
+            }
+        }
+    }
+
+    if (roughGloss && translucent)
+    {
+        float3 wh = Normalize(surface.eta * wi + surface.wo);
+        wh = surface.eta > 1 ? -wh : wh;
+        const float whdotwi = wh.dot(wi);
+
+        ShadingData s = surface;
+        s.SetWi_Tr(wi, normal, wh);
+
+        // wo and wi have to be on opposite sides of the microfacet
+        if (s.ndotwh > 0 && s.whdotwo > 0 && whdotwi < 0)
+        {
+            // Change of variable from wh to wi. Note that TranslucentTrPdf() adds the
+            // absolute values of wh.wo and wh.wi, whereas the actual density of refracted
+            // directions has the signed sum (see PBRT 4th ed., section 9.7).
+            const float denom = whdotwi + s.whdotwo / s.eta;
+            const float dwh_dwi = -whdotwi / (denom * denom);
+            const float pdf_wh = GGXMicrofacetPdf(s.alpha, s.ndotwh, s.ndotwo) * s.whdotwo;
+            const float F = Fresnel_Dielectric(s.whdotwo, 1.0f / s.eta);
+
+            pdf += p.Gloss * pdf_wh * dwh_dwi * (1.0f - F);
+        }
+    }
+
+    const float ndotwi = normal.dot(wi);
+    if (ndotwi > 0)
+        pdf += p.DiffuseR * ndotwi * ONE_OVER_PI;
+    else
+        pdf += p.DiffuseT * -ndotwi * ONE_OVER_PI;
+
+    return pdf;
+}
+
+bool ReferencePathTracer::SampleBSDF(const ShadingData& surface, const float3& normal, RNG& rng,
+    BSDFSample& sample) const
+{
+    if (surface.backfacing_wo)
+        return false;
+
+    const LobeProbs p = ComputeLobeProbs(surface);
+    const bool translucent = surface.specTr && !surface.metallic;
+    const float u = rng.Uniform();
+    const float2 u_wh = rng.Uniform2D();
+    float3 wi;
+    bool delta;
+
+    if (u < p.Coat)
+    {
+        wi = SampleCoat(surface, normal, u_wh);
+        delta = surface.CoatSpecular();
+    }
+    else if (u < p.Coat + p.Gloss)
+    {
+        if (translucent)
+        {
+            // Choose between reflection and transmission based on Fresnel at sampled microfacet
+            const float3 wh = surface.GlossSpecular() ? normal :
+                SampleGGXMicrofacet(surface.wo, surface.alpha, normal, u_wh);
+            const float F = Fresnel_Dielectric(Saturate(wh.dot(surface.wo)), 1.0f / surface.eta);
+
+            wi = rng.Uniform() < F ? Reflect(-surface.wo, wh) : Refract(-surface.wo, wh, 1.0f / surface.eta);
+        }
+        else
+            wi = SampleGloss(surface, normal, u_wh);
+
+        delta = surface.GlossSpecular();
+    }
+    else
+    {
+        const bool transmit = u >= p.Coat + p.Gloss + p.DiffuseR;
+        float unused;
+        wi = SampleDiffuse(transmit ? -normal : normal, u_wh, unused);
+        delta = false;
+    }
+
+    if (wi.dot(wi) == 0)
+        return false;
+
+    wi = Normalize(wi);
+
+    ShadingData s = surface;
+    s.SetWi(wi, normal);
+    const BSDFEval eval = Unified(s);
+
+    sample.wi = wi;
+    sample.Delta = delta;
+
+    if (delta)
+    {
+        // Probability of sampling this exact direction -- specular coat and specular gloss
+        // reflection lead to the same direction
+        const bool reflection = normal.dot(wi) > 0;
+        const float F = translucent ? Fresnel_Dielectric(surface.ndotwo, 1.0f / surface.eta) : 1.0f;
+        float mass = 0;
+
+        if (reflection)
+        {
+            mass += surface.Coated() && surface.CoatSpecular() ? p.Coat : 0.0f;
+            mass += surface.GlossSpecular() ? p.Gloss * F : 0.0f;
+        }
+        else
+            mass = p.Gloss * (1.0f - F);
+
+        if (mass <= 0)
+            return false;
+
+        sample.Weight = eval.f_delta / mass;
+        sample.Pdf = 0;
+
+        return true;
+    }
+
+    const float pdf = BSDFPdf(surface, normal, wi);
+    if (pdf <= 0)
+        return false;
+
+    sample.Weight = (eval.f - eval.f_delta) / pdf;
+    sample.Pdf = pdf;
+
+    return true;
+}
+
+float3 ReferencePathTracer::Li(const Ray& cameraRay, RNG& rng, uint32_t& numRays) const
+{
+    float3 li(0.0f);
+    float3 throughput(1.0f);
+    Ray ray = cameraRay;
+    float eta_curr = ETA_AIR;
+    bool prevDelta = true;
+    float prevPdf = 0;
+
+    for (uint32_t numSegments = 1; ; numSegments++)
+    {
+        TriangleHit hit;
+        numRays++;
+
+        if (!m_bvh.Intersect(ray, FLT_MAX, hit))
+        {
+            li += throughput * m_opts.SkyRadiance;
+            break;
+        }
+
+        const Triangle& tri = m_tris[hit.Tri];
+        const float3& v0 = m_positions[3 * hit.Tri];
+        const float3& v1 = m_positions[3 * hit.Tri + 1];
+        const float3& v2 = m_positions[3 * hit.Tri + 2];
+        const float b0 = 1.0f - hit.U - hit.V;
+        const float3 pos = b0 * v0 + hit.U * v1 + hit.V * v2;
+        const float3 wo = -ray.Dir;
+
+        float3 geoNormal = Normalize((v1 - v0).cross(v2 - v0));
+        float3 normal = b0 * tri.N0 + hit.U * tri.N1 + hit.V * tri.N2;
+        normal = normal.dot(normal) > 0 ? Normalize(normal) : geoNormal;
+
+        Material mat = m_materials[tri.MatIdx];
+
+        // Emission
+        const uint32_t emissiveIdx = m_triToEmissive[hit.Tri];
+        if (emissiveIdx != NO_EMISSIVE)
+        {
+            const float cosTheta_l = geoNormal.dot(wo);
+
+            if (cosTheta_l > 0 || mat.DoubleSided())
+            {
+                const float w = prevDelta ? 1.0f :
+                    PowerHeuristic(prevPdf, LightPdf(emissiveIdx, hit.T, fabsf(cosTheta_l)));
+                li += w * throughput * m_emissives[emissiveIdx].Le;
+            }
+        }
+
+        if (numSegments == m_opts.MaxDepth)
+            break;
+
+        // Same as RtRayQuery::GetMaterialData() -- no radiance can be reflected back from
+        // the backside of one-sided surfaces
+        const bool hitBackface = wo.dot(normal) < 0;
+        if (hitBackface && !mat.DoubleSided())
+            break;
+
+        normal = hitBackface ? -normal : normal;
+        geoNormal = geoNormal.dot(normal) < 0 ? -geoNormal : geoNormal;
+
+        const float eta_mat = mat.GetSpecularIOR();
+        const float eta_next = eta_curr == ETA_AIR ? eta_mat : ETA_AIR;
+        const bool specTr = mat.Transmissive();
+        const float trDepth = specTr ? HalfToFloat(mat.GetTransmissionDepth().x) : 0.0f;
+        const float subsurface = mat.ThinWalled() ? mat.GetSubsurface() : 0.0f;
+
+        const ShadingData surface = ShadingData::Init(m_rho, normal, wo, mat.Metallic(),
+            mat.GetSpecularRoughness(), mat.GetBaseColorFactor(), eta_curr, eta_next, specTr,
+            trDepth, subsurface, mat.GetCoatWeight(), mat.GetCoatColor(), mat.GetCoatRoughness(),
+            mat.GetCoatIOR());
+
+        // Beer's law
+        if (eta_curr != ETA_AIR && trDepth > 0)
+        {
+            const float3& c = surface.baseColor_Fr0_TrCol;
+            const float d = hit.T / trDepth;
+            throughput *= float3(powf(c.x, d), powf(c.y, d), powf(c.z, d));
+        }
+
+        // Next event estimation
+        if (!m_emissives.empty())
+        {
+            float lightSelectionPdf;
+            const uint32_t e = m_lightDist.Sample(rng.Uniform(), lightSelectionPdf);
+            const Emissive& emissive = m_emissives[e];
+
+            const float3& l0 = m_positions[3 * emissive.Tri];
+            const float3& l1 = m_positions[3 * emissive.Tri + 1];
+            const float3& l2 = m_positions[3 * emissive.Tri + 2];
+
+            // Uniform sampling of triangle area
+            const float2 u = rng.Uniform2D();
+            const float su = sqrtf(u.x);
+            const float bl0 = 1.0f - su;
+            const float bl1 = u.y * su;
+            const float3 lightPos = bl0 * l0 + bl1 * l1 + (1.0f - bl0 - bl1) * l2;
+
+            const float3 origin = OffsetRayOrigin(pos, geoNormal, lightPos - pos);
+            float3 toLight = lightPos - origin;
+            const float t = toLight.length();
+            const float3 wi = toLight / t;
+            const float3 lightNormal = Normalize((l1 - l0).cross(l2 - l0));
+            const float cosTheta_l = -lightNormal.dot(wi);
+            const bool lightDoubleSided = m_materials[m_tris[emissive.Tri].MatIdx].DoubleSided();
+
+            if (t > 0 && (cosTheta_l > 0 || (lightDoubleSided && cosTheta_l < 0)))
+            {
+                ShadingData s = surface;
+                s.SetWi(wi, normal);
+                const BSDFEval eval = Unified(s);
+                // Specular lobes can't be sampled this way
+                const float3 f = eval.f - eval.f_delta;
+
+                if (MaxComponent(f) > 0)
+                {
+                    numRays++;
+
+                    // Stop slightly short of the light so that it doesn't occlude itself
+                    if (!m_bvh.Occluded(Ray(origin, wi), t * (1.0f - 1e-4f)))
+                    {
+                        const float lightPdf = lightSelectionPdf * t * t / (emissive.Area * fabsf(cosTheta_l));
+                        const float bsdfPdf = BSDFPdf(surface, normal, wi);
+                        const float w = PowerHeuristic(lightPdf, bsdfPdf);
+
+                        li += throughput * f * emissive.Le * (w / lightPdf);
+                    }
+                }
+            }
+        }
+
+        // Sample the BSDF to extend the path
+        BSDFSample bsdfSample;
+        if (!SampleBSDF(surface, normal, rng, bsdfSample))
+            break;
+
+        throughput *= bsdfSample.Weight;
+        if (MaxComponent(throughput) <= 0)
+            break;
+
+        const bool transmitted = normal.dot(bsdfSample.wi) < 0;
+        eta_curr = transmitted ? (eta_curr == ETA_AIR ? eta_next : ETA_AIR) : eta_curr;
+        prevDelta = bsdfSample.Delta;
+        prevPdf = bsdfSample.Pdf;
+
+        ray = Ray(OffsetRayOrigin(pos, geoNormal, bsdfSample.wi), bsdfSample.wi);
+
+        // Russian roulette
+        if (numSegments >= MIN_NUM_SEGMENTS_RUSSIAN_ROULETTE)
+        {
+            const float q = Min(MaxComponent(throughput), 0.95f);
+            if (rng.Uniform() >= q)
+                break;
+
+            throughput /= q;
+        }
+    }
+
+    return li;
+}
+
+void ReferencePathTracer::WritePFM(const char* path) const
+{
+    const uint32_t w = m_opts.Width;
+    const uint32_t h = m_opts.Height;
+
+    // Negative scale means little endian
+    StackStr(header, n, "PF\n%u %u\n-1.0\n", w, h);
+    SmallVector<uint8_t> file;
+    file.resize(n + w * h * sizeof(float3));
+    memcpy(file.data(), header, n);
+
+    // Rows are stored from bottom to top
+    for (uint32_t y = 0; y < h; y++)
+    {
+        memcpy(file.data() + n + y * w * sizeof(float3), m_image.data() + (h - 1 - y) * w,
+            w * sizeof(float3));
+    }
+
+    Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+}
+
+void ReferencePathTracer::WriteEXR(const char* path) const
+{
+    const int32_t w = (int32_t)m_opts.Width;
+    const int32_t h = (int32_t)m_opts.Height;
+    constexpr int32_t PIXEL_TYPE_FLOAT = 2;
+    constexpr int NUM_CHANNELS = 3;
+
+    SmallVector<uint8_t> file;
+    // Magic number and version 2, single-part scanline
+    Append(file, uint32_t(20000630));
+    Append(file, uint32_t(2));
+
+    // Channels have to be in alphabetical order
+    AppendStr(file, "channels");
+    AppendStr(file, "chlist");
+    Append(file, int32_t(NUM_CHANNELS * (2 + 16) + 1));
+
+    for (const char* c : { "B", "G", "R" })
+    {
+        AppendStr(file, c);
+        Append(file, PIXEL_TYPE_FLOAT);
+        // pLinear + reserved
+        Append(file, uint32_t(0));
+        // x and y sampling
+        Append(file, int32_t(1));
+        Append(file, int32_t(1));
+    }
+
+    Append(file, uint8_t(0));
+
+    AppendStr(file, "compression");
+    AppendStr(file, "compression");
+    Append(file, int32_t(1));
+    Append(file, uint8_t(0));
+
+    for (const char* window : { "dataWindow", "displayWindow" })
+    {
+        AppendStr(file, window);
+        AppendStr(file, "box2i");
+        Append(file, int32_t(16));
+        Append(file, int32_t(0));
+        Append(file, int32_t(0));
+        Append(file, w - 1);
+        Append(file, h - 1);
+    }
+
+    AppendStr(file, "lineOrder");
+    AppendStr(file, "lineOrder");
+    Append(file, int32_t(1));
+    Append(file, uint8_t(0));
+
+    AppendStr(file, "pixelAspectRatio");
+    AppendStr(file, "float");
+    Append(file, int32_t(4));
+    Append(file, 1.0f);
+
+    AppendStr(file, "screenWindowCenter");
+    AppendStr(file, "v2f");
+    Append(file, int32_t(8));
+    Append(file, 0.0f);
+    Append(file, 0.0f);
+
+    AppendStr(file, "screenWindowWidth");
+    AppendStr(file, "float");
+    Append(file, int32_t(4));
+    Append(file, 1.0f);
+
+    // End of header
+    Append(file, uint8_t(0));
+
+    // Line offset table, followed by one scanline per block
+    const uint32_t lineSize = w * NUM_CHANNELS * sizeof(float);
+    const uint64_t firstLine = file.size() + h * sizeof(uint64_t);
+
+    for (int32_t y = 0; y < h; y++)
+        Append(file, uint64_t(firstLine + y * (2 * sizeof(int32_t) + lineSize)));
+
+    for (int32_t y = 0; y < h; y++)
+    {
+        Append(file, y);
+        Append(file, lineSize);
+
+        const float3* row = m_image.data() + y * w;
+        for (int32_t x = 0; x < w; x++)
+            Append(file, row[x].z);
+        for (int32_t x = 0; x < w; x++)
+            Append(file, row[x].y);
+        for (int32_t x = 0; x < w; x++)
+            Append(file, row[x].x);
+    }
+
+    Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+}
\ No newline at end of file
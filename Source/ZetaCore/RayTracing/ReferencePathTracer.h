@@ -0,0 +1,216 @@
+#pragma once
+
+#include "BSDF.h"
+#include "TriangleBVH.h"
+#include "../Core/Vertex.h"
+#include "../Math/Matrix.h"
+#include "../Math/Sampling.h"
+#include <atomic>
+
+namespace ZetaRay::Scene
+{
+    class SceneCore;
+    class Camera;
+}
+
+namespace ZetaRay::Util
+{
+    struct RNG;
+}
+
+namespace ZetaRay::RT
+{
+    // Unidirectional path tracer that runs on the CPU, meant as ground truth for the GPU
+    // renderer and as a CPU throughput benchmark. Uses next event estimation for emissive
+    // triangles with multiple importance sampling and the same material model as the shaders
+    // (see BSDF.h). Limitations:
+    //  - Textures and normal maps are ignored, material factors are used instead
+    //  - Sky is a constant radiance (no sun)
+    //
+    // Usage:
+    //  1. Add geometry -- AddMesh() or AddScene(). Only the Scene::SceneCore overload depends
+    //     on the scene (see ReferencePathTracerScene.cpp).
+    //  2. Commit()
+    //  3. Render(), then write out the result
+    struct ReferencePathTracer
+    {
+        static constexpr uint32_t TILE_SIZE = 16;
+
+        struct Options
+        {
+            uint32_t Width = 1280;
+            uint32_t Height = 720;
+            uint32_t SamplesPerPixel = 64;
+            // Maximum number of path segments, e.g. 1 for emitters only, 2 for direct lighting
+            uint32_t MaxDepth = 8;
+            uint32_t Seed = 0;
+            Math::float3 SkyRadiance = Math::float3(0.0f);
+        };
+
+        // Pinhole camera, same conventions as Scene::Camera
+        struct View
+        {
+            Math::float3 Pos;
+            Math::float3 BasisX;
+            Math::float3 BasisY;
+            Math::float3 BasisZ;
+            float TanHalfFOV;
+            float AspectRatio;
+        };
+
+        // Indexed geometry that's shared between instances, independent of Scene::SceneCore
+        struct SceneSource
+        {
+            struct Mesh
+            {
+                uint32_t BaseVertex;
+                uint32_t NumVertices;
+                uint32_t BaseIndex;
+                uint32_t NumIndices;
+                // Index into Materials
+                uint32_t MatIdx;
+            };
+
+            struct Instance
+            {
+                // Index into Meshes
+                uint32_t MeshIdx;
+                Math::float4x3 ToWorld;
+            };
+
+            // Object space
+            Util::Span<Core::Vertex> Vertices;
+            // Relative to each mesh's BaseVertex
+            Util::Span<uint32_t> Indices;
+            Util::Span<Mesh> Meshes;
+            Util::Span<Material> Materials;
+            Util::Span<Instance> Instances;
+        };
+
+        struct Stats
+        {
+            uint64_t NumSamples;
+            uint64_t NumRays;
+            double ElapsedSec;
+        };
+
+        ReferencePathTracer() = default;
+        ~ReferencePathTracer() = default;
+
+        ReferencePathTracer(const ReferencePathTracer&) = delete;
+        ReferencePathTracer& operator=(const ReferencePathTracer&) = delete;
+
+        void Init(const Options& opts);
+        void Clear();
+
+        // Rho LUT needs to be initialized before rendering. When called with nullptr, loads
+        // Assets/LUT/rho.dds or if that's missing, computes it (see BSDF::RhoLUT::Compute()).
+        bool LoadRhoLUT(const char* path = nullptr);
+        ZetaInline BSDF::RhoLUT& RhoLUT() { return m_rho; }
+
+        // Vertices are in object space
+        void AddMesh(Util::Span<Core::Vertex> vertices, Util::Span<uint32_t> indices,
+            const Math::float4x3& toWorld, const Material& mat);
+        // Adds every instance in the source
+        void AddScene(const SceneSource& source);
+        // Adds every instance in the scene. Requires scene to keep a CPU copy of mesh data
+        // (SceneCore::RetainCpuMeshData()) and world transformations to be up to date.
+        void AddScene(const Scene::SceneCore& scene);
+        // Builds the acceleration structure and the light distribution
+        void Commit();
+
+        void SetView(const View& view) { m_view = view; }
+        void SetView(const Scene::Camera& camera);
+
+        // Renders the whole image. Tiles are distributed among worker threads.
+        void Render();
+        // Renders one tile, can be called from multiple threads as long as tiles don't overlap
+        void RenderTile(uint32_t tileIdx);
+        ZetaInline uint32_t NumTiles() const { return m_numTilesX * m_numTilesY; }
+
+        // Estimated radiance, row major
+        ZetaInline Util::Span<Math::float3> Image() const { return m_image; }
+        ZetaInline const Stats& GetStats() const { return m_stats; }
+        ZetaInline uint32_t NumTriangles() const { return m_bvh.NumTriangles(); }
+        ZetaInline uint32_t NumEmissiveTriangles() const { return (uint32_t)m_emissives.size(); }
+
+        // Portable float map (RGB, 32-bit float)
+        void WritePFM(const char* path) const;
+        // OpenEXR (RGB, 32-bit float, uncompressed scanlines)
+        void WriteEXR(const char* path) const;
+
+        // Exposed for testing
+        struct BSDFSample
+        {
+            Math::float3 wi;
+            // f * n.wi / pdf
+            Math::float3 Weight;
+            // Zero for specular lobes
+            float Pdf;
+            bool Delta;
+        };
+
+        bool SampleBSDF(const BSDF::ShadingData& surface, const Math::float3& normal,
+            Util::RNG& rng, BSDFSample& sample) const;
+        // Density of sampling wi with SampleBSDF(), excluding the specular lobes
+        float BSDFPdf(const BSDF::ShadingData& surface, const Math::float3& normal,
+            const Math::float3& wi) const;
+        Math::float3 Li(const Math::Ray& cameraRay, Util::RNG& rng, uint32_t& numRays) const;
+
+    private:
+        struct Triangle
+        {
+            // World space
+            Math::float3 N0;
+            Math::float3 N1;
+            Math::float3 N2;
+            uint32_t MatIdx;
+        };
+
+        struct Emissive
+        {
+            uint32_t Tri;
+            float Area;
+            Math::float3 Le;
+        };
+
+        // Probabilities of choosing each lobe
+        struct LobeProbs
+        {
+            float Coat;
+            // Gloss reflection for metals and opaque dielectrics. Reflection or transmission
+            // for translucent dielectrics.
+            float Gloss;
+            float DiffuseR;
+            float DiffuseT;
+        };
+
+        void AddTriangles(Util::Span<Core::Vertex> vertices, Util::Span<uint32_t> indices,
+            const Math::float4x3& toWorld, uint32_t matIdx);
+        LobeProbs ComputeLobeProbs(const BSDF::ShadingData& surface) const;
+        // Light sampling pdf w.r.t. solid angle at a point that's at distance t
+        float LightPdf(uint32_t emissiveIdx, float t, float cosTheta_l) const;
+
+        Options m_opts;
+        View m_view;
+        BSDF::RhoLUT m_rho;
+
+        // Three per triangle
+        Util::SmallVector<Math::float3> m_positions;
+        Util::SmallVector<Triangle> m_tris;
+        Util::SmallVector<Material> m_materials;
+        TriangleBVH m_bvh;
+
+        Util::SmallVector<Emissive> m_emissives;
+        // Maps triangle index to emissive index or UINT32_MAX
+        Util::SmallVector<uint32_t> m_triToEmissive;
+        Math::DynamicDistribution m_lightDist;
+
+        Util::SmallVector<Math::float3> m_image;
+        uint32_t m_numTilesX = 0;
+        uint32_t m_numTilesY = 0;
+        std::atomic_uint32_t m_nextTile = 0;
+        std::atomic_uint64_t m_numRays = 0;
+        Stats m_stats = {};
+    };
+}
\ No newline at end of file
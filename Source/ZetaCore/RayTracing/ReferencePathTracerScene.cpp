@@ -0,0 +1,85 @@
+#include "ReferencePathTracer.h"
+#include "../Scene/SceneCore.h"
+#include "../Scene/Camera.h"
+#include "../Utility/HashTable.h"
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Model;
+using namespace ZetaRay::Scene;
+
+//--------------------------------------------------------------------------------------
+// ReferencePathTracer -- Scene::SceneCore and Scene::Camera adapters
+//--------------------------------------------------------------------------------------
+
+void ReferencePathTracer::AddScene(const SceneCore& scene)
+{
+    Span<Vertex> vertices = scene.m_meshes.Vertices();
+    Span<uint32_t> indices = scene.m_meshes.Indices();
+    Check(!vertices.empty() && !indices.empty(), "Mesh data hasn't been retained on the CPU, "
+        "see SceneCore::RetainCpuMeshData().");
+
+    SmallVector<SceneSource::Mesh> meshes;
+    SmallVector<Material> materials;
+    SmallVector<SceneSource::Instance> instances;
+    // Mesh and material IDs to their index in the source
+    HashTable<uint32_t> meshIdx;
+    HashTable<uint32_t> matIdx;
+
+    for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
+    {
+        const auto& currTreeLevel = scene.m_sceneGraph[treeLevelIdx];
+
+        for (size_t i = 0; i < currTreeLevel.m_meshIDs.size(); i++)
+        {
+            const uint64_t meshID = currTreeLevel.m_meshIDs[i];
+            if (meshID == Scene::INVALID_MESH)
+                continue;
+
+            auto idx = meshIdx.find(meshID);
+
+            if (!idx)
+            {
+                const TriangleMesh* mesh = scene.GetMesh(meshID).value();
+                auto m = matIdx.find(mesh->m_materialID);
+
+                if (!m)
+                {
+                    matIdx.insert_or_assign(mesh->m_materialID, (uint32_t)materials.size());
+                    materials.push_back(*scene.GetMaterial(mesh->m_materialID).value());
+                    m = matIdx.find(mesh->m_materialID);
+                }
+
+                meshIdx.insert_or_assign(meshID, (uint32_t)meshes.size());
+                meshes.push_back(SceneSource::Mesh{ .BaseVertex = mesh->m_vtxBuffStartOffset,
+                    .NumVertices = mesh->m_numVertices,
+                    .BaseIndex = mesh->m_idxBuffStartOffset,
+                    .NumIndices = mesh->m_numIndices,
+                    .MatIdx = *m.value() });
+                idx = meshIdx.find(meshID);
+            }
+
+            instances.push_back(SceneSource::Instance{ .MeshIdx = *idx.value(),
+                .ToWorld = currTreeLevel.m_toWorlds[i] });
+        }
+    }
+
+    AddScene(SceneSource{ .Vertices = vertices,
+        .Indices = indices,
+        .Meshes = meshes,
+        .Materials = materials,
+        .Instances = instances });
+}
+
+void ReferencePathTracer::SetView(const Camera& camera)
+{
+    m_view.Pos = camera.GetPos();
+    m_view.BasisX = camera.GetBasisX();
+    m_view.BasisY = camera.GetBasisY();
+    m_view.BasisZ = camera.GetBasisZ();
+    m_view.TanHalfFOV = camera.GetTanHalfFOV();
+    m_view.AspectRatio = (float)m_opts.Width / m_opts.Height;
+}
\ No newline at end of file
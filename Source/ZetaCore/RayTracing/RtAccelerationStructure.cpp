@@ -26,17 +26,8 @@ namespace
         float M[3][4];
     };
 
-    struct DynamicBlasBuild
-    {
-        D3D12_RAYTRACING_GEOMETRY_DESC GeoDesc;
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO BuildInfo;
-        uint32_t BlasBufferOffset;
-        uint32_t ScratchBufferOffset;
-        uint32_t TreeLevel;
-        uint32_t LevelIdx;
-    };
-
-    ZetaInline D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS BuildFlags(RT_MESH_MODE t)
+    ZetaInline D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS BuildFlags(RT_MESH_MODE t,
+        bool deformable = false)
     {
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS f = 
             D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
@@ -51,6 +42,9 @@ namespace
         //else if (t == RT_MESH_MODE::DYNAMIC_REBUILD)
         //    f |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
 
+        if (deformable)
+            f |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+
         return f;
     }
 }
@@ -118,13 +112,13 @@ void StaticBLAS::FillMeshTransformBufferForBuild(ID3D12Heap* heap, uint32_t heap
     }
 }
 
-void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
+void StaticBLAS::PrepareRebuild()
 {
     SceneCore& scene = App::GetScene();
     //Assert(scene.m_numOpaqueInstances + scene.m_numNonOpaqueInstances == 
     // scene.m_numStaticInstances, "these should match.");
 
-    SmallVector<D3D12_RAYTRACING_GEOMETRY_DESC, App::FrameAllocator> meshDescs;
+    auto& meshDescs = m_meshDescs;
     meshDescs.resize(scene.m_numStaticInstances);
 
     constexpr int transformMatSize = sizeof(BLASTransform);
@@ -180,13 +174,16 @@ void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
     }
 
     Assert(currInstance == scene.m_numStaticInstances, "Invalid instance index.");
+}
 
+void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
+{
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
     buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
     buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::STATIC);
     buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    buildDesc.Inputs.NumDescs = (UINT)meshDescs.size();
-    buildDesc.Inputs.pGeometryDescs = meshDescs.data();
+    buildDesc.Inputs.NumDescs = (UINT)m_meshDescs.size();
+    buildDesc.Inputs.pGeometryDescs = m_meshDescs.data();
 
     // Very expensive. Only needed for first frame - future frames use the cached result.
     if (m_prebuildInfo.ResultDataMaxSizeInBytes == 0)
@@ -784,6 +781,38 @@ void TLAS::Update()
         UpdateFrameMeshInstances_StaticToDynamic();
     else if (m_updateType == UPDATE_TYPE::INSTANCE_TRANSFORM)
         UpdateFrameMeshInstances_NewTransform();
+
+    // Gather everything that Render() needs from the scene. Afterwards, the scene is free to 
+    // simulate the next frame.
+    const bool staticBLASReady = !scene.m_numStaticInstances || m_staticBLASCompacted;
+    m_rebuildStaticBLAS = m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC ||
+        (!staticBLASReady && !m_staticBLAS.m_buffer.IsInitialized());
+
+    if (m_rebuildStaticBLAS)
+        m_staticBLAS.PrepareRebuild();
+
+    // Once in the first frame
+    if (m_rebuildDynamicBLASes && scene.m_numDynamicInstances)
+        PrepareDynamicBLASBuilds();
+    // BLASes that were just built already have the deformed vertices
+    else if (!m_dynamicBLASes.empty())
+        PrepareDeformedBLASRefits();
+
+    if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC && scene.m_numDynamicInstances)
+        PrepareStaticToDynamicBLASBuilds();
+
+    // Following order is important, STATIC_TO_DYNAMIC should supercede INSTANCE_TRANSFORM
+    const uint32_t numInstances = scene.m_numDynamicInstances + (scene.m_numStaticInstances > 0);
+    m_rebuildTLASInstances = numInstances && (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC ||
+        !m_tlasInstanceBuffer.IsInitialized());
+
+    if (m_rebuildTLASInstances)
+    {
+        FillTLASInstances();
+        scene.m_pendingRtMeshModeSwitch.clear();
+    }
+    else if (numInstances && m_updateType == UPDATE_TYPE::INSTANCE_TRANSFORM)
+        UpdateTLASInstances_NewTransform();
 }
 
 void TLAS::Render(CommandList& cmdList)
@@ -804,13 +833,13 @@ void TLAS::Render(CommandList& cmdList)
     computeCmdList.PIXEndEvent();
 }
 
-void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
+void TLAS::PrepareDynamicBLASBuilds()
 {
     SceneCore& scene = App::GetScene();
 
-    SmallVector<DynamicBlasBuild, App::FrameAllocator> blasBuilds;
+    auto& blasBuilds = m_dynamicBlasBuilds;
+    blasBuilds.clear();
     blasBuilds.reserve(scene.m_numDynamicInstances);
-    m_dynamicBLASes.reserve(scene.m_numDynamicInstances);
 
     // Skip the first level
     for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
@@ -844,6 +873,7 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
                 buildItem.GeoDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
                 buildItem.GeoDesc.Triangles.VertexCount = mesh->m_numVertices;
                 buildItem.GeoDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+                buildItem.Deformable = (bool)scene.m_skinnedMeshes.Find(currTreeLevel.m_IDs[i]);
 
                 blasBuilds.push_back(buildItem);
 
@@ -856,6 +886,12 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
             }
         }
     }
+}
+
+void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
+{
+    auto& blasBuilds = m_dynamicBlasBuilds;
+    m_dynamicBLASes.reserve(blasBuilds.size());
 
     auto* device = App::GetRenderer().GetDevice();
     uint32_t currBuildSizeInBytes = 0;
@@ -865,7 +901,7 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
     {
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
         buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
+        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD, b.Deformable);
         buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
         buildDesc.Inputs.NumDescs = 1;
         buildDesc.Inputs.pGeometryDescs = &b.GeoDesc;
@@ -890,7 +926,8 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
             .PageOffset = b.BlasBufferOffset,
             .TreeLevel = b.TreeLevel,
             .LevelIdx = b.LevelIdx,
-            .InstanceID = UINT32_MAX });
+            .InstanceID = UINT32_MAX,
+            .UpdateScratchSizeInBytes = b.Deformable ? (uint32_t)b.BuildInfo.UpdateScratchDataSizeInBytes : 0 });
     }
 
     Assert(m_dynamicBLASArenas.empty(), "bug");
@@ -921,7 +958,7 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
     {
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
         buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
+        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD, b.Deformable);
         buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
         buildDesc.Inputs.NumDescs = 1;
         buildDesc.Inputs.pGeometryDescs = &b.GeoDesc;
@@ -940,8 +977,6 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
 
 void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
 {
-    SceneCore& scene = App::GetScene();
-
     // From Ray Tracing Gems 1 Chapter 19:
     // "One important optimization is to ensure that any resource transition barriers that
     // are needed after BLAS updates are deferred to be executed right before the
@@ -951,7 +986,6 @@ void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
     // avoids redundant synchronization that would otherwise cause the GPU to frequently
     // become idle."
     SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator> uavBarriers;
-    const bool staticBLASReady = !scene.m_numStaticInstances || m_staticBLASCompacted;
 
     // Compacting static BLAS requires two CPU-GPU synchronizations that'll likely
     // span multiple frames and has the following steps:
@@ -962,12 +996,13 @@ void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
     //    compacted size. Then, record a command for compaction operation (on GPU).
     // 4. Wait for GPU to finish step 3
     // 5. Replace BLAS from step 1 with the new compacted BLAS 
-    if (!staticBLASReady || m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
+    if (m_rebuildStaticBLAS || (!m_staticBLASCompacted && m_staticBLAS.m_buffer.IsInitialized()))
     {
-        // Step 1
-        if (!m_staticBLAS.m_buffer.IsInitialized() || m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
+        // Step 1 (prepared in Update())
+        if (m_rebuildStaticBLAS)
         {
             m_staticBLAS.Rebuild(cmdList);
+            m_rebuildStaticBLAS = false;
 
             const D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(m_staticBLAS.m_buffer.Resource(),
                 D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
@@ -1029,7 +1064,7 @@ void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
     }
 
     // Once in the first frame
-    if (m_rebuildDynamicBLASes && scene.m_numDynamicInstances)
+    if (m_rebuildDynamicBLASes && !m_dynamicBlasBuilds.empty())
     {
         BuildDynamicBLASes(cmdList);
 
@@ -1042,42 +1077,14 @@ void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
 
         uavBarriers.push_back(barrier);
     }
+    // BLASes that were just built already have the deformed vertices
+    else if (!m_refits.empty())
+        RefitDeformedBLASes(cmdList, uavBarriers);
 
-    if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC && scene.m_numDynamicInstances)
+    // Prepared in Update()
+    if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC && !m_dynamicBlasBuilds.empty())
     {
-        Assert(!scene.m_pendingRtMeshModeSwitch.empty(), "Unexpected condition.");
-
-        SmallVector<DynamicBlasBuild, SystemAllocator, 3> builds;
-        builds.reserve(scene.m_pendingRtMeshModeSwitch.size());
-
-        for (auto instance : scene.m_pendingRtMeshModeSwitch)
-        {
-            const auto treePos = scene.FindTreePosFromID(instance).value();
-            const auto meshID = scene.m_sceneGraph[treePos.Level].m_meshIDs[treePos.Offset];
-
-            const TriangleMesh* mesh = scene.GetMesh(meshID).value();
-            const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
-            const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
-
-            DynamicBlasBuild build;
-            build.GeoDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-            build.GeoDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
-            build.GeoDesc.Triangles.IndexBuffer = sceneIBGpuVa + mesh->m_idxBuffStartOffset * sizeof(uint32_t);
-            build.GeoDesc.Triangles.IndexCount = mesh->m_numIndices;
-            build.GeoDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-            build.GeoDesc.Triangles.Transform3x4 = 0;
-            build.GeoDesc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa +
-                mesh->m_vtxBuffStartOffset * sizeof(Vertex);
-            build.GeoDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
-            build.GeoDesc.Triangles.VertexCount = mesh->m_numVertices;
-            build.GeoDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-
-            build.TreeLevel = treePos.Level;
-            build.LevelIdx = treePos.Offset;
-
-            builds.push_back(build);
-        }
-
+        auto& builds = m_dynamicBlasBuilds;
         uint32_t totalScratchDataSizeInBytes = 0;
 
         for (auto& b : builds)
@@ -1202,45 +1209,178 @@ void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
     if (!uavBarriers.empty())
         cmdList.ResourceBarrier(uavBarriers.data(), (uint32_t)uavBarriers.size());
 
+    m_dynamicBlasBuilds.clear();
     m_rebuildDynamicBLASes = false;
 }
 
-void TLAS::UpdateTLASInstances(ComputeCmdList& cmdList)
+void TLAS::PrepareStaticToDynamicBLASBuilds()
 {
-    // When static BLAS is compacted, the GPU buffer changes and static BLAS instance
-    // below also changes, which requires TLAS instance buffer to be updated.
-    if (m_updateType == UPDATE_TYPE::NONE && m_tlasInstanceBuffer.IsInitialized())
-        return;
+    SceneCore& scene = App::GetScene();
+    Assert(!scene.m_pendingRtMeshModeSwitch.empty(), "Unexpected condition.");
+
+    auto& builds = m_dynamicBlasBuilds;
+    builds.clear();
+    builds.reserve(scene.m_pendingRtMeshModeSwitch.size());
 
+    for (auto instance : scene.m_pendingRtMeshModeSwitch)
+    {
+        const auto treePos = scene.FindTreePosFromID(instance).value();
+        const auto meshID = scene.m_sceneGraph[treePos.Level].m_meshIDs[treePos.Offset];
+
+        const TriangleMesh* mesh = scene.GetMesh(meshID).value();
+        const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
+        const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
+
+        DynamicBlasBuild build;
+        build.GeoDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+        build.GeoDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
+        build.GeoDesc.Triangles.IndexBuffer = sceneIBGpuVa + mesh->m_idxBuffStartOffset * sizeof(uint32_t);
+        build.GeoDesc.Triangles.IndexCount = mesh->m_numIndices;
+        build.GeoDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+        build.GeoDesc.Triangles.Transform3x4 = 0;
+        build.GeoDesc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa +
+            mesh->m_vtxBuffStartOffset * sizeof(Vertex);
+        build.GeoDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
+        build.GeoDesc.Triangles.VertexCount = mesh->m_numVertices;
+        build.GeoDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+
+        build.TreeLevel = treePos.Level;
+        build.LevelIdx = treePos.Offset;
+
+        builds.push_back(build);
+    }
+}
+
+void TLAS::PrepareDeformedBLASRefits()
+{
     SceneCore& scene = App::GetScene();
-    const uint32_t numInstances = scene.m_numDynamicInstances + (scene.m_numStaticInstances > 0);
-    if (numInstances == 0)
+    auto& refits = m_refits;
+    refits.clear();
+
+    // Skinned meshes that were deformed this frame. Their vertices have been uploaded to
+    // the scene vertex buffer during scene update.
+    Span<BVH::BVHUpdateInput> deformed = scene.GetSkinnedMeshBoundsUpdates();
+    if (deformed.empty())
         return;
 
-    // Following order is important, STATIC_TO_DYNAMIC should supercede INSTANCE_TRANSFORM
-    if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC || !m_tlasInstanceBuffer.IsInitialized())
+    refits.reserve(deformed.size());
+    const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
+    const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
+    uint32_t totalScratchSizeInBytes = 0;
+
+    for (auto& d : deformed)
     {
-        RebuildTLASInstances(cmdList);
-        scene.m_pendingRtMeshModeSwitch.clear();
+        const auto treePos = scene.FindTreePosFromID(d.InstanceID).value();
+
+        // Sorted by tree position
+        auto it = std::lower_bound(m_dynamicBLASes.begin(), m_dynamicBLASes.end(), treePos,
+            [](const DynamicBLAS& blas, const SceneCore::TreePos& p)
+            {
+                return blas.TreeLevel < p.Level || (blas.TreeLevel == p.Level && blas.LevelIdx < p.Offset);
+            });
+
+        if (it == m_dynamicBLASes.end() || it->TreeLevel != treePos.Level || it->LevelIdx != treePos.Offset ||
+            it->UpdateScratchSizeInBytes == 0)
+        {
+            continue;
+        }
+
+        const uint64_t meshID = scene.m_sceneGraph[treePos.Level].m_meshIDs[treePos.Offset];
+        const TriangleMesh* mesh = scene.GetMesh(meshID).value();
+
+        Refit r;
+        r.GeoDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+        r.GeoDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
+        r.GeoDesc.Triangles.IndexBuffer = sceneIBGpuVa + mesh->m_idxBuffStartOffset * sizeof(uint32_t);
+        r.GeoDesc.Triangles.IndexCount = mesh->m_numIndices;
+        r.GeoDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+        r.GeoDesc.Triangles.Transform3x4 = 0;
+        r.GeoDesc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa +
+            mesh->m_vtxBuffStartOffset * sizeof(Vertex);
+        r.GeoDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
+        r.GeoDesc.Triangles.VertexCount = mesh->m_numVertices;
+        r.GeoDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+        r.BlasIdx = (uint32_t)(it - m_dynamicBLASes.begin());
+
+        totalScratchSizeInBytes = AlignUp(totalScratchSizeInBytes,
+            (uint32_t)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+        r.ScratchBufferOffset = totalScratchSizeInBytes;
+        totalScratchSizeInBytes += it->UpdateScratchSizeInBytes;
+
+        refits.push_back(r);
     }
-    else if (m_updateType == UPDATE_TYPE::STATIC_BLAS_COMPACTED)
-        UpdateTLASInstances_StaticCompacted(cmdList);
-    else if (m_updateType == UPDATE_TYPE::INSTANCE_TRANSFORM)
-        UpdateTLASInstances_NewTransform(cmdList);
-    else
-        Assert(false, "Unreachable case.");
 
-    // Wait for copy to be finished before doing compute work
-    auto barrier = Direct3DUtil::BufferBarrier(m_tlasInstanceBuffer.Resource(),
-        D3D12_BARRIER_SYNC_COPY,
-        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
-        D3D12_BARRIER_ACCESS_COPY_DEST,
-        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    m_refitScratchSizeInBytes = totalScratchSizeInBytes;
+}
 
-    cmdList.ResourceBarrier(barrier);
+void TLAS::RefitDeformedBLASes(ComputeCmdList& cmdList,
+    SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator>& uavBarriers)
+{
+    // BlasIdx is still valid as m_dynamicBLASes is only modified after the refits are recorded
+    // (by static-to-dynamic builds)
+    Assert(!m_refits.empty(), "Invalid call.");
+
+    // Separate from the build scratch buffer, which may be in use by builds earlier in
+    // this command list
+    if (!m_refitScratchBuffer.IsInitialized() ||
+        m_refitScratchBuffer.Desc().Width < m_refitScratchSizeInBytes)
+    {
+        m_refitScratchBuffer = GpuMemory::GetDefaultHeapBuffer("DynamicBLAS_refit_scratch",
+            AlignUp(m_refitScratchSizeInBytes, (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+            D3D12_RESOURCE_STATE_COMMON,
+            true);
+    }
+
+    SmallVector<int, App::FrameAllocator, 3> touchedPages;
+    cmdList.PIXBeginEvent("DynamicBLASRefit");
+
+    for (auto& r : m_refits)
+    {
+        const DynamicBLAS& blas = m_dynamicBLASes[r.BlasIdx];
+        const D3D12_GPU_VIRTUAL_ADDRESS blasVa = m_dynamicBLASArenas[blas.PageIdx].Page.GpuVA() +
+            blas.PageOffset;
+
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc{};
+        buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD, true) |
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+        buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        buildDesc.Inputs.NumDescs = 1;
+        buildDesc.Inputs.pGeometryDescs = &r.GeoDesc;
+        // In-place update
+        buildDesc.DestAccelerationStructureData = blasVa;
+        buildDesc.SourceAccelerationStructureData = blasVa;
+        buildDesc.ScratchAccelerationStructureData = m_refitScratchBuffer.GpuVA() +
+            r.ScratchBufferOffset;
+
+        cmdList.BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+        touchedPages.push_back(blas.PageIdx);
+    }
+
+    cmdList.PIXEndEvent();
+    m_refits.clear();
+
+    // Insert a barrier for every used page
+    if (touchedPages.size() > 1)
+        std::sort(touchedPages.begin(), touchedPages.end());
+
+    for (int i = 0; i < (int)touchedPages.size(); i++)
+    {
+        if (i == 0 || touchedPages[i] != touchedPages[i - 1])
+        {
+            D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(
+                m_dynamicBLASArenas[touchedPages[i]].Page.Resource(),
+                D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
+                D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
+                D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+
+            uavBarriers.push_back(barrier);
+        }
+    }
 }
 
-void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
+void TLAS::FillTLASInstances()
 {
     SceneCore& scene = App::GetScene();
     const uint32_t numStaticInstances = scene.m_numStaticInstances;
@@ -1248,13 +1388,13 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
 
     m_tlasInstances.resize(numInstances);
 
+    // AccelerationStructure is filled in by RebuildTLASInstances()
     if (numStaticInstances)
     {
         m_tlasInstances[0].InstanceID = 0;
         m_tlasInstances[0].InstanceMask = RT_AS_SUBGROUP::ALL;
         m_tlasInstances[0].InstanceContributionToHitGroupIndex = 0;
         m_tlasInstances[0].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        m_tlasInstances[0].AccelerationStructure = m_staticBLAS.m_buffer.GpuVA();
 
         // Identity transform for static BLAS instance
         memset(&m_tlasInstances[0].Transform, 0, sizeof(BLASTransform));
@@ -1263,7 +1403,7 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
         m_tlasInstances[0].Transform[2][2] = 1.0f;
     }
 
-    // Following traversal order must match the one in RebuildOrUpdateBLASes()
+    // Following traversal order must match the one in PrepareDynamicBLASBuilds()
     uint32_t currDynamicInstance = 0;
 
     // Skip the first level
@@ -1284,17 +1424,12 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
 
                 if (flags.MeshMode != RT_MESH_MODE::STATIC)
                 {
-                    auto& blas = m_dynamicBLASes[currDynamicInstance];
-                    blas.InstanceID = numStaticInstances + currDynamicInstance;
-
                     D3D12_RAYTRACING_INSTANCE_DESC instance;
-                    instance.InstanceID = blas.InstanceID;
+                    instance.InstanceID = numStaticInstances + currDynamicInstance;
                     instance.InstanceMask = flags.InstanceMask;
                     instance.InstanceContributionToHitGroupIndex = 0;
                     instance.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-                    instance.AccelerationStructure = 
-                        m_dynamicBLASArenas[blas.PageIdx].Page.GpuVA() +
-                        blas.PageOffset;
+                    instance.AccelerationStructure = 0;
 
                     auto& M = currTreeLevel.m_toWorlds[i];
 
@@ -1315,9 +1450,84 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
         }
     }
 
-    // When static BLAS is compacted but otherwise no other changes, only the 1st instance
-    // needs to be updated
     Assert((numStaticInstances > 0) + currDynamicInstance == numInstances, "bug");
+}
+
+void TLAS::UpdateTLASInstances(ComputeCmdList& cmdList)
+{
+    bool copied = false;
+
+    if (m_rebuildTLASInstances)
+    {
+        RebuildTLASInstances(cmdList);
+        m_rebuildTLASInstances = false;
+        copied = true;
+    }
+    else
+    {
+        // When static BLAS is compacted, the GPU buffer changes and static BLAS instance
+        // below also changes, which requires TLAS instance buffer to be updated.
+        if (m_updateType == UPDATE_TYPE::STATIC_BLAS_COMPACTED && !m_tlasInstances.empty())
+        {
+            UpdateTLASInstances_StaticCompacted(cmdList);
+            copied = true;
+        }
+
+        // Instances that were modified by UpdateTLASInstances_NewTransform()
+        if (m_modifiedTlasInstancesEnd > m_modifiedTlasInstancesBegin)
+        {
+            const uint32_t numInstancesToCopy = m_modifiedTlasInstancesEnd - m_modifiedTlasInstancesBegin;
+            const uint32_t sizeInBytes = numInstancesToCopy * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+
+            UploadHeapBuffer scratchBuff = GpuMemory::GetUploadHeapBuffer(sizeInBytes);
+            scratchBuff.Copy(0, sizeInBytes, m_tlasInstances.data() + m_modifiedTlasInstancesBegin);
+
+            cmdList.CopyBufferRegion(m_tlasInstanceBuffer.Resource(),
+                m_modifiedTlasInstancesBegin * sizeof(D3D12_RAYTRACING_INSTANCE_DESC),
+                scratchBuff.Resource(),
+                scratchBuff.Offset(),
+                sizeInBytes);
+
+            m_modifiedTlasInstancesBegin = 0;
+            m_modifiedTlasInstancesEnd = 0;
+            copied = true;
+        }
+    }
+
+    if (!copied)
+        return;
+
+    // Wait for copy to be finished before doing compute work
+    auto barrier = Direct3DUtil::BufferBarrier(m_tlasInstanceBuffer.Resource(),
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_COPY_DEST,
+        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+
+    cmdList.ResourceBarrier(barrier);
+}
+
+void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
+{
+    // Instances were filled in by FillTLASInstances(), except for the BLAS addresses, 
+    // which aren't known until the BLASes are built
+    const uint32_t numInstances = (uint32_t)m_tlasInstances.size();
+    const uint32_t firstDynamicInstance = numInstances - (uint32_t)m_dynamicBLASes.size();
+    Assert(numInstances >= m_dynamicBLASes.size() && firstDynamicInstance <= 1, "bug");
+
+    if (firstDynamicInstance)
+        m_tlasInstances[0].AccelerationStructure = m_staticBLAS.m_buffer.GpuVA();
+
+    for (uint32_t i = 0; i < (uint32_t)m_dynamicBLASes.size(); i++)
+    {
+        auto& blas = m_dynamicBLASes[i];
+        auto& instance = m_tlasInstances[firstDynamicInstance + i];
+
+        blas.InstanceID = instance.InstanceID;
+        instance.AccelerationStructure = m_dynamicBLASArenas[blas.PageIdx].Page.GpuVA() +
+            blas.PageOffset;
+    }
+
     const uint32_t sizeInBytes = sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * numInstances;
 
     const uint32_t alignedSizeInBytes = AlignUp(sizeInBytes,
@@ -1342,10 +1552,6 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
 
 void TLAS::UpdateTLASInstances_StaticCompacted(ComputeCmdList& cmdList)
 {
-    SceneCore& scene = App::GetScene();
-    Assert(scene.m_numStaticInstances, "Invalid call.");
-
-    m_tlasInstances.resize(Max(m_tlasInstances.size(), 1llu));
 
     m_tlasInstances[0].InstanceID = 0;
     m_tlasInstances[0].InstanceMask = RT_AS_SUBGROUP::ALL;
@@ -1382,7 +1588,7 @@ void TLAS::UpdateTLASInstances_StaticCompacted(ComputeCmdList& cmdList)
         sizeInBytes);
 }
 
-void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
+void TLAS::UpdateTLASInstances_NewTransform()
 {
     auto& scene = App::GetScene();
     const auto currFrame = App::GetTimer().GetTotalFrameCount();
@@ -1447,19 +1653,9 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
     Assert(!hadUpdates || minIdx <= maxIdx, "Invalid range.");
     if (hadUpdates)
     {
-        const size_t numInstancesToCopy = maxIdx - minIdx + 1;
-        const size_t sizeInBytes = numInstancesToCopy * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
-
-        UploadHeapBuffer scratchBuff = GpuMemory::GetUploadHeapBuffer((uint32)sizeInBytes);
-        // + 1 to skip static instance
-        minIdx++;
-        scratchBuff.Copy(0, (uint32)sizeInBytes, m_tlasInstances.data() + minIdx);
-
-        cmdList.CopyBufferRegion(m_tlasInstanceBuffer.Resource(),
-            minIdx * sizeof(D3D12_RAYTRACING_INSTANCE_DESC),
-            scratchBuff.Resource(),
-            scratchBuff.Offset(),
-            sizeInBytes);
+        // Uploaded in UpdateTLASInstances(). + 1 to skip static instance.
+        m_modifiedTlasInstancesBegin = (uint32_t)minIdx + 1;
+        m_modifiedTlasInstancesEnd = (uint32_t)maxIdx + 2;
     }
 
     for (auto it = scene.m_instanceUpdates.begin_it(); it != scene.m_instanceUpdates.end_it();
@@ -1483,9 +1679,7 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
 
 void TLAS::RebuildTLAS(ComputeCmdList& cmdList)
 {
-    SceneCore& scene = App::GetScene();
-
-    const uint32_t numInstances = scene.m_numDynamicInstances + (scene.m_numStaticInstances > 0);
+    const uint32_t numInstances = (uint32_t)m_tlasInstances.size();
     if (numInstances == 0)
         return;
 
@@ -25,6 +25,9 @@ namespace ZetaRay::RT
 
     struct StaticBLAS
     {
+        // Gathers the static meshes and updates their RT-AS info. Followed by Rebuild(), 
+        // which records the build.
+        void PrepareRebuild();
         void Rebuild(Core::ComputeCmdList& cmdList);
         void DoCompaction(Core::ComputeCmdList& cmdList);
         void CompactionCompletedCallback();
@@ -41,6 +44,9 @@ namespace ZetaRay::RT
         // 3x4 affine transformation matrix for each triangle mesh
         Core::GpuMemory::Buffer m_perMeshTransform;
 
+        // Geometry of every static mesh for the pending rebuild
+        Util::SmallVector<D3D12_RAYTRACING_GEOMETRY_DESC> m_meshDescs;
+
         // Cache the results as it's expensive to compute
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO m_prebuildInfo = {};
 
@@ -57,6 +63,9 @@ namespace ZetaRay::RT
 
     struct TLAS
     {
+        // Everything that reads or modifies the scene happens here, Render() only records the 
+        // commands. That way, the scene can simulate the next frame while this one is being
+        // recorded.
         void Update();
         void Render(Core::CommandList& cmdList);
         ZetaInline const Core::GpuMemory::Buffer& GetTLAS() const { return m_tlasBuffer[m_frameIdx];  };
@@ -78,6 +87,27 @@ namespace ZetaRay::RT
             uint32_t TreeLevel;
             uint32_t LevelIdx;
             uint32_t InstanceID;
+            // Non-zero for BLASes of deformable meshes, which are refitted every frame
+            uint32_t UpdateScratchSizeInBytes = 0;
+        };
+
+        struct DynamicBlasBuild
+        {
+            D3D12_RAYTRACING_GEOMETRY_DESC GeoDesc;
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO BuildInfo;
+            uint32_t BlasBufferOffset;
+            uint32_t ScratchBufferOffset;
+            uint32_t TreeLevel;
+            uint32_t LevelIdx;
+            // Skinned or morphed, refitted every frame
+            bool Deformable = false;
+        };
+
+        struct Refit
+        {
+            D3D12_RAYTRACING_GEOMETRY_DESC GeoDesc;
+            uint32_t BlasIdx;
+            uint32_t ScratchBufferOffset;
         };
 
         enum class UPDATE_TYPE
@@ -96,14 +126,21 @@ namespace ZetaRay::RT
         void UpdateFrameMeshInstances_NewTransform();
 
         // BLASes
+        void PrepareDynamicBLASBuilds();
         void BuildDynamicBLASes(Core::ComputeCmdList& cmdList);
         void RebuildOrUpdateBLASes(Core::ComputeCmdList& cmdList);
+        void PrepareStaticToDynamicBLASBuilds();
+        void PrepareDeformedBLASRefits();
+        // Barriers for the refitted BLASes are appended to uavBarriers
+        void RefitDeformedBLASes(Core::ComputeCmdList& cmdList,
+            Util::SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator>& uavBarriers);
 
         // TLAS instances
+        void FillTLASInstances();
+        void UpdateTLASInstances_NewTransform();
         void UpdateTLASInstances(Core::ComputeCmdList& cmdList);
         void RebuildTLASInstances(Core::ComputeCmdList& cmdList);
         void UpdateTLASInstances_StaticCompacted(Core::ComputeCmdList& cmdList);
-        void UpdateTLASInstances_NewTransform(Core::ComputeCmdList& cmdList);
 
         void RebuildTLAS(Core::ComputeCmdList& cmdList);
 
@@ -111,6 +148,7 @@ namespace ZetaRay::RT
         Core::GpuMemory::Buffer m_framesMeshInstances[2];
         Core::GpuMemory::Buffer m_tlasBuffer[2];
         Core::GpuMemory::Buffer m_scratchBuffer;
+        Core::GpuMemory::Buffer m_refitScratchBuffer;
         Core::GpuMemory::Buffer m_tlasInstanceBuffer;
         Core::GpuMemory::ResourceHeap m_tlasResHeap;
         Core::GpuMemory::ResourceHeap m_meshInstanceResHeap;
@@ -122,6 +160,16 @@ namespace ZetaRay::RT
         Util::SmallVector<RT::MeshInstance> m_frameInstanceData;
         Util::SmallVector<D3D12_RAYTRACING_INSTANCE_DESC, Support::SystemAllocator, 1> m_tlasInstances;
 
+        // Prepared in Update() and recorded in Render()
+        Util::SmallVector<DynamicBlasBuild> m_dynamicBlasBuilds;
+        Util::SmallVector<Refit> m_refits;
+        uint32_t m_refitScratchSizeInBytes = 0;
+        // Range of m_tlasInstances with new transforms, [begin, end)
+        uint32_t m_modifiedTlasInstancesBegin = 0;
+        uint32_t m_modifiedTlasInstancesEnd = 0;
+        bool m_rebuildStaticBLAS = false;
+        bool m_rebuildTLASInstances = false;
+
         Support::WaitObject m_waitObj;
         std::atomic_bool m_compactionInfoReady = false;
         bool m_staticBLASCompacted = false;
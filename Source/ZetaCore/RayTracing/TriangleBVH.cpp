@@ -0,0 +1,535 @@
+#include "TriangleBVH.h"
+#include <algorithm>
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    static constexpr uint32_t NUM_BINS = 16;
+
+    ZetaInline float Component(const float3& v, int axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    ZetaInline float3 Min3(const float3& a, const float3& b)
+    {
+        return float3(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z));
+    }
+
+    ZetaInline float3 Max3(const float3& a, const float3& b)
+    {
+        return float3(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z));
+    }
+
+    ZetaInline float HalfArea(const float3& boxMin, const float3& boxMax)
+    {
+        if (boxMin.x > boxMax.x)
+            return 0.0f;
+
+        const float3 d = boxMax - boxMin;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    struct BVHBuilder
+    {
+        uint32_t BuildNode(uint32_t base, uint32_t count, int depth);
+
+        MutableSpan<BVHPrim> Prims;
+        SmallVector<BVHNode>& Nodes;
+        uint32_t MaxPrimsPerLeaf;
+    };
+
+    uint32_t BVHBuilder::BuildNode(uint32_t base, uint32_t count, int depth)
+    {
+        const uint32_t nodeIdx = (uint32_t)Nodes.size();
+        Nodes.emplace_back();
+
+        float3 boxMin(FLT_MAX);
+        float3 boxMax(-FLT_MAX);
+        float3 centMin(FLT_MAX);
+        float3 centMax(-FLT_MAX);
+
+        for (uint32_t i = base; i < base + count; i++)
+        {
+            boxMin = Min3(boxMin, Prims[i].BoxMin);
+            boxMax = Max3(boxMax, Prims[i].BoxMax);
+            centMin = Min3(centMin, Prims[i].Centroid);
+            centMax = Max3(centMax, Prims[i].Centroid);
+        }
+
+        auto makeLeaf = [&]()
+            {
+                BVHNode& node = Nodes[nodeIdx];
+                node.BoxMin = boxMin;
+                node.BoxMax = boxMax;
+                node.Offset = base;
+                node.Count = (uint16_t)count;
+                node.Axis = 0;
+
+                return nodeIdx;
+            };
+
+        if (count <= MaxPrimsPerLeaf)
+            return makeLeaf();
+
+        const float3 extent = centMax - centMin;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        const float axisMin = Component(centMin, axis);
+        const float axisExtent = Component(extent, axis);
+        uint32_t mid = base;
+
+        // Binned SAH. Close to maximum depth, switch to median splits to bound the depth.
+        if (axisExtent > 0 && depth < TriangleBVH::MAX_DEPTH - 24)
+        {
+            struct Bin
+            {
+                float3 BoxMin = float3(FLT_MAX);
+                float3 BoxMax = float3(-FLT_MAX);
+                uint32_t Count = 0;
+            };
+
+            Bin bins[NUM_BINS];
+            const float scale = NUM_BINS / axisExtent;
+
+            auto binIdx = [&](const BVHPrim& p)
+                {
+                    const uint32_t b = (uint32_t)((Component(p.Centroid, axis) - axisMin) * scale);
+                    return Min(b, NUM_BINS - 1);
+                };
+
+            for (uint32_t i = base; i < base + count; i++)
+            {
+                Bin& b = bins[binIdx(Prims[i])];
+                b.BoxMin = Min3(b.BoxMin, Prims[i].BoxMin);
+                b.BoxMax = Max3(b.BoxMax, Prims[i].BoxMax);
+                b.Count++;
+            }
+
+            // Sweep from right to left to compute cost of the right side for every split
+            float rightCost[NUM_BINS - 1];
+            float3 rMin(FLT_MAX);
+            float3 rMax(-FLT_MAX);
+            uint32_t rCount = 0;
+
+            for (int i = NUM_BINS - 1; i > 0; i--)
+            {
+                rMin = Min3(rMin, bins[i].BoxMin);
+                rMax = Max3(rMax, bins[i].BoxMax);
+                rCount += bins[i].Count;
+                rightCost[i - 1] = HalfArea(rMin, rMax) * rCount;
+            }
+
+            float3 lMin(FLT_MAX);
+            float3 lMax(-FLT_MAX);
+            uint32_t lCount = 0;
+            float bestCost = FLT_MAX;
+            int bestSplit = -1;
+
+            for (int i = 0; i < NUM_BINS - 1; i++)
+            {
+                lMin = Min3(lMin, bins[i].BoxMin);
+                lMax = Max3(lMax, bins[i].BoxMax);
+                lCount += bins[i].Count;
+                const float cost = HalfArea(lMin, lMax) * lCount + rightCost[i];
+
+                if (lCount > 0 && lCount < count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = i;
+                }
+            }
+
+            // Relative to cost of intersecting every primitive, assuming traversal
+            // step is 8x cheaper than a primitive test
+            const float leafCost = (float)count;
+            bestCost = 0.125f + bestCost / HalfArea(boxMin, boxMax);
+
+            if (bestSplit != -1 && (bestCost < leafCost || count > UINT16_MAX))
+            {
+                BVHPrim* midPtr = std::partition(Prims.begin() + base, Prims.begin() + base + count,
+                    [&](const BVHPrim& p)
+                    {
+                        return (int)binIdx(p) <= bestSplit;
+                    });
+
+                mid = (uint32_t)(midPtr - Prims.begin());
+            }
+            else if (count <= UINT16_MAX)
+                return makeLeaf();
+        }
+
+        // Fall back to splitting in the middle
+        if (mid == base || mid == base + count)
+        {
+            mid = base + count / 2;
+            std::nth_element(Prims.begin() + base, Prims.begin() + mid, Prims.begin() + base + count,
+                [axis](const BVHPrim& a, const BVHPrim& b)
+                {
+                    return Component(a.Centroid, axis) < Component(b.Centroid, axis);
+                });
+        }
+
+        BuildNode(base, mid - base, depth + 1);
+        const uint32_t right = BuildNode(mid, base + count - mid, depth + 1);
+
+        BVHNode& node = Nodes[nodeIdx];
+        node.BoxMin = boxMin;
+        node.BoxMax = boxMax;
+        node.Offset = right;
+        node.Count = 0;
+        node.Axis = (uint16_t)axis;
+
+        return nodeIdx;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// BVH construction
+//--------------------------------------------------------------------------------------
+
+void RT::BuildBVH(MutableSpan<BVHPrim> prims, SmallVector<BVHNode>& nodes, uint32_t maxPrimsPerLeaf)
+{
+    Assert(maxPrimsPerLeaf > 0 && maxPrimsPerLeaf <= UINT16_MAX, "Invalid leaf size.");
+    nodes.clear();
+
+    if (prims.empty())
+        return;
+
+    // Upper bound is 2n - 1 nodes
+    nodes.reserve(2 * prims.size());
+
+    BVHBuilder builder{ .Prims = prims, .Nodes = nodes, .MaxPrimsPerLeaf = maxPrimsPerLeaf };
+    builder.BuildNode(0, (uint32_t)prims.size(), 0);
+}
+
+//--------------------------------------------------------------------------------------
+// TriangleBVH
+//--------------------------------------------------------------------------------------
+
+TriangleBVH::RayData::RayData(const Ray& ray)
+    : Origin(ray.Origin)
+{
+    InvDir = float3(1.0f / ray.Dir.x, 1.0f / ray.Dir.y, 1.0f / ray.Dir.z);
+    DirIsNeg[0] = ray.Dir.x < 0;
+    DirIsNeg[1] = ray.Dir.y < 0;
+    DirIsNeg[2] = ray.Dir.z < 0;
+
+    // Permute so that z is the dimension where ray direction is largest
+    const float3 absDir(fabsf(ray.Dir.x), fabsf(ray.Dir.y), fabsf(ray.Dir.z));
+    Kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+    Kx = Kz == 2 ? 0 : Kz + 1;
+    Ky = Kx == 2 ? 0 : Kx + 1;
+
+    // Preserve winding
+    if (Component(ray.Dir, Kz) < 0)
+        std::swap(Kx, Ky);
+
+    const float dz = Component(ray.Dir, Kz);
+    Sx = Component(ray.Dir, Kx) / dz;
+    Sy = Component(ray.Dir, Ky) / dz;
+    Sz = 1.0f / dz;
+}
+
+template<typename GetVertexFn>
+void TriangleBVH::BuildImpl(uint32_t numTris, GetVertexFn getVertex)
+{
+    Clear();
+    if (numTris == 0)
+        return;
+
+    SmallVector<BVHPrim> prims;
+    prims.resize(numTris);
+
+    for (uint32_t i = 0; i < numTris; i++)
+    {
+        const float3 v0 = getVertex(i, 0);
+        const float3 v1 = getVertex(i, 1);
+        const float3 v2 = getVertex(i, 2);
+
+        BVHPrim& p = prims[i];
+        p.BoxMin = Min3(v0, Min3(v1, v2));
+        p.BoxMax = Max3(v0, Max3(v1, v2));
+        p.Centroid = 0.5f * (p.BoxMin + p.BoxMax);
+        p.Index = i;
+    }
+
+    BuildBVH(prims, m_nodes, MAX_NUM_TRIS_PER_LEAF);
+
+    // Pack leaf triangles into groups of four
+    m_packets.reserve(CeilUnsignedIntDiv(numTris, PACKET_SIZE) + m_nodes.size() / 2);
+    m_triIndices.reserve(m_packets.capacity() * PACKET_SIZE);
+
+    for (auto& node : m_nodes)
+    {
+        if (!node.IsLeaf())
+            continue;
+
+        const uint32_t base = node.Offset;
+        const uint32_t count = node.Count;
+        node.Offset = (uint32_t)m_packets.size();
+
+        for (uint32_t i = 0; i < count; i += PACKET_SIZE)
+        {
+            alignas(16) float v[3][3][PACKET_SIZE];
+
+            for (uint32_t lane = 0; lane < PACKET_SIZE; lane++)
+            {
+                const uint32_t tri = prims[base + Min(i + lane, count - 1)].Index;
+                m_triIndices.push_back(i + lane < count ? tri : INVALID_TRI);
+
+                for (int j = 0; j < 3; j++)
+                {
+                    const float3 vtx = getVertex(tri, j);
+                    v[j][0][lane] = vtx.x;
+                    v[j][1][lane] = vtx.y;
+                    v[j][2][lane] = vtx.z;
+                }
+            }
+
+            m_packets.emplace_back();
+            TrianglePacket& packet = m_packets.back();
+
+            for (int j = 0; j < 3; j++)
+            {
+                for (int k = 0; k < 3; k++)
+                    packet.V[j][k] = _mm_load_ps(v[j][k]);
+            }
+        }
+    }
+
+    m_numTris = numTris;
+}
+
+void TriangleBVH::Build(Span<float3> positions)
+{
+    Assert(positions.size() % 3 == 0, "Number of positions must be a multiple of 3.");
+
+    BuildImpl((uint32_t)(positions.size() / 3), [positions](uint32_t tri, int j)
+        {
+            return positions[3 * tri + j];
+        });
+}
+
+void TriangleBVH::Build(const void* vertices, uint32_t vertexStride, uint32_t numVertices,
+    Span<uint32_t> indices)
+{
+    Assert(indices.size() % 3 == 0, "Number of indices must be a multiple of 3.");
+    Assert(vertexStride >= sizeof(float3), "Invalid vertex stride.");
+
+    BuildImpl((uint32_t)(indices.size() / 3), [vertices, vertexStride, numVertices, indices](uint32_t tri, int j)
+        {
+            const uint32_t idx = indices[3 * tri + j];
+            Assert(idx < numVertices, "Index out of bounds.");
+
+            float3 pos;
+            memcpy(&pos, reinterpret_cast<const uint8_t*>(vertices) + (size_t)idx * vertexStride,
+                sizeof(float3));
+
+            return pos;
+        });
+}
+
+void TriangleBVH::Clear()
+{
+    m_nodes.free_memory();
+    m_packets.free_memory();
+    m_triIndices.free_memory();
+    m_numTris = 0;
+}
+
+int TriangleBVH::IntersectPacket(const RayData& r, const TrianglePacket& packet, uint32_t numValid,
+    float tMax, float& t, float& u, float& v)
+{
+    // Translate vertices so that ray origin is at (0, 0, 0)
+    const __m128 vOx = _mm_set1_ps(Component(r.Origin, r.Kx));
+    const __m128 vOy = _mm_set1_ps(Component(r.Origin, r.Ky));
+    const __m128 vOz = _mm_set1_ps(Component(r.Origin, r.Kz));
+    const __m128 vSx = _mm_set1_ps(r.Sx);
+    const __m128 vSy = _mm_set1_ps(r.Sy);
+
+    __m128 vX[3];
+    __m128 vY[3];
+    __m128 vZ[3];
+
+    // Shear so that ray direction becomes (0, 0, 1)
+    for (int j = 0; j < 3; j++)
+    {
+        vZ[j] = _mm_sub_ps(packet.V[j][r.Kz], vOz);
+        vX[j] = _mm_fnmadd_ps(vSx, vZ[j], _mm_sub_ps(packet.V[j][r.Kx], vOx));
+        vY[j] = _mm_fnmadd_ps(vSy, vZ[j], _mm_sub_ps(packet.V[j][r.Ky], vOy));
+    }
+
+    // Scaled barycentrics
+    __m128 vU = _mm_fmsub_ps(vX[2], vY[1], _mm_mul_ps(vY[2], vX[1]));
+    __m128 vV = _mm_fmsub_ps(vX[0], vY[2], _mm_mul_ps(vY[0], vX[2]));
+    __m128 vW = _mm_fmsub_ps(vX[1], vY[0], _mm_mul_ps(vY[1], vX[0]));
+
+    const __m128 vValid = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(numValid),
+        _mm_setr_epi32(0, 1, 2, 3)));
+    const __m128 vZero = _mm_setzero_ps();
+
+    // Edge cases, fall back to double precision
+    const __m128 vOnEdge = _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(vU, vZero), _mm_cmpeq_ps(vV, vZero)),
+        _mm_cmpeq_ps(vW, vZero));
+
+    if (_mm_movemask_ps(_mm_and_ps(vOnEdge, vValid)))
+    {
+        // = a * b - c * d
+        auto edgeFunc = [](__m128 a, __m128 b, __m128 c, __m128 d)
+            {
+                const __m256d vAB = _mm256_mul_pd(_mm256_cvtps_pd(a), _mm256_cvtps_pd(b));
+                const __m256d vCD = _mm256_mul_pd(_mm256_cvtps_pd(c), _mm256_cvtps_pd(d));
+
+                return _mm256_cvtpd_ps(_mm256_sub_pd(vAB, vCD));
+            };
+
+        vU = edgeFunc(vX[2], vY[1], vY[2], vX[1]);
+        vV = edgeFunc(vX[0], vY[2], vY[0], vX[2]);
+        vW = edgeFunc(vX[1], vY[0], vY[1], vX[0]);
+    }
+
+    // Double-sided -- all the signs must match
+    const __m128 vAnyNeg = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(vU, vZero), _mm_cmplt_ps(vV, vZero)),
+        _mm_cmplt_ps(vW, vZero));
+    const __m128 vAnyPos = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(vU, vZero), _mm_cmpgt_ps(vV, vZero)),
+        _mm_cmpgt_ps(vW, vZero));
+    const __m128 vDet = _mm_add_ps(_mm_add_ps(vU, vV), vW);
+
+    __m128 vHit = _mm_andnot_ps(_mm_and_ps(vAnyNeg, vAnyPos), vValid);
+    vHit = _mm_and_ps(vHit, _mm_cmpneq_ps(vDet, vZero));
+
+    if (!_mm_movemask_ps(vHit))
+        return -1;
+
+    __m128 vT = _mm_mul_ps(vU, vZ[0]);
+    vT = _mm_fmadd_ps(vV, vZ[1], vT);
+    vT = _mm_fmadd_ps(vW, vZ[2], vT);
+    vT = _mm_div_ps(_mm_mul_ps(vT, _mm_set1_ps(r.Sz)), vDet);
+
+    vHit = _mm_and_ps(vHit, _mm_cmpgt_ps(vT, vZero));
+    vHit = _mm_and_ps(vHit, _mm_cmplt_ps(vT, _mm_set1_ps(tMax)));
+
+    int mask = _mm_movemask_ps(vHit);
+    if (!mask)
+        return -1;
+
+    alignas(16) float tLanes[4];
+    _mm_store_ps(tLanes, vT);
+
+    int closest = -1;
+    float tClosest = tMax;
+
+    while (mask)
+    {
+        const int lane = _tzcnt_u32(mask);
+        mask &= mask - 1;
+
+        if (tLanes[lane] < tClosest)
+        {
+            tClosest = tLanes[lane];
+            closest = lane;
+        }
+    }
+
+    alignas(16) float vLanes[4];
+    alignas(16) float wLanes[4];
+    alignas(16) float detLanes[4];
+    _mm_store_ps(vLanes, vV);
+    _mm_store_ps(wLanes, vW);
+    _mm_store_ps(detLanes, vDet);
+
+    const float rcpDet = 1.0f / detLanes[closest];
+    t = tClosest;
+    u = vLanes[closest] * rcpDet;
+    v = wLanes[closest] * rcpDet;
+
+    return closest;
+}
+
+template<bool AnyHit>
+bool TriangleBVH::Traverse(const Ray& ray, float tMax, TriangleHit& hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    const RayData r(ray);
+    uint32_t stack[MAX_DEPTH];
+    int stackSize = 0;
+    uint32_t curr = 0;
+    bool found = false;
+
+    while (true)
+    {
+        const BVHNode& node = m_nodes[curr];
+
+        if (IntersectRayBox(node.BoxMin, node.BoxMax, r.Origin, r.InvDir, tMax) != FLT_MAX)
+        {
+            if (node.IsLeaf())
+            {
+                const uint32_t count = node.Count;
+
+                for (uint32_t i = 0; i < count; i += PACKET_SIZE)
+                {
+                    const uint32_t packetIdx = node.Offset + i / PACKET_SIZE;
+                    float t, u, v;
+                    const int lane = IntersectPacket(r, m_packets[packetIdx], Min(count - i, PACKET_SIZE),
+                        tMax, t, u, v);
+
+                    if (lane != -1)
+                    {
+                        if constexpr (AnyHit)
+                            return true;
+
+                        tMax = t;
+                        hit.T = t;
+                        hit.Tri = m_triIndices[packetIdx * PACKET_SIZE + lane];
+                        hit.U = u;
+                        hit.V = v;
+                        found = true;
+                    }
+                }
+            }
+            else
+            {
+                // Visit the closer child first
+                const uint32_t left = curr + 1;
+                const uint32_t right = node.Offset;
+
+                if (r.DirIsNeg[node.Axis])
+                {
+                    stack[stackSize++] = left;
+                    curr = right;
+                }
+                else
+                {
+                    stack[stackSize++] = right;
+                    curr = left;
+                }
+
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            break;
+
+        curr = stack[--stackSize];
+    }
+
+    return found;
+}
+
+bool TriangleBVH::Intersect(const Ray& ray, float tMax, TriangleHit& hit) const
+{
+    return Traverse<false>(ray, tMax, hit);
+}
+
+bool TriangleBVH::Occluded(const Ray& ray, float tMax) const
+{
+    TriangleHit unused;
+    return Traverse<true>(ray, tMax, unused);
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+// References:
+// 1. S. Woop, C. Benthin and I. Wald, "Watertight Ray/Triangle Intersection," Journal of Computer
+//    Graphics Techniques, 2013.
+// 2. I. Wald, "On fast Construction of SAH-based Bounding Volume Hierarchies," IEEE Symposium on
+//    Interactive Ray Tracing, 2007.
+
+#pragma once
+
+#include "../Math/CollisionTypes.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::RT
+{
+    //--------------------------------------------------------------------------------------
+    // Binary BVH construction, shared between TriangleBVH and TwoLevelBVH
+    //--------------------------------------------------------------------------------------
+
+    struct BVHNode
+    {
+        ZetaInline bool IsLeaf() const { return Count != 0; }
+
+        Math::float3 BoxMin;
+        // Internal nodes: index of right child (left child immediately follows its parent)
+        // Leaves: offset of first primitive
+        uint32_t Offset;
+        Math::float3 BoxMax;
+        uint16_t Count;
+        uint16_t Axis;
+    };
+
+    static_assert(sizeof(BVHNode) == 32);
+
+    struct BVHPrim
+    {
+        Math::float3 BoxMin;
+        Math::float3 BoxMax;
+        Math::float3 Centroid;
+        uint32_t Index;
+    };
+
+    // Builds a BVH using binned SAH. Reorders prims such that every leaf refers to a
+    // contiguous range. Nodes are in depth-first order with the root at index 0.
+    void BuildBVH(Util::MutableSpan<BVHPrim> prims, Util::SmallVector<BVHNode>& nodes,
+        uint32_t maxPrimsPerLeaf);
+
+    // Returns the entry distance or FLT_MAX when there's no intersection
+    ZetaInline float IntersectRayBox(const Math::float3& boxMin, const Math::float3& boxMax,
+        const Math::float3& origin, const Math::float3& invDir, float tMax)
+    {
+        const float tx0 = (boxMin.x - origin.x) * invDir.x;
+        const float tx1 = (boxMax.x - origin.x) * invDir.x;
+        const float ty0 = (boxMin.y - origin.y) * invDir.y;
+        const float ty1 = (boxMax.y - origin.y) * invDir.y;
+        const float tz0 = (boxMin.z - origin.z) * invDir.z;
+        const float tz1 = (boxMax.z - origin.z) * invDir.z;
+
+        const float tEnter = Math::Max(Math::Max(Math::Min(tx0, tx1), Math::Min(ty0, ty1)),
+            Math::Max(Math::Min(tz0, tz1), 0.0f));
+        // Ref: PBRT, conservative bounds for the exit distance
+        const float tExit = Math::Min(Math::Min(Math::Max(tx0, tx1), Math::Max(ty0, ty1)),
+            Math::Min(Math::Max(tz0, tz1), tMax)) * 1.00000024f;
+
+        return tEnter <= tExit ? tEnter : FLT_MAX;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // TriangleBVH
+    //--------------------------------------------------------------------------------------
+
+    struct TriangleHit
+    {
+        float T;
+        uint32_t Tri;
+        // Barycentrics of second and third vertices
+        float U;
+        float V;
+    };
+
+    // Bounding volume hierarchy over triangles for ray tracing on the CPU. Leaf triangles
+    // are stored in groups of four and tested together using SSE.
+    struct TriangleBVH
+    {
+        static constexpr uint32_t INVALID_TRI = UINT32_MAX;
+        static constexpr int MAX_DEPTH = 64;
+
+        TriangleBVH() = default;
+        ~TriangleBVH() = default;
+
+        TriangleBVH(TriangleBVH&&) = default;
+        TriangleBVH& operator=(TriangleBVH&&) = default;
+
+        // Every three consecutive positions form a triangle
+        void Build(Util::Span<Math::float3> positions);
+        // Indexed triangle list. Position is assumed to be at the start of every vertex.
+        void Build(const void* vertices, uint32_t vertexStride, uint32_t numVertices,
+            Util::Span<uint32_t> indices);
+        void Clear();
+
+        // Closest hit with t in (0, tMax). Triangles are double-sided.
+        bool Intersect(const Math::Ray& ray, float tMax, TriangleHit& hit) const;
+        // Any hit with t in (0, tMax)
+        bool Occluded(const Math::Ray& ray, float tMax) const;
+
+        ZetaInline uint32_t NumTriangles() const { return m_numTris; }
+        ZetaInline uint32_t NumNodes() const { return (uint32_t)m_nodes.size(); }
+        ZetaInline bool Empty() const { return m_nodes.empty(); }
+        ZetaInline Math::float3 BoxMin() const { return m_nodes[0].BoxMin; }
+        ZetaInline Math::float3 BoxMax() const { return m_nodes[0].BoxMax; }
+
+    private:
+        static constexpr uint32_t MAX_NUM_TRIS_PER_LEAF = 4;
+        static constexpr uint32_t PACKET_SIZE = 4;
+
+        // Four triangles in SoA layout -- V[vertex][axis]
+        struct alignas(16) TrianglePacket
+        {
+            __m128 V[3][3];
+        };
+
+        // Precomputed per-ray data for the watertight test
+        struct RayData
+        {
+            RayData(const Math::Ray& ray);
+
+            Math::float3 Origin;
+            Math::float3 InvDir;
+            int Kx;
+            int Ky;
+            int Kz;
+            float Sx;
+            float Sy;
+            float Sz;
+            bool DirIsNeg[3];
+        };
+
+        template<typename GetVertexFn>
+        void BuildImpl(uint32_t numTris, GetVertexFn getVertex);
+        // Returns the lane with the closest hit or -1
+        static int IntersectPacket(const RayData& r, const TrianglePacket& packet, uint32_t numValid,
+            float tMax, float& t, float& u, float& v);
+        template<bool AnyHit>
+        bool Traverse(const Math::Ray& ray, float tMax, TriangleHit& hit) const;
+
+        Util::SmallVector<BVHNode> m_nodes;
+        // In tree order. Every leaf starts at a new packet, unused lanes repeat a valid triangle.
+        Util::SmallVector<TrianglePacket> m_packets;
+        // Maps packet lanes to triangle indices
+        Util::SmallVector<uint32_t> m_triIndices;
+        uint32_t m_numTris = 0;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "TwoLevelBVH.h"
+#include "../Scene/SceneCore.h"
+#include "../Support/Task.h"
+#include "../Utility/HashTable.h"
+#include <atomic>
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Model;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    ZetaInline float3 Min3(const float3& a, const float3& b)
+    {
+        return float3(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z));
+    }
+
+    ZetaInline float3 Max3(const float3& a, const float3& b)
+    {
+        return float3(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z));
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// TwoLevelBVH
+//--------------------------------------------------------------------------------------
+
+uint32_t TwoLevelBVH::AddMesh(const void* vertices, uint32_t vertexStride, uint32_t numVertices,
+    Span<uint32_t> indices)
+{
+    Assert(indices.size() % 3 == 0, "Number of indices must be a multiple of 3.");
+
+    m_meshes.emplace_back();
+    Mesh& mesh = m_meshes.back();
+    mesh.Vertices = vertices;
+    mesh.Indices = indices.data();
+    mesh.VertexStride = vertexStride;
+    mesh.NumVertices = numVertices;
+    mesh.NumIndices = (uint32_t)indices.size();
+
+    return (uint32_t)m_meshes.size() - 1;
+}
+
+uint32_t TwoLevelBVH::AddInstance(uint32_t meshIdx, const float4x3& toWorld, uint64_t instanceID)
+{
+    Assert(meshIdx < m_meshes.size(), "Invalid mesh index.");
+
+    m_instances.emplace_back();
+    Instance& instance = m_instances.back();
+    instance.ToWorld = toWorld;
+    instance.ID = instanceID;
+    instance.Mesh = meshIdx;
+
+    return (uint32_t)m_instances.size() - 1;
+}
+
+void TwoLevelBVH::AddScene(const Scene::SceneCore& scene)
+{
+    Span<Vertex> vertices = scene.m_meshes.Vertices();
+    Span<uint32_t> indices = scene.m_meshes.Indices();
+    Check(!vertices.empty() && !indices.empty(), "Mesh data hasn't been retained on the CPU, "
+        "see SceneCore::RetainCpuMeshData().");
+
+    // Meshes can be referenced by multiple instances
+    HashTable<uint32_t> meshIDToIdx;
+
+    for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
+    {
+        const auto& currTreeLevel = scene.m_sceneGraph[treeLevelIdx];
+
+        for (size_t i = 0; i < currTreeLevel.m_meshIDs.size(); i++)
+        {
+            const uint64_t meshID = currTreeLevel.m_meshIDs[i];
+            if (meshID == Scene::INVALID_MESH)
+                continue;
+
+            uint32_t meshIdx;
+
+            if (auto it = meshIDToIdx.find(meshID); it)
+                meshIdx = *it.value();
+            else
+            {
+                const TriangleMesh* mesh = scene.GetMesh(meshID).value();
+                meshIdx = AddMesh(Span(vertices.data() + mesh->m_vtxBuffStartOffset, mesh->m_numVertices),
+                    Span(indices.data() + mesh->m_idxBuffStartOffset, mesh->m_numIndices));
+                meshIDToIdx.insert_or_assign(meshID, meshIdx);
+            }
+
+            AddInstance(meshIdx, currTreeLevel.m_toWorlds[i], currTreeLevel.m_IDs[i]);
+        }
+    }
+}
+
+void TwoLevelBVH::Clear()
+{
+    m_meshes.free_memory();
+    m_instances.free_memory();
+    m_nodes.free_memory();
+    m_instanceIndices.free_memory();
+}
+
+void TwoLevelBVH::Build()
+{
+    const uint32_t numMeshes = (uint32_t)m_meshes.size();
+    std::atomic_uint32_t nextMesh = 0;
+
+    // Persistent tasks that keep pulling meshes -- mesh sizes are often very uneven
+    const int numTasks = (int)Min((uint32_t)Min(App::GetNumWorkerThreads() + 1, TaskSet::MAX_NUM_TASKS),
+        numMeshes);
+
+    if (numTasks > 1)
+    {
+        TaskSet ts;
+
+        for (int i = 0; i < numTasks; i++)
+        {
+            StackStr(tname, n, "TwoLevelBVH::BLAS_%d", i);
+            ts.EmplaceTask(tname, [this, &nextMesh, numMeshes]()
+                {
+                    uint32_t mesh;
+                    while ((mesh = nextMesh.fetch_add(1, std::memory_order_relaxed)) < numMeshes)
+                        BuildBLAS(mesh);
+                });
+        }
+
+        WaitObject waitObj;
+        ts.Sort();
+        ts.Finalize(&waitObj);
+        App::Submit(ZetaMove(ts));
+
+        // Help out with unfinished tasks
+        App::FlushWorkerThreadPool();
+        waitObj.Wait();
+    }
+    else
+    {
+        for (uint32_t i = 0; i < numMeshes; i++)
+            BuildBLAS(i);
+    }
+
+    BuildTLAS();
+}
+
+void TwoLevelBVH::BuildBLAS(uint32_t meshIdx)
+{
+    Mesh& mesh = m_meshes[meshIdx];
+    mesh.BVH.Build(mesh.Vertices, mesh.VertexStride, mesh.NumVertices, Span(mesh.Indices, mesh.NumIndices));
+}
+
+void TwoLevelBVH::UpdateInstance(Instance& instance)
+{
+    const float4x3& M = instance.ToWorld;
+
+    // Inverse of the linear part is the transposed cofactor matrix divided by determinant
+    const float3 c0 = M.m[1].cross(M.m[2]);
+    const float3 c1 = M.m[2].cross(M.m[0]);
+    const float3 c2 = M.m[0].cross(M.m[1]);
+    const float det = M.m[0].dot(c0);
+    Assert(det != 0, "Transformation is not invertible.");
+    const float rcpDet = 1.0f / det;
+
+    instance.ToObject[0] = c0 * rcpDet;
+    instance.ToObject[1] = c1 * rcpDet;
+    instance.ToObject[2] = c2 * rcpDet;
+
+    // World-space AABB (Arvo's method)
+    const TriangleBVH& blas = m_meshes[instance.Mesh].BVH;
+    if (blas.Empty())
+    {
+        instance.BoxMin = float3(FLT_MAX);
+        instance.BoxMax = float3(-FLT_MAX);
+
+        return;
+    }
+
+    const float3 boxMin = blas.BoxMin();
+    const float3 boxMax = blas.BoxMax();
+    const float objMin[3] = { boxMin.x, boxMin.y, boxMin.z };
+    const float objMax[3] = { boxMax.x, boxMax.y, boxMax.z };
+    float3 newMin = M.m[3];
+    float3 newMax = M.m[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        const float3 a = M.m[i] * objMin[i];
+        const float3 b = M.m[i] * objMax[i];
+        newMin += Min3(a, b);
+        newMax += Max3(a, b);
+    }
+
+    instance.BoxMin = newMin;
+    instance.BoxMax = newMax;
+}
+
+void TwoLevelBVH::BuildTLAS()
+{
+    SmallVector<BVHPrim> prims;
+    prims.reserve(m_instances.size());
+
+    for (uint32_t i = 0; i < (uint32_t)m_instances.size(); i++)
+    {
+        Instance& instance = m_instances[i];
+        UpdateInstance(instance);
+
+        // Skip instances of empty meshes
+        if (instance.BoxMin.x > instance.BoxMax.x)
+            continue;
+
+        prims.push_back(BVHPrim{ .BoxMin = instance.BoxMin,
+            .BoxMax = instance.BoxMax,
+            .Centroid = 0.5f * (instance.BoxMin + instance.BoxMax),
+            .Index = i });
+    }
+
+    BuildBVH(prims, m_nodes, MAX_NUM_INSTANCES_PER_LEAF);
+
+    m_instanceIndices.resize(prims.size());
+    for (size_t i = 0; i < prims.size(); i++)
+        m_instanceIndices[i] = prims[i].Index;
+}
+
+void TwoLevelBVH::SetTransform(uint32_t instanceIdx, const float4x3& toWorld)
+{
+    m_instances[instanceIdx].ToWorld = toWorld;
+}
+
+void TwoLevelBVH::Refit()
+{
+    for (auto& instance : m_instances)
+        UpdateInstance(instance);
+
+    // Children always come after their parent, so a reverse pass visits children first
+    for (int64_t i = (int64_t)m_nodes.size() - 1; i >= 0; i--)
+    {
+        BVHNode& node = m_nodes[i];
+        float3 boxMin(FLT_MAX);
+        float3 boxMax(-FLT_MAX);
+
+        if (node.IsLeaf())
+        {
+            for (uint32_t j = node.Offset; j < node.Offset + node.Count; j++)
+            {
+                const Instance& instance = m_instances[m_instanceIndices[j]];
+                boxMin = Min3(boxMin, instance.BoxMin);
+                boxMax = Max3(boxMax, instance.BoxMax);
+            }
+        }
+        else
+        {
+            const BVHNode& left = m_nodes[i + 1];
+            const BVHNode& right = m_nodes[node.Offset];
+            boxMin = Min3(left.BoxMin, right.BoxMin);
+            boxMax = Max3(left.BoxMax, right.BoxMax);
+        }
+
+        node.BoxMin = boxMin;
+        node.BoxMax = boxMax;
+    }
+}
+
+uint64_t TwoLevelBVH::NumInstancedTriangles() const
+{
+    uint64_t n = 0;
+    for (auto& instance : m_instances)
+        n += m_meshes[instance.Mesh].BVH.NumTriangles();
+
+    return n;
+}
+
+template<bool AnyHit>
+bool TwoLevelBVH::Traverse(const Ray& ray, float tMax, TwoLevelHit& hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    const float3 invDir(1.0f / ray.Dir.x, 1.0f / ray.Dir.y, 1.0f / ray.Dir.z);
+    const bool dirIsNeg[3] = { ray.Dir.x < 0, ray.Dir.y < 0, ray.Dir.z < 0 };
+    uint32_t stack[TriangleBVH::MAX_DEPTH];
+    int stackSize = 0;
+    uint32_t curr = 0;
+    bool found = false;
+
+    while (true)
+    {
+        const BVHNode& node = m_nodes[curr];
+
+        if (IntersectRayBox(node.BoxMin, node.BoxMax, ray.Origin, invDir, tMax) != FLT_MAX)
+        {
+            if (node.IsLeaf())
+            {
+                for (uint32_t i = node.Offset; i < node.Offset + node.Count; i++)
+                {
+                    const uint32_t instanceIdx = m_instanceIndices[i];
+                    const Instance& instance = m_instances[instanceIdx];
+
+                    // Direction isn't normalized, so that distances along the ray stay the same
+                    const float3 o = ray.Origin - instance.ToWorld.m[3];
+                    const float3 originObj(o.dot(instance.ToObject[0]), o.dot(instance.ToObject[1]),
+                        o.dot(instance.ToObject[2]));
+                    const float3 dirObj(ray.Dir.dot(instance.ToObject[0]), ray.Dir.dot(instance.ToObject[1]),
+                        ray.Dir.dot(instance.ToObject[2]));
+                    const Ray rayObj(originObj, dirObj);
+                    const TriangleBVH& blas = m_meshes[instance.Mesh].BVH;
+
+                    if constexpr (AnyHit)
+                    {
+                        if (blas.Occluded(rayObj, tMax))
+                            return true;
+                    }
+                    else
+                    {
+                        TriangleHit triHit;
+
+                        if (blas.Intersect(rayObj, tMax, triHit))
+                        {
+                            tMax = triHit.T;
+                            hit.T = triHit.T;
+                            hit.Instance = instanceIdx;
+                            hit.Mesh = instance.Mesh;
+                            hit.Tri = triHit.Tri;
+                            hit.U = triHit.U;
+                            hit.V = triHit.V;
+                            hit.InstanceID = instance.ID;
+                            found = true;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                // Visit the closer child first
+                const uint32_t left = curr + 1;
+                const uint32_t right = node.Offset;
+
+                if (dirIsNeg[node.Axis])
+                {
+                    stack[stackSize++] = left;
+                    curr = right;
+                }
+                else
+                {
+                    stack[stackSize++] = right;
+                    curr = left;
+                }
+
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            break;
+
+        curr = stack[--stackSize];
+    }
+
+    return found;
+}
+
+bool TwoLevelBVH::Intersect(const Ray& ray, float tMax, TwoLevelHit& hit) const
+{
+    return Traverse<false>(ray, tMax, hit);
+}
+
+bool TwoLevelBVH::Occluded(const Ray& ray, float tMax) const
+{
+    TwoLevelHit unused;
+    return Traverse<true>(ray, tMax, unused);
+}
\ No newline at end of file
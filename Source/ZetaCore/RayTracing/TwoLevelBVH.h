@@ -0,0 +1,116 @@
+#pragma once
+
+#include "TriangleBVH.h"
+#include "../Core/Vertex.h"
+#include "../Math/Matrix.h"
+
+namespace ZetaRay::Scene
+{
+    class SceneCore;
+}
+
+namespace ZetaRay::RT
+{
+    struct TwoLevelHit
+    {
+        float T;
+        uint32_t Instance;
+        uint32_t Mesh;
+        // Index of triangle in the mesh (= primitive index)
+        uint32_t Tri;
+        // Barycentrics of second and third vertices
+        float U;
+        float V;
+        uint64_t InstanceID;
+    };
+
+    // CPU analogue of BLAS/TLAS -- one triangle BVH per mesh in object space and a BVH
+    // over mesh instances on top. Moving instances only requires updating the top level.
+    //
+    // Usage:
+    //  1. AddMesh() and AddInstance(), or AddScene()
+    //  2. Build() -- mesh BVHs are built in parallel
+    //  3. For dynamic instances, SetTransform() followed by Refit()
+    struct TwoLevelBVH
+    {
+        static constexpr uint32_t INVALID_MESH = UINT32_MAX;
+
+        TwoLevelBVH() = default;
+        ~TwoLevelBVH() = default;
+
+        TwoLevelBVH(const TwoLevelBVH&) = delete;
+        TwoLevelBVH& operator=(const TwoLevelBVH&) = delete;
+
+        // Vertex and index data has to stay valid until mesh BVHs are built. Position is
+        // assumed to be at the start of every vertex.
+        uint32_t AddMesh(const void* vertices, uint32_t vertexStride, uint32_t numVertices,
+            Util::Span<uint32_t> indices);
+        ZetaInline uint32_t AddMesh(Util::Span<Core::Vertex> vertices, Util::Span<uint32_t> indices)
+        {
+            return AddMesh(vertices.data(), sizeof(Core::Vertex), (uint32_t)vertices.size(), indices);
+        }
+        uint32_t AddInstance(uint32_t meshIdx, const Math::float4x3& toWorld, uint64_t instanceID);
+        // Adds every mesh and instance in the scene. Requires scene to keep a CPU copy of
+        // mesh data (SceneCore::RetainCpuMeshData()).
+        void AddScene(const Scene::SceneCore& scene);
+        void Clear();
+
+        // Builds the mesh BVHs using the worker threads, followed by BuildTLAS()
+        void Build();
+        // Calls for different meshes can run in parallel
+        void BuildBLAS(uint32_t meshIdx);
+        void BuildTLAS();
+
+        void SetTransform(uint32_t instanceIdx, const Math::float4x3& toWorld);
+        // Updates instance bounds and the top-level tree after instances moved. Tree
+        // quality degrades as instances move further from where they were at build time.
+        void Refit();
+
+        // Closest hit with t in (0, tMax). Triangles are double-sided.
+        bool Intersect(const Math::Ray& ray, float tMax, TwoLevelHit& hit) const;
+        // Any hit with t in (0, tMax)
+        bool Occluded(const Math::Ray& ray, float tMax) const;
+
+        ZetaInline uint32_t NumMeshes() const { return (uint32_t)m_meshes.size(); }
+        ZetaInline uint32_t NumInstances() const { return (uint32_t)m_instances.size(); }
+        ZetaInline uint32_t NumTLASNodes() const { return (uint32_t)m_nodes.size(); }
+        ZetaInline const TriangleBVH& BLAS(uint32_t meshIdx) const { return m_meshes[meshIdx].BVH; }
+        // Sum over instances
+        uint64_t NumInstancedTriangles() const;
+
+    private:
+        static constexpr uint32_t MAX_NUM_INSTANCES_PER_LEAF = 2;
+
+        struct Mesh
+        {
+            const void* Vertices;
+            const uint32_t* Indices;
+            uint32_t VertexStride;
+            uint32_t NumVertices;
+            uint32_t NumIndices;
+            TriangleBVH BVH;
+        };
+
+        struct Instance
+        {
+            // Object to world
+            Math::float4x3 ToWorld;
+            // World to object, object-space coordinate i is dot(p - ToWorld.m[3], ToObject[i])
+            Math::float3 ToObject[3];
+            Math::float3 BoxMin;
+            Math::float3 BoxMax;
+            uint64_t ID;
+            uint32_t Mesh;
+        };
+
+        void UpdateInstance(Instance& instance);
+        template<bool AnyHit>
+        bool Traverse(const Math::Ray& ray, float tMax, TwoLevelHit& hit) const;
+
+        Util::SmallVector<Mesh> m_meshes;
+        Util::SmallVector<Instance> m_instances;
+        Util::SmallVector<BVHNode> m_nodes;
+        // Instances in tree order
+        Util::SmallVector<uint32_t> m_instanceIndices;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "Animation.h"
+#include "../Math/Quaternion.h"
+#include "../Utility/Utility.h"
+#include "../Support/MemoryReport.h"
+
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Scene::Internal;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+//--------------------------------------------------------------------------------------
+// AnimationSet
+//--------------------------------------------------------------------------------------
+
+void AnimationSet::Add(uint64_t instanceID, Span<Keyframe> keyframes, float t_start, bool loop)
+{
+    Check(keyframes.size() > 1, "Invalid animation.");
+
+    m_metadata.push_back(Metadata{
+        .InstanceID = instanceID,
+        .StartOffset = (uint32_t)m_times.size(),
+        .Length = (uint32_t)keyframes.size(),
+        .T0 = t_start,
+        .Loop = loop });
+
+    m_cursors.push_back(0);
+
+    for (size_t i = 0; i < keyframes.size(); i++)
+    {
+        const Keyframe& k = keyframes[i];
+        Assert(i == 0 || keyframes[i - 1].Time < k.Time, "Keyframes must be sorted by time.");
+
+        m_times.push_back(k.Time);
+        m_scales.push_back(k.Transform.Scale);
+        m_rotations.push_back(k.Transform.Rotation);
+        m_translations.push_back(k.Transform.Translation);
+    }
+}
+
+void AnimationSet::Clear()
+{
+    m_metadata.free_memory();
+    m_cursors.free_memory();
+    m_times.free_memory();
+    m_scales.free_memory();
+    m_rotations.free_memory();
+    m_translations.free_memory();
+}
+
+void AnimationSet::ReportMemory(Support::MemoryReport& report) const
+{
+    report.Add("AnimationSet", "m_metadata", m_metadata);
+    report.Add("AnimationSet", "m_cursors", m_cursors);
+    report.Add("AnimationSet", "m_times", m_times);
+    report.Add("AnimationSet", "m_scales", m_scales);
+    report.Add("AnimationSet", "m_rotations", m_rotations);
+    report.Add("AnimationSet", "m_translations", m_translations);
+}
+
+void AnimationSet::FindInterval(size_t anim, float t, int32_t& k1, float& u)
+{
+    const Metadata& meta = m_metadata[anim];
+    const float* times = m_times.data() + meta.StartOffset;
+    const uint32_t lastInterval = meta.Length - 2;
+    const float tBeg = times[0];
+    const float tEnd = times[meta.Length - 1];
+
+    // Animation's local time
+    t -= meta.T0;
+
+    // Fast paths
+    if (t <= tBeg)
+    {
+        k1 = meta.StartOffset;
+        u = 0.0f;
+
+        return;
+    }
+
+    if (t >= tEnd)
+    {
+        if (!meta.Loop)
+        {
+            k1 = meta.StartOffset + lastInterval;
+            u = 1.0f;
+
+            return;
+        }
+
+        const float duration = tEnd - tBeg;
+        t = tBeg + fmodf(t - tBeg, duration);
+    }
+
+    uint32_t c = m_cursors[anim];
+
+    // Time usually moves forward by a small amount from one frame to the next, so the
+    // new interval is either the same one or a few steps ahead
+    if (t >= times[c])
+    {
+        int numSteps = 0;
+
+        while (c < lastInterval && t >= times[c + 1] && numSteps < MAX_NUM_LINEAR_STEPS)
+        {
+            c++;
+            numSteps++;
+        }
+    }
+
+    // Jumped backward (e.g. looped around) or too far ahead
+    if (t < times[c] || (c < lastInterval && t >= times[c + 1]))
+    {
+        const int64_t idx = Util::FindInterval(Span(times, meta.Length), t,
+            [](const float& x) { return x; });
+
+        // t can be equal to tEnd after round-off
+        c = idx == -1 ? lastInterval : (uint32_t)idx;
+    }
+
+    Assert(c <= lastInterval, "Invalid interval.");
+    m_cursors[anim] = c;
+
+    k1 = meta.StartOffset + c;
+    u = Min((t - times[c]) / (times[c + 1] - times[c]), 1.0f);
+}
+
+void AnimationSet::Sample(float t, size_t begin, size_t end, MutableSpan<AffineTransformation> out)
+{
+    Assert(end <= m_metadata.size() && begin <= end, "Invalid range.");
+    Assert(out.size() >= end - begin, "Output is too small.");
+
+    alignas(32) int32_t k1[SIMD_WIDTH];
+    alignas(32) float u[SIMD_WIDTH];
+    alignas(32) float res[10][SIMD_WIDTH];
+
+    const float* scales = reinterpret_cast<const float*>(m_scales.data());
+    const float* rotations = reinterpret_cast<const float*>(m_rotations.data());
+    const float* translations = reinterpret_cast<const float*>(m_translations.data());
+    size_t i = begin;
+
+    for (; i + SIMD_WIDTH <= end; i += SIMD_WIDTH)
+    {
+        for (int j = 0; j < SIMD_WIDTH; j++)
+            FindInterval(i + j, t, k1[j], u[j]);
+
+        const __m256i vK1 = _mm256_load_si256(reinterpret_cast<__m256i*>(k1));
+        const __m256 vU = _mm256_load_ps(u);
+
+        // Element c of keyframe k is at index 3 * k + c (float3) or 4 * k + c (float4)
+        const __m256i vIdx3 = _mm256_mullo_epi32(vK1, _mm256_set1_epi32(3));
+        const __m256i vIdx3Next = _mm256_add_epi32(vIdx3, _mm256_set1_epi32(3));
+        const __m256i vIdx4 = _mm256_slli_epi32(vK1, 2);
+        const __m256i vIdx4Next = _mm256_add_epi32(vIdx4, _mm256_set1_epi32(4));
+
+        // Scale & translation
+        for (int c = 0; c < 3; c++)
+        {
+            const __m256 vS1 = _mm256_i32gather_ps(scales + c, vIdx3, sizeof(float));
+            const __m256 vS2 = _mm256_i32gather_ps(scales + c, vIdx3Next, sizeof(float));
+            _mm256_store_ps(res[c], lerp(vS1, vS2, vU));
+
+            const __m256 vT1 = _mm256_i32gather_ps(translations + c, vIdx3, sizeof(float));
+            const __m256 vT2 = _mm256_i32gather_ps(translations + c, vIdx3Next, sizeof(float));
+            _mm256_store_ps(res[7 + c], lerp(vT1, vT2, vU));
+        }
+
+        // Rotation
+        __m256 vQ1[4];
+        __m256 vQ2[4];
+        __m256 vQ[4];
+
+        for (int c = 0; c < 4; c++)
+        {
+            vQ1[c] = _mm256_i32gather_ps(rotations + c, vIdx4, sizeof(float));
+            vQ2[c] = _mm256_i32gather_ps(rotations + c, vIdx4Next, sizeof(float));
+        }
+
+        slerp(vQ1, vQ2, vU, vQ);
+
+        for (int c = 0; c < 4; c++)
+            _mm256_store_ps(res[3 + c], vQ[c]);
+
+        // Back to AoS
+        for (int j = 0; j < SIMD_WIDTH; j++)
+        {
+            AffineTransformation& M = out[i - begin + j];
+            M.Scale = float3(res[0][j], res[1][j], res[2][j]);
+            M.Rotation = float4(res[3][j], res[4][j], res[5][j], res[6][j]);
+            M.Translation = float3(res[7][j], res[8][j], res[9][j]);
+        }
+    }
+
+    // Remaining ones (fewer than SIMD_WIDTH)
+    for (; i < end; i++)
+    {
+        int32_t k;
+        float uk;
+        FindInterval(i, t, k, uk);
+
+        const __m128 vScale = lerp(loadFloat3(m_scales[k]), loadFloat3(m_scales[k + 1]), uk);
+        const __m128 vTranslate = lerp(loadFloat3(m_translations[k]), loadFloat3(m_translations[k + 1]), uk);
+        const __m128 vRot = slerp(loadFloat4(m_rotations[k]), loadFloat4(m_rotations[k + 1]), uk);
+
+        AffineTransformation& M = out[i - begin];
+        M.Scale = storeFloat3(vScale);
+        M.Rotation = storeFloat4(vRot);
+        M.Translation = storeFloat3(vTranslate);
+    }
+}
\ No newline at end of file
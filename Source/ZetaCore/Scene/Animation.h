@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../Math/Matrix.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    struct MemoryReport;
+}
+
+namespace ZetaRay::Scene
+{
+    struct Keyframe
+    {
+        static Keyframe Identity()
+        {
+            Keyframe k;
+            k.Transform = Math::AffineTransformation::GetIdentity();
+
+            return k;
+        }
+
+        Math::AffineTransformation Transform;
+        float Time;
+    };
+}
+
+namespace ZetaRay::Scene::Internal
+{
+    // Keyframes of all the animations, stored in SoA layout. Every animation remembers the keyframe
+    // interval from the last time it was sampled, so that for monotonically increasing time, finding
+    // the interval is amortized O(1) rather than a binary search. Animations are interpolated eight
+    // at a time.
+    struct AnimationSet
+    {
+        static constexpr int SIMD_WIDTH = 8;
+        // Number of intervals to step through before falling back to binary search
+        static constexpr int MAX_NUM_LINEAR_STEPS = 4;
+
+        // Keyframes must be sorted by time
+        void Add(uint64_t instanceID, Util::Span<Keyframe> keyframes, float t_start, bool loop);
+        // Samples animations [begin, end) at time t and writes the results to out[0, end - begin).
+        // Disjoint ranges can be sampled in parallel.
+        void Sample(float t, size_t begin, size_t end, Util::MutableSpan<Math::AffineTransformation> out);
+        void Clear();
+        void ReportMemory(Support::MemoryReport& report) const;
+
+        ZetaInline size_t NumAnimations() const { return m_metadata.size(); }
+        ZetaInline size_t NumKeyframes() const { return m_times.size(); }
+        ZetaInline uint64_t InstanceID(size_t i) const { return m_metadata[i].InstanceID; }
+
+    private:
+        struct Metadata
+        {
+            uint64_t InstanceID;
+            // Offset into keyframe arrays
+            uint32_t StartOffset;
+            uint32_t Length;
+            float T0;
+            bool Loop;
+        };
+
+        // Returns (absolute) index of the first keyframe of the interval containing t along with
+        // the interpolation parameter
+        void FindInterval(size_t anim, float t, int32_t& k1, float& u);
+
+        Util::SmallVector<Metadata> m_metadata;
+        // Interval index (relative to animation's start offset) from last sample
+        Util::SmallVector<uint32_t> m_cursors;
+
+        Util::SmallVector<float> m_times;
+        Util::SmallVector<Math::float3> m_scales;
+        Util::SmallVector<Math::float4> m_rotations;
+        Util::SmallVector<Math::float3> m_translations;
+    };
+}
\ No newline at end of file
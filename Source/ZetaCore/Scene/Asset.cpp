@@ -1,30 +1,60 @@
 #include "Asset.h"
-#include "../Core/RendererCore.h"
-#include "../Core/SharedShaderResources.h"
 #include "SceneCore.h"
 #include "../App/Log.h"
 #include "../App/Timer.h"
+#include "../Support/MemoryReport.h"
 #include <algorithm>
 
+#ifdef _WIN32
+#include "../Core/RendererCore.h"
+#include "../Core/SharedShaderResources.h"
+#endif
+
+using namespace ZetaRay;
 using namespace ZetaRay::Core;
+#ifdef _WIN32
 using namespace ZetaRay::Core::GpuMemory;
+#endif
 using namespace ZetaRay::Scene::Internal;
 using namespace ZetaRay::App;
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Math;
 using namespace ZetaRay::Model;
 using namespace ZetaRay::Model::glTF;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    // Approximate power of an emissive triangle, ignoring its emissive texture (if any)
+    float EstimateEmissivePower(RT::EmissiveTriangle& tri)
+    {
+        __m128 v0;
+        __m128 v1;
+        __m128 v2;
+        tri.LoadVertices(v0, v1, v2);
+
+        const __m128 vArea = length(cross(_mm_sub_ps(v1, v0), _mm_sub_ps(v2, v0)));
+        const float area = 0.5f * _mm_cvtss_f32(vArea);
+        const float3 factor = tri.GetFactor();
+        const float lum = 0.2126f * factor.x + 0.7152f * factor.y + 0.0722f * factor.z;
+        const float strength = HalfToFloat(tri.GetStrength().x);
+
+        return lum * strength * area * (tri.IsDoubleSided() ? 2.0f : 1.0f);
+    }
+}
 
+#ifdef _WIN32
 //--------------------------------------------------------------------------------------
 // TexSRVDescriptorTable
 //--------------------------------------------------------------------------------------
 
 TexSRVDescriptorTable::TexSRVDescriptorTable(const uint32_t descTableSize)
-    : m_descTableSize(descTableSize),
-    m_numMasks(descTableSize >> 6)
+    : m_descTableSize(descTableSize)
 {
     Assert(Math::IsPow2(descTableSize), "descriptor table size must be a power of two.");
     Assert(descTableSize < MAX_NUM_DESCRIPTORS, "desc. table size exceeded maximum allowed.");
+
+    m_slots.Init(descTableSize, descTableSize);
 }
 
 void TexSRVDescriptorTable::Init(uint64_t id)
@@ -36,7 +66,7 @@ void TexSRVDescriptorTable::Init(uint64_t id)
     s.InsertOrAssignDescriptorTable(id, m_descTable);
 }
 
-uint32_t TexSRVDescriptorTable::Add(Texture&& tex)
+uint32_t TexSRVDescriptorTable::Add(Texture&& tex, float minLOD)
 {
     // If texture already exists, just increase the ref count and return it
     if (auto it = m_cache.find(tex.ID()); it)
@@ -50,25 +80,15 @@ uint32_t TexSRVDescriptorTable::Add(Texture&& tex)
 
     Assert(tex.IsInitialized(), "Texture hasn't been initialized.");
 
-    // Find first free slot in table
-    uint32_t freeSlot = UINT32_MAX;
-    int i = 0;
+    // Grab a free slot in the table
+    const auto slot = m_slots.Allocate(1);
+    Check(!slot.IsEmpty(), "No free slot was found.");
 
-    for (; i < (int)m_numMasks; i++)
-    {
-        freeSlot = (uint32)_tzcnt_u64(~m_inUseBitset[i]);
-        if (freeSlot != 64)
-            break;
-    }
-
-    Assert(freeSlot != UINT32_MAX, "No free slot was found.");
-    m_inUseBitset[i] |= (1llu << freeSlot);    // Set the slot to occupied
-
-    freeSlot += i * 64;        // Each uint64_t covers 64 slots
+    const uint32_t freeSlot = slot.Offset;
     Assert(freeSlot < m_descTableSize, "Invalid table index.");
 
     auto descCpuHandle = m_descTable.CPUHandle(freeSlot);
-    Direct3DUtil::CreateTexture2DSRV(tex, descCpuHandle);
+    Direct3DUtil::CreateTexture2DSRV(tex, descCpuHandle, DXGI_FORMAT_UNKNOWN, minLOD);
 
     // Remember ID before moving the texture
     const Texture::ID_TYPE id = tex.ID();
@@ -77,11 +97,29 @@ uint32_t TexSRVDescriptorTable::Add(Texture&& tex)
     m_cache.insert_or_assign(id, CacheEntry{
         .T = ZetaMove(tex), 
         .DescTableOffset = freeSlot,
+        .SlotInternal = slot.Internal,
         .RefCount = 1 });
 
     return freeSlot;
 }
 
+Texture* TexSRVDescriptorTable::Find(Texture::ID_TYPE id)
+{
+    if (auto it = m_cache.find(id); it)
+        return &it.value()->T;
+
+    return nullptr;
+}
+
+void TexSRVDescriptorTable::SetMinLOD(Texture::ID_TYPE id, float minLOD)
+{
+    if (auto it = m_cache.find(id); it)
+    {
+        Direct3DUtil::CreateTexture2DSRV(it.value()->T, m_descTable.CPUHandle(it.value()->DescTableOffset),
+            DXGI_FORMAT_UNKNOWN, minLOD);
+    }
+}
+
 void TexSRVDescriptorTable::Recycle(uint64_t completedFenceVal)
 {
     for(auto it = m_pending.begin(); it != m_pending.end();)
@@ -90,15 +128,19 @@ void TexSRVDescriptorTable::Recycle(uint64_t completedFenceVal)
         if (it->FenceVal <= completedFenceVal)
         {
             // Set the descriptor slot to free
-            const uint32_t idx = it->DescTableOffset >> 6;
-            Assert(idx < m_numMasks, "invalid index.");
-            m_inUseBitset[idx] |= (1llu << (it->DescTableOffset & 63));
+            Assert(it->DescTableOffset < m_descTableSize, "invalid index.");
+            m_slots.Release(Support::DescriptorAllocator::Allocation{ .Offset = it->DescTableOffset,
+                .Count = 1,
+                .Internal = it->SlotInternal },
+                completedFenceVal);
 
             it = m_pending.erase(*it);
         }
         else
             it++;
     }
+
+    m_slots.Recycle(completedFenceVal);
 }
 
 void TexSRVDescriptorTable::Clear()
@@ -109,6 +151,7 @@ void TexSRVDescriptorTable::Clear()
     for (auto& t : m_pending)
         t.T.Reset(false);
 }
+#endif
 
 //--------------------------------------------------------------------------------------
 // MaterialBuffer
@@ -138,6 +181,7 @@ void MaterialBuffer::Add(uint32_t ID, const Material& mat)
 
 void MaterialBuffer::UploadToGPU()
 {
+#ifdef _WIN32
     // First time
     if (!m_buffer.IsInitialized())
     {
@@ -172,6 +216,9 @@ void MaterialBuffer::UploadToGPU()
 
         m_staleID = UINT32_MAX;
     }
+#else
+    m_staleID = UINT32_MAX;
+#endif
 }
 
 void MaterialBuffer::ResizeAdditionalMaterials(uint32_t num)
@@ -181,8 +228,15 @@ void MaterialBuffer::ResizeAdditionalMaterials(uint32_t num)
 
 void MaterialBuffer::Clear()
 {
+#ifdef _WIN32
     // Assumes CPU-GPU synchronization has been performed, so that GPU is done with the material buffer.
     m_buffer.Reset();
+#endif
+}
+
+void MaterialBuffer::ReportMemory(MemoryReport& report) const
+{
+    report.Add("MaterialBuffer", "m_materials", m_materials);
 }
 
 //--------------------------------------------------------------------------------------
@@ -217,7 +271,8 @@ void MeshContainer::AddBatch(SmallVector<Model::glTF::Asset::Mesh>&& meshes,
     // Each mesh primitive + material index combo must be unique
     for (auto& mesh : meshes)
     {
-        const uint64_t meshFromSceneID = Scene::MeshID(mesh.SceneID, mesh.MeshIdx, mesh.MeshPrimIdx);
+        const uint64_t meshFromSceneID = Scene::MeshID(mesh.SceneID, mesh.MeshIdx, mesh.MeshPrimIdx,
+            mesh.NodeIdx);
         const uint32_t matFromSceneID = mesh.glTFMaterialIdx != -1 ?
             Scene::MaterialID(mesh.SceneID, mesh.glTFMaterialIdx) :
             Scene::DEFAULT_MATERIAL_ID;
@@ -254,6 +309,7 @@ void MeshContainer::RebuildBuffers()
     Assert(m_vertices.size() > 0, "vertex buffer is empty");
     Assert(m_indices.size() > 0, "index buffer is empty");
 
+#ifdef _WIN32
     const uint32_t vbSizeInBytes = sizeof(Vertex) * (uint32_t)m_vertices.size();
     const uint32_t ibSizeInBytes = sizeof(uint32_t) * (uint32_t)m_indices.size();
 
@@ -278,15 +334,47 @@ void MeshContainer::RebuildBuffers()
     r.InsertOrAssignDefaultHeapBuffer(GlobalResource::SCENE_VERTEX_BUFFER, m_vertexBuffer);
     r.InsertOrAssignDefaultHeapBuffer(GlobalResource::SCENE_INDEX_BUFFER, m_indexBuffer);
 
-    m_vertices.free_memory();
-    m_indices.free_memory();
+    if (!m_retainCpuCopy)
+    {
+        m_vertices.free_memory();
+        m_indices.free_memory();
+    }
+#endif
+}
+
+void MeshContainer::UpdateVertices(uint32_t baseVertex, Span<Vertex> vertices)
+{
+    if (!m_vertices.empty())
+    {
+        Assert(baseVertex + vertices.size() <= m_vertices.size(), "Out-of-bound write.");
+        memcpy(m_vertices.data() + baseVertex, vertices.data(), vertices.size() * sizeof(Vertex));
+    }
+
+#ifdef _WIN32
+    if (m_vertexBuffer.IsInitialized())
+    {
+        const uint32_t sizeInBytes = (uint32_t)(vertices.size() * sizeof(Vertex));
+        GpuMemory::UploadToDefaultHeapBuffer(m_vertexBuffer, sizeInBytes,
+            MemoryRegion{ .Data = vertices.data(), .SizeInBytes = sizeInBytes },
+            baseVertex * sizeof(Vertex));
+    }
+#endif
 }
 
 void MeshContainer::Clear()
 {
+#ifdef _WIN32
     m_vertexBuffer.Reset(false);
     m_indexBuffer.Reset(false);
     m_heap.Reset();
+#endif
+}
+
+void MeshContainer::ReportMemory(MemoryReport& report) const
+{
+    report.Add("MeshContainer", "m_meshes", m_meshes);
+    report.Add("MeshContainer", "m_vertices", m_vertices);
+    report.Add("MeshContainer", "m_indices", m_indices);
 }
 
 //--------------------------------------------------------------------------------------
@@ -342,13 +430,73 @@ void EmissiveBuffer::AddBatch(SmallVector<Asset::EmissiveInstance>&& instances,
     LOG_UI_INFO("Emissive buffers processed in %u [us].", (uint32_t)timer.DeltaMicro());
 }
 
-void EmissiveBuffer::UploadToGPU()
+void EmissiveBuffer::Update(int maxNumLightBVHSubtrees)
 {
     if (m_trisCpu.empty())
         return;
 
-    if (!m_trisGpu.IsInitialized())
+    if (!m_initialized)
     {
+        // Everything is uploaded the first time
+        m_staleRanges.clear();
+        m_uploadAll = true;
+        m_initialized = true;
+
+        m_power.resize(m_trisCpu.size());
+
+        for (size_t i = 0; i < m_trisCpu.size(); i++)
+            m_power[i] = EstimateEmissivePower(m_trisCpu[i]);
+
+        m_lightBVHBuildBegin = Timer::NowNano();
+        m_numPendingLightBVHSubtrees = m_lightBVH.BeginBuild(m_trisCpu, m_power,
+            Min(RT::LightBVH::MAX_NUM_SUBTREES, maxNumLightBVHSubtrees));
+    }
+    else if (!m_staleRanges.empty())
+    {
+        std::sort(m_staleRanges.begin(), m_staleRanges.end(),
+            [](const TriRange& lhs, const TriRange& rhs)
+            {
+                return lhs.Base < rhs.Base;
+            });
+
+        // Coalesce overlapping and adjacent ranges, which are then uploaded separately, so 
+        // that unmodified triangles in between aren't uploaded
+        size_t numRanges = 0;
+
+        for (size_t i = 1; i < m_staleRanges.size(); i++)
+        {
+            TriRange& curr = m_staleRanges[numRanges];
+            const TriRange& next = m_staleRanges[i];
+
+            if (next.Base <= curr.Base + curr.Count)
+                curr.Count = Max(curr.Count, next.Base + next.Count - curr.Base);
+            else
+                m_staleRanges[++numRanges] = next;
+        }
+
+        numRanges++;
+
+        for (size_t i = 0; i < numRanges; i++)
+        {
+            const TriRange& r = m_staleRanges[i];
+            Assert(r.Base + r.Count <= m_trisCpu.size(), "Invalid range.");
+
+            for (uint32_t t = r.Base; t < r.Base + r.Count; t++)
+                m_power[t] = EstimateEmissivePower(m_trisCpu[t]);
+
+            m_uploadRanges.push_back(r);
+        }
+
+        m_lightBVH.Refit(m_trisCpu, m_power, Span(m_staleRanges.data(), numRanges));
+        m_staleRanges.clear();
+    }
+}
+
+void EmissiveBuffer::UploadToGPU()
+{
+    if (m_uploadAll)
+    {
+#ifdef _WIN32
         const size_t sizeInBytes = sizeof(RT::EmissiveTriangle) * m_trisCpu.size();
         m_trisGpu = GpuMemory::GetDefaultHeapBufferAndInit(GlobalResource::EMISSIVE_TRIANGLE_BUFFER,
             (uint32)sizeInBytes,
@@ -357,26 +505,80 @@ void EmissiveBuffer::UploadToGPU()
 
         auto& r = App::GetRenderer().GetSharedShaderResources();
         r.InsertOrAssignDefaultHeapBuffer(GlobalResource::EMISSIVE_TRIANGLE_BUFFER, m_trisGpu);
+#endif
+
+        // Ranges from later updates are covered by the full upload
+        m_uploadRanges.clear();
+        m_uploadAll = false;
+
+        return;
     }
-    else if(m_staleNumTris > 0)
-    {
-        Assert(m_staleBaseOffset != UINT32_MAX, "Invalid base offset.");
-        const size_t numMbytes = sizeof(RT::EmissiveTriangle) * m_staleNumTris / (1024 * 1024);
-        LOG_UI_INFO("Uploading %d emissive triangles (%d MB)...", m_staleNumTris, numMbytes);
 
-        const size_t sizeInBytes = sizeof(RT::EmissiveTriangle) * m_staleNumTris;
+    if (m_uploadRanges.empty())
+        return;
+
+    uint32_t numStaleTris = 0;
+
+    for (auto& r : m_uploadRanges)
+    {
+#ifdef _WIN32
+        const size_t sizeInBytes = sizeof(RT::EmissiveTriangle) * r.Count;
         GpuMemory::UploadToDefaultHeapBuffer(m_trisGpu, (uint32)sizeInBytes,
-            MemoryRegion{ .Data = &m_trisCpu[m_staleBaseOffset], .SizeInBytes = (uint32)sizeInBytes },
-            m_staleBaseOffset * sizeof(RT::EmissiveTriangle));
+            MemoryRegion{ .Data = &m_trisCpu[r.Base], .SizeInBytes = (uint32)sizeInBytes },
+            r.Base * sizeof(RT::EmissiveTriangle));
+#endif
 
-        m_staleNumTris = 0;
-        m_staleBaseOffset = UINT32_MAX;
+        numStaleTris += r.Count;
     }
+
+    const size_t numMbytes = sizeof(RT::EmissiveTriangle) * numStaleTris / (1024 * 1024);
+    LOG_UI_INFO("Uploading %u emissive triangles in %u ranges (%llu MB)...", numStaleTris, 
+        (uint32_t)m_uploadRanges.size(), numMbytes);
+
+    m_uploadRanges.clear();
 }
 
 void EmissiveBuffer::Clear()
 {
+#ifdef _WIN32
     m_trisGpu.Reset(false);
+#endif
+    m_initialized = false;
+    m_uploadAll = false;
+    m_uploadRanges.clear();
+    m_power.free_memory();
+    m_lightBVH.Clear();
+    m_numPendingLightBVHSubtrees = 0;
+}
+
+void EmissiveBuffer::ReportMemory(MemoryReport& report) const
+{
+    report.Add("EmissiveBuffer", "m_instances", m_instances);
+    report.Add("EmissiveBuffer", "m_trisCpu", m_trisCpu);
+    report.Add("EmissiveBuffer", "m_triInitialPos", m_triInitialPos);
+    report.Add("EmissiveBuffer", "m_idToIdxMap", m_idToIdxMap);
+    report.Add("EmissiveBuffer", "m_staleRanges", m_staleRanges);
+    report.Add("EmissiveBuffer", "m_uploadRanges", m_uploadRanges);
+    report.Add("EmissiveBuffer", "m_power", m_power);
+    m_lightBVH.ReportMemory(report);
+}
+
+void EmissiveBuffer::BuildLightBVHSubtree(int i)
+{
+    if (i < m_numPendingLightBVHSubtrees)
+        m_lightBVH.BuildSubtree(i);
+}
+
+void EmissiveBuffer::FinishLightBVH()
+{
+    if (!m_numPendingLightBVHSubtrees)
+        return;
+
+    m_lightBVH.EndBuild();
+    m_numPendingLightBVHSubtrees = 0;
+
+    const int64_t elapsedUs = (Timer::NowNano() - m_lightBVHBuildBegin) / 1000;
+    LOG_UI_INFO("Light BVH (%u nodes) built in %u [us].", m_lightBVH.NumNodes(), (uint32_t)elapsedUs);
 }
 
 void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveFactor, float strength)
@@ -392,7 +594,8 @@ void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveF
     const uint32 newEmissiveFactor = Float3ToRGB8(emissiveFactor);
     const half newStrength(strength);
 
-    m_staleBaseOffset = m_instances[idx].BaseTriOffset;
+    const uint32_t staleBaseOffset = m_instances[idx].BaseTriOffset;
+    uint32_t numStaleTris = 0;
 
     // Find every instance that uses this material
     while (idx < (int64)m_instances.size() && m_instances[idx].MaterialIdx == modifiedMatIdx)
@@ -405,15 +608,15 @@ void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveF
             m_trisCpu[i].SetStrength(newStrength);
         }
 
-        m_staleNumTris += m_instances[idx].NumTriangles;
+        numStaleTris += m_instances[idx].NumTriangles;
         idx++;
     } 
+
+    // Instances are sorted by material, so modified triangles are contiguous
+    m_staleRanges.push_back(TriRange{ .Base = staleBaseOffset, .Count = numStaleTris });
 }
 
-void EmissiveBuffer::UpdateTriPositions(size_t startIdx, size_t endIdx)
+void EmissiveBuffer::UpdateTriPositions(Span<TriRange> ranges)
 {
-    Assert(endIdx <= m_trisCpu.size(), "Invalid index.");
-
-    m_staleBaseOffset = (uint32)startIdx;
-    m_staleNumTris = (uint32)(endIdx - startIdx);
+    m_staleRanges.append_range(ranges.begin(), ranges.end());
 }
@@ -1,13 +1,26 @@
 #pragma once
 
 #include "../Utility/HashTable.h"
-#include "../Core/DescriptorHeap.h"
 #include "../Model/glTFAsset.h"
 #include "../RayTracing/RtCommon.h"
+#include "../RayTracing/LightBVH.h"
 #include <Utility/Optional.h>
 
+// Without a renderer (headless build), materials, meshes and emissives are only kept on
+// the CPU and textures aren't loaded
+#ifdef _WIN32
+#include "../Core/DescriptorHeap.h"
+#include "../Core/GpuMemory.h"
+#endif
+
+namespace ZetaRay::Support
+{
+    struct MemoryReport;
+}
+
 namespace ZetaRay::Scene::Internal
 {
+#ifdef _WIN32
     //--------------------------------------------------------------------------------------
     // TextureDescriptorTable: A descriptor table containing a contiguous set of textures, 
     // which are to be bound as unbounded descriptor tables in shaders. Each texture index in
@@ -27,8 +40,13 @@ namespace ZetaRay::Scene::Internal
         void Clear();
         // Returns offset of the given texture in the descriptor table. The texture is then loaded from
         // the disk. "id" is hash of the texture path.
-        uint32_t Add(Core::GpuMemory::Texture&& tex);
+        uint32_t Add(Core::GpuMemory::Texture&& tex, float minLOD = 0.0f);
         void Recycle(uint64_t completedFenceVal);
+        // Returns NULL if the texture isn't in this table
+        Core::GpuMemory::Texture* Find(Core::GpuMemory::Texture::ID_TYPE id);
+        // Recreates the SRV with a different MinLOD clamp, e.g. once more mips have been
+        // streamed in. Does nothing if the texture isn't in this table.
+        void SetMinLOD(Core::GpuMemory::Texture::ID_TYPE id, float minLOD);
         ZetaInline uint32_t GPUDescriptorHeapIndex() const { return m_descTable.GPUDescriptorHeapIndex(); }
 
     private:
@@ -37,28 +55,31 @@ namespace ZetaRay::Scene::Internal
             Core::GpuMemory::Texture T;
             uint64_t FenceVal;
             uint32_t DescTableOffset;
+            uint32_t SlotInternal;
         };
 
         struct CacheEntry
         {
             Core::GpuMemory::Texture T;
             uint32_t DescTableOffset = UINT32_MAX;
+            uint32_t SlotInternal = UINT32_MAX;
             uint32_t RefCount = 0;
         };
 
         static constexpr int MAX_NUM_DESCRIPTORS = 4096;
-        static constexpr int MAX_NUM_MASKS = MAX_NUM_DESCRIPTORS >> 6;
-        static_assert(MAX_NUM_MASKS * 64 == MAX_NUM_DESCRIPTORS, "these must match.");
 
         Util::SmallVector<ToBeFreedTexture> m_pending;
         const uint32_t m_descTableSize;
-        const uint32_t m_numMasks;
-        uint64_t m_inUseBitset[MAX_NUM_MASKS] = { 0 };
+        // Free slots in the descriptor table
+        Support::DescriptorAllocator m_slots;
         Core::DescriptorTable m_descTable;
         // TODO Duplicate texture ID storage as key and texture object member
         Util::HashTable<CacheEntry, Core::GpuMemory::Texture::ID_TYPE> m_cache;
     };
 
+    static_assert(std::is_same_v<Model::glTF::Asset::TextureID, Core::GpuMemory::Texture::ID_TYPE>);
+#endif
+
     //--------------------------------------------------------------------------------------
     // MaterialBuffer: Wrapper over a GPU buffer containing all the materials
     //--------------------------------------------------------------------------------------
@@ -81,6 +102,7 @@ namespace ZetaRay::Scene::Internal
         }
         void UploadToGPU();
         void ResizeAdditionalMaterials(uint32_t num);
+        void ReportMemory(Support::MemoryReport& report) const;
         uint32_t NumMaterials() const { return (uint32_t)m_materials.size(); }
 
         ZetaInline Util::Optional<const Material*> Get(uint32_t ID, uint32* bufferIdx = nullptr) const
@@ -111,7 +133,9 @@ namespace ZetaRay::Scene::Internal
         static_assert(NUM_MASKS * 64 == MAX_NUM_MATERIALS, "these must match.");
         uint64_t m_inUseBitset[NUM_MASKS] = { 0 };
 
+#ifdef _WIN32
         Core::GpuMemory::Buffer m_buffer;
+#endif
         Util::HashTable<Entry, uint32_t> m_materials;
         uint32 m_staleID = UINT32_MAX;
     };
@@ -130,6 +154,12 @@ namespace ZetaRay::Scene::Internal
         void Reserve(size_t numVertices, size_t numIndices);
         void RebuildBuffers();
         void Clear();
+        void ReportMemory(Support::MemoryReport& report) const;
+        // Keeps a CPU copy of vertex and index buffers after the GPU buffers are created
+        ZetaInline void RetainCpuCopy(bool b) { m_retainCpuCopy = b; }
+        // Overwrites vertices [baseVertex, baseVertex + vertices.size()), e.g. after deformation.
+        // Calls for non-overlapping ranges can run in parallel.
+        void UpdateVertices(uint32_t baseVertex, Util::Span<Core::Vertex> vertices);
 
         // Note: not thread safe for reading and writing at the same time
         ZetaInline Util::Optional<const Model::TriangleMesh*> GetMesh(uint64_t id) const
@@ -141,18 +171,27 @@ namespace ZetaRay::Scene::Internal
             return {};
         }
 
+#ifdef _WIN32
         const Core::GpuMemory::Buffer& GetVB() const { return m_vertexBuffer; }
         const Core::GpuMemory::Buffer& GetIB() const { return m_indexBuffer; }
+#endif
         uint32_t NumMeshes() const { return (uint32_t)m_meshes.size(); }
+        // Empty after RebuildBuffers() unless CPU copy is retained. Always retained in the
+        // headless build.
+        Util::Span<Core::Vertex> Vertices() const { return m_vertices; }
+        Util::Span<uint32_t> Indices() const { return m_indices; }
 
     private:
         Util::HashTable<Model::TriangleMesh> m_meshes;
         Util::SmallVector<Core::Vertex> m_vertices;
         Util::SmallVector<uint32_t> m_indices;
+        bool m_retainCpuCopy = false;
 
+#ifdef _WIN32
         Core::GpuMemory::Buffer m_vertexBuffer;
         Core::GpuMemory::Buffer m_indexBuffer;
         Core::GpuMemory::ResourceHeap m_heap;
+#endif
     };
 
     //--------------------------------------------------------------------------------------
@@ -174,19 +213,30 @@ namespace ZetaRay::Scene::Internal
 
         using Instance = Model::glTF::Asset::EmissiveInstance;
 
+        // Range of triangles [Base, Base + Count)
+        struct TriRange
+        {
+            uint32_t Base;
+            uint32_t Count;
+        };
+
         EmissiveBuffer() = default;
         ~EmissiveBuffer() = default;
 
         EmissiveBuffer(const EmissiveBuffer&) = delete;
         EmissiveBuffer& operator=(const EmissiveBuffer&) = delete;
 
-        ZetaInline bool Initialized() const { return m_trisGpu.IsInitialized(); }
+        // Whether the power distribution has been initialized (see Update())
+        ZetaInline bool Initialized() const { return m_initialized; }
         ZetaInline uint32_t NumInstances() const { return (uint32_t)m_instances.size(); }
         ZetaInline uint32_t NumTriangles() const { return (uint32_t)m_trisCpu.size(); }
         ZetaInline Util::Span<Instance> Instances() { return m_instances; }
         ZetaInline Util::MutableSpan<RT::EmissiveTriangle> Triagnles() { return m_trisCpu; }
         ZetaInline Util::MutableSpan<Triangle> InitialTriPositions() { return m_triInitialPos; }
-        ZetaInline bool HasStaleMaterials() const { return m_staleNumTris > 0; }
+        ZetaInline bool HasStaleMaterials() const { return !m_staleRanges.empty(); }
+        // Built from approximate triangle powers. As emissive textures aren't available on the 
+        // CPU, only emissive factor, strength and area are accounted for. Refit in every Update().
+        ZetaInline const RT::LightBVH& LightBVH() const { return m_lightBVH; }
         ZetaInline Util::Optional<const Instance*> FindInstance(uint64_t ID)
         {
             auto it = m_idToIdxMap.find(ID);
@@ -199,19 +249,44 @@ namespace ZetaRay::Scene::Internal
         // Assumes proper GPU synchronization has been performed
         void Clear();
         void UpdateMaterial(uint64_t instanceID, const Math::float3& emissiveFactor, float strength);
-        void UpdateTriPositions(size_t startIdx, size_t endIdx);
+        // Marks given triangle ranges as modified. Ranges may overlap and don't need to be sorted.
+        void UpdateTriPositions(Util::Span<TriRange> ranges);
         void AddBatch(Util::SmallVector<Instance>&& instances,
             Util::SmallVector<RT::EmissiveTriangle>&& tris);
+        // CPU side of an update: updates the power estimates and light BVH for the modified
+        // triangles and queues them for upload. First time, also begins building the light BVH
+        // with up to maxNumLightBVHSubtrees subtrees. The build is then completed by calling
+        // BuildLightBVHSubtree(i) for every i in [0, maxNumLightBVHSubtrees) -- calls can run 
+        // in parallel -- followed by FinishLightBVH(). Both are no-ops when no build is pending.
+        void Update(int maxNumLightBVHSubtrees = 1);
+        // Uploads the triangles that were queued by Update() calls since the last upload
         void UploadToGPU();
+        void BuildLightBVHSubtree(int i);
+        void FinishLightBVH();
+        void ReportMemory(Support::MemoryReport& report) const;
 
     private:
+
         Util::SmallVector<Instance> m_instances;
         Util::SmallVector<RT::EmissiveTriangle> m_trisCpu;
         Util::SmallVector<Triangle> m_triInitialPos;
         // Maps instance ID to index in m_instances
         Util::HashTable<uint32_t> m_idToIdxMap;
+#ifdef _WIN32
         Core::GpuMemory::Buffer m_trisGpu;
-        uint32_t m_staleBaseOffset = UINT32_MAX;
-        uint32_t m_staleNumTris = 0;
+#endif
+        // Triangle ranges that were modified since the last Update()
+        Util::SmallVector<TriRange> m_staleRanges;
+        // Coalesced ranges that Update() has processed, but haven't been uploaded yet
+        Util::SmallVector<TriRange> m_uploadRanges;
+        // Approximate power of each triangle, weights of the light BVH
+        Util::SmallVector<float> m_power;
+        RT::LightBVH m_lightBVH;
+        // Number of subtrees of the light BVH build in progress, 0 if there isn't one
+        int m_numPendingLightBVHSubtrees = 0;
+        int64_t m_lightBVHBuildBegin = 0;
+        bool m_initialized = false;
+        // Whole buffer is uploaded (and created) on next UploadToGPU()
+        bool m_uploadAll = false;
     };
 }
\ No newline at end of file
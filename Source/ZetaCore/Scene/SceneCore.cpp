@@ -2,14 +2,23 @@
 #include "../Math/CollisionFuncs.h"
 #include "../Math/Quaternion.h"
 #include "../Support/Task.h"
+#include "../Support/MemoryReport.h"
+#include "../Support/FramePipeline.h"
 #include "Camera.h"
 #include <App/Timer.h>
 #include <Support/Param.h>
 #include <algorithm>
 #include "../Assets/Font/IconsFontAwesome6.h"
 
+#ifdef _WIN32
+#include "../Core/RendererCore.h"
+#endif
+
+using namespace ZetaRay;
 using namespace ZetaRay::Core;
+#ifdef _WIN32
 using namespace ZetaRay::Core::GpuMemory;
+#endif
 using namespace ZetaRay::Scene;
 using namespace ZetaRay::Scene::Internal;
 using namespace ZetaRay::Model;
@@ -34,6 +43,107 @@ namespace
         v.z += v.x * v.y;
         return v;
     }
+
+    // Applies a transform edit (see SceneCore::TransformInstance()) to the given world 
+    // transformation
+    v_float4x4 ApplyTransformEdit(const v_float4x4& vW, const float3& dTr, const v_float4x4& vdR,
+        const float3& dScale)
+    {
+        float4a t;
+        float4a r;
+        float4a s;
+        decomposeSRT(vW, s, r, t);
+
+        float3 newTr = dTr + t.xyz();
+        float3 newScale = dScale * s.xyz();
+
+        v_float4x4 vR = rotationMatFromQuat(load(r));
+        vR = mul(vR, vdR);
+
+        return affineTransformation(vR, newScale, newTr);
+    }
+
+    void AccumulateTransformEdit(AffineTransformation& curr, const float3& dTr, const v_float4x4& vdR,
+        const float3& dScale)
+    {
+        curr.Translation += dTr;
+        curr.Scale *= dScale;
+
+        v_float4x4 vCurrR = rotationMatFromQuat(loadFloat4(curr.Rotation));
+        vCurrR = mul(vCurrR, vdR);
+        curr.Rotation = quaternionFromRotationMat1(vCurrR);
+    }
+
+    // Decodes each batch of triangles, transforms their vertices eight at a time in SoA 
+    // layout, and then re-encodes them
+    void TransformEmissiveTriangles(EmissiveBuffer::Triangle* initTris, RT::EmissiveTriangle* tris,
+        size_t n, const float4x3& toWorld, uint32_t rtInstanceID)
+    {
+        constexpr int BATCH_SIZE = 8;
+
+        __m256 vM[4][3];
+        for (int i = 0; i < 4; i++)
+        {
+            vM[i][0] = _mm256_broadcast_ss(&toWorld.m[i].x);
+            vM[i][1] = _mm256_broadcast_ss(&toWorld.m[i].y);
+            vM[i][2] = _mm256_broadcast_ss(&toWorld.m[i].z);
+        }
+
+        // [vertex][component][triangle]
+        alignas(32) float pos[3][3][BATCH_SIZE] = {};
+
+        for (size_t base = 0; base < n; base += BATCH_SIZE)
+        {
+            const int batchSize = (int)Min(n - base, (size_t)BATCH_SIZE);
+
+            for (int i = 0; i < batchSize; i++)
+            {
+                EmissiveBuffer::Triangle& initTri = initTris[base + i];
+                __m128 vV[3];
+                RT::EmissiveTriangle::DecodeVertices(initTri.Vtx0, initTri.V0V1, initTri.V0V2,
+                    initTri.EdgeLengths,
+                    vV[0], vV[1], vV[2]);
+
+                for (int v = 0; v < 3; v++)
+                {
+                    alignas(16) float temp[4];
+                    _mm_store_ps(temp, vV[v]);
+
+                    pos[v][0][i] = temp[0];
+                    pos[v][1][i] = temp[1];
+                    pos[v][2][i] = temp[2];
+                }
+            }
+
+            // Row-vector convention
+            for (int v = 0; v < 3; v++)
+            {
+                const __m256 vX = _mm256_load_ps(pos[v][0]);
+                const __m256 vY = _mm256_load_ps(pos[v][1]);
+                const __m256 vZ = _mm256_load_ps(pos[v][2]);
+
+                for (int c = 0; c < 3; c++)
+                {
+                    __m256 vRes = _mm256_fmadd_ps(vZ, vM[2][c], vM[3][c]);
+                    vRes = _mm256_fmadd_ps(vY, vM[1][c], vRes);
+                    vRes = _mm256_fmadd_ps(vX, vM[0][c], vRes);
+
+                    _mm256_store_ps(pos[v][c], vRes);
+                }
+            }
+
+            for (int i = 0; i < batchSize; i++)
+            {
+                RT::EmissiveTriangle& tri = tris[base + i];
+                tri.StoreVertices(_mm_setr_ps(pos[0][0][i], pos[0][1][i], pos[0][2][i], 1.0f),
+                    _mm_setr_ps(pos[1][0][i], pos[1][1][i], pos[1][2][i], 1.0f),
+                    _mm_setr_ps(pos[2][0][i], pos[2][1][i], pos[2][2][i], 1.0f));
+
+                // Dynamic instances have geometry index = 0
+                tri.ID = Pcg3d(uint3(0, rtInstanceID, initTris[base + i].PrimIdx)).x;
+            }
+        }
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -41,10 +151,12 @@ namespace
 //--------------------------------------------------------------------------------------
 
 SceneCore::SceneCore()
+#ifdef _WIN32
     : m_baseColorDescTable(BASE_COLOR_DESC_TABLE_SIZE),
     m_normalDescTable(NORMAL_DESC_TABLE_SIZE),
     m_metallicRoughnessDescTable(METALLIC_ROUGHNESS_DESC_TABLE_SIZE),
     m_emissiveDescTable(EMISSIVE_DESC_TABLE_SIZE)
+#endif
 {}
 
 void SceneCore::Init(Renderer::Interface& rendererInterface)
@@ -70,6 +182,7 @@ void SceneCore::Init(Renderer::Interface& rendererInterface)
     v_float4x4 I = identity();
     m_sceneGraph[0].m_toWorlds[0] = float4x3(store(I));
 
+#ifdef _WIN32
     m_baseColorDescTable.Init(XXH3_64bits(GlobalResource::BASE_COLOR_DESCRIPTOR_TABLE,
         strlen(GlobalResource::BASE_COLOR_DESCRIPTOR_TABLE)));
     m_normalDescTable.Init(XXH3_64bits(GlobalResource::NORMAL_DESCRIPTOR_TABLE, 
@@ -78,8 +191,10 @@ void SceneCore::Init(Renderer::Interface& rendererInterface)
         strlen(GlobalResource::METALLIC_ROUGHNESS_DESCRIPTOR_TABLE)));
     m_emissiveDescTable.Init(XXH3_64bits(GlobalResource::EMISSIVE_DESCRIPTOR_TABLE, 
         strlen(GlobalResource::EMISSIVE_DESCRIPTOR_TABLE)));
+#endif
 
     m_rendererInterface.Init();
+    m_mipStreamer.Init(MAX_NUM_MIP_LOADS_IN_FLIGHT, MIP_STREAMING_BYTES_PER_FRAME);
 
     // Allocate a slot for the default material
     m_matBuffer.ResizeAdditionalMaterials(1);
@@ -99,23 +214,20 @@ void SceneCore::OnWindowSizeChanged()
     m_rendererInterface.OnWindowSizeChanged();
 }
 
-void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
+void SceneCore::Simulate(uint64_t frame, double t, TaskSet& ts)
 {
     if (m_isPaused)
         return;
 
-    auto updateWorldTransforms = sceneTS.EmplaceTask("Scene::UpdateWorldTransform", [this]()
+    m_simFrame = frame;
+    m_simTime = (float)t;
+    m_simulated = true;
+
+    auto updateWorldTransforms = ts.EmplaceTask("Scene::UpdateWorldTransform", [this]()
         {
             if (m_rebuildBVHFlag)
                 InitWorldTransformations();
 
-            if (m_animate)
-            {
-                SmallVector<AnimationUpdate, App::FrameAllocator> animUpdates;
-                UpdateAnimations((float)App::GetTimer().GetTotalTime(), animUpdates);
-                UpdateLocalTransforms(animUpdates);
-            }
-
             if (!m_instanceUpdates.empty())
             {
                 SmallVector<BVH::BVHUpdateInput, App::FrameAllocator> toUpdateInstances;
@@ -125,6 +237,79 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
             m_rebuildBVHFlag = false;
         });
 
+    // Sample the animations in parallel and write the results directly to local transforms 
+    // of animated instances
+    const size_t numAnimations = m_animations.NumAnimations();
+
+    if (m_animate && numAnimations)
+    {
+        if (m_staleAnimationTreePos)
+            UpdateAnimationTreePositions();
+
+        constexpr size_t MAX_NUM_ANIMATION_WORKERS = 4;
+        constexpr size_t MIN_ANIMATIONS_PER_WORKER = 256;
+        size_t threadOffsets[MAX_NUM_ANIMATION_WORKERS];
+        size_t threadSizes[MAX_NUM_ANIMATION_WORKERS];
+
+        const size_t numAnimationWorkers = SubdivideRangeWithMin(numAnimations,
+            MAX_NUM_ANIMATION_WORKERS,
+            threadOffsets,
+            threadSizes,
+            MIN_ANIMATIONS_PER_WORKER);
+
+        const float t = m_simTime;
+
+        for (size_t i = 0; i < numAnimationWorkers; i++)
+        {
+            StackStr(tname, n, "Scene::Animation_%d", i);
+
+            auto h = ts.EmplaceTask(tname, [this, t, offset = threadOffsets[i], size = threadSizes[i]]()
+                {
+                    UpdateAnimations(t, offset, offset + size);
+                });
+
+            ts.AddOutgoingEdge(h, updateWorldTransforms);
+        }
+    }
+
+    // Deform skinned meshes in parallel once joints' world transforms are updated
+    const size_t numSkinnedMeshes = m_skinnedMeshes.NumMeshes();
+
+    if (m_animate && numSkinnedMeshes)
+    {
+        if (m_staleSkinnedMeshTreePos)
+            UpdateSkinnedMeshTreePositions();
+
+        m_skinnedBoundsUpdates.resize(numSkinnedMeshes);
+
+        constexpr size_t MAX_NUM_SKINNING_WORKERS = 3;
+        constexpr size_t MIN_SKINNED_MESHES_PER_WORKER = 2;
+        size_t threadOffsets[MAX_NUM_SKINNING_WORKERS];
+        size_t threadSizes[MAX_NUM_SKINNING_WORKERS];
+
+        const size_t numSkinningWorkers = SubdivideRangeWithMin(numSkinnedMeshes,
+            MAX_NUM_SKINNING_WORKERS,
+            threadOffsets,
+            threadSizes,
+            MIN_SKINNED_MESHES_PER_WORKER);
+
+        const float t = m_simTime;
+
+        for (size_t i = 0; i < numSkinningWorkers; i++)
+        {
+            StackStr(tname, n, "Scene::Skinning_%d", i);
+
+            auto h = ts.EmplaceTask(tname, [this, t, offset = threadOffsets[i], size = threadSizes[i]]()
+                {
+                    DeformSkinnedMeshes(t, offset, offset + size);
+                });
+
+            ts.AddOutgoingEdge(updateWorldTransforms, h);
+        }
+    }
+    else
+        m_skinnedBoundsUpdates.clear();
+
     const uint32_t numInstances = m_emissives.NumInstances();
     m_staleEmissiveMats = m_emissives.HasStaleMaterials() || !m_emissives.Initialized();
     // Size of m_instanceUpdates may change after async. task above runs, but since it never
@@ -151,20 +336,42 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
         if (!m_emissives.Initialized())
 #endif
         {
-            resetRtAsInfo = sceneTS.EmplaceTask("Scene::UpdateRtAsInfo", [this]()
+            resetRtAsInfo = ts.EmplaceTask("Scene::UpdateRtAsInfo", [this]()
                 {
                     ResetRtAsInfos();
                 });
         }
 
-        auto upload = sceneTS.EmplaceTask("UploadEmissiveBuffer", [this]()
+        const int numLightBVHWorkers = Min(RT::LightBVH::MAX_NUM_SUBTREES, App::GetNumWorkerThreads());
+
+        // GPU upload happens in Update() (see UploadSimulationResults())
+        auto upload = ts.EmplaceTask("Scene::UpdateEmissives", [this, numLightBVHWorkers]()
             {
-                m_emissives.UploadToGPU();
+                m_emissives.Update(numLightBVHWorkers);
             });
 
         // Full rebuild of emissive buffer for first time
         if (!m_emissives.Initialized())
         {
+            // Light BVH build starts on first update. Its subtrees are built in parallel after that.
+            auto finishLightBVH = ts.EmplaceTask("Scene::FinishLightBVH", [this]()
+                {
+                    m_emissives.FinishLightBVH();
+                });
+
+            for (int i = 0; i < numLightBVHWorkers; i++)
+            {
+                StackStr(tname, n, "Scene::LightBVH_%d", i);
+
+                auto h = ts.EmplaceTask(tname, [this, i]()
+                    {
+                        m_emissives.BuildLightBVHSubtree(i);
+                    });
+
+                ts.AddOutgoingEdge(upload, h);
+                ts.AddOutgoingEdge(h, finishLightBVH);
+            }
+
             constexpr size_t MAX_NUM_EMISSIVE_WORKERS = 5;
             constexpr size_t MIN_EMISSIVE_INSTANCES_PER_WORKER = 35;
             size_t threadOffsets[MAX_NUM_EMISSIVE_WORKERS];
@@ -180,7 +387,7 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
             {
                 StackStr(tname, n, "Scene::Emissive_%d", i);
 
-                auto h = sceneTS.EmplaceTask(tname, [this, offset = threadOffsets[i], size = threadSizes[i]]()
+                auto h = ts.EmplaceTask(tname, [this, offset = threadOffsets[i], size = threadSizes[i]]()
                     {
                         auto emissvies = m_emissives.Instances();
                         auto tris = m_emissives.Triagnles();
@@ -228,28 +435,66 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
                         }
                     });
 
-                sceneTS.AddOutgoingEdge(updateWorldTransforms, h);
+                ts.AddOutgoingEdge(updateWorldTransforms, h);
 
                 Assert(resetRtAsInfo != TaskSet::INVALID_TASK_HANDLE, "Invalid task handle.");
-                sceneTS.AddOutgoingEdge(resetRtAsInfo, h);
+                ts.AddOutgoingEdge(resetRtAsInfo, h);
 
-                sceneTS.AddOutgoingEdge(h, upload);
+                ts.AddOutgoingEdge(h, upload);
             }
         }
         else if (m_staleEmissivePositions)
         {
-            auto h = sceneTS.EmplaceTask("Scene::UpdateEmissivePos", [this]()
+            // Moved instances are only known after world transforms are updated
+            auto gather = ts.EmplaceTask("Scene::GatherEmissiveUpdates", [this]()
                 {
-                    UpdateEmissivePositions();
+                    GatherEmissiveUpdates();
                 });
 
-            //sceneTS.AddOutgoingEdge(resetRtAsInfo, h);
-            sceneTS.AddOutgoingEdge(h, upload);
+            ts.AddOutgoingEdge(updateWorldTransforms, gather);
+
+            constexpr size_t NUM_EMISSIVE_POS_WORKERS = 4;
+
+            for (size_t i = 0; i < NUM_EMISSIVE_POS_WORKERS; i++)
+            {
+                StackStr(tname, n, "Scene::UpdateEmissivePos_%d", i);
+
+                auto h = ts.EmplaceTask(tname, [this, i]()
+                    {
+                        UpdateEmissivePositions(i, NUM_EMISSIVE_POS_WORKERS);
+                    });
+
+                ts.AddOutgoingEdge(gather, h);
+                ts.AddOutgoingEdge(h, upload);
+            }
         }
 
         m_staleEmissivePositions = false;
     }
 
+}
+
+void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
+{
+    // Whether this frame was already simulated while the previous one was being recorded
+    const bool simulated = m_simulated;
+    m_simulated = false;
+
+    ApplyPendingEdits(simulated);
+    UpdateTextureStreaming();
+
+    if (m_isPaused)
+    {
+        PublishRenderState();
+        return;
+    }
+
+    if (!simulated)
+    {
+        Simulate(App::GetTimer().GetTotalFrameCount(), App::GetTimer().GetTotalTime(), sceneTS);
+        m_simulated = false;
+    }
+
     if (m_meshBufferStale)
     {
         sceneTS.EmplaceTask("Scene::RebuildMeshBuffers", [this]()
@@ -260,6 +505,14 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
         m_meshBufferStale = false;
     }
 
+    // sceneRendererTS runs after sceneTS, so the simulation has finished by then. From here 
+    // on, render tasks only read the published state.
+    sceneRendererTS.EmplaceTask("Scene::FinishUpdate", [this]()
+        {
+            UploadSimulationResults();
+            PublishRenderState();
+        });
+
     m_matBuffer.UploadToGPU();
     m_rendererInterface.Update(sceneRendererTS);
 }
@@ -269,16 +522,24 @@ void SceneCore::Shutdown()
     // Make sure all GPU resources (texture, buffers, etc) are manually released,
     // as they normally call the GPU memory subsystem upon destruction, which
     // is deleted at that point.
+    m_mipStreamer.Shutdown();
+    m_streamedTexIDs.free_memory();
+    m_streamedTexIdx.free_memory();
+    m_matStreamedTextures.free_memory();
     m_matBuffer.Clear();
+#ifdef _WIN32
     m_baseColorDescTable.Clear();
     m_normalDescTable.Clear();
     m_metallicRoughnessDescTable.Clear();
     m_emissiveDescTable.Clear();
+#endif
     m_meshes.Clear();
     m_emissives.Clear();
 
+#ifdef _WIN32
     for (auto& heap : m_textureHeaps)
         heap.Reset();
+#endif
 
     m_rendererInterface.Shutdown();
 }
@@ -287,13 +548,13 @@ uint32_t SceneCore::AddMesh(SmallVector<Vertex>&& vertices, SmallVector<uint32_t
     uint32_t matIdx, bool lock)
 {
     if (lock)
-        AcquireSRWLockExclusive(&m_meshLock);
+        m_meshLock.Lock();
 
     m_numTriangles += (uint32_t)indices.size();
     uint32_t idx = m_meshes.Add(ZetaMove(vertices), ZetaMove(indices), matIdx);
 
     if (lock)
-        ReleaseSRWLockExclusive(&m_meshLock);
+        m_meshLock.Unlock();
 
     return idx;
 }
@@ -302,17 +563,19 @@ void SceneCore::AddMeshes(SmallVector<Asset::Mesh>&& meshes, SmallVector<Vertex>
     SmallVector<uint32_t>&& indices, bool lock)
 {
     if (lock)
-        AcquireSRWLockExclusive(&m_meshLock);
+        m_meshLock.Lock();
 
     m_numTriangles += (uint32_t)indices.size();
     m_meshes.AddBatch(ZetaMove(meshes), ZetaMove(vertices), ZetaMove(indices));
 
     if (lock)
-        ReleaseSRWLockExclusive(&m_meshLock);
+        m_meshLock.Unlock();
 }
 
 void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, bool lock)
 {
+    AddMaterialStreamedTextures(matDesc);
+
     Material mat;
     mat.SetBaseColorFactor(matDesc.BaseColorFactor);
     mat.SetMetallic(matDesc.MetallicFactor);
@@ -332,17 +595,20 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, bool lock)
     mat.SetDoubleSided(matDesc.DoubleSided);
 
     if (lock)
-        AcquireSRWLockExclusive(&m_matLock);
+        m_matLock.Lock();
 
     m_matBuffer.Add(matDesc.ID, mat);
 
     if (lock)
-        ReleaseSRWLockExclusive(&m_matLock);
+        m_matLock.Unlock();
 }
 
+#ifdef _WIN32
 void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Texture> ddsImages,
     bool lock)
 {
+    AddMaterialStreamedTextures(matDesc);
+
     Material mat;
     mat.SetBaseColorFactor(matDesc.BaseColorFactor);
     mat.SetMetallic(matDesc.MetallicFactor);
@@ -361,13 +627,20 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
     mat.SetAlphaMode(matDesc.AlphaMode);
     mat.SetDoubleSided(matDesc.DoubleSided);
 
-    auto addTex = [](Texture::ID_TYPE ID, const char* type, TexSRVDescriptorTable& table, uint32_t& tableOffset, 
+    auto addTex = [this](Texture::ID_TYPE ID, const char* type, TexSRVDescriptorTable& table, uint32_t& tableOffset, 
         MutableSpan<Texture> ddsImages)
         {
             auto idx = BinarySearch(Span(ddsImages), ID, [](const Texture& obj) {return obj.ID(); });
             Check(idx != -1, "%s image with ID %llu was not found.", type, ID);
 
-            tableOffset = table.Add(ZetaMove(ddsImages[idx]));
+            // Only the mip tail of streamed textures has been uploaded
+            float minLOD = 0.0f;
+            m_streamingLock.Lock();
+            if (auto texIdx = m_streamedTexIdx.find(ID); texIdx)
+                minLOD = (float)m_mipStreamer.Scheduler().ResidentMip(*texIdx.value());
+            m_streamingLock.Unlock();
+
+            tableOffset = table.Add(ZetaMove(ddsImages[idx]), minLOD);
 
             // HACK Since the texture was moved, ID was changed to -1. Add a dummy texture with the same ID
             // so that binary search continues to work.
@@ -375,7 +648,7 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
         };
 
     if (lock)
-        AcquireSRWLockExclusive(&m_matLock);
+        m_matLock.Lock();
 
     {
         uint32_t tableOffset = Material::INVALID_ID;    // i.e. index in GPU descriptor table
@@ -421,7 +694,233 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
     m_matBuffer.Add(matDesc.ID, mat);
 
     if (lock)
-        ReleaseSRWLockExclusive(&m_matLock);
+        m_matLock.Unlock();
+}
+#endif
+
+bool SceneCore::AddStreamedTexture(const char* ddsPath, uint64_t texID, Streaming::DDSTextureDesc& desc,
+    SmallVector<uint8_t>& tail, uint32_t& firstTailMip)
+{
+    const double time = App::GetTimer().GetTotalTime();
+    uint32_t texIdx;
+
+    m_streamingLock.Lock();
+
+    if (!m_mipStreamer.AddTexture(ddsPath, desc, texIdx))
+    {
+        m_streamingLock.Unlock();
+        return false;
+    }
+
+    Assert(texIdx == m_streamedTexIDs.size(), "bug");
+    m_streamedTexIDs.push_back(texID);
+    m_streamedTexIdx[texID] = texIdx;
+
+    const Streaming::MipScheduler::MipLoad load = m_mipStreamer.IssueTail(texIdx, time);
+    void* file = m_mipStreamer.File(texIdx);
+
+    m_streamingLock.Unlock();
+
+    // Read outside the lock so that textures can be loaded in parallel
+    const bool success = Streaming::MipStreamer::ReadMips(file, load, tail);
+    Check(success, "Reading the mip tail of texture %s failed.", ddsPath);
+
+    m_streamingLock.Lock();
+    m_mipStreamer.OnTailLoaded(texIdx, time, success);
+    m_streamingLock.Unlock();
+
+    firstTailMip = load.FirstMip;
+
+    return true;
+}
+
+void SceneCore::AddMaterialStreamedTextures(const Asset::MaterialDesc& matDesc)
+{
+    const TextureID texIDs[] = { matDesc.BaseColorTexID, matDesc.NormalTexID,
+        matDesc.MetallicRoughnessTexID, matDesc.EmissiveTexID };
+    MaterialStreamedTextures streamed;
+    bool found = false;
+
+    m_streamingLock.Lock();
+
+    for (int i = 0; i < ZetaArrayLen(texIDs); i++)
+    {
+        streamed.TexIdx[i] = UINT32_MAX;
+        if (texIDs[i] == INVALID_TEXTURE_ID)
+            continue;
+
+        if (auto texIdx = m_streamedTexIdx.find(texIDs[i]); texIdx)
+        {
+            streamed.TexIdx[i] = *texIdx.value();
+            found = true;
+        }
+    }
+
+    if (found)
+        m_matStreamedTextures[matDesc.ID] = streamed;
+
+    m_streamingLock.Unlock();
+}
+
+void SceneCore::SetTextureStreamingView(const float3& pos, float tanHalfFovY, uint32_t screenHeight)
+{
+    m_streamingView = TextureStreamingView{ .Pos = pos,
+        .TanHalfFovY = tanHalfFovY,
+        .ScreenHeight = screenHeight };
+    m_hasStreamingView = true;
+}
+
+void SceneCore::UpdateMipPriorities()
+{
+    const Streaming::MipScheduler& scheduler = m_mipStreamer.Scheduler();
+    const uint32_t numTextures = scheduler.NumTextures();
+
+    // Mips are never dropped, so there's nothing left to prioritize once every texture is 
+    // fully resident
+    bool allResident = true;
+    for (uint32_t t = 0; t < numTextures && allResident; t++)
+        allResident = scheduler.ResidentMip(t) == 0;
+
+    if (allResident)
+        return;
+
+    // Largest screen-space footprint among the instances that reference each texture
+    SmallVector<float, App::FrameAllocator> footprints;
+    footprints.resize(numTextures, 0.0f);
+
+    float3 camPos = m_streamingView.Pos;
+    const __m128 vCamPos = loadFloat3(camPos);
+
+    m_instanceLock.LockShared();
+    m_meshLock.Lock();
+
+    for (size_t treeLevelIdx = 1; treeLevelIdx < m_sceneGraph.size(); treeLevelIdx++)
+    {
+        const auto& currTreeLevel = m_sceneGraph[treeLevelIdx];
+
+        for (size_t i = 0; i < currTreeLevel.m_meshIDs.size(); i++)
+        {
+            const uint64_t meshID = currTreeLevel.m_meshIDs[i];
+            if (meshID == Scene::INVALID_MESH)
+                continue;
+
+            const TriangleMesh* mesh = m_meshes.GetMesh(meshID).value();
+            auto streamed = m_matStreamedTextures.find(mesh->m_materialID);
+            if (!streamed)
+                continue;
+
+            const v_AABB vBox = transform(load4x3(currTreeLevel.m_toWorlds[i]), v_AABB(mesh->m_AABB));
+            const float radius = _mm_cvtss_f32(length(vBox.vExtents));
+            const float distance = _mm_cvtss_f32(length(_mm_sub_ps(vBox.vCenter, vCamPos)));
+            const float area = Streaming::MipScheduler::ScreenFootprint(radius, distance, 
+                m_streamingView.TanHalfFovY, m_streamingView.ScreenHeight);
+
+            for (uint32_t t : streamed.value()->TexIdx)
+            {
+                if (t != UINT32_MAX)
+                    footprints[t] = Max(footprints[t], area);
+            }
+        }
+    }
+
+    m_meshLock.Unlock();
+    m_instanceLock.UnlockShared();
+
+    // Textures that aren't referenced by any instance only need their tail
+    for (uint32_t t = 0; t < numTextures; t++)
+    {
+        const uint32_t desiredMip = Streaming::MipScheduler::DesiredMipFromFootprint(
+            scheduler.GetDesc(t), footprints[t]);
+        m_mipStreamer.SetPriority(t, desiredMip, footprints[t]);
+    }
+}
+
+void SceneCore::UpdateTextureStreaming()
+{
+    if (m_streamedTexIDs.empty())
+        return;
+
+#ifdef _WIN32
+    const Camera& camera = App::GetCamera();
+    SetTextureStreamingView(camera.GetPos(), camera.GetTanHalfFOV(), 
+        App::GetRenderer().GetRenderHeight());
+#endif
+
+    if (m_hasStreamingView)
+        UpdateMipPriorities();
+
+    const uint64_t frame = App::GetTimer().GetTotalFrameCount();
+
+#ifdef _WIN32
+    // Uploads from MAX_FRAMES_IN_FLIGHT frames ago have finished, their mips can be sampled
+    for (auto it = m_pendingMinLODs.begin(); it != m_pendingMinLODs.end();)
+    {
+        if (it->Frame + FramePipeline::MAX_FRAMES_IN_FLIGHT > frame)
+        {
+            it++;
+            continue;
+        }
+
+        const float minLOD = (float)it->Mip;
+        m_baseColorDescTable.SetMinLOD(it->TexID, minLOD);
+        m_normalDescTable.SetMinLOD(it->TexID, minLOD);
+        m_metallicRoughnessDescTable.SetMinLOD(it->TexID, minLOD);
+        m_emissiveDescTable.SetMinLOD(it->TexID, minLOD);
+
+        it = m_pendingMinLODs.erase(*it);
+    }
+#endif
+
+    const Streaming::MipScheduler& scheduler = m_mipStreamer.Scheduler();
+    const Streaming::MipScheduler::Stats stats = scheduler.GetStats();
+    if (stats.NumComplete == stats.NumTextures && stats.NumLoading == 0)
+        return;
+
+    m_completedMipLoads.clear();
+    m_mipStreamer.Update(App::GetTimer().GetTotalTime(), m_completedMipLoads);
+
+    for (auto& c : m_completedMipLoads)
+    {
+        const uint64_t texID = m_streamedTexIDs[c.Load.Texture];
+
+#ifdef _WIN32
+        Texture* tex = m_baseColorDescTable.Find(texID);
+        tex = tex ? tex : m_normalDescTable.Find(texID);
+        tex = tex ? tex : m_metallicRoughnessDescTable.Find(texID);
+        tex = tex ? tex : m_emissiveDescTable.Find(texID);
+
+        if (tex)
+        {
+            const Streaming::DDSTextureDesc& desc = scheduler.GetDesc(c.Load.Texture);
+            D3D12_SUBRESOURCE_DATA subresources[16];
+            const uint32_t numMips = c.Load.LastMip - c.Load.FirstMip + 1;
+
+            for (uint32_t i = 0; i < numMips; i++)
+            {
+                const uint32_t mip = c.Load.FirstMip + i;
+                subresources[i].pData = m_mipStreamer.MipData(c, mip).data();
+                subresources[i].RowPitch = ((desc.MipWidth(mip) + 3) / 4) * desc.BlockSize;
+                subresources[i].SlicePitch = desc.MipSize(mip);
+            }
+
+            // Data is copied to an upload buffer, so the staging buffer can be released below
+            GpuMemory::UploadToTexture(*tex, Span(subresources, numMips), c.Load.FirstMip,
+                D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+
+            m_pendingMinLODs.push_back(PendingMinLOD{ .Frame = frame,
+                .TexID = texID,
+                .Mip = c.Load.FirstMip });
+        }
+        // Not referenced by any material, nothing left to load
+        else
+        {
+            const uint32_t firstTailMip = scheduler.FirstTailMip(c.Load.Texture);
+            m_mipStreamer.SetPriority(c.Load.Texture, firstTailMip, 0.0f);
+        }
+#endif
+
+        m_mipStreamer.Release(c.StagingBuffer);
+    }
 }
 
 void SceneCore::UpdateMaterial(uint32 ID, const Material& newMat)
@@ -438,10 +937,10 @@ void SceneCore::ResizeAdditionalMaterials(uint32_t num)
 void SceneCore::AddInstance(Asset::InstanceDesc& instance, bool lock)
 {
     const uint64_t meshID = instance.MeshIdx == -1 ? INVALID_MESH :
-        MeshID(instance.SceneID, instance.MeshIdx, instance.MeshPrimIdx);
+        MeshID(instance.SceneID, instance.MeshIdx, instance.MeshPrimIdx, instance.MeshNodeIdx);
 
     if (lock)
-        AcquireSRWLockExclusive(&m_instanceLock);
+        m_instanceLock.LockExclusive();
 
     if (meshID != INVALID_MESH)
     {
@@ -463,7 +962,7 @@ void SceneCore::AddInstance(Asset::InstanceDesc& instance, bool lock)
     // Get parent's index from the hashmap
     if (instance.ParentID != ROOT_ID)
     {
-        const TreePos& p = FindTreePosFromID(instance.ParentID).value();
+        const TreePos p = FindTreePosFromID(instance.ParentID).value();
 
         treeLevel = p.Level + 1;
         parentIdx = p.Offset;
@@ -489,9 +988,12 @@ void SceneCore::AddInstance(Asset::InstanceDesc& instance, bool lock)
     }
 
     m_rebuildBVHFlag = true;
+    // Insertion may have shifted tree positions of animated instances
+    m_staleAnimationTreePos = true;
+    m_staleSkinnedMeshTreePos = true;
 
     if (lock)
-        ReleaseSRWLockExclusive(&m_instanceLock);
+        m_instanceLock.UnlockExclusive();
 }
 
 uint32_t SceneCore::InsertAtLevel(uint64_t id, uint32_t treeLevel, uint32_t parentIdx, 
@@ -614,7 +1116,7 @@ void SceneCore::AddAnimation(uint64_t id, MutableSpan<Keyframe> keyframes, float
     bool loop, bool isSorted)
 {
 #ifndef NDEBUG
-    TreePos& p = FindTreePosFromID(id).value();
+    TreePos p = FindTreePosFromID(id).value();
     Assert(RT_Flags::Decode(m_sceneGraph[p.Level].m_rtFlags[p.Offset]).MeshMode != RT_MESH_MODE::STATIC,
         "Static instances can't be animated.");
 #endif
@@ -623,43 +1125,218 @@ void SceneCore::AddAnimation(uint64_t id, MutableSpan<Keyframe> keyframes, float
 
     if (!isSorted)
     {
-        std::sort(m_keyframes.begin(), m_keyframes.end(),
+        std::sort(keyframes.begin(), keyframes.end(),
             [](const Keyframe& k1, const Keyframe& k2)
             {
                 return k1.Time < k2.Time;
             });
     }
 
-    // Remember starting offset and number of keyframes
-    const uint32_t currOffset = (uint32_t)m_keyframes.size();
-    m_animationMetadata.push_back(AnimationMetadata{
-            .InstanceID = id,
-            .StartOffset = currOffset,
-            .Length = (uint32_t)keyframes.size(),
-            .T0 = t_start,
-            .Loop = loop
-        });
+    m_animations.Add(id, keyframes, t_start, loop);
+    m_staleAnimationTreePos = true;
+}
+
+void SceneCore::AddSkinnedMesh(const SkinnedMeshDesc& desc, bool lock)
+{
+    if (lock)
+        m_instanceLock.LockExclusive();
+
+#ifndef NDEBUG
+    TreePos p = FindTreePosFromID(desc.InstanceID).value();
+    Assert(RT_Flags::Decode(m_sceneGraph[p.Level].m_rtFlags[p.Offset]).MeshMode != RT_MESH_MODE::STATIC,
+        "Static instances can't be deformed.");
+#endif
 
-    m_keyframes.append_range(keyframes.begin(), keyframes.end());
+    m_skinnedMeshes.Add(desc);
+    m_staleSkinnedMeshTreePos = true;
+
+    if (lock)
+        m_instanceLock.UnlockExclusive();
 }
 
 void SceneCore::TransformInstance(uint64_t id, const float3& tr, const float3x3& rotation,
     const float3& scale)
 {
-    m_tempWorldTransformUpdates[id] = TransformUpdate{ .Tr = tr, .Rotation = rotation, .Scale = scale };
+    m_editLock.Lock();
+    m_pendingTransformEdits.push_back(TransformEdit{ .InstanceID = id,
+        .Delta = TransformUpdate{ .Tr = tr, .Rotation = rotation, .Scale = scale } });
+    m_editLock.Unlock();
+}
+
+void SceneCore::ApplyPendingEdits(bool simulated)
+{
+    m_editLock.Lock();
 
-    const auto treePos = FindTreePosFromID(id).value();
-    const auto rtFlags = RT_Flags::Decode(m_sceneGraph[treePos.Level].m_rtFlags[treePos.Offset]);
+    // Frame before the one that the edits are simulated in (see UpdateWorldTransformations())
+    const uint64_t frame = App::GetTimer().GetTotalFrameCount() - !simulated;
 
-    m_staleEmissivePositions = m_staleEmissivePositions || 
-        (m_emissives.NumInstances() &&
-        (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE));
+    for (auto& e : m_pendingTransformEdits)
+    {
+        // Edits to the same instance since the last simulation are combined
+        if (auto it = m_tempWorldTransformUpdates.find(e.InstanceID); it)
+        {
+            auto& curr = *it.value();
+            curr.Tr += e.Delta.Tr;
+            curr.Scale *= e.Delta.Scale;
+
+            v_float4x4 vR = mul(load3x3(curr.Rotation), load3x3(e.Delta.Rotation));
+            curr.Rotation = float3x3(store(vR));
+        }
+        else
+            m_tempWorldTransformUpdates[e.InstanceID] = e.Delta;
 
-    ConvertInstanceDynamic(id, treePos, rtFlags);
-    // Updates if instance already exists
-    m_instanceUpdates[id] = App::GetTimer().GetTotalFrameCount();
+        // When this frame has already been simulated, the edit applies in the next one, so 
+        // that's where it's captured
+        App::CaptureTransformEdit(e.InstanceID, e.Delta.Tr, e.Delta.Rotation, e.Delta.Scale, 
+            simulated);
 
-    m_rendererInterface.SceneModified();
+        const auto treePos = FindTreePosFromID(e.InstanceID).value();
+        const auto rtFlags = RT_Flags::Decode(m_sceneGraph[treePos.Level].m_rtFlags[treePos.Offset]);
+
+        m_staleEmissivePositions = m_staleEmissivePositions ||
+            (m_emissives.NumInstances() &&
+            (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE));
+
+        ConvertInstanceDynamic(e.InstanceID, treePos, rtFlags);
+        // Updates if instance already exists
+        m_instanceUpdates[e.InstanceID] = frame;
+    }
+
+    for (auto& e : m_pendingEmissiveEdits)
+        m_emissives.UpdateMaterial(e.InstanceID, e.EmissiveFactor, e.Strength);
+
+    if (!m_pendingTransformEdits.empty() || !m_pendingEmissiveEdits.empty())
+        m_rendererInterface.SceneModified();
+
+    m_pendingTransformEdits.clear();
+    m_pendingEmissiveEdits.clear();
+
+    m_editLock.Unlock();
+}
+
+void SceneCore::UploadSimulationResults()
+{
+    m_emissives.UploadToGPU();
+
+    // Replace the vertices of deformed meshes (CPU copy if retained and GPU vertex buffer), 
+    // which the renderer's BLAS refit reads from
+    for (size_t i = 0; i < m_skinnedBoundsUpdates.size(); i++)
+    {
+        const TreePos& p = m_skinnedMeshTreePos[i];
+        const TriangleMesh* mesh = GetMesh(m_sceneGraph[p.Level].m_meshIDs[p.Offset]).value();
+        m_meshes.UpdateVertices(mesh->m_vtxBuffStartOffset, m_skinnedMeshes.DeformedVertices(i));
+    }
+}
+
+void SceneCore::PublishRenderState()
+{
+    m_pickLock.LockShared();
+    m_pickedStates.resize(m_pickedInstances.size());
+
+    for (size_t i = 0; i < m_pickedInstances.size(); i++)
+    {
+        const uint64_t id = m_pickedInstances[i];
+        PickedInstance& state = m_pickedStates[i];
+
+        state.ID = id;
+        state.MeshID = GetInstanceMeshID(id);
+        state.ToWorld = GetToWorld(id);
+        state.Bounds = GetAABB(id);
+
+        auto local = m_worldTransformUpdates.find(id);
+        state.LocalTransform = local ? *local.value() : AffineTransformation::GetIdentity();
+
+        // Include the edits that haven't been simulated yet, otherwise e.g. the gizmo would
+        // apply the same edit again
+        if (auto pending = m_tempWorldTransformUpdates.find(id); pending)
+        {
+            const TransformUpdate& delta = *pending.value();
+            const v_float4x4 vdR = load3x3(delta.Rotation);
+            const v_float4x4 vW = ApplyTransformEdit(load4x3(state.ToWorld), delta.Tr, vdR,
+                delta.Scale);
+
+            state.ToWorld = float4x3(store(vW));
+            AccumulateTransformEdit(state.LocalTransform, delta.Tr, vdR, delta.Scale);
+        }
+    }
+
+    m_pickLock.UnlockShared();
+}
+
+void SceneCore::GetMemoryReport(MemoryReport& report)
+{
+    m_instanceLock.LockShared();
+
+    for (auto& level : m_sceneGraph)
+    {
+        report.Add("SceneCore", "m_sceneGraph[].m_IDs", level.m_IDs);
+        report.Add("SceneCore", "m_sceneGraph[].m_localTransforms", level.m_localTransforms);
+        report.Add("SceneCore", "m_sceneGraph[].m_toWorlds", level.m_toWorlds);
+        report.Add("SceneCore", "m_sceneGraph[].m_meshIDs", level.m_meshIDs);
+        report.Add("SceneCore", "m_sceneGraph[].m_subtreeRanges", level.m_subtreeRanges);
+        report.Add("SceneCore", "m_sceneGraph[].m_rtFlags", level.m_rtFlags);
+        report.Add("SceneCore", "m_sceneGraph[].m_rtASInfo", level.m_rtASInfo);
+    }
+
+    report.Add("SceneCore", "m_sceneGraph", m_sceneGraph);
+    report.Add("SceneCore", "m_IDtoTreePos", m_IDtoTreePos);
+    report.Add("SceneCore", "m_rtMeshInstanceIdxToID", m_rtMeshInstanceIdxToID);
+    report.Add("SceneCore", "m_prevToWorlds", m_prevToWorlds);
+    report.Add("SceneCore", "m_instanceUpdates", m_instanceUpdates);
+    report.Add("SceneCore", "m_tempWorldTransformUpdates", m_tempWorldTransformUpdates);
+    report.Add("SceneCore", "m_worldTransformUpdates", m_worldTransformUpdates);
+    report.Add("SceneCore", "m_pendingRtMeshModeSwitch", m_pendingRtMeshModeSwitch);
+    report.Add("SceneCore", "m_emissiveUpdates", m_emissiveUpdates);
+    report.Add("SceneCore", "m_emissiveDirtyRanges", m_emissiveDirtyRanges);
+    report.Add("SceneCore", "m_animationTreePos", m_animationTreePos);
+    report.Add("SceneCore", "m_skinnedMeshTreePos", m_skinnedMeshTreePos);
+    report.Add("SceneCore", "m_jointTreePos", m_jointTreePos);
+    report.Add("SceneCore", "m_jointTreePosOffsets", m_jointTreePosOffsets);
+    report.Add("SceneCore", "m_skinnedBoundsUpdates", m_skinnedBoundsUpdates);
+
+    m_animations.ReportMemory(report);
+    m_skinnedMeshes.ReportMemory(report);
+
+    m_instanceLock.UnlockShared();
+
+    m_meshLock.Lock();
+    m_meshes.ReportMemory(report);
+    m_meshLock.Unlock();
+
+    m_matLock.Lock();
+    m_matBuffer.ReportMemory(report);
+    m_matLock.Unlock();
+
+    m_emissiveLock.Lock();
+    m_emissives.ReportMemory(report);
+    m_emissiveLock.Unlock();
+
+    m_pickLock.LockShared();
+    report.Add("SceneCore", "m_pickedInstances", m_pickedInstances);
+    report.Add("SceneCore", "m_pickedStates", m_pickedStates);
+    m_pickLock.UnlockShared();
+}
+
+void SceneCore::AddMemoryStats()
+{
+    m_memoryReport.Clear();
+    GetMemoryReport(m_memoryReport);
+
+    // Used and slack (reserved but unused) memory of each owner
+    auto containers = m_memoryReport.Containers();
+    for (size_t i = 0; i < containers.size(); i++)
+    {
+        if (!m_memoryReport.IsFirstOfOwner(i))
+            continue;
+
+        const char* owner = containers[i].Owner;
+        const MemoryReport::OwnerTotals t = m_memoryReport.Totals(owner);
+
+        StackStr(used, n1, "%s (KB)", owner);
+        StackStr(slack, n2, "%s slack (KB)", owner);
+        App::AddFrameStat("Scene memory", used, (uint32_t)(t.UsedBytes >> 10));
+        App::AddFrameStat("Scene memory", slack, (uint32_t)((t.ReservedBytes - t.UsedBytes) >> 10));
+    }
 }
 
 void SceneCore::ReserveInstances(Span<int> treeLevels, size_t total)
@@ -681,7 +1358,7 @@ void SceneCore::ReserveInstances(Span<int> treeLevels, size_t total)
 
     m_prevToWorlds.resize(total, true);
     m_IDtoTreePos.resize(total, true);
-    m_worldTransformUpdates.resize(Min(total, 32llu));
+    m_worldTransformUpdates.resize(Min(total, (size_t)32));
 }
 
 void SceneCore::AddEmissives(Util::SmallVector<Asset::EmissiveInstance>&& emissiveInstances,
@@ -691,18 +1368,21 @@ void SceneCore::AddEmissives(Util::SmallVector<Asset::EmissiveInstance>&& emissi
         return;
 
     if(lock)
-        AcquireSRWLockExclusive(&m_emissiveLock);
+        m_emissiveLock.Lock();
     
     m_emissives.AddBatch(ZetaMove(emissiveInstances), ZetaMove(emissiveTris));
 
     if(lock)
-        ReleaseSRWLockExclusive(&m_emissiveLock);
+        m_emissiveLock.Unlock();
 }
 
 void SceneCore::UpdateEmissiveMaterial(uint64_t instanceID, const float3& emissiveFactor, float strength)
 {
-    m_emissives.UpdateMaterial(instanceID, emissiveFactor, strength);
-    m_rendererInterface.SceneModified();
+    m_editLock.Lock();
+    m_pendingEmissiveEdits.push_back(EmissiveMaterialEdit{ .InstanceID = instanceID,
+        .EmissiveFactor = emissiveFactor,
+        .Strength = strength });
+    m_editLock.Unlock();
 }
 
 void SceneCore::InitWorldTransformations()
@@ -758,7 +1438,7 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
     };
 
     SmallVector<Entry, App::FrameAllocator, 10> stack;
-    const auto currFrame = App::GetTimer().GetTotalFrameCount();
+    const auto currFrame = m_simFrame;
 
     // Can't append while iterating
     SmallVector<uint64, App::FrameAllocator, 3> toAppend;
@@ -768,7 +1448,7 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
     {
         const auto instance = it->Key;
         const auto frame = it->Val;
-        const TreePos& p = FindTreePosFromID(instance).value();
+        const TreePos p = FindTreePosFromID(instance).value();
 
         // -1 -> update was added at the tail end of last frame
         if (frame < currFrame - 1)
@@ -780,23 +1460,11 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
 
         // Grab current to world transformation
         const float4x3& prevW = m_sceneGraph[p.Level].m_toWorlds[p.Offset];
-        v_float4x4 vW = load4x3(prevW);
-
-        float4a t;
-        float4a r;
-        float4a s;
-        decomposeSRT(vW, s, r, t);
 
         // Apply the update
         auto& delta = m_tempWorldTransformUpdates[instance];
-        float3 newTr = delta.Tr + t.xyz();
-        float3 newScale = delta.Scale * s.xyz();
-
-        v_float4x4 vR = rotationMatFromQuat(load(r));
         v_float4x4 vNewR = load3x3(delta.Rotation);
-        vR = mul(vR, vNewR);
-
-        v_float4x4 vNewWorld = affineTransformation(vR, newScale, newTr);
+        v_float4x4 vNewWorld = ApplyTransformEdit(load4x3(prevW), delta.Tr, vNewR, delta.Scale);
 
         float3x3 R = float3x3(store(vNewR));
         Assert(fabsf(R.m[0].length() - 1) < 1e-5, "");
@@ -818,15 +1486,7 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
 
         // Remember transformation update for future
         if (auto existingIt = m_worldTransformUpdates.find(instance); existingIt)
-        {
-            auto& curr = *existingIt.value();
-            curr.Translation += delta.Tr;
-            curr.Scale *= delta.Scale;
-
-            v_float4x4 vCurrR = rotationMatFromQuat(loadFloat4(curr.Rotation));
-            vCurrR = mul(vCurrR, vNewR);
-            curr.Rotation = quaternionFromRotationMat1(vCurrR);
-        }
+            AccumulateTransformEdit(*existingIt.value(), delta.Tr, vNewR, delta.Scale);
         else
         {
             AffineTransformation tr;
@@ -891,131 +1551,194 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
     m_tempWorldTransformUpdates.clear();
     
     for(auto id : toAppend)
-        m_instanceUpdates[id] = App::GetTimer().GetTotalFrameCount() - 1;
+        m_instanceUpdates[id] = m_simFrame - 1;
 }
 
-void SceneCore::UpdateEmissivePositions()
+void SceneCore::GatherEmissiveUpdates()
 {
-    auto tris = m_emissives.Triagnles();
-    auto triInitialPos = m_emissives.InitialTriPositions();
+    m_emissiveUpdates.clear();
+    m_emissiveDirtyRanges.clear();
 
-    uint32_t minIdx = (uint32_t)tris.size() - 1;
-    uint32_t maxIdx = 0;
+    const auto currFrame = m_simFrame;
 
     for (auto it = m_instanceUpdates.begin_it(); it != m_instanceUpdates.end_it();
         it = m_instanceUpdates.next_it(it))
     {
-        auto instance = it->Key;
-        const auto& emissiveInstance = *m_emissives.FindInstance(instance).value();
-        const v_float4x4 vW = load4x3(GetToWorld(instance));
-        const auto rtASInfo = GetInstanceRtASInfo(instance);
+        // Instance hasn't moved (see UpdateWorldTransformations())
+        if (it->Val < currFrame - 1)
+            continue;
+
+        auto emissiveInstance = m_emissives.FindInstance(it->Key);
+        if (!emissiveInstance)
+            continue;
 
-        for (size_t t = emissiveInstance.BaseTriOffset; 
-            t < emissiveInstance.BaseTriOffset + emissiveInstance.NumTriangles; t++)
+        m_emissiveUpdates.push_back(EmissiveUpdate{
+            .InstanceID = it->Key,
+            .BaseTriOffset = emissiveInstance.value()->BaseTriOffset,
+            .NumTriangles = emissiveInstance.value()->NumTriangles });
+    }
+
+    std::sort(m_emissiveUpdates.begin(), m_emissiveUpdates.end(),
+        [](const EmissiveUpdate& lhs, const EmissiveUpdate& rhs)
         {
-            EmissiveBuffer::Triangle& initTri = triInitialPos[t];
-
-            __m128 vV0;
-            __m128 vV1;
-            __m128 vV2;
-            RT::EmissiveTriangle::DecodeVertices(initTri.Vtx0, initTri.V0V1, initTri.V0V2,
-                initTri.EdgeLengths,
-                vV0, vV1, vV2);
-
-            vV0 = mul(vW, vV0);
-            vV1 = mul(vW, vV1);
-            vV2 = mul(vW, vV2);
-            tris[t].StoreVertices(vV0, vV1, vV2);
-
-            // Dynamic instances have geometry index = 0
-            const uint32_t hash = Pcg3d(uint3(0,
-                rtASInfo.InstanceID,
-                initTri.PrimIdx)).x;
-            tris[t].ID = hash;
-        }
+            return lhs.BaseTriOffset < rhs.BaseTriOffset;
+        });
+
+    // Triangles of each instance are contiguous, so only instances that are next to each 
+    // other in the emissive buffer need to be merged
+    uint32_t prefixSum = 0;
 
-        minIdx = Min(minIdx, emissiveInstance.BaseTriOffset);
-        maxIdx = Max(maxIdx, emissiveInstance.BaseTriOffset + emissiveInstance.NumTriangles);
+    for (auto& e : m_emissiveUpdates)
+    {
+        e.TriPrefixSum = prefixSum;
+        prefixSum += e.NumTriangles;
+
+        if (!m_emissiveDirtyRanges.empty() && 
+            m_emissiveDirtyRanges.back().Base + m_emissiveDirtyRanges.back().Count == e.BaseTriOffset)
+        {
+            m_emissiveDirtyRanges.back().Count += e.NumTriangles;
+        }
+        else
+            m_emissiveDirtyRanges.push_back(EmissiveBuffer::TriRange{ .Base = e.BaseTriOffset, .Count = e.NumTriangles });
     }
 
-    Assert(minIdx <= maxIdx, "Invalid indices.");
-    m_emissives.UpdateTriPositions(minIdx, maxIdx);
+    m_emissives.UpdateTriPositions(m_emissiveDirtyRanges);
 }
 
-void SceneCore::UpdateAnimations(float t, Vector<AnimationUpdate, App::FrameAllocator>& animVec)
+void SceneCore::UpdateEmissivePositions(size_t workerIdx, size_t numWorkers)
 {
-    for (auto& anim : m_animationMetadata)
-    {
-        AffineTransformation vRes;
+    if (m_emissiveUpdates.empty())
+        return;
 
-        const Keyframe& kStart = m_keyframes[anim.StartOffset];
-        const Keyframe& kEnd = m_keyframes[anim.StartOffset + anim.Length - 1];
-        const float t_start = anim.T0;
+    // Split the triangles (rather than instances) evenly between the workers
+    const EmissiveUpdate& last = m_emissiveUpdates.back();
+    const uint64_t numTris = last.TriPrefixSum + last.NumTriangles;
+    const uint32_t begin = (uint32_t)((numTris * workerIdx) / numWorkers);
+    const uint32_t end = (uint32_t)((numTris * (workerIdx + 1)) / numWorkers);
 
-        // Fast paths
-        if (t <= kStart.Time + t_start)
-        {
-            vRes = kStart.Transform;
-        }
-        else if (!anim.Loop && t >= kEnd.Time + t_start)
+    if (begin == end)
+        return;
+
+    // First instance that contains triangle "begin"
+    auto it = std::upper_bound(m_emissiveUpdates.begin(), m_emissiveUpdates.end(), begin,
+        [](uint32_t t, const EmissiveUpdate& e)
         {
-            vRes = kEnd.Transform;
-        }
-        else
+            return t < e.TriPrefixSum;
+        });
+    Assert(it != m_emissiveUpdates.begin(), "Invalid prefix sum.");
+    it--;
+
+    auto tris = m_emissives.Triagnles();
+    auto triInitialPos = m_emissives.InitialTriPositions();
+
+    for (; it != m_emissiveUpdates.end() && it->TriPrefixSum < end; it++)
+    {
+        const uint32_t triBeg = Max(begin, it->TriPrefixSum) - it->TriPrefixSum;
+        const uint32_t triEnd = Min(end, it->TriPrefixSum + it->NumTriangles) - it->TriPrefixSum;
+        const auto rtASInfo = GetInstanceRtASInfo(it->InstanceID);
+
+        TransformEmissiveTriangles(triInitialPos.data() + it->BaseTriOffset + triBeg,
+            tris.data() + it->BaseTriOffset + triBeg,
+            triEnd - triBeg,
+            GetToWorld(it->InstanceID),
+            rtASInfo.InstanceID);
+    }
+}
+
+void SceneCore::UpdateSkinnedMeshTreePositions()
+{
+    m_instanceLock.LockShared();
+
+    const size_t numMeshes = m_skinnedMeshes.NumMeshes();
+    m_skinnedMeshTreePos.resize(numMeshes);
+    m_jointTreePosOffsets.resize(numMeshes);
+    m_jointTreePos.clear();
+
+    for (size_t i = 0; i < numMeshes; i++)
+    {
+        m_skinnedMeshTreePos[i] = FindTreePosFromID(m_skinnedMeshes.InstanceID(i)).value();
+        m_jointTreePosOffsets[i] = (uint32_t)m_jointTreePos.size();
+
+        for (size_t j = 0; j < m_skinnedMeshes.NumJoints(i); j++)
+            m_jointTreePos.push_back(FindTreePosFromID(m_skinnedMeshes.JointID(i, j)).value());
+    }
+
+    m_staleSkinnedMeshTreePos = false;
+
+    m_instanceLock.UnlockShared();
+}
+
+void SceneCore::DeformSkinnedMeshes(float t, size_t begin, size_t end)
+{
+    SmallVector<float4x3, App::FrameAllocator, 64> jointToWorlds;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const TreePos& p = m_skinnedMeshTreePos[i];
+        const float4x3& meshToWorld = m_sceneGraph[p.Level].m_toWorlds[p.Offset];
+        const uint32_t numJoints = m_skinnedMeshes.NumJoints(i);
+
+        if (numJoints)
         {
-            if (t >= kEnd.Time + t_start)
+            jointToWorlds.resize(numJoints);
+
+            for (uint32_t j = 0; j < numJoints; j++)
             {
-                float numLoops = floorf((t - kStart.Time) / (kEnd.Time - kStart.Time));
-                float excess = numLoops * (kEnd.Time - kStart.Time) + kStart.Time;
-                t -= excess;
-                t += kStart.Time;
+                const TreePos& jp = m_jointTreePos[m_jointTreePosOffsets[i] + j];
+                jointToWorlds[j] = m_sceneGraph[jp.Level].m_toWorlds[jp.Offset];
             }
 
-            auto idx = FindInterval(Span(m_keyframes), t, [](const Keyframe& k) { return k.Time; },
-                anim.StartOffset,
-                anim.StartOffset + anim.Length - 1);
+            m_skinnedMeshes.UpdateJointMatrices(i, meshToWorld, jointToWorlds);
+        }
 
-            Assert(idx != -1, "FindInterval() unexpectedly failed.");
-            Keyframe& k1 = m_keyframes[idx];
-            Keyframe& k2 = m_keyframes[idx + 1];
+        m_skinnedMeshes.UpdateMorphWeights(i, t);
+        // Deformed vertices are uploaded in Update() (see UploadSimulationResults())
+        m_skinnedMeshes.Deform(i);
 
-            Assert(t >= k1.Time + t_start && t <= k2.Time + t_start, "bug");
-            Assert(k1.Time < k2.Time, "divide-by-zero");
+        const uint64_t instanceID = m_skinnedMeshes.InstanceID(i);
 
-            float interpolatedT = (t - (k1.Time + t_start)) / (k2.Time - k1.Time);
+        // Bounds are in the instance's local space, old box was seen with the previous transformation
+        const v_float4x4 vW = load4x3(meshToWorld);
+        auto prevW = m_prevToWorlds.find(instanceID);
+        const v_float4x4 vPrevW = prevW ? load4x3(*prevW.value()) : vW;
 
-            // Scale
-            const __m128 vScale1 = loadFloat3(k1.Transform.Scale);
-            const __m128 vScale2 = loadFloat3(k2.Transform.Scale);
-            const __m128 vScaleInt = lerp(vScale1, vScale2, interpolatedT);
+        m_skinnedBoundsUpdates[i] = BVH::BVHUpdateInput{
+            .OldBox = store(transform(vPrevW, v_AABB(m_skinnedMeshes.PrevBounds(i)))),
+            .NewBox = store(transform(vW, v_AABB(m_skinnedMeshes.Bounds(i)))),
+            .InstanceID = instanceID };
+    }
+}
 
-            // Translation
-            const __m128 vTranslate1 = loadFloat3(k1.Transform.Translation);
-            const __m128 vTranslate2 = loadFloat3(k2.Transform.Translation);
-            const __m128 vTranslateInt = lerp(vTranslate1, vTranslate2, interpolatedT);
+void SceneCore::UpdateAnimationTreePositions()
+{
+    m_instanceLock.LockShared();
 
-            // Rotation
-            const __m128 vRot1 = loadFloat4(k1.Transform.Rotation);
-            const __m128 vRot2 = loadFloat4(k2.Transform.Rotation);
-            const __m128 vRotInt = slerp(vRot1, vRot2, interpolatedT);
+    const size_t numAnimations = m_animations.NumAnimations();
+    m_animationTreePos.resize(numAnimations);
 
-            vRes.Scale = storeFloat3(vScaleInt);
-            vRes.Rotation = storeFloat4(vRotInt);
-            vRes.Translation = storeFloat3(vTranslateInt);
-        }
+    for (size_t i = 0; i < numAnimations; i++)
+        m_animationTreePos[i] = FindTreePosFromID(m_animations.InstanceID(i)).value();
 
-        animVec.push_back(AnimationUpdate{
-            .M = vRes,
-            .InstanceID = anim.InstanceID });
-    }
+    m_staleAnimationTreePos = false;
+
+    m_instanceLock.UnlockShared();
 }
 
-void SceneCore::UpdateLocalTransforms(Span<AnimationUpdate> animVec)
+void SceneCore::UpdateAnimations(float t, size_t begin, size_t end)
 {
-    for (auto& update : animVec)
+    constexpr size_t BATCH_SIZE = 64;
+    AffineTransformation transforms[BATCH_SIZE];
+
+    for (size_t i = begin; i < end; i += BATCH_SIZE)
     {
-        TreePos t = FindTreePosFromID(update.InstanceID).value();
-        m_sceneGraph[t.Level].m_localTransforms[t.Offset] = update.M;
+        const size_t n = Min(BATCH_SIZE, end - i);
+        m_animations.Sample(t, i, i + n, MutableSpan(transforms, n));
+
+        for (size_t j = 0; j < n; j++)
+        {
+            const TreePos& p = m_animationTreePos[i + j];
+            m_sceneGraph[p.Level].m_localTransforms[p.Offset] = transforms[j];
+        }
     }
 }
 
@@ -1072,14 +1795,14 @@ void SceneCore::ClearPick()
 {
     m_rendererInterface.ClearPick();
 
-    AcquireSRWLockExclusive(&m_pickLock);
+    m_pickLock.LockExclusive();
     m_pickedInstances.clear();
-    ReleaseSRWLockExclusive(&m_pickLock);
+    m_pickLock.UnlockExclusive();
 }
 
 void SceneCore::SetPickedInstance(uint64 instanceID)
 {
-    AcquireSRWLockExclusive(&m_pickLock);
+    m_pickLock.LockExclusive();
 
     if (!m_multiPick)
     {
@@ -1105,5 +1828,5 @@ void SceneCore::SetPickedInstance(uint64 instanceID)
             m_pickedInstances.push_back(instanceID);
     }
 
-    ReleaseSRWLockExclusive(&m_pickLock);
+    m_pickLock.UnlockExclusive();
 }
@@ -2,10 +2,14 @@
 
 #include "../Math/BVH.h"
 #include "Asset.h"
+#include "Animation.h"
+#include "Skinning.h"
+#include "TextureStreaming.h"
 #include "SceneRenderer.h"
 #include "SceneCommon.h"
 #include "../Utility/Utility.h"
 #include "../Utility/SynchronizedView.h"
+#include "../Support/MemoryReport.h"
 #include <xxHash/xxhash.h>
 #include <atomic>
 
@@ -18,6 +22,8 @@ namespace ZetaRay::RT
 {
     struct StaticBLAS;
     struct TLAS;
+    struct ReferencePathTracer;
+    struct TwoLevelBVH;
 }
 
 namespace ZetaRay::Support
@@ -27,20 +33,6 @@ namespace ZetaRay::Support
 
 namespace ZetaRay::Scene
 {
-    struct Keyframe
-    {
-        static Keyframe Identity()
-        {
-            Keyframe k;
-            k.Transform = Math::AffineTransformation::GetIdentity();
-
-            return k;
-        }
-
-        Math::AffineTransformation Transform;
-        float Time;
-    };
-
     struct RT_Flags
     {
         static RT_Flags Decode(uint8_t f)
@@ -99,6 +91,32 @@ namespace ZetaRay::Scene
 
         return meshFromSceneID;
     }
+
+    // ID of node nodeIdx's private copy of a mesh primitive (see Model::glTF::Asset::Mesh),
+    // or the shared one when nodeIdx is -1
+    ZetaInline uint64_t MeshID(uint32_t sceneID, int meshIdx, int meshPrimIdx, int nodeIdx)
+    {
+        if (nodeIdx == -1)
+            return MeshID(sceneID, meshIdx, meshPrimIdx);
+
+        StackStr(str, n, "mesh_%u_%d_%d_%d", sceneID, meshIdx, meshPrimIdx, nodeIdx);
+        uint64_t meshFromSceneID = XXH3_64bits(str, n);
+
+        return meshFromSceneID;
+    }
+
+    // State of a picked instance as of the last scene update (see 
+    // SceneCore::GetPickedInstanceStates())
+    struct PickedInstance
+    {
+        uint64_t ID;
+        uint64_t MeshID;
+        Math::float4x3 ToWorld;
+        // In instance's local space (see SceneCore::GetAABB())
+        Math::AABB Bounds;
+        // Accumulated transform edits, e.g. from the GUI
+        Math::AffineTransformation LocalTransform;
+    };
 }
 
 namespace ZetaRay::Scene
@@ -107,6 +125,8 @@ namespace ZetaRay::Scene
     {
         friend struct RT::StaticBLAS;
         friend struct RT::TLAS;
+        friend struct RT::ReferencePathTracer;
+        friend struct RT::TwoLevelBVH;
 
     public:
         static constexpr uint64_t ROOT_ID = UINT64_MAX;
@@ -123,6 +143,17 @@ namespace ZetaRay::Scene
         void OnWindowSizeChanged();
         void Shutdown();
 
+        // Scene update has two parts:
+        //  - Simulate() advances the scene to the given frame on the CPU (animations, world
+        //    transforms, skinning, emissive positions and light BVH) by adding tasks to ts.
+        //  - Update() applies the edits that were made since the last call (see 
+        //    TransformInstance()), uploads the simulation results, publishes the state that 
+        //    rendering reads (e.g. GetPickedInstanceStates()) and updates the renderer. The 
+        //    frame is simulated first if Simulate() wasn't called for it.
+        // As render tasks don't read the simulated state directly, Simulate() for frame N + 1 
+        // can run while frame N is being recorded. Edits made in the meantime apply in frame 
+        // N + 2.
+        void Simulate(uint64_t frame, double t, Support::TaskSet& ts);
         void Update(double dt, Support::TaskSet& sceneTS, Support::TaskSet& sceneRendererTS);
         void Render(Support::TaskSet& ts) { m_rendererInterface.Render(ts); };
 
@@ -141,32 +172,61 @@ namespace ZetaRay::Scene
         }
         ZetaInline Util::Optional<const Model::TriangleMesh*> GetInstanceMesh(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             const uint64_t meshID = m_sceneGraph[p.Level].m_meshIDs[p.Offset];
 
             return m_meshes.GetMesh(meshID);
         }
+#ifdef _WIN32
         ZetaInline const Core::GpuMemory::Buffer& GetMeshVB() { return m_meshes.GetVB(); }
         ZetaInline const Core::GpuMemory::Buffer& GetMeshIB() { return m_meshes.GetIB(); }
+#endif
+        // Keep mesh data on the CPU after upload (e.g. for RT::ReferencePathTracer or
+        // RT::TwoLevelBVH). Must be set before meshes are added.
+        ZetaInline void RetainCpuMeshData(bool b) { m_meshes.RetainCpuCopy(b); }
+        // Empty unless retained. Vertices of skinned meshes are replaced with the deformed ones.
+        ZetaInline Util::Span<Core::Vertex> GetMeshVertices() const { return m_meshes.Vertices(); }
 
         //
         // Material
         //
+        // Texture IDs of mat are only used to find the streamed textures that it references
         void AddMaterial(const Model::glTF::Asset::MaterialDesc& mat, bool lock = true);
+#ifdef _WIN32
         void AddMaterial(const Model::glTF::Asset::MaterialDesc& mat,
             Util::MutableSpan<Core::GpuMemory::Texture> ddsImages, bool lock = true);
+#endif
         ZetaInline Util::Optional<const Material*> GetMaterial(uint32_t ID, uint32_t* bufferIdx = nullptr) const
         {
             return m_matBuffer.Get(ID, bufferIdx);
         }
         void UpdateMaterial(uint32 ID, const Material& newMat);
         void ResizeAdditionalMaterials(uint32_t num);
+#ifdef _WIN32
         ZetaInline void AddTextureHeap(Core::GpuMemory::ResourceHeap&& heap) { m_textureHeaps.push_back(ZetaForward(heap)); }
 
         ZetaInline uint32_t GetBaseColMapsDescHeapOffset() const { return m_baseColorDescTable.GPUDescriptorHeapIndex(); }
         ZetaInline uint32_t GetNormalMapsDescHeapOffset() const { return m_normalDescTable.GPUDescriptorHeapIndex(); }
         ZetaInline uint32_t GetMetallicRougnessMapsDescHeapOffset() const { return m_metallicRoughnessDescTable.GPUDescriptorHeapIndex(); }
         ZetaInline uint32_t GetEmissiveMapsDescHeapOffset() const { return m_emissiveDescTable.GPUDescriptorHeapIndex(); }
+#endif
+
+        //
+        // Texture streaming
+        //
+        // Registers a block-compressed DDS texture whose mips are loaded tail-first. Reads the 
+        // mip tail -- mips [firstTailMip, desc.MipCount) -- into tail, which the caller uploads 
+        // when it creates the texture. Finer mips are then read in the background and uploaded 
+        // during scene updates. Returns false if the texture can't be streamed (e.g. not 
+        // block-compressed), in which case it should be loaded as a whole. Thread-safe.
+        bool AddStreamedTexture(const char* ddsPath, uint64_t texID, Streaming::DDSTextureDesc& desc,
+            Util::SmallVector<uint8_t>& tail, uint32_t& firstTailMip);
+        ZetaInline const Streaming::MipScheduler& GetTextureStreaming() const { return m_mipStreamer.Scheduler(); }
+        // View that the desired mip and priority of streamed textures are computed from on every
+        // update, using the screen-space footprint of the instances whose materials reference 
+        // them. Set from the camera when there's a renderer. Until a view is set, every texture 
+        // is streamed up to mip 0.
+        void SetTextureStreamingView(const Math::float3& pos, float tanHalfFovY, uint32_t screenHeight);
 
         //
         // Instance
@@ -180,44 +240,44 @@ namespace ZetaRay::Scene
 
             return {};
         }
+        // Simulated state, which isn't safe to read while Simulate() is running. Render tasks
+        // should use GetPickedInstanceStates() instead.
         ZetaInline const Math::float4x3& GetToWorld(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return m_sceneGraph[p.Level].m_toWorlds[p.Offset];
         }
-        ZetaInline Math::AffineTransformation GetLocalTransform(uint64_t id) const
-        {
-            auto it = m_worldTransformUpdates.find(id);
-            if (it)
-                return *it.value();
-
-            return Math::AffineTransformation::GetIdentity();
-        }
+        // In instance's local space. For skinned meshes, bounds as of the last deformation.
         ZetaInline const Math::AABB& GetAABB(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            if (auto skinned = m_skinnedMeshes.Find(id); skinned)
+                return m_skinnedMeshes.Bounds(skinned.value());
+
+            const TreePos p = FindTreePosFromID(id).value();
             const uint64_t meshID = m_sceneGraph[p.Level].m_meshIDs[p.Offset];
             return m_meshes.GetMesh(meshID).value()->m_AABB;
         }
         ZetaInline uint64_t GetInstanceMeshID(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return m_sceneGraph[p.Level].m_meshIDs[p.Offset];
         }
         ZetaInline RT_AS_Info GetInstanceRtASInfo(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return m_sceneGraph[p.Level].m_rtASInfo[p.Offset];
         }
         ZetaInline RT_Flags GetInstanceRtFlags(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return RT_Flags::Decode(m_sceneGraph[p.Level].m_rtFlags[p.Offset]);
         }
         ZetaInline uint64_t GetIDFromRtMeshIdx(uint32 idx) const
         {
             return m_rtMeshInstanceIdxToID[idx];
         }
+        // Applied in the next Update() -- in the frame that's being updated or, if it has 
+        // already been simulated, in the one after. Thread-safe.
         void TransformInstance(uint64_t id, const Math::float3& tr, const Math::float3x3& rotation,
             const Math::float3& scale);
         void ReserveInstances(Util::Span<int> treeLevels, size_t total);
@@ -229,8 +289,10 @@ namespace ZetaRay::Scene
             Util::SmallVector<RT::EmissiveTriangle>&& emissiveTris, bool lock);
         ZetaInline size_t NumEmissiveInstances() const { return m_emissives.NumInstances(); }
         ZetaInline size_t NumEmissiveTriangles() const { return m_emissives.NumTriangles(); }
+        ZetaInline const RT::LightBVH& EmissiveLightBVH() const { return m_emissives.LightBVH(); }
         ZetaInline bool AreEmissivePositionsStale() const { return m_staleEmissivePositions; }
         ZetaInline bool AreEmissiveMaterialsStale() const { return m_staleEmissiveMats; }
+        // Applied in the next Update(), same as TransformInstance(). Thread-safe.
         void UpdateEmissiveMaterial(uint64_t instanceID, const Math::float3& emissiveFactor, float strength);
 
         //
@@ -240,6 +302,28 @@ namespace ZetaRay::Scene
             bool loop = true, bool isSorted = true);
         void AnimateCallback(const Support::ParamVariant& p);
 
+        //
+        // Skinning & morph targets
+        //
+        void AddSkinnedMesh(const SkinnedMeshDesc& desc, bool lock = true);
+        ZetaInline size_t NumSkinnedMeshes() const { return m_skinnedMeshes.NumMeshes(); }
+        // Deformed vertices (in instance's local space) as of the last update
+        ZetaInline Util::Optional<Util::Span<Core::Vertex>> GetSkinnedVertices(uint64_t instanceID) const
+        {
+            auto idx = m_skinnedMeshes.Find(instanceID);
+            if (idx)
+                return m_skinnedMeshes.DeformedVertices(idx.value());
+
+            return {};
+        }
+        // Old and refitted world-space bounding box of each skinned mesh that was deformed in
+        // this frame (empty otherwise). Valid after scene update has finished. RT::TLAS refits
+        // the BLAS of each one.
+        ZetaInline Util::Span<Math::BVH::BVHUpdateInput> GetSkinnedMeshBoundsUpdates() const
+        {
+            return m_skinnedBoundsUpdates;
+        }
+
         //
         // Misc
         //
@@ -253,6 +337,13 @@ namespace ZetaRay::Scene
         ZetaInline Core::RenderGraph* GetRenderGraph() { return m_rendererInterface.GetRenderGraph(); }
         ZetaInline void SceneModified() { m_rendererInterface.SceneModified(); }
         ZetaInline void DebugDrawRenderGraph() { m_rendererInterface.DebugDrawRenderGraph(); }
+        // CPU memory of the scene's containers (scene graph, meshes, emissives, animations,
+        // etc.). Takes every scene lock in turn. Thread-safe.
+        void GetMemoryReport(Support::MemoryReport& report);
+        // Adds per-owner totals of GetMemoryReport() as "Scene memory" frame stats. Called
+        // by the app once per frame after all of the frame's tasks have finished, so that
+        // the scene locks are uncontended.
+        void AddMemoryStats();
 
         //
         // Picking
@@ -273,6 +364,9 @@ namespace ZetaRay::Scene
         { 
             return Util::SynchronizedSpan<uint64_t>(m_pickedInstances, m_pickLock);
         }
+        // Picked instances as of the last Update(), which is what render tasks should read. 
+        // Instances that are picked afterwards show up after the next Update().
+        ZetaInline Util::Span<PickedInstance> GetPickedInstanceStates() const { return m_pickedStates; }
         ZetaInline void CaptureScreen() { m_rendererInterface.CaptureScreen(); }
 
     private:
@@ -287,12 +381,6 @@ namespace ZetaRay::Scene
             uint32_t Offset;
         };
 
-        struct AnimationUpdate
-        {
-            Math::AffineTransformation M;
-            uint64_t InstanceID;
-        };
-
         struct Range
         {
             Range() = default;
@@ -317,16 +405,6 @@ namespace ZetaRay::Scene
             Util::SmallVector<RT_AS_Info> m_rtASInfo;
         };
 
-        // Offset into "m_keyframes" array
-        struct AnimationMetadata
-        {
-            uint64_t InstanceID;
-            uint32_t StartOffset;
-            uint32_t Length;
-            float T0;
-            bool Loop;
-        };
-
         ZetaInline Util::Optional<TreePos> FindTreePosFromID(uint64_t id) const
         {
             auto pos = m_IDtoTreePos.find(id);
@@ -343,12 +421,22 @@ namespace ZetaRay::Scene
         void InitWorldTransformations();
         void UpdateWorldTransformations(Util::Vector<Math::BVH::BVHUpdateInput, 
             App::FrameAllocator>& toUpdateInstances);
-        void UpdateEmissivePositions();
+        void GatherEmissiveUpdates();
+        void UpdateEmissivePositions(size_t workerIdx, size_t numWorkers);
         void RebuildBVH();
-        void UpdateAnimations(float t, Util::Vector<AnimationUpdate, App::FrameAllocator>& animVec);
-        void UpdateLocalTransforms(Util::Span<AnimationUpdate> animVec);
+        void UpdateAnimationTreePositions();
+        void UpdateAnimations(float t, size_t begin, size_t end);
+        void UpdateSkinnedMeshTreePositions();
+        void DeformSkinnedMeshes(float t, size_t begin, size_t end);
         bool ConvertInstanceDynamic(uint64_t instanceID, const TreePos& treePos, RT_Flags rtFlags);
         void ConvertSubtreeDynamic(uint32_t treeLevel, Range r);
+        void UpdateTextureStreaming();
+        void UpdateMipPriorities();
+        void AddMaterialStreamedTextures(const Model::glTF::Asset::MaterialDesc& matDesc);
+        // With simulated, the edits apply in the next frame
+        void ApplyPendingEdits(bool simulated);
+        void UploadSimulationResults();
+        void PublishRenderState();
 
         // Maps instance ID to tree position
         Util::HashTable<TreePos> m_IDtoTreePos;
@@ -358,6 +446,8 @@ namespace ZetaRay::Scene
         // Previous frame's world transformation
         Util::HashTable<Math::float4x3> m_prevToWorlds;
         Util::SmallVector<uint64, Support::SystemAllocator, 4> m_pickedInstances;
+        // Published in Update() (see GetPickedInstanceStates())
+        Util::SmallVector<PickedInstance, Support::SystemAllocator, 4> m_pickedStates;
         bool m_multiPick = false;
         bool m_isPaused = false;
 
@@ -383,6 +473,33 @@ namespace ZetaRay::Scene
         Util::HashTable<TransformUpdate> m_tempWorldTransformUpdates;
         Util::HashTable<Math::AffineTransformation> m_worldTransformUpdates;
 
+        // Edits that were made since the last Update(). Simulation of the next frame may be 
+        // running at the same time, so they're only applied in Update().
+        struct TransformEdit
+        {
+            uint64_t InstanceID;
+            TransformUpdate Delta;
+        };
+
+        struct EmissiveMaterialEdit
+        {
+            uint64_t InstanceID;
+            Math::float3 EmissiveFactor;
+            float Strength;
+        };
+
+        Util::SmallVector<TransformEdit> m_pendingTransformEdits;
+        Util::SmallVector<EmissiveMaterialEdit> m_pendingEmissiveEdits;
+
+        //
+        // Simulation
+        //
+        // Frame and time of the last Simulate() call
+        uint64_t m_simFrame = 0;
+        float m_simTime = 0.0f;
+        // Whether the frame that's being updated was simulated ahead of Update()
+        bool m_simulated = false;
+
         //
         // BVH
         //
@@ -394,33 +511,112 @@ namespace ZetaRay::Scene
         //
         Internal::MeshContainer m_meshes;
         Internal::MaterialBuffer m_matBuffer;
+#ifdef _WIN32
         Internal::TexSRVDescriptorTable m_baseColorDescTable;
         Internal::TexSRVDescriptorTable m_normalDescTable;
         Internal::TexSRVDescriptorTable m_metallicRoughnessDescTable;
         Internal::TexSRVDescriptorTable m_emissiveDescTable;
         Util::SmallVector<Core::GpuMemory::ResourceHeap, Support::SystemAllocator, 8> m_textureHeaps;
+#endif
+
+        //
+        // Texture streaming
+        //
+        static constexpr uint32_t MAX_NUM_MIP_LOADS_IN_FLIGHT = 16;
+        static constexpr uint64_t MIP_STREAMING_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+        Streaming::MipStreamer m_mipStreamer;
+        // Texture ID of each streamed texture (same order as m_mipStreamer)
+        Util::SmallVector<uint64_t> m_streamedTexIDs;
+        // Maps texture ID to index in m_mipStreamer
+        Util::HashTable<uint32_t> m_streamedTexIdx;
+        Util::SmallVector<Streaming::MipStreamer::CompletedLoad> m_completedMipLoads;
+
+        // Streamed textures referenced by a material, as indices in m_mipStreamer (UINT32_MAX 
+        // if unused)
+        struct MaterialStreamedTextures
+        {
+            uint32_t TexIdx[4];
+        };
+
+        // Maps material ID to its streamed textures, only for materials that have any
+        Util::HashTable<MaterialStreamedTextures> m_matStreamedTextures;
+
+        struct TextureStreamingView
+        {
+            Math::float3 Pos;
+            float TanHalfFovY;
+            uint32_t ScreenHeight;
+        };
+
+        TextureStreamingView m_streamingView;
+        bool m_hasStreamingView = false;
+#ifdef _WIN32
+        // New mips can only be sampled once their upload has finished on the GPU
+        struct PendingMinLOD
+        {
+            uint64_t Frame;
+            uint64_t TexID;
+            uint32_t Mip;
+        };
+
+        Util::SmallVector<PendingMinLOD> m_pendingMinLODs;
+#endif
 
         //
         // Emissives
         //
         Internal::EmissiveBuffer m_emissives;
         Util::SmallVector<uint64_t, App::FrameAllocator> m_toUpdateEmissives;
+
+        // Emissive instances that moved this frame, sorted by base triangle offset
+        struct EmissiveUpdate
+        {
+            uint64_t InstanceID;
+            uint32_t BaseTriOffset;
+            uint32_t NumTriangles;
+            // Sum of NumTriangles of preceding entries
+            uint32_t TriPrefixSum;
+        };
+
+        Util::SmallVector<EmissiveUpdate> m_emissiveUpdates;
+        Util::SmallVector<Internal::EmissiveBuffer::TriRange> m_emissiveDirtyRanges;
         bool m_staleEmissiveMats = false;
         bool m_staleEmissivePositions = false;
 
-        SRWLOCK m_matLock = SRWLOCK_INIT;
-        SRWLOCK m_meshLock = SRWLOCK_INIT;
-        SRWLOCK m_instanceLock = SRWLOCK_INIT;
-        SRWLOCK m_emissiveLock = SRWLOCK_INIT;
-        SRWLOCK m_pickLock = SRWLOCK_INIT;
+        Support::Mutex m_matLock{ "Scene materials" };
+        Support::Mutex m_meshLock{ "Scene meshes" };
+        Support::RWLock m_instanceLock{ "Scene instances" };
+        Support::Mutex m_emissiveLock{ "Scene emissives" };
+        Support::RWLock m_pickLock{ "Scene picking" };
+        Support::Mutex m_streamingLock{ "Scene texture streaming" };
+        Support::Mutex m_editLock{ "Scene edits" };
 
         //
         // Animation
         //
-        Util::SmallVector<AnimationMetadata> m_animationMetadata;
-        Util::SmallVector<Keyframe> m_keyframes;
+        Internal::AnimationSet m_animations;
+        // Tree position of each animated instance (same order as m_animations). Needs to be 
+        // recomputed after instances are added.
+        Util::SmallVector<TreePos> m_animationTreePos;
+        bool m_staleAnimationTreePos = false;
         bool m_animate = true;
 
+        //
+        // Skinning
+        //
+        Internal::SkinnedMeshSet m_skinnedMeshes;
+        // Tree position of each skinned mesh instance followed by its joints. Same as 
+        // above, needs to be recomputed after instances are added.
+        Util::SmallVector<TreePos> m_skinnedMeshTreePos;
+        Util::SmallVector<TreePos> m_jointTreePos;
+        Util::SmallVector<uint32_t> m_jointTreePosOffsets;
+        Util::SmallVector<Math::BVH::BVHUpdateInput> m_skinnedBoundsUpdates;
+        bool m_staleSkinnedMeshTreePos = false;
+
+        // Reused every frame by AddMemoryStats()
+        Support::MemoryReport m_memoryReport;
+
         //
         // Scene Renderer
         //
@@ -0,0 +1,280 @@
+#include "Skinning.h"
+#include "../Math/CollisionFuncs.h"
+#include "../Math/MatrixFuncs.h"
+#include "../Utility/Utility.h"
+#include "../Support/MemoryReport.h"
+
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Scene::Internal;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Core;
+
+//--------------------------------------------------------------------------------------
+// SkinnedMeshSet
+//--------------------------------------------------------------------------------------
+
+void SkinnedMeshSet::Add(const SkinnedMeshDesc& desc)
+{
+    const size_t numVertices = desc.Vertices.size();
+    const size_t numJoints = desc.JointIDs.size();
+    const size_t numTargets = desc.MorphWeights.size();
+    const size_t numKeys = desc.MorphWeightKeyTimes.size();
+
+    Check(numVertices > 0, "Invalid mesh.");
+    Check(!desc.Skin.empty() || numTargets, "Mesh has neither a skin nor morph targets.");
+    Check(desc.Skin.empty() || desc.Skin.size() == numVertices, "Invalid skin.");
+    Check(desc.Skin.empty() || numJoints, "Invalid skin.");
+    Check(desc.InverseBindMatrices.size() == numJoints, "Number of joints and inverse bind matrices must match.");
+    Check(desc.MorphPositionDeltas.size() == numTargets * numVertices, "Invalid morph targets.");
+    Check(desc.MorphNormalDeltas.empty() || desc.MorphNormalDeltas.size() == numTargets * numVertices,
+        "Invalid morph targets.");
+    Check(desc.MorphWeightKeys.size() == numKeys * numTargets, "Invalid morph weights animation.");
+    Check(!m_instanceToIdx.find(desc.InstanceID), "Instance %llu already has a skinned mesh.", desc.InstanceID);
+
+    Metadata m;
+    m.InstanceID = desc.InstanceID;
+    m.VtxOffset = (uint32_t)m_bindPose.size();
+    m.NumVertices = (uint32_t)numVertices;
+    m.JointOffset = (uint32_t)m_jointIDs.size();
+    m.NumJoints = desc.Skin.empty() ? 0 : (uint32_t)numJoints;
+    m.MorphOffset = (uint32_t)m_morphPositionDeltas.size();
+    m.NumTargets = (uint32_t)numTargets;
+    m.WeightOffset = (uint32_t)m_morphWeights.size();
+    m.KeyOffset = (uint32_t)m_morphKeyTimes.size();
+    m.NumKeys = (uint32_t)numKeys;
+    m.HasNormalDeltas = !desc.MorphNormalDeltas.empty();
+
+    v_AABB vBox = compueMeshAABB(desc.Vertices.data(), offsetof(Vertex, Position), sizeof(Vertex),
+        m.NumVertices);
+    m.Bounds = store(vBox);
+    m.PrevBounds = m.Bounds;
+
+    m_bindPose.append_range(desc.Vertices.begin(), desc.Vertices.end());
+    // Until the first update
+    m_deformed.append_range(desc.Vertices.begin(), desc.Vertices.end());
+
+    // Skin is indexed with vertex offset, so morph-only meshes need (unused) entries too
+    if (m.NumJoints)
+    {
+#ifndef NDEBUG
+        for (auto& s : desc.Skin)
+        {
+            for (int k = 0; k < MAX_NUM_JOINTS_PER_VERTEX; k++)
+                Assert(s.Joints[k] < numJoints, "Invalid joint index.");
+        }
+#endif
+        m_skin.append_range(desc.Skin.begin(), desc.Skin.end());
+
+        m_jointIDs.append_range(desc.JointIDs.begin(), desc.JointIDs.end());
+        m_inverseBinds.append_range(desc.InverseBindMatrices.begin(), desc.InverseBindMatrices.end());
+        m_jointMatrices.resize(m_jointMatrices.size() + numJoints, store(identity()));
+    }
+    else
+        m_skin.resize(m_skin.size() + numVertices);
+
+    if (numTargets)
+    {
+        m_morphPositionDeltas.append_range(desc.MorphPositionDeltas.begin(), desc.MorphPositionDeltas.end());
+
+        if (m.HasNormalDeltas)
+            m_morphNormalDeltas.append_range(desc.MorphNormalDeltas.begin(), desc.MorphNormalDeltas.end());
+        else
+            m_morphNormalDeltas.resize(m_morphNormalDeltas.size() + numTargets * numVertices, float3(0.0f));
+
+        m_morphWeights.append_range(desc.MorphWeights.begin(), desc.MorphWeights.end());
+        m_morphKeyTimes.append_range(desc.MorphWeightKeyTimes.begin(), desc.MorphWeightKeyTimes.end());
+        m_morphKeys.append_range(desc.MorphWeightKeys.begin(), desc.MorphWeightKeys.end());
+    }
+
+    m_instanceToIdx.insert_or_assign(desc.InstanceID, m_metadata.size());
+    m_metadata.push_back(m);
+}
+
+void SkinnedMeshSet::Clear()
+{
+    m_metadata.free_memory();
+    m_instanceToIdx.free_memory();
+    m_bindPose.free_memory();
+    m_deformed.free_memory();
+    m_skin.free_memory();
+    m_jointIDs.free_memory();
+    m_inverseBinds.free_memory();
+    m_jointMatrices.free_memory();
+    m_morphPositionDeltas.free_memory();
+    m_morphNormalDeltas.free_memory();
+    m_morphWeights.free_memory();
+    m_morphKeyTimes.free_memory();
+    m_morphKeys.free_memory();
+}
+
+void SkinnedMeshSet::ReportMemory(Support::MemoryReport& report) const
+{
+    report.Add("SkinnedMeshSet", "m_metadata", m_metadata);
+    report.Add("SkinnedMeshSet", "m_instanceToIdx", m_instanceToIdx);
+    report.Add("SkinnedMeshSet", "m_bindPose", m_bindPose);
+    report.Add("SkinnedMeshSet", "m_deformed", m_deformed);
+    report.Add("SkinnedMeshSet", "m_skin", m_skin);
+    report.Add("SkinnedMeshSet", "m_jointIDs", m_jointIDs);
+    report.Add("SkinnedMeshSet", "m_inverseBinds", m_inverseBinds);
+    report.Add("SkinnedMeshSet", "m_jointMatrices", m_jointMatrices);
+    report.Add("SkinnedMeshSet", "m_morphPositionDeltas", m_morphPositionDeltas);
+    report.Add("SkinnedMeshSet", "m_morphNormalDeltas", m_morphNormalDeltas);
+    report.Add("SkinnedMeshSet", "m_morphWeights", m_morphWeights);
+    report.Add("SkinnedMeshSet", "m_morphKeyTimes", m_morphKeyTimes);
+    report.Add("SkinnedMeshSet", "m_morphKeys", m_morphKeys);
+}
+
+void SkinnedMeshSet::UpdateJointMatrices(size_t mesh, const float4x3& meshToWorld,
+    Span<float4x3> jointToWorlds)
+{
+    const Metadata& m = m_metadata[mesh];
+    Assert(jointToWorlds.size() == m.NumJoints, "Invalid number of joints.");
+
+    const v_float4x4 vWorldToMesh = inverseSRT(load4x3(meshToWorld));
+
+    for (uint32_t j = 0; j < m.NumJoints; j++)
+    {
+        const v_float4x4 vInvBind = load4x4(m_inverseBinds[m.JointOffset + j]);
+        const v_float4x4 vJointToWorld = load4x3(jointToWorlds[j]);
+
+        // Row vector convention -- inverse bind matrix is applied first
+        v_float4x4 vM = mul(vInvBind, vJointToWorld);
+        vM = mul(vM, vWorldToMesh);
+
+        m_jointMatrices[m.JointOffset + j] = store(vM);
+    }
+}
+
+void SkinnedMeshSet::UpdateMorphWeights(size_t mesh, float t)
+{
+    const Metadata& m = m_metadata[mesh];
+    if (m.NumKeys == 0)
+        return;
+
+    const float* times = m_morphKeyTimes.data() + m.KeyOffset;
+    const float* keys = m_morphKeys.data() + m.KeyOffset * m.NumTargets;
+    float* weights = m_morphWeights.data() + m.WeightOffset;
+    const float tBeg = times[0];
+    const float tEnd = times[m.NumKeys - 1];
+
+    if (t >= tEnd && tEnd > tBeg)
+        t = tBeg + fmodf(t - tBeg, tEnd - tBeg);
+
+    uint32_t k = 0;
+    float u = 0.0f;
+
+    if (t > tBeg && m.NumKeys > 1)
+    {
+        const int64_t idx = FindInterval(Span(times, m.NumKeys), t, [](const float& x) { return x; });
+        k = idx == -1 ? m.NumKeys - 2 : (uint32_t)idx;
+        u = Min((t - times[k]) / (times[k + 1] - times[k]), 1.0f);
+    }
+
+    const float* w0 = keys + k * m.NumTargets;
+    const float* w1 = m.NumKeys > 1 ? w0 + m.NumTargets : w0;
+
+    for (uint32_t i = 0; i < m.NumTargets; i++)
+        weights[i] = w0[i] + u * (w1[i] - w0[i]);
+}
+
+v_AABB SkinnedMeshSet::Deform(size_t mesh, uint32_t begin, uint32_t end)
+{
+    const Metadata& m = m_metadata[mesh];
+    Assert(begin <= end && end <= m.NumVertices, "Invalid range.");
+
+    const Vertex* src = m_bindPose.data() + m.VtxOffset;
+    Vertex* dst = m_deformed.data() + m.VtxOffset;
+    const VertexSkin* skin = m_skin.data() + m.VtxOffset;
+    const float* joints = reinterpret_cast<const float*>(m_jointMatrices.data() + m.JointOffset);
+    const float* weights = m_morphWeights.data() + m.WeightOffset;
+
+    // Targets with zero weight don't contribute
+    SmallVector<uint32_t, Support::SystemAllocator, 16> activeTargets;
+    for (uint32_t t = 0; t < m.NumTargets; t++)
+    {
+        if (weights[t] != 0.0f)
+            activeTargets.push_back(t);
+    }
+
+    const __m128 vOne = _mm_set1_ps(1.0f);
+    __m128 vMin = _mm_set1_ps(FLT_MAX);
+    __m128 vMax = _mm_set1_ps(-FLT_MAX);
+
+    for (uint32_t v = begin; v < end; v++)
+    {
+        Vertex vtx = src[v];
+        __m128 vPos = loadFloat3(vtx.Position);
+        float3 n = vtx.Normal.decode();
+        float3 t = vtx.Tangent.decode();
+        __m128 vNormal = loadFloat3(n);
+        __m128 vTangent = loadFloat3(t);
+
+        // Morph targets
+        for (auto target : activeTargets)
+        {
+            const size_t idx = m.MorphOffset + target * m.NumVertices + v;
+            const __m128 vW = _mm_set1_ps(weights[target]);
+
+            vPos = _mm_fmadd_ps(vW, loadFloat3(m_morphPositionDeltas[idx]), vPos);
+            vNormal = _mm_fmadd_ps(vW, loadFloat3(m_morphNormalDeltas[idx]), vNormal);
+        }
+
+        // Linear blend skinning
+        if (m.NumJoints)
+        {
+            const VertexSkin& s = skin[v];
+
+            // Blend two rows of the joint matrices at a time
+            __m256 vRow01 = _mm256_setzero_ps();
+            __m256 vRow23 = _mm256_setzero_ps();
+
+            for (int k = 0; k < MAX_NUM_JOINTS_PER_VERTEX; k++)
+            {
+                const __m256 vW = _mm256_broadcast_ss(&s.Weights[k]);
+                const float* J = joints + s.Joints[k] * 16;
+
+                vRow01 = _mm256_fmadd_ps(vW, _mm256_loadu_ps(J), vRow01);
+                vRow23 = _mm256_fmadd_ps(vW, _mm256_loadu_ps(J + 8), vRow23);
+            }
+
+            const v_float4x4 vM(_mm256_castps256_ps128(vRow01),
+                _mm256_extractf128_ps(vRow01, 1),
+                _mm256_castps256_ps128(vRow23),
+                _mm256_extractf128_ps(vRow23, 1));
+
+            // w = 1 for points and 0 for vectors. Normals are transformed with the blended
+            // matrix rather than its inverse transpose, which is exact for rotations and
+            // uniform scaling.
+            vPos = mul(vM, _mm_insert_ps(vPos, vOne, 0x30));
+            vNormal = mul(vM, vNormal);
+            vTangent = mul(vM, vTangent);
+        }
+
+        vNormal = normalize(vNormal);
+        vTangent = normalize(vTangent);
+
+        vMin = _mm_min_ps(vMin, vPos);
+        vMax = _mm_max_ps(vMax, vPos);
+
+        Vertex& out = dst[v];
+        out.Position = storeFloat3(vPos);
+        out.TexUV = vtx.TexUV;
+        out.Normal = oct32(storeFloat3(vNormal));
+        out.Tangent = oct32(storeFloat3(vTangent));
+    }
+
+    v_AABB vBox;
+    vBox.Reset(vMin, vMax);
+
+    return vBox;
+}
+
+void SkinnedMeshSet::Deform(size_t mesh)
+{
+    Metadata& m = m_metadata[mesh];
+    const v_AABB vBox = Deform(mesh, 0, m.NumVertices);
+
+    m.PrevBounds = m.Bounds;
+    m.Bounds = store(vBox);
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../Core/Vertex.h"
+#include "../Math/CollisionTypes.h"
+#include "../Math/Matrix.h"
+#include "../Utility/HashTable.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    struct MemoryReport;
+}
+
+namespace ZetaRay::Scene
+{
+    static constexpr int MAX_NUM_JOINTS_PER_VERTEX = 4;
+
+    struct VertexSkin
+    {
+        // Indices into the skin's joints
+        uint16_t Joints[MAX_NUM_JOINTS_PER_VERTEX];
+        float Weights[MAX_NUM_JOINTS_PER_VERTEX];
+    };
+
+    struct SkinnedMeshDesc
+    {
+        uint64_t InstanceID;
+        // Bind pose
+        Util::Span<Core::Vertex> Vertices = { nullptr, 0 };
+
+        //
+        // Skin -- all empty when mesh only has morph targets
+        //
+        // One entry per vertex
+        Util::Span<VertexSkin> Skin = { nullptr, 0 };
+        // Instance ID of each joint node
+        Util::Span<uint64_t> JointIDs = { nullptr, 0 };
+        Util::Span<Math::float4x4a> InverseBindMatrices = { nullptr, 0 };
+
+        //
+        // Morph targets -- all empty when mesh only has a skin
+        //
+        // Delta of vertex v for target t is at [t * #vertices + v]. Normal deltas can be empty.
+        Util::Span<Math::float3> MorphPositionDeltas = { nullptr, 0 };
+        Util::Span<Math::float3> MorphNormalDeltas = { nullptr, 0 };
+        // One weight per target
+        Util::Span<float> MorphWeights = { nullptr, 0 };
+        // Optional (looping) animation of morph weights -- #keys times followed by
+        // #keys * #targets weights
+        Util::Span<float> MorphWeightKeyTimes = { nullptr, 0 };
+        Util::Span<float> MorphWeightKeys = { nullptr, 0 };
+    };
+}
+
+namespace ZetaRay::Scene::Internal
+{
+    // Deforms meshes on the CPU using morph targets followed by linear blend skinning. Output
+    // vertices are in the mesh instance's local space (as glTF skinning matrices already include
+    // the transformation to world space, it's reversed using the mesh instance's transformation),
+    // so that instance transformations keep working as usual. Along with the deformed vertices,
+    // bounding box of each mesh is refitted, which can be used for BVH updates and BLAS refits.
+    //
+    // Different meshes can be deformed in parallel.
+    struct SkinnedMeshSet
+    {
+        void Add(const SkinnedMeshDesc& desc);
+        void Clear();
+        void ReportMemory(Support::MemoryReport& report) const;
+
+        // Computes the skinning matrices: inverse bind matrix -> joint to world -> world to mesh
+        // instance
+        void UpdateJointMatrices(size_t mesh, const Math::float4x3& meshToWorld,
+            Util::Span<Math::float4x3> jointToWorlds);
+        // Samples the morph weights animation (if any) at time t
+        void UpdateMorphWeights(size_t mesh, float t);
+        // Deforms vertices [begin, end) of given mesh and returns their bounding box
+        Math::v_AABB Deform(size_t mesh, uint32_t begin, uint32_t end);
+        // Deforms all vertices of given mesh and updates its bounding box
+        void Deform(size_t mesh);
+
+        ZetaInline size_t NumMeshes() const { return m_metadata.size(); }
+        ZetaInline uint64_t InstanceID(size_t mesh) const { return m_metadata[mesh].InstanceID; }
+        ZetaInline uint32_t NumVertices(size_t mesh) const { return m_metadata[mesh].NumVertices; }
+        ZetaInline uint32_t NumJoints(size_t mesh) const { return m_metadata[mesh].NumJoints; }
+        ZetaInline uint64_t JointID(size_t mesh, size_t j) const
+        {
+            return m_jointIDs[m_metadata[mesh].JointOffset + j];
+        }
+        ZetaInline Util::Span<Core::Vertex> DeformedVertices(size_t mesh) const
+        {
+            const Metadata& m = m_metadata[mesh];
+            return Util::Span(m_deformed.data() + m.VtxOffset, m.NumVertices);
+        }
+        ZetaInline const Math::AABB& Bounds(size_t mesh) const { return m_metadata[mesh].Bounds; }
+        ZetaInline const Math::AABB& PrevBounds(size_t mesh) const { return m_metadata[mesh].PrevBounds; }
+        ZetaInline Util::Optional<size_t> Find(uint64_t instanceID) const
+        {
+            auto idx = m_instanceToIdx.find(instanceID);
+            if (idx)
+                return *idx.value();
+
+            return {};
+        }
+
+    private:
+        struct Metadata
+        {
+            uint64_t InstanceID;
+            uint32_t VtxOffset;
+            uint32_t NumVertices;
+            uint32_t JointOffset;
+            uint32_t NumJoints;
+            // Into morph deltas
+            uint32_t MorphOffset;
+            uint32_t NumTargets;
+            // Into morph weights
+            uint32_t WeightOffset;
+            // Into morph weight keys
+            uint32_t KeyOffset;
+            uint32_t NumKeys;
+            bool HasNormalDeltas;
+            Math::AABB Bounds;
+            Math::AABB PrevBounds;
+        };
+
+        Util::SmallVector<Metadata> m_metadata;
+        Util::HashTable<size_t> m_instanceToIdx;
+
+        Util::SmallVector<Core::Vertex> m_bindPose;
+        Util::SmallVector<Core::Vertex> m_deformed;
+        Util::SmallVector<VertexSkin> m_skin;
+
+        Util::SmallVector<uint64_t> m_jointIDs;
+        Util::SmallVector<Math::float4x4a> m_inverseBinds;
+        // Row-major, row-vector convention
+        Util::SmallVector<Math::float4x4a> m_jointMatrices;
+
+        Util::SmallVector<Math::float3> m_morphPositionDeltas;
+        Util::SmallVector<Math::float3> m_morphNormalDeltas;
+        Util::SmallVector<float> m_morphWeights;
+        Util::SmallVector<float> m_morphKeyTimes;
+        Util::SmallVector<float> m_morphKeys;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,589 @@
+#include "TextureStreaming.h"
+#include "../App/App.h"
+#include "../App/Filesystem.h"
+#include "../Core/dds.h"
+#include "../Support/Task.h"
+#include <algorithm>
+#include <thread>
+
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Scene::Streaming;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::App;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Core::Direct3DUtil;
+
+namespace
+{
+    // Returns bytes per block or zero if format isn't block compressed
+    uint16_t BlockSizeFromFormat(DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_TYPELESS:
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            return 8;
+
+        case DXGI_FORMAT_BC2_TYPELESS:
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_TYPELESS:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC5_TYPELESS:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+        case DXGI_FORMAT_BC6H_TYPELESS:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_TYPELESS:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return 16;
+
+        default:
+            return 0;
+        }
+    }
+
+    // Legacy (pre-DX10) headers
+    DXGI_FORMAT FormatFromFourCC(uint32_t fourCC)
+    {
+        if (fourCC == MAKEFOURCC('D', 'X', 'T', '1'))
+            return DXGI_FORMAT_BC1_UNORM;
+        if (fourCC == MAKEFOURCC('D', 'X', 'T', '2') || fourCC == MAKEFOURCC('D', 'X', 'T', '3'))
+            return DXGI_FORMAT_BC2_UNORM;
+        if (fourCC == MAKEFOURCC('D', 'X', 'T', '4') || fourCC == MAKEFOURCC('D', 'X', 'T', '5'))
+            return DXGI_FORMAT_BC3_UNORM;
+        if (fourCC == MAKEFOURCC('A', 'T', 'I', '1') || fourCC == MAKEFOURCC('B', 'C', '4', 'U'))
+            return DXGI_FORMAT_BC4_UNORM;
+        if (fourCC == MAKEFOURCC('B', 'C', '4', 'S'))
+            return DXGI_FORMAT_BC4_SNORM;
+        if (fourCC == MAKEFOURCC('A', 'T', 'I', '2') || fourCC == MAKEFOURCC('B', 'C', '5', 'U'))
+            return DXGI_FORMAT_BC5_UNORM;
+        if (fourCC == MAKEFOURCC('B', 'C', '5', 'S'))
+            return DXGI_FORMAT_BC5_SNORM;
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// DDSTextureDesc
+//--------------------------------------------------------------------------------------
+
+uint64_t DDSTextureDesc::MipOffset(uint32_t mip) const
+{
+    uint64_t offset = DataOffset;
+    for (uint32_t m = 0; m < mip; m++)
+        offset += MipSize(m);
+
+    return offset;
+}
+
+uint64_t DDSTextureDesc::MipSize(uint32_t mip) const
+{
+    const uint64_t numBlocksX = (MipWidth(mip) + 3) / 4;
+    const uint64_t numBlocksY = (MipHeight(mip) + 3) / 4;
+
+    return numBlocksX * numBlocksY * BlockSize;
+}
+
+bool Streaming::ParseDDSHeader(Span<uint8_t> data, DDSTextureDesc& desc)
+{
+    if (data.size() < sizeof(uint32_t) + sizeof(DDS_HEADER))
+        return false;
+
+    uint32_t magic;
+    memcpy(&magic, data.data(), sizeof(uint32_t));
+    if (magic != DDS_MAGIC)
+        return false;
+
+    DDS_HEADER header;
+    memcpy(&header, data.data() + sizeof(uint32_t), sizeof(DDS_HEADER));
+    if (header.size != sizeof(DDS_HEADER) || header.ddspf.size != sizeof(DDS_PIXELFORMAT))
+        return false;
+
+    // Volume textures and cubemaps aren't supported
+    if (header.flags & DDS_HEADER_FLAGS_VOLUME || header.caps2 & DDS_CUBEMAP)
+        return false;
+
+    uint64_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+
+    if ((header.ddspf.flags & DDS_FOURCC) && header.ddspf.fourCC == MAKEFOURCC('D', 'X', '1', '0'))
+    {
+        if (data.size() < offset + sizeof(DDS_HEADER_DXT10))
+            return false;
+
+        DDS_HEADER_DXT10 dx10Header;
+        memcpy(&dx10Header, data.data() + offset, sizeof(DDS_HEADER_DXT10));
+
+        if (dx10Header.resourceDimension != DDS_DIMENSION_TEXTURE2D || dx10Header.arraySize != 1)
+            return false;
+
+        format = dx10Header.dxgiFormat;
+        offset += sizeof(DDS_HEADER_DXT10);
+    }
+    else if (header.ddspf.flags & DDS_FOURCC)
+        format = FormatFromFourCC(header.ddspf.fourCC);
+
+    const uint16_t blockSize = BlockSizeFromFormat(format);
+    if (blockSize == 0 || header.width == 0 || header.height == 0)
+        return false;
+
+    desc.Width = header.width;
+    desc.Height = header.height;
+    desc.MipCount = (uint16_t)Max(header.mipMapCount, 1u);
+    desc.BlockSize = blockSize;
+    desc.DataOffset = offset;
+    desc.Format = format;
+
+    return desc.MipCount <= 16;
+}
+
+//--------------------------------------------------------------------------------------
+// MipScheduler
+//--------------------------------------------------------------------------------------
+
+void MipScheduler::Init(uint32_t maxLoadsInFlight, uint32_t tailMaxDim)
+{
+    Assert(maxLoadsInFlight > 0, "Invalid number of loads in flight.");
+    Assert(tailMaxDim > 0, "Invalid mip tail dimension.");
+
+    Clear();
+
+    m_maxLoadsInFlight = maxLoadsInFlight;
+    m_tailMaxDim = tailMaxDim;
+}
+
+void MipScheduler::Clear()
+{
+    m_textures.clear();
+    m_candidates.clear();
+    m_numLoading = 0;
+    m_numRenderable = 0;
+    m_numComplete = 0;
+    m_numLatencySamples = 0;
+    m_numBytesLoaded = 0;
+    m_numBytesInFlight = 0;
+    m_startTime = -1.0;
+    m_timeToRenderable = -1.0;
+    m_timeToComplete = -1.0;
+    m_totalLatency = 0.0;
+    m_maxLatency = 0.0;
+}
+
+uint32_t MipScheduler::AddTexture(const DDSTextureDesc& desc)
+{
+    Assert(m_maxLoadsInFlight > 0, "MipScheduler hasn't been initialized.");
+    Assert(desc.MipCount > 0 && desc.MipCount <= 16, "Invalid number of mips.");
+
+    uint16_t firstTailMip = 0;
+    while (firstTailMip < desc.MipCount - 1 &&
+        (desc.MipWidth(firstTailMip) > m_tailMaxDim || desc.MipHeight(firstTailMip) > m_tailMaxDim))
+    {
+        firstTailMip++;
+    }
+
+    m_textures.push_back(Texture{ .Desc = desc,
+        .Priority = 0.0f,
+        .IssueTime = 0.0,
+        .LoadSize = 0,
+        .FirstTailMip = firstTailMip,
+        .ResidentMip = desc.MipCount,
+        .DesiredMip = 0,
+        .LoadingMip = NOT_LOADING });
+
+    // Previous measurements no longer cover every texture
+    m_timeToRenderable = -1.0;
+    m_timeToComplete = -1.0;
+
+    return (uint32_t)m_textures.size() - 1;
+}
+
+void MipScheduler::SetPriority(uint32_t texIdx, uint32_t desiredMip, float priority)
+{
+    Texture& t = m_textures[texIdx];
+    const bool wasComplete = IsComplete(t);
+
+    t.DesiredMip = (uint16_t)Min(desiredMip, (uint32_t)t.FirstTailMip);
+    t.Priority = Max(priority, 0.0f);
+
+    const bool isComplete = IsComplete(t);
+    if (wasComplete != isComplete)
+        m_numComplete += isComplete ? 1 : -1;
+}
+
+MipScheduler::MipLoad MipScheduler::NextLoad(uint32_t texIdx) const
+{
+    const Texture& t = m_textures[texIdx];
+
+    // Whole tail, otherwise the next finer mip
+    const uint16_t firstMip = t.ResidentMip == t.Desc.MipCount ? t.FirstTailMip : t.ResidentMip - 1;
+    const uint16_t lastMip = t.ResidentMip == t.Desc.MipCount ? t.Desc.MipCount - 1 : firstMip;
+    const uint64_t offset = t.Desc.MipOffset(firstMip);
+
+    return MipLoad{ .Texture = texIdx,
+        .FirstMip = firstMip,
+        .LastMip = lastMip,
+        .Offset = offset,
+        .Size = t.Desc.MipOffset(lastMip + 1) - offset };
+}
+
+void MipScheduler::Schedule(double time, uint64_t budgetInBytes, SmallVector<MipLoad>& loads,
+    uint32_t maxNewLoads)
+{
+    if (m_startTime < 0.0)
+        m_startTime = time;
+
+    maxNewLoads = Min(maxNewLoads, m_maxLoadsInFlight - m_numLoading);
+    uint32_t numIssued = 0;
+    uint64_t numBytesIssued = 0;
+
+    auto sortCandidates = [this]()
+        {
+            std::sort(m_candidates.begin(), m_candidates.end(),
+                [](const Candidate& lhs, const Candidate& rhs)
+                {
+                    if (lhs.Key != rhs.Key)
+                        return lhs.Key > rhs.Key;
+                    if (lhs.NumMissing != rhs.NumMissing)
+                        return lhs.NumMissing > rhs.NumMissing;
+
+                    return lhs.Texture < rhs.Texture;
+                });
+        };
+
+    // Returns false once either limit has been reached
+    auto issue = [&, this]()
+        {
+            for (auto& c : m_candidates)
+            {
+                if (numIssued == maxNewLoads)
+                    return false;
+
+                const MipLoad load = NextLoad(c.Texture);
+
+                // At least one load per call, so that loads that are larger than the budget
+                // still make progress
+                if (numIssued > 0 && numBytesIssued + load.Size > budgetInBytes)
+                    return false;
+
+                Texture& t = m_textures[c.Texture];
+                t.LoadingMip = load.FirstMip;
+                t.LoadSize = load.Size;
+                t.IssueTime = time;
+
+                loads.push_back(load);
+                numIssued++;
+                numBytesIssued += load.Size;
+            }
+
+            return true;
+        };
+
+    // Tails go first
+    m_candidates.clear();
+
+    for (uint32_t i = 0; i < (uint32_t)m_textures.size(); i++)
+    {
+        const Texture& t = m_textures[i];
+        if (t.ResidentMip == t.Desc.MipCount && t.LoadingMip == NOT_LOADING)
+            m_candidates.push_back(Candidate{ .Key = t.Priority, .NumMissing = 0, .Texture = i });
+    }
+
+    sortCandidates();
+    if (!issue())
+    {
+        m_numLoading += numIssued;
+        m_numBytesInFlight += numBytesIssued;
+
+        return;
+    }
+
+    // Then the finer mips of textures whose tail is resident
+    m_candidates.clear();
+
+    for (uint32_t i = 0; i < (uint32_t)m_textures.size(); i++)
+    {
+        const Texture& t = m_textures[i];
+        if (t.ResidentMip == t.Desc.MipCount || IsComplete(t) || t.LoadingMip != NOT_LOADING)
+            continue;
+
+        const uint32_t numMissing = t.ResidentMip - t.DesiredMip;
+        m_candidates.push_back(Candidate{ .Key = t.Priority * numMissing,
+            .NumMissing = numMissing,
+            .Texture = i });
+    }
+
+    sortCandidates();
+    issue();
+
+    m_numLoading += numIssued;
+    m_numBytesInFlight += numBytesIssued;
+}
+
+MipScheduler::MipLoad MipScheduler::IssueTail(uint32_t texIdx, double time)
+{
+    Texture& t = m_textures[texIdx];
+    Assert(t.ResidentMip == t.Desc.MipCount && t.LoadingMip == NOT_LOADING, "Tail has already been issued.");
+
+    if (m_startTime < 0.0)
+        m_startTime = time;
+
+    const MipLoad load = NextLoad(texIdx);
+    t.LoadingMip = load.FirstMip;
+    t.LoadSize = load.Size;
+    t.IssueTime = time;
+
+    m_numLoading++;
+    m_numBytesInFlight += load.Size;
+
+    return load;
+}
+
+void MipScheduler::OnLoaded(uint32_t texIdx, double time)
+{
+    Texture& t = m_textures[texIdx];
+    Assert(t.LoadingMip != NOT_LOADING, "Texture wasn't loading.");
+
+    const bool wasRenderable = IsRenderable(texIdx);
+    const bool wasComplete = IsComplete(t);
+
+    t.ResidentMip = t.LoadingMip;
+    t.LoadingMip = NOT_LOADING;
+
+    if (!wasRenderable)
+        m_numRenderable++;
+    if (!wasComplete && IsComplete(t))
+        m_numComplete++;
+
+    m_numLoading--;
+    m_numBytesInFlight -= t.LoadSize;
+    m_numBytesLoaded += t.LoadSize;
+
+    const double latency = time - t.IssueTime;
+    m_totalLatency += latency;
+    m_maxLatency = Max(m_maxLatency, latency);
+    m_numLatencySamples++;
+
+    UpdateCompletionTimes(time);
+}
+
+void MipScheduler::OnLoadFailed(uint32_t texIdx)
+{
+    Texture& t = m_textures[texIdx];
+    Assert(t.LoadingMip != NOT_LOADING, "Texture wasn't loading.");
+
+    t.LoadingMip = NOT_LOADING;
+    m_numLoading--;
+    m_numBytesInFlight -= t.LoadSize;
+}
+
+void MipScheduler::UpdateCompletionTimes(double time)
+{
+    const uint32_t numTextures = (uint32_t)m_textures.size();
+
+    if (m_timeToRenderable < 0.0 && m_numRenderable == numTextures)
+        m_timeToRenderable = time - m_startTime;
+
+    if (m_timeToComplete < 0.0 && m_numComplete == numTextures)
+        m_timeToComplete = time - m_startTime;
+}
+
+MipScheduler::Stats MipScheduler::GetStats() const
+{
+    return Stats{ .NumTextures = (uint32_t)m_textures.size(),
+        .NumRenderable = m_numRenderable,
+        .NumComplete = m_numComplete,
+        .NumLoading = m_numLoading,
+        .NumBytesLoaded = m_numBytesLoaded,
+        .NumBytesInFlight = m_numBytesInFlight,
+        .TimeToRenderable = m_timeToRenderable,
+        .TimeToComplete = m_timeToComplete,
+        .AvgLoadLatency = m_numLatencySamples ? m_totalLatency / m_numLatencySamples : 0.0,
+        .MaxLoadLatency = m_maxLatency };
+}
+
+uint32_t MipScheduler::DesiredMipFromFootprint(const DDSTextureDesc& desc, float areaInPixels)
+{
+    if (areaInPixels < 1.0f)
+        return desc.MipCount - 1;
+
+    // Every mip has a quarter of the texels of the previous one
+    const float numTexels = (float)desc.Width * (float)desc.Height;
+    const float mip = 0.5f * log2f(numTexels / areaInPixels);
+
+    return Min((uint32_t)Max(mip, 0.0f), desc.MipCount - 1u);
+}
+
+float MipScheduler::ScreenFootprint(float radius, float distance, float tanHalfFovY, uint32_t screenHeight)
+{
+    // Camera is inside the sphere
+    distance = Max(distance, radius);
+    const float radiusInPixels = radius / (distance * tanHalfFovY) * 0.5f * screenHeight;
+
+    return PI * radiusInPixels * radiusInPixels;
+}
+
+//--------------------------------------------------------------------------------------
+// MipStreamer
+//--------------------------------------------------------------------------------------
+
+MipStreamer::~MipStreamer()
+{
+    Shutdown();
+}
+
+void MipStreamer::Init(uint32_t maxLoadsInFlight, uint64_t bytesPerFrame, uint32_t tailMaxDim)
+{
+    Assert(bytesPerFrame > 0, "Invalid budget.");
+
+    m_scheduler.Init(maxLoadsInFlight, tailMaxDim);
+    m_bytesPerFrame = bytesPerFrame;
+
+    m_stagingBuffers.resize(maxLoadsInFlight);
+    m_freeBuffers.resize(maxLoadsInFlight);
+    for (uint32_t i = 0; i < maxLoadsInFlight; i++)
+        m_freeBuffers[i] = maxLoadsInFlight - 1 - i;
+}
+
+void MipStreamer::Shutdown()
+{
+    // Background tasks reference the staging buffers
+    while (m_numPending.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+
+    for (auto f : m_files)
+        Filesystem::CloseFile(f);
+
+    CompletedLoad c;
+    while (m_completed.try_dequeue(c));
+
+    m_files.free_memory();
+    m_stagingBuffers.free_memory();
+    m_freeBuffers.free_memory();
+    m_loads.free_memory();
+    m_scheduler.Clear();
+}
+
+bool MipStreamer::AddTexture(const char* ddsPath, DDSTextureDesc& desc, uint32_t& texIdx)
+{
+    void* file = Filesystem::OpenFileForRead(ddsPath);
+    if (!file)
+        return false;
+
+    constexpr size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(Core::Direct3DUtil::DDS_HEADER) +
+        sizeof(Core::Direct3DUtil::DDS_HEADER_DXT10);
+    uint8_t header[MAX_HEADER_SIZE];
+    const size_t fileSize = Filesystem::GetFileSize(ddsPath);
+    const size_t headerSize = Min(fileSize, MAX_HEADER_SIZE);
+
+    if (!Filesystem::ReadFromFile(file, 0, MutableSpan(header, headerSize)) ||
+        !ParseDDSHeader(Span<uint8_t>(header, headerSize), desc) ||
+        desc.MipOffset(desc.MipCount) > fileSize)
+    {
+        Filesystem::CloseFile(file);
+        return false;
+    }
+
+    texIdx = m_scheduler.AddTexture(desc);
+    m_files.push_back(file);
+
+    return true;
+}
+
+void MipStreamer::OnTailLoaded(uint32_t texIdx, double time, bool success)
+{
+    if (!success)
+    {
+        m_scheduler.OnLoadFailed(texIdx);
+        return;
+    }
+
+    const DDSTextureDesc& desc = m_scheduler.GetDesc(texIdx);
+    const uint64_t tailSize = desc.MipOffset(desc.MipCount) - desc.MipOffset(m_scheduler.FirstTailMip(texIdx));
+    m_numBytesRead.fetch_add(tailSize, std::memory_order_relaxed);
+
+    m_scheduler.OnLoaded(texIdx, time);
+}
+
+void MipStreamer::Update(double time, SmallVector<CompletedLoad>& completed)
+{
+    CompletedLoad done[32];
+    size_t n;
+
+    while ((n = m_completed.try_dequeue_bulk(done, ZetaArrayLen(done))) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (done[i].Success)
+            {
+                m_scheduler.OnLoaded(done[i].Load.Texture, time);
+                completed.push_back(done[i]);
+            }
+            else
+            {
+                m_scheduler.OnLoadFailed(done[i].Load.Texture);
+                Release(done[i].StagingBuffer);
+            }
+        }
+    }
+
+    // Staging buffers that are still held by the caller limit the number of new loads
+    m_loads.clear();
+    m_scheduler.Schedule(time, m_bytesPerFrame, m_loads, (uint32_t)m_freeBuffers.size());
+
+    for (auto& load : m_loads)
+    {
+        const uint32_t buffer = m_freeBuffers.back();
+        m_freeBuffers.pop_back();
+
+        m_stagingBuffers[buffer].Load = load;
+        m_stagingBuffers[buffer].File = m_files[load.Texture];
+        m_numPending.fetch_add(1, std::memory_order_relaxed);
+
+        Task t("MipStreamer::Load", TASK_PRIORITY::BACKGROUND, [this, buffer]()
+            {
+                StagingBuffer& sb = m_stagingBuffers[buffer];
+                const bool success = ReadMips(sb.File, sb.Load, sb.Data);
+                if (success)
+                    m_numBytesRead.fetch_add(sb.Load.Size, std::memory_order_relaxed);
+
+                m_completed.enqueue(CompletedLoad{ .Load = sb.Load,
+                    .StagingBuffer = buffer,
+                    .Success = success });
+
+                m_numPending.fetch_sub(1, std::memory_order_release);
+            });
+
+        App::SubmitBackground(ZetaMove(t));
+    }
+}
+
+Span<uint8_t> MipStreamer::MipData(const CompletedLoad& c, uint32_t mip) const
+{
+    Assert(mip >= c.Load.FirstMip && mip <= c.Load.LastMip, "Mip wasn't part of this load.");
+    const DDSTextureDesc& desc = m_scheduler.GetDesc(c.Load.Texture);
+    const uint64_t offset = desc.MipOffset(mip) - c.Load.Offset;
+
+    return Span<uint8_t>(m_stagingBuffers[c.StagingBuffer].Data.data() + offset, desc.MipSize(mip));
+}
+
+void MipStreamer::Release(uint32_t buffer)
+{
+    Assert(buffer < m_stagingBuffers.size(), "Invalid staging buffer.");
+    m_freeBuffers.push_back(buffer);
+}
+
+bool MipStreamer::ReadMips(void* file, const MipScheduler::MipLoad& load, SmallVector<uint8_t>& dst)
+{
+    dst.resize(load.Size);
+    return Filesystem::ReadFromFile(file, load.Offset, dst);
+}
\ No newline at end of file
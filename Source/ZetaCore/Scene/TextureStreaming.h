@@ -0,0 +1,237 @@
+#pragma once
+
+#include "../Utility/Span.h"
+#include "../Utility/SmallVector.h"
+#include "../Math/Common.h"
+#include "concurrentqueue/concurrentqueue.h"
+
+namespace ZetaRay::Scene::Streaming
+{
+    //--------------------------------------------------------------------------------------
+    // DDSTextureDesc: Layout of a block-compressed 2D texture as stored in a DDS file
+    //--------------------------------------------------------------------------------------
+
+    struct DDSTextureDesc
+    {
+        uint32_t Width;
+        uint32_t Height;
+        uint16_t MipCount;
+        // Bytes per 4x4 block
+        uint16_t BlockSize;
+        // Offset of mip 0 from the start of the file
+        uint64_t DataOffset;
+        // DXGI_FORMAT
+        uint32_t Format = 0;
+
+        ZetaInline uint32_t MipWidth(uint32_t mip) const { return Math::Max(Width >> mip, 1u); }
+        ZetaInline uint32_t MipHeight(uint32_t mip) const { return Math::Max(Height >> mip, 1u); }
+        // Offset of given mip from the start of the file
+        uint64_t MipOffset(uint32_t mip) const;
+        // Size of given mip in the file
+        uint64_t MipSize(uint32_t mip) const;
+    };
+
+    // Parses the DDS header. Only block-compressed 2D textures (no arrays or cubemaps) are supported.
+    bool ParseDDSHeader(Util::Span<uint8_t> header, DDSTextureDesc& desc);
+
+    //--------------------------------------------------------------------------------------
+    // MipScheduler: Decides the order in which the mips of a set of (non-tiled) textures are
+    // loaded. Works purely on the CPU and doesn't do any I/O:
+    //
+    //  - Mips whose dimensions are both at most tailMaxDim form the "tail" of a texture and
+    //    are loaded together before anything else, so that every texture can be sampled
+    //    as soon as possible. The tail is a small fraction of the whole texture.
+    //  - After that, finer mips are loaded one at a time (coarse to fine) until the desired
+    //    mip of each texture is reached. Candidates are ordered by priority (e.g. screen-space
+    //    footprint) times the number of missing mips, so that textures that are both large
+    //    on screen and far from the desired resolution go first.
+    //  - Every call to Schedule() issues loads until the given byte budget is exhausted (at
+    //    least one load is always issued) or the maximum number of loads are in flight.
+    //
+    // Mips are never dropped once loaded. Times are in seconds and are only used for the
+    // load-time metrics, e.g. App::GetTimer().GetTotalTime().
+    //--------------------------------------------------------------------------------------
+
+    struct MipScheduler
+    {
+        struct MipLoad
+        {
+            uint32_t Texture;
+            // Mips [FirstMip, LastMip] are contiguous in the file
+            uint16_t FirstMip;
+            uint16_t LastMip;
+            uint64_t Offset;
+            uint64_t Size;
+        };
+
+        struct Stats
+        {
+            uint32_t NumTextures;
+            // Textures whose tail is resident
+            uint32_t NumRenderable;
+            // Textures that have reached their desired mip
+            uint32_t NumComplete;
+            uint32_t NumLoading;
+            uint64_t NumBytesLoaded;
+            uint64_t NumBytesInFlight;
+            // Time from the first call to Schedule() until every tail was resident, negative
+            // if that hasn't happened yet
+            double TimeToRenderable;
+            // Same, but until every texture reached its desired mip
+            double TimeToComplete;
+            double AvgLoadLatency;
+            double MaxLoadLatency;
+        };
+
+        MipScheduler() = default;
+        ~MipScheduler() = default;
+
+        MipScheduler(const MipScheduler&) = delete;
+        MipScheduler& operator=(const MipScheduler&) = delete;
+
+        void Init(uint32_t maxLoadsInFlight, uint32_t tailMaxDim = 128);
+        void Clear();
+        // Desired mip starts out as mip 0 with zero priority
+        uint32_t AddTexture(const DDSTextureDesc& desc);
+        void SetPriority(uint32_t texIdx, uint32_t desiredMip, float priority);
+        // Appends at most maxNewLoads loads
+        void Schedule(double time, uint64_t budgetInBytes, Util::SmallVector<MipLoad>& loads,
+            uint32_t maxNewLoads = UINT32_MAX);
+        // Issues the load of the tail outside of Schedule(), e.g. for reading it synchronously
+        // when the texture is created. Must be followed by OnLoaded() or OnLoadFailed().
+        MipLoad IssueTail(uint32_t texIdx, double time);
+        void OnLoaded(uint32_t texIdx, double time);
+        // Load is retried in a later Schedule()
+        void OnLoadFailed(uint32_t texIdx);
+
+        // Finest resident mip, MipCount if nothing is resident yet
+        ZetaInline uint32_t ResidentMip(uint32_t texIdx) const { return m_textures[texIdx].ResidentMip; }
+        ZetaInline bool IsRenderable(uint32_t texIdx) const
+        {
+            return m_textures[texIdx].ResidentMip <= m_textures[texIdx].FirstTailMip;
+        }
+        ZetaInline uint32_t FirstTailMip(uint32_t texIdx) const { return m_textures[texIdx].FirstTailMip; }
+        ZetaInline const DDSTextureDesc& GetDesc(uint32_t texIdx) const { return m_textures[texIdx].Desc; }
+        ZetaInline uint32_t NumTextures() const { return (uint32_t)m_textures.size(); }
+        Stats GetStats() const;
+
+        // Mip that roughly gives one texel per pixel for given screen-space footprint
+        static uint32_t DesiredMipFromFootprint(const DDSTextureDesc& desc, float areaInPixels);
+        // Approximate screen-space area of a sphere with given radius at given distance
+        static float ScreenFootprint(float radius, float distance, float tanHalfFovY, uint32_t screenHeight);
+
+    private:
+        static constexpr uint16_t NOT_LOADING = UINT16_MAX;
+
+        struct Texture
+        {
+            DDSTextureDesc Desc;
+            float Priority;
+            double IssueTime;
+            uint64_t LoadSize;
+            uint16_t FirstTailMip;
+            uint16_t ResidentMip;
+            uint16_t DesiredMip;
+            // First mip of the load that's in flight
+            uint16_t LoadingMip;
+        };
+
+        struct Candidate
+        {
+            float Key;
+            uint32_t NumMissing;
+            uint32_t Texture;
+        };
+
+        ZetaInline static bool IsComplete(const Texture& t) { return t.ResidentMip <= t.DesiredMip; }
+        MipLoad NextLoad(uint32_t texIdx) const;
+        void UpdateCompletionTimes(double time);
+
+        Util::SmallVector<Texture> m_textures;
+        Util::SmallVector<Candidate> m_candidates;
+        uint32_t m_maxLoadsInFlight = 0;
+        uint32_t m_tailMaxDim = 0;
+        uint32_t m_numLoading = 0;
+        uint32_t m_numRenderable = 0;
+        uint32_t m_numComplete = 0;
+        uint32_t m_numLatencySamples = 0;
+        uint64_t m_numBytesLoaded = 0;
+        uint64_t m_numBytesInFlight = 0;
+        double m_startTime = -1.0;
+        double m_timeToRenderable = -1.0;
+        double m_timeToComplete = -1.0;
+        double m_totalLatency = 0.0;
+        double m_maxLatency = 0.0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // MipStreamer: Reads the loads issued by a MipScheduler from DDS files using background
+    // tasks (TASK_PRIORITY::BACKGROUND), with a budget of bytes issued per frame. Every load
+    // is read into its own staging buffer, which has to be returned by Release() once it's
+    // been uploaded (e.g. with a larger MinLOD clamp for the SRV until the texture is
+    // complete).
+    //
+    // Everything except the background tasks is meant to be called from one thread.
+    //--------------------------------------------------------------------------------------
+
+    struct MipStreamer
+    {
+        struct CompletedLoad
+        {
+            MipScheduler::MipLoad Load;
+            uint32_t StagingBuffer;
+            bool Success;
+        };
+
+        MipStreamer() = default;
+        ~MipStreamer();
+
+        MipStreamer(const MipStreamer&) = delete;
+        MipStreamer& operator=(const MipStreamer&) = delete;
+
+        void Init(uint32_t maxLoadsInFlight, uint64_t bytesPerFrame, uint32_t tailMaxDim = 128);
+        // Waits for the loads in flight to finish
+        void Shutdown();
+        bool AddTexture(const char* ddsPath, DDSTextureDesc& desc, uint32_t& texIdx);
+        // For reading the tail synchronously with ReadMips() (see MipScheduler::IssueTail())
+        ZetaInline MipScheduler::MipLoad IssueTail(uint32_t texIdx, double time)
+        {
+            return m_scheduler.IssueTail(texIdx, time);
+        }
+        void OnTailLoaded(uint32_t texIdx, double time, bool success);
+        ZetaInline void* File(uint32_t texIdx) const { return m_files[texIdx]; }
+        ZetaInline void SetPriority(uint32_t texIdx, uint32_t desiredMip, float priority)
+        {
+            m_scheduler.SetPriority(texIdx, desiredMip, priority);
+        }
+        // Appends the loads that have finished since the last call, then issues new ones
+        void Update(double time, Util::SmallVector<CompletedLoad>& completed);
+        // Data of given mip from a completed load
+        Util::Span<uint8_t> MipData(const CompletedLoad& c, uint32_t mip) const;
+        void Release(uint32_t buffer);
+
+        ZetaInline const MipScheduler& Scheduler() const { return m_scheduler; }
+        ZetaInline uint64_t NumBytesRead() const { return m_numBytesRead.load(std::memory_order_relaxed); }
+
+        // Reads the file range of given load into dst. Returns false on failure.
+        static bool ReadMips(void* file, const MipScheduler::MipLoad& load, Util::SmallVector<uint8_t>& dst);
+
+    private:
+        struct StagingBuffer
+        {
+            Util::SmallVector<uint8_t> Data;
+            MipScheduler::MipLoad Load;
+            void* File;
+        };
+
+        MipScheduler m_scheduler;
+        Util::SmallVector<MipScheduler::MipLoad> m_loads;
+        Util::SmallVector<void*> m_files;
+        Util::SmallVector<StagingBuffer> m_stagingBuffers;
+        Util::SmallVector<uint32_t> m_freeBuffers;
+        moodycamel::ConcurrentQueue<CompletedLoad> m_completed;
+        uint64_t m_bytesPerFrame = 0;
+        std::atomic_uint32_t m_numPending = 0;
+        std::atomic_uint64_t m_numBytesRead = 0;
+    };
+}
\ No newline at end of file
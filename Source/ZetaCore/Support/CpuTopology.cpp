@@ -0,0 +1,191 @@
+#include "CpuTopology.h"
+#include <algorithm>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+//--------------------------------------------------------------------------------------
+// CpuTopology
+//--------------------------------------------------------------------------------------
+
+void CpuTopology::Build(Span<LogicalProcessor> processors)
+{
+    m_processors.clear();
+    m_cores.clear();
+    m_numNodes = 0;
+
+    // Dense node indices, in ascending order of OS node IDs
+    for (auto& p : processors)
+    {
+        bool found = false;
+
+        for (int n = 0; n < m_numNodes; n++)
+        {
+            if (m_osNodeIDs[n] == p.Node)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found && m_numNodes < MAX_NUM_NODES)
+            m_osNodeIDs[m_numNodes++] = p.Node;
+    }
+
+    std::sort(m_osNodeIDs, m_osNodeIDs + m_numNodes);
+
+    for (auto& p : processors)
+    {
+        for (auto& q : m_processors)
+            Assert(q.ID != p.ID, "Duplicate logical processor %d.", p.ID);
+
+        LogicalProcessor lp = p;
+        lp.Node = m_numNodes - 1;
+
+        for (int n = 0; n < m_numNodes; n++)
+        {
+            if (m_osNodeIDs[n] == p.Node)
+            {
+                lp.Node = n;
+                break;
+            }
+        }
+
+        m_processors.push_back(lp);
+    }
+
+    std::sort(m_processors.begin(), m_processors.end(),
+        [](const LogicalProcessor& a, const LogicalProcessor& b)
+        {
+            if (a.Node != b.Node)
+                return a.Node < b.Node;
+            if (a.EfficiencyClass != b.EfficiencyClass)
+                return a.EfficiencyClass > b.EfficiencyClass;
+            if (a.Package != b.Package)
+                return a.Package < b.Package;
+            if (a.Core != b.Core)
+                return a.Core < b.Core;
+
+            return a.ID < b.ID;
+        });
+
+    for (int i = 0; i < (int)m_processors.size(); i++)
+    {
+        const LogicalProcessor& p = m_processors[i];
+
+        if (!m_cores.empty())
+        {
+            const LogicalProcessor& prev = m_processors[i - 1];
+
+            if (prev.Package == p.Package && prev.Core == p.Core && prev.Node == p.Node)
+            {
+                m_cores.back().Count++;
+                continue;
+            }
+        }
+
+        m_cores.push_back(Core{ .Node = p.Node, .EfficiencyClass = p.EfficiencyClass, .First = i, .Count = 1 });
+    }
+}
+
+int CpuTopology::NodeOf(int id) const
+{
+    for (auto& p : m_processors)
+    {
+        if (p.ID == id)
+            return p.Node;
+    }
+
+    return 0;
+}
+
+void CpuTopology::CoreOrder(THREAD_PINNING policy, SmallVector<int, SystemAllocator, 64>& order) const
+{
+    order.clear();
+
+    if (policy == THREAD_PINNING::COMPACT)
+    {
+        for (int c = 0; c < (int)m_cores.size(); c++)
+            order.push_back(c);
+
+        // Slower cores of every node come after the faster cores of all the nodes
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+            {
+                return m_cores[a].EfficiencyClass > m_cores[b].EfficiencyClass;
+            });
+
+        return;
+    }
+
+    // Cores are sorted by node, so the k-th core of each node is found by skipping
+    // over the cores of the previous nodes
+    int nodeBegin[MAX_NUM_NODES + 1] = { 0 };
+
+    for (auto& c : m_cores)
+        nodeBegin[c.Node + 1]++;
+
+    for (int n = 0; n < m_numNodes; n++)
+        nodeBegin[n + 1] += nodeBegin[n];
+
+    for (int k = 0; (int)order.size() < (int)m_cores.size(); k++)
+    {
+        for (int n = 0; n < m_numNodes; n++)
+        {
+            if (nodeBegin[n] + k < nodeBegin[n + 1])
+                order.push_back(nodeBegin[n] + k);
+        }
+    }
+}
+
+void CpuTopology::AssignThreads(THREAD_PINNING policy, int numWorkers, int numBackground,
+    MutableSpan<int> cpus) const
+{
+    Assert(cpus.size() == (size_t)(numWorkers + numBackground), "Invalid output size.");
+
+    for (auto& c : cpus)
+        c = UNPINNED;
+
+    if (policy == THREAD_PINNING::NONE || m_processors.empty())
+        return;
+
+    SmallVector<int, SystemAllocator, 64> order;
+    CoreOrder(policy, order);
+
+    // Every logical processor in the order it's handed out: primaries of each core,
+    // then their first SMT siblings, and so on
+    SmallVector<int, SystemAllocator, 64> slots;
+    int numPrimaries = 0;
+
+    for (int level = 0; (int)slots.size() < (int)m_processors.size(); level++)
+    {
+        for (int c : order)
+        {
+            if (level < m_cores[c].Count)
+                slots.push_back(m_processors[m_cores[c].First + level].ID);
+        }
+
+        if (level == 0)
+            numPrimaries = (int)slots.size();
+    }
+
+    const int numSlots = (int)slots.size();
+
+    // Past the number of logical processors, workers share them
+    for (int i = 0; i < numWorkers; i++)
+        cpus[i] = slots[i % numSlots];
+
+    if (numWorkers >= numSlots)
+        return;
+
+    // Unused SMT siblings first, then unused physical cores
+    SmallVector<int, SystemAllocator, 64> unused;
+
+    for (int i = Math::Max(numWorkers, numPrimaries); i < numSlots; i++)
+        unused.push_back(slots[i]);
+
+    for (int i = numWorkers; i < numPrimaries; i++)
+        unused.push_back(slots[i]);
+
+    for (int i = 0; i < numBackground; i++)
+        cpus[numWorkers + i] = unused[i % unused.size()];
+}
\ No newline at end of file
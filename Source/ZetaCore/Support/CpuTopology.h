@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Memory.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    enum class THREAD_PINNING : uint8_t
+    {
+        // Threads are left to the OS scheduler
+        NONE,
+        // Workers fill up the physical cores of one NUMA node before moving on to the next,
+        // which keeps tasks that share data on the same node. Slower cores (e.g. efficiency
+        // cores of hybrid CPUs) are only used once all the faster ones are taken.
+        COMPACT,
+        // Workers alternate between NUMA nodes, which maximizes the available memory
+        // bandwidth at low thread counts
+        SPREAD
+    };
+
+    struct LogicalProcessor
+    {
+        // Logical processor index as used by the OS affinity APIs. On Windows, it's
+        // (processor group * 64 + index in group).
+        int ID;
+        int Package;
+        // Logical processors with the same (Package, Core) pair are SMT siblings
+        int Core;
+        // NUMA node as reported by the OS
+        int Node;
+        // Higher is faster, e.g. performance cores of hybrid CPUs have a higher class than
+        // efficiency cores. Zero when all the cores are the same.
+        int EfficiencyClass = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // CpuTopology: Physical cores, SMT siblings and NUMA nodes of the logical processors
+    // that are available to this process, and the assignment of threads to them.
+    //
+    //  - Workers (including the main thread) get one physical core each, the fastest ones
+    //    (highest efficiency class) first. Only once every core is taken are SMT siblings
+    //    used.
+    //  - Background threads go on the SMT siblings that workers didn't take, so that they
+    //    don't compete with workers for execution units. Without free siblings, they're
+    //    left to the scheduler.
+    //  - NUMA nodes are renumbered densely as [0, NumNodes()).
+    //--------------------------------------------------------------------------------------
+
+    struct CpuTopology
+    {
+        static constexpr int MAX_NUM_NODES = 8;
+        static constexpr int UNPINNED = -1;
+
+        CpuTopology() = default;
+        ~CpuTopology() = default;
+
+        CpuTopology(CpuTopology&&) = delete;
+        CpuTopology& operator=(CpuTopology&&) = delete;
+
+        // Duplicate IDs aren't allowed. Nodes past MAX_NUM_NODES are merged into the last one.
+        void Build(Util::Span<LogicalProcessor> processors);
+
+        ZetaInline int NumLogicalProcessors() const { return (int)m_processors.size(); }
+        ZetaInline int NumPhysicalCores() const { return (int)m_cores.size(); }
+        ZetaInline int NumNodes() const { return m_numNodes; }
+        // OS node ID of the given dense node index
+        ZetaInline int OsNodeID(int node) const { return m_osNodeIDs[node]; }
+
+        // Dense node index of the logical processor with the given ID, zero if there's no
+        // such processor
+        int NodeOf(int id) const;
+
+        // Logical processor ID for each thread, or UNPINNED. Threads are ordered as
+        // [workers (main thread first), background threads], i.e. the same order as
+        // App::GetAllThreadIDs(). Size of cpus must be numWorkers + numBackground.
+        void AssignThreads(THREAD_PINNING policy, int numWorkers, int numBackground,
+            Util::MutableSpan<int> cpus) const;
+
+    private:
+        struct Core
+        {
+            int Node;
+            int EfficiencyClass;
+            // Indices into m_processors, first one is the primary
+            int First;
+            int Count;
+        };
+
+        void CoreOrder(THREAD_PINNING policy, Util::SmallVector<int, SystemAllocator, 64>& order) const;
+
+        // Sorted by (node, efficiency class descending, package, core), so that SMT siblings
+        // are adjacent and the fastest cores of each node come first
+        Util::SmallVector<LogicalProcessor, SystemAllocator, 64> m_processors;
+        Util::SmallVector<Core, SystemAllocator, 64> m_cores;
+        int m_osNodeIDs[MAX_NUM_NODES] = { 0 };
+        int m_numNodes = 0;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "DescriptorAllocator.h"
+#include "../Utility/Error.h"
+
+using namespace ZetaRay::Support;
+
+//--------------------------------------------------------------------------------------
+// DescriptorAllocator
+//--------------------------------------------------------------------------------------
+
+void DescriptorAllocator::Init(uint32_t numEntries, uint32_t maxNumAllocs)
+{
+    Assert(numEntries > 0, "Invalid size.");
+
+    m_size = numEntries;
+    m_allocator.Init(numEntries, Math::Min(maxNumAllocs, numEntries));
+    m_pending.clear();
+    m_pendingHead = 0;
+    m_numPending = 0;
+
+    for (int i = 0; i < MAX_NUM_THREAD_CACHES; i++)
+    {
+        for (int bin = 0; bin < NUM_CACHED_BINS; bin++)
+            m_threadCaches[i].Size[bin] = 0;
+
+        m_threadCaches[i].NumCached.store(0, std::memory_order_relaxed);
+    }
+}
+
+void DescriptorAllocator::RefillThreadCache(ThreadCache& cache, int bin)
+{
+    const uint32_t binSize = 1u << bin;
+    int n = 0;
+
+    m_lock.Lock();
+
+    for (; n < REFILL_BATCH_SIZE; n++)
+    {
+        auto a = m_allocator.Allocate(binSize);
+        if (a.IsEmpty())
+            break;
+
+        cache.Entries[bin][cache.Size[bin]++] = a;
+    }
+
+    m_lock.Unlock();
+
+    cache.NumCached.fetch_add(n * binSize, std::memory_order_relaxed);
+}
+
+DescriptorAllocator::Allocation DescriptorAllocator::Allocate(uint32_t count, int threadIdx)
+{
+    Assert(count > 0 && count <= m_size, "Invalid allocation count.");
+    Assert(threadIdx < MAX_NUM_THREAD_CACHES, "Invalid thread index.");
+
+    // Fast path -- pop from this thread's cache
+    if (threadIdx >= 0 && count <= MAX_CACHED_SIZE)
+    {
+        const int bin = BinIndex(count);
+        ThreadCache& cache = m_threadCaches[threadIdx];
+
+        if (cache.Size[bin] == 0)
+            RefillThreadCache(cache, bin);
+
+        if (cache.Size[bin] > 0)
+        {
+            const auto a = cache.Entries[bin][--cache.Size[bin]];
+            cache.NumCached.fetch_sub(1u << bin, std::memory_order_relaxed);
+
+            return Allocation{ .Offset = a.Offset,
+                .Count = a.Size,
+                .Internal = a.Internal };
+        }
+
+        // Backing allocator is out of space, fall back to the slow path (which may
+        // still succeed after other thread caches are flushed)
+    }
+
+    // Sizes that fall in one of the cached bins are always rounded up, so that the reserved count
+    // can be recovered from the requested count (see ReservedCount())
+    count = ReservedCount(count);
+
+    m_lock.Lock();
+    auto a = m_allocator.Allocate(count);
+
+    if (a.IsEmpty())
+    {
+        // Take back the entries that are held by the thread caches and try again. Other threads
+        // may be concurrently popping from their caches, so only the calling thread's cache is safe
+        // to flush here.
+        if (threadIdx >= 0)
+        {
+            ThreadCache& cache = m_threadCaches[threadIdx];
+            uint32_t numFreed = 0;
+
+            for (int bin = 0; bin < NUM_CACHED_BINS; bin++)
+            {
+                for (int i = 0; i < cache.Size[bin]; i++)
+                    m_allocator.Free(cache.Entries[bin][i]);
+
+                numFreed += cache.Size[bin] << bin;
+                cache.Size[bin] = 0;
+            }
+
+            cache.NumCached.fetch_sub(numFreed, std::memory_order_relaxed);
+            a = m_allocator.Allocate(count);
+        }
+    }
+
+    m_lock.Unlock();
+
+    if (a.IsEmpty())
+        return Allocation::Empty();
+
+    return Allocation{ .Offset = a.Offset,
+        .Count = a.Size,
+        .Internal = a.Internal };
+}
+
+void DescriptorAllocator::Release(const Allocation& alloc, uint64_t releaseFence)
+{
+    Assert(!alloc.IsEmpty(), "Invalid allocation.");
+
+    m_lock.Lock();
+
+    // Callers racing with fence increments may arrive slightly out of order. Clamping to
+    // the last fence value keeps the queue sorted while only (conservatively) delaying
+    // this release.
+    if (m_pending.size() > m_pendingHead)
+        releaseFence = Math::Max(releaseFence, m_pending.back().ReleaseFence);
+
+    m_pending.push_back(PendingRelease{
+        .Alloc = OffsetAllocator::Allocation{ .Size = alloc.Count,
+            .Offset = alloc.Offset,
+            .Internal = alloc.Internal },
+        .ReleaseFence = releaseFence });
+
+    m_numPending += alloc.Count;
+
+    m_lock.Unlock();
+}
+
+void DescriptorAllocator::Recycle(uint64_t completedFenceVal)
+{
+    m_lock.Lock();
+
+    // Pending queue is sorted by fence value
+    while (m_pendingHead < m_pending.size() &&
+        m_pending[m_pendingHead].ReleaseFence <= completedFenceVal)
+    {
+        const auto& p = m_pending[m_pendingHead++];
+        m_allocator.Free(p.Alloc);
+        m_numPending -= p.Alloc.Size;
+    }
+
+    // Compact once the retired prefix dominates so that the queue doesn't grow unbounded
+    if (m_pendingHead == m_pending.size())
+    {
+        m_pending.clear();
+        m_pendingHead = 0;
+    }
+    else if (m_pendingHead > 64 && m_pendingHead > m_pending.size() / 2)
+    {
+        const size_t numRemaining = m_pending.size() - m_pendingHead;
+        memmove(m_pending.data(), m_pending.data() + m_pendingHead, numRemaining * sizeof(PendingRelease));
+        m_pending.resize(numRemaining);
+        m_pendingHead = 0;
+    }
+
+    m_lock.Unlock();
+}
+
+void DescriptorAllocator::FlushThreadCache(int threadIdx)
+{
+    Assert(threadIdx >= 0 && threadIdx < MAX_NUM_THREAD_CACHES, "Invalid thread index.");
+    ThreadCache& cache = m_threadCaches[threadIdx];
+    uint32_t numFreed = 0;
+
+    m_lock.Lock();
+
+    for (int bin = 0; bin < NUM_CACHED_BINS; bin++)
+    {
+        for (int i = 0; i < cache.Size[bin]; i++)
+            m_allocator.Free(cache.Entries[bin][i]);
+
+        numFreed += cache.Size[bin] << bin;
+        cache.Size[bin] = 0;
+    }
+
+    m_lock.Unlock();
+
+    cache.NumCached.fetch_sub(numFreed, std::memory_order_relaxed);
+}
+
+void DescriptorAllocator::FlushAllThreadCaches()
+{
+    for (int i = 0; i < MAX_NUM_THREAD_CACHES; i++)
+        FlushThreadCache(i);
+}
+
+uint32_t DescriptorAllocator::NumFreeEntries() const
+{
+    uint32_t numCached = 0;
+    for (int i = 0; i < MAX_NUM_THREAD_CACHES; i++)
+        numCached += m_threadCaches[i].NumCached.load(std::memory_order_relaxed);
+
+    return m_allocator.FreeStorage() + numCached;
+}
+
+DescriptorAllocator::FragmentationReport DescriptorAllocator::GetFragmentationReport()
+{
+    uint32_t numCached = 0;
+    for (int i = 0; i < MAX_NUM_THREAD_CACHES; i++)
+        numCached += m_threadCaches[i].NumCached.load(std::memory_order_relaxed);
+
+    m_lock.Lock();
+    const auto report = m_allocator.GetStorageReport();
+    const uint32_t numPending = m_numPending;
+    m_lock.Unlock();
+
+    return FragmentationReport{ .TotalFree = report.TotalFreeSpace,
+        .LargestFreeRegion = report.LargestFreeRegion,
+        .NumCached = numCached,
+        .NumPending = numPending,
+        .Fragmentation = report.TotalFreeSpace > 0 ?
+            1.0f - (float)report.LargestFreeRegion / report.TotalFreeSpace : 0.0f };
+}
\ No newline at end of file
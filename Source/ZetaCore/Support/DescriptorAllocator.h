@@ -0,0 +1,131 @@
+#pragma once
+
+#include "OffsetAllocator.h"
+#include "Lock.h"
+#include "../Utility/SmallVector.h"
+#include <atomic>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include "../Posix/Posix.h"
+#endif
+
+namespace ZetaRay::Support
+{
+    // Allocates contiguous ranges of indices (e.g. descriptors in a descriptor heap) with O(1)
+    // allocation and release. Independent of D3D12 -- the caller maps returned offsets to
+    // heap handles.
+    //
+    //  - Backing storage is a two-level segregated fit (TLSF) allocator (OffsetAllocator) that
+    //    coalesces neighboring free ranges.
+    //  - Small power-of-two sizes (1, 2, 4, ..., MAX_CACHED_SIZE) are served from per-thread caches
+    //    without taking the lock. Each cache is refilled in batches, so the lock is taken
+    //    at most once every REFILL_BATCH_SIZE allocations per thread.
+    //  - Releases are deferred until the given fence value has completed. Pending releases are
+    //    kept sorted by fence value, so Recycle() is O(#retired).
+    class DescriptorAllocator
+    {
+    public:
+        static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+        static constexpr int MAX_NUM_THREAD_CACHES = ZETA_MAX_NUM_THREADS;
+        static constexpr int NUM_CACHED_BINS = 5;
+        static constexpr uint32_t MAX_CACHED_SIZE = 1 << (NUM_CACHED_BINS - 1);
+        static constexpr int THREAD_CACHE_CAPACITY = 16;
+        static constexpr int REFILL_BATCH_SIZE = THREAD_CACHE_CAPACITY / 2;
+
+        struct Allocation
+        {
+            static Allocation Empty()
+            {
+                return Allocation{ .Offset = INVALID_OFFSET,
+                    .Count = 0,
+                    .Internal = OffsetAllocator::INVALID_NODE };
+            }
+
+            ZetaInline bool IsEmpty() const { return Offset == INVALID_OFFSET; }
+
+            uint32_t Offset;
+            // Number of reserved entries -- may be larger than the requested count (see ReservedCount())
+            uint32_t Count;
+            uint32_t Internal;
+        };
+
+        struct FragmentationReport
+        {
+            // Free entries in the backing allocator
+            uint32_t TotalFree;
+            uint32_t LargestFreeRegion;
+            // Free entries that are held by the thread caches
+            uint32_t NumCached;
+            // Released entries that are waiting for their fence
+            uint32_t NumPending;
+            // 1 - (largest free region / total free). 0 means all the free space is contiguous.
+            float Fragmentation;
+        };
+
+        // Contention on the lock is reported under name (see Mutex)
+        explicit DescriptorAllocator(const char* name = nullptr)
+            : m_lock(name)
+        {}
+        ~DescriptorAllocator() = default;
+
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        void Init(uint32_t numEntries, uint32_t maxNumAllocs);
+        // threadIdx in [0, MAX_NUM_THREAD_CACHES) selects the calling thread's cache. Each cache
+        // must only be accessed by one thread. Passing -1 always goes through the lock.
+        Allocation Allocate(uint32_t count, int threadIdx = -1);
+        // The allocation becomes available again once Recycle() is called with a completed
+        // fence value >= releaseFence.
+        void Release(const Allocation& alloc, uint64_t releaseFence);
+        void Recycle(uint64_t completedFenceVal);
+        // Returns the cached entries of given thread to the backing allocator. Must be called
+        // from the owning thread or when it's known to be idle.
+        void FlushThreadCache(int threadIdx);
+        void FlushAllThreadCaches();
+
+        // Number of entries that are actually reserved for an allocation of given size
+        ZetaInline static uint32_t ReservedCount(uint32_t count)
+        {
+            return count <= MAX_CACHED_SIZE ? 1u << BinIndex(count) : count;
+        }
+
+        // Includes entries that are held by thread caches
+        uint32_t NumFreeEntries() const;
+        FragmentationReport GetFragmentationReport();
+        ZetaInline uint32_t Size() const { return m_size; }
+
+    private:
+        struct PendingRelease
+        {
+            OffsetAllocator::Allocation Alloc;
+            uint64_t ReleaseFence;
+        };
+
+        struct alignas(64) ThreadCache
+        {
+            OffsetAllocator::Allocation Entries[NUM_CACHED_BINS][THREAD_CACHE_CAPACITY];
+            int Size[NUM_CACHED_BINS] = { 0 };
+            // Read by other threads for reporting
+            std::atomic_uint32_t NumCached = 0;
+        };
+
+        ZetaInline static int BinIndex(uint32_t count)
+        {
+            return count == 1 ? 0 : 32 - (int)_lzcnt_u32(count - 1);
+        }
+
+        void RefillThreadCache(ThreadCache& cache, int bin);
+
+        OffsetAllocator m_allocator;
+        Mutex m_lock;
+        uint32_t m_size = 0;
+
+        Util::SmallVector<PendingRelease> m_pending;
+        size_t m_pendingHead = 0;
+        uint32_t m_numPending = 0;
+
+        ThreadCache m_threadCaches[MAX_NUM_THREAD_CACHES];
+    };
+}
@@ -0,0 +1,398 @@
+#include "FrameCapture.h"
+#include "ParamRegistry.h"
+#include "../App/Filesystem.h"
+#include <xxHash/xxhash.h>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Scene;
+
+namespace
+{
+    // Layout (little endian):
+    //  - Header: magic, version, number of frames (uint32 each)
+    //  - For each frame: time since the capture began in nanoseconds (int64), dt in seconds
+    //    (double), number of events (uint32), size of the events in bytes (uint32),
+    //    followed by the events
+    //  - Event: type (uint8), size of the payload in bytes (uint16), payload
+    //      - Camera motion: dt (float), acceleration (3 floats), mouse delta (2 int16s)
+    //      - Param: group, subgroup, name and value as null-terminated strings
+    //      - Pick: type (uint8), x, y (uint16 each)
+    //      - Transform: instance ID (uint64), translation (3 floats), rotation (3x3
+    //        floats, row-major), scale (3 floats)
+    constexpr size_t HEADER_SIZE = 3 * sizeof(uint32_t);
+    constexpr size_t FRAME_HEADER_SIZE = sizeof(int64_t) + sizeof(double) + 2 * sizeof(uint32_t);
+    constexpr size_t EVENT_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint16_t);
+
+    template<typename T>
+    ZetaInline void Append(SmallVector<uint8_t>& data, const T& val)
+    {
+        const size_t offset = data.size();
+        data.resize(offset + sizeof(T));
+        memcpy(data.data() + offset, &val, sizeof(T));
+    }
+
+    ZetaInline void AppendStr(SmallVector<uint8_t>& data, const char* str)
+    {
+        const size_t n = strlen(str) + 1;
+        data.append_range(reinterpret_cast<const uint8_t*>(str), reinterpret_cast<const uint8_t*>(str) + n);
+    }
+
+    template<typename T>
+    ZetaInline bool Read(const SmallVector<uint8_t>& data, size_t& offset, size_t end, T& val)
+    {
+        if (offset + sizeof(T) > end)
+            return false;
+
+        memcpy(&val, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+
+        return true;
+    }
+
+    ZetaInline bool ReadStr(const SmallVector<uint8_t>& data, size_t& offset, size_t end, const char*& str)
+    {
+        const char* beg = reinterpret_cast<const char*>(data.data() + offset);
+        const void* nul = offset < end ? memchr(beg, '\0', end - offset) : nullptr;
+        if (!nul)
+            return false;
+
+        str = beg;
+        offset += reinterpret_cast<const char*>(nul) - beg + 1;
+
+        return true;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// FrameCaptureWriter
+//--------------------------------------------------------------------------------------
+
+void FrameCaptureWriter::Begin()
+{
+    m_lock.Lock();
+
+    Assert(!IsRecording(), "Capture has already begun.");
+    m_data.clear();
+    m_paramValues.clear();
+    m_nextFrameTransforms.clear();
+    m_numFrames = 0;
+    m_numFrameEvents = 0;
+
+    Append(m_data, MAGIC);
+    Append(m_data, VERSION);
+    Append(m_data, uint32_t(0));
+
+    m_recording.store(true, std::memory_order_relaxed);
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::End(const char* path)
+{
+    m_lock.Lock();
+    Assert(IsRecording(), "Begin() hasn't been called.");
+    m_recording.store(false, std::memory_order_relaxed);
+
+    if (m_numFrames)
+        memcpy(m_data.data() + m_frameHeaderOffset + sizeof(int64_t) + sizeof(double), &m_numFrameEvents, sizeof(uint32_t));
+
+    memcpy(m_data.data() + 2 * sizeof(uint32_t), &m_numFrames, sizeof(uint32_t));
+    App::Filesystem::WriteToFile(path, m_data.data(), (uint32_t)m_data.size());
+
+    m_data.free_memory();
+    m_paramValues.clear();
+    m_nextFrameTransforms.clear();
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::BeginFrame(int64_t timeNs, double dt)
+{
+    m_lock.Lock();
+
+    // Number of events of the previous frame
+    if (m_numFrames)
+        memcpy(m_data.data() + m_frameHeaderOffset + sizeof(int64_t) + sizeof(double), &m_numFrameEvents, sizeof(uint32_t));
+
+    m_frameHeaderOffset = m_data.size();
+    m_numFrameEvents = 0;
+    m_numFrames++;
+
+    Append(m_data, timeNs);
+    Append(m_data, dt);
+    Append(m_data, uint32_t(0));
+    Append(m_data, uint32_t(0));
+
+    for (auto& t : m_nextFrameTransforms)
+        WriteTransform(t);
+
+    m_nextFrameTransforms.clear();
+
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::BeginEvent(CAPTURE_EVENT type)
+{
+    Assert(m_numFrames, "BeginFrame() hasn't been called.");
+
+    m_eventOffset = m_data.size();
+    Append(m_data, (uint8_t)type);
+    Append(m_data, uint16_t(0));
+}
+
+void FrameCaptureWriter::EndEvent()
+{
+    const size_t payloadSize = m_data.size() - m_eventOffset - EVENT_HEADER_SIZE;
+    Assert(payloadSize <= UINT16_MAX, "Event is too large.");
+    const uint16_t size = (uint16_t)payloadSize;
+    memcpy(m_data.data() + m_eventOffset + sizeof(uint8_t), &size, sizeof(uint16_t));
+
+    // Size of the current frame's events
+    const size_t frameEventsOffset = m_frameHeaderOffset + FRAME_HEADER_SIZE;
+    const uint32_t eventsSize = (uint32_t)(m_data.size() - frameEventsOffset);
+    memcpy(m_data.data() + frameEventsOffset - sizeof(uint32_t), &eventsSize, sizeof(uint32_t));
+
+    m_numFrameEvents++;
+}
+
+void FrameCaptureWriter::RecordMotion(const Motion& m)
+{
+    m_lock.Lock();
+    BeginEvent(CAPTURE_EVENT::CAMERA_MOTION);
+
+    Append(m_data, m.dt);
+    Append(m_data, m.Acceleration);
+    Append(m_data, m.dMouse_x);
+    Append(m_data, m.dMouse_y);
+
+    EndEvent();
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::RecordParamChanges(Span<ParamVariant> params)
+{
+    m_lock.Lock();
+
+    // Every param is recorded on the first frame
+    const bool recordAll = m_paramValues.size() == 0;
+
+    for (auto& p : params)
+    {
+        char value[ParamRegistry::MAX_VALUE_LEN];
+        const int n = ParamRegistry::FormatValue(p, value, sizeof(value));
+        const uint64_t h = XXH3_64bits(value, n);
+
+        if (!recordAll)
+        {
+            auto prev = m_paramValues.find(p.ID());
+            if (prev && *prev.value() == h)
+                continue;
+        }
+
+        m_paramValues.insert_or_assign(p.ID(), h);
+
+        BeginEvent(CAPTURE_EVENT::PARAM);
+        AppendStr(m_data, p.GetGroup());
+        AppendStr(m_data, p.GetSubGroup());
+        AppendStr(m_data, p.GetName());
+        AppendStr(m_data, value);
+        EndEvent();
+    }
+
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::RecordPick(CAPTURE_PICK type, uint16_t x, uint16_t y)
+{
+    m_lock.Lock();
+    BeginEvent(CAPTURE_EVENT::PICK);
+
+    Append(m_data, (uint8_t)type);
+    Append(m_data, x);
+    Append(m_data, y);
+
+    EndEvent();
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::RecordTransform(uint64_t instanceID, const float3& tr, const float3x3& rotation,
+    const float3& scale, bool nextFrame)
+{
+    const CapturedTransform t{ .InstanceID = instanceID,
+        .Translation = tr,
+        .Rotation = rotation,
+        .Scale = scale };
+
+    m_lock.Lock();
+
+    if (nextFrame)
+        m_nextFrameTransforms.push_back(t);
+    else
+        WriteTransform(t);
+
+    m_lock.Unlock();
+}
+
+void FrameCaptureWriter::WriteTransform(const CapturedTransform& t)
+{
+    BeginEvent(CAPTURE_EVENT::TRANSFORM);
+
+    Append(m_data, t.InstanceID);
+    Append(m_data, t.Translation);
+
+    for (int i = 0; i < 3; i++)
+        Append(m_data, t.Rotation.m[i]);
+
+    Append(m_data, t.Scale);
+
+    EndEvent();
+}
+
+//--------------------------------------------------------------------------------------
+// FrameCaptureReader
+//--------------------------------------------------------------------------------------
+
+bool FrameCaptureReader::Load(const char* path)
+{
+    m_data.clear();
+    m_numFrames = 0;
+
+    if (!App::Filesystem::Exists(path))
+        return false;
+
+    App::Filesystem::LoadFromFile(path, m_data);
+
+    return Validate();
+}
+
+bool FrameCaptureReader::Load(Span<uint8_t> data)
+{
+    m_data.clear();
+    m_data.append_range(data.begin(), data.end(), true);
+    m_numFrames = 0;
+
+    return Validate();
+}
+
+bool FrameCaptureReader::Validate()
+{
+    size_t offset = 0;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numFrames;
+
+    if (!Read(m_data, offset, m_data.size(), magic) || magic != FrameCaptureWriter::MAGIC ||
+        !Read(m_data, offset, m_data.size(), version) || version != FrameCaptureWriter::VERSION ||
+        !Read(m_data, offset, m_data.size(), numFrames))
+    {
+        return false;
+    }
+
+    // Every frame must fit
+    for (uint32_t f = 0; f < numFrames; f++)
+    {
+        if (offset + FRAME_HEADER_SIZE > m_data.size())
+            return false;
+
+        uint32_t eventsSize;
+        memcpy(&eventsSize, m_data.data() + offset + FRAME_HEADER_SIZE - sizeof(uint32_t), sizeof(uint32_t));
+        offset += FRAME_HEADER_SIZE + eventsSize;
+
+        if (offset > m_data.size())
+            return false;
+    }
+
+    m_numFrames = numFrames;
+    m_nextFrame = HEADER_SIZE;
+    m_nextEvent = 0;
+    m_frameEnd = 0;
+
+    return true;
+}
+
+bool FrameCaptureReader::NextFrame(CapturedFrame& frame)
+{
+    if (m_nextFrame + FRAME_HEADER_SIZE > m_data.size())
+        return false;
+
+    size_t offset = m_nextFrame;
+    uint32_t eventsSize;
+
+    Read(m_data, offset, m_data.size(), frame.TimeNs);
+    Read(m_data, offset, m_data.size(), frame.Dt);
+    Read(m_data, offset, m_data.size(), frame.NumEvents);
+    Read(m_data, offset, m_data.size(), eventsSize);
+
+    m_nextEvent = offset;
+    m_frameEnd = offset + eventsSize;
+    m_nextFrame = m_frameEnd;
+
+    return true;
+}
+
+bool FrameCaptureReader::NextEvent(CapturedEvent& event)
+{
+    // Skips over the events that are malformed or of unknown types
+    while (m_nextEvent + EVENT_HEADER_SIZE <= m_frameEnd)
+    {
+        size_t offset = m_nextEvent;
+        uint8_t type;
+        uint16_t size;
+
+        Read(m_data, offset, m_frameEnd, type);
+        Read(m_data, offset, m_frameEnd, size);
+
+        const size_t end = offset + size;
+        m_nextEvent = end;
+
+        if (end > m_frameEnd)
+            return false;
+
+        event.Type = (CAPTURE_EVENT)type;
+        bool valid = false;
+
+        switch (event.Type)
+        {
+        case CAPTURE_EVENT::CAMERA_MOTION:
+            valid = Read(m_data, offset, end, event.Motion.dt) &&
+                Read(m_data, offset, end, event.Motion.Acceleration) &&
+                Read(m_data, offset, end, event.Motion.dMouse_x) &&
+                Read(m_data, offset, end, event.Motion.dMouse_y);
+            break;
+
+        case CAPTURE_EVENT::PARAM:
+            valid = ReadStr(m_data, offset, end, event.Param.Group) &&
+                ReadStr(m_data, offset, end, event.Param.Subgroup) &&
+                ReadStr(m_data, offset, end, event.Param.Name) &&
+                ReadStr(m_data, offset, end, event.Param.Value);
+            break;
+
+        case CAPTURE_EVENT::PICK:
+        {
+            uint8_t pickType;
+            valid = Read(m_data, offset, end, pickType) &&
+                Read(m_data, offset, end, event.Pick.X) &&
+                Read(m_data, offset, end, event.Pick.Y);
+            event.Pick.Type = (CAPTURE_PICK)pickType;
+            break;
+        }
+
+        case CAPTURE_EVENT::TRANSFORM:
+            valid = Read(m_data, offset, end, event.Transform.InstanceID) &&
+                Read(m_data, offset, end, event.Transform.Translation) &&
+                Read(m_data, offset, end, event.Transform.Rotation.m[0]) &&
+                Read(m_data, offset, end, event.Transform.Rotation.m[1]) &&
+                Read(m_data, offset, end, event.Transform.Rotation.m[2]) &&
+                Read(m_data, offset, end, event.Transform.Scale);
+            break;
+
+        default:
+            break;
+        }
+
+        if (valid)
+            return true;
+    }
+
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Lock.h"
+#include "../Scene/Camera.h"
+#include "../Math/Matrix.h"
+#include "../Utility/HashTable.h"
+#include "../Utility/SmallVector.h"
+
+namespace ZetaRay::Support
+{
+    struct ParamVariant;
+
+    enum class CAPTURE_EVENT : uint8_t
+    {
+        CAMERA_MOTION,
+        PARAM,
+        PICK,
+        TRANSFORM,
+        COUNT
+    };
+
+    enum class CAPTURE_PICK : uint8_t
+    {
+        SINGLE,
+        MULTI,
+        CLEAR
+    };
+
+    struct CapturedPick
+    {
+        CAPTURE_PICK Type;
+        uint16_t X;
+        uint16_t Y;
+    };
+
+    struct CapturedTransform
+    {
+        uint64_t InstanceID;
+        Math::float3 Translation;
+        Math::float3x3 Rotation;
+        Math::float3 Scale;
+    };
+
+    // Strings point into the reader's buffer
+    struct CapturedParam
+    {
+        const char* Group;
+        const char* Subgroup;
+        const char* Name;
+        // In the syntax of ParamRegistry::SetValue()
+        const char* Value;
+    };
+
+    // Only the member that corresponds to Type is valid
+    struct CapturedEvent
+    {
+        CAPTURE_EVENT Type;
+        Scene::Motion Motion;
+        CapturedParam Param;
+        CapturedPick Pick;
+        CapturedTransform Transform;
+    };
+
+    struct CapturedFrame
+    {
+        // Since the capture began
+        int64_t TimeNs;
+        // Elapsed time that the scene was updated with
+        double Dt;
+        uint32_t NumEvents;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // FrameCapture: The per-frame inputs to the scene (camera motion, param changes, picks
+    // and transform edits along with the frame times), recorded so that a session can be
+    // replayed as a fixed workload (see App::Headless::Replay()).
+    //
+    //  - Param changes are found by comparing the formatted value of every param against
+    //    the previous frame. The first frame records every param, so that a replay starts
+    //    from the same values.
+    //  - Events can be recorded from any thread, they belong to the last frame that was
+    //    started. Transform edits can instead be deferred to the next frame, so that they're
+    //    replayed in the frame where they take effect.
+    //--------------------------------------------------------------------------------------
+
+    struct FrameCaptureWriter
+    {
+        static constexpr uint32_t MAGIC = 0x5041435a;     // "ZCAP"
+        static constexpr uint32_t VERSION = 1;
+
+        FrameCaptureWriter() = default;
+        ~FrameCaptureWriter() = default;
+
+        FrameCaptureWriter(FrameCaptureWriter&&) = delete;
+        FrameCaptureWriter& operator=(FrameCaptureWriter&&) = delete;
+
+        void Begin();
+        // Writes the recorded frames to the given path (see the layout below)
+        void End(const char* path);
+        ZetaInline bool IsRecording() const { return m_recording.load(std::memory_order_relaxed); }
+
+        void BeginFrame(int64_t timeNs, double dt);
+        void RecordMotion(const Scene::Motion& m);
+        void RecordParamChanges(Util::Span<ParamVariant> params);
+        void RecordPick(CAPTURE_PICK type, uint16_t x = 0, uint16_t y = 0);
+        void RecordTransform(uint64_t instanceID, const Math::float3& tr, const Math::float3x3& rotation,
+            const Math::float3& scale, bool nextFrame = false);
+
+    private:
+        void BeginEvent(CAPTURE_EVENT type);
+        void EndEvent();
+        void WriteTransform(const CapturedTransform& t);
+
+        Util::SmallVector<uint8_t> m_data;
+        // Hash of the formatted value of each param as of the last frame
+        Util::HashTable<uint64_t> m_paramValues;
+        // Written at the beginning of the next frame
+        Util::SmallVector<CapturedTransform> m_nextFrameTransforms;
+        size_t m_frameHeaderOffset = 0;
+        size_t m_eventOffset = 0;
+        uint32_t m_numFrames = 0;
+        uint32_t m_numFrameEvents = 0;
+        std::atomic_bool m_recording = false;
+        Mutex m_lock;
+    };
+
+    struct FrameCaptureReader
+    {
+        FrameCaptureReader() = default;
+        ~FrameCaptureReader() = default;
+
+        FrameCaptureReader(FrameCaptureReader&&) = delete;
+        FrameCaptureReader& operator=(FrameCaptureReader&&) = delete;
+
+        // Returns false if the file doesn't exist or isn't a valid capture
+        bool Load(const char* path);
+        bool Load(Util::Span<uint8_t> data);
+        ZetaInline uint32_t NumFrames() const { return m_numFrames; }
+
+        // Moves to the next frame. Returns false after the last frame.
+        bool NextFrame(CapturedFrame& frame);
+        // Next event of the current frame. Returns false after the last one.
+        bool NextEvent(CapturedEvent& event);
+
+    private:
+        bool Validate();
+
+        Util::SmallVector<uint8_t> m_data;
+        uint32_t m_numFrames = 0;
+        // Offset of the next frame
+        size_t m_nextFrame = 0;
+        // Offset of the next event of the current frame and end of its events
+        size_t m_nextEvent = 0;
+        size_t m_frameEnd = 0;
+    };
+}
\ No newline at end of file
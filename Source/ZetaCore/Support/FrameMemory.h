@@ -1,10 +1,19 @@
 #pragma once
 
 #include "../Utility/Error.h"
+#include "CpuTopology.h"
 #include <string.h>
+#ifdef _WIN32
+#include "../Win32/Win32.h"
+#else
+#include <sys/mman.h>
+#endif
 
 namespace ZetaRay::Support
 {
+    // Blocks are grouped by the NUMA node of the threads that use them. Their pages are
+    // placed on that node; on Windows explicitly, elsewhere by being first touched by a
+    // thread that runs on it.
     template<size_t BlockSize>
     struct FrameMemory
     {
@@ -17,7 +26,7 @@ namespace ZetaRay::Support
             for (int i = 0; i < NUM_BLOCKS; i++)
             {
                 if (m_blocks[i].Start)
-                    free(m_blocks[i].Start);
+                    FreeBlock(m_blocks[i].Start);
             }
         }
 
@@ -31,19 +40,24 @@ namespace ZetaRay::Support
             int UsageCounter;
         };
 
-        ZetaInline MemoryBlock& GetAndInitIfEmpty(int i)
+        // i is the index of block among the blocks of given node, osNodeID is the node's
+        // ID as reported by the OS
+        ZetaInline MemoryBlock& GetAndInitIfEmpty(int node, int i, int osNodeID = 0)
         {
-            Assert(i >= 0 && i < NUM_BLOCKS, "Invalid block index.");
+            Assert(node >= 0 && node < CpuTopology::MAX_NUM_NODES, "Invalid node.");
+            Assert(i >= 0 && i < NUM_BLOCKS_PER_NODE, "Invalid block index.");
 
-            if (!m_blocks[i].Start)
+            MemoryBlock& block = m_blocks[node * NUM_BLOCKS_PER_NODE + i];
+
+            if (!block.Start)
             {
-                m_blocks[i].Start = malloc(BLOCK_SIZE);
-                m_blocks[i].Offset = 0;
+                block.Start = AllocateBlock(osNodeID);
+                block.Offset = 0;
             }
 
-            m_blocks[i].UsageCounter = NUM_FRAMES_TO_FREE_DELAY;
+            block.UsageCounter = NUM_FRAMES_TO_FREE_DELAY;
 
-            return m_blocks[i];
+            return block;
         }
 
         void Reset()
@@ -58,7 +72,7 @@ namespace ZetaRay::Support
 
                 if (m_blocks[i].UsageCounter == 0)
                 {
-                    free(m_blocks[i].Start);
+                    FreeBlock(m_blocks[i].Start);
                     m_blocks[i].Start = nullptr;
                 }
             }
@@ -77,10 +91,35 @@ namespace ZetaRay::Support
             return sum;
         }
 
-        static constexpr int NUM_BLOCKS = ZETA_MAX_NUM_THREADS * 2;
+        static constexpr int NUM_BLOCKS_PER_NODE = ZETA_MAX_NUM_THREADS * 2;
+        static constexpr int NUM_BLOCKS = NUM_BLOCKS_PER_NODE * CpuTopology::MAX_NUM_NODES;
         static constexpr int NUM_FRAMES_TO_FREE_DELAY = 10;
         static constexpr size_t BLOCK_SIZE = BlockSize;
 
         MemoryBlock m_blocks[NUM_BLOCKS];
+
+    private:
+        // Pages are reserved but not touched here
+        static void* AllocateBlock(int osNodeID)
+        {
+#ifdef _WIN32
+            void* mem = VirtualAllocExNuma(GetCurrentProcess(), nullptr, BLOCK_SIZE,
+                MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, (DWORD)osNodeID);
+            Check(mem, "VirtualAllocExNuma() failed.");
+#else
+            void* mem = mmap(nullptr, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            Check(mem != MAP_FAILED, "mmap() failed.");
+#endif
+            return mem;
+        }
+
+        static void FreeBlock(void* mem)
+        {
+#ifdef _WIN32
+            VirtualFree(mem, 0, MEM_RELEASE);
+#else
+            munmap(mem, BLOCK_SIZE);
+#endif
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "FramePipeline.h"
+#include "../App/Timer.h"
+#include <string.h>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::App;
+
+//--------------------------------------------------------------------------------------
+// FramePipeline
+//--------------------------------------------------------------------------------------
+
+void FramePipeline::SetFramesInFlight(int n)
+{
+    Assert(n >= 1 && n <= MAX_FRAMES_IN_FLIGHT, "Frames in flight must be in [1, %d].", MAX_FRAMES_IN_FLIGHT);
+    m_queuedFramesInFlight.store(n, std::memory_order_relaxed);
+}
+
+uint64_t FramePipeline::BeginFrame(WaitFn waitFn)
+{
+    m_framesInFlight = m_queuedFramesInFlight.load(std::memory_order_relaxed);
+    const uint64_t frame = m_nextFrame++;
+    const int64_t waitBegin = Timer::NowNano();
+
+    if (frame >= (uint64_t)m_framesInFlight)
+    {
+        const uint64_t waitFor = frame - m_framesInFlight;
+        uint64_t numCompleted = m_numCompleted.load(std::memory_order_acquire);
+
+        if (waitFn)
+        {
+            if (numCompleted <= waitFor)
+            {
+                waitFn(waitFor);
+                CompleteFrame(waitFor);
+            }
+        }
+        else
+        {
+            while (numCompleted <= waitFor)
+            {
+                m_numCompleted.wait(numCompleted, std::memory_order_acquire);
+                numCompleted = m_numCompleted.load(std::memory_order_acquire);
+            }
+        }
+    }
+
+    // The frame that previously used this slot has completed, so it can be reused
+    FrameTimes& f = m_frames[Slot(frame)];
+    memset(&f, 0, sizeof(f));
+    f.Begin = waitBegin;
+    f.StageBegin[(int)FRAME_STAGE::GPU_WAIT] = waitBegin;
+    f.StageEnd[(int)FRAME_STAGE::GPU_WAIT] = Timer::NowNano();
+
+    return frame;
+}
+
+void FramePipeline::CompleteFrame(uint64_t frame)
+{
+    m_latest.Update([this, frame](FrameLatencies& latest)
+        {
+            // Frames that were completed by a later frame's completion are skipped
+            if (frame < m_numCompleted.load(std::memory_order_relaxed))
+                return;
+
+            const int64_t now = Timer::NowNano();
+            const FrameTimes& f = m_frames[Slot(frame)];
+
+            latest.Frame = frame;
+            latest.TotalMs = (float)((double)(now - f.Begin) / 1'000'000);
+
+            for (int i = 0; i < (int)FRAME_STAGE::COUNT; i++)
+            {
+                latest.StageMs[i] = f.StageEnd[i] != 0 ?
+                    (float)((double)(f.StageEnd[i] - f.StageBegin[i]) / 1'000'000) :
+                    0.0f;
+            }
+
+            m_numCompleted.store(frame + 1, std::memory_order_release);
+            m_numCompleted.notify_all();
+        });
+}
+
+void FramePipeline::BeginStage(uint64_t frame, FRAME_STAGE stage)
+{
+    Assert(stage < FRAME_STAGE::COUNT, "Invalid stage.");
+    Assert(frame >= m_numCompleted.load(std::memory_order_relaxed), "Frame %llu has already completed.", frame);
+    m_frames[Slot(frame)].StageBegin[(int)stage] = Timer::NowNano();
+}
+
+void FramePipeline::EndStage(uint64_t frame, FRAME_STAGE stage)
+{
+    Assert(stage < FRAME_STAGE::COUNT, "Invalid stage.");
+    Assert(frame >= m_numCompleted.load(std::memory_order_relaxed), "Frame %llu has already completed.", frame);
+    m_frames[Slot(frame)].StageEnd[(int)stage] = Timer::NowNano();
+}
+
+bool FramePipeline::GetLatest(FrameLatencies& l)
+{
+    l = m_latest.Load();
+
+    return l.Frame != UINT64_MAX;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Lock.h"
+#include <FastDelegate/FastDelegate.h>
+
+namespace ZetaRay::Support
+{
+    enum class FRAME_STAGE : uint8_t
+    {
+        // Waiting for the GPU to finish frame N - (frames in flight) before starting frame N
+        GPU_WAIT,
+        // Scene and animation updates
+        UPDATE,
+        // Render graph and command list recording
+        RECORD,
+        // Command list submission, present and end-of-frame recycling
+        SUBMIT,
+        COUNT
+    };
+
+    // Frame stats that App adds every frame for the last completed frame: one per stage,
+    // followed by the total latency
+    inline constexpr const char* FRAME_PIPELINE_STAT_GROUP = "Frame Pipeline";
+    inline constexpr const char* FRAME_PIPELINE_STAT_NAMES[(int)FRAME_STAGE::COUNT + 1] = {
+        "GPU wait (ms)",
+        "Update (ms)",
+        "Record (ms)",
+        "Submit (ms)",
+        "Latency (ms)" };
+
+    struct FrameLatencies
+    {
+        uint64_t Frame = UINT64_MAX;
+        // Zero for stages that weren't recorded
+        float StageMs[(int)FRAME_STAGE::COUNT] = { 0 };
+        // From the start of the frame until its completion was reported
+        float TotalMs = 0.0f;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // FramePipeline: Limits how far the CPU can run ahead of the GPU and measures where
+    // the time of each frame goes.
+    //
+    //  - BeginFrame() blocks until frame N - GetFramesInFlight() has completed. Fewer
+    //    frames in flight lowers the input-to-display latency, more frames in flight
+    //    hides CPU and GPU stalls.
+    //  - Resources that are written every frame and read by the GPU are versioned by
+    //    Slot(frame) (see PerFrame). Since there are always MAX_FRAMES_IN_FLIGHT slots,
+    //    changing the number of frames in flight never aliases a slot that is in use.
+    //  - Stages can begin and end on any thread. Their durations are available once the
+    //    frame has completed.
+    //--------------------------------------------------------------------------------------
+
+    struct FramePipeline
+    {
+        static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
+        // Blocks until the given frame has completed (e.g. on a GPU fence)
+        using WaitFn = fastdelegate::FastDelegate1<uint64_t>;
+
+        FramePipeline() = default;
+        ~FramePipeline() = default;
+
+        FramePipeline(FramePipeline&&) = delete;
+        FramePipeline& operator=(FramePipeline&&) = delete;
+
+        // Takes effect at the next BeginFrame(). Thread-safe.
+        void SetFramesInFlight(int n);
+        ZetaInline int GetFramesInFlight() const { return m_framesInFlight; }
+
+        // Starts the next frame and returns its index (starting from zero). Frame
+        // N - GetFramesInFlight() must have completed first, either by waitFn (after which
+        // that frame and every frame before it are marked as completed) or, if waitFn is
+        // empty, by a CompleteFrame() call from another thread. Must be called from one
+        // thread at a time.
+        uint64_t BeginFrame(WaitFn waitFn = WaitFn());
+        ZetaInline uint64_t GetCurrentFrame() const { return m_nextFrame - 1; }
+        // Marks the given frame and every frame before it as completed. Thread-safe.
+        void CompleteFrame(uint64_t frame);
+        // Every frame before this one has completed
+        ZetaInline uint64_t GetNumCompletedFrames() const { return m_numCompleted.load(std::memory_order_acquire); }
+
+        ZetaInline static int Slot(uint64_t frame) { return (int)(frame % MAX_FRAMES_IN_FLIGHT); }
+
+        // Frame must be in flight
+        void BeginStage(uint64_t frame, FRAME_STAGE stage);
+        void EndStage(uint64_t frame, FRAME_STAGE stage);
+
+        // Latencies of the last completed frame. Returns false if no frame has completed yet.
+        bool GetLatest(FrameLatencies& l);
+
+    private:
+        struct FrameTimes
+        {
+            int64_t Begin;
+            int64_t StageBegin[(int)FRAME_STAGE::COUNT];
+            int64_t StageEnd[(int)FRAME_STAGE::COUNT];
+        };
+
+        FrameTimes m_frames[MAX_FRAMES_IN_FLIGHT];
+        uint64_t m_nextFrame = 0;
+        int m_framesInFlight = MAX_FRAMES_IN_FLIGHT;
+        std::atomic_int32_t m_queuedFramesInFlight = MAX_FRAMES_IN_FLIGHT;
+
+        std::atomic_uint64_t m_numCompleted = 0;
+        // Also serializes CompleteFrame() calls
+        SeqLock<FrameLatencies> m_latest;
+    };
+
+    // Per-frame copies of T, one for each frame that can be in flight
+    template<typename T>
+    struct PerFrame
+    {
+        ZetaInline T& operator[](uint64_t frame) { return m_data[FramePipeline::Slot(frame)]; }
+        ZetaInline const T& operator[](uint64_t frame) const { return m_data[FramePipeline::Slot(frame)]; }
+
+        T m_data[FramePipeline::MAX_FRAMES_IN_FLIGHT];
+    };
+}
\ No newline at end of file
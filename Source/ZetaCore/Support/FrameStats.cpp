@@ -0,0 +1,247 @@
+#include "FrameStats.h"
+#include "../App/Filesystem.h"
+#include <xxHash/xxhash.h>
+#include <algorithm>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    template<typename T>
+    ZetaInline void Append(SmallVector<uint8_t>& data, const T& val)
+    {
+        const size_t offset = data.size();
+        data.resize(offset + sizeof(T));
+        memcpy(data.data() + offset, &val, sizeof(T));
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// FrameStats
+//--------------------------------------------------------------------------------------
+
+FrameStats::FrameStats()
+{
+    for (int i = 0; i < HASH_TABLE_SIZE; i++)
+        m_keys[i].store(0, std::memory_order_relaxed);
+
+    m_window.resize(MAX_NUM_STATS * WINDOW_LEN);
+    memset(m_windowCount, 0, sizeof(m_windowCount));
+    memset(m_windowNext, 0, sizeof(m_windowNext));
+}
+
+uint64_t FrameStats::Hash(const char* group, const char* name)
+{
+    Assert(group, "Group can't be NULL");
+    Assert(name, "Name can't be NULL");
+
+    // Same truncation as Stat, so that names that only differ past the limit map to the
+    // same stat
+    char buff[Stat::GROUP_LEN + Stat::NAME_LEN];
+    const size_t ng = Min(Stat::GROUP_LEN - 1, strlen(group));
+    const size_t nn = Min(Stat::NAME_LEN - 1, strlen(name));
+
+    memcpy(buff, group, ng);
+    buff[ng] = '.';
+    memcpy(buff + ng + 1, name, nn);
+
+    const uint64_t h = XXH3_64bits(buff, ng + nn + 1);
+
+    // Zero marks an empty slot
+    return h ? h : 1;
+}
+
+uint32_t FrameStats::Find(const char* group, const char* name) const
+{
+    const uint64_t h = Hash(group, name);
+    uint32_t slot = h & (HASH_TABLE_SIZE - 1);
+
+    while (true)
+    {
+        const uint64_t key = m_keys[slot].load(std::memory_order_acquire);
+        if (key == h)
+            return m_keyIDs[slot];
+        if (key == 0)
+            return INVALID_ID;
+
+        slot = (slot + 1) & (HASH_TABLE_SIZE - 1);
+    }
+}
+
+uint32_t FrameStats::Register(const char* group, const char* name)
+{
+    uint32_t id = Find(group, name);
+    if (id != INVALID_ID)
+        return id;
+
+    const uint64_t h = Hash(group, name);
+    uint32_t slot = h & (HASH_TABLE_SIZE - 1);
+
+    AcquireSRWLockExclusive(&m_registerLock);
+
+    // Another thread might've registered it in the meantime
+    while (true)
+    {
+        const uint64_t key = m_keys[slot].load(std::memory_order_relaxed);
+        if (key == h)
+        {
+            id = m_keyIDs[slot];
+            break;
+        }
+
+        if (key == 0)
+        {
+            id = m_numStats.load(std::memory_order_relaxed);
+            Check(id < MAX_NUM_STATS, "Number of frame stats exceeded MAX_NUM_STATS.");
+
+            m_registered[id] = Stat(group, name, Stat::ST_TYPE::ST_INT, 0);
+            m_keyIDs[slot] = id;
+            m_numStats.store(id + 1, std::memory_order_release);
+            m_keys[slot].store(h, std::memory_order_release);
+
+            break;
+        }
+
+        slot = (slot + 1) & (HASH_TABLE_SIZE - 1);
+    }
+
+    ReleaseSRWLockExclusive(&m_registerLock);
+
+    return id;
+}
+
+void FrameStats::Merge(uint64_t frameIdx)
+{
+    m_merged.clear();
+
+    for (int t = 0; t < ZETA_MAX_NUM_THREADS; t++)
+    {
+        auto& buffer = m_threadBuffers[t];
+        const uint32_t tail = buffer.Tail.load(std::memory_order_relaxed);
+        const uint32_t head = buffer.Head.load(std::memory_order_acquire);
+
+        for (uint32_t i = tail; i != head; i++)
+        {
+            const Entry& e = buffer.Entries[i & (THREAD_BUFFER_LEN - 1)];
+            auto& latest = m_latest[e.ID];
+
+            latest.Frame = frameIdx;
+            latest.Type = e.Type;
+            latest.Bits = e.Bits;
+        }
+
+        // Hand the slots back to the owner thread
+        buffer.Tail.store(head, std::memory_order_release);
+    }
+
+    size_t dumpCountOffset = 0;
+
+    if (m_dumping)
+    {
+        Append(m_dumpData, frameIdx);
+        dumpCountOffset = m_dumpData.size();
+        Append(m_dumpData, uint32_t(0));
+    }
+
+    const uint32_t numStats = m_numStats.load(std::memory_order_acquire);
+
+    for (uint32_t id = 0; id < numStats; id++)
+    {
+        const auto& latest = m_latest[id];
+        if (latest.Frame != frameIdx)
+            continue;
+
+        const Stat& reg = m_registered[id];
+        m_merged.emplace_back(reg.GetGroup(), reg.GetName(), latest.Type, latest.Bits);
+
+        m_window[id * WINDOW_LEN + m_windowNext[id]] = Stat::ToFloat(latest.Type, latest.Bits);
+        m_windowNext[id] = (m_windowNext[id] + 1) & (WINDOW_LEN - 1);
+        m_windowCount[id] = Min(m_windowCount[id] + 1, WINDOW_LEN);
+
+        if (m_dumping)
+        {
+            Append(m_dumpData, id);
+            Append(m_dumpData, (uint32_t)latest.Type);
+            Append(m_dumpData, latest.Bits);
+        }
+    }
+
+    if (m_dumping)
+    {
+        const uint32_t count = (uint32_t)m_merged.size();
+        memcpy(m_dumpData.data() + dumpCountOffset, &count, sizeof(count));
+        m_numDumpedFrames++;
+    }
+}
+
+StatPercentiles FrameStats::GetPercentiles(uint32_t id) const
+{
+    Assert(id < m_numStats.load(std::memory_order_relaxed), "Invalid stat ID %u.", id);
+
+    const uint32_t n = m_windowCount[id];
+    if (n == 0)
+        return StatPercentiles();
+
+    float sorted[WINDOW_LEN];
+    memcpy(sorted, m_window.data() + id * WINDOW_LEN, n * sizeof(float));
+    std::sort(sorted, sorted + n);
+
+    // Nearest rank
+    auto percentile = [&sorted, n](float p)
+        {
+            const int rank = (int)ceilf(p * n);
+            return sorted[Max(rank, 1) - 1];
+        };
+
+    return StatPercentiles{ .P50 = percentile(0.5f),
+        .P95 = percentile(0.95f),
+        .P99 = percentile(0.99f),
+        .NumSamples = (int)n };
+}
+
+void FrameStats::BeginDump()
+{
+    m_dumpData.clear();
+    m_numDumpedFrames = 0;
+    m_dumping = true;
+}
+
+void FrameStats::EndDump(const char* path)
+{
+    Assert(m_dumping, "BeginDump() hasn't been called.");
+    m_dumping = false;
+
+    // Layout (little endian):
+    //  - Header: magic, version, number of stats, number of frames (uint32 each)
+    //  - For each stat in order of ID: group (GROUP_LEN chars), name (NAME_LEN chars)
+    //  - For each frame: frame index (uint64), number of stats (uint32), followed by
+    //    (ID (uint32), type (uint32), value bits (uint64)) for each stat
+    const uint32_t numStats = m_numStats.load(std::memory_order_acquire);
+    SmallVector<uint8_t> file;
+    file.reserve(4 * sizeof(uint32_t) + numStats * (Stat::GROUP_LEN + Stat::NAME_LEN) +
+        m_dumpData.size());
+
+    Append(file, DUMP_MAGIC);
+    Append(file, DUMP_VERSION);
+    Append(file, numStats);
+    Append(file, m_numDumpedFrames);
+
+    for (uint32_t id = 0; id < numStats; id++)
+    {
+        char group[Stat::GROUP_LEN] = { 0 };
+        char name[Stat::NAME_LEN] = { 0 };
+        strcpy(group, m_registered[id].GetGroup());
+        strcpy(name, m_registered[id].GetName());
+
+        Append(file, group);
+        Append(file, name);
+    }
+
+    file.append_range(m_dumpData.begin(), m_dumpData.end(), true);
+    App::Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+
+    m_dumpData.free_memory();
+    m_numDumpedFrames = 0;
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Stat.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+#include <atomic>
+#ifdef _WIN32
+#include "../Win32/Win32.h"
+#else
+#include "../Posix/Posix.h"
+#endif
+
+namespace ZetaRay::Support
+{
+    struct StatPercentiles
+    {
+        float P50 = 0.0f;
+        float P95 = 0.0f;
+        float P99 = 0.0f;
+        int NumSamples = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // FrameStats: Per-frame stats that can be added from any thread without locking.
+    //
+    //  - Stats are identified by interned IDs rather than group and name strings. Lookup
+    //    of an existing ID is lock-free, registration of a new one takes a lock.
+    //  - Every thread writes to its own ring buffer, which are drained and merged once
+    //    per frame by Merge(). When the same stat is added more than once in a frame, the
+    //    last value wins.
+    //  - A rolling window of the last WINDOW_LEN merged values of each stat is kept for
+    //    percentiles.
+    //  - Merged frames can be recorded and written to a binary file for offline analysis
+    //    (see EndDump() for the layout).
+    //--------------------------------------------------------------------------------------
+
+    struct FrameStats
+    {
+        static constexpr uint32_t MAX_NUM_STATS = 256;
+        static constexpr uint32_t WINDOW_LEN = 128;
+        static constexpr uint32_t THREAD_BUFFER_LEN = 256;
+        static constexpr uint32_t INVALID_ID = UINT32_MAX;
+        static constexpr uint32_t DUMP_MAGIC = 0x5453465a;     // "ZFST"
+        static constexpr uint32_t DUMP_VERSION = 1;
+
+        FrameStats();
+        ~FrameStats() = default;
+
+        FrameStats(FrameStats&&) = delete;
+        FrameStats& operator=(FrameStats&&) = delete;
+
+        // Returns the same ID for the same group and name. Thread-safe.
+        uint32_t Register(const char* group, const char* name);
+        // Returns INVALID_ID if the stat hasn't been registered. Thread-safe and lock-free.
+        uint32_t Find(const char* group, const char* name) const;
+
+        // threadIdx must be unique to the calling thread and less than ZETA_MAX_NUM_THREADS
+        ZetaInline void Add(int threadIdx, uint32_t id, int i)
+        {
+            Push(threadIdx, id, Stat::ST_TYPE::ST_INT, (uint32_t)i);
+        }
+        ZetaInline void Add(int threadIdx, uint32_t id, uint32_t u)
+        {
+            Push(threadIdx, id, Stat::ST_TYPE::ST_UINT, u);
+        }
+        ZetaInline void Add(int threadIdx, uint32_t id, float f)
+        {
+            uint32_t u;
+            memcpy(&u, &f, sizeof(f));
+            Push(threadIdx, id, Stat::ST_TYPE::ST_FLOAT, u);
+        }
+        ZetaInline void Add(int threadIdx, uint32_t id, uint64_t u)
+        {
+            Push(threadIdx, id, Stat::ST_TYPE::ST_UINT64, u);
+        }
+        ZetaInline void Add(int threadIdx, uint32_t id, uint32_t num, uint32_t total)
+        {
+            Push(threadIdx, id, Stat::ST_TYPE::ST_RATIO, ((uint64_t)num << 32) | total);
+        }
+
+        // Drains the per-thread buffers into the merged stats for frameIdx, replacing the
+        // previous frame's. Must be called from one thread at a time.
+        void Merge(uint64_t frameIdx);
+        // Stats from the last Merge() in order of registration
+        ZetaInline Util::Span<Stat> GetMerged() { return m_merged; }
+        // Percentiles over the last WINDOW_LEN merged values of the given stat. Not
+        // thread-safe with respect to Merge().
+        StatPercentiles GetPercentiles(uint32_t id) const;
+        // Number of stats that were dropped due to a full thread buffer
+        ZetaInline uint64_t GetNumDropped() const { return m_numDropped.load(std::memory_order_relaxed); }
+
+        // Records every merged frame until EndDump()
+        void BeginDump();
+        void EndDump(const char* path);
+        ZetaInline bool IsDumping() const { return m_dumping; }
+
+    private:
+        static constexpr uint32_t HASH_TABLE_SIZE = MAX_NUM_STATS * 2;
+        static_assert(Math::IsPow2(THREAD_BUFFER_LEN), "Ring buffer length must be a power of two.");
+        static_assert(Math::IsPow2(WINDOW_LEN), "Window length must be a power of two.");
+        static_assert(Math::IsPow2(HASH_TABLE_SIZE), "Hash table size must be a power of two.");
+
+        struct Entry
+        {
+            uint32_t ID;
+            Stat::ST_TYPE Type;
+            uint64_t Bits;
+        };
+
+        // Single-producer single-consumer ring buffer. Head is only written by the owner
+        // thread, Tail only by Merge().
+        struct alignas(64) ThreadBuffer
+        {
+            Entry Entries[THREAD_BUFFER_LEN];
+            std::atomic_uint32_t Head = 0;
+            alignas(64) std::atomic_uint32_t Tail = 0;
+        };
+
+        struct LatestValue
+        {
+            uint64_t Frame = UINT64_MAX;
+            uint64_t Bits;
+            Stat::ST_TYPE Type;
+        };
+
+        ZetaInline void Push(int threadIdx, uint32_t id, Stat::ST_TYPE type, uint64_t bits)
+        {
+            Assert(threadIdx >= 0 && threadIdx < ZETA_MAX_NUM_THREADS, "Invalid thread index %d.", threadIdx);
+            Assert(id < m_numStats.load(std::memory_order_relaxed), "Invalid stat ID %u.", id);
+
+            auto& buffer = m_threadBuffers[threadIdx];
+            const uint32_t head = buffer.Head.load(std::memory_order_relaxed);
+
+            if (head - buffer.Tail.load(std::memory_order_acquire) == THREAD_BUFFER_LEN)
+            {
+                m_numDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            buffer.Entries[head & (THREAD_BUFFER_LEN - 1)] = Entry{ .ID = id, .Type = type, .Bits = bits };
+            buffer.Head.store(head + 1, std::memory_order_release);
+        }
+
+        static uint64_t Hash(const char* group, const char* name);
+
+        ThreadBuffer m_threadBuffers[ZETA_MAX_NUM_THREADS];
+
+        // Open addressing with linear probing, zero marks an empty slot. Key is published
+        // after ID, so a reader that sees the key also sees the ID.
+        std::atomic_uint64_t m_keys[HASH_TABLE_SIZE];
+        uint32_t m_keyIDs[HASH_TABLE_SIZE];
+        Stat m_registered[MAX_NUM_STATS];
+        std::atomic_uint32_t m_numStats = 0;
+        SRWLOCK m_registerLock = SRWLOCK_INIT;
+
+        Util::SmallVector<Stat> m_merged;
+        LatestValue m_latest[MAX_NUM_STATS];
+        std::atomic_uint64_t m_numDropped = 0;
+
+        // m_window[id * WINDOW_LEN + i]
+        Util::SmallVector<float> m_window;
+        uint32_t m_windowCount[MAX_NUM_STATS];
+        uint32_t m_windowNext[MAX_NUM_STATS];
+
+        Util::SmallVector<uint8_t> m_dumpData;
+        uint32_t m_numDumpedFrames = 0;
+        bool m_dumping = false;
+    };
+}
\ No newline at end of file
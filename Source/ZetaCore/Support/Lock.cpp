@@ -0,0 +1,226 @@
+#include "Lock.h"
+#include "../App/Timer.h"
+#include "../Math/Common.h"
+#ifdef _WIN32
+#include "../Win32/Win32.h"
+#else
+#include "../Posix/Posix.h"
+#endif
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    // Number of times a waiting thread checks the lock before parking. The pause between
+    // attempts doubles up to 2^MAX_BACKOFF_LOG2.
+    static constexpr int NUM_SPINS = 24;
+    static constexpr int MAX_BACKOFF_LOG2 = 6;
+    // Locks beyond this many aren't instrumented
+    static constexpr int MAX_NUM_NAMED_LOCKS = 64;
+
+    struct LockRegistry
+    {
+        SRWLOCK Lock = SRWLOCK_INIT;
+        LockStats* Locks[MAX_NUM_NAMED_LOCKS];
+        int NumLocks = 0;
+    };
+
+    // Constant-initialized, so that locks with static storage duration can register
+    // themselves
+    LockRegistry g_lockRegistry;
+
+    ZetaInline void Backoff(int i)
+    {
+        const int n = 1 << Math::Min(i, MAX_BACKOFF_LOG2);
+
+        for (int j = 0; j < n; j++)
+            _mm_pause();
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// LockStats
+//--------------------------------------------------------------------------------------
+
+LockStats::LockStats(const char* name)
+    : Name(name)
+{
+    if (!name)
+        return;
+
+    AcquireSRWLockExclusive(&g_lockRegistry.Lock);
+
+    if (g_lockRegistry.NumLocks < MAX_NUM_NAMED_LOCKS)
+        g_lockRegistry.Locks[g_lockRegistry.NumLocks++] = this;
+
+    ReleaseSRWLockExclusive(&g_lockRegistry.Lock);
+}
+
+LockStats::~LockStats()
+{
+    if (!Name)
+        return;
+
+    AcquireSRWLockExclusive(&g_lockRegistry.Lock);
+
+    for (int i = 0; i < g_lockRegistry.NumLocks; i++)
+    {
+        if (g_lockRegistry.Locks[i] == this)
+        {
+            g_lockRegistry.Locks[i] = g_lockRegistry.Locks[--g_lockRegistry.NumLocks];
+            break;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&g_lockRegistry.Lock);
+}
+
+int ZetaRay::Support::CollectLockStats(MutableSpan<LockFrameStats> stats)
+{
+    int n = 0;
+
+    AcquireSRWLockShared(&g_lockRegistry.Lock);
+
+    for (int i = 0; i < g_lockRegistry.NumLocks && n < (int)stats.size(); i++)
+    {
+        LockStats& l = *g_lockRegistry.Locks[i];
+        const uint32_t numAcquires = l.NumAcquires.exchange(0, std::memory_order_relaxed);
+        if (numAcquires == 0)
+            continue;
+
+        stats[n++] = LockFrameStats{ .Name = l.Name,
+            .NumAcquires = numAcquires,
+            .NumContended = l.NumContended.exchange(0, std::memory_order_relaxed),
+            .WaitMs = (float)((double)l.WaitNs.exchange(0, std::memory_order_relaxed) / 1'000'000) };
+    }
+
+    ReleaseSRWLockShared(&g_lockRegistry.Lock);
+
+    return n;
+}
+
+//--------------------------------------------------------------------------------------
+// Mutex
+//--------------------------------------------------------------------------------------
+
+void Mutex::LockContended()
+{
+    const int64_t begin = Timer::NowNano();
+
+    for (int i = 0; i < NUM_SPINS; i++)
+    {
+        Backoff(i);
+
+        uint32_t expected = UNLOCKED;
+        if (m_state.load(std::memory_order_relaxed) == UNLOCKED &&
+            m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire))
+        {
+            m_stats.OnContended(Timer::NowNano() - begin);
+            return;
+        }
+    }
+
+    // It's not known whether other threads are parked, so the lock is taken in the
+    // parked state, which makes the next Unlock() notify
+    while (m_state.exchange(LOCKED_PARKED, std::memory_order_acquire) != UNLOCKED)
+        m_state.wait(LOCKED_PARKED, std::memory_order_relaxed);
+
+    m_stats.OnContended(Timer::NowNano() - begin);
+}
+
+//--------------------------------------------------------------------------------------
+// RWLock
+//--------------------------------------------------------------------------------------
+
+void RWLock::LockSharedContended()
+{
+    const int64_t begin = Timer::NowNano();
+    int i = 0;
+
+    while (true)
+    {
+        uint32_t s = m_state.load(std::memory_order_relaxed);
+
+        if (!(s & (WRITER | WRITER_PENDING)))
+        {
+            Assert((s & READER_MASK) != READER_MASK, "Too many readers.");
+
+            if (m_state.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+                break;
+
+            continue;
+        }
+
+        if (i < NUM_SPINS)
+        {
+            Backoff(i++);
+            continue;
+        }
+
+        if (!(s & PARKED))
+        {
+            if (!m_state.compare_exchange_weak(s, s | PARKED, std::memory_order_relaxed))
+                continue;
+
+            s |= PARKED;
+        }
+
+        m_state.wait(s, std::memory_order_relaxed);
+    }
+
+    m_stats.OnContended(Timer::NowNano() - begin);
+}
+
+void RWLock::LockExclusiveContended()
+{
+    const int64_t begin = Timer::NowNano();
+    int i = 0;
+
+    while (true)
+    {
+        uint32_t s = m_state.load(std::memory_order_relaxed);
+
+        if (!(s & (WRITER | READER_MASK)))
+        {
+            // Clears WRITER_PENDING. Other waiting writers set it again when they retry.
+            if (m_state.compare_exchange_weak(s, (s & PARKED) | WRITER, std::memory_order_acquire))
+                break;
+
+            continue;
+        }
+
+        // Stop new readers from getting in
+        if (!(s & WRITER_PENDING))
+        {
+            m_state.compare_exchange_weak(s, s | WRITER_PENDING, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (i < NUM_SPINS)
+        {
+            Backoff(i++);
+            continue;
+        }
+
+        if (!(s & PARKED))
+        {
+            if (!m_state.compare_exchange_weak(s, s | PARKED, std::memory_order_relaxed))
+                continue;
+
+            s |= PARKED;
+        }
+
+        m_state.wait(s, std::memory_order_relaxed);
+    }
+
+    m_stats.OnContended(Timer::NowNano() - begin);
+}
+
+void RWLock::WakeAll()
+{
+    m_state.fetch_and(~PARKED, std::memory_order_relaxed);
+    m_state.notify_all();
+}
\ No newline at end of file
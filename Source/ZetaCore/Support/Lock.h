@@ -0,0 +1,259 @@
+#pragma once
+
+#include "../Utility/Error.h"
+#include "../Utility/Span.h"
+#include <atomic>
+#include <immintrin.h>
+#include <string.h>
+#include <type_traits>
+
+namespace ZetaRay::Support
+{
+    // Frame stats that App adds every frame for each named lock that was acquired: the
+    // ratio of contended acquisitions and the total time threads spent waiting
+    inline constexpr const char* LOCK_STAT_GROUP = "Locks";
+
+    struct LockFrameStats
+    {
+        const char* Name;
+        uint32_t NumAcquires;
+        // Acquisitions that didn't succeed on the first try
+        uint32_t NumContended;
+        float WaitMs;
+    };
+
+    // Contention counters of a lock. Named locks are registered so that their counters can
+    // be collected every frame (see CollectLockStats()).
+    struct LockStats
+    {
+        explicit LockStats(const char* name);
+        ~LockStats();
+
+        LockStats(LockStats&&) = delete;
+        LockStats& operator=(LockStats&&) = delete;
+
+        ZetaInline void OnAcquire()
+        {
+            NumAcquires.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ZetaInline void OnContended(int64_t waitNs)
+        {
+            NumContended.fetch_add(1, std::memory_order_relaxed);
+            WaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+        }
+
+        const char* Name;
+        std::atomic_uint32_t NumAcquires = 0;
+        std::atomic_uint32_t NumContended = 0;
+        std::atomic_int64_t WaitNs = 0;
+    };
+
+    // Copies the counters of the named locks that were acquired since the last call into
+    // stats and resets them. Returns the number of locks written.
+    int CollectLockStats(Util::MutableSpan<LockFrameStats> stats);
+
+    //--------------------------------------------------------------------------------------
+    // Locks that spin for a short while before parking the thread. Most critical sections
+    // in the engine are a few hundred cycles at most, so a waiting worker is likely to get
+    // the lock before an OS wait would even return.
+    //
+    //  - Parking is done with atomic wait/notify, and unlocking only notifies when some
+    //    thread has actually parked.
+    //  - A lock that's given a name has its contention counters reported as frame stats.
+    //--------------------------------------------------------------------------------------
+
+    struct alignas(64) Mutex
+    {
+        explicit Mutex(const char* name = nullptr)
+            : m_stats(name)
+        {}
+        ~Mutex() = default;
+
+        Mutex(Mutex&&) = delete;
+        Mutex& operator=(Mutex&&) = delete;
+
+        ZetaInline void Lock()
+        {
+            uint32_t expected = UNLOCKED;
+            if (!m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire))
+                LockContended();
+
+            m_stats.OnAcquire();
+        }
+
+        ZetaInline bool TryLock()
+        {
+            uint32_t expected = UNLOCKED;
+            if (!m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire))
+                return false;
+
+            m_stats.OnAcquire();
+            return true;
+        }
+
+        ZetaInline void Unlock()
+        {
+            if (m_state.exchange(UNLOCKED, std::memory_order_release) == LOCKED_PARKED)
+                m_state.notify_one();
+        }
+
+        ZetaInline const LockStats& Stats() const { return m_stats; }
+
+    private:
+        enum STATE : uint32_t
+        {
+            UNLOCKED,
+            LOCKED,
+            // Locked and at least one thread is parked
+            LOCKED_PARKED
+        };
+
+        void LockContended();
+
+        std::atomic_uint32_t m_state = UNLOCKED;
+        LockStats m_stats;
+    };
+
+    // Writers take priority: once a writer is waiting, new readers wait too
+    struct alignas(64) RWLock
+    {
+        explicit RWLock(const char* name = nullptr)
+            : m_stats(name)
+        {}
+        ~RWLock() = default;
+
+        RWLock(RWLock&&) = delete;
+        RWLock& operator=(RWLock&&) = delete;
+
+        ZetaInline void LockShared()
+        {
+            uint32_t s = m_state.load(std::memory_order_relaxed);
+            if ((s & (WRITER | WRITER_PENDING)) ||
+                !m_state.compare_exchange_strong(s, s + 1, std::memory_order_acquire))
+            {
+                LockSharedContended();
+            }
+
+            m_stats.OnAcquire();
+        }
+
+        ZetaInline void UnlockShared()
+        {
+            const uint32_t prev = m_state.fetch_sub(1, std::memory_order_release);
+            Assert((prev & READER_MASK) != 0, "Lock wasn't held in shared mode.");
+
+            // The last reader wakes up the waiting writers
+            if ((prev & READER_MASK) == 1 && (prev & PARKED))
+                WakeAll();
+        }
+
+        ZetaInline void LockExclusive()
+        {
+            uint32_t s = m_state.load(std::memory_order_relaxed) & PARKED;
+            if (!m_state.compare_exchange_strong(s, s | WRITER, std::memory_order_acquire))
+                LockExclusiveContended();
+
+            m_stats.OnAcquire();
+        }
+
+        ZetaInline void UnlockExclusive()
+        {
+            const uint32_t prev = m_state.fetch_and(~(WRITER | PARKED), std::memory_order_release);
+            Assert(prev & WRITER, "Lock wasn't held in exclusive mode.");
+
+            if (prev & PARKED)
+                m_state.notify_all();
+        }
+
+        ZetaInline const LockStats& Stats() const { return m_stats; }
+
+    private:
+        static constexpr uint32_t WRITER = 1u << 31;
+        // Blocks new readers
+        static constexpr uint32_t WRITER_PENDING = 1u << 30;
+        // Some thread is parked and needs to be woken up
+        static constexpr uint32_t PARKED = 1u << 29;
+        static constexpr uint32_t READER_MASK = PARKED - 1;
+
+        void LockSharedContended();
+        void LockExclusiveContended();
+        void WakeAll();
+
+        std::atomic_uint32_t m_state = 0;
+        LockStats m_stats;
+    };
+
+    // For data that is read much more often than it's written. Readers never block the
+    // writer, instead they retry if a write happened while they were reading. T must be
+    // trivially copyable.
+    template<typename T>
+    struct SeqLock
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        explicit SeqLock(const char* name = nullptr)
+            : m_writeLock(name)
+        {}
+
+        SeqLock(SeqLock&&) = delete;
+        SeqLock& operator=(SeqLock&&) = delete;
+
+        T Load() const
+        {
+            T ret;
+
+            while (true)
+            {
+                const uint32_t begin = m_seq.load(std::memory_order_acquire);
+
+                // A write is in progress
+                if (begin & 0x1)
+                {
+                    _mm_pause();
+                    continue;
+                }
+
+                memcpy(&ret, &m_data, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (m_seq.load(std::memory_order_relaxed) == begin)
+                    return ret;
+            }
+        }
+
+        // Writers are serialized. Returns whatever fn returns.
+        template<typename F>
+        auto Update(F fn)
+        {
+            m_writeLock.Lock();
+            m_seq.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            if constexpr (std::is_void_v<decltype(fn(m_data))>)
+            {
+                fn(m_data);
+                m_seq.fetch_add(1, std::memory_order_release);
+                m_writeLock.Unlock();
+            }
+            else
+            {
+                auto ret = fn(m_data);
+                m_seq.fetch_add(1, std::memory_order_release);
+                m_writeLock.Unlock();
+
+                return ret;
+            }
+        }
+
+        void Store(const T& t)
+        {
+            Update([&t](T& data) { data = t; });
+        }
+
+    private:
+        Mutex m_writeLock;
+        std::atomic_uint32_t m_seq = 0;
+        T m_data = T();
+    };
+}
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "../App/ZetaRay.h"
+#ifdef _WIN32
 #include <malloc.h>
+#else
+#include "../Posix/Posix.h"
+#endif
 #include <concepts>
 
 namespace ZetaRay::Support
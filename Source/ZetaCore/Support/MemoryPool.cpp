@@ -1,7 +1,11 @@
 #include "MemoryPool.h"
 #include "../Utility/Error.h"
 #include "../Math/Common.h"
+#ifdef _WIN32
 #include <intrin.h>
+#else
+#include "../Posix/Posix.h"
+#endif
 #include <cstdio>
 #include <string.h>
 
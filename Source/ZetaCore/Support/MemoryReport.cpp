@@ -0,0 +1,193 @@
+#include "MemoryReport.h"
+#include "../App/Filesystem.h"
+#include "../Utility/Error.h"
+#include <string.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    template<typename... Args>
+    void AppendFormat(SmallVector<char>& out, const char* fmt, Args... args)
+    {
+        char buff[256];
+        const int n = stbsp_snprintf(buff, sizeof(buff), fmt, args...);
+        out.append_range(buff, buff + n);
+    }
+
+    // Names come from code, so only quotes and backslashes need to be escaped
+    void AppendJSONStr(SmallVector<char>& out, const char* str)
+    {
+        out.push_back('"');
+
+        for (const char* c = str; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                out.push_back('\\');
+
+            out.push_back(*c);
+        }
+
+        out.push_back('"');
+    }
+
+    ZetaInline void Copy(char* dst, const char* src, int maxLen)
+    {
+        const size_t n = Math::Min(strlen(src), (size_t)maxLen - 1);
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+
+    ZetaInline double ToKB(size_t bytes)
+    {
+        return (double)bytes / 1024.0;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// MemoryReport
+//--------------------------------------------------------------------------------------
+
+void MemoryReport::Add(const char* owner, const char* name, size_t numElements, size_t capacity,
+    size_t elementSize)
+{
+    Assert(numElements <= capacity, "Number of elements exceeds capacity.");
+
+    for (auto& c : m_containers)
+    {
+        if (strcmp(c.Owner, owner) == 0 && strcmp(c.Name, name) == 0)
+        {
+            Assert(c.ElementSize == elementSize, "Containers with the same name must have the same element size.");
+            c.NumElements += numElements;
+            c.Capacity += capacity;
+
+            return;
+        }
+    }
+
+    m_containers.emplace_back();
+    Container& c = m_containers.back();
+    Copy(c.Owner, owner, MAX_OWNER_LEN);
+    Copy(c.Name, name, MAX_NAME_LEN);
+    c.NumElements = numElements;
+    c.Capacity = capacity;
+    c.ElementSize = elementSize;
+}
+
+const MemoryReport::Container* MemoryReport::Find(const char* owner, const char* name) const
+{
+    for (auto& c : m_containers)
+    {
+        if (strcmp(c.Owner, owner) == 0 && strcmp(c.Name, name) == 0)
+            return &c;
+    }
+
+    return nullptr;
+}
+
+MemoryReport::OwnerTotals MemoryReport::Totals(const char* owner) const
+{
+    OwnerTotals ret;
+
+    for (auto& c : m_containers)
+    {
+        if (owner && strcmp(c.Owner, owner) != 0)
+            continue;
+
+        ret.UsedBytes += c.UsedBytes();
+        ret.ReservedBytes += c.ReservedBytes();
+        ret.NumContainers++;
+    }
+
+    return ret;
+}
+
+bool MemoryReport::IsFirstOfOwner(size_t i) const
+{
+    for (size_t j = 0; j < i; j++)
+    {
+        if (strcmp(m_containers[j].Owner, m_containers[i].Owner) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+void MemoryReport::Print(SmallVector<char>& out) const
+{
+    AppendFormat(out, "%-*s %-*s %12s %12s %12s %14s\n", MAX_OWNER_LEN - 1, "Owner", MAX_NAME_LEN - 1,
+        "Container", "Elements", "Capacity", "Used (KB)", "Reserved (KB)");
+
+    for (auto& c : m_containers)
+    {
+        AppendFormat(out, "%-*s %-*s %12zu %12zu %12.1f %14.1f\n", MAX_OWNER_LEN - 1, c.Owner, MAX_NAME_LEN - 1,
+            c.Name, c.NumElements, c.Capacity, ToKB(c.UsedBytes()), ToKB(c.ReservedBytes()));
+    }
+
+    out.push_back('\n');
+
+    // Owners in the order they first appear
+    for (size_t i = 0; i < m_containers.size(); i++)
+    {
+        if (!IsFirstOfOwner(i))
+            continue;
+
+        const char* owner = m_containers[i].Owner;
+        const OwnerTotals t = Totals(owner);
+        AppendFormat(out, "%-*s %-*s %12s %12s %12.1f %14.1f\n", MAX_OWNER_LEN - 1, owner, MAX_NAME_LEN - 1,
+            "(total)", "", "", ToKB(t.UsedBytes), ToKB(t.ReservedBytes));
+    }
+
+    const OwnerTotals t = Totals();
+    AppendFormat(out, "%-*s %-*s %12s %12s %12.1f %14.1f\n", MAX_OWNER_LEN - 1, "Total", MAX_NAME_LEN - 1,
+        "", "", "", ToKB(t.UsedBytes), ToKB(t.ReservedBytes));
+}
+
+void MemoryReport::ToJSON(SmallVector<char>& out) const
+{
+    const OwnerTotals total = Totals();
+    AppendFormat(out, "{\"usedBytes\": %zu, \"reservedBytes\": %zu, \"owners\": [", total.UsedBytes,
+        total.ReservedBytes);
+
+    bool first = true;
+
+    for (size_t i = 0; i < m_containers.size(); i++)
+    {
+        if (!IsFirstOfOwner(i))
+            continue;
+
+        const char* owner = m_containers[i].Owner;
+        const OwnerTotals t = Totals(owner);
+        AppendFormat(out, "%s{\"owner\": ", first ? "" : ", ");
+        AppendJSONStr(out, owner);
+        AppendFormat(out, ", \"usedBytes\": %zu, \"reservedBytes\": %zu}", t.UsedBytes, t.ReservedBytes);
+        first = false;
+    }
+
+    AppendFormat(out, "], \"containers\": [");
+
+    for (size_t i = 0; i < m_containers.size(); i++)
+    {
+        const Container& c = m_containers[i];
+
+        AppendFormat(out, "%s{\"owner\": ", i == 0 ? "" : ", ");
+        AppendJSONStr(out, c.Owner);
+        AppendFormat(out, ", \"name\": ");
+        AppendJSONStr(out, c.Name);
+        AppendFormat(out, ", \"numElements\": %zu, \"capacity\": %zu, \"elementSize\": %zu, "
+            "\"usedBytes\": %zu, \"reservedBytes\": %zu}", c.NumElements, c.Capacity, c.ElementSize,
+            c.UsedBytes(), c.ReservedBytes());
+    }
+
+    AppendFormat(out, "]}");
+}
+
+void MemoryReport::WriteJSON(const char* path) const
+{
+    SmallVector<char> json;
+    ToJSON(json);
+
+    App::Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(json.data()), (uint32_t)json.size());
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../Utility/HashTable.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    //--------------------------------------------------------------------------------------
+    // MemoryReport: CPU memory of a set of containers, grouped by the object that owns
+    // them (e.g. SceneCore or MeshContainer).
+    //
+    //  - Used is the size of the elements, reserved the size of the allocated capacity (for
+    //    hash tables, every bucket). Their difference is slack that could be reclaimed by
+    //    shrinking.
+    //  - Containers are identified by (owner, name). Adding one that already exists merges
+    //    the two, e.g. the same array of every scene graph level.
+    //  - Storage is kept across Clear(), so that a report can be rebuilt every frame
+    //    without allocating.
+    //--------------------------------------------------------------------------------------
+
+    struct MemoryReport
+    {
+        static constexpr int MAX_OWNER_LEN = 24;
+        static constexpr int MAX_NAME_LEN = 48;
+
+        struct Container
+        {
+            ZetaInline size_t UsedBytes() const { return NumElements * ElementSize; }
+            ZetaInline size_t ReservedBytes() const { return Capacity * ElementSize; }
+
+            char Owner[MAX_OWNER_LEN];
+            char Name[MAX_NAME_LEN];
+            size_t NumElements;
+            size_t Capacity;
+            size_t ElementSize;
+        };
+
+        struct OwnerTotals
+        {
+            size_t UsedBytes = 0;
+            size_t ReservedBytes = 0;
+            size_t NumContainers = 0;
+        };
+
+        MemoryReport() = default;
+        ~MemoryReport() = default;
+
+        MemoryReport(MemoryReport&&) = delete;
+        MemoryReport& operator=(MemoryReport&&) = delete;
+
+        void Clear() { m_containers.clear(); }
+
+        void Add(const char* owner, const char* name, size_t numElements, size_t capacity, size_t elementSize);
+        template<typename T, AllocatorType Allocator>
+        ZetaInline void Add(const char* owner, const char* name, const Util::Vector<T, Allocator>& v)
+        {
+            Add(owner, name, v.size(), v.capacity(), sizeof(T));
+        }
+        template<typename V, typename K, AllocatorType Allocator>
+        ZetaInline void Add(const char* owner, const char* name, const Util::HashTable<V, K, Allocator>& t)
+        {
+            Add(owner, name, t.size(), t.bucket_count(), sizeof(typename Util::HashTable<V, K, Allocator>::Entry));
+        }
+
+        // In the order they were first added
+        ZetaInline Util::Span<Container> Containers() const { return m_containers; }
+        // nullptr if there's no such container
+        const Container* Find(const char* owner, const char* name) const;
+        // Totals over every container of the given owner, or every container if owner is
+        // nullptr
+        OwnerTotals Totals(const char* owner = nullptr) const;
+        // Whether container i is the first one of its owner, for visiting every owner once
+        bool IsFirstOfOwner(size_t i) const;
+
+        // Appends a table with one row per container followed by the per-owner totals
+        void Print(Util::SmallVector<char>& out) const;
+        // Appends a JSON object:
+        //  {"usedBytes": ..., "reservedBytes": ...,
+        //   "owners": [{"owner": ..., "usedBytes": ..., "reservedBytes": ...}, ...],
+        //   "containers": [{"owner": ..., "name": ..., "numElements": ..., "capacity": ...,
+        //      "elementSize": ..., "usedBytes": ..., "reservedBytes": ...}, ...]}
+        void ToJSON(Util::SmallVector<char>& out) const;
+        void WriteJSON(const char* path) const;
+
+    private:
+        Util::SmallVector<Container> m_containers;
+    };
+}
\ No newline at end of file
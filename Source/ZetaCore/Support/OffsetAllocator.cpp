@@ -1,7 +1,11 @@
 #include "OffsetAllocator.h"
 #include "../Utility/Error.h"
 #include "../Math/Common.h"
+#ifdef _WIN32
 #include <intrin.h>
+#else
+#include "../Posix/Posix.h"
+#endif
 #include <concepts>
 
 using namespace ZetaRay::Support;
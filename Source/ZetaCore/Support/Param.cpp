@@ -40,18 +40,30 @@ void ParamVariant::InitCommon(const char* group, const char* subgroup,
     memcpy(m_name, name, lenName);
     m_name[lenName] = '\0';
 
+    m_id = ComputeID(m_group, m_subgroup, m_name);
+}
+
+uint64_t ParamVariant::ComputeID(const char* group, const char* subgroup, const char* name)
+{
+    const size_t lenGroup = Min((int)strlen(group), (MAX_GROUP_LEN - 1));
+    const size_t lenSubgroup = Min((int)strlen(subgroup), (MAX_SUBGROUP_LEN - 1));
+    const size_t lenName = Min((int)strlen(name), (MAX_NAME_LEN - 1));
+
     constexpr int BUFF_SIZE = ParamVariant::MAX_GROUP_LEN + ParamVariant::MAX_SUBGROUP_LEN + 
         ParamVariant::MAX_NAME_LEN;
     char buff[BUFF_SIZE];
     size_t ptr = 0;
 
+    // Separators so that e.g. ("ab", "c") and ("a", "bc") don't collide
     memcpy(buff, group, lenGroup);
     ptr += lenGroup;
+    buff[ptr++] = '/';
     memcpy(buff + ptr, subgroup, lenSubgroup);
     ptr += lenSubgroup;
+    buff[ptr++] = '/';
     memcpy(buff + ptr, name, lenName);
 
-    m_id = XXH3_64bits(buff, ptr + lenName);
+    return XXH3_64bits(buff, ptr + lenName);
 }
 
 void ParamVariant::InitFloat(const char* group, const char* subgroup, const char* name, 
@@ -216,6 +216,9 @@ namespace ZetaRay::Support
         const char* GetName() const { return m_name; }
         PARAM_TYPE GetType() const { return m_type; }
         uint64_t ID() const { return m_id; }
+        // Same as ID() of a param with the given group, subgroup and name (subsubgroup 
+        // isn't part of the ID)
+        static uint64_t ComputeID(const char* group, const char* subgroup, const char* name);
 
         const FloatParam& GetFloat() const;
         void SetFloat(float v);
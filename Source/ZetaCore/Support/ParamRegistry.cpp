@@ -0,0 +1,477 @@
+#include "ParamRegistry.h"
+#include "../App/Filesystem.h"
+#include "../App/Log.h"
+#include "../Math/Common.h"
+#include <algorithm>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    ZetaInline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    // Returns the [beg, end) range of str without the leading and trailing whitespace
+    ZetaInline void Trim(const char*& beg, const char*& end)
+    {
+        while (beg < end && IsSpace(*beg))
+            beg++;
+        while (end > beg && IsSpace(*(end - 1)))
+            end--;
+    }
+
+    ZetaInline bool CopyToken(const char* beg, const char* end, char* dst, size_t dstSize)
+    {
+        Trim(beg, end);
+        const size_t n = end - beg;
+        if (n == 0 || n >= dstSize)
+            return false;
+
+        memcpy(dst, beg, n);
+        dst[n] = '\0';
+
+        return true;
+    }
+
+    // Parses up to n floats separated by whitespace or commas, returns how many were read
+    int ParseFloats(const char* str, float* vals, int n)
+    {
+        int i = 0;
+
+        while (i < n)
+        {
+            while (*str && (IsSpace(*str) || *str == ','))
+                str++;
+
+            if (*str == '\0')
+                break;
+
+            char* end;
+            vals[i] = strtof(str, &end);
+            if (end == str)
+                return -1;
+
+            str = end;
+            i++;
+        }
+
+        // Anything left over is an error
+        while (*str && (IsSpace(*str) || *str == ','))
+            str++;
+
+        return *str == '\0' ? i : -1;
+    }
+
+    ZetaInline void ClampAll(float* vals, int n, float min, float max)
+    {
+        for (int i = 0; i < n; i++)
+            vals[i] = Min(Max(vals[i], min), max);
+    }
+
+    // Case-insensitive
+    bool Equal(const char* a, const char* b)
+    {
+        while (*a && *b && tolower(*a) == tolower(*b))
+        {
+            a++;
+            b++;
+        }
+
+        return *a == *b;
+    }
+
+    int CompareParams(const ParamVariant& p1, const ParamVariant& p2)
+    {
+        int c = strcmp(p1.GetGroup(), p2.GetGroup());
+        if (c != 0)
+            return c;
+
+        c = strcmp(p1.GetSubGroup(), p2.GetSubGroup());
+        if (c != 0)
+            return c;
+
+        c = strcmp(p1.GetSubSubGroup(), p2.GetSubSubGroup());
+        if (c != 0)
+            return c;
+
+        return strcmp(p1.GetName(), p2.GetName());
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// ParamRegistry
+//--------------------------------------------------------------------------------------
+
+void ParamRegistry::Add(const ParamVariant& p)
+{
+    m_updateLock.Lock();
+
+    m_updates.push_back(Update{ .ID = p.ID(),
+        .Idx = (uint32_t)m_pendingParams.size(),
+        .Op = OP::ADD });
+    m_pendingParams.push_back(p);
+
+    m_updateLock.Unlock();
+}
+
+void ParamRegistry::TryAdd(const ParamVariant& p)
+{
+    m_updateLock.Lock();
+
+    m_updates.push_back(Update{ .ID = p.ID(),
+        .Idx = (uint32_t)m_pendingParams.size(),
+        .Op = OP::TRY_ADD });
+    m_pendingParams.push_back(p);
+
+    m_updateLock.Unlock();
+}
+
+void ParamRegistry::Remove(const char* group, const char* subgroup, const char* name)
+{
+    const uint64_t id = ParamVariant::ComputeID(group, subgroup, name);
+
+    m_updateLock.Lock();
+    m_updates.push_back(Update{ .ID = id, .Idx = 0, .Op = OP::REMOVE });
+    m_updateLock.Unlock();
+}
+
+void ParamRegistry::SetValue(const char* group, const char* subgroup, const char* name,
+    const char* value)
+{
+    PendingValue v;
+    stbsp_snprintf(v.Path, MAX_PATH_LEN, "%s/%s/%s", group, subgroup, name);
+
+    const size_t n = strlen(value);
+    Check(n < MAX_VALUE_LEN, "Value %s for param %s is too long.", value, v.Path);
+    memcpy(v.Value, value, n + 1);
+
+    const uint64_t id = ParamVariant::ComputeID(group, subgroup, name);
+
+    m_updateLock.Lock();
+
+    m_updates.push_back(Update{ .ID = id,
+        .Idx = (uint32_t)m_pendingValues.size(),
+        .Op = OP::SET_VALUE });
+    m_pendingValues.push_back(v);
+
+    m_updateLock.Unlock();
+}
+
+bool ParamRegistry::SetValues(const char* text, size_t len)
+{
+    const char* curr = text;
+    const char* textEnd = text + len;
+    int lineNum = 0;
+    bool success = true;
+
+    while (curr < textEnd)
+    {
+        const char* lineEnd = curr;
+        while (lineEnd < textEnd && *lineEnd != '\n')
+            lineEnd++;
+
+        const char* next = lineEnd < textEnd ? lineEnd + 1 : lineEnd;
+        lineNum++;
+
+        // Skip comments
+        const char* comment = (const char*)memchr(curr, '#', lineEnd - curr);
+        if (comment)
+            lineEnd = comment;
+
+        const char* beg = curr;
+        const char* end = lineEnd;
+        Trim(beg, end);
+        curr = next;
+
+        if (beg == end)
+            continue;
+
+        const char* eq = (const char*)memchr(beg, '=', end - beg);
+        const char* slash1 = eq ? (const char*)memchr(beg, '/', eq - beg) : nullptr;
+        const char* slash2 = slash1 ? (const char*)memchr(slash1 + 1, '/', eq - slash1 - 1) : nullptr;
+
+        char group[ParamVariant::MAX_GROUP_LEN];
+        char subgroup[ParamVariant::MAX_SUBGROUP_LEN];
+        char name[ParamVariant::MAX_NAME_LEN];
+        char value[MAX_VALUE_LEN];
+
+        if (!slash2 ||
+            !CopyToken(beg, slash1, group, sizeof(group)) ||
+            !CopyToken(slash1 + 1, slash2, subgroup, sizeof(subgroup)) ||
+            !CopyToken(slash2 + 1, eq, name, sizeof(name)) ||
+            !CopyToken(eq + 1, end, value, sizeof(value)))
+        {
+            LOG_UI_WARNING("Line %d: expected \"group/subgroup/name = value\".", lineNum);
+            success = false;
+
+            continue;
+        }
+
+        SetValue(group, subgroup, name, value);
+    }
+
+    return success;
+}
+
+bool ParamRegistry::SetValuesFromFile(const char* path)
+{
+    if (!App::Filesystem::Exists(path))
+    {
+        LOG_UI_WARNING("Param file %s was not found.", path);
+        return false;
+    }
+
+    SmallVector<uint8_t> text;
+    App::Filesystem::LoadFromFile(path, text);
+
+    return SetValues(reinterpret_cast<const char*>(text.data()), text.size());
+}
+
+int ParamRegistry::ApplyUpdates()
+{
+    // Take the queued updates, so that threads that queue more aren't blocked while these
+    // are applied
+    SmallVector<Update> updates;
+    SmallVector<ParamVariant> pendingParams;
+    SmallVector<PendingValue> pendingValues;
+
+    m_updateLock.Lock();
+    updates.swap(m_updates);
+    pendingParams.swap(m_pendingParams);
+    pendingValues.swap(m_pendingValues);
+    m_updateLock.Unlock();
+
+    if (updates.empty())
+        return 0;
+
+    // Removed params are only marked here and compacted at the end
+    SmallVector<bool> removed;
+    removed.resize(m_params.size(), false);
+    bool membershipChanged = false;
+    int numFailed = 0;
+
+    for (auto& u : updates)
+    {
+        auto idx = m_index.find(u.ID);
+        const bool exists = idx && !removed[*idx.value()];
+
+        switch (u.Op)
+        {
+        case OP::ADD:
+        case OP::TRY_ADD:
+            if (idx)
+            {
+                const uint32_t i = *idx.value();
+
+                if (u.Op == OP::ADD || removed[i])
+                    m_params[i] = pendingParams[u.Idx];
+
+                removed[i] = false;
+            }
+            else
+            {
+                m_index.insert_or_assign(u.ID, (uint32_t)m_params.size());
+                m_params.push_back(pendingParams[u.Idx]);
+                removed.push_back(false);
+                membershipChanged = true;
+            }
+            break;
+
+        case OP::REMOVE:
+            if (exists)
+            {
+                removed[*idx.value()] = true;
+                membershipChanged = true;
+            }
+            break;
+
+        case OP::SET_VALUE:
+        {
+            const PendingValue& v = pendingValues[u.Idx];
+
+            if (!exists)
+            {
+                LOG_UI_WARNING("Param %s was not found.", v.Path);
+                numFailed++;
+            }
+            else if (!ParseValue(m_params[*idx.value()], v.Value))
+            {
+                LOG_UI_WARNING("Invalid value \"%s\" for param %s.", v.Value, v.Path);
+                numFailed++;
+            }
+        }
+        break;
+
+        default:
+            break;
+        }
+    }
+
+    if (membershipChanged)
+    {
+        size_t next = 0;
+
+        for (size_t i = 0; i < m_params.size(); i++)
+        {
+            if (removed[i])
+                continue;
+
+            if (next != i)
+                m_params[next] = m_params[i];
+
+            next++;
+        }
+
+        m_params.resize(next);
+
+        std::sort(m_params.begin(), m_params.end(), [](const ParamVariant& p1, const ParamVariant& p2)
+            {
+                return CompareParams(p1, p2) < 0;
+            });
+
+        m_index.clear();
+        m_index.resize(m_params.size(), true);
+
+        for (size_t i = 0; i < m_params.size(); i++)
+            m_index.insert_or_assign(m_params[i].ID(), (uint32_t)i);
+    }
+
+    return numFailed;
+}
+
+int ParamRegistry::FormatValue(const ParamVariant& p, char* buff, int size)
+{
+    // 9 significant digits are enough for a float to survive the round trip
+    switch (p.GetType())
+    {
+    case PARAM_TYPE::PT_float:
+        return stbsp_snprintf(buff, size, "%.9g", p.GetFloat().m_value);
+    case PARAM_TYPE::PT_float2:
+    {
+        const float2 v = p.GetFloat2().m_value;
+        return stbsp_snprintf(buff, size, "%.9g %.9g", v.x, v.y);
+    }
+    case PARAM_TYPE::PT_float3:
+    case PARAM_TYPE::PT_color:
+    {
+        const float3 v = p.GetType() == PARAM_TYPE::PT_float3 ? p.GetFloat3().m_value : p.GetColor().m_value;
+        return stbsp_snprintf(buff, size, "%.9g %.9g %.9g", v.x, v.y, v.z);
+    }
+    case PARAM_TYPE::PT_unit_dir:
+        return stbsp_snprintf(buff, size, "%.9g %.9g", p.GetUnitDir().m_pitch, p.GetUnitDir().m_yaw);
+    case PARAM_TYPE::PT_int:
+        return stbsp_snprintf(buff, size, "%d", p.GetInt().m_value);
+    case PARAM_TYPE::PT_bool:
+        return stbsp_snprintf(buff, size, "%s", p.GetBool() ? "true" : "false");
+    case PARAM_TYPE::PT_enum:
+        return stbsp_snprintf(buff, size, "%d", p.GetEnum().m_curr);
+    default:
+        buff[0] = '\0';
+        return 0;
+    }
+}
+
+bool ParamRegistry::ParseValue(ParamVariant& p, const char* value)
+{
+    float vals[3];
+
+    switch (p.GetType())
+    {
+    case PARAM_TYPE::PT_float:
+    {
+        if (ParseFloats(value, vals, 1) != 1)
+            return false;
+
+        const FloatParam& f = p.GetFloat();
+        p.SetFloat(Min(Max(vals[0], f.m_min), f.m_max));
+        return true;
+    }
+    case PARAM_TYPE::PT_float2:
+    {
+        if (ParseFloats(value, vals, 2) != 2)
+            return false;
+
+        const Float2Param& f = p.GetFloat2();
+        ClampAll(vals, 2, f.m_min, f.m_max);
+        p.SetFloat2(float2(vals[0], vals[1]));
+        return true;
+    }
+    case PARAM_TYPE::PT_float3:
+    {
+        if (ParseFloats(value, vals, 3) != 3)
+            return false;
+
+        const Float3Param& f = p.GetFloat3();
+        ClampAll(vals, 3, f.m_min, f.m_max);
+        p.SetFloat3(float3(vals[0], vals[1], vals[2]));
+        return true;
+    }
+    case PARAM_TYPE::PT_color:
+    {
+        if (ParseFloats(value, vals, 3) != 3)
+            return false;
+
+        const Float3Param& f = p.GetColor();
+        ClampAll(vals, 3, f.m_min, f.m_max);
+        p.SetColor(float3(vals[0], vals[1], vals[2]));
+        return true;
+    }
+    case PARAM_TYPE::PT_unit_dir:
+        if (ParseFloats(value, vals, 2) != 2)
+            return false;
+
+        p.SetUnitDir(Min(Max(vals[0], 0.0f), PI), Min(Max(vals[1], 0.0f), TWO_PI));
+        return true;
+    case PARAM_TYPE::PT_int:
+    {
+        char* end;
+        const long v = strtol(value, &end, 10);
+        if (end == value || *end != '\0')
+            return false;
+
+        const IntParam& i = p.GetInt();
+        p.SetInt(Min(Max((int)v, i.m_min), i.m_max));
+        return true;
+    }
+    case PARAM_TYPE::PT_bool:
+        if (Equal(value, "true") || Equal(value, "on") || strcmp(value, "1") == 0)
+            p.SetBool(true);
+        else if (Equal(value, "false") || Equal(value, "off") || strcmp(value, "0") == 0)
+            p.SetBool(false);
+        else
+            return false;
+
+        return true;
+    case PARAM_TYPE::PT_enum:
+    {
+        const EnumParam& e = p.GetEnum();
+
+        for (int i = 0; i < e.m_num; i++)
+        {
+            if (Equal(value, e.m_values[i]))
+            {
+                p.SetEnum(i);
+                return true;
+            }
+        }
+
+        char* end;
+        const long v = strtol(value, &end, 10);
+        if (end == value || *end != '\0' || v < 0 || v >= e.m_num)
+            return false;
+
+        p.SetEnum((int)v);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
\ No newline at end of file
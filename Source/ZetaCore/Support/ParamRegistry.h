@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Param.h"
+#include "Lock.h"
+#include "../Utility/HashTable.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    //--------------------------------------------------------------------------------------
+    // ParamRegistry: Stores the params sorted by (group, subgroup, subsubgroup, name) in a
+    // dense array, with a hash table from param ID to its index.
+    //
+    //  - Adds, removes and value changes can be queued from any thread and are applied
+    //    together, in order, by ApplyUpdates() (once per frame). Changes in membership
+    //    re-sort the params and rebuild the index once per call rather than per update.
+    //  - Lookups don't take a lock. Returned pointers (and the order of Params()) stay
+    //    valid until the next ApplyUpdates(), which must not run concurrently with them.
+    //  - Values can be set from text, one "group/subgroup/name = value" per line, e.g. for
+    //    automated parameter sweeps (see SetValue() for the value syntax).
+    //--------------------------------------------------------------------------------------
+
+    struct ParamRegistry
+    {
+        static constexpr int MAX_VALUE_LEN = 64;
+        static constexpr int MAX_PATH_LEN = ParamVariant::MAX_GROUP_LEN +
+            ParamVariant::MAX_SUBGROUP_LEN + ParamVariant::MAX_NAME_LEN;
+
+        ParamRegistry() = default;
+        ~ParamRegistry() = default;
+
+        ParamRegistry(ParamRegistry&&) = delete;
+        ParamRegistry& operator=(ParamRegistry&&) = delete;
+
+        // Replaces the param with the same ID, if any. Thread-safe.
+        void Add(const ParamVariant& p);
+        // Ignored if a param with the same ID already exists. Thread-safe.
+        void TryAdd(const ParamVariant& p);
+        // Thread-safe.
+        void Remove(const char* group, const char* subgroup, const char* name);
+        // Value is parsed according to the param's type when the update is applied:
+        //  - float, int: a number
+        //  - float2, float3, color: two or three numbers separated by spaces or commas
+        //  Numbers are clamped to the param's range.
+        //  - unit direction: pitch and yaw in radians
+        //  - bool: true/false, on/off or 1/0
+        //  - enum: index or one of the enum's values
+        // Thread-safe.
+        void SetValue(const char* group, const char* subgroup, const char* name, const char* value);
+        // Queues a SetValue() for every "group/subgroup/name = value" line. Empty lines and
+        // text after '#' are ignored. Returns false if any line was malformed, the other
+        // lines are still queued. Thread-safe.
+        bool SetValues(const char* text, size_t len);
+        bool SetValuesFromFile(const char* path);
+        // Writes the param's value in the syntax of SetValue(), such that setting it back
+        // results in the same value. Returns the length of the string.
+        static int FormatValue(const ParamVariant& p, char* buff, int size);
+
+        // Applies the queued updates. Returns the number of value changes that failed (unknown
+        // param or invalid value).
+        int ApplyUpdates();
+
+        ZetaInline ParamVariant* Find(uint64_t id)
+        {
+            auto idx = m_index.find(id);
+            return idx ? &m_params[*idx.value()] : nullptr;
+        }
+        ZetaInline ParamVariant* Find(const char* group, const char* subgroup, const char* name)
+        {
+            return Find(ParamVariant::ComputeID(group, subgroup, name));
+        }
+        // Sorted by (group, subgroup, subsubgroup, name). Values can be changed, but the
+        // params must not be reordered.
+        ZetaInline Util::MutableSpan<ParamVariant> Params() { return m_params; }
+        ZetaInline size_t NumParams() const { return m_params.size(); }
+
+    private:
+        enum class OP : uint8_t
+        {
+            ADD,
+            TRY_ADD,
+            REMOVE,
+            SET_VALUE
+        };
+
+        struct Update
+        {
+            uint64_t ID;
+            // Index into m_pendingParams or m_pendingValues
+            uint32_t Idx;
+            OP Op;
+        };
+
+        struct PendingValue
+        {
+            // For error messages
+            char Path[MAX_PATH_LEN];
+            char Value[MAX_VALUE_LEN];
+        };
+
+        static bool ParseValue(ParamVariant& p, const char* value);
+
+        Util::SmallVector<ParamVariant> m_params;
+        Util::HashTable<uint32_t> m_index;
+
+        Util::SmallVector<Update> m_updates;
+        Util::SmallVector<ParamVariant> m_pendingParams;
+        Util::SmallVector<PendingValue> m_pendingValues;
+        Mutex m_updateLock{ "Param updates" };
+    };
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "PipelineCacheIndex.h"
+#include <string.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+//--------------------------------------------------------------------------------------
+// PipelineCacheIndex
+//--------------------------------------------------------------------------------------
+
+PipelineCacheIndex::PipelineCacheIndex(size_t numPSOs)
+{
+    m_entries.resize(numPSOs);
+    Clear();
+}
+
+void PipelineCacheIndex::Clear()
+{
+    memset(m_entries.data(), 0, m_entries.size() * sizeof(PsoEntry));
+    m_numLibraryPSOs.store(0, std::memory_order_relaxed);
+}
+
+bool PipelineCacheIndex::Load(Span<const uint8_t> data)
+{
+    Clear();
+
+    if (data.size() < sizeof(IndexHeader))
+        return false;
+
+    IndexHeader header;
+    memcpy(&header, data.data(), sizeof(IndexHeader));
+
+    if (header.Magic != INDEX_MAGIC || header.Version != INDEX_VERSION ||
+        data.size() != sizeof(IndexHeader) + header.NumEntries * sizeof(IndexEntry))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.NumEntries; i++)
+    {
+        IndexEntry e;
+        memcpy(&e, data.data() + sizeof(IndexHeader) + i * sizeof(IndexEntry), sizeof(IndexEntry));
+
+        // Number of PSOs may have changed since the index was written
+        if (e.PsoIdx >= m_entries.size())
+            continue;
+
+        PsoEntry& entry = m_entries[e.PsoIdx];
+        entry.Key = e.Key;
+        entry.InLibrary = e.InLibrary;
+        memcpy(entry.PathToCompiledCS, e.PathToCompiledCS, MAX_PATH_LEN);
+        entry.PathToCompiledCS[MAX_PATH_LEN - 1] = '\0';
+    }
+
+    m_numLibraryPSOs.store(header.NumLibraryPSOs, std::memory_order_relaxed);
+
+    return true;
+}
+
+void PipelineCacheIndex::Serialize(SmallVector<uint8_t>& out) const
+{
+    m_lock.LockShared();
+
+    uint32_t numEntries = 0;
+    for (auto& e : m_entries)
+        numEntries += e.Key != 0;
+
+    out.resize(sizeof(IndexHeader) + numEntries * sizeof(IndexEntry));
+
+    IndexHeader header{ .Magic = INDEX_MAGIC,
+        .Version = INDEX_VERSION,
+        .NumEntries = numEntries,
+        .NumLibraryPSOs = m_numLibraryPSOs.load(std::memory_order_relaxed) };
+    memcpy(out.data(), &header, sizeof(IndexHeader));
+
+    uint8_t* curr = out.data() + sizeof(IndexHeader);
+
+    for (int i = 0; i < (int)m_entries.size(); i++)
+    {
+        if (m_entries[i].Key == 0)
+            continue;
+
+        IndexEntry e{ .Key = m_entries[i].Key,
+            .PsoIdx = (uint16_t)i,
+            .InLibrary = m_entries[i].InLibrary };
+        memcpy(e.PathToCompiledCS, m_entries[i].PathToCompiledCS, MAX_PATH_LEN);
+
+        memcpy(curr, &e, sizeof(IndexEntry));
+        curr += sizeof(IndexEntry);
+    }
+
+    m_lock.UnlockShared();
+}
+
+PipelineCacheIndex::ACQUIRE PipelineCacheIndex::Acquire(uint32_t idx, uint64_t key)
+{
+    Assert(idx < m_entries.size(), "Invalid PSO index.");
+    std::atomic_ref state(m_entries[idx].State);
+    uint32_t s = state.load(std::memory_order_acquire);
+
+    while (true)
+    {
+        if (s == PSO_STATE::EMPTY)
+        {
+            if (state.compare_exchange_weak(s, PSO_STATE::COMPILING, std::memory_order_acquire))
+                return ACQUIRE::COMPILE;
+
+            continue;
+        }
+
+        // Being compiled by some other thread
+        if (s == PSO_STATE::COMPILING)
+        {
+            state.wait(PSO_STATE::COMPILING, std::memory_order_acquire);
+            s = state.load(std::memory_order_acquire);
+
+            continue;
+        }
+
+        // Key is only modified before the PSO is published, which happens-before the load above
+        if (m_entries[idx].Key == key)
+            return ACQUIRE::HIT;
+
+        if (state.compare_exchange_weak(s, PSO_STATE::COMPILING, std::memory_order_acquire))
+            return ACQUIRE::STALE;
+    }
+}
+
+bool PipelineCacheIndex::TryClaim(uint32_t idx)
+{
+    Assert(idx < m_entries.size(), "Invalid PSO index.");
+    std::atomic_ref state(m_entries[idx].State);
+    uint32_t expected = PSO_STATE::EMPTY;
+
+    return state.compare_exchange_strong(expected, PSO_STATE::COMPILING, std::memory_order_acquire);
+}
+
+void PipelineCacheIndex::Publish(uint32_t idx, uint64_t key, bool inLibrary, const char* pathToCompiledCS)
+{
+    Assert(idx < m_entries.size(), "Invalid PSO index.");
+
+    m_lock.LockExclusive();
+
+    PsoEntry& entry = m_entries[idx];
+    entry.Key = key;
+    entry.InLibrary = inLibrary;
+
+    // Paths that don't fit are left out of the index, which means they won't be warmed up
+    const size_t len = pathToCompiledCS ? strlen(pathToCompiledCS) : MAX_PATH_LEN;
+    if (len < MAX_PATH_LEN)
+        memcpy(entry.PathToCompiledCS, pathToCompiledCS, len + 1);
+    else
+        entry.PathToCompiledCS[0] = '\0';
+
+    m_lock.UnlockExclusive();
+
+    std::atomic_ref state(entry.State);
+    state.store(PSO_STATE::COMPILED, std::memory_order_release);
+    state.notify_all();
+}
+
+bool PipelineCacheIndex::HasWarmUpWork() const
+{
+    for (auto& e : m_entries)
+    {
+        if (e.Key != 0 && e.PathToCompiledCS[0] != '\0')
+            return true;
+    }
+
+    return false;
+}
+
+bool PipelineCacheIndex::NeedsWarmUp(uint32_t idx, char (&pathToCompiledCS)[MAX_PATH_LEN]) const
+{
+    Assert(idx < m_entries.size(), "Invalid PSO index.");
+
+    m_lock.LockShared();
+    memcpy(pathToCompiledCS, m_entries[idx].PathToCompiledCS, MAX_PATH_LEN);
+    m_lock.UnlockShared();
+
+    std::atomic_ref state(const_cast<uint32_t&>(m_entries[idx].State));
+
+    return pathToCompiledCS[0] != '\0' && state.load(std::memory_order_acquire) == PSO_STATE::EMPTY;
+}
+
+void PipelineCacheIndex::OnLibraryReset()
+{
+    m_lock.LockExclusive();
+
+    for (auto& e : m_entries)
+        e.InLibrary = false;
+
+    m_lock.UnlockExclusive();
+
+    m_numLibraryPSOs.store(0, std::memory_order_relaxed);
+}
+
+void PipelineCacheIndex::SetInLibrary(uint32_t idx, bool inLibrary)
+{
+    Assert(idx < m_entries.size(), "Invalid PSO index.");
+
+    m_lock.LockExclusive();
+    m_entries[idx].InLibrary = inLibrary;
+    m_lock.UnlockExclusive();
+}
+
+uint32_t PipelineCacheIndex::NumStale() const
+{
+    uint32_t numInLibrary = 0;
+
+    m_lock.LockShared();
+
+    for (auto& e : m_entries)
+        numInLibrary += e.InLibrary;
+
+    m_lock.UnlockShared();
+
+    const uint32_t numLibraryPSOs = m_numLibraryPSOs.load(std::memory_order_relaxed);
+
+    return numLibraryPSOs > numInLibrary ? numLibraryPSOs - numInLibrary : 0;
+}
+
+bool PipelineCacheIndex::TooManyStale(uint32_t numInUse) const
+{
+    return NumStale() > Math::Max(MIN_NUM_STALE_BEFORE_REBUILD, numInUse);
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Lock.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+#include <atomic>
+
+namespace ZetaRay::Support
+{
+    // Bookkeeping for a cache of pipeline state objects (see Core::PipelineStateLibrary).
+    // Independent of D3D12 -- the caller compiles the PSOs and stores them.
+    //
+    //  - Every PSO slot has a key (hash of its contents), which decides whether a cached PSO
+    //    can be reused (Acquire()). Each slot is compiled by one thread, others wait for it.
+    //  - PSOs that have been replaced by one with a different key stay in the serialized
+    //    library as stale entries until it's rebuilt (TooManyStale()).
+    //  - (slot, key, whether it's in the library, path to compiled shader) of every known PSO
+    //    can be serialized, so that the slots can be compiled ahead of time on next run.
+    class PipelineCacheIndex
+    {
+    public:
+        static constexpr int MAX_PATH_LEN = 52;
+        // Library is rebuilt when number of stale PSOs exceeds max(this, #PSOs in use)
+        static constexpr uint32_t MIN_NUM_STALE_BEFORE_REBUILD = 16;
+
+        enum class ACQUIRE
+        {
+            // Caller must compile the PSO and then call Publish()
+            COMPILE,
+            // Already compiled with the same key
+            HIT,
+            // Compiled with a different key. Caller must compile the PSO and then call
+            // Publish(), after which the old PSO can be released.
+            STALE
+        };
+
+        explicit PipelineCacheIndex(size_t numPSOs);
+        ~PipelineCacheIndex() = default;
+
+        PipelineCacheIndex(PipelineCacheIndex&&) = delete;
+        PipelineCacheIndex& operator=(PipelineCacheIndex&&) = delete;
+
+        // Marks every slot as empty
+        void Clear();
+        // Initializes the slots from serialized data. Returns false (leaving the slots
+        // empty) when data is invalid.
+        bool Load(Util::Span<const uint8_t> data);
+        void Serialize(Util::SmallVector<uint8_t>& out) const;
+
+        // Blocks while the PSO is being compiled by another thread
+        ACQUIRE Acquire(uint32_t idx, uint64_t key);
+        // Claims an empty slot without waiting, e.g. for compiling ahead of time. Returns false
+        // if the PSO has been compiled or is being compiled.
+        bool TryClaim(uint32_t idx);
+        // Records the compiled PSO (after it's been stored by the caller) and wakes up the
+        // threads that are waiting for it. pathToCompiledCS may be NULL.
+        void Publish(uint32_t idx, uint64_t key, bool inLibrary, const char* pathToCompiledCS);
+
+        // Whether any slot has a compiled shader that can be loaded ahead of time
+        bool HasWarmUpWork() const;
+        // Returns true and the path to its compiled shader if the PSO hasn't been compiled
+        // and isn't being compiled
+        bool NeedsWarmUp(uint32_t idx, char (&pathToCompiledCS)[MAX_PATH_LEN]) const;
+
+        // Called after a new PSO was stored in the library
+        ZetaInline void OnStoredInLibrary() { m_numLibraryPSOs.fetch_add(1, std::memory_order_relaxed); }
+        // Called after the library was recreated empty
+        void OnLibraryReset();
+        ZetaInline uint32_t NumLibraryPSOs() const { return m_numLibraryPSOs.load(std::memory_order_relaxed); }
+        // PSOs in the library that no slot refers to anymore
+        uint32_t NumStale() const;
+        bool TooManyStale(uint32_t numInUse) const;
+
+        ZetaInline size_t NumPSOs() const { return m_entries.size(); }
+        ZetaInline uint64_t Key(uint32_t idx) const { return m_entries[idx].Key; }
+        ZetaInline bool InLibrary(uint32_t idx) const { return m_entries[idx].InLibrary; }
+        // For when the library is rebuilt from the compiled PSOs
+        void SetInLibrary(uint32_t idx, bool inLibrary);
+
+    private:
+        static constexpr uint32_t INDEX_MAGIC = 0x5844494c;        // "LIDX"
+        static constexpr uint32_t INDEX_VERSION = 1;
+
+        enum PSO_STATE : uint32_t
+        {
+            EMPTY,
+            COMPILING,
+            COMPILED
+        };
+
+        struct IndexHeader
+        {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t NumEntries;
+            // Number of PSOs in the serialized library, including the stale ones
+            uint32_t NumLibraryPSOs;
+        };
+
+        struct IndexEntry
+        {
+            uint64_t Key;
+            uint16_t PsoIdx;
+            uint16_t InLibrary;
+            // Relative to the compiled shaders directory. Empty when the bytecode didn't come
+            // from a file.
+            char PathToCompiledCS[MAX_PATH_LEN];
+        };
+        static_assert(sizeof(IndexEntry) == 64);
+
+        struct PsoEntry
+        {
+            // Key of the compiled PSO or the one from the index if it hasn't been compiled yet
+            uint64_t Key;
+            uint32_t State;
+            bool InLibrary;
+            char PathToCompiledCS[MAX_PATH_LEN];
+        };
+
+        Util::SmallVector<PsoEntry> m_entries;
+        mutable RWLock m_lock{ "PSO cache index" };
+        std::atomic_uint32_t m_numLibraryPSOs = 0;
+    };
+}
\ No newline at end of file
@@ -47,42 +47,80 @@ namespace ZetaRay::Support
             m_type = ST_TYPE::ST_RATIO;
             m_uint64 = ((uint64_t)u << 32) | total;
         }
+        // Value is the raw bits of the union member that corresponds to type
+        Stat(const char* group, const char* name, ST_TYPE type, uint64_t bits)
+        {
+            InitCommon(group, name);
+            m_type = type;
+            m_uint64 = bits;
+        }
 
-        const char* GetGroup() { return m_group; }
-        const char* GetName() { return m_name; }
-        ST_TYPE GetType() { return m_type; }
+        const char* GetGroup() const { return m_group; }
+        const char* GetName() const { return m_name; }
+        ST_TYPE GetType() const { return m_type; }
 
-        int GetInt()
+        int GetInt() const
         {
             Assert(m_type == ST_TYPE::ST_INT, "Invalid union type.");
             return m_int;
         }
 
-        uint32_t GetUInt()
+        uint32_t GetUInt() const
         {
             Assert(m_type == ST_TYPE::ST_UINT, "Invalid union type.");
             return m_uint;
         }
 
-        float GetFloat()
+        float GetFloat() const
         {
             Assert(m_type == ST_TYPE::ST_FLOAT, "Invalid union type.");
             return m_float;
         }
 
-        uint64_t GetUInt64()
+        uint64_t GetUInt64() const
         {
             Assert(m_type == ST_TYPE::ST_UINT64, "Invalid union type.");
             return m_uint64;
         }
 
-        void GetRatio(uint32_t& num, uint32_t& total)
+        void GetRatio(uint32_t& num, uint32_t& total) const
         {
             Assert(m_type == ST_TYPE::ST_RATIO, "Invalid union type.");
             num = m_uint64 >> 32;
             total = m_uint64 & 0xffffffff;
         }
 
+        // Value converted to float regardless of type, ratios are returned as a fraction
+        static float ToFloat(ST_TYPE type, uint64_t bits)
+        {
+            switch (type)
+            {
+            case ST_TYPE::ST_INT:
+                return (float)(int)(uint32_t)bits;
+            case ST_TYPE::ST_UINT:
+                return (float)(uint32_t)bits;
+            case ST_TYPE::ST_FLOAT:
+            {
+                const uint32_t u = (uint32_t)bits;
+                float f;
+                memcpy(&f, &u, sizeof(f));
+                return f;
+            }
+            case ST_TYPE::ST_UINT64:
+                return (float)bits;
+            case ST_TYPE::ST_RATIO:
+            {
+                const uint32_t total = bits & 0xffffffff;
+                return total ? (float)(bits >> 32) / total : 0.0f;
+            }
+            default:
+                return 0.0f;
+            }
+        }
+
+        static constexpr size_t GROUP_LEN = 16;
+        static constexpr size_t NAME_LEN = 32;
+
     private:
         void InitCommon(const char* group, const char* name)
         {
@@ -105,9 +143,6 @@ namespace ZetaRay::Support
             //m_id = XXH3_64bits(temp, ng + nn);
         }
 
-        static constexpr size_t GROUP_LEN = 16;
-        static constexpr size_t NAME_LEN = 32;
-
         char m_group[GROUP_LEN];
         char m_name[NAME_LEN];
         ST_TYPE m_type;
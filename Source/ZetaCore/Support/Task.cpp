@@ -1,6 +1,10 @@
 #include "Task.h"
 #include "../App/Timer.h"
+#ifdef _WIN32
 #include <intrin.h>
+#else
+#include "../Posix/Posix.h"
+#endif
 
 using namespace ZetaRay::Support;
 using namespace ZetaRay::Util;
@@ -15,10 +19,13 @@ Task::Task(const char* name, TASK_PRIORITY priority, Function&& f)
     m_priority(priority)
 {
     if(m_priority == TASK_PRIORITY::NORMAL)
-        m_signalHandle = App::RegisterTask();
+        m_signalHandle = App::RegisterTask(name);
+    // Background tasks can outlive the frame, so their captures can't stay in frame memory
+    else
+        m_dlg.MoveToHeap();
 }
 
-Task::Task(Task&& other)
+Task::Task(Task&& other) noexcept
     : m_dlg(ZetaMove(other.m_dlg)),
     m_signalHandle(other.m_signalHandle),
     m_indegree(other.m_indegree),
@@ -32,7 +39,7 @@ Task::Task(Task&& other)
     other.m_signalHandle = -1;
 }
 
-Task& Task::operator=(Task&& other)
+Task& Task::operator=(Task&& other) noexcept
 {
     if (this == &other)
         return *this;
@@ -60,7 +67,10 @@ void Task::Reset(const char* name, TASK_PRIORITY priority, Function&& f)
     m_dlg = ZetaMove(f);
 
     if(m_priority == TASK_PRIORITY::NORMAL)
-        m_signalHandle = App::RegisterTask();
+        m_signalHandle = App::RegisterTask(name);
+    // Background tasks can outlive the frame, so their captures can't stay in frame memory
+    else
+        m_dlg.MoveToHeap();
 }
 
 //--------------------------------------------------------------------------------------
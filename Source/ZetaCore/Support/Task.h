@@ -27,8 +27,8 @@ namespace ZetaRay::Support
         Task() = default;
         Task(const char* name, TASK_PRIORITY priority, Util::Function&& f);
         ~Task() = default;
-        Task(Task&&);
-        Task& operator=(Task&&);
+        Task(Task&&) noexcept;
+        Task& operator=(Task&&) noexcept;
 
         void Reset(const char* name, TASK_PRIORITY priority, Util::Function&& f);
         ZetaInline int GetSignalHandle() const { return m_signalHandle; }
@@ -0,0 +1,200 @@
+#include "TaskSignalPool.h"
+#include "../App/Timer.h"
+#include <immintrin.h>
+#include <string.h>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    // Dependencies often finish within a few microseconds, in which case parking the
+    // thread costs more than spinning
+    static constexpr int NUM_SPINS = 128;
+    // Signal() decrements this many counters before waking any of the tasks
+    static constexpr int SIGNAL_BATCH_SIZE = 32;
+}
+
+//--------------------------------------------------------------------------------------
+// TaskSignalPool
+//--------------------------------------------------------------------------------------
+
+TaskSignalPool::~TaskSignalPool()
+{
+    for (int i = 0; i < m_numPages; i++)
+        delete m_pages[i].load(std::memory_order_relaxed);
+}
+
+int TaskSignalPool::Register(const char* name)
+{
+    const int handle = m_numRegistered.fetch_add(1, std::memory_order_relaxed);
+    Check(handle < MAX_NUM_SIGNALS, "Number of task signals exceeded MAX_NUM_SIGNALS (%d).",
+        MAX_NUM_SIGNALS);
+
+    const int pageIdx = handle / PAGE_SIZE;
+    Page* page = m_pages[pageIdx].load(std::memory_order_acquire);
+
+    if (!page)
+    {
+        AcquireSRWLockExclusive(&m_growLock);
+
+        // Some other thread might've allocated it in the meantime
+        page = m_pages[pageIdx].load(std::memory_order_relaxed);
+
+        // Pages are allocated in order, so that m_numPages tracks the allocated range
+        while (!page)
+        {
+            m_pages[m_numPages].store(new Page, std::memory_order_release);
+            m_numPages++;
+
+            page = m_pages[pageIdx].load(std::memory_order_relaxed);
+        }
+
+        ReleaseSRWLockExclusive(&m_growLock);
+    }
+
+    Entry& s = page->Entries[handle % PAGE_SIZE];
+    s.Indegree.store(0, std::memory_order_relaxed);
+    s.State.store(READY, std::memory_order_relaxed);
+    s.BlockedNs = 0;
+
+    const size_t n = name ? strlen(name) : 0;
+    const size_t len = n < TaskStall::MAX_NAME_LEN - 1 ? n : TaskStall::MAX_NAME_LEN - 1;
+    if (len)
+        memcpy(s.Name, name, len);
+    s.Name[len] = '\0';
+
+    return handle;
+}
+
+void TaskSignalPool::Finalize(int handle, int indegree)
+{
+    Assert(indegree > 0, "Redundant call.");
+
+    Entry& s = Get(handle);
+    s.Indegree.store(indegree, std::memory_order_relaxed);
+    s.State.store(BLOCKED, std::memory_order_release);
+}
+
+void TaskSignalPool::Wait(int handle)
+{
+    Entry& s = Get(handle);
+    uint32_t state = s.State.load(std::memory_order_acquire);
+
+    if (state == READY)
+        return;
+
+    const int64_t begin = Timer::NowNano();
+
+    for (int i = 0; i < NUM_SPINS && state != READY; i++)
+    {
+        _mm_pause();
+        state = s.State.load(std::memory_order_acquire);
+    }
+
+    // Let Signal() know that this thread needs to be woken up. Fails if the task became
+    // ready in the meantime.
+    if (state == BLOCKED && s.State.compare_exchange_strong(state, WAITING, std::memory_order_acquire))
+        state = WAITING;
+
+    while (state != READY)
+    {
+        s.State.wait(WAITING, std::memory_order_acquire);
+        state = s.State.load(std::memory_order_acquire);
+    }
+
+    const int64_t blockedNs = Timer::NowNano() - begin;
+    s.BlockedNs = blockedNs;
+
+    m_numBlocked.fetch_add(1, std::memory_order_relaxed);
+    m_blockedNs.fetch_add(blockedNs, std::memory_order_relaxed);
+}
+
+void TaskSignalPool::Signal(Span<int> handles)
+{
+    Entry* ready[SIGNAL_BATCH_SIZE];
+
+    for (size_t beg = 0; beg < handles.size(); beg += SIGNAL_BATCH_SIZE)
+    {
+        const size_t end = beg + SIGNAL_BATCH_SIZE < handles.size() ? beg + SIGNAL_BATCH_SIZE : handles.size();
+        int numReady = 0;
+
+        for (size_t i = beg; i < end; i++)
+        {
+            Entry& s = Get(handles[i]);
+            const int remaining = s.Indegree.fetch_sub(1, std::memory_order_acq_rel);
+            Assert(remaining > 0, "Task was signalled more times than its indegree.");
+
+            // This was the last dependency
+            if (remaining == 1)
+                ready[numReady++] = &s;
+        }
+
+        for (int i = 0; i < numReady; i++)
+        {
+            const uint32_t prev = ready[i]->State.exchange(READY, std::memory_order_release);
+
+            // Only the tasks whose thread is parked need a wake-up
+            if (prev == WAITING)
+                ready[i]->State.notify_one();
+        }
+    }
+}
+
+void TaskSignalPool::Reset()
+{
+    const int numTasks = m_numRegistered.load(std::memory_order_relaxed);
+
+    m_frameStats.NumTasks = numTasks;
+    m_frameStats.NumBlocked = m_numBlocked.load(std::memory_order_relaxed);
+    m_frameStats.BlockedMs = (float)((double)m_blockedNs.load(std::memory_order_relaxed) / 1'000'000);
+    m_frameStats.NumStalls = 0;
+
+    // Keep the tasks that were blocked the longest, sorted by insertion
+    if (m_frameStats.NumBlocked > 0)
+    {
+        int64_t stallNs[TaskSignalStats::MAX_NUM_STALLS];
+        const Entry* stalls[TaskSignalStats::MAX_NUM_STALLS];
+        int numStalls = 0;
+
+        for (int i = 0; i < numTasks; i++)
+        {
+            const Entry& s = Get(i);
+            if (s.BlockedNs == 0)
+                continue;
+
+            int j = numStalls < TaskSignalStats::MAX_NUM_STALLS ? numStalls++ : TaskSignalStats::MAX_NUM_STALLS;
+
+            while (j > 0 && stallNs[j - 1] < s.BlockedNs)
+            {
+                if (j < TaskSignalStats::MAX_NUM_STALLS)
+                {
+                    stallNs[j] = stallNs[j - 1];
+                    stalls[j] = stalls[j - 1];
+                }
+
+                j--;
+            }
+
+            if (j < TaskSignalStats::MAX_NUM_STALLS)
+            {
+                stallNs[j] = s.BlockedNs;
+                stalls[j] = &s;
+            }
+        }
+
+        for (int i = 0; i < numStalls; i++)
+        {
+            TaskStall& t = m_frameStats.Stalls[i];
+            memcpy(t.Name, stalls[i]->Name, TaskStall::MAX_NAME_LEN);
+            t.BlockedMs = (float)((double)stallNs[i] / 1'000'000);
+        }
+
+        m_frameStats.NumStalls = numStalls;
+    }
+
+    m_numRegistered.store(0, std::memory_order_relaxed);
+    m_numBlocked.store(0, std::memory_order_relaxed);
+    m_blockedNs.store(0, std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../Utility/Error.h"
+#include "../Utility/Span.h"
+#include <atomic>
+#ifdef _WIN32
+#include "../Win32/Win32.h"
+#else
+#include "../Posix/Posix.h"
+#endif
+
+namespace ZetaRay::Support
+{
+    // Frame stats that App adds every frame for the tasks of the previous frame
+    inline constexpr const char* TASK_STAT_GROUP = "Tasks";
+    inline constexpr const char* TASK_STAT_NUM_TASKS = "#Tasks";
+    inline constexpr const char* TASK_STAT_NUM_BLOCKED = "#Blocked";
+    inline constexpr const char* TASK_STAT_BLOCKED_MS = "Blocked (ms)";
+
+    struct TaskStall
+    {
+        static constexpr int MAX_NAME_LEN = 48;
+
+        char Name[MAX_NAME_LEN];
+        // Time that the task's thread spent waiting for its dependencies
+        float BlockedMs;
+    };
+
+    struct TaskSignalStats
+    {
+        static constexpr int MAX_NUM_STALLS = 4;
+
+        int NumTasks = 0;
+        // Tasks that had to wait for at least one of their dependencies
+        int NumBlocked = 0;
+        float BlockedMs = 0.0f;
+        // Tasks that were blocked the longest, sorted from longest to shortest
+        TaskStall Stalls[MAX_NUM_STALLS];
+        int NumStalls = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // TaskSignalPool: Dependency counters for the tasks of a frame.
+    //
+    //  - Signals are allocated in pages that are never freed, so the pool grows to the
+    //    largest number of tasks in a frame and Reset() recycles them for the next one.
+    //    Looking up a handle doesn't take a lock.
+    //  - Each signal is on its own cache line, so that threads decrementing different
+    //    counters don't contend.
+    //  - Signal() first decrements all the counters, then wakes the tasks that became
+    //    ready, and only if their thread is parked.
+    //  - Time spent blocked is recorded per task, see GetFrameStats().
+    //--------------------------------------------------------------------------------------
+
+    struct TaskSignalPool
+    {
+        static constexpr int PAGE_SIZE = 256;
+        static constexpr int MAX_NUM_PAGES = 64;
+        static constexpr int MAX_NUM_SIGNALS = PAGE_SIZE * MAX_NUM_PAGES;
+
+        TaskSignalPool() = default;
+        ~TaskSignalPool();
+
+        TaskSignalPool(TaskSignalPool&&) = delete;
+        TaskSignalPool& operator=(TaskSignalPool&&) = delete;
+
+        // Returns a handle that is valid until the next Reset(). Thread-safe.
+        int Register(const char* name);
+        // Task can't start until Signal() has been called indegree times for it
+        void Finalize(int handle, int indegree);
+        // Blocks until all the dependencies of given task have signalled
+        void Wait(int handle);
+        void Signal(Util::Span<int> handles);
+
+        // Recycles all the handles and collects the stats for the tasks that were registered
+        // since the last call. No task from the previous frame may still be running.
+        void Reset();
+        ZetaInline int NumRegistered() const { return m_numRegistered.load(std::memory_order_relaxed); }
+        ZetaInline int Capacity() const { return m_numPages * PAGE_SIZE; }
+        // Stats for the tasks before the last Reset()
+        ZetaInline const TaskSignalStats& GetFrameStats() const { return m_frameStats; }
+
+    private:
+        enum STATE : uint32_t
+        {
+            READY,
+            BLOCKED,
+            // Blocked and its thread is (about to be) parked
+            WAITING
+        };
+
+        struct alignas(64) Entry
+        {
+            std::atomic_int32_t Indegree;
+            std::atomic_uint32_t State;
+            int64_t BlockedNs;
+            char Name[TaskStall::MAX_NAME_LEN];
+        };
+
+        static_assert(sizeof(Entry) == 64);
+
+        struct Page
+        {
+            Entry Entries[PAGE_SIZE];
+        };
+
+        ZetaInline Entry& Get(int handle)
+        {
+            Assert(handle >= 0 && handle < m_numRegistered.load(std::memory_order_relaxed),
+                "Received handle %d while #handles for current frame is %d.", handle,
+                m_numRegistered.load(std::memory_order_relaxed));
+
+            Page* page = m_pages[handle / PAGE_SIZE].load(std::memory_order_acquire);
+            return page->Entries[handle % PAGE_SIZE];
+        }
+
+        std::atomic<Page*> m_pages[MAX_NUM_PAGES] = {};
+        int m_numPages = 0;
+        SRWLOCK m_growLock = SRWLOCK_INIT;
+
+        alignas(64) std::atomic_int32_t m_numRegistered = 0;
+        alignas(64) std::atomic_int32_t m_numBlocked = 0;
+        std::atomic_int64_t m_blockedNs = 0;
+
+        TaskSignalStats m_frameStats;
+    };
+}
\ No newline at end of file
@@ -13,7 +13,7 @@ namespace
 
         for (int i = 0; i < (int)threadIds.size(); i++)
         {
-            if (threadIds[i] == GetCurrentThreadId())
+            if (threadIds[i] == ZetaRay::App::GetCurrentThreadID())
             {
                 idx = i;
                 break;
@@ -66,16 +66,17 @@ void ThreadPool::Init(int poolSize, int totalNumThreads, const wchar_t* threadNa
 
     for (int i = 0; i < m_threadPoolSize; i++)
     {
-        m_threadPool[i] = std::thread(&ThreadPool::WorkerThread, this);
-        m_threadIDs[i] = App::GetThreadID(m_threadPool[i].native_handle());
+        m_threadPool[i] = std::thread(&ThreadPool::WorkerThread, this, i);
 
         wchar_t buffer[32];
-        //swprintf(buff, L"ZetaWorker_%d", i);
-        swprintf(buffer, L"%ls_%d", threadNamePrefix, i);
-        App::SetThreadDesc(m_threadPool[i].native_handle(), buffer);
+        swprintf(buffer, ZetaArrayLen(buffer), L"%ls_%d", threadNamePrefix, i);
+        App::SetThreadDesc((void*)m_threadPool[i].native_handle(), buffer);
 
-        App::SetThreadPriority(m_threadPool[i].native_handle(), priority);
+        App::SetThreadPriority((void*)m_threadPool[i].native_handle(), priority);
     }
+
+    // Every worker publishes its own thread ID before doing anything else
+    while (m_numThreadsStarted.load(std::memory_order_acquire) != m_threadPoolSize);
 }
 
 void ThreadPool::Start(Span<ZETA_THREAD_ID_TYPE> threadIDs)
@@ -138,7 +139,7 @@ void ThreadPool::PumpUntilEmpty()
     const int idx = FindThreadIdx(Span(m_allThreadIds, m_totalNumThreads));
     Assert(idx != -1, "Thread ID was not found");
 
-    const ZETA_THREAD_ID_TYPE tid = GetCurrentThreadId();
+    const ZETA_THREAD_ID_TYPE tid = App::GetCurrentThreadID();
     Task task;
 
     // "try_dequeue()" returning false doesn't guarantee that queue is empty
@@ -150,15 +151,20 @@ void ThreadPool::PumpUntilEmpty()
 
             const int taskHandle = task.GetSignalHandle();
 
-            // Block if this task depends on other unfinished tasks
-            App::WaitForAdjacentHeadNodes(taskHandle);
+            // Block if this task depends on other unfinished tasks. Background tasks
+            // don't have a signal handle.
+            if (task.GetPriority() != TASK_PRIORITY::BACKGROUND)
+                App::WaitForAdjacentHeadNodes(taskHandle);
 
             task.DoTask();
 
             // Signal dependent tasks that this task has finished
-            auto adjacencies = task.GetAdjacencies();
-            if (adjacencies.size() > 0)
-                App::SignalAdjacentTailNodes(adjacencies);
+            if (task.GetPriority() != TASK_PRIORITY::BACKGROUND)
+            {
+                auto adjacencies = task.GetAdjacencies();
+                if (adjacencies.size() > 0)
+                    App::SignalAdjacentTailNodes(adjacencies);
+            }
 
             m_numTasksFinished.fetch_add(1, std::memory_order_release);
         }
@@ -183,11 +189,14 @@ bool ThreadPool::TryFlush()
     return success;
 }
 
-void ThreadPool::WorkerThread()
+void ThreadPool::WorkerThread(int threadIdx)
 {
+    const ZETA_THREAD_ID_TYPE tid = App::GetCurrentThreadID();
+    m_threadIDs[threadIdx] = tid;
+    m_numThreadsStarted.fetch_add(1, std::memory_order_release);
+
     while (!m_start.load(std::memory_order_acquire));
 
-    const ZETA_THREAD_ID_TYPE tid = GetCurrentThreadId();
     LOG_UI(INFO, "Thread %u waiting for tasks...\n", tid);
 
     const int idx = FindThreadIdx(Span(m_allThreadIds, m_totalNumThreads));
@@ -34,9 +34,10 @@ namespace ZetaRay::Support
 
         ZetaInline int ThreadPoolSize() const { return m_threadPoolSize; }
         ZetaInline Util::Span<ZETA_THREAD_ID_TYPE> ThreadIDs() const { return Util::Span(m_threadIDs, m_threadPoolSize); }
+        ZetaInline void* ThreadHandle(int i) { return (void*)m_threadPool[i].native_handle(); }
 
     private:
-        void WorkerThread();
+        void WorkerThread(int threadIdx);
 
         int m_threadPoolSize;
         int m_totalNumThreads;
@@ -68,6 +69,7 @@ namespace ZetaRay::Support
             sizeof(moodycamel::ConsumerToken) * ZETA_MAX_NUM_THREADS];
         moodycamel::ConsumerToken* m_consumerTokens;
 
+        std::atomic_int32_t m_numThreadsStarted = 0;
         std::atomic_bool m_start = false;
         std::atomic_bool m_shutdown = false;
     };
@@ -2,7 +2,11 @@
 
 #include "../Utility/SmallVector.h"
 #include <atomic>
+#ifdef _WIN32
 #include "../Win32/Win32.h"
+#else
+#include "../Posix/Posix.h"
+#endif
 
 namespace ZetaRay::Support
 {
@@ -1,74 +1,94 @@
 #pragma once
 
-#include "../App/ZetaRay.h"
+#include "../App/App.h"
+#include <string.h>
+#include <type_traits>
 
 namespace ZetaRay::Util
 {
+    // Type-erased callable with small buffer optimization. Callables that don't fit in the
+    // inline buffer are moved to the frame allocator, so they're only valid until the end
+    // of the current frame, unless moved to the heap with MoveToHeap(). Callables that are
+    // trivially copyable are moved with a memcpy.
+    //
     // Ref: https://stackoverflow.com/questions/18633697/fastdelegate-and-lambdas-cant-get-them-to-work-don-clugstons-fastest-possib
     struct Function
     {
         Function() = default;
 
-        template <typename F>
+        template <typename F> requires(!std::is_same_v<std::decay_t<F>, Function>)
         Function(F&& f)
         {
-            static_assert(sizeof(F) <= BUFFER_SIZE, "Memory needed exceeded capture buffer size.");
-            static_assert(std::is_move_constructible_v<F>);
+            using T = std::decay_t<F>;
+            static_assert(std::is_move_constructible_v<T>);
+
+            if constexpr (IsInline<T>())
+            {
+                m_lambda = &GetInline<T>();
+                new (m_buffer) T(ZetaMove(f));
+            }
+            else
+            {
+                static_assert(sizeof(T) + alignof(T) - 1 <= App::FRAME_ALLOCATOR_MAX_ALLOCATION_SIZE,
+                    "Memory needed exceeded frame allocator's maximum allocation size.");
 
-            m_lambda = &Get<F>();
-            new (&m_buffer) F(ZetaMove(f));
+                m_lambda = &GetSpilled<T>();
+                void* mem = App::AllocateFrameAllocator(sizeof(T), alignof(T));
+                T* spilled = new (mem) T(ZetaMove(f));
+                memcpy(m_buffer, &spilled, sizeof(T*));
+            }
         }
 
         ~Function()
         {
             if (m_lambda)
-            {
-                m_lambda->destruct(&m_buffer);
-            }
+                m_lambda->destruct(m_buffer);
         }
 
         Function(Function&& other)
             : m_lambda(other.m_lambda)
         {
-            other.m_lambda = nullptr;
-            memcpy(m_buffer, other.m_buffer, BUFFER_SIZE);
-            memset(other.m_buffer, 0, BUFFER_SIZE);
+            MoveFrom(other);
         }
 
         Function& operator=(Function&& other)
         {
+            if (this == &other)
+                return *this;
+
+            if (m_lambda)
+                m_lambda->destruct(m_buffer);
+
             m_lambda = other.m_lambda;
-            other.m_lambda = nullptr;
-            memcpy(m_buffer, other.m_buffer, BUFFER_SIZE);
-            memset(other.m_buffer, 0, BUFFER_SIZE);
+            MoveFrom(other);
 
             return *this;
         }
 
-        bool IsSet() const
+        ZetaInline bool IsSet() const
         {
             return m_lambda != nullptr;
         }
 
-        //template <typename F>
-        //void Reset(F&& f)
-        //{
-        //    static_assert(sizeof(F) <= BUFFER_SIZE, "Memory needed exceede capture buffer size.");
-        //    static_assert(std::is_move_constructible_v<F>);
-
-        //    if (m_lambda)
-        //        m_lambda->destruct(&m_buffer);
+        // Whether the callable lives in frame memory rather than the inline buffer
+        ZetaInline bool IsSpilled() const
+        {
+            return m_lambda && m_lambda->spilled;
+        }
 
-        //    m_lambda = &Get<F>();
-        //    new (&m_buffer) F(ZetaMove(f));
-        //}
+        // Moves a callable that was spilled to frame memory to the heap, so that it stays
+        // valid after the frame ends. No-op otherwise.
+        ZetaInline void MoveToHeap()
+        {
+            if (m_lambda && m_lambda->moveToHeap)
+                m_lambda = m_lambda->moveToHeap(m_buffer);
+        }
 
         ZetaInline void Run()
         {
-            return m_lambda->call(&m_buffer);
+            return m_lambda->call(m_buffer);
         }
 
-    private:
         // Due to [[no_unique_address]] not working in clang-cl < 18, following needs to be larger
 #if !defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
         static constexpr int BUFFER_SIZE = 40;
@@ -76,10 +96,24 @@ namespace ZetaRay::Util
         static constexpr int BUFFER_SIZE = 32;
 #endif
 
+        template <typename F>
+        static constexpr bool IsInline()
+        {
+            return sizeof(F) <= BUFFER_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+                std::is_nothrow_move_constructible_v<F>;
+        }
+
+    private:
         struct LambdaFuncPtrs
         {
             void (*call)(void*);
             void (*destruct)(void*);
+            // Moves the callable from second argument into first and destructs the source.
+            // NULL when a memcpy suffices.
+            void (*relocate)(void*, void*);
+            // Only set for callables in frame memory
+            const LambdaFuncPtrs* (*moveToHeap)(void*);
+            bool spilled;
         };
 
         template <typename F>
@@ -95,12 +129,89 @@ namespace ZetaRay::Util
         }
 
         template <typename F>
-        const LambdaFuncPtrs& Get()
+        static void RelocateInline(void* dst, void* src)
         {
-            static const LambdaFuncPtrs lambda = { &Call<F>, &Destruct<F> };
+            F* s = reinterpret_cast<F*>(src);
+            new (dst) F(ZetaMove(*s));
+            s->~F();
+        }
+
+        template <typename F>
+        static void CallSpilled(void* f)
+        {
+            F* spilled;
+            memcpy(&spilled, f, sizeof(F*));
+            (*spilled)();
+        }
+
+        // Frame memory is released all at once, only the destructor needs to run
+        template <typename F>
+        static void DestructSpilled(void* f)
+        {
+            F* spilled;
+            memcpy(&spilled, f, sizeof(F*));
+            spilled->~F();
+        }
+
+        template <typename F>
+        static void DestructHeap(void* f)
+        {
+            F* onHeap;
+            memcpy(&onHeap, f, sizeof(F*));
+            onHeap->~F();
+            _aligned_free(onHeap);
+        }
+
+        template <typename F>
+        static const LambdaFuncPtrs* MoveSpilledToHeap(void* f)
+        {
+            F* spilled;
+            memcpy(&spilled, f, sizeof(F*));
+
+            void* mem = _aligned_malloc(sizeof(F), alignof(F));
+            F* onHeap = new (mem) F(ZetaMove(*spilled));
+            spilled->~F();
+            memcpy(f, &onHeap, sizeof(F*));
+
+            return &GetHeap<F>();
+        }
+
+        template <typename F>
+        static const LambdaFuncPtrs& GetInline()
+        {
+            static constexpr LambdaFuncPtrs lambda = { &Call<F>, &Destruct<F>,
+                std::is_trivially_copyable_v<F> ? nullptr : &RelocateInline<F>, nullptr, false };
             return lambda;
         }
 
+        // Only the pointer is stored inline, so it can always be moved with a memcpy
+        template <typename F>
+        static const LambdaFuncPtrs& GetSpilled()
+        {
+            static constexpr LambdaFuncPtrs lambda = { &CallSpilled<F>, &DestructSpilled<F>,
+                nullptr, &MoveSpilledToHeap<F>, true };
+            return lambda;
+        }
+
+        // Same as above, except that memory is freed on destruction
+        template <typename F>
+        static const LambdaFuncPtrs& GetHeap()
+        {
+            static constexpr LambdaFuncPtrs lambda = { &CallSpilled<F>, &DestructHeap<F>,
+                nullptr, nullptr, false };
+            return lambda;
+        }
+
+        ZetaInline void MoveFrom(Function& other)
+        {
+            if (m_lambda && m_lambda->relocate)
+                m_lambda->relocate(m_buffer, other.m_buffer);
+            else
+                memcpy(m_buffer, other.m_buffer, BUFFER_SIZE);
+
+            other.m_lambda = nullptr;
+        }
+
         const LambdaFuncPtrs* m_lambda = nullptr;
         alignas(alignof(std::max_align_t)) uint8_t m_buffer[BUFFER_SIZE];
     };
@@ -427,8 +427,10 @@ namespace ZetaRay::Util
         Entry* m_end = nullptr;        // Pointer to the end of memory block
         size_t m_numEntries = 0;
         size_t m_numNonTombstoneEntries = 0;
-#if defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
+#if defined(ZETA_HAS_NO_UNIQUE_ADDRESS) && defined(_MSC_VER)
         [[msvc::no_unique_address]] Allocator m_allocator;
+#elif defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
+        [[no_unique_address]] Allocator m_allocator;
 #else
         Allocator m_allocator;
 #endif
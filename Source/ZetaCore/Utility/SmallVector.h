@@ -15,7 +15,7 @@ namespace ZetaRay::Util
     template<typename T, Support::AllocatorType Allocator = Support::SystemAllocator>
     class Vector
     {
-        static constexpr size_t MIN_CAPACITY = Math::Max(64 / sizeof(T), 4llu);
+        static constexpr size_t MIN_CAPACITY = Math::Max(64 / sizeof(T), (size_t)4);
 
     public:
         bool has_inline_storage() const
@@ -618,8 +618,10 @@ namespace ZetaRay::Util
         T* m_end = nullptr;        // Pointer to element to insert at next (one past the last inserted element)
         T* m_last = nullptr;       // Pointer to the end of memory block
 
-#if defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
+#if defined(ZETA_HAS_NO_UNIQUE_ADDRESS) && defined(_MSC_VER)
         [[msvc::no_unique_address]] Allocator m_allocator;
+#elif defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
+        [[no_unique_address]] Allocator m_allocator;
 #else
         Allocator m_allocator;
 #endif
@@ -652,7 +654,9 @@ namespace ZetaRay::Util
     constexpr uint32_t GetExcessSize()
     {
         auto vecSize = Math::AlignUp(sizeof(Vector<T, Allocator>), alignof(T));
-        auto alignment = Math::Max(alignof(T), alignof(std::max_align_t));
+        // alignof(std::max_align_t) differs between compilers (8 on MSVC, 16 on GCC), use the
+        // object's own alignment so that inline capacity doesn't depend on the platform
+        auto alignment = Math::Max(alignof(T), alignof(Vector<T, Allocator>));
         int total = (int)Math::AlignUp(vecSize + 1, alignment);
         int leftover = (total - (int)vecSize) / sizeof(T);
         return Math::Max<int>(0, leftover);
@@ -849,8 +853,10 @@ namespace ZetaRay::Util
             Assert(this->capacity() == N, "Capacity must be N.");
         }
 
-#if defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
+#if defined(ZETA_HAS_NO_UNIQUE_ADDRESS) && defined(_MSC_VER)
         [[msvc::no_unique_address]] InlineStorage<T, N> m_inlineStorage;
+#elif defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
+        [[no_unique_address]] InlineStorage<T, N> m_inlineStorage;
 #else
         InlineStorage<T, N> m_inlineStorage;
 #endif
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../Win32/Win32.h"
+#include "../Support/Lock.h"
 #include "Span.h"
 
 namespace ZetaRay::Util
@@ -8,15 +8,15 @@ namespace ZetaRay::Util
     template<typename T>
     struct RSynchronizedView
     {
-        RSynchronizedView(const T& t, SRWLOCK& lock)
+        RSynchronizedView(const T& t, Support::RWLock& lock)
             : m_view(t),
             m_lock(lock)
         {
-            AcquireSRWLockShared(&m_lock);
+            m_lock.LockShared();
         }
         ~RSynchronizedView()
         {
-            ReleaseSRWLockShared(&m_lock);
+            m_lock.UnlockShared();
         }
         RSynchronizedView(RSynchronizedView&&) = delete;
         RSynchronizedView& operator=(RSynchronizedView&&) = delete;
@@ -25,21 +25,21 @@ namespace ZetaRay::Util
 
     private:
         const T& m_view;
-        SRWLOCK& m_lock;
+        Support::RWLock& m_lock;
     };
 
     template<typename T>
     struct RWSynchronizedView
     {
-        RWSynchronizedView(T& t, SRWLOCK& lock)
+        RWSynchronizedView(T& t, Support::RWLock& lock)
             : m_view(t),
             m_lock(lock)
         {
-            AcquireSRWLockExclusive(&m_lock);
+            m_lock.LockExclusive();
         }
         ~RWSynchronizedView()
         {
-            ReleaseSRWLockExclusive(&m_lock);
+            m_lock.UnlockExclusive();
         }
         RWSynchronizedView(RWSynchronizedView&&) = delete;
         RWSynchronizedView& operator=(RWSynchronizedView&&) = delete;
@@ -48,48 +48,48 @@ namespace ZetaRay::Util
 
     private:
         T& m_view;
-        SRWLOCK& m_lock;
+        Support::RWLock& m_lock;
     };
 
     template<typename T>
     struct SynchronizedSpan
     {
-        SynchronizedSpan(Util::Span<T> t, SRWLOCK& lock)
+        SynchronizedSpan(Util::Span<T> t, Support::RWLock& lock)
             : m_span(t),
             m_lock(lock)
         {
-            AcquireSRWLockShared(&m_lock);
+            m_lock.LockShared();
         }
         ~SynchronizedSpan()
         {
-            ReleaseSRWLockShared(&m_lock);
+            m_lock.UnlockShared();
         }
         SynchronizedSpan(SynchronizedSpan&&) = delete;
         SynchronizedSpan& operator=(SynchronizedSpan&&) = delete;
 
         const Util::Span<T> m_span;
     private:
-        SRWLOCK& m_lock;
+        Support::RWLock& m_lock;
     };    
     
     template<typename T>
     struct SynchronizedMutableSpan
     {
-        SynchronizedMutableSpan(Util::MutableSpan<T> t, SRWLOCK& lock)
+        SynchronizedMutableSpan(Util::MutableSpan<T> t, Support::RWLock& lock)
             : m_span(t),
             m_lock(lock)
         {
-            AcquireSRWLockExclusive(&m_lock);
+            m_lock.LockExclusive();
         }
         ~SynchronizedMutableSpan()
         {
-            ReleaseSRWLockExclusive(&m_lock);
+            m_lock.UnlockExclusive();
         }
         SynchronizedMutableSpan(SynchronizedMutableSpan&&) = delete;
         SynchronizedMutableSpan& operator=(SynchronizedMutableSpan&&) = delete;
 
         const Util::MutableSpan<T> m_span;
     private:
-        SRWLOCK& m_lock;
+        Support::RWLock& m_lock;
     };
 }
\ No newline at end of file
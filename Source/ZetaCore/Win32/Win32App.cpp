@@ -1,9 +1,14 @@
 #include "../App/Log.h"
 #include "../Support/FrameMemory.h"
+#include "../Support/CpuTopology.h"
 #include "../App/Timer.h"
 #include "../App/Common.h"
-#include "../Support/Param.h"
-#include "../Support/Stat.h"
+#include "../Support/ParamRegistry.h"
+#include "../Support/FrameStats.h"
+#include "../Support/FramePipeline.h"
+#include "../Support/Lock.h"
+#include "../Support/TaskSignalPool.h"
+#include "../Support/FrameCapture.h"
 #include "../Core/RendererCore.h"
 #include "../Scene/SceneCore.h"
 #include "../Scene/Camera.h"
@@ -39,18 +44,6 @@ namespace
         int NextFramHistIdx = 0;
     };
 
-    struct ParamUpdate
-    {
-        enum OP_TYPE
-        {
-            ADD,
-            REMOVE
-        };
-
-        ZetaRay::Support::ParamVariant P;
-        OP_TYPE Op;
-    };
-
     // Ref: https://github.com/ysc3839/win32-darkmode
     enum PreferredAppMode
     {
@@ -118,7 +111,12 @@ namespace
     struct FrameMemoryContext
     {
         alignas(64) int m_threadFrameAllocIndices[ZETA_MAX_NUM_THREADS] = { -1 };
-        std::atomic_int32_t m_currFrameAllocIndex;
+        // Dense NUMA node of each thread, zero for threads that aren't pinned
+        int m_threadNodes[ZETA_MAX_NUM_THREADS] = { 0 };
+        // Affinity of each thread before it was pinned, restored when it's unpinned
+        GROUP_AFFINITY m_defaultAffinities[ZETA_MAX_NUM_THREADS];
+        // Blocks of each node are handed out separately
+        std::atomic_int32_t m_currFrameAllocIndex[CpuTopology::MAX_NUM_NODES];
     };
 
     struct AppData
@@ -130,27 +128,23 @@ namespace
         inline static constexpr const char* DXC_PATH = "..\\Tools\\dxc\\bin\\x64\\dxc.exe";
         inline static constexpr const char* RENDER_PASS_DIR = "..\\Source\\ZetaRenderPass";
         static constexpr int NUM_BACKGROUND_THREADS = 2;
-        static constexpr int MAX_NUM_TASKS_PER_FRAME = 256;
+        inline static const char* PINNING_OPTIONS[] = { "None", "Compact", "Spread" };
         static constexpr int CLIPBOARD_LEN = 128;
         static constexpr int FRAME_ALLOCATOR_BLOCK_SIZE = FRAME_ALLOCATOR_MAX_ALLOCATION_SIZE;
 
-        struct alignas(64) TaskSignal
-        {
-            std::atomic_int32_t Indegree;
-            std::atomic_bool BlockFlag;
-        };
-
         alignas(64) ZETA_THREAD_ID_TYPE m_threadIDs[ZETA_MAX_NUM_THREADS];
-        TaskSignal m_registeredTasks[MAX_NUM_TASKS_PER_FRAME];
-        std::atomic_int32_t m_currTaskSignalIdx = 0;
+        TaskSignalPool m_taskSignals;
 
         FrameMemoryContext m_frameMemoryContext;
         FrameMemory<FRAME_ALLOCATOR_BLOCK_SIZE> m_frameMemory;
 
         ThreadPool m_workerThreadPool;
         ThreadPool m_backgroundThreadPool;
+        CpuTopology m_cpuTopology;
         RendererCore m_renderer;
         Timer m_timer;
+        // Measures time from App::Init() until the first frame has been submitted
+        DeltaTimer m_startupTimer;
         SceneCore m_scene;
         Camera m_camera;
 
@@ -183,24 +177,28 @@ namespace
         float m_upscaleFactor = 1.0f;
         float m_queuedUpscaleFactor = 1.0f;
         float m_cameraAcceleration = 40.0f;
+        THREAD_PINNING m_pinning = THREAD_PINNING::NONE;
+        THREAD_PINNING m_queuedPinning = THREAD_PINNING::NONE;
 
-        SmallVector<ParamVariant> m_params;
-        SmallVector<ParamUpdate, SystemAllocator, 32> m_paramsUpdates;
+        ParamRegistry m_params;
         SmallVector<ShaderReloadHandler> m_shaderReloadHandlers;
-        SmallVector<Stat, FrameAllocator> m_frameStats;
+        FrameStats m_frameStats;
+        FramePipeline m_framePipeline;
         FrameTime m_frameTime;
+        FrameCaptureWriter m_frameCapture;
+        double m_frameCaptureBeginTime = 0.0;
 
         SRWLOCK m_stdOutLock = SRWLOCK_INIT;
-        SRWLOCK m_paramLock = SRWLOCK_INIT;
-        SRWLOCK m_paramUpdateLock = SRWLOCK_INIT;
-        SRWLOCK m_shaderReloadLock = SRWLOCK_INIT;
-        SRWLOCK m_statsLock = SRWLOCK_INIT;
-        SRWLOCK m_logLock = SRWLOCK_INIT;
+        RWLock m_paramLock{ "Params" };
+        RWLock m_shaderReloadLock{ "Shader reload" };
+        RWLock m_statsLock{ "Stats" };
+        RWLock m_logLock{ "Logs" };
 
         Motion m_frameMotion;
         char m_clipboard[CLIPBOARD_LEN];
         bool m_isInitialized = false;
         bool m_issueResize = false;
+        bool m_issuePinning = false;
 
         MemoryArena m_logStrArena;
         SmallVector<LogMessage> m_frameLogs;
@@ -599,8 +597,6 @@ namespace ZetaRay::AppImpl
 
     void UpdateStats(size_t tempMemoryUsage)
     {
-        g_app->m_frameStats.free_memory();
-
         const float frameTimeMs = g_app->m_timer.GetTotalFrameCount() > 1 ?
             (float)(g_app->m_timer.GetElapsedTime() * 1000.0f) :
             0.0f;
@@ -624,10 +620,49 @@ namespace ZetaRay::AppImpl
         if (memoryInfo.CurrentUsage > memoryInfo.Budget)
             LOG_UI_WARNING("VRAM usage exceeded available budget; performance can be severely impacted.");
 
-        g_app->m_frameStats.emplace_back("Frame", "FPS", g_app->m_timer.GetFramesPerSecond());
-        g_app->m_frameStats.emplace_back("GPU", "VRAM Usage (MB)", memoryInfo.CurrentUsage >> 20);
-        g_app->m_frameStats.emplace_back("GPU", "VRAM Budget (MB)", memoryInfo.Budget >> 20);
-        g_app->m_frameStats.emplace_back("Frame", "Frame temp memory usage (kb)", tempMemoryUsage >> 10);
+        App::AddFrameStat("Frame", "FPS", g_app->m_timer.GetFramesPerSecond());
+        App::AddFrameStat("GPU", "VRAM Usage (MB)", memoryInfo.CurrentUsage >> 20);
+        App::AddFrameStat("GPU", "VRAM Budget (MB)", memoryInfo.Budget >> 20);
+        App::AddFrameStat("Frame", "Frame temp memory usage (kb)", tempMemoryUsage >> 10);
+
+        FrameLatencies latencies;
+        if (g_app->m_framePipeline.GetLatest(latencies))
+        {
+            for (int i = 0; i < (int)FRAME_STAGE::COUNT; i++)
+                App::AddFrameStat(FRAME_PIPELINE_STAT_GROUP, FRAME_PIPELINE_STAT_NAMES[i], latencies.StageMs[i]);
+
+            App::AddFrameStat(FRAME_PIPELINE_STAT_GROUP, FRAME_PIPELINE_STAT_NAMES[(int)FRAME_STAGE::COUNT],
+                latencies.TotalMs);
+        }
+
+        LockFrameStats lockStats[32];
+        const int numLocks = CollectLockStats(lockStats);
+
+        for (int i = 0; i < numLocks; i++)
+        {
+            char name[Stat::NAME_LEN];
+            stbsp_snprintf(name, sizeof(name), "%s contended", lockStats[i].Name);
+            App::AddFrameStat(LOCK_STAT_GROUP, name, lockStats[i].NumContended, lockStats[i].NumAcquires);
+
+            stbsp_snprintf(name, sizeof(name), "%s wait (ms)", lockStats[i].Name);
+            App::AddFrameStat(LOCK_STAT_GROUP, name, lockStats[i].WaitMs);
+        }
+
+        const TaskSignalStats& taskStats = g_app->m_taskSignals.GetFrameStats();
+        App::AddFrameStat(TASK_STAT_GROUP, TASK_STAT_NUM_TASKS, taskStats.NumTasks);
+        App::AddFrameStat(TASK_STAT_GROUP, TASK_STAT_NUM_BLOCKED, taskStats.NumBlocked);
+        App::AddFrameStat(TASK_STAT_GROUP, TASK_STAT_BLOCKED_MS, taskStats.BlockedMs);
+
+        // All of the previous frame's worker tasks (including simulation of this frame) have
+        // finished and this frame's scene tasks haven't been submitted yet, so taking the
+        // scene locks here doesn't contend with them
+        g_app->m_scene.AddMemoryStats();
+
+        // Stats that were added during the previous frame (plus the ones above) are merged
+        // once here, rather than every AddFrameStat() serializing on a lock
+        g_app->m_statsLock.LockExclusive();
+        g_app->m_frameStats.Merge(g_app->m_timer.GetTotalFrameCount());
+        g_app->m_statsLock.UnlockExclusive();
     }
 
     void Update(TaskSet& sceneTS, TaskSet& sceneRendererTS, size_t tempMemoryUsage)
@@ -664,10 +699,30 @@ namespace ZetaRay::AppImpl
         g_app->m_inMouseWheelMove = 0;
         g_app->m_frameMotion.dt = (float)g_app->m_timer.GetElapsedTime();
 
+        const bool capturing = g_app->m_frameCapture.IsRecording();
+
+        if (capturing)
+        {
+            const double t = g_app->m_timer.GetTotalTime() - g_app->m_frameCaptureBeginTime;
+            g_app->m_frameCapture.BeginFrame((int64_t)(t * 1e9), g_app->m_timer.GetElapsedTime());
+
+            g_app->m_paramLock.LockShared();
+            g_app->m_frameCapture.RecordParamChanges(g_app->m_params.Params());
+            g_app->m_paramLock.UnlockShared();
+
+            g_app->m_frameCapture.RecordMotion(g_app->m_frameMotion);
+        }
+
         g_app->m_camera.Update(g_app->m_frameMotion);
 
         if (g_app->m_picked)
         {
+            if (capturing)
+            {
+                g_app->m_frameCapture.RecordPick(g_app->m_multiPick ? CAPTURE_PICK::MULTI : CAPTURE_PICK::SINGLE,
+                    (uint16_t)g_app->m_lastLMBClickPosX, (uint16_t)g_app->m_lastLMBClickPosY);
+            }
+
             if (g_app->m_multiPick)
                 g_app->m_scene.MultiPick(g_app->m_lastLMBClickPosX, g_app->m_lastLMBClickPosY);
             else
@@ -828,7 +883,12 @@ namespace ZetaRay::AppImpl
                 }
             }
             else if (GetAsyncKeyState(VK_ESCAPE) & (1 << 16))
+            {
+                if (g_app->m_frameCapture.IsRecording())
+                    g_app->m_frameCapture.RecordPick(CAPTURE_PICK::CLEAR);
+
                 g_app->m_scene.ClearPick();
+            }
         }
     }
 
@@ -998,37 +1058,9 @@ namespace ZetaRay::AppImpl
 
     void ApplyParamUpdates()
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
-        AcquireSRWLockExclusive(&g_app->m_paramLock);
-
-        for (auto& p : g_app->m_paramsUpdates)
-        {
-            if (p.Op == ParamUpdate::OP_TYPE::ADD)
-                g_app->m_params.push_back(p.P);
-            else if (p.Op == ParamUpdate::OP_TYPE::REMOVE)
-            {
-                size_t i = 0;
-                bool found = false;
-                while (i < g_app->m_params.size())
-                {
-                    if (g_app->m_params[i].ID() == p.P.ID())
-                    {
-                        found = true;
-                        break;
-                    }
-
-                    i++;
-                }
-
-                if (found)
-                    g_app->m_params.erase_at_index(i);
-            }
-        }
-
-        g_app->m_paramsUpdates.clear();
-
-        ReleaseSRWLockExclusive(&g_app->m_paramLock);
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
+        g_app->m_paramLock.LockExclusive();
+        g_app->m_params.ApplyUpdates();
+        g_app->m_paramLock.UnlockExclusive();
     }
 
     // Ref: https://github.com/ysc3839/win32-darkmode
@@ -1255,6 +1287,17 @@ namespace ZetaRay::AppImpl
         g_app->m_cameraAcceleration = p.GetFloat().m_value;
     }
 
+    void SetFramesInFlight(const ParamVariant& p)
+    {
+        g_app->m_framePipeline.SetFramesInFlight(p.GetInt().m_value);
+    }
+
+    void SetThreadPinning(const ParamVariant& p)
+    {
+        g_app->m_queuedPinning = (THREAD_PINNING)p.GetEnum().m_curr;
+        g_app->m_issuePinning = true;
+    }
+
     void ResizeIfQueued()
     {
         if (g_app->m_issueResize)
@@ -1273,7 +1316,149 @@ namespace ZetaRay::AppImpl
         }
     }
 
-    ZetaInline int GetThreadIdx()
+    // Logical processors of all the processor groups along with their package, core,
+    // NUMA node and efficiency class
+    void DetectCpuTopology(CpuTopology& topology)
+    {
+        DWORD buffSize = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &buffSize);
+        Assert(GetLastError() == ERROR_INSUFFICIENT_BUFFER, "GetLogicalProcessorInformationEx() failed.");
+
+        SmallVector<uint8_t, SystemAllocator, 4096> buffer;
+        buffer.resize(buffSize);
+        CheckWin32(GetLogicalProcessorInformationEx(RelationAll,
+            reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &buffSize));
+
+        auto inMask = [](const GROUP_AFFINITY& g, int id)
+            {
+                return g.Group == id / 64 && (g.Mask & (1llu << (id % 64)));
+            };
+
+        // Cores first, so that packages and nodes can be looked up by their masks
+        SmallVector<LogicalProcessor, SystemAllocator, 64> processors;
+        int numCores = 0;
+
+        for (DWORD offset = 0; offset < buffSize;)
+        {
+            auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+            offset += info->Size;
+
+            if (info->Relationship != RelationProcessorCore)
+                continue;
+
+            for (int g = 0; g < info->Processor.GroupCount; g++)
+            {
+                const GROUP_AFFINITY& group = info->Processor.GroupMask[g];
+                uint64_t mask = group.Mask;
+
+                while (mask)
+                {
+                    const int id = group.Group * 64 + (int)_tzcnt_u64(mask);
+                    processors.push_back(LogicalProcessor{ .ID = id, .Package = 0, .Core = numCores, .Node = 0,
+                        .EfficiencyClass = info->Processor.EfficiencyClass });
+                    mask &= mask - 1;
+                }
+            }
+
+            numCores++;
+        }
+
+        int numPackages = 0;
+
+        for (DWORD offset = 0; offset < buffSize;)
+        {
+            auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+            offset += info->Size;
+
+            if (info->Relationship == RelationProcessorPackage)
+            {
+                for (auto& p : processors)
+                {
+                    for (int g = 0; g < info->Processor.GroupCount; g++)
+                    {
+                        if (inMask(info->Processor.GroupMask[g], p.ID))
+                            p.Package = numPackages;
+                    }
+                }
+
+                numPackages++;
+            }
+            else if (info->Relationship == RelationNumaNode)
+            {
+                for (auto& p : processors)
+                {
+                    if (inMask(info->NumaNode.GroupMask, p.ID))
+                        p.Node = (int)info->NumaNode.NodeNumber;
+                }
+            }
+        }
+
+        topology.Build(processors);
+    }
+
+    void PinThread(HANDLE thread, int cpu)
+    {
+        GROUP_AFFINITY affinity{};
+        affinity.Group = (WORD)(cpu / 64);
+        affinity.Mask = (KAFFINITY)1 << (cpu % 64);
+
+        CheckWin32(SetThreadGroupAffinity(thread, &affinity, nullptr));
+    }
+
+    // Thread handle of the given thread index, must be called from the main thread
+    HANDLE ThreadHandle(int threadIdx)
+    {
+        const int numWorkers = g_app->m_processorCoreCount;
+
+        return threadIdx == 0 ? GetCurrentThread() :
+            threadIdx < numWorkers ? g_app->m_workerThreadPool.ThreadHandle(threadIdx - 1) :
+            g_app->m_backgroundThreadPool.ThreadHandle(threadIdx - numWorkers);
+    }
+
+    // Threads that the policy doesn't pin get their default affinity back. Must be called
+    // from the main thread when no frame memory is in use (the thread nodes decide which
+    // node's frame memory is used).
+    void PinThreads(THREAD_PINNING policy)
+    {
+        const int totalNumThreads = g_app->m_processorCoreCount + AppData::NUM_BACKGROUND_THREADS;
+        int cpus[ZETA_MAX_NUM_THREADS];
+        g_app->m_cpuTopology.AssignThreads(policy, g_app->m_processorCoreCount,
+            AppData::NUM_BACKGROUND_THREADS, MutableSpan(cpus, totalNumThreads));
+
+        for (int i = 0; i < totalNumThreads; i++)
+        {
+            g_app->m_frameMemoryContext.m_threadNodes[i] = cpus[i] != CpuTopology::UNPINNED ?
+                g_app->m_cpuTopology.NodeOf(cpus[i]) :
+                0;
+
+            if (cpus[i] == CpuTopology::UNPINNED)
+            {
+                CheckWin32(SetThreadGroupAffinity(ThreadHandle(i),
+                    &g_app->m_frameMemoryContext.m_defaultAffinities[i], nullptr));
+            }
+            else
+                PinThread(ThreadHandle(i), cpus[i]);
+        }
+
+        g_app->m_pinning = policy;
+    }
+
+    void PinThreadsIfQueued()
+    {
+        if (g_app->m_issuePinning)
+        {
+            if (g_app->m_queuedPinning != g_app->m_pinning)
+            {
+                PinThreads(g_app->m_queuedPinning);
+                LOG_UI(INFO, "Thread pinning changed to %s.",
+                    AppData::PINNING_OPTIONS[(int)g_app->m_pinning]);
+            }
+
+            g_app->m_issuePinning = false;
+        }
+    }
+
+    ZetaInline int FindThreadIdx()
     {
         const ZETA_THREAD_ID_TYPE id = GetCurrentThreadId();
 
@@ -1293,6 +1478,12 @@ namespace ZetaRay::AppImpl
             }
         }
 
+        return ret;
+    }
+
+    ZetaInline int GetThreadIdx()
+    {
+        const int ret = FindThreadIdx();
         Assert(ret != -1, "thread index was not found.");
 
         return ret;
@@ -1310,6 +1501,8 @@ namespace ZetaRay::AppImpl
 
         const int threadIdx = GetThreadIdx();
         Assert(threadIdx != -1, "thread idx was not found");
+        const int node = context.m_threadNodes[threadIdx];
+        const int osNodeID = g_app->m_cpuTopology.OsNodeID(node);
 
         // current memory block has enough space
         int allocIdx = context.m_threadFrameAllocIndices[threadIdx];
@@ -1317,7 +1510,7 @@ namespace ZetaRay::AppImpl
         // first time in this frame
         if (allocIdx != -1)
         {
-            auto& block = frameMemory.GetAndInitIfEmpty(allocIdx);
+            auto& block = frameMemory.GetAndInitIfEmpty(node, allocIdx, osNodeID);
 
             const uintptr_t start = reinterpret_cast<uintptr_t>(block.Start);
             const uintptr_t ret = Math::AlignUp(start + block.Offset, alignment);
@@ -1331,9 +1524,9 @@ namespace ZetaRay::AppImpl
         }
 
         // allocate/reuse a new block
-        allocIdx = context.m_currFrameAllocIndex.fetch_add(1, std::memory_order_relaxed);
+        allocIdx = context.m_currFrameAllocIndex[node].fetch_add(1, std::memory_order_relaxed);
         context.m_threadFrameAllocIndices[threadIdx] = allocIdx;
-        auto& block = frameMemory.GetAndInitIfEmpty(allocIdx);
+        auto& block = frameMemory.GetAndInitIfEmpty(node, allocIdx, osNodeID);
         Assert(block.Offset == 0, "block offset should be initially 0");
 
         const uintptr_t start = reinterpret_cast<uintptr_t>(block.Start);
@@ -1351,43 +1544,12 @@ namespace ZetaRay
 {
     CpuInfo App::GetProcessorInfo()
     {
-        DWORD buffSize = 0;
-        GetLogicalProcessorInformation(nullptr, &buffSize);
-        Assert(GetLastError() == ERROR_INSUFFICIENT_BUFFER, "GetLogicalProcessorInformation() failed.");
-
-        SmallVector<unsigned char, SystemAllocator, 1024> buffer;
-        buffer.resize(buffSize);
-        SYSTEM_LOGICAL_PROCESSOR_INFORMATION* dataPtr =
-            reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION*>(buffer.data());
-
-        bool rc = GetLogicalProcessorInformation(dataPtr, &buffSize);
-        Assert(rc, "GetLogicalProcessorInformation() failed.");
-
-        const int n = buffSize / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
-        SYSTEM_LOGICAL_PROCESSOR_INFORMATION* curr = dataPtr;
-        //int logicalProcessorCount = 0;
+        CpuTopology topology;
+        AppImpl::DetectCpuTopology(topology);
 
-        CpuInfo ret{};
-
-        for (int i = 0; i < n; i++)
-        {
-            switch (curr->Relationship)
-            {
-            case RelationProcessorCore:
-                ret.NumPhysicalCores++;
-
-                // A hyperthreaded core supplies more than one logical processor.
-                ret.NumLogicalCores += (int)__popcnt64(curr->ProcessorMask);
-                break;
-
-            default:
-                break;
-            }
-
-            curr++;
-        }
-
-        return ret;
+        return CpuInfo{ .NumPhysicalCores = topology.NumPhysicalCores(),
+            .NumLogicalCores = topology.NumLogicalProcessors(),
+            .NumNumaNodes = topology.NumNodes() };
     }
 
     ZETA_THREAD_ID_TYPE App::GetCurrentThreadID()
@@ -1395,14 +1557,9 @@ namespace ZetaRay
         return GetCurrentThreadId();
     }
 
-    ZETA_THREAD_ID_TYPE App::GetThreadID(void* handle)
+    int App::GetCurrentThreadIdx()
     {
-        Assert(handle, "Invalid handle.");
-
-        auto id = GetThreadId(handle);
-        CheckWin32(id);
-
-        return id;
+        return g_app ? AppImpl::FindThreadIdx() : -1;
     }
 
     void App::SetThreadPriority(void* handle, THREAD_PRIORITY priority)
@@ -1471,9 +1628,10 @@ namespace ZetaRay
         CheckWin32(instance);
 
         g_app = new (std::nothrow) AppData;
+        g_app->m_startupTimer.Start();
 
-        CpuInfo cpuInfo = App::GetProcessorInfo();
-        g_app->m_processorCoreCount = (uint16)Min(cpuInfo.NumPhysicalCores,
+        AppImpl::DetectCpuTopology(g_app->m_cpuTopology);
+        g_app->m_processorCoreCount = (uint16)Min(g_app->m_cpuTopology.NumPhysicalCores(),
             (ZETA_MAX_NUM_THREADS - AppData::NUM_BACKGROUND_THREADS));
 
         // create the window
@@ -1492,9 +1650,20 @@ namespace ZetaRay
             L"ZetaBackgroundWorker",
             THREAD_PRIORITY::BACKGROUND);
 
+        // Threads are left to the scheduler until pinning is enabled (see the "Thread Pinning"
+        // param)
+        for (int i = 0; i < totalNumThreads; i++)
+        {
+            CheckWin32(GetThreadGroupAffinity(AppImpl::ThreadHandle(i),
+                &g_app->m_frameMemoryContext.m_defaultAffinities[i]));
+        }
+
+        AppImpl::PinThreads(g_app->m_pinning);
+
         // initialize frame allocators
         memset(g_app->m_frameMemoryContext.m_threadFrameAllocIndices, -1, sizeof(int) * ZETA_MAX_NUM_THREADS);
-        g_app->m_frameMemoryContext.m_currFrameAllocIndex.store(0, std::memory_order_release);
+        for (int i = 0; i < CpuTopology::MAX_NUM_NODES; i++)
+            g_app->m_frameMemoryContext.m_currFrameAllocIndex[i].store(0, std::memory_order_release);
 
         memset(g_app->m_threadIDs, 0, ZetaArrayLen(g_app->m_threadIDs) * sizeof(uint32_t));
 
@@ -1546,9 +1715,23 @@ namespace ZetaRay
             g_app->m_cameraAcceleration, 1.0f, 100.0f, 1.0f, "Motion");
         App::AddParam(acc);
 
+        ParamVariant framesInFlight;
+        framesInFlight.InitInt(ICON_FA_FILM " Renderer", "Frame Pipeline", "Frames In Flight",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetFramesInFlight),
+            g_app->m_framePipeline.GetFramesInFlight(), 1, FramePipeline::MAX_FRAMES_IN_FLIGHT, 1);
+        App::AddParam(framesInFlight);
+
+        ParamVariant pinning;
+        pinning.InitEnum(ICON_FA_FILM " Renderer", "Frame Pipeline", "Thread Pinning",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetThreadPinning),
+            AppData::PINNING_OPTIONS, ZetaArrayLen(AppData::PINNING_OPTIONS), (int)g_app->m_pinning);
+        App::AddParam(pinning);
+
         g_app->m_isInitialized = true;
 
-        LOG_UI(INFO, "Detected %d physical CPU cores", g_app->m_processorCoreCount);
+        LOG_UI(INFO, "Detected %d physical CPU cores (%d logical) on %d NUMA node(s)",
+            g_app->m_cpuTopology.NumPhysicalCores(), g_app->m_cpuTopology.NumLogicalProcessors(),
+            g_app->m_cpuTopology.NumNodes());
         LOG_UI(INFO, "Work area on the primary display monitor is %dx%d", 
             g_app->m_displayWidth, g_app->m_displayHeight);
     }
@@ -1630,23 +1813,33 @@ namespace ZetaRay
                 continue;
 
             // at this point, all worker tasks from previous frame are done (GPU may still be executing those though)
-            g_app->m_currTaskSignalIdx.store(0, std::memory_order_relaxed);
+            g_app->m_taskSignals.Reset();
             const size_t tempMemoryUsed = g_app->m_frameMemory.TotalSize();
 
             // Skip first frame
             if (g_app->m_timer.GetTotalFrameCount() > 0)
             {
-                g_app->m_frameMemoryContext.m_currFrameAllocIndex.store(0, std::memory_order_release);
+                for (int i = 0; i < CpuTopology::MAX_NUM_NODES; i++)
+                    g_app->m_frameMemoryContext.m_currFrameAllocIndex[i].store(0, std::memory_order_release);
                 for (int i = 0; i < ZETA_MAX_NUM_THREADS; i++)
                     g_app->m_frameMemoryContext.m_threadFrameAllocIndices[i] = -1;
                 g_app->m_frameMemory.Reset();        // set the offset to 0, essentially releasing the memory
             }
 
+            // Frame memory was just released, so threads can move to a different node
+            AppImpl::PinThreadsIfQueued();
+
+            // Blocks until the GPU has finished frame N - (frames in flight)
+            const uint64_t pipelineFrame = g_app->m_framePipeline.BeginFrame(
+                fastdelegate::MakeDelegate(&g_app->m_renderer, &RendererCore::WaitForFrame));
+
             g_app->m_renderer.BeginFrame();
             // Startup is counted as "frame" 0, so program loop starts from frame 1
             g_app->m_timer.Tick();
             AppImpl::ResizeIfQueued();
 
+            g_app->m_framePipeline.BeginStage(pipelineFrame, FRAME_STAGE::UPDATE);
+
             // update app
             {
                 TaskSet appTS;
@@ -1694,6 +1887,7 @@ namespace ZetaRay
             while (!success)
                 success = g_app->m_workerThreadPool.TryFlush();
 
+            g_app->m_framePipeline.EndStage(pipelineFrame, FRAME_STAGE::UPDATE);
             g_app->m_frameMotion.Reset();
 
             // render
@@ -1701,10 +1895,27 @@ namespace ZetaRay
                 TaskSet renderTS;
                 TaskSet endFrameTS;
 
+                g_app->m_framePipeline.BeginStage(pipelineFrame, FRAME_STAGE::RECORD);
+
                 g_app->m_scene.Render(renderTS);
                 renderTS.Sort();
 
+                // endFrameTS starts once all of renderTS has finished
+                auto h0 = endFrameTS.EmplaceTask("BeginSubmitStage", [pipelineFrame]()
+                    {
+                        g_app->m_framePipeline.EndStage(pipelineFrame, FRAME_STAGE::RECORD);
+                        g_app->m_framePipeline.BeginStage(pipelineFrame, FRAME_STAGE::SUBMIT);
+                    });
+
                 g_app->m_renderer.EndFrame(endFrameTS);
+                endFrameTS.AddOutgoingEdgeToAll(h0);
+
+                auto h1 = endFrameTS.EmplaceTask("EndSubmitStage", [pipelineFrame]()
+                    {
+                        g_app->m_framePipeline.EndStage(pipelineFrame, FRAME_STAGE::SUBMIT);
+                    });
+
+                endFrameTS.AddIncomingEdgeFromAll(h1);
                 endFrameTS.Sort();
 
                 renderTS.ConnectTo(endFrameTS);
@@ -1716,7 +1927,27 @@ namespace ZetaRay
                 Submit(ZetaMove(endFrameTS));
             }
 
+            // Simulate the next frame while this one is being recorded. Render tasks only read
+            // the state that scene update publishes (e.g. picked instances, TLAS), so they're
+            // unaffected. Scene update for the next frame then just applies the results. Elapsed
+            // time of the next frame isn't known yet, use this frame's instead.
+            {
+                TaskSet simTS;
+                g_app->m_scene.Simulate(g_app->m_timer.GetTotalFrameCount() + 1,
+                    g_app->m_timer.GetTotalTime() + g_app->m_timer.GetElapsedTime(), simTS);
+
+                simTS.Sort();
+                simTS.Finalize();
+                Submit(ZetaMove(simTS));
+            }
+
             g_app->m_workerThreadPool.PumpUntilEmpty();
+
+            if (g_app->m_timer.GetTotalFrameCount() == 1)
+            {
+                g_app->m_startupTimer.End();
+                LOG_UI(INFO, "Time to first frame: %u [ms]", (uint32_t)g_app->m_startupTimer.DeltaMilli());
+            }
         }
 
         return (int)msg.wParam;
@@ -1734,55 +1965,24 @@ namespace ZetaRay
             g_app->m_frameMemoryContext, size, alignment);
     }
 
-    int App::RegisterTask()
+    int App::RegisterTask(const char* name)
     {
-        int idx = g_app->m_currTaskSignalIdx.fetch_add(1, std::memory_order_relaxed);
-        Assert(idx < AppData::MAX_NUM_TASKS_PER_FRAME, 
-            "Number of task signals exceeded MAX_NUM_TASKS_PER_FRAME.");
-
-        return idx;
+        return g_app->m_taskSignals.Register(name);
     }
 
     void App::TaskFinalizedCallback(int handle, int indegree)
     {
-        Assert(indegree > 0, "Redundant call.");
-        const int c = g_app->m_currTaskSignalIdx.load(std::memory_order_relaxed);
-        Assert(handle < c, "Received handle %d while #handles for current frame is %d.", c);
-
-        g_app->m_registeredTasks[handle].Indegree.store(indegree, std::memory_order_release);
-        g_app->m_registeredTasks[handle].BlockFlag.store(true, std::memory_order_release);
+        g_app->m_taskSignals.Finalize(handle, indegree);
     }
 
     void App::WaitForAdjacentHeadNodes(int handle)
     {
-        const int c = g_app->m_currTaskSignalIdx.load(std::memory_order_relaxed);
-        Assert(handle >= 0 && handle < c, "Received handle %d while #handles for current frame is %d.", c);
-
-        auto& taskSignal = g_app->m_registeredTasks[handle];
-        const int indegree = taskSignal.Indegree.load(std::memory_order_acquire);
-        Assert(indegree >= 0, "Invalid task indegree.");
-
-        if (indegree != 0)
-        {
-            taskSignal.BlockFlag.wait(true, std::memory_order_acquire);
-            return;
-        }
+        g_app->m_taskSignals.Wait(handle);
     }
 
     void App::SignalAdjacentTailNodes(Span<int> taskIDs)
     {
-        for (auto handle : taskIDs)
-        {
-            auto& taskSignal = g_app->m_registeredTasks[handle];
-            const int remaining = taskSignal.Indegree.fetch_sub(1, std::memory_order_acquire);
-
-            // this was the last dependency, unblock the task
-            if (remaining == 1)
-            {
-                taskSignal.BlockFlag.store(false, std::memory_order_release);
-                taskSignal.BlockFlag.notify_one();
-            }
-        }
+        g_app->m_taskSignals.Signal(taskIDs);
     }
 
     void App::Submit(Task&& t)
@@ -1879,7 +2079,7 @@ namespace ZetaRay
 
     SynchronizedMutableSpan<ParamVariant> App::GetParams()
     {
-        return SynchronizedMutableSpan<ParamVariant>(g_app->m_params, g_app->m_paramLock);
+        return SynchronizedMutableSpan<ParamVariant>(g_app->m_params.Params(), g_app->m_paramLock);
     }
 
     SynchronizedMutableSpan<ShaderReloadHandler> App::GetShaderReloadHandlers()
@@ -1889,72 +2089,59 @@ namespace ZetaRay
 
     SynchronizedSpan<Stat> App::GetStats()
     {
-        return SynchronizedSpan<Stat>(g_app->m_frameStats, g_app->m_statsLock);
+        return SynchronizedSpan<Stat>(g_app->m_frameStats.GetMerged(), g_app->m_statsLock);
     }
 
     void App::AddParam(ParamVariant& p)
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
-
-        g_app->m_paramsUpdates.push_back(ParamUpdate{
-            .P = p,
-            .Op = ParamUpdate::ADD });
-
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
+        g_app->m_params.Add(p);
     }
 
     void App::TryAddParam(ParamVariant& p)
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
-
-        // TODO Linear search can be slow if there are a lot of parameters
-        bool found = false;
-        for(auto& param : g_app->m_params)
-        {
-            if (param.ID() == p.ID())
-            {
-                found = true;
-                break;
-            }
-        }
-
-        if (!found)
-        {
-            g_app->m_paramsUpdates.push_back(ParamUpdate{
-                .P = p,
-                .Op = ParamUpdate::ADD });
-        }
-
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
+        g_app->m_params.TryAdd(p);
     }
 
     void App::RemoveParam(const char* group, const char* subgroup, const char* name)
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
+        g_app->m_params.Remove(group, subgroup, name);
+    }
+
+    bool App::FindParam(const char* group, const char* subgroup, const char* name, ParamVariant& param)
+    {
+        // Params may be added or removed (and moved) as soon as the lock is released, so
+        // a copy is returned rather than a pointer
+        g_app->m_paramLock.LockShared();
+        const ParamVariant* p = g_app->m_params.Find(group, subgroup, name);
+        if (p)
+            param = *p;
+        g_app->m_paramLock.UnlockShared();
 
-        // create a dummy ParamVariant (never exposed to outside)
-        ParamVariant dummy;
-        dummy.InitBool(group, subgroup, name, fastdelegate::FastDelegate1<const ParamVariant&>(), false);
+        return p != nullptr;
+    }
 
-        g_app->m_paramsUpdates.push_back(ParamUpdate{
-            .P = dummy,
-            .Op = ParamUpdate::REMOVE });
+    void App::SetParam(const char* group, const char* subgroup, const char* name, const char* value)
+    {
+        g_app->m_params.SetValue(group, subgroup, name, value);
+    }
 
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
+    bool App::LoadParams(const char* path)
+    {
+        return g_app->m_params.SetValuesFromFile(path);
     }
 
     void App::AddShaderReloadHandler(const char* name, fastdelegate::FastDelegate0<> dlg)
     {
-        AcquireSRWLockExclusive(&g_app->m_shaderReloadLock);
+        g_app->m_shaderReloadLock.LockExclusive();
         g_app->m_shaderReloadHandlers.emplace_back(name, dlg);
-        ReleaseSRWLockExclusive(&g_app->m_shaderReloadLock);
+        g_app->m_shaderReloadLock.UnlockExclusive();
     }
 
     void App::RemoveShaderReloadHandler(const char* name)
     {
         uint64_t id = XXH3_64bits(name, Math::Min(ShaderReloadHandler::MAX_LEN - 1, (int)strlen(name)));
 
-        AcquireSRWLockExclusive(&g_app->m_shaderReloadLock);
+        g_app->m_shaderReloadLock.LockExclusive();
         int i = 0;
         bool found = false;
 
@@ -1970,42 +2157,138 @@ namespace ZetaRay
         if (found)
             g_app->m_shaderReloadHandlers.erase_at_index(i);
 
-        ReleaseSRWLockExclusive(&g_app->m_shaderReloadLock);
+        g_app->m_shaderReloadLock.UnlockExclusive();
     }
 
     void App::AddFrameStat(const char* group, const char* name, int i)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, i);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, i);
     }
 
     void App::AddFrameStat(const char* group, const char* name, uint32_t u)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, u);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
     }
 
     void App::AddFrameStat(const char* group, const char* name, float f)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, f);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, f);
     }
 
     void App::AddFrameStat(const char* group, const char* name, uint64_t u)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, u);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
     }
 
     void App::AddFrameStat(const char* group, const char* name, uint32_t num, uint32_t total)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, num, total);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        const uint32_t id = g_app->m_frameStats.Register(group, name);
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, num, total);
+    }
+
+    uint32_t App::RegisterFrameStat(const char* group, const char* name)
+    {
+        return g_app->m_frameStats.Register(group, name);
+    }
+
+    void App::AddFrameStat(uint32_t id, int i)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, i);
+    }
+
+    void App::AddFrameStat(uint32_t id, uint32_t u)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
+    }
+
+    void App::AddFrameStat(uint32_t id, float f)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, f);
+    }
+
+    void App::AddFrameStat(uint32_t id, uint64_t u)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, u);
+    }
+
+    void App::AddFrameStat(uint32_t id, uint32_t num, uint32_t total)
+    {
+        g_app->m_frameStats.Add(AppImpl::GetThreadIdx(), id, num, total);
+    }
+
+    StatPercentiles App::GetFrameStatPercentiles(uint32_t id)
+    {
+        g_app->m_statsLock.LockShared();
+        const StatPercentiles ret = g_app->m_frameStats.GetPercentiles(id);
+        g_app->m_statsLock.UnlockShared();
+
+        return ret;
+    }
+
+    void App::SetFramesInFlight(int n)
+    {
+        g_app->m_framePipeline.SetFramesInFlight(n);
+    }
+
+    int App::GetFramesInFlight()
+    {
+        return g_app->m_framePipeline.GetFramesInFlight();
+    }
+
+    FramePipeline& App::GetFramePipeline()
+    {
+        return g_app->m_framePipeline;
+    }
+
+    const TaskSignalStats& App::GetTaskSignalStats()
+    {
+        return g_app->m_taskSignals.GetFrameStats();
+    }
+
+    const CpuTopology& App::GetCpuTopology()
+    {
+        return g_app->m_cpuTopology;
+    }
+
+    void App::BeginFrameStatsDump()
+    {
+        g_app->m_statsLock.LockExclusive();
+        g_app->m_frameStats.BeginDump();
+        g_app->m_statsLock.UnlockExclusive();
+    }
+
+    void App::EndFrameStatsDump(const char* path)
+    {
+        g_app->m_statsLock.LockExclusive();
+        g_app->m_frameStats.EndDump(path);
+        g_app->m_statsLock.UnlockExclusive();
+    }
+
+    void App::BeginFrameCapture()
+    {
+        g_app->m_frameCaptureBeginTime = g_app->m_timer.GetTotalTime();
+        g_app->m_frameCapture.Begin();
+    }
+
+    void App::EndFrameCapture(const char* path)
+    {
+        g_app->m_frameCapture.End(path);
+    }
+
+    bool App::IsCapturingFrames()
+    {
+        return g_app->m_frameCapture.IsRecording();
+    }
+
+    void App::CaptureTransformEdit(uint64_t instanceID, const float3& tr, const float3x3& rotation,
+        const float3& scale, bool nextFrame)
+    {
+        if (g_app->m_frameCapture.IsRecording())
+            g_app->m_frameCapture.RecordTransform(instanceID, tr, rotation, scale, nextFrame);
     }
 
     Span<float> App::GetFrameTimeHistory()
@@ -2016,9 +2299,9 @@ namespace ZetaRay
 
     void App::Log(const char* msg, LogMessage::MsgType t)
     {
-        AcquireSRWLockExclusive(&g_app->m_logLock);
+        g_app->m_logLock.LockExclusive();
         g_app->m_frameLogs.emplace_back(msg, t);
-        ReleaseSRWLockExclusive(&g_app->m_logLock);
+        g_app->m_logLock.UnlockExclusive();
     }
 
     Util::RWSynchronizedView<Vector<App::LogMessage, SystemAllocator>> App::GetLogs()
@@ -192,3 +192,39 @@ bool Filesystem::IsDirectory(const char* path)
 
     return ret & FILE_ATTRIBUTE_DIRECTORY;
 }
+
+void* Filesystem::OpenFileForRead(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    HANDLE h = CreateFileA(path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+    return h == INVALID_HANDLE_VALUE ? nullptr : h;
+}
+
+void Filesystem::CloseFile(void* file)
+{
+    if (file)
+        CloseHandle(file);
+}
+
+bool Filesystem::ReadFromFile(void* file, size_t offset, MutableSpan<uint8_t> data)
+{
+    Assert(file, "Invalid file handle.");
+    Assert(data.size() <= UINT32_MAX, "Read size is too large.");
+
+    // Reads with an explicit offset don't use or modify the shared file pointer
+    OVERLAPPED ov{};
+    ov.Offset = (DWORD)(offset & 0xffffffff);
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+
+    DWORD numRead;
+    const bool success = ReadFile(file, data.data(), (DWORD)data.size(), &numRead, &ov);
+
+    return success && numRead == (DWORD)data.size();
+}
\ No newline at end of file
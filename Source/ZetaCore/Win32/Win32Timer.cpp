@@ -15,6 +15,25 @@ Timer::Timer()
     m_counterFreqSec = freq.QuadPart;
 }
 
+int64_t Timer::NowNano()
+{
+    static const int64_t freq = []()
+        {
+            LARGE_INTEGER f;
+            CheckWin32(QueryPerformanceFrequency(&f));
+            return f.QuadPart;
+        }();
+
+    LARGE_INTEGER currCount;
+    CheckWin32(QueryPerformanceCounter(&currCount));
+
+    // Split to avoid overflow of counts * 10^9
+    const int64_t sec = currCount.QuadPart / freq;
+    const int64_t rem = currCount.QuadPart % freq;
+
+    return sec * 1'000'000'000 + (rem * 1'000'000'000) / freq;
+}
+
 void Timer::Start()
 {
     LARGE_INTEGER currCount;
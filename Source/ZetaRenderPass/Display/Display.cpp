@@ -240,7 +240,7 @@ void DisplayPass::Render(CommandList& cmdList)
     directCmdList.OMSetRenderTargets(1, &m_cpuDescs[(int)SHADER_IN_CPU_DESC::RTV], true, nullptr);
     directCmdList.DrawInstanced(3, 1, 0, 0);
 
-    if (auto picks = scene.GetPickedInstances().m_span; !picks.empty())
+    if (auto picks = scene.GetPickedInstanceStates(); !picks.empty())
         DrawPicked(directCmdList, picks);
 
     if (m_captureScreen)
@@ -290,7 +290,7 @@ void DisplayPass::Render(CommandList& cmdList)
     directCmdList.PIXEndEvent();
 }
 
-void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<uint64_t> picks)
+void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<PickedInstance> picks)
 {
     Assert(!picks.empty(), "Invalid argument.");
     const auto& camera = App::GetCamera();
@@ -302,10 +302,12 @@ void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<uint64_t> picks)
     v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(frustum));
     vFrustum = transform(vM, vFrustum);
 
-    for (auto ID : picks)
+    // Picked instances as of the last scene update, the scene may be simulating the next 
+    // frame while this one is being recorded
+    for (auto& picked : picks)
     {
-        v_AABB vBox(App::GetScene().GetAABB(ID));
-        v_float4x4 vW = load4x3(App::GetScene().GetToWorld(ID));
+        v_AABB vBox(picked.Bounds);
+        v_float4x4 vW = load4x3(picked.ToWorld);
         vBox = transform(vW, vBox);
 
         // Skip if outside the view frustum
@@ -315,9 +317,8 @@ void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<uint64_t> picks)
         // Draw mask
         {
             auto& scene = App::GetScene();
-            auto meshID = scene.GetInstanceMeshID(ID);
-            auto* mesh = scene.GetMesh(meshID).value();
-            float4x3 toWorld = scene.GetToWorld(ID);
+            auto* mesh = scene.GetMesh(picked.MeshID).value();
+            float4x3 toWorld = picked.ToWorld;
 
             const Camera& cam = App::GetCamera();
             v_float4x4 vView = load4x4(const_cast<float4x4a&>(cam.GetCurrView()));
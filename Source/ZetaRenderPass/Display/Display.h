@@ -22,6 +22,11 @@ namespace ZetaRay::Support
     struct ParamVariant;
 }
 
+namespace ZetaRay::Scene
+{
+    struct PickedInstance;
+}
+
 namespace ZetaRay::RenderPass
 {
     enum class DISPLAY_SHADER
@@ -120,7 +125,7 @@ namespace ZetaRay::RenderPass
             "Sobel_ps.cso" 
         };
 
-        void DrawPicked(Core::GraphicsCmdList& cmdList, Util::Span<uint64_t> picks);
+        void DrawPicked(Core::GraphicsCmdList& cmdList, Util::Span<Scene::PickedInstance> picks);
         void CreatePSOs();
         void ReadbackPickIdx();
         void ReadbackScreenCapture();
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <Scene/Camera.h>
 #include <Core/PipelineStateLibrary.h>
+#include <Core/RootSignature.h>
 #include <Utility/Utility.h>
 #include <Support/Task.h>
 #include <GBuffer/GenerateDepthBuffer.h>
@@ -859,6 +860,8 @@ namespace
             auto* device = App::GetRenderer().GetDevice();
             CheckHR(device->CreateRootSignature(0, outBlob->GetBufferPointer(), outBlob->GetBufferSize(),
                 IID_PPV_ARGS(g_fsr2Data->m_passes[pass].RootSig.GetAddressOf())));
+            SetRootSignatureHash(g_fsr2Data->m_passes[pass].RootSig.Get(), outBlob->GetBufferPointer(), 
+                outBlob->GetBufferSize());
         }
 
         // output
@@ -2,6 +2,10 @@
 #include <Core/CommandList.h>
 #include <Support/Param.h>
 #include <Support/Stat.h>
+#include <Support/FrameStats.h>
+#include <Support/FramePipeline.h>
+#include <Support/TaskSignalPool.h>
+#include <Support/MemoryReport.h>
 #include <Scene/SceneCore.h>
 #include <Scene/Camera.h>
 #include <App/Timer.h>
@@ -29,15 +33,9 @@ using namespace ZetaRay::Model;
 
 namespace
 {
+    // Params are already sorted by (group, subgroup, subsubgroup, name)
     void AddParamRange(MutableSpan<ParamVariant> params, int offset, int count)
     {
-        // Sort by name among current subgroup
-        std::sort(params.begin() + offset, params.begin() + offset + count, 
-            [](const ParamVariant& p1, const ParamVariant& p2)
-            {
-                return strcmp(p1.GetName(), p2.GetName()) < 0;
-            });
-
         for (int p = offset; p < offset + count; p++)
         {
             ParamVariant& param = params[p];
@@ -530,15 +528,17 @@ void GuiPass::RenderUI()
         float4x4a W;
         uint64_t firstPicked = Scene::INVALID_INSTANCE;
 
-        if (auto picks = scene.GetPickedInstances(); !picks.m_span.empty())
+        // Picked instances as of the last scene update, the scene may be simulating the 
+        // next frame while this one is being recorded
+        if (auto picks = scene.GetPickedInstanceStates(); !picks.empty())
         {
-            firstPicked = picks.m_span[0];
+            firstPicked = picks[0].ID;
 
-            W = float4x4a(scene.GetToWorld(firstPicked));
-            instanceMesh = *scene.GetInstanceMesh(firstPicked).value();
+            W = float4x4a(picks[0].ToWorld);
+            instanceMesh = *scene.GetMesh(picks[0].MeshID).value();
 
             if (m_gizmoActive)
-                RenderGizmo(picks.m_span, instanceMesh, W);
+                RenderGizmo(picks, instanceMesh, W);
         }
 
         RenderSettings(firstPicked, instanceMesh, W);
@@ -796,6 +796,26 @@ void GuiPass::RenderProfiler()
         for (auto s : App::GetStats().m_span)
             func(s);
 
+        ImGui::SeparatorText("Frame Pipeline");
+        ImGui::Text("\tFrames in flight: %d", App::GetFramesInFlight());
+
+        for (int i = 0; i <= (int)FRAME_STAGE::COUNT; i++)
+        {
+            const uint32_t id = App::RegisterFrameStat(FRAME_PIPELINE_STAT_GROUP, FRAME_PIPELINE_STAT_NAMES[i]);
+            const StatPercentiles p = App::GetFrameStatPercentiles(id);
+
+            ImGui::Text("\t%s: p50 %.2f, p95 %.2f, p99 %.2f", FRAME_PIPELINE_STAT_NAMES[i],
+                p.P50, p.P95, p.P99);
+        }
+
+        ImGui::SeparatorText("Task Stalls");
+        const TaskSignalStats& taskStats = App::GetTaskSignalStats();
+        ImGui::Text("\t%d/%d tasks blocked for %.2f ms", taskStats.NumBlocked, taskStats.NumTasks,
+            taskStats.BlockedMs);
+
+        for (int i = 0; i < taskStats.NumStalls; i++)
+            ImGui::Text("\t%s: %.3f ms", taskStats.Stalls[i].Name, taskStats.Stalls[i].BlockedMs);
+
         ImGui::SeparatorText("Scene");
         ImGui::Text("\t#Instances: %u", (uint32_t)scene.TotalNumInstances());
         ImGui::Text("\t#Meshes: %u", (uint32_t)scene.TotalNumMeshes());
@@ -803,6 +823,21 @@ void GuiPass::RenderProfiler()
         ImGui::Text("\t#Materials: %u", (uint32_t)scene.TotalNumMaterials());
         ImGui::Text("\t#Emissive Triangles: %u", (uint32_t)scene.NumEmissiveTriangles());
 
+        ImGui::SeparatorText("Scene Memory");
+
+        // Takes every scene lock, so only collected on request
+        if (ImGui::Button("Refresh"))
+        {
+            MemoryReport report;
+            scene.GetMemoryReport(report);
+
+            m_memoryReport.clear();
+            report.Print(m_memoryReport);
+        }
+
+        if (!m_memoryReport.empty())
+            ImGui::TextUnformatted(m_memoryReport.data(), m_memoryReport.data() + m_memoryReport.size());
+
         ImGui::Text("");
     }
 
@@ -999,7 +1034,7 @@ void GuiPass::RenderMainHeader()
     ImGui::End();
 }
 
-void GuiPass::RenderGizmo(Span<uint64_t> pickedIDs, const TriangleMesh& mesh, const float4x4a& W)
+void GuiPass::RenderGizmo(Span<PickedInstance> picks, const TriangleMesh& mesh, const float4x4a& W)
 {
     if (!ImGuizmo::IsUsingAny())
     {
@@ -1033,8 +1068,8 @@ void GuiPass::RenderGizmo(Span<uint64_t> pickedIDs, const TriangleMesh& mesh, co
 
     if (modified)
     {
-        for(auto ID : pickedIDs)
-            App::GetScene().TransformInstance(ID, dt, float3x3(dr), ds);
+        for(auto& picked : picks)
+            App::GetScene().TransformInstance(picked.ID, dt, float3x3(dr), ds);
     }
 }
 
@@ -1115,36 +1150,28 @@ void GuiPass::CameraTab()
     {
         auto params = App::GetParams();
 
-        // Partition by "Scene"
-        auto firstNonScene = std::partition(params.m_span.begin(), params.m_span.end(), 
-            [](const ParamVariant& p)
-            {
-                return strcmp(p.GetGroup(), ICON_FA_LANDMARK " Scene") == 0;
-            });
-        // Partition by "Camera"
-        auto firstNonCamera = std::partition(params.m_span.begin(), firstNonScene, 
-            [](const ParamVariant& p)
+        auto isCamera = [](const ParamVariant& p)
             {
-                return strcmp(p.GetSubGroup(), "Camera") == 0;
-            });
-        const int numCameraParams = (int)(firstNonCamera - params.m_span.data());
-        if (numCameraParams == 0)
-            return;
+                return strcmp(p.GetGroup(), ICON_FA_LANDMARK " Scene") == 0 &&
+                    strcmp(p.GetSubGroup(), "Camera") == 0;
+            };
 
-        std::sort(params.m_span.begin(), firstNonCamera,
-            [](const ParamVariant& p1, const ParamVariant& p2)
-            {
-                return strcmp(p1.GetSubSubGroup(), p2.GetSubSubGroup()) < 0;
-            });
+        // Params are sorted, so camera params are contiguous and sorted by subsubgroup
+        auto firstCamera = std::find_if(params.m_span.begin(), params.m_span.end(), isCamera);
+        auto firstNonCamera = std::find_if_not(firstCamera, params.m_span.end(), isCamera);
+        const int cameraBeg = (int)(firstCamera - params.m_span.begin());
+        const int cameraEnd = (int)(firstNonCamera - params.m_span.begin());
+        if (cameraBeg == cameraEnd)
+            return;
 
         char curr[ParamVariant::MAX_SUBSUBGROUP_LEN];
-        size_t len = strlen(params.m_span[0].GetSubSubGroup());
-        memcpy(curr, params.m_span[0].GetSubSubGroup(), len);
+        size_t len = strlen(params.m_span[cameraBeg].GetSubSubGroup());
+        memcpy(curr, params.m_span[cameraBeg].GetSubSubGroup(), len);
         curr[len] = '\0';
-        int beg = 0;
-        int i = 0;
+        int beg = cameraBeg;
+        int i = cameraBeg;
 
-        for (i = 0; i < numCameraParams; i++)
+        for (i = cameraBeg; i < cameraEnd; i++)
         {
             if (strcmp(params.m_span[i].GetSubSubGroup(), curr) != 0)
             {
@@ -1176,13 +1203,8 @@ void GuiPass::ParameterTab()
 
     ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.55f);
 
-    // Sort by group
-    std::sort(params.m_span.begin(), params.m_span.end(), 
-        [](const ParamVariant& p1, const ParamVariant& p2)
-        {
-            return strcmp(p1.GetGroup(), p2.GetGroup()) < 0;
-        });
-
+    // Params are already sorted by (group, subgroup, subsubgroup, name), so every group,
+    // subgroup and subsubgroup is a contiguous range
     for (int currGroupIdx = 0; currGroupIdx < (int)params.m_span.size();)
     {
         ParamVariant& currParam_g = params.m_span[currGroupIdx];
@@ -1200,13 +1222,6 @@ void GuiPass::ParameterTab()
         {
             char currSubGroup[ParamVariant::MAX_SUBGROUP_LEN];
 
-            // Sort by subgroup among current group
-            std::sort(params.m_span.begin() + currGroupIdx, params.m_span.begin() + nextGroupIdx,
-                [](const ParamVariant& p1, const ParamVariant& p2)
-                {
-                    return strcmp(p1.GetSubGroup(), p2.GetSubGroup()) < 0;
-                });
-
             // Add the parameters in this subgroup
             for (int currSubgroupIdx = currGroupIdx; currSubgroupIdx < nextGroupIdx;)
             {
@@ -1217,7 +1232,7 @@ void GuiPass::ParameterTab()
                 currSubGroup[subGroupLen] = '\0';
 
                 int nextSubgroupIdx = currSubgroupIdx;
-                while (nextSubgroupIdx < params.m_span.size() &&
+                while (nextSubgroupIdx < nextGroupIdx &&
                     (strcmp(params.m_span[nextSubgroupIdx].GetSubGroup(), currSubGroup) == 0))
                     nextSubgroupIdx++;
 
@@ -1243,13 +1258,6 @@ void GuiPass::ParameterTab()
                         }
                     }
 
-                    // Sort by subsubgroup among current subgroup
-                    std::sort(params.m_span.begin() + currSubgroupIdx, params.m_span.begin() + nextSubgroupIdx,
-                        [](const ParamVariant& p1, const ParamVariant& p2)
-                        {
-                            return strcmp(p1.GetSubSubGroup(), p2.GetSubSubGroup()) < 0;
-                        });
-
                     if (hasSubsubgroups)
                     {
                         for (int currSubsubgroupIdx = currSubgroupIdx; currSubsubgroupIdx < nextSubgroupIdx;)
@@ -1260,7 +1268,7 @@ void GuiPass::ParameterTab()
                             currSubsubGroup[subSubgroupLen] = '\0';
 
                             int nextSubsubgroupIdx = currSubsubgroupIdx;
-                            while (nextSubsubgroupIdx < params.m_span.size() &&
+                            while (nextSubsubgroupIdx < nextSubgroupIdx &&
                                 (strcmp(params.m_span[nextSubsubgroupIdx].GetSubSubGroup(), currSubsubGroup) == 0))
                                 nextSubsubgroupIdx++;
 
@@ -1421,7 +1429,15 @@ void GuiPass::PickedWorldTransform(uint64 pickedID, const TriangleMesh& mesh, co
 
         if (isLocal)
         {
-            prevTr = scene.GetLocalTransform(pickedID);
+            for (auto& picked : scene.GetPickedInstanceStates())
+            {
+                if (picked.ID == pickedID)
+                {
+                    prevTr = picked.LocalTransform;
+                    break;
+                }
+            }
+
             newTr = prevTr;
         }
         else
@@ -16,6 +16,11 @@ namespace ZetaRay::Model
     struct TriangleMesh;
 }
 
+namespace ZetaRay::Scene
+{
+    struct PickedInstance;
+}
+
 namespace ZetaRay::RenderPass
 {
     struct GuiPass final : public RenderPassBase<1>
@@ -56,7 +61,7 @@ namespace ZetaRay::RenderPass
         void RenderLogWindow();
         void RenderMainHeader();
         void RenderToolbar();
-        void RenderGizmo(Util::Span<uint64> pickedIDs, const Model::TriangleMesh& mesh, 
+        void RenderGizmo(Util::Span<Scene::PickedInstance> picks, const Model::TriangleMesh& mesh, 
             const Math::float4x4a& W);
         void InfoTab();
         void CameraTab();
@@ -78,6 +83,8 @@ namespace ZetaRay::RenderPass
         ImGuiFrameBufferData m_imguiFrameBuffs[Core::Constants::NUM_BACK_BUFFERS];
         D3D12_CPU_DESCRIPTOR_HANDLE m_cpuDescriptors[SHADER_IN_CPU_DESC::COUNT] = { 0 };
         Util::SmallVector<Core::GpuTimer::Timing> m_cachedTimings;
+        // Text of the last scene memory report
+        Util::SmallVector<char> m_memoryReport;
 
         int m_currShader = -1;
         float m_dbgWndWidthPct = 0.21f;
@@ -21,143 +21,6 @@ using namespace ZetaRay::Util;
 using namespace ZetaRay::App;
 using namespace ZetaRay::Math;
 
-namespace
-{
-    // Ref: https://www.keithschwarz.com/darts-dice-coins/
-    void BuildAliasTable(MutableSpan<float> probs, MutableSpan<RT::EmissiveLumenAliasTableEntry> table)
-    {
-        const int64_t N = probs.size();
-        const float oneDivN = 1.0f / N;
-        AliasTable_Normalize(probs);
-
-        for (int64_t i = 0; i < N; i++)
-        {
-            table[i].CachedP_Orig = probs[i] * oneDivN;
-#ifndef NDEBUG
-            table[i].Alias = UINT32_MAX;
-#endif
-        }
-
-        struct TempAllocator
-        {
-            void* AllocateAligned(size_t size, size_t alignment)
-            {
-                m_offset += size;
-                Assert(m_offset <= m_sizeInBytes, "bug");
-
-                return m_memPtr;
-            }
-
-            ZetaInline void FreeAligned(void* mem, size_t size, size_t alignment)
-            {}
-
-            void* m_memPtr;
-            size_t m_sizeInBytes;
-            size_t m_offset = 0;
-        };
-
-        const size_t sizeInBytes = N * sizeof(uint32_t);
-        const size_t totalSizeInBytes = 2 * sizeInBytes;
-        App::OneTimeFrameAllocatorWithFallback allocator;
-        void* mem = allocator.AllocateAligned(totalSizeInBytes);
-
-        TempAllocator tempAllocator1{
-            .m_memPtr = mem,
-            .m_sizeInBytes = sizeInBytes };
-        TempAllocator tempAllocator2{
-            .m_memPtr = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(mem) + sizeInBytes),
-            .m_sizeInBytes = sizeInBytes };
-
-        // maintain an index buffer since original ordering of elements must be preserved
-        SmallVector<uint32_t, TempAllocator> larger(tempAllocator1);
-        larger.reserve(N);
-
-        SmallVector<uint32_t, TempAllocator> smaller(tempAllocator2);
-        smaller.reserve(N);
-
-        for (int64_t i = 0; i < N; i++)
-        {
-            if (probs[i] < 1.0f)
-                smaller.push_back((uint32_t)i);
-            else
-                larger.push_back((uint32_t)i);
-        }
-
-#ifndef NDEBUG
-        int64_t numInsertions = 0;
-#endif
-
-        // in each iteration, pick two probabilities such that one is smaller than 1.0 and the other larger 
-        // than 1.0. Use the latter to bring up the former to 1.0.
-        while (!smaller.empty() && !larger.empty())
-        {
-            const uint32_t smallerIdx = smaller.back();
-            smaller.pop_back();
-            const float smallerProb = probs[smallerIdx];
-
-            const uint32_t largerIdx = larger.back();
-            float largerProb = probs[largerIdx];
-            Assert(largerProb >= 1.0f, "should be >= 1.0");
-
-            RT::EmissiveLumenAliasTableEntry& e = table[smallerIdx];
-            Assert(e.Alias == uint32_t(-1), "Every element must be inserted exactly one time.");
-            e.Alias = largerIdx;
-            e.P_Curr = smallerProb;
-
-            // = largerProb - (1.0f - smallerProb);
-            largerProb = (smallerProb + largerProb) - 1.0f;
-            probs[largerIdx] = largerProb;
-
-            if (largerProb < 1.0f)
-            {
-                larger.pop_back();
-                smaller.push_back(largerIdx);
-            }
-
-#ifndef NDEBUG
-            numInsertions++;
-#endif
-        }
-
-        while (!larger.empty())
-        {
-            size_t idx = larger.back();
-            larger.pop_back();
-            //Assert(fabsf(1.0f - probs[idx]) <= 0.1f, "This should be ~1.0.");
-
-            // alias should point to itself
-            table[idx].Alias = (uint32_t)idx;
-            table[idx].P_Curr = 1.0f;
-
-#ifndef NDEBUG
-            numInsertions++;
-#endif
-        }
-
-        while (!smaller.empty())
-        {
-            size_t idx = smaller.back();
-            smaller.pop_back();
-            //Assert(fabsf(1.0f - probs[idx]) <= 0.1f, "This should be ~1.0.");
-
-            // alias should point to itself
-            table[idx].Alias = (uint32_t)idx;
-            table[idx].P_Curr = 1.0f;
-
-#ifndef NDEBUG
-            numInsertions++;
-#endif
-        }
-
-        Assert(numInsertions == N, "Some elements were not inserted.");
-
-        for (int64_t i = 0; i < N; i++)
-            table[i].CachedP_Alias = table[table[i].Alias].CachedP_Orig;
-
-        allocator.FreeAligned(mem, sizeInBytes);
-    }
-}
-
 //--------------------------------------------------------------------------------------
 // PreLighting
 //--------------------------------------------------------------------------------------
@@ -482,6 +345,11 @@ void EmissiveTriangleAliasTable::Update(ReadbackHeapBuffer* readback)
     Assert(readback, "Readback buffer was NULL.");
     m_readback = readback;
 
+    // A pending build of the previous estimate is superseded -- its readback is going to be
+    // overwritten
+    m_fence = UINT64_MAX;
+    m_tableBuilt = false;
+
     const size_t currBuffLen = m_aliasTable.IsInitialized() ? 
         m_aliasTable.Desc().Width / sizeof(float) : 0;
     m_currNumTris = (uint32_t)App::GetScene().NumEmissiveTriangles();
@@ -500,6 +368,92 @@ void EmissiveTriangleAliasTable::Update(ReadbackHeapBuffer* readback)
     }
 }
 
+void EmissiveTriangleAliasTable::InitBuild(int numChunks)
+{
+    // Safe to map, related fence has passed. Unmapping happens automatically when readback 
+    // buffer is released.
+    m_readback->Map();
+    float* data = reinterpret_cast<float*>(m_readback->MappedMemory());
+
+    // Frame allocator is used if the size allows, otherwise malloc
+    m_table = SmallVector<RT::EmissiveLumenAliasTableEntry, Allocator>();
+    m_table.resize(m_currNumTris);
+
+    m_builder.Clear();
+    m_builder.Init(Span(data, m_currNumTris), numChunks);
+}
+
+void EmissiveTriangleAliasTable::SetEntry(uint32_t i, float pCurr, uint32_t alias)
+{
+    const float oneDivN = 1.0f / m_currNumTris;
+
+    RT::EmissiveLumenAliasTableEntry& e = m_table[i];
+    e.CachedP_Orig = m_builder.NormalizedWeight(i) * oneDivN;
+    e.CachedP_Alias = m_builder.NormalizedWeight(alias) * oneDivN;
+    e.P_Curr = pCurr;
+    e.Alias = alias;
+}
+
+void EmissiveTriangleAliasTable::SubmitBuild()
+{
+    // Fence is known once the pass has been recorded (see Render())
+    if (m_fence == UINT64_MAX || m_tableBuilt || 
+        !App::GetRenderer().IsDirectQueueFenceComplete(m_fence))
+    {
+        return;
+    }
+
+    const int numChunks = (int)Min(Max(m_currNumTris / MIN_NUM_TRIS_PER_CHUNK, (size_t)1),
+        (size_t)MAX_NUM_CHUNKS);
+    InitBuild(numChunks);
+
+    // Every step depends on all the chunks of the previous step
+    TaskSet ts;
+    TaskSet::TaskHandle prev[MAX_NUM_CHUNKS];
+    TaskSet::TaskHandle curr[MAX_NUM_CHUNKS];
+
+    for (int step = 0; step < 4; step++)
+    {
+        for (int c = 0; c < m_builder.NumChunks(); c++)
+        {
+            StackStr(buff, n, "AliasTable_%d_%d", step, c);
+
+            curr[c] = ts.EmplaceTask(buff, [this, step, c]()
+                {
+                    switch (step)
+                    {
+                    case 0:
+                        m_builder.Sum(c);
+                        break;
+                    case 1:
+                        m_builder.Classify(c);
+                        break;
+                    case 2:
+                        m_builder.Partition(c);
+                        break;
+                    default:
+                        m_builder.Assign(c, [this](uint32_t i, float pCurr, uint32_t alias)
+                            {
+                                SetEntry(i, pCurr, alias);
+                            });
+                    }
+                });
+
+            for (int p = 0; step > 0 && p < m_builder.NumChunks(); p++)
+                ts.AddOutgoingEdge(prev[p], curr[c]);
+        }
+
+        memcpy(prev, curr, sizeof(curr));
+    }
+
+    ts.Sort();
+    ts.Finalize();
+    App::Submit(ZetaMove(ts));
+
+    // Not waited on -- update, including these tasks, finishes before rendering starts
+    m_tableBuilt = true;
+}
+
 void EmissiveTriangleAliasTable::SetEmissiveTriPassHandle(RenderNodeHandle& emissiveTriHandle)
 {
     Assert(emissiveTriHandle.IsValid(), "invalid handle.");
@@ -520,46 +474,43 @@ void EmissiveTriangleAliasTable::Render(CommandList& cmdList)
         m_fence;
     Assert(m_fence != UINT64_MAX, "Invalid fence value.");
 
-    // For 1st frame, wait until GPU finishes copying data to readback buffer. For subsequent
-    // frames, check the fence and defer to next frame if not ready.
-    if(App::GetTimer().GetTotalFrameCount() <= 1)
-        renderer.WaitForDirectQueueFenceCPU(m_fence);
-    else if (!renderer.IsDirectQueueFenceComplete(m_fence))
+    // For 1st frame, light presampling needs the table in the next frame, so wait until GPU
+    // finishes copying data to readback buffer and build it here. As this runs in a 
+    // render-graph task, which can't wait for other tasks, it's built as a single chunk. For
+    // subsequent frames, it's built by the tasks from SubmitBuild() once the fence has passed.
+    if (App::GetTimer().GetTotalFrameCount() <= 1)
     {
-        LOG_UI_INFO("Alias table - fence hasn't passed, returning...");
-        return;
-    }
+        renderer.WaitForDirectQueueFenceCPU(m_fence);
 
-    // Try to use frame allocator first, if it fails (allocation size exceeded per-frame max),
-    // use malloc instead
-    SmallVector<RT::EmissiveLumenAliasTableEntry, App::OneTimeFrameAllocatorWithFallback> table;
-    table.resize(m_currNumTris);
+        App::DeltaTimer timer;
+        timer.Start();
 
-    App::DeltaTimer timer;
-    timer.Start();
+        InitBuild(1);
+        m_builder.Sum(0);
+        m_builder.Classify(0);
+        m_builder.Partition(0);
+        m_builder.Assign(0, [this](uint32_t i, float pCurr, uint32_t alias)
+            {
+                SetEntry(i, pCurr, alias);
+            });
 
+        timer.End();
+        LOG_UI_INFO("Alias table - computation took %u [us].", (uint32_t)timer.DeltaMicro());
+    }
+    else if (!m_tableBuilt)
     {
-        // Safe to map, related fence has passed
-        m_readback->Map();
-
-        float* data = reinterpret_cast<float*>(m_readback->MappedMemory());
-        BuildAliasTable(MutableSpan(data, m_currNumTris), table);
-
-        // Unmapping happens automatically when readback buffer is released
-        //m_readback->Unmap();
+        LOG_UI_INFO("Alias table - fence hasn't passed, returning...");
+        return;
     }
 
-    timer.End();
-    LOG_UI_INFO("Alias table - computation took %u [us].", (uint32_t)timer.DeltaMicro());
-
     auto& gpuTimer = renderer.GetGpuTimer();
     const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "UploadAliasTable");
     computeCmdList.PIXBeginEvent("UploadAliasTable");
 
     // Schedule a copy
-    const uint32_t sizeInBytes = sizeof(RT::EmissiveLumenAliasTableEntry) * m_currNumTris;
+    const uint32_t sizeInBytes = sizeof(RT::EmissiveLumenAliasTableEntry) * (uint32_t)m_table.size();
     m_aliasTableUpload = GpuMemory::GetUploadHeapBuffer(sizeInBytes);
-    m_aliasTableUpload.Copy(0, sizeInBytes, table.data());
+    m_aliasTableUpload.Copy(0, sizeInBytes, m_table.data());
     computeCmdList.CopyBufferRegion(m_aliasTable.Resource(),
         0,
         m_aliasTableUpload.Resource(),
@@ -573,10 +524,15 @@ void EmissiveTriangleAliasTable::Render(CommandList& cmdList)
     gpuTimer.EndQuery(computeCmdList, queryIdx);
     cmdList.PIXEndEvent();
 
+    // Frame memory is released at the start of next frame
+    m_table = SmallVector<RT::EmissiveLumenAliasTableEntry, Allocator>();
+    m_builder.Clear();
+
     // Even though at this point this command list hasn't been submitted yet (only recorded),
     // it's safe to release the buffers here -- this is because resource deallocation
     // and signalling the related fence happens at the end of frame when all command 
     // lists have been submitted
     m_releaseDlg();
     m_fence = UINT64_MAX;
+    m_tableBuilt = false;
 }
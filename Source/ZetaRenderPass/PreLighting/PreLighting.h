@@ -2,6 +2,9 @@
 
 #include "../RenderPass.h"
 #include <Core/GpuMemory.h>
+#include <App/App.h>
+#include <Math/Sampling.h>
+#include <Support/Task.h>
 #include "PreLighting_Common.h"
 
 namespace ZetaRay::Core
@@ -114,10 +117,26 @@ namespace ZetaRay::RenderPass
         ZetaInline bool HasPendingRender() { return m_fence != UINT64_MAX; }
 
         void Update(Core::GpuMemory::ReadbackHeapBuffer* readback);
+        // Once the GPU has finished estimating the triangle powers, submits tasks that build
+        // the alias table in parallel. Called during scene-renderer update, which finishes
+        // (along with the submitted tasks) before Render() uploads the table.
+        void SubmitBuild();
         void SetEmissiveTriPassHandle(Core::RenderNodeHandle& emissiveTriHandle);
         void Render(Core::CommandList& cmdList);
 
     private:
+        static constexpr size_t MIN_NUM_TRIS_PER_CHUNK = 64 * 1024;
+        // 4 steps per chunk, which has to fit in one TaskSet
+        static constexpr int MAX_NUM_CHUNKS = Support::TaskSet::MAX_NUM_TASKS / 4;
+
+        // Both only live until the table is uploaded in the same frame
+        using Allocator = App::OneTimeFrameAllocatorWithFallback;
+        Math::AliasTableBuilder<Allocator> m_builder;
+        Util::SmallVector<RT::EmissiveLumenAliasTableEntry, Allocator> m_table;
+
+        void InitBuild(int numChunks);
+        void SetEntry(uint32_t i, float pCurr, uint32_t alias);
+
         Core::GpuMemory::Buffer m_aliasTable;
         Core::GpuMemory::UploadHeapBuffer m_aliasTableUpload;
         Core::GpuMemory::ReadbackHeapBuffer* m_readback = nullptr;
@@ -125,5 +144,6 @@ namespace ZetaRay::RenderPass
         uint32_t m_currNumTris = 0;
         int m_emissiveTriHandle = -1;
         uint64_t m_fence = UINT64_MAX;
+        bool m_tableBuilt = false;
     };
 }
\ No newline at end of file
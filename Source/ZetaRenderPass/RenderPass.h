@@ -70,6 +70,7 @@ namespace ZetaRay::RenderPass
             Assert(!m_rootSigObj, "Attempting to double-init.");
             m_rootSig.Finalize(name, m_rootSigObj, samplers, flags);
             m_psoLib.Init(name);
+            m_psoLib.WarmUp(m_rootSigObj.Get());
         }
 
         Core::PipelineStateLibrary m_psoLib;
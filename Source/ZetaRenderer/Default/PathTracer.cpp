@@ -142,6 +142,10 @@ void PathTracer::Update(const RenderSettings& settings, Core::RenderGraph& rende
             data.EmissiveAliasTable.Update(&readback);
             data.EmissiveAliasTable.SetReleaseBuffersDlg(data.PreLightingPass.GetReleaseBuffersDlg());
         }
+
+        // Builds the alias table on worker threads when read back triangle powers are ready.
+        // Runs after PreLighting::Update() as that may reallocate the readback buffer.
+        data.EmissiveAliasTable.SubmitBuild();
     }
 }
 
@@ -3,12 +3,57 @@
 #include <Utility/RNG.h>
 #include <App/App.h>
 #include <doctest/doctest.h>
+#include <chrono>
+#include <thread>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Support;
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Math;
 
+namespace
+{
+    // Steps are run one after the other, chunks of each step are processed by
+    // different threads when multithreaded is set
+    void BuildParallel(MutableSpan<float> weights, MutableSpan<AliasTableEntry> table, int numChunks,
+        bool multithreaded = false)
+    {
+        AliasTableBuilder<> builder;
+        builder.Init(weights, numChunks);
+        const float oneDivN = 1.0f / weights.size();
+
+        auto setEntry = [&table, &builder, oneDivN](uint32_t i, float pCurr, uint32_t alias)
+            {
+                table[i].P_Curr = pCurr;
+                table[i].P_Orig = builder.NormalizedWeight(i) * oneDivN;
+                table[i].Alias = alias;
+            };
+
+        auto run = [&builder, multithreaded](auto step)
+            {
+                if (!multithreaded)
+                {
+                    for (int c = 0; c < builder.NumChunks(); c++)
+                        step(c);
+
+                    return;
+                }
+
+                std::thread threads[AliasTableBuilder<>::MAX_NUM_CHUNKS];
+                for (int c = 0; c < builder.NumChunks(); c++)
+                    threads[c] = std::thread(step, c);
+
+                for (int c = 0; c < builder.NumChunks(); c++)
+                    threads[c].join();
+            };
+
+        run([&builder](int c) { builder.Sum(c); });
+        run([&builder](int c) { builder.Classify(c); });
+        run([&builder](int c) { builder.Partition(c); });
+        run([&builder, &setEntry](int c) { builder.Assign(c, setEntry); });
+    }
+}
+
 TEST_SUITE("AliasTable")
 {
     TEST_CASE("Normalize")
@@ -119,4 +164,144 @@ TEST_SUITE("AliasTable")
         INFO("Test statistic: ", chiSquared, ", critical value: ", criticalValue);
         CHECK(chiSquared <= criticalValue);
     }
+    TEST_CASE("ParallelMatchesDistribution")
+    {
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        const uint32_t n = 1 + rng.UniformUintBounded(9999);
+        SmallVector<float> vals;
+        vals.resize(n);
+
+        // Mix of zero, small, and large weights
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const uint32_t r = rng.UniformUintBounded(10);
+            vals[i] = r == 0 ? 0.0f : (r < 8 ? rng.Uniform() : rng.Uniform() * 1000.0f);
+        }
+
+        double sum = 0.0;
+        for (auto v : vals)
+            sum += v;
+
+        const int numChunks = 1 + (int)rng.UniformUintBounded(AliasTableBuilder<>::MAX_NUM_CHUNKS);
+        INFO("N: ", n, ", #chunks: ", numChunks);
+
+        SmallVector<AliasTableEntry> table;
+        table.resize(n);
+        BuildParallel(vals, table, numChunks);
+
+        // Every element must end up with its own probability -- probability of keeping itself
+        // plus what other entries give to it as their alias
+        SmallVector<double> mass;
+        mass.resize(n, 0.0);
+        bool validAliases = true;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            validAliases = validAliases && table[i].Alias < n && table[i].P_Curr >= 0.0f && 
+                table[i].P_Curr <= 1.0f + 1e-5f;
+            mass[i] += table[i].P_Curr;
+
+            if (table[i].Alias < n)
+                mass[table[i].Alias] += 1.0 - table[i].P_Curr;
+        }
+
+        CHECK(validAliases);
+
+        double maxError = 0.0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const double expected = vals[i] / sum;
+            maxError = std::max(maxError, fabs(mass[i] / n - expected));
+        }
+
+        INFO("Max. error: ", maxError);
+        CHECK(maxError < 1e-6);
+    }
+
+    TEST_CASE("ParallelDensity")
+    {
+        RNG rng(71);
+
+        const int n = 50;
+        SmallVector<float> vals;
+        vals.resize(n);
+
+        for (int i = 0; i < n; i++)
+            vals[i] = (float)rng.UniformUintBounded(1000);
+
+        SmallVector<float> valsNormalized = vals;
+        const float sum = Math::KahanSum(vals);
+
+        for (int i = 0; i < n; i++)
+            valsNormalized[i] /= sum;
+
+        SmallVector<AliasTableEntry> table;
+        table.resize(n);
+        BuildParallel(vals, table, 4, true);
+
+        const int sampleSize = 10000;
+        SmallVector<size_t> count;
+        count.resize(n, 0);
+
+        for (int i = 0; i < sampleSize; i++)
+        {
+            float pdf;
+            uint32_t idx = SampleAliasTable(table, rng, pdf);
+
+            CHECK(fabsf(pdf - valsNormalized[idx]) < 1e-6f);
+            count[idx]++;
+        }
+
+        // Chi-squared goodness-of-fit test
+        double chiSquared = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            double expected = valsNormalized[i] * sampleSize;
+            double diff = count[i] - expected;
+            chiSquared += expected == 0 ? 0 : (diff * diff) / expected;
+        }
+
+        // alpha = 0.01 and dof = n - 1 = 49
+        const double criticalValue = 74.9195;
+
+        INFO("Test statistic: ", chiSquared, ", critical value: ", criticalValue);
+        CHECK(chiSquared <= criticalValue);
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        RNG rng(19);
+        const int numThreads = (int)std::min(std::thread::hardware_concurrency(),
+            (unsigned int)AliasTableBuilder<>::MAX_NUM_CHUNKS);
+
+        for (size_t n : { 1'000'000, 10'000'000, 50'000'000 })
+        {
+            SmallVector<float> vals;
+            vals.resize(n);
+
+            for (size_t i = 0; i < n; i++)
+                vals[i] = rng.Uniform() * 100.0f;
+
+            // Serial build normalizes the weights in place
+            SmallVector<float> valsCopy = vals;
+            SmallVector<AliasTableEntry> table;
+            table.resize(n);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            AliasTable_Build(valsCopy, table);
+            auto end = std::chrono::high_resolution_clock::now();
+            const double serialMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+            start = std::chrono::high_resolution_clock::now();
+            BuildParallel(vals, table, numThreads, true);
+            end = std::chrono::high_resolution_clock::now();
+            const double parallelMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+            MESSAGE("N = ", n, ": serial ", serialMs, " [ms], parallel (", numThreads, " threads) ", 
+                parallelMs, " [ms]");
+        }
+    }
 };
\ No newline at end of file
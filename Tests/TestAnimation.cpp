@@ -0,0 +1,188 @@
+#include <Scene/Animation.h>
+#include <Math/Quaternion.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Scene::Internal;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    void RandomKeyframes(RNG& rng, int n, Keyframe* keyframes)
+    {
+        float t = rng.Uniform();
+
+        for (int i = 0; i < n; i++)
+        {
+            t += 0.01f + rng.Uniform();
+            float3 axis(rng.Uniform() - 0.5f, rng.Uniform() - 0.5f, rng.Uniform() - 0.5f);
+            axis.normalize();
+
+            keyframes[i].Time = t;
+            keyframes[i].Transform.Scale = float3(0.1f + rng.Uniform(), 0.1f + rng.Uniform(),
+                0.1f + rng.Uniform());
+            keyframes[i].Transform.Rotation = storeFloat4(rotationQuaternion(axis,
+                rng.Uniform() * TWO_PI - PI));
+            keyframes[i].Transform.Translation = float3(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f,
+                rng.Uniform() * 10.0f);
+        }
+    }
+
+    // Linear search + SSE interpolation
+    AffineTransformation Reference(Keyframe* keyframes, int n, float t, float t_start, bool loop)
+    {
+        t -= t_start;
+
+        if (t <= keyframes[0].Time)
+            return keyframes[0].Transform;
+
+        if (t >= keyframes[n - 1].Time)
+        {
+            if (!loop)
+                return keyframes[n - 1].Transform;
+
+            const float duration = keyframes[n - 1].Time - keyframes[0].Time;
+            t = keyframes[0].Time + fmodf(t - keyframes[0].Time, duration);
+        }
+
+        int k = 0;
+        while (k < n - 2 && t >= keyframes[k + 1].Time)
+            k++;
+
+        const float u = (t - keyframes[k].Time) / (keyframes[k + 1].Time - keyframes[k].Time);
+        Keyframe& k1 = keyframes[k];
+        Keyframe& k2 = keyframes[k + 1];
+
+        AffineTransformation M;
+        M.Scale = storeFloat3(lerp(loadFloat3(k1.Transform.Scale), loadFloat3(k2.Transform.Scale), u));
+        M.Rotation = storeFloat4(slerp(loadFloat4(k1.Transform.Rotation), loadFloat4(k2.Transform.Rotation), u));
+        M.Translation = storeFloat3(lerp(loadFloat3(k1.Transform.Translation),
+            loadFloat3(k2.Transform.Translation), u));
+
+        return M;
+    }
+
+    bool Equal(const AffineTransformation& a, const AffineTransformation& b)
+    {
+        constexpr float EPS = 1e-3f;
+
+        // q and -q represent the same rotation
+        float4 q = b.Rotation;
+        if (a.Rotation.x * q.x + a.Rotation.y * q.y + a.Rotation.z * q.z + a.Rotation.w * q.w < 0)
+            q = float4(-q.x, -q.y, -q.z, -q.w);
+
+        return fabsf(a.Scale.x - b.Scale.x) < EPS && fabsf(a.Scale.y - b.Scale.y) < EPS &&
+            fabsf(a.Scale.z - b.Scale.z) < EPS &&
+            fabsf(a.Rotation.x - q.x) < EPS && fabsf(a.Rotation.y - q.y) < EPS &&
+            fabsf(a.Rotation.z - q.z) < EPS && fabsf(a.Rotation.w - q.w) < EPS &&
+            fabsf(a.Translation.x - b.Translation.x) < EPS && fabsf(a.Translation.y - b.Translation.y) < EPS &&
+            fabsf(a.Translation.z - b.Translation.z) < EPS;
+    }
+}
+
+TEST_SUITE("Animation")
+{
+    TEST_CASE("MatchesReference")
+    {
+        constexpr int NUM_ANIMATIONS = 37;
+        constexpr int MAX_NUM_KEYFRAMES = 16;
+
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        Keyframe keyframes[NUM_ANIMATIONS][MAX_NUM_KEYFRAMES];
+        int numKeyframes[NUM_ANIMATIONS];
+        float t_start[NUM_ANIMATIONS];
+        AnimationSet animations;
+
+        for (int i = 0; i < NUM_ANIMATIONS; i++)
+        {
+            numKeyframes[i] = 2 + rng.UniformUintBounded(MAX_NUM_KEYFRAMES - 1);
+            t_start[i] = rng.Uniform() * 2.0f;
+            RandomKeyframes(rng, numKeyframes[i], keyframes[i]);
+
+            animations.Add(i, Span<Keyframe>(keyframes[i], numKeyframes[i]), t_start[i], (i & 1) == 0);
+        }
+
+        AffineTransformation out[NUM_ANIMATIONS];
+        bool allEqual = true;
+
+        // Mostly increasing time with occasional jumps backward
+        float t = 0.0f;
+        for (int iter = 0; iter < 500; iter++)
+        {
+            t = (iter % 100) == 99 ? rng.Uniform() * 5.0f : t + rng.Uniform() * 0.3f;
+            animations.Sample(t, 0, NUM_ANIMATIONS, MutableSpan<AffineTransformation>(out, NUM_ANIMATIONS));
+
+            for (int i = 0; i < NUM_ANIMATIONS; i++)
+            {
+                auto expected = Reference(keyframes[i], numKeyframes[i], t, t_start[i], (i & 1) == 0);
+                allEqual = allEqual && Equal(out[i], expected);
+            }
+        }
+
+        CHECK(allEqual);
+    }
+
+    TEST_CASE("Subrange")
+    {
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        constexpr int NUM_ANIMATIONS = 20;
+        Keyframe keyframes[NUM_ANIMATIONS][4];
+        AnimationSet animations;
+
+        for (int i = 0; i < NUM_ANIMATIONS; i++)
+        {
+            RandomKeyframes(rng, 4, keyframes[i]);
+            animations.Add(i, Span<Keyframe>(keyframes[i], 4), 0.0f, true);
+        }
+
+        CHECK(animations.NumAnimations() == NUM_ANIMATIONS);
+        CHECK(animations.NumKeyframes() == NUM_ANIMATIONS * 4);
+
+        // Output is relative to the beginning of the range
+        AffineTransformation out[NUM_ANIMATIONS];
+        animations.Sample(1.5f, 5, 17, MutableSpan<AffineTransformation>(out, NUM_ANIMATIONS));
+
+        for (int i = 5; i < 17; i++)
+            CHECK(Equal(out[i - 5], Reference(keyframes[i], 4, 1.5f, 0.0f, true)));
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        constexpr int NUM_ANIMATIONS = 100'000;
+        constexpr int NUM_KEYFRAMES = 32;
+        constexpr int NUM_FRAMES = 100;
+
+        RNG rng(17);
+        Keyframe keyframes[NUM_KEYFRAMES];
+        AnimationSet animations;
+
+        for (int i = 0; i < NUM_ANIMATIONS; i++)
+        {
+            RandomKeyframes(rng, NUM_KEYFRAMES, keyframes);
+            animations.Add(i, Span<Keyframe>(keyframes, NUM_KEYFRAMES), rng.Uniform(), true);
+        }
+
+        SmallVector<AffineTransformation> out;
+        out.resize(NUM_ANIMATIONS);
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int f = 0; f < NUM_FRAMES; f++)
+            animations.Sample(f / 60.0f, 0, NUM_ANIMATIONS, out);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        MESSAGE("Sampled ", NUM_ANIMATIONS, " animations in ", ms / NUM_FRAMES, " [ms] per frame (single thread)");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include <BCnEncoder.h>
+#include <Math/Common.h>
+#include <Utility/RNG.h>
+#include <Utility/SmallVector.h>
+#include <doctest/doctest.h>
+#include <chrono>
+#include <thread>
+
+using namespace ZetaRay;
+using namespace ZetaRay::BCn;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    static constexpr FORMAT ALL_FORMATS[] = { FORMAT::BC1, FORMAT::BC3, FORMAT::BC4, FORMAT::BC5, FORMAT::BC7 };
+
+    // Channels that are stored by each format
+    uint32_t ChannelMask(FORMAT f)
+    {
+        switch (f)
+        {
+        case FORMAT::BC1:
+            return 0x7;
+        case FORMAT::BC4:
+            return 0x1;
+        case FORMAT::BC5:
+            return 0x3;
+        default:
+            return 0xf;
+        }
+    }
+
+    uint32_t NumChannels(FORMAT f)
+    {
+        uint32_t mask = ChannelMask(f);
+        uint32_t n = 0;
+        for (; mask; mask >>= 1)
+            n += mask & 1;
+
+        return n;
+    }
+
+    ZetaInline uint8_t ToUNorm8(float v)
+    {
+        return (uint8_t)Min(Max(v, 0.0f), 255.0f);
+    }
+
+    // Smooth gradients with some noise, similar to typical texture content
+    void RandomImage(RNG& rng, uint32_t width, uint32_t height, bool opaque, SmallVector<uint8_t>& rgba)
+    {
+        rgba.resize(size_t(width) * height * 4);
+
+        float base[4];
+        float dx[4];
+        float dy[4];
+        for (int ch = 0; ch < 4; ch++)
+        {
+            base[ch] = rng.Uniform() * 255.0f;
+            dx[ch] = (rng.Uniform() - 0.5f) * 8.0f;
+            dy[ch] = (rng.Uniform() - 0.5f) * 8.0f;
+        }
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint8_t* texel = rgba.data() + (size_t(y) * width + x) * 4;
+                const float wave = 40.0f * sinf(x * 0.11f) * cosf(y * 0.07f);
+
+                for (int ch = 0; ch < 4; ch++)
+                {
+                    const float noise = (rng.Uniform() - 0.5f) * 6.0f;
+                    const float v = fmodf(base[ch] + dx[ch] * x + dy[ch] * y + wave + noise + 1024.0f, 512.0f);
+                    texel[ch] = ToUNorm8(v < 256.0f ? v : 511.0f - v);
+                }
+
+                if (opaque)
+                    texel[3] = 255;
+            }
+        }
+    }
+
+    double RoundTripPSNR(FORMAT f, QUALITY q, const SmallVector<uint8_t>& rgba, uint32_t width, uint32_t height)
+    {
+        SmallVector<uint8_t> blocks;
+        blocks.resize(CompressedSize(f, width, height));
+        EncodeImage(f, q, rgba.data(), width, height, blocks, 1);
+
+        SmallVector<uint8_t> decoded;
+        decoded.resize(rgba.size());
+        DecodeImage(f, blocks, width, height, decoded);
+
+        const uint64_t err = SquaredError(rgba.data(), decoded.data(), width, height, ChannelMask(f));
+        return PSNR(err, uint64_t(width) * height * NumChannels(f));
+    }
+}
+
+TEST_SUITE("BCnEncoder")
+{
+    TEST_CASE("RoundTripQuality")
+    {
+        RNG rng(3);
+        SmallVector<uint8_t> rgba;
+        RandomImage(rng, 64, 64, true, rgba);
+
+        for (auto f : ALL_FORMATS)
+        {
+            const double psnrFast = RoundTripPSNR(f, QUALITY::FAST, rgba, 64, 64);
+            const double psnrNormal = RoundTripPSNR(f, QUALITY::NORMAL, rgba, 64, 64);
+            const double psnrSlow = RoundTripPSNR(f, QUALITY::SLOW, rgba, 64, 64);
+
+            CHECK(psnrFast > 30.0);
+            CHECK(psnrNormal >= psnrFast - 0.05);
+            CHECK(psnrSlow >= psnrNormal - 0.05);
+        }
+
+        // Single-channel formats and BC7 should do much better than BC1
+        CHECK(RoundTripPSNR(FORMAT::BC4, QUALITY::NORMAL, rgba, 64, 64) > 40.0);
+        CHECK(RoundTripPSNR(FORMAT::BC7, QUALITY::NORMAL, rgba, 64, 64) >
+            RoundTripPSNR(FORMAT::BC1, QUALITY::NORMAL, rgba, 64, 64) + 3.0);
+    }
+
+    TEST_CASE("ConstantBlocks")
+    {
+        RNG rng(5);
+
+        for (int i = 0; i < 200; i++)
+        {
+            uint8_t texels[16][4];
+            const uint8_t c[4] = { (uint8_t)rng.UniformUintBounded(256), (uint8_t)rng.UniformUintBounded(256),
+                (uint8_t)rng.UniformUintBounded(256), (uint8_t)rng.UniformUintBounded(256) };
+
+            for (int t = 0; t < 16; t++)
+                memcpy(texels[t], c, 4);
+
+            uint8_t block[16];
+            uint8_t decoded[16][4];
+
+            // BC4, BC5 and BC7 represent any constant exactly
+            EncodeBC7(texels, QUALITY::NORMAL, block);
+            DecodeBlock(FORMAT::BC7, block, decoded);
+            REQUIRE(memcmp(decoded, texels, sizeof(texels)) == 0);
+
+            EncodeBC5(texels, QUALITY::NORMAL, block);
+            DecodeBlock(FORMAT::BC5, block, decoded);
+            for (int t = 0; t < 16; t++)
+            {
+                REQUIRE(decoded[t][0] == c[0]);
+                REQUIRE(decoded[t][1] == c[1]);
+            }
+
+            // 5:6:5 endpoints
+            for (int t = 0; t < 16; t++)
+                texels[t][3] = 255;
+
+            EncodeBC1(texels, QUALITY::NORMAL, block);
+            DecodeBlock(FORMAT::BC1, block, decoded);
+            for (int t = 0; t < 16; t++)
+            {
+                CHECK(abs(decoded[t][0] - c[0]) <= 4);
+                CHECK(abs(decoded[t][1] - c[1]) <= 2);
+                CHECK(abs(decoded[t][2] - c[2]) <= 4);
+                CHECK(decoded[t][3] == 255);
+            }
+        }
+    }
+
+    TEST_CASE("Alpha")
+    {
+        RNG rng(7);
+        uint8_t texels[16][4];
+
+        for (int t = 0; t < 16; t++)
+        {
+            for (int ch = 0; ch < 3; ch++)
+                texels[t][ch] = (uint8_t)rng.UniformUintBounded(256);
+
+            texels[t][3] = (t % 3 == 0) ? 0 : 255;
+        }
+
+        // BC1 uses 1-bit alpha
+        uint8_t block[16];
+        uint8_t decoded[16][4];
+        EncodeBC1(texels, QUALITY::NORMAL, block);
+        DecodeBlock(FORMAT::BC1, block, decoded);
+
+        for (int t = 0; t < 16; t++)
+            CHECK(decoded[t][3] == texels[t][3]);
+
+        // Smooth color and alpha gradients
+        for (int t = 0; t < 16; t++)
+        {
+            texels[t][0] = uint8_t(40 + t * 3);
+            texels[t][1] = uint8_t(90 + t);
+            texels[t][2] = uint8_t(200 - t * 2);
+            texels[t][3] = uint8_t(100 + t * 2);
+        }
+
+        EncodeBC3(texels, QUALITY::NORMAL, block);
+        DecodeBlock(FORMAT::BC3, block, decoded);
+        for (int t = 0; t < 16; t++)
+            CHECK(abs(decoded[t][3] - texels[t][3]) <= 2);
+
+        EncodeBC7(texels, QUALITY::NORMAL, block);
+        DecodeBlock(FORMAT::BC7, block, decoded);
+        for (int t = 0; t < 16; t++)
+        {
+            for (int ch = 0; ch < 4; ch++)
+                CHECK(abs(decoded[t][ch] - texels[t][ch]) <= 2);
+        }
+    }
+
+    TEST_CASE("ParallelMatchesSerial")
+    {
+        RNG rng(11);
+        SmallVector<uint8_t> rgba;
+        // Not a multiple of block size
+        RandomImage(rng, 75, 41, false, rgba);
+
+        for (auto f : ALL_FORMATS)
+        {
+            SmallVector<uint8_t> serial;
+            serial.resize(CompressedSize(f, 75, 41));
+            EncodeImage(f, QUALITY::NORMAL, rgba.data(), 75, 41, serial, 1);
+
+            SmallVector<uint8_t> parallel;
+            parallel.resize(serial.size());
+            EncodeImage(f, QUALITY::NORMAL, rgba.data(), 75, 41, parallel, 4);
+
+            CHECK(memcmp(serial.data(), parallel.data(), serial.size()) == 0);
+        }
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        RNG rng(13);
+        constexpr uint32_t DIM = 2048;
+        SmallVector<uint8_t> rgba;
+        RandomImage(rng, DIM, DIM, true, rgba);
+
+        const int numThreads = (int)Max(std::thread::hardware_concurrency(), 1u);
+        const char* formatNames[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+        const char* qualityNames[] = { "fast", "normal", "slow" };
+
+        for (int i = 0; i < (int)ZetaArrayLen(ALL_FORMATS); i++)
+        {
+            const FORMAT f = ALL_FORMATS[i];
+            SmallVector<uint8_t> blocks;
+            blocks.resize(CompressedSize(f, DIM, DIM));
+
+            for (int q = 0; q < 3; q++)
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                EncodeImage(f, (QUALITY)q, rgba.data(), DIM, DIM, blocks, numThreads);
+                auto end = std::chrono::high_resolution_clock::now();
+                const double sec = std::chrono::duration<double>(end - start).count();
+
+                SmallVector<uint8_t> decoded;
+                decoded.resize(rgba.size());
+                DecodeImage(f, blocks, DIM, DIM, decoded);
+                const double psnr = PSNR(SquaredError(rgba.data(), decoded.data(), DIM, DIM, ChannelMask(f)),
+                    uint64_t(DIM) * DIM * NumChannels(f));
+
+                MESSAGE(formatNames[i], " (", qualityNames[q], ", ", numThreads, " threads): ",
+                    DIM * DIM / sec * 1e-6, " [MPixels/s], PSNR ", psnr, " [dB]");
+            }
+        }
+    }
+}
\ No newline at end of file
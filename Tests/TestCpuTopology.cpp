@@ -0,0 +1,157 @@
+#include <Support/CpuTopology.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    // Two packages with one NUMA node each, four cores per package and two logical
+    // processors per core, numbered like Linux does: primaries 0-7, then siblings 8-15.
+    // OS node IDs are 0 and 2.
+    void DualSocket(CpuTopology& topology)
+    {
+        LogicalProcessor processors[16];
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int core = i % 8;
+            const int package = core / 4;
+            processors[i] = LogicalProcessor{ .ID = i, .Package = package, .Core = core % 4,
+                .Node = package * 2 };
+        }
+
+        topology.Build(Span(processors, 16));
+    }
+}
+
+TEST_SUITE("CpuTopology")
+{
+    TEST_CASE("Build")
+    {
+        CpuTopology topology;
+        DualSocket(topology);
+
+        CHECK(topology.NumLogicalProcessors() == 16);
+        CHECK(topology.NumPhysicalCores() == 8);
+        REQUIRE(topology.NumNodes() == 2);
+        CHECK(topology.OsNodeID(0) == 0);
+        CHECK(topology.OsNodeID(1) == 2);
+
+        CHECK(topology.NodeOf(3) == 0);
+        CHECK(topology.NodeOf(13) == 1);
+        // Not a logical processor of this topology
+        CHECK(topology.NodeOf(99) == 0);
+    }
+
+    TEST_CASE("Compact")
+    {
+        CpuTopology topology;
+        DualSocket(topology);
+
+        // Workers fill node 0 first, background threads go on the siblings
+        int cpus[6];
+        topology.AssignThreads(THREAD_PINNING::COMPACT, 4, 2, cpus);
+        const int expected[6] = { 0, 1, 2, 3, 8, 9 };
+
+        for (int i = 0; i < 6; i++)
+            CHECK(cpus[i] == expected[i]);
+
+        // No thread was pinned
+        topology.AssignThreads(THREAD_PINNING::NONE, 4, 2, cpus);
+
+        for (int i = 0; i < 6; i++)
+            CHECK(cpus[i] == CpuTopology::UNPINNED);
+    }
+
+    TEST_CASE("Spread")
+    {
+        CpuTopology topology;
+        DualSocket(topology);
+
+        int cpus[6];
+        topology.AssignThreads(THREAD_PINNING::SPREAD, 4, 2, cpus);
+        const int expected[6] = { 0, 4, 1, 5, 8, 12 };
+
+        for (int i = 0; i < 6; i++)
+            CHECK(cpus[i] == expected[i]);
+    }
+
+    TEST_CASE("SMT")
+    {
+        CpuTopology topology;
+        DualSocket(topology);
+
+        // Siblings are only used once every physical core has a worker
+        int cpus[12];
+        topology.AssignThreads(THREAD_PINNING::COMPACT, 10, 2, cpus);
+
+        for (int i = 0; i < 8; i++)
+            CHECK(cpus[i] == i);
+
+        CHECK(cpus[8] == 8);
+        CHECK(cpus[9] == 9);
+        CHECK(cpus[10] == 10);
+        CHECK(cpus[11] == 11);
+
+        // More workers than logical processors leaves nothing for background threads
+        int oversubscribed[18];
+        topology.AssignThreads(THREAD_PINNING::COMPACT, 17, 1, oversubscribed);
+        CHECK(oversubscribed[15] == 15);
+        CHECK(oversubscribed[16] == 0);
+        CHECK(oversubscribed[17] == CpuTopology::UNPINNED);
+    }
+
+    TEST_CASE("Hybrid")
+    {
+        // Two efficiency cores (IDs 0-1, no SMT) enumerated before two performance cores
+        // with SMT (IDs 2-5)
+        LogicalProcessor processors[6];
+        processors[0] = LogicalProcessor{ .ID = 0, .Package = 0, .Core = 0, .Node = 0, .EfficiencyClass = 0 };
+        processors[1] = LogicalProcessor{ .ID = 1, .Package = 0, .Core = 1, .Node = 0, .EfficiencyClass = 0 };
+
+        for (int i = 2; i < 6; i++)
+        {
+            processors[i] = LogicalProcessor{ .ID = i, .Package = 0, .Core = 2 + (i - 2) / 2, .Node = 0,
+                .EfficiencyClass = 1 };
+        }
+
+        CpuTopology topology;
+        topology.Build(Span(processors, 6));
+        CHECK(topology.NumPhysicalCores() == 4);
+
+        // Performance cores are taken first, then the efficiency cores
+        int cpus[4];
+        topology.AssignThreads(THREAD_PINNING::COMPACT, 3, 1, cpus);
+        const int expected[4] = { 2, 4, 0, 3 };
+
+        for (int i = 0; i < 4; i++)
+            CHECK(cpus[i] == expected[i]);
+
+        topology.AssignThreads(THREAD_PINNING::SPREAD, 2, 0, MutableSpan(cpus, 2));
+        CHECK(cpus[0] == 2);
+        CHECK(cpus[1] == 4);
+    }
+
+    TEST_CASE("NoSMT")
+    {
+        LogicalProcessor processors[4];
+
+        for (int i = 0; i < 4; i++)
+            processors[i] = LogicalProcessor{ .ID = i, .Package = 0, .Core = i, .Node = 0 };
+
+        CpuTopology topology;
+        topology.Build(Span(processors, 4));
+        CHECK(topology.NumPhysicalCores() == 4);
+        CHECK(topology.NumNodes() == 1);
+
+        // Without siblings, background threads get the cores that workers didn't take
+        int cpus[5];
+        topology.AssignThreads(THREAD_PINNING::SPREAD, 2, 3, cpus);
+        const int expected[5] = { 0, 1, 2, 3, 2 };
+
+        for (int i = 0; i < 5; i++)
+            CHECK(cpus[i] == expected[i]);
+    }
+}
\ No newline at end of file
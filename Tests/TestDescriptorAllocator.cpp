@@ -0,0 +1,178 @@
+#include <Support/DescriptorAllocator.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+#include <thread>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+TEST_SUITE("DescriptorAllocator")
+{
+    TEST_CASE("Basic")
+    {
+        DescriptorAllocator allocator;
+        allocator.Init(1024, 256);
+
+        auto a = allocator.Allocate(100);
+        CHECK(!a.IsEmpty());
+        CHECK(a.Count == 100);
+
+        // Small sizes are rounded up to their bin size
+        auto b = allocator.Allocate(3);
+        CHECK(!b.IsEmpty());
+        CHECK(b.Count == 4);
+        CHECK(DescriptorAllocator::ReservedCount(3) == 4);
+        CHECK(DescriptorAllocator::ReservedCount(17) == 17);
+
+        CHECK((b.Offset >= a.Offset + a.Count || b.Offset + b.Count <= a.Offset));
+        CHECK(allocator.NumFreeEntries() == 1024 - 100 - 4);
+    }
+
+    TEST_CASE("DeferredRelease")
+    {
+        DescriptorAllocator allocator;
+        allocator.Init(64, 64);
+
+        auto a = allocator.Allocate(64);
+        CHECK(!a.IsEmpty());
+        CHECK(allocator.Allocate(1).IsEmpty());
+
+        allocator.Release(a, 5);
+        CHECK(allocator.GetFragmentationReport().NumPending == 64);
+
+        // Fence hasn't completed yet
+        allocator.Recycle(4);
+        CHECK(allocator.NumFreeEntries() == 0);
+        CHECK(allocator.Allocate(1).IsEmpty());
+
+        allocator.Recycle(5);
+        CHECK(allocator.NumFreeEntries() == 64);
+        CHECK(allocator.GetFragmentationReport().NumPending == 0);
+
+        auto b = allocator.Allocate(64);
+        CHECK(b.Offset == 0);
+    }
+
+    TEST_CASE("ThreadCache")
+    {
+        DescriptorAllocator allocator;
+        allocator.Init(1024, 1024);
+
+        // First allocation refills the cache with a batch
+        auto a = allocator.Allocate(1, 0);
+        CHECK(!a.IsEmpty());
+        CHECK(a.Count == 1);
+
+        auto report = allocator.GetFragmentationReport();
+        CHECK(report.NumCached == DescriptorAllocator::REFILL_BATCH_SIZE - 1);
+        CHECK(allocator.NumFreeEntries() == 1024 - 1);
+
+        // Cached entries don't overlap
+        DescriptorAllocator::Allocation allocs[DescriptorAllocator::REFILL_BATCH_SIZE];
+        allocs[0] = a;
+        for (int i = 1; i < DescriptorAllocator::REFILL_BATCH_SIZE; i++)
+        {
+            allocs[i] = allocator.Allocate(1, 0);
+            CHECK(!allocs[i].IsEmpty());
+
+            for (int j = 0; j < i; j++)
+                CHECK(allocs[i].Offset != allocs[j].Offset);
+        }
+
+        CHECK(allocator.GetFragmentationReport().NumCached == 0);
+
+        allocator.Allocate(8, 1);
+        allocator.FlushAllThreadCaches();
+        CHECK(allocator.GetFragmentationReport().NumCached == 0);
+        CHECK(allocator.NumFreeEntries() == 1024 - DescriptorAllocator::REFILL_BATCH_SIZE - 8);
+    }
+
+    TEST_CASE("NoFragmentationAfterRelease")
+    {
+        DescriptorAllocator allocator;
+        allocator.Init(4096, 1024);
+
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        DescriptorAllocator::Allocation allocs[256];
+        uint64_t fence = 1;
+
+        for (int i = 0; i < 256; i++)
+        {
+            allocs[i] = allocator.Allocate(1 + rng.UniformUintBounded(12), i & 0x3);
+            REQUIRE(!allocs[i].IsEmpty());
+        }
+
+        for (int i = 0; i < 256; i++)
+            allocator.Release(allocs[i], fence + i / 16);
+
+        allocator.Recycle(UINT64_MAX);
+        allocator.FlushAllThreadCaches();
+
+        auto report = allocator.GetFragmentationReport();
+        CHECK(report.TotalFree == 4096);
+        CHECK(report.LargestFreeRegion == 4096);
+        CHECK(report.Fragmentation == 0.0f);
+
+        auto all = allocator.Allocate(4096);
+        CHECK(all.Offset == 0);
+    }
+
+    TEST_CASE("Concurrent")
+    {
+        constexpr int NUM_THREADS = 4;
+        constexpr int NUM_ITERS = 2000;
+
+        DescriptorAllocator allocator;
+        allocator.Init(NUM_THREADS * 1024, NUM_THREADS * 1024);
+        std::thread threads[NUM_THREADS];
+        std::atomic_uint64_t fence = 1;
+        bool failed[NUM_THREADS] = { false };
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads[t] = std::thread([&allocator, &fence, &failed, t]()
+                {
+                    DescriptorAllocator::Allocation live[32];
+
+                    for (int i = 0; i < NUM_ITERS; i++)
+                    {
+                        const int n = i & 31;
+                        if (i >= 32)
+                            allocator.Release(live[n], fence.load(std::memory_order_relaxed));
+
+                        live[n] = allocator.Allocate(1 + (i & 7), t);
+                        if (live[n].IsEmpty())
+                        {
+                            failed[t] = true;
+                            return;
+                        }
+
+                        for (int j = 0; j < 32 && j < i; j++)
+                        {
+                            if (j != n && live[j].Offset == live[n].Offset)
+                                failed[t] = true;
+                        }
+
+                        if ((i & 15) == 0)
+                            allocator.Recycle(fence.fetch_add(1, std::memory_order_relaxed));
+                    }
+
+                    for (int i = 0; i < 32; i++)
+                        allocator.Release(live[i], fence.load(std::memory_order_relaxed));
+                });
+        }
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            threads[t].join();
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            CHECK(!failed[t]);
+
+        allocator.Recycle(UINT64_MAX);
+        allocator.FlushAllThreadCaches();
+        CHECK(allocator.NumFreeEntries() == NUM_THREADS * 1024);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <Math/Sampling.h>
+#include <Utility/SmallVector.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    float RandomWeight(RNG& rng)
+    {
+        const uint32_t r = rng.UniformUintBounded(10);
+        return r == 0 ? 0.0f : (r < 8 ? rng.Uniform() : rng.Uniform() * 1000.0f);
+    }
+
+    // Brute-force CDF inversion, returns whether idx is a valid outcome for u
+    bool ValidSample(const SmallVector<float>& weights, double total, float u, uint32_t idx)
+    {
+        double prefix = 0.0;
+        for (uint32_t i = 0; i < idx; i++)
+            prefix += weights[i];
+
+        const double target = u * total;
+        const double eps = 1e-9 * total;
+
+        return weights[idx] > 0.0f && prefix <= target + eps && prefix + weights[idx] >= target - eps;
+    }
+}
+
+TEST_SUITE("DynamicDistribution")
+{
+    TEST_CASE("MatchesBruteForce")
+    {
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        const uint32_t n = 1 + rng.UniformUintBounded(2000);
+        SmallVector<float> weights;
+        weights.resize(n);
+
+        for (uint32_t i = 0; i < n; i++)
+            weights[i] = RandomWeight(rng);
+
+        // Make sure there's at least one nonzero weight
+        weights[rng.UniformUintBounded(n)] = 1.0f;
+
+        DynamicDistribution dist;
+        dist.Init(weights);
+        CHECK(dist.Size() == n);
+
+        bool pdfsMatch = true;
+        bool samplesValid = true;
+
+        for (int iter = 0; iter < 20; iter++)
+        {
+            // Modify a few weights
+            const uint32_t k = 1 + rng.UniformUintBounded(32);
+            for (uint32_t j = 0; j < k; j++)
+            {
+                const uint32_t i = rng.UniformUintBounded(n);
+                weights[i] = RandomWeight(rng);
+                dist.Set(i, weights[i]);
+            }
+
+            double total = 0.0;
+            for (auto w : weights)
+                total += w;
+
+            if (total == 0.0)
+            {
+                weights[0] = 1.0f;
+                dist.Set(0, 1.0f);
+                total = 1.0;
+            }
+
+            pdfsMatch = pdfsMatch && fabs(dist.Total() - total) <= 1e-9 * total;
+
+            for (uint32_t i = 0; i < n; i++)
+                pdfsMatch = pdfsMatch && fabsf(dist.Pdf(i) - (float)(weights[i] / total)) < 1e-6f;
+
+            for (int s = 0; s < 100; s++)
+            {
+                const float u = rng.Uniform();
+                float pdf;
+                const uint32_t idx = dist.Sample(u, pdf);
+
+                samplesValid = samplesValid && idx < n && ValidSample(weights, total, u, idx) &&
+                    pdf == dist.Pdf(idx);
+            }
+        }
+
+        CHECK(pdfsMatch);
+        CHECK(samplesValid);
+    }
+
+    TEST_CASE("Edges")
+    {
+        float vals[] = { 0.0f, 2.0f, 0.0f, 0.0f, 6.0f, 0.0f };
+        DynamicDistribution dist;
+        dist.Init(Span(vals, sizeof(vals) / sizeof(float)));
+
+        float pdf;
+        CHECK(dist.Sample(0.0f, pdf) == 1);
+        CHECK(pdf == 0.25f);
+        CHECK(dist.Sample(0.2499f, pdf) == 1);
+        CHECK(dist.Sample(0.25f, pdf) == 4);
+        CHECK(pdf == 0.75f);
+        CHECK(dist.Sample(0.99999994f, pdf) == 4);
+
+        // Removing the last nonzero element
+        dist.Set(4, 0.0f);
+        CHECK(dist.Total() == 2.0);
+        CHECK(dist.Sample(0.99999994f, pdf) == 1);
+        CHECK(pdf == 1.0f);
+
+        dist.Set(5, 2.0f);
+        CHECK(dist.Sample(0.5f, pdf) == 5);
+        CHECK(pdf == 0.5f);
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        constexpr size_t N = 10'000'000;
+        constexpr int NUM_UPDATES = 1000;
+
+        RNG rng(23);
+        SmallVector<float> weights;
+        weights.resize(N);
+
+        for (size_t i = 0; i < N; i++)
+            weights[i] = rng.Uniform();
+
+        DynamicDistribution dist;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        dist.Init(weights);
+        auto end = std::chrono::high_resolution_clock::now();
+        const double initMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < NUM_UPDATES; i++)
+            dist.Set(rng.UniformUintBounded(N), rng.Uniform());
+
+        end = std::chrono::high_resolution_clock::now();
+        const double updateUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+        SmallVector<AliasTableEntry> table;
+        table.resize(N);
+
+        start = std::chrono::high_resolution_clock::now();
+        AliasTable_Build(weights, table);
+        end = std::chrono::high_resolution_clock::now();
+        const double rebuildMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        MESSAGE("N = ", N, ": init ", initMs, " [ms], ", NUM_UPDATES, " updates ", updateUs,
+            " [us], alias table rebuild ", rebuildMs, " [ms]");
+    }
+}
\ No newline at end of file
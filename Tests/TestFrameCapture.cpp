@@ -0,0 +1,285 @@
+#include <Support/FrameCapture.h>
+#include <Support/ParamRegistry.h>
+#include <App/Filesystem.h>
+#include <doctest/doctest.h>
+#include <memory>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Scene;
+
+namespace
+{
+    struct Listener
+    {
+        void OnChanged(const ParamVariant& p)
+        {
+            NumCalls++;
+        }
+
+        int NumCalls = 0;
+    };
+
+    const char* ENUM_VALS[] = { "Low", "Medium", "High" };
+
+    // One param of every type
+    void MakeParams(Listener& l, ParamVariant* params)
+    {
+        auto dlg = fastdelegate::MakeDelegate(&l, &Listener::OnChanged);
+
+        params[0].InitFloat("Renderer", "Sky", "Float", dlg, 0.1f, -10.0f, 10.0f, 0.1f);
+        params[1].InitFloat2("Renderer", "Sky", "Float2", dlg, float2(0.2f, -0.3f), -10.0f, 10.0f, 0.1f);
+        params[2].InitFloat3("Renderer", "Sky", "Float3", dlg, float3(1.0f / 3.0f, 2.0f, 1e-6f), -10.0f, 10.0f, 0.1f);
+        params[3].InitColor("Renderer", "Sky", "Color", dlg, float3(0.7f, 0.11f, 0.9f));
+        params[4].InitUnitDir("Renderer", "Sky", "Dir", dlg, 1.2345678f, 4.5678901f);
+        params[5].InitInt("Renderer", "Sky", "Int", dlg, -7, -100, 100, 1);
+        params[6].InitBool("Renderer", "Sky", "Bool", dlg, true);
+        params[7].InitEnum("Renderer", "Sky", "Enum", dlg, ENUM_VALS, ZetaArrayLen(ENUM_VALS), 2);
+    }
+
+    constexpr int NUM_PARAMS = 8;
+}
+
+TEST_SUITE("FrameCapture")
+{
+    TEST_CASE("RoundTrip")
+    {
+        const char* path = "TestFrameCapture.bin";
+        auto writer = std::make_unique<FrameCaptureWriter>();
+        writer->Begin();
+        CHECK(writer->IsRecording());
+
+        writer->BeginFrame(0, 1.0 / 60);
+        Motion m;
+        m.Reset();
+        m.dt = 1.0f / 60;
+        m.Acceleration = float3(1.0f, 0.0f, -2.0f);
+        m.dMouse_x = -5;
+        m.dMouse_y = 12;
+        writer->RecordMotion(m);
+        writer->RecordPick(CAPTURE_PICK::SINGLE, 10, 20);
+
+        // A frame without events
+        writer->BeginFrame(16'000'000, 1.0 / 30);
+
+        writer->BeginFrame(33'000'000, 0.5);
+        float3x3 rot(float3(0.0f, 1.0f, 0.0f), float3(-1.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 1.0f));
+        writer->RecordTransform(42, float3(1.0f, 2.0f, 3.0f), rot, float3(2.0f));
+        writer->RecordPick(CAPTURE_PICK::CLEAR);
+
+        writer->End(path);
+        CHECK(!writer->IsRecording());
+
+        auto reader = std::make_unique<FrameCaptureReader>();
+        REQUIRE(reader->Load(path));
+        App::Filesystem::RemoveFile(path);
+        REQUIRE(reader->NumFrames() == 3);
+
+        CapturedFrame frame;
+        CapturedEvent event;
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.TimeNs == 0);
+        CHECK(frame.Dt == 1.0 / 60);
+        CHECK(frame.NumEvents == 2);
+
+        REQUIRE(reader->NextEvent(event));
+        REQUIRE(event.Type == CAPTURE_EVENT::CAMERA_MOTION);
+        CHECK(event.Motion.dt == m.dt);
+        CHECK(event.Motion.Acceleration.x == 1.0f);
+        CHECK(event.Motion.Acceleration.z == -2.0f);
+        CHECK(event.Motion.dMouse_x == -5);
+        CHECK(event.Motion.dMouse_y == 12);
+
+        REQUIRE(reader->NextEvent(event));
+        REQUIRE(event.Type == CAPTURE_EVENT::PICK);
+        CHECK(event.Pick.Type == CAPTURE_PICK::SINGLE);
+        CHECK(event.Pick.X == 10);
+        CHECK(event.Pick.Y == 20);
+        CHECK(!reader->NextEvent(event));
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.TimeNs == 16'000'000);
+        CHECK(frame.NumEvents == 0);
+        CHECK(!reader->NextEvent(event));
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.Dt == 0.5);
+        CHECK(frame.NumEvents == 2);
+
+        REQUIRE(reader->NextEvent(event));
+        REQUIRE(event.Type == CAPTURE_EVENT::TRANSFORM);
+        CHECK(event.Transform.InstanceID == 42);
+        CHECK(event.Transform.Translation.y == 2.0f);
+        CHECK(event.Transform.Rotation.m[1].x == -1.0f);
+        CHECK(event.Transform.Rotation.m[0].y == 1.0f);
+        CHECK(event.Transform.Scale.z == 2.0f);
+
+        REQUIRE(reader->NextEvent(event));
+        CHECK(event.Type == CAPTURE_EVENT::PICK);
+        CHECK(event.Pick.Type == CAPTURE_PICK::CLEAR);
+        CHECK(!reader->NextEvent(event));
+
+        CHECK(!reader->NextFrame(frame));
+        CHECK(!reader->Load("Missing.bin"));
+    }
+
+    TEST_CASE("ParamChanges")
+    {
+        Listener l;
+        ParamVariant params[NUM_PARAMS];
+        MakeParams(l, params);
+
+        const char* path = "TestFrameCapture.bin";
+        auto writer = std::make_unique<FrameCaptureWriter>();
+        writer->Begin();
+
+        // Every param is recorded on the first frame, then only the ones that changed
+        writer->BeginFrame(0, 0.0);
+        writer->RecordParamChanges(Span(params, NUM_PARAMS));
+
+        writer->BeginFrame(1, 0.0);
+        writer->RecordParamChanges(Span(params, NUM_PARAMS));
+
+        writer->BeginFrame(2, 0.0);
+        params[5].SetInt(8);
+        params[6].SetBool(false);
+        writer->RecordParamChanges(Span(params, NUM_PARAMS));
+
+        // Changed and then changed back
+        writer->BeginFrame(3, 0.0);
+        params[5].SetInt(9);
+        params[5].SetInt(8);
+        writer->RecordParamChanges(Span(params, NUM_PARAMS));
+
+        writer->End(path);
+
+        auto reader = std::make_unique<FrameCaptureReader>();
+        REQUIRE(reader->Load(path));
+        App::Filesystem::RemoveFile(path);
+        REQUIRE(reader->NumFrames() == 4);
+
+        CapturedFrame frame;
+        CapturedEvent event;
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.NumEvents == NUM_PARAMS);
+
+        for (int i = 0; i < NUM_PARAMS; i++)
+        {
+            REQUIRE(reader->NextEvent(event));
+            REQUIRE(event.Type == CAPTURE_EVENT::PARAM);
+            CHECK(strcmp(event.Param.Group, "Renderer") == 0);
+            CHECK(strcmp(event.Param.Subgroup, "Sky") == 0);
+            CHECK(strcmp(event.Param.Name, params[i].GetName()) == 0);
+        }
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.NumEvents == 0);
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.NumEvents == 2);
+        REQUIRE(reader->NextEvent(event));
+        CHECK(strcmp(event.Param.Name, "Int") == 0);
+        CHECK(strcmp(event.Param.Value, "8") == 0);
+        REQUIRE(reader->NextEvent(event));
+        CHECK(strcmp(event.Param.Name, "Bool") == 0);
+        CHECK(strcmp(event.Param.Value, "false") == 0);
+
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.NumEvents == 0);
+    }
+
+    TEST_CASE("FormatValue")
+    {
+        Listener l;
+        ParamVariant params[NUM_PARAMS];
+        MakeParams(l, params);
+
+        auto reg = std::make_unique<ParamRegistry>();
+
+        for (int i = 0; i < NUM_PARAMS; i++)
+            reg->Add(params[i]);
+
+        reg->ApplyUpdates();
+
+        char values[NUM_PARAMS][ParamRegistry::MAX_VALUE_LEN];
+
+        for (int i = 0; i < NUM_PARAMS; i++)
+        {
+            const int n = ParamRegistry::FormatValue(params[i], values[i], ParamRegistry::MAX_VALUE_LEN);
+            CHECK(n == (int)strlen(values[i]));
+        }
+
+        CHECK(strcmp(values[5], "-7") == 0);
+        CHECK(strcmp(values[6], "true") == 0);
+        CHECK(strcmp(values[7], "2") == 0);
+
+        // Move every param away from its value, then set it back from the formatted text
+        const char* others[NUM_PARAMS] = { "5", "1 1", "1 1 1", "0 0 0", "0.5 0.5", "3", "false", "0" };
+
+        for (int i = 0; i < NUM_PARAMS; i++)
+            reg->SetValue("Renderer", "Sky", params[i].GetName(), others[i]);
+
+        CHECK(reg->ApplyUpdates() == 0);
+
+        for (int i = 0; i < NUM_PARAMS; i++)
+            reg->SetValue("Renderer", "Sky", params[i].GetName(), values[i]);
+
+        CHECK(reg->ApplyUpdates() == 0);
+
+        // Values must be identical, not just close
+        auto find = [&reg](const char* name) { return reg->Find("Renderer", "Sky", name); };
+        CHECK(find("Float")->GetFloat().m_value == params[0].GetFloat().m_value);
+        CHECK(find("Float2")->GetFloat2().m_value.x == params[1].GetFloat2().m_value.x);
+        CHECK(find("Float2")->GetFloat2().m_value.y == params[1].GetFloat2().m_value.y);
+        CHECK(find("Float3")->GetFloat3().m_value.x == params[2].GetFloat3().m_value.x);
+        CHECK(find("Float3")->GetFloat3().m_value.z == params[2].GetFloat3().m_value.z);
+        CHECK(find("Color")->GetColor().m_value.y == params[3].GetColor().m_value.y);
+        CHECK(find("Dir")->GetUnitDir().m_pitch == params[4].GetUnitDir().m_pitch);
+        CHECK(find("Dir")->GetUnitDir().m_yaw == params[4].GetUnitDir().m_yaw);
+        CHECK(find("Int")->GetInt().m_value == -7);
+        CHECK(find("Bool")->GetBool());
+        CHECK(find("Enum")->GetEnum().m_curr == 2);
+    }
+
+    TEST_CASE("InvalidData")
+    {
+        auto reader = std::make_unique<FrameCaptureReader>();
+
+        uint8_t garbage[16] = { 1, 2, 3 };
+        CHECK(!reader->Load(Span(garbage, sizeof(garbage))));
+
+        // Write a valid capture to memory by way of a file
+        const char* path = "TestFrameCapture.bin";
+        auto writer = std::make_unique<FrameCaptureWriter>();
+        writer->Begin();
+        writer->BeginFrame(0, 0.0);
+        writer->RecordPick(CAPTURE_PICK::MULTI, 1, 2);
+        writer->RecordPick(CAPTURE_PICK::SINGLE, 3, 4);
+        writer->End(path);
+
+        SmallVector<uint8_t> data;
+        App::Filesystem::LoadFromFile(path, data);
+        App::Filesystem::RemoveFile(path);
+        REQUIRE(reader->Load(Span(data.data(), data.size())));
+
+        // Truncated
+        CHECK(!reader->Load(Span(data.data(), data.size() - 1)));
+
+        // Events of unknown types are skipped. Header is 12 bytes, frame header is 24 bytes.
+        data[12 + 24] = (uint8_t)CAPTURE_EVENT::COUNT;
+        REQUIRE(reader->Load(Span(data.data(), data.size())));
+
+        CapturedFrame frame;
+        CapturedEvent event;
+        REQUIRE(reader->NextFrame(frame));
+        CHECK(frame.NumEvents == 2);
+        REQUIRE(reader->NextEvent(event));
+        CHECK(event.Pick.Type == CAPTURE_PICK::SINGLE);
+        CHECK(event.Pick.X == 3);
+        CHECK(!reader->NextEvent(event));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include <Support/FramePipeline.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    struct Waiter
+    {
+        void Wait(uint64_t frame)
+        {
+            Waited[NumWaits++] = frame;
+        }
+
+        uint64_t Waited[16];
+        int NumWaits = 0;
+    };
+
+    void SleepMs(int ms)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+TEST_SUITE("FramePipeline")
+{
+    TEST_CASE("WaitFn")
+    {
+        auto pipeline = std::make_unique<FramePipeline>();
+        Waiter w;
+        auto waitFn = fastdelegate::MakeDelegate(&w, &Waiter::Wait);
+
+        CHECK(pipeline->GetFramesInFlight() == FramePipeline::MAX_FRAMES_IN_FLIGHT);
+        pipeline->SetFramesInFlight(2);
+        // Takes effect at the next frame
+        CHECK(pipeline->GetFramesInFlight() == FramePipeline::MAX_FRAMES_IN_FLIGHT);
+
+        CHECK(pipeline->BeginFrame(waitFn) == 0);
+        CHECK(pipeline->GetFramesInFlight() == 2);
+        CHECK(pipeline->BeginFrame(waitFn) == 1);
+        CHECK(w.NumWaits == 0);
+
+        // Frame 2 needs frame 0
+        CHECK(pipeline->BeginFrame(waitFn) == 2);
+        REQUIRE(w.NumWaits == 1);
+        CHECK(w.Waited[0] == 0);
+        CHECK(pipeline->GetNumCompletedFrames() == 1);
+
+        // Frames that have already completed aren't waited for
+        pipeline->CompleteFrame(2);
+        CHECK(pipeline->GetNumCompletedFrames() == 3);
+        pipeline->BeginFrame(waitFn);
+        pipeline->BeginFrame(waitFn);
+        CHECK(w.NumWaits == 1);
+
+        pipeline->SetFramesInFlight(1);
+        CHECK(pipeline->BeginFrame(waitFn) == 5);
+        REQUIRE(w.NumWaits == 2);
+        CHECK(w.Waited[1] == 4);
+        CHECK(pipeline->GetCurrentFrame() == 5);
+    }
+
+    TEST_CASE("CompleteFromOtherThread")
+    {
+        auto pipeline = std::make_unique<FramePipeline>();
+        pipeline->SetFramesInFlight(2);
+
+        CHECK(pipeline->BeginFrame() == 0);
+        CHECK(pipeline->BeginFrame() == 1);
+
+        // Stands in for the GPU
+        std::thread gpu([&pipeline]()
+            {
+                SleepMs(20);
+                pipeline->CompleteFrame(0);
+            });
+
+        // Blocks until frame 0 has completed
+        CHECK(pipeline->BeginFrame() == 2);
+        CHECK(pipeline->GetNumCompletedFrames() >= 1);
+        gpu.join();
+
+        pipeline->CompleteFrame(2);
+
+        FrameLatencies l;
+        REQUIRE(pipeline->GetLatest(l));
+        CHECK(l.Frame == 2);
+        CHECK(l.StageMs[(int)FRAME_STAGE::GPU_WAIT] >= 10.0f);
+        CHECK(l.TotalMs >= l.StageMs[(int)FRAME_STAGE::GPU_WAIT]);
+    }
+
+    TEST_CASE("Stages")
+    {
+        auto pipeline = std::make_unique<FramePipeline>();
+        FrameLatencies l;
+
+        CHECK(!pipeline->GetLatest(l));
+
+        const uint64_t frame = pipeline->BeginFrame();
+
+        pipeline->BeginStage(frame, FRAME_STAGE::UPDATE);
+        SleepMs(5);
+        pipeline->EndStage(frame, FRAME_STAGE::UPDATE);
+
+        // Stages can begin and end on different threads
+        pipeline->BeginStage(frame, FRAME_STAGE::RECORD);
+        std::thread worker([&pipeline, frame]()
+            {
+                SleepMs(5);
+                pipeline->EndStage(frame, FRAME_STAGE::RECORD);
+            });
+        worker.join();
+
+        // Started the next frame before this one completed
+        const uint64_t next = pipeline->BeginFrame();
+        pipeline->BeginStage(next, FRAME_STAGE::UPDATE);
+
+        pipeline->CompleteFrame(frame);
+        REQUIRE(pipeline->GetLatest(l));
+        CHECK(l.Frame == frame);
+        CHECK(l.StageMs[(int)FRAME_STAGE::UPDATE] >= 4.0f);
+        CHECK(l.StageMs[(int)FRAME_STAGE::RECORD] >= 4.0f);
+        CHECK(l.StageMs[(int)FRAME_STAGE::SUBMIT] == 0.0f);
+        CHECK(l.TotalMs >= l.StageMs[(int)FRAME_STAGE::UPDATE] + l.StageMs[(int)FRAME_STAGE::RECORD]);
+
+        // Completing a frame completes every frame before it, and only reports the last one
+        pipeline->BeginFrame();
+        pipeline->CompleteFrame(next + 1);
+        CHECK(pipeline->GetNumCompletedFrames() == next + 2);
+        REQUIRE(pipeline->GetLatest(l));
+        CHECK(l.Frame == next + 1);
+        CHECK(l.StageMs[(int)FRAME_STAGE::UPDATE] == 0.0f);
+
+        // Stale completions are ignored
+        pipeline->CompleteFrame(frame);
+        CHECK(pipeline->GetNumCompletedFrames() == next + 2);
+    }
+
+    TEST_CASE("PerFrame")
+    {
+        PerFrame<int> data;
+
+        for (uint64_t frame = 0; frame < FramePipeline::MAX_FRAMES_IN_FLIGHT; frame++)
+            data[frame] = (int)frame;
+
+        bool allDistinct = true;
+        for (uint64_t frame = 0; frame < FramePipeline::MAX_FRAMES_IN_FLIGHT; frame++)
+            allDistinct = allDistinct && data[frame] == (int)frame;
+
+        CHECK(allDistinct);
+        // A slot is reused MAX_FRAMES_IN_FLIGHT frames later
+        CHECK(&data[FramePipeline::MAX_FRAMES_IN_FLIGHT + 1] == &data[1]);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include <Support/FrameStats.h>
+#include <App/Filesystem.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+TEST_SUITE("FrameStats")
+{
+    TEST_CASE("Register")
+    {
+        auto stats = std::make_unique<FrameStats>();
+
+        CHECK(stats->Find("Group", "A") == FrameStats::INVALID_ID);
+
+        const uint32_t a = stats->Register("Group", "A");
+        const uint32_t b = stats->Register("Group", "B");
+        const uint32_t c = stats->Register("Other", "A");
+
+        CHECK(a != b);
+        CHECK(a != c);
+        CHECK(b != c);
+        CHECK(stats->Register("Group", "A") == a);
+        CHECK(stats->Find("Group", "A") == a);
+        CHECK(stats->Find("Other", "A") == c);
+        // Group and name aren't simply concatenated
+        CHECK(stats->Find("Grou", "pA") == FrameStats::INVALID_ID);
+    }
+
+    TEST_CASE("ConcurrentRegister")
+    {
+        auto stats = std::make_unique<FrameStats>();
+        constexpr int NUM_THREADS = 8;
+        constexpr int NUM_STATS = 64;
+        uint32_t ids[NUM_THREADS][NUM_STATS];
+        std::thread threads[NUM_THREADS];
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads[t] = std::thread([&stats, &ids, t]()
+                {
+                    char name[16];
+
+                    for (int i = 0; i < NUM_STATS; i++)
+                    {
+                        // Different order in every thread
+                        const int s = (i + t * 7) % NUM_STATS;
+                        snprintf(name, sizeof(name), "Stat%d", s);
+                        ids[t][s] = stats->Register("Concurrent", name);
+                    }
+                });
+        }
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            threads[t].join();
+
+        bool allEqual = true;
+        bool allValid = true;
+
+        for (int i = 0; i < NUM_STATS; i++)
+        {
+            allValid = allValid && ids[0][i] < NUM_STATS;
+
+            for (int t = 1; t < NUM_THREADS; t++)
+                allEqual = allEqual && (ids[t][i] == ids[0][i]);
+        }
+
+        CHECK(allEqual);
+        CHECK(allValid);
+    }
+
+    TEST_CASE("Merge")
+    {
+        auto stats = std::make_unique<FrameStats>();
+        constexpr int NUM_THREADS = 6;
+        constexpr int NUM_ITERS = 1000;
+        uint32_t ids[NUM_THREADS];
+        char name[16];
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            snprintf(name, sizeof(name), "Thread%d", t);
+            ids[t] = stats->Register("Merge", name);
+        }
+
+        const uint32_t shared = stats->Register("Merge", "Shared");
+
+        for (uint64_t frame = 0; frame < 3; frame++)
+        {
+            std::thread threads[NUM_THREADS];
+
+            for (int t = 0; t < NUM_THREADS; t++)
+            {
+                threads[t] = std::thread([&stats, &ids, shared, t, frame]()
+                    {
+                        // Merge() is only called after the threads are joined, so at most
+                        // THREAD_BUFFER_LEN of these fit
+                        for (int i = 0; i < FrameStats::THREAD_BUFFER_LEN - 1; i++)
+                            stats->Add(t, ids[t], uint32_t(frame * NUM_ITERS + i));
+
+                        if (t == 0)
+                            stats->Add(t, shared, 0.5f);
+                    });
+            }
+
+            for (int t = 0; t < NUM_THREADS; t++)
+                threads[t].join();
+
+            stats->Merge(frame);
+            auto merged = stats->GetMerged();
+
+            REQUIRE(merged.size() == NUM_THREADS + 1);
+
+            for (int t = 0; t < NUM_THREADS; t++)
+            {
+                snprintf(name, sizeof(name), "Thread%d", t);
+                Stat s = merged[t];
+
+                CHECK(strcmp(s.GetGroup(), "Merge") == 0);
+                CHECK(strcmp(s.GetName(), name) == 0);
+                // Last value wins
+                CHECK(s.GetUInt() == uint32_t(frame * NUM_ITERS + FrameStats::THREAD_BUFFER_LEN - 2));
+            }
+
+            Stat s = merged[NUM_THREADS];
+            CHECK(s.GetFloat() == 0.5f);
+        }
+
+        CHECK(stats->GetNumDropped() == 0);
+
+        // Stats that weren't added in a frame aren't part of it
+        stats->Add(2, ids[2], 7u);
+        stats->Merge(3);
+        REQUIRE(stats->GetMerged().size() == 1);
+        CHECK(stats->GetMerged()[0].GetUInt() == 7u);
+
+        stats->Merge(4);
+        CHECK(stats->GetMerged().size() == 0);
+    }
+
+    TEST_CASE("Dropped")
+    {
+        auto stats = std::make_unique<FrameStats>();
+        const uint32_t id = stats->Register("Dropped", "A");
+
+        for (int i = 0; i < FrameStats::THREAD_BUFFER_LEN + 10; i++)
+            stats->Add(0, id, i);
+
+        CHECK(stats->GetNumDropped() == 10);
+
+        stats->Merge(0);
+        REQUIRE(stats->GetMerged().size() == 1);
+        Stat s = stats->GetMerged()[0];
+        CHECK(s.GetInt() == FrameStats::THREAD_BUFFER_LEN - 1);
+
+        // Merge frees up the buffer
+        stats->Add(0, id, -1);
+        stats->Merge(1);
+        CHECK(stats->GetNumDropped() == 10);
+        s = stats->GetMerged()[0];
+        CHECK(s.GetInt() == -1);
+    }
+
+    TEST_CASE("Percentiles")
+    {
+        auto stats = std::make_unique<FrameStats>();
+        const uint32_t a = stats->Register("Percentiles", "A");
+        const uint32_t b = stats->Register("Percentiles", "B");
+
+        CHECK(stats->GetPercentiles(a).NumSamples == 0);
+
+        // Values 1..100 in shuffled order
+        for (int i = 0; i < 100; i++)
+        {
+            stats->Add(0, a, (float)((i * 37) % 100 + 1));
+            stats->Add(1, b, uint32_t(i + 1), 200u);
+            stats->Merge(i);
+        }
+
+        StatPercentiles p = stats->GetPercentiles(a);
+        CHECK(p.NumSamples == 100);
+        CHECK(p.P50 == 50.0f);
+        CHECK(p.P95 == 95.0f);
+        CHECK(p.P99 == 99.0f);
+
+        p = stats->GetPercentiles(b);
+        CHECK(p.P50 == 50.0f / 200.0f);
+
+        // Only the last WINDOW_LEN frames are kept
+        for (int i = 0; i < FrameStats::WINDOW_LEN; i++)
+        {
+            stats->Add(0, a, 1000.0f);
+            stats->Merge(100 + i);
+        }
+
+        p = stats->GetPercentiles(a);
+        CHECK(p.NumSamples == FrameStats::WINDOW_LEN);
+        CHECK(p.P50 == 1000.0f);
+        CHECK(p.P99 == 1000.0f);
+    }
+
+    TEST_CASE("Dump")
+    {
+        auto stats = std::make_unique<FrameStats>();
+        const uint32_t a = stats->Register("Dump", "A");
+        const uint32_t b = stats->Register("Dump", "B");
+
+        // Not recorded
+        stats->Add(0, a, 1);
+        stats->Merge(0);
+
+        stats->BeginDump();
+
+        stats->Add(0, a, 2);
+        stats->Add(0, b, uint64_t(1) << 40);
+        stats->Merge(1);
+
+        stats->Add(0, b, uint64_t(3));
+        stats->Merge(2);
+
+        CHECK(stats->IsDumping());
+        const char* path = "TestFrameStats.bin";
+        stats->EndDump(path);
+        CHECK(!stats->IsDumping());
+
+        SmallVector<uint8_t> file;
+        App::Filesystem::LoadFromFile(path, file);
+        App::Filesystem::RemoveFile(path);
+
+        struct Header
+        {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t NumStats;
+            uint32_t NumFrames;
+        };
+
+        struct Record
+        {
+            uint32_t ID;
+            uint32_t Type;
+            uint64_t Bits;
+        };
+
+        const size_t statTableSize = 2 * (Stat::GROUP_LEN + Stat::NAME_LEN);
+        const size_t framesSize = 2 * (sizeof(uint64_t) + sizeof(uint32_t)) + 3 * sizeof(Record);
+        REQUIRE(file.size() == sizeof(Header) + statTableSize + framesSize);
+
+        Header h;
+        memcpy(&h, file.data(), sizeof(h));
+        CHECK(h.Magic == FrameStats::DUMP_MAGIC);
+        CHECK(h.Version == FrameStats::DUMP_VERSION);
+        CHECK(h.NumStats == 2);
+        CHECK(h.NumFrames == 2);
+
+        const uint8_t* curr = file.data() + sizeof(Header);
+        CHECK(strcmp(reinterpret_cast<const char*>(curr), "Dump") == 0);
+        CHECK(strcmp(reinterpret_cast<const char*>(curr + Stat::GROUP_LEN), "A") == 0);
+        curr += statTableSize;
+
+        uint64_t frame;
+        uint32_t count;
+        Record r;
+
+        memcpy(&frame, curr, sizeof(frame));
+        memcpy(&count, curr + sizeof(frame), sizeof(count));
+        curr += sizeof(frame) + sizeof(count);
+        CHECK(frame == 1);
+        REQUIRE(count == 2);
+
+        memcpy(&r, curr, sizeof(r));
+        CHECK(r.ID == a);
+        CHECK(r.Type == (uint32_t)Stat::ST_TYPE::ST_INT);
+        CHECK(r.Bits == 2);
+
+        memcpy(&r, curr + sizeof(r), sizeof(r));
+        CHECK(r.ID == b);
+        CHECK(r.Type == (uint32_t)Stat::ST_TYPE::ST_UINT64);
+        CHECK(r.Bits == uint64_t(1) << 40);
+        curr += 2 * sizeof(r);
+
+        memcpy(&frame, curr, sizeof(frame));
+        memcpy(&count, curr + sizeof(frame), sizeof(count));
+        curr += sizeof(frame) + sizeof(count);
+        CHECK(frame == 2);
+        REQUIRE(count == 1);
+
+        memcpy(&r, curr, sizeof(r));
+        CHECK(r.ID == b);
+        CHECK(r.Bits == 3);
+    }
+}
\ No newline at end of file
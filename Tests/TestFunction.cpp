@@ -0,0 +1,341 @@
+#include <App/Headless.h>
+#include <Support/Task.h>
+#include <Utility/Function.h>
+#include <doctest/doctest.h>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    // Checks that it's never memcpy'd to another address
+    struct SelfReferencing
+    {
+        explicit SelfReferencing(int* sum, int* numDestructed)
+            : Self(this),
+            Sum(sum),
+            NumDestructed(numDestructed)
+        {}
+        SelfReferencing(SelfReferencing&& other) noexcept
+            : Self(this),
+            Sum(other.Sum),
+            NumDestructed(other.NumDestructed)
+        {}
+        ~SelfReferencing()
+        {
+            (*NumDestructed)++;
+        }
+
+        void operator()()
+        {
+            *Sum += Self == this ? 1 : 1000;
+        }
+
+        SelfReferencing* Self;
+        int* Sum;
+        int* NumDestructed;
+    };
+
+    // Function before inline/spilled storage, for comparison
+    struct LegacyFunction
+    {
+        LegacyFunction() = default;
+
+        template <typename F>
+        LegacyFunction(F&& f)
+        {
+            static_assert(sizeof(F) <= BUFFER_SIZE, "Memory needed exceeded capture buffer size.");
+
+            m_lambda = &Get<F>();
+            new (&m_buffer) F(ZetaMove(f));
+        }
+
+        ~LegacyFunction()
+        {
+            if (m_lambda)
+                m_lambda->destruct(&m_buffer);
+        }
+
+        LegacyFunction(LegacyFunction&& other)
+            : m_lambda(other.m_lambda)
+        {
+            other.m_lambda = nullptr;
+            memcpy(m_buffer, other.m_buffer, BUFFER_SIZE);
+            memset(other.m_buffer, 0, BUFFER_SIZE);
+        }
+
+        LegacyFunction& operator=(LegacyFunction&& other)
+        {
+            m_lambda = other.m_lambda;
+            other.m_lambda = nullptr;
+            memcpy(m_buffer, other.m_buffer, BUFFER_SIZE);
+            memset(other.m_buffer, 0, BUFFER_SIZE);
+
+            return *this;
+        }
+
+        ZetaInline void Run()
+        {
+            return m_lambda->call(&m_buffer);
+        }
+
+    private:
+        static constexpr int BUFFER_SIZE = Function::BUFFER_SIZE;
+
+        struct LambdaFuncPtrs
+        {
+            void (*call)(void*);
+            void (*destruct)(void*);
+        };
+
+        template <typename F>
+        static void Call(void* f)
+        {
+            (*reinterpret_cast<F*>(f))();
+        }
+
+        template <typename F>
+        static void Destruct(void* f)
+        {
+            reinterpret_cast<F*>(f)->~F();
+        }
+
+        template <typename F>
+        const LambdaFuncPtrs& Get()
+        {
+            static const LambdaFuncPtrs lambda = { &Call<F>, &Destruct<F> };
+            return lambda;
+        }
+
+        const LambdaFuncPtrs* m_lambda = nullptr;
+        alignas(alignof(std::max_align_t)) uint8_t m_buffer[BUFFER_SIZE];
+    };
+
+    struct Context
+    {
+        float Data[32];
+        float* Out;
+    };
+
+    // Creates n callables, moves them once (as TaskSet does when it sorts) and runs them.
+    // Returns ns per callable.
+    template <typename Func, typename MakeFn>
+    double Measure(int n, Func* funcs, Func* sorted, MakeFn make)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < n; i++)
+            funcs[i] = make(i);
+
+        for (int i = 0; i < n; i++)
+            sorted[n - 1 - i] = ZetaMove(funcs[i]);
+
+        for (int i = 0; i < n; i++)
+            sorted[i].Run();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / n;
+    }
+}
+
+TEST_SUITE("Function")
+{
+    TEST_CASE("Inline")
+    {
+        int sum = 0;
+        Function f([&sum]() { sum++; });
+        CHECK(f.IsSet());
+        CHECK(!f.IsSpilled());
+
+        Function g(ZetaMove(f));
+        CHECK(!f.IsSet());
+        g.Run();
+        CHECK(sum == 1);
+
+        // Previous callable is destructed
+        int numDestructed = 0;
+        g = Function(SelfReferencing(&sum, &numDestructed));
+        numDestructed = 0;
+
+        Function h;
+        h = ZetaMove(g);
+        CHECK(!g.IsSet());
+        CHECK(!h.IsSpilled());
+        h.Run();
+        CHECK(sum == 2);
+        CHECK(numDestructed == 1);
+
+        h = Function([&sum]() { sum += 10; });
+        CHECK(numDestructed == 2);
+        h.Run();
+        CHECK(sum == 12);
+    }
+
+    TEST_CASE("Spilled")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        App::Headless::BeginFrame();
+
+        float out = 0.0f;
+        int numDestructed = 0;
+        int sum = 0;
+
+        {
+            Context ctx;
+            for (int i = 0; i < 32; i++)
+                ctx.Data[i] = (float)i;
+            ctx.Out = &out;
+
+            static_assert(!Function::IsInline<Context>());
+
+            // Captured by value
+            Function f([ctx]()
+                {
+                    float s = 0.0f;
+                    for (int i = 0; i < 32; i++)
+                        s += ctx.Data[i];
+
+                    *ctx.Out = s;
+                });
+            CHECK(f.IsSpilled());
+
+            Function g(ZetaMove(f));
+            CHECK(!f.IsSet());
+            CHECK(g.IsSpilled());
+            g.Run();
+            CHECK(out == 496.0f);
+
+            struct Large
+            {
+                SelfReferencing S;
+                char Padding[64];
+            };
+
+            Function h([l = Large{ .S = SelfReferencing(&sum, &numDestructed) }]() mutable { l.S(); });
+            numDestructed = 0;
+            Function k;
+            k = ZetaMove(h);
+            k.Run();
+            CHECK(sum == 1);
+            CHECK(numDestructed == 0);
+        }
+
+        CHECK(numDestructed == 1);
+
+        // Moved to the heap, e.g. for background tasks that outlive the frame
+        {
+            struct Large
+            {
+                SelfReferencing S;
+                char Padding[64];
+            };
+
+            sum = 0;
+            Function h([l = Large{ .S = SelfReferencing(&sum, &numDestructed) }]() mutable { l.S(); });
+            numDestructed = 0;
+            h.MoveToHeap();
+            CHECK(!h.IsSpilled());
+            // Frame copy is destructed
+            CHECK(numDestructed == 1);
+
+            Function k(ZetaMove(h));
+            k.Run();
+            CHECK(sum == 1);
+
+            Task t("Background", TASK_PRIORITY::BACKGROUND,
+                [l = Large{ .S = SelfReferencing(&sum, &numDestructed) }]() mutable { l.S(); });
+            numDestructed = 0;
+        }
+
+        // Both callables on the heap are destructed
+        CHECK(numDestructed == 2);
+
+        // Tasks can capture context by value
+        TaskSet ts;
+        std::atomic<float> total = 0.0f;
+        float data[24];
+        for (int i = 0; i < 24; i++)
+            data[i] = 1.0f;
+
+        for (int i = 0; i < 4; i++)
+        {
+            ts.EmplaceTask("Spilled", [&total, i, data]()
+                {
+                    float s = 0.0f;
+                    for (int j = 0; j < 24; j++)
+                        s += data[j] * (float)i;
+
+                    total.fetch_add(s);
+                });
+        }
+
+        ts.Sort();
+        ts.Finalize();
+        App::Submit(ZetaMove(ts));
+        App::FlushWorkerThreadPool();
+
+        CHECK(total.load() == 24.0f * 6);
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        constexpr int N = 64 * 1024;
+        constexpr int NUM_ITERATIONS = 20;
+
+        App::Headless::Init({ .NumWorkerThreads = 1, .Pinning = THREAD_PINNING::NONE });
+
+        auto* legacy = new LegacyFunction[N];
+        auto* legacySorted = new LegacyFunction[N];
+        auto* funcs = new Function[N];
+        auto* funcsSorted = new Function[N];
+        float out = 0.0f;
+        Context ctx;
+        for (int i = 0; i < 32; i++)
+            ctx.Data[i] = (float)i;
+        ctx.Out = &out;
+
+        double legacySmall = 0.0;
+        double small = 0.0;
+        double legacyLarge = 0.0;
+        double large = 0.0;
+
+        for (int it = 0; it < NUM_ITERATIONS; it++)
+        {
+            App::Headless::BeginFrame();
+
+            legacySmall += Measure(N, legacy, legacySorted, [&out](int i)
+                {
+                    return LegacyFunction([&out, i]() { out += (float)i; });
+                });
+            small += Measure(N, funcs, funcsSorted, [&out](int i)
+                {
+                    return Function([&out, i]() { out += (float)i; });
+                });
+            // Legacy has to capture a pointer to shared context
+            legacyLarge += Measure(N, legacy, legacySorted, [&ctx](int i)
+                {
+                    return LegacyFunction([c = &ctx, i]() { *c->Out += c->Data[i & 31]; });
+                });
+            large += Measure(N, funcs, funcsSorted, [&ctx](int i)
+                {
+                    return Function([ctx, i]() { *ctx.Out += ctx.Data[i & 31]; });
+                });
+        }
+
+        MESSAGE("Small capture: legacy ", legacySmall / NUM_ITERATIONS, " ns, inline ",
+            small / NUM_ITERATIONS, " ns per task");
+        MESSAGE("Large capture: legacy (by pointer) ", legacyLarge / NUM_ITERATIONS,
+            " ns, spilled (by value) ", large / NUM_ITERATIONS, " ns per task");
+
+        delete[] legacy;
+        delete[] legacySorted;
+        delete[] funcs;
+        delete[] funcsSorted;
+
+        App::Headless::Shutdown();
+    }
+}
\ No newline at end of file
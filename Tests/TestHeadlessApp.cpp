@@ -0,0 +1,1169 @@
+#include <App/Headless.h>
+#include <App/Timer.h>
+#include <App/Filesystem.h>
+#include <Support/Task.h>
+#include <Support/FrameStats.h>
+#include <Support/FramePipeline.h>
+#include <Support/Lock.h>
+#include <Support/TaskSignalPool.h>
+#include <Support/CpuTopology.h>
+#include <Support/Param.h>
+#include <Scene/SceneCore.h>
+#include <Core/dds.h>
+#include <RayTracing/TriangleBVH.h>
+#include <Math/MatrixFuncs.h>
+#include <Math/CollisionFuncs.h>
+#include <Math/Sampling.h>
+#include <Utility/RNG.h>
+#include <Utility/SynchronizedView.h>
+#include <doctest/doctest.h>
+#include <thread>
+#include <chrono>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::RT;
+
+namespace
+{
+    struct BVHPrimSource
+    {
+        float3 Center;
+        float Extent;
+    };
+
+    struct ReplayListener
+    {
+        void OnParamChanged(const ParamVariant& p) {}
+        void OnTransform(const CapturedTransform& t)
+        {
+            InstanceIDs.push_back(t.InstanceID);
+        }
+        void OnUpdate(double dt)
+        {
+            NumUpdates++;
+            TotalDt += dt;
+        }
+
+        SmallVector<uint64_t> InstanceIDs;
+        int NumUpdates = 0;
+        double TotalDt = 0.0;
+    };
+
+    bool Equal(const float3& a, const float3& b)
+    {
+        return (a - b).length() < 1e-5f;
+    }
+
+    // Same as a frame of the Win32 backend, minus rendering
+    void UpdateScene()
+    {
+        App::Headless::BeginFrame();
+
+        TaskSet sceneTS;
+        TaskSet sceneRendererTS;
+        App::GetScene().Update(App::GetTimer().GetElapsedTime(), sceneTS, sceneRendererTS);
+
+        sceneTS.Sort();
+        sceneRendererTS.Sort();
+        sceneTS.ConnectTo(sceneRendererTS);
+        sceneTS.Finalize();
+        sceneRendererTS.Finalize();
+        App::Submit(ZetaMove(sceneTS));
+        App::Submit(ZetaMove(sceneRendererTS));
+
+        App::FlushWorkerThreadPool();
+    }
+
+    // Parent (ID 1) at (1, 2, 3) without a mesh and a child (ID 2) with a triangle that's
+    // one unit above it. Returns the mesh index.
+    uint32_t AddParentAndChild(Scene::SceneCore& scene)
+    {
+        SmallVector<Core::Vertex> vertices;
+        vertices.resize(3);
+        vertices[0].Position = float3(0.0f, 0.0f, 0.0f);
+        vertices[1].Position = float3(1.0f, 0.0f, 0.0f);
+        vertices[2].Position = float3(0.0f, 1.0f, 0.0f);
+        SmallVector<uint32_t> indices;
+        indices.push_back(0);
+        indices.push_back(1);
+        indices.push_back(2);
+        const uint32_t meshIdx = scene.AddMesh(ZetaMove(vertices), ZetaMove(indices), Scene::DEFAULT_MATERIAL_ID);
+
+        // One instance on each level
+        int levels[] = { 1, 1 };
+        scene.ReserveInstances(levels, 2);
+
+        Model::glTF::Asset::InstanceDesc parent{ .LocalTransform = AffineTransformation::GetIdentity(),
+            .SceneID = Scene::DEFAULT_SCENE_ID,
+            .ID = 1,
+            .ParentID = Scene::SceneCore::ROOT_ID,
+            .MeshIdx = -1,
+            .MeshPrimIdx = 0,
+            .RtMeshMode = Model::RT_MESH_MODE::STATIC,
+            .RtInstanceMask = RT_AS_SUBGROUP::NON_EMISSIVE,
+            .IsOpaque = true };
+        parent.LocalTransform.Translation = float3(1.0f, 2.0f, 3.0f);
+        scene.AddInstance(parent);
+
+        Model::glTF::Asset::InstanceDesc child = parent;
+        child.LocalTransform = AffineTransformation::GetIdentity();
+        child.LocalTransform.Translation = float3(0.0f, 0.0f, 1.0f);
+        child.ID = 2;
+        child.ParentID = 1;
+        child.MeshIdx = (int)meshIdx;
+        scene.AddInstance(child);
+
+        return meshIdx;
+    }
+}
+
+TEST_SUITE("HeadlessApp")
+{
+    TEST_CASE("ThreadPools")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 4, .NumBackgroundThreads = 2, .Pinning = THREAD_PINNING::NONE });
+
+        CHECK(App::GetNumWorkerThreads() == 4);
+        CHECK(App::GetNumBackgroundThreads() == 2);
+        CHECK(App::GetCurrentThreadIdx() == 0);
+
+        auto ids = App::GetAllThreadIDs();
+        REQUIRE(ids.size() == 6);
+
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            CHECK(ids[i] != 0);
+
+            for (size_t j = i + 1; j < ids.size(); j++)
+                CHECK(ids[i] != ids[j]);
+        }
+
+        // Available even when threads aren't pinned
+        const CpuTopology& topology = App::GetCpuTopology();
+        const App::CpuInfo info = App::GetProcessorInfo();
+        CHECK(topology.NumPhysicalCores() == info.NumPhysicalCores);
+        CHECK(topology.NumLogicalProcessors() == info.NumLogicalCores);
+        CHECK(topology.NumLogicalProcessors() >= topology.NumPhysicalCores());
+        CHECK(topology.NumNodes() >= 1);
+
+        for (int frame = 0; frame < 3; frame++)
+        {
+            App::Headless::BeginFrame();
+
+            std::atomic_int32_t numRun = 0;
+            std::atomic_int32_t badThreadIdx = 0;
+            int order[2] = { -1, -1 };
+            std::atomic_int32_t next = 0;
+
+            TaskSet ts;
+
+            for (int i = 0; i < 8; i++)
+            {
+                ts.EmplaceTask("Work", [&numRun, &badThreadIdx]()
+                    {
+                        const int idx = App::GetCurrentThreadIdx();
+                        if (idx < 0 || idx >= App::GetNumWorkerThreads())
+                            badThreadIdx.fetch_add(1, std::memory_order_relaxed);
+
+                        numRun.fetch_add(1, std::memory_order_relaxed);
+                    });
+            }
+
+            auto a = ts.EmplaceTask("A", [&order, &next]()
+                {
+                    order[0] = next.fetch_add(1, std::memory_order_relaxed);
+                });
+            auto b = ts.EmplaceTask("B", [&order, &next]()
+                {
+                    order[1] = next.fetch_add(1, std::memory_order_relaxed);
+                });
+            ts.AddOutgoingEdge(a, b);
+
+            ts.Sort();
+            ts.Finalize();
+            App::Submit(ZetaMove(ts));
+
+            std::atomic_int32_t backgroundIdx = -1;
+            Task t("Background", TASK_PRIORITY::BACKGROUND, [&backgroundIdx]()
+                {
+                    backgroundIdx.store(App::GetCurrentThreadIdx(), std::memory_order_relaxed);
+                });
+            App::SubmitBackground(ZetaMove(t));
+
+            App::FlushAllThreadPools();
+
+            CHECK(numRun.load() == 8);
+            CHECK(badThreadIdx.load() == 0);
+            CHECK(order[0] == 0);
+            CHECK(order[1] == 1);
+            CHECK(backgroundIdx.load() >= 0);
+        }
+
+        CHECK(App::GetTimer().GetTotalFrameCount() == 3);
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("Pinning")
+    {
+        cpu_set_t prevSet;
+        REQUIRE(sched_getaffinity(0, sizeof(prevSet), &prevSet) == 0);
+
+        App::Headless::Init({ .NumWorkerThreads = 2, .NumBackgroundThreads = 1,
+            .Pinning = THREAD_PINNING::COMPACT });
+
+        // Main thread is pinned to the first core
+        cpu_set_t set;
+        REQUIRE(sched_getaffinity(0, sizeof(set), &set) == 0);
+        CHECK(CPU_COUNT(&set) == 1);
+
+        for (int frame = 0; frame < 2; frame++)
+        {
+            App::Headless::BeginFrame();
+
+            std::atomic_int32_t numFailed = 0;
+            TaskSet ts;
+
+            for (int i = 0; i < 4; i++)
+            {
+                ts.EmplaceTask("Pinned", [&numFailed]()
+                    {
+                        cpu_set_t workerSet;
+                        if (sched_getaffinity(0, sizeof(workerSet), &workerSet) != 0 || CPU_COUNT(&workerSet) != 1)
+                            numFailed.fetch_add(1, std::memory_order_relaxed);
+
+                        // Blocks come from the node of the calling thread
+                        auto* mem = reinterpret_cast<uint8_t*>(App::AllocateFrameAllocator(64 * 1024, 64));
+                        memset(mem, 0xab, 64 * 1024);
+                    });
+            }
+
+            ts.Sort();
+            ts.Finalize();
+            App::Submit(ZetaMove(ts));
+            App::FlushWorkerThreadPool();
+
+            CHECK(numFailed.load() == 0);
+        }
+
+        App::Headless::Shutdown();
+
+        // Don't leave the test runner pinned
+        sched_setaffinity(0, sizeof(prevSet), &prevSet);
+    }
+
+    TEST_CASE("FrameAllocator")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 3, .Pinning = THREAD_PINNING::NONE });
+
+        for (int frame = 0; frame < 4; frame++)
+        {
+            App::Headless::BeginFrame();
+
+            // Stats that were added during the previous frame are merged at the start
+            // of this one. Task stats are added every frame, frame pipeline stats once a
+            // frame has completed.
+            {
+                auto stats = App::GetStats();
+
+                // Lock stats depend on which locks were taken, scene memory stats on
+                // which containers the scene has
+                size_t numStats = 0;
+                for (auto& s : stats.m_span)
+                {
+                    numStats += strcmp(s.GetGroup(), LOCK_STAT_GROUP) != 0 &&
+                        strcmp(s.GetGroup(), "Scene memory") != 0;
+                }
+
+                REQUIRE(numStats == (frame == 0 ? 2 + 3 : 3 + 3 + (int)FRAME_STAGE::COUNT + 1));
+
+                if (frame > 0)
+                {
+                    int numFound = 0;
+
+                    for (auto& s : stats.m_span)
+                    {
+                        if (strcmp(s.GetGroup(), "Test") == 0 && strcmp(s.GetName(), "Frame") == 0)
+                        {
+                            CHECK(s.GetUInt() == (uint32_t)frame - 1);
+                            numFound++;
+                        }
+                        // The six tasks of the previous frame
+                        else if (strcmp(s.GetName(), TASK_STAT_NUM_TASKS) == 0)
+                        {
+                            CHECK(s.GetInt() == 6);
+                            numFound++;
+                        }
+                    }
+
+                    CHECK(numFound == 2);
+                }
+            }
+
+            // Without a GPU, the previous frame has completed by now
+            CHECK(App::GetFramePipeline().GetCurrentFrame() == (uint64_t)frame);
+            CHECK(App::GetFramePipeline().GetNumCompletedFrames() == (uint64_t)frame);
+
+            App::AddFrameStat("Test", "Frame", (uint32_t)frame);
+
+            std::atomic_int32_t numFailed = 0;
+            TaskSet ts;
+
+            for (int i = 0; i < 6; i++)
+            {
+                ts.EmplaceTask("Alloc", [&numFailed, i]()
+                    {
+                        for (int j = 0; j < 64; j++)
+                        {
+                            const size_t size = 1024 + j * 37;
+                            const size_t alignment = 16 << (j & 3);
+                            auto* mem = reinterpret_cast<uint8_t*>(App::AllocateFrameAllocator(size, alignment));
+
+                            if ((reinterpret_cast<uintptr_t>(mem) & (alignment - 1)) != 0)
+                                numFailed.fetch_add(1, std::memory_order_relaxed);
+
+                            memset(mem, i, size);
+
+                            for (size_t k = 0; k < size; k++)
+                            {
+                                if (mem[k] != i)
+                                {
+                                    numFailed.fetch_add(1, std::memory_order_relaxed);
+                                    break;
+                                }
+                            }
+                        }
+                    });
+            }
+
+            ts.Sort();
+            ts.Finalize();
+            App::Submit(ZetaMove(ts));
+
+            // Main thread can use it too
+            void* mem = App::AllocateFrameAllocator(4096, 64);
+            CHECK((reinterpret_cast<uintptr_t>(mem) & 63) == 0);
+
+            App::FlushWorkerThreadPool();
+            CHECK(numFailed.load() == 0);
+        }
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("AliasTableFrameAllocator")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+
+        float weights[1000];
+        for (int i = 0; i < 1000; i++)
+            weights[i] = (float)(1 + i % 7);
+
+        // One-time allocators are reset by Clear(), so the builder can be reused every frame
+        AliasTableBuilder<App::OneTimeFrameAllocatorWithFallback> builder;
+        AliasTableBuilder<> reference;
+        reference.Init(Span(weights, 1000), 1);
+        reference.Sum(0);
+        reference.Classify(0);
+        reference.Partition(0);
+
+        for (int frame = 0; frame < 3; frame++)
+        {
+            App::Headless::BeginFrame();
+
+            builder.Clear();
+            builder.Init(Span(weights, 1000), 3);
+
+            for (int c = 0; c < builder.NumChunks(); c++)
+                builder.Sum(c);
+            for (int c = 0; c < builder.NumChunks(); c++)
+                builder.Classify(c);
+            for (int c = 0; c < builder.NumChunks(); c++)
+                builder.Partition(c);
+
+            uint32_t aliases[1000];
+            uint32_t refAliases[1000];
+            for (int c = 0; c < builder.NumChunks(); c++)
+                builder.Assign(c, [&aliases](uint32_t i, float, uint32_t alias) { aliases[i] = alias; });
+            reference.Assign(0, [&refAliases](uint32_t i, float, uint32_t alias) { refAliases[i] = alias; });
+
+            CHECK(memcmp(aliases, refAliases, sizeof(aliases)) == 0);
+        }
+
+        builder.Clear();
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("FrameStats")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 4, .Pinning = THREAD_PINNING::NONE });
+
+        const uint32_t id = App::RegisterFrameStat("Test", "Worker");
+        CHECK(App::RegisterFrameStat("Test", "Worker") == id);
+
+        for (int frame = 0; frame < 5; frame++)
+        {
+            App::Headless::BeginFrame();
+
+            if (frame > 0)
+            {
+                auto stats = App::GetStats();
+                bool found = false;
+
+                for (Stat s : stats.m_span)
+                {
+                    if (strcmp(s.GetName(), "Worker") == 0)
+                    {
+                        CHECK(s.GetFloat() == (float)(frame - 1));
+                        found = true;
+                    }
+                }
+
+                CHECK(found);
+            }
+
+            TaskSet ts;
+
+            for (int i = 0; i < 8; i++)
+            {
+                ts.EmplaceTask("Stat", [id, frame]()
+                    {
+                        App::AddFrameStat(id, (float)frame);
+                    });
+            }
+
+            ts.Sort();
+            ts.Finalize();
+            App::Submit(ZetaMove(ts));
+            App::FlushWorkerThreadPool();
+        }
+
+        StatPercentiles p = App::GetFrameStatPercentiles(id);
+        CHECK(p.NumSamples == 4);
+        CHECK(p.P50 == 1.0f);
+        CHECK(p.P99 == 3.0f);
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("Timer")
+    {
+        App::DeltaTimer dt;
+        dt.Start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        dt.End();
+
+        CHECK(dt.DeltaMilli() >= 5.0);
+        CHECK(dt.DeltaMilli() < 5000.0);
+        CHECK(dt.DeltaMicro() >= 5000.0);
+
+        App::Timer timer;
+        timer.Start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        timer.Tick();
+
+        CHECK(timer.GetTotalFrameCount() == 1);
+        CHECK(timer.GetElapsedTime() >= 0.002);
+        CHECK(timer.GetTotalTime() >= timer.GetElapsedTime());
+    }
+
+    TEST_CASE("Filesystem")
+    {
+        const char* dir = "TestHeadlessApp";
+        const char* path = "TestHeadlessApp/a.bin";
+        const char* copyPath = "TestHeadlessApp/b.bin";
+
+        App::Filesystem::CreateDirectoryIfNotExists(dir);
+        App::Filesystem::CreateDirectoryIfNotExists(dir);
+        CHECK(App::Filesystem::IsDirectory(dir));
+        CHECK(!App::Filesystem::Exists(dir));
+        CHECK(App::Filesystem::GetFileSize(path) == size_t(-1));
+
+        uint8_t data[3000];
+        for (int i = 0; i < (int)sizeof(data); i++)
+            data[i] = uint8_t(i * 13 + 1);
+
+        App::Filesystem::WriteToFile(path, data, sizeof(data));
+        CHECK(App::Filesystem::Exists(path));
+        CHECK(!App::Filesystem::IsDirectory(path));
+        CHECK(App::Filesystem::GetFileSize(path) == sizeof(data));
+
+        SmallVector<uint8_t> loaded;
+        App::Filesystem::LoadFromFile(path, loaded);
+        REQUIRE(loaded.size() == sizeof(data));
+        CHECK(memcmp(loaded.data(), data, sizeof(data)) == 0);
+
+        CHECK(App::Filesystem::Copy(path, copyPath));
+        CHECK(!App::Filesystem::Copy(path, copyPath));
+        CHECK(App::Filesystem::Copy(path, copyPath, true));
+        CHECK(App::Filesystem::GetFileSize(copyPath) == sizeof(data));
+
+        void* f = App::Filesystem::OpenFileForRead(copyPath);
+        REQUIRE(f);
+
+        uint8_t range[100];
+        CHECK(App::Filesystem::ReadFromFile(f, 1000, MutableSpan<uint8_t>(range, sizeof(range))));
+        CHECK(memcmp(range, data + 1000, sizeof(range)) == 0);
+        CHECK(!App::Filesystem::ReadFromFile(f, sizeof(data) - 10, MutableSpan<uint8_t>(range, sizeof(range))));
+        App::Filesystem::CloseFile(f);
+
+        App::Filesystem::RemoveFile(copyPath);
+        App::Filesystem::RemoveFile(path);
+        CHECK(!App::Filesystem::Exists(path));
+        rmdir(dir);
+    }
+
+    TEST_CASE("Replay")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+
+        const char* path = "TestHeadlessApp.zcap";
+        ReplayListener l;
+        auto dlg = fastdelegate::MakeDelegate(&l, &ReplayListener::OnParamChanged);
+
+        ParamVariant exposure;
+        exposure.InitFloat("Test", "Replay", "Exposure", dlg, 1.0f, 0.0f, 10.0f, 0.1f);
+        App::AddParam(exposure);
+        ParamVariant removed;
+        removed.InitBool("Test", "Replay", "Removed", dlg, true);
+        App::AddParam(removed);
+        App::Headless::BeginFrame();
+
+        App::BeginFrameCapture();
+        CHECK(App::IsCapturingFrames());
+        double capturedDt = 0.0;
+
+        App::Headless::BeginFrame();
+        capturedDt += App::GetTimer().GetElapsedTime();
+
+        App::SetParam("Test", "Replay", "Exposure", "2.5");
+        App::Headless::BeginFrame();
+        capturedDt += App::GetTimer().GetElapsedTime();
+        App::CaptureTransformEdit(7, float3(1.0f), float3x3(float3(1, 0, 0), float3(0, 1, 0), float3(0, 0, 1)),
+            float3(1.0f));
+
+        App::Headless::BeginFrame();
+        capturedDt += App::GetTimer().GetElapsedTime();
+        App::CaptureTransformEdit(8, float3(2.0f), float3x3(float3(1, 0, 0), float3(0, 1, 0), float3(0, 0, 1)),
+            float3(1.0f));
+
+        App::EndFrameCapture(path);
+        CHECK(!App::IsCapturingFrames());
+        // Not recorded
+        App::CaptureTransformEdit(9, float3(0.0f), float3x3(float3(1, 0, 0), float3(0, 1, 0), float3(0, 0, 1)),
+            float3(1.0f));
+
+        App::SetParam("Test", "Replay", "Exposure", "5");
+        App::RemoveParam("Test", "Replay", "Removed");
+        App::Headless::BeginFrame();
+        ParamVariant found;
+        REQUIRE(App::FindParam("Test", "Replay", "Exposure", found));
+        CHECK(found.GetFloat().m_value == 5.0f);
+
+        App::Headless::ReplayHandlers handlers{
+            .OnTransform = fastdelegate::MakeDelegate(&l, &ReplayListener::OnTransform),
+            .OnUpdate = fastdelegate::MakeDelegate(&l, &ReplayListener::OnUpdate) };
+        App::Headless::ReplayStats stats;
+
+        REQUIRE(App::Headless::Replay(path, handlers, stats));
+        App::Filesystem::RemoveFile(path);
+
+        CHECK(stats.NumFrames == 3);
+        // Recorded on the first frame, but no longer exists
+        CHECK(stats.NumSkippedParams == 1);
+        CHECK(stats.UpdateMs >= 0.0);
+        REQUIRE(App::FindParam("Test", "Replay", "Exposure", found));
+        CHECK(found.GetFloat().m_value == 2.5f);
+        CHECK(!App::FindParam("Test", "Replay", "Removed", found));
+
+        REQUIRE(l.InstanceIDs.size() == 2);
+        CHECK(l.InstanceIDs[0] == 7);
+        CHECK(l.InstanceIDs[1] == 8);
+        // Frames are replayed with the captured elapsed times
+        CHECK(l.NumUpdates == 3);
+        CHECK(l.TotalDt == capturedDt);
+
+        CHECK(!App::Headless::Replay("Missing.zcap", handlers, stats));
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("Scene")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        Scene::SceneCore& scene = App::GetScene();
+
+        const uint32_t meshIdx = AddParentAndChild(scene);
+        UpdateScene();
+
+        CHECK(Equal(scene.GetToWorld(2).m[3], float3(1.0f, 2.0f, 4.0f)));
+        CHECK(scene.GetInstanceMeshID(2) == Scene::MeshID(Scene::DEFAULT_SCENE_ID, meshIdx, 0));
+
+        // Moving the parent moves its subtree
+        App::Headless::BeginFrame();
+        scene.TransformInstance(1, float3(1.0f, 0.0f, 0.0f), float3x3(float3(1, 0, 0), float3(0, 1, 0),
+            float3(0, 0, 1)), float3(1.0f));
+        UpdateScene();
+
+        CHECK(Equal(scene.GetToWorld(1).m[3], float3(2.0f, 2.0f, 3.0f)));
+        CHECK(Equal(scene.GetToWorld(2).m[3], float3(2.0f, 2.0f, 4.0f)));
+        CHECK(Equal(scene.GetPrevToWorld(2).value()->m[3], float3(1.0f, 2.0f, 4.0f)));
+
+        // Scene memory is sampled into frame stats once per frame
+        App::Headless::BeginFrame();
+        bool found = false;
+
+        for (Stat s : App::GetStats().m_span)
+        {
+            if (strcmp(s.GetGroup(), "Scene memory") == 0 && strcmp(s.GetName(), "SceneCore (KB)") == 0)
+                found = true;
+        }
+
+        CHECK(found);
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("ReplayScene")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        Scene::SceneCore& scene = App::GetScene();
+        AddParentAndChild(scene);
+        UpdateScene();
+
+        const char* path = "TestHeadlessAppScene.zcap";
+        App::BeginFrameCapture();
+        UpdateScene();
+
+        // Edit from the GUI, after this frame's update. Takes effect in the next frame.
+        scene.TransformInstance(1, float3(1.0f, 0.0f, 0.0f), float3x3(float3(1, 0, 0), float3(0, 1, 0),
+            float3(0, 0, 1)), float3(1.0f));
+        UpdateScene();
+        CHECK(Equal(scene.GetToWorld(2).m[3], float3(2.0f, 2.0f, 4.0f)));
+
+        App::EndFrameCapture(path);
+
+        // Edit is captured in the frame where it was applied
+        FrameCaptureReader reader;
+        REQUIRE(reader.Load(path));
+        REQUIRE(reader.NumFrames() == 2);
+        CapturedFrame frame;
+        CapturedEvent event;
+        int numTransforms[2] = { 0, 0 };
+
+        for (int i = 0; i < 2; i++)
+        {
+            REQUIRE(reader.NextFrame(frame));
+
+            while (reader.NextEvent(event))
+                numTransforms[i] += event.Type == CAPTURE_EVENT::TRANSFORM;
+        }
+
+        CHECK(numTransforms[0] == 0);
+        CHECK(numTransforms[1] == 1);
+
+        // Replayed edit is applied on top of the current state
+        App::Headless::ReplayStats stats;
+        REQUIRE(App::Headless::ReplayScene(path, stats));
+        App::Filesystem::RemoveFile(path);
+
+        CHECK(stats.NumFrames == 2);
+        CHECK(Equal(scene.GetToWorld(1).m[3], float3(3.0f, 2.0f, 3.0f)));
+        CHECK(Equal(scene.GetToWorld(2).m[3], float3(3.0f, 2.0f, 4.0f)));
+        CHECK(Equal(scene.GetPrevToWorld(2).value()->m[3], float3(2.0f, 2.0f, 4.0f)));
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("SimulateAhead")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        Scene::SceneCore& scene = App::GetScene();
+        AddParentAndChild(scene);
+        scene.SetPickedInstance(2);
+        UpdateScene();
+
+        Span<Scene::PickedInstance> picked = scene.GetPickedInstanceStates();
+        REQUIRE(picked.size() == 1);
+        CHECK(picked[0].ID == 2);
+        CHECK(Equal(picked[0].ToWorld.m[3], float3(1.0f, 2.0f, 4.0f)));
+
+        // Same as the Win32 backend, next frame is simulated while this one is being recorded
+        auto simulateNextFrame = [&scene]()
+            {
+                TaskSet simTS;
+                scene.Simulate(App::GetTimer().GetTotalFrameCount() + 1,
+                    App::GetTimer().GetTotalTime() + App::GetTimer().GetElapsedTime(), simTS);
+
+                simTS.Sort();
+                simTS.Finalize();
+                App::Submit(ZetaMove(simTS));
+                App::FlushWorkerThreadPool();
+            };
+
+        // Edit from the GUI during recording. Next frame was simulated without it, so it's
+        // applied in the frame after.
+        scene.TransformInstance(1, float3(1.0f, 0.0f, 0.0f), float3x3(float3(1, 0, 0), float3(0, 1, 0),
+            float3(0, 0, 1)), float3(1.0f));
+        simulateNextFrame();
+        UpdateScene();
+        CHECK(Equal(scene.GetToWorld(2).m[3], float3(1.0f, 2.0f, 4.0f)));
+
+        // Simulation moves the instance, but published state stays the same until the next update
+        simulateNextFrame();
+        CHECK(Equal(scene.GetToWorld(2).m[3], float3(2.0f, 2.0f, 4.0f)));
+        CHECK(Equal(scene.GetPickedInstanceStates()[0].ToWorld.m[3], float3(1.0f, 2.0f, 4.0f)));
+
+        UpdateScene();
+        CHECK(Equal(scene.GetPickedInstanceStates()[0].ToWorld.m[3], float3(2.0f, 2.0f, 4.0f)));
+        CHECK(Equal(scene.GetPrevToWorld(2).value()->m[3], float3(1.0f, 2.0f, 4.0f)));
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("SkinnedMesh")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        Scene::SceneCore& scene = App::GetScene();
+
+        SmallVector<Core::Vertex> vertices;
+        vertices.resize(3);
+        vertices[0].Position = float3(0.0f, 0.0f, 0.0f);
+        vertices[1].Position = float3(1.0f, 0.0f, 0.0f);
+        vertices[2].Position = float3(0.0f, 1.0f, 0.0f);
+        SmallVector<uint32_t> indices;
+        indices.push_back(0);
+        indices.push_back(1);
+        indices.push_back(2);
+        const uint32_t meshIdx = scene.AddMesh(ZetaMove(vertices), ZetaMove(indices), Scene::DEFAULT_MATERIAL_ID);
+
+        int levels[] = { 1 };
+        scene.ReserveInstances(levels, 1);
+
+        Model::glTF::Asset::InstanceDesc instance{ .LocalTransform = AffineTransformation::GetIdentity(),
+            .SceneID = Scene::DEFAULT_SCENE_ID,
+            .ID = 1,
+            .ParentID = Scene::SceneCore::ROOT_ID,
+            .MeshIdx = (int)meshIdx,
+            .MeshPrimIdx = 0,
+            .RtMeshMode = Model::RT_MESH_MODE::DYNAMIC_NO_REBUILD,
+            .RtInstanceMask = RT_AS_SUBGROUP::NON_EMISSIVE,
+            .IsOpaque = true };
+        instance.LocalTransform.Translation = float3(10.0f, 0.0f, 0.0f);
+        scene.AddInstance(instance);
+
+        // One morph target that moves every vertex up by 2
+        Core::Vertex bindPose[3];
+        memcpy(bindPose, scene.GetMeshVertices().data(), sizeof(bindPose));
+        float3 deltas[3] = { float3(0.0f, 2.0f, 0.0f), float3(0.0f, 2.0f, 0.0f), float3(0.0f, 2.0f, 0.0f) };
+        float weights[1] = { 1.0f };
+        scene.AddSkinnedMesh(Scene::SkinnedMeshDesc{ .InstanceID = 1,
+            .Vertices = Span(bindPose, 3),
+            .MorphPositionDeltas = Span(deltas, 3),
+            .MorphWeights = Span(weights, 1) });
+
+        UpdateScene();
+
+        // Deformed vertices replace the mesh's
+        Span<Core::Vertex> deformed = scene.GetMeshVertices();
+        REQUIRE(deformed.size() == 3);
+        CHECK(Equal(deformed[0].Position, float3(0.0f, 2.0f, 0.0f)));
+        CHECK(Equal(deformed[2].Position, float3(0.0f, 3.0f, 0.0f)));
+
+        // Local-space bounds
+        CHECK(Equal(scene.GetAABB(1).Center, float3(0.5f, 2.5f, 0.0f)));
+
+        // World-space bounds
+        Span<BVH::BVHUpdateInput> updates = scene.GetSkinnedMeshBoundsUpdates();
+        REQUIRE(updates.size() == 1);
+        CHECK(updates[0].InstanceID == 1);
+        CHECK(Equal(updates[0].NewBox.Center, float3(10.5f, 2.5f, 0.0f)));
+        CHECK(Equal(updates[0].NewBox.Extents, float3(0.5f, 0.5f, 0.0f)));
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("SharedDeformableMesh")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        Scene::SceneCore& scene = App::GetScene();
+
+        // Mesh primitive that's used by a static and a morphed instance. The latter has a
+        // private copy of it, as the glTF loader would add.
+        SmallVector<Core::Vertex> vertices;
+        vertices.resize(6);
+        for (int i = 0; i < 6; i += 3)
+        {
+            vertices[i].Position = float3(0.0f, 0.0f, 0.0f);
+            vertices[i + 1].Position = float3(1.0f, 0.0f, 0.0f);
+            vertices[i + 2].Position = float3(0.0f, 1.0f, 0.0f);
+        }
+        SmallVector<uint32_t> indices;
+        indices.push_back(0);
+        indices.push_back(1);
+        indices.push_back(2);
+
+        const int nodeIdx = 7;
+        Model::glTF::Asset::Mesh shared{ .SceneID = Scene::DEFAULT_SCENE_ID,
+            .glTFMaterialIdx = -1,
+            .MeshIdx = 0,
+            .MeshPrimIdx = 0,
+            .BaseVtxOffset = 0,
+            .BaseIdxOffset = 0,
+            .NumVertices = 3,
+            .NumIndices = 3 };
+        Model::glTF::Asset::Mesh copy = shared;
+        copy.BaseVtxOffset = 3;
+        copy.NodeIdx = nodeIdx;
+
+        SmallVector<Model::glTF::Asset::Mesh> meshes;
+        meshes.push_back(shared);
+        meshes.push_back(copy);
+        scene.AddMeshes(ZetaMove(meshes), ZetaMove(vertices), ZetaMove(indices));
+
+        int levels[] = { 2 };
+        scene.ReserveInstances(levels, 1);
+
+        Model::glTF::Asset::InstanceDesc instance{ .LocalTransform = AffineTransformation::GetIdentity(),
+            .SceneID = Scene::DEFAULT_SCENE_ID,
+            .ID = 1,
+            .ParentID = Scene::SceneCore::ROOT_ID,
+            .MeshIdx = 0,
+            .MeshPrimIdx = 0,
+            .RtMeshMode = Model::RT_MESH_MODE::STATIC,
+            .RtInstanceMask = RT_AS_SUBGROUP::NON_EMISSIVE,
+            .IsOpaque = true };
+        scene.AddInstance(instance);
+
+        instance.ID = 2;
+        instance.RtMeshMode = Model::RT_MESH_MODE::DYNAMIC_NO_REBUILD;
+        instance.MeshNodeIdx = nodeIdx;
+        scene.AddInstance(instance);
+
+        const uint64_t sharedID = Scene::MeshID(Scene::DEFAULT_SCENE_ID, 0, 0);
+        const uint64_t copyID = Scene::MeshID(Scene::DEFAULT_SCENE_ID, 0, 0, nodeIdx);
+        CHECK(sharedID != copyID);
+        CHECK(scene.GetInstanceMeshID(1) == sharedID);
+        CHECK(scene.GetInstanceMeshID(2) == copyID);
+
+        Core::Vertex bindPose[3];
+        memcpy(bindPose, scene.GetMeshVertices().data(), sizeof(bindPose));
+        float3 deltas[3] = { float3(0.0f, 2.0f, 0.0f), float3(0.0f, 2.0f, 0.0f), float3(0.0f, 2.0f, 0.0f) };
+        float weights[1] = { 1.0f };
+        scene.AddSkinnedMesh(Scene::SkinnedMeshDesc{ .InstanceID = 2,
+            .Vertices = Span(bindPose, 3),
+            .MorphPositionDeltas = Span(deltas, 3),
+            .MorphWeights = Span(weights, 1) });
+
+        UpdateScene();
+
+        // Only the copy is deformed
+        Span<Core::Vertex> all = scene.GetMeshVertices();
+        const uint32_t sharedBase = scene.GetMesh(sharedID).value()->m_vtxBuffStartOffset;
+        const uint32_t copyBase = scene.GetMesh(copyID).value()->m_vtxBuffStartOffset;
+        CHECK(sharedBase != copyBase);
+        CHECK(Equal(all[sharedBase].Position, float3(0.0f, 0.0f, 0.0f)));
+        CHECK(Equal(all[sharedBase + 2].Position, float3(0.0f, 1.0f, 0.0f)));
+        CHECK(Equal(all[copyBase].Position, float3(0.0f, 2.0f, 0.0f)));
+        CHECK(Equal(all[copyBase + 2].Position, float3(0.0f, 3.0f, 0.0f)));
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("TextureStreaming")
+    {
+        using namespace ZetaRay::Core::Direct3DUtil;
+
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = THREAD_PINNING::NONE });
+        Scene::SceneCore& scene = App::GetScene();
+
+        // BC7, 512x256 with a full mip chain
+        constexpr uint32_t WIDTH = 512;
+        constexpr uint32_t HEIGHT = 256;
+        constexpr uint32_t MIP_COUNT = 10;
+        const size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+        size_t dataSize = 0;
+        for (uint32_t m = 0; m < MIP_COUNT; m++)
+            dataSize += Max((WIDTH >> m) / 4, 1u) * Max((HEIGHT >> m) / 4, 1u) * 16;
+
+        SmallVector<uint8_t> file;
+        file.resize(headerSize + dataSize);
+        for (size_t i = headerSize; i < file.size(); i++)
+            file[i] = uint8_t(i * 13 + 5);
+
+        const uint32_t magic = DDS_MAGIC;
+        memcpy(file.data(), &magic, sizeof(uint32_t));
+
+        DDS_HEADER header{};
+        header.size = sizeof(DDS_HEADER);
+        header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+        header.width = WIDTH;
+        header.height = HEIGHT;
+        header.mipMapCount = MIP_COUNT;
+        header.ddspf = DDSPF_DX10;
+        memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+
+        DDS_HEADER_DXT10 dx10Header{};
+        dx10Header.dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+        dx10Header.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+        dx10Header.arraySize = 1;
+        memcpy(file.data() + sizeof(uint32_t) + sizeof(DDS_HEADER), &dx10Header, sizeof(dx10Header));
+
+        const char* path = "TestHeadlessAppStreaming.dds";
+        App::Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+
+        // Only the tail (128x64 and smaller) is read when the texture is added
+        Scene::Streaming::DDSTextureDesc desc;
+        SmallVector<uint8_t> tail;
+        uint32_t firstTailMip;
+        REQUIRE(scene.AddStreamedTexture(path, 1234, desc, tail, firstTailMip));
+        CHECK(desc.Format == DXGI_FORMAT_BC7_UNORM);
+        CHECK(firstTailMip == 2);
+        REQUIRE(tail.size() == desc.MipOffset(MIP_COUNT) - desc.MipOffset(2));
+        CHECK(memcmp(tail.data(), file.data() + desc.MipOffset(2), tail.size()) == 0);
+
+        const Scene::Streaming::MipScheduler& streaming = scene.GetTextureStreaming();
+        CHECK(streaming.IsRenderable(0));
+        CHECK(streaming.ResidentMip(0) == 2);
+
+        // Unit triangle that's textured with it, centered at (0.5, 0.5, 0)
+        Model::glTF::Asset::MaterialDesc matDesc;
+        matDesc.ID = 5;
+        matDesc.BaseColorTexID = 1234;
+        scene.AddMaterial(matDesc);
+
+        SmallVector<Core::Vertex> vertices;
+        vertices.resize(3);
+        vertices[0].Position = float3(0.0f, 0.0f, 0.0f);
+        vertices[1].Position = float3(1.0f, 0.0f, 0.0f);
+        vertices[2].Position = float3(0.0f, 1.0f, 0.0f);
+        SmallVector<uint32_t> indices;
+        indices.push_back(0);
+        indices.push_back(1);
+        indices.push_back(2);
+        const uint32_t meshIdx = scene.AddMesh(ZetaMove(vertices), ZetaMove(indices), matDesc.ID);
+
+        int levels[] = { 1 };
+        scene.ReserveInstances(levels, 1);
+
+        Model::glTF::Asset::InstanceDesc instance{ .LocalTransform = AffineTransformation::GetIdentity(),
+            .SceneID = Scene::DEFAULT_SCENE_ID,
+            .ID = 1,
+            .ParentID = Scene::SceneCore::ROOT_ID,
+            .MeshIdx = (int)meshIdx,
+            .MeshPrimIdx = 0,
+            .RtMeshMode = Model::RT_MESH_MODE::STATIC,
+            .RtInstanceMask = RT_AS_SUBGROUP::NON_EMISSIVE,
+            .IsOpaque = true };
+        scene.AddInstance(instance);
+
+        // From far enough, the triangle covers about 12k pixels, for which mip 1 (256x128) 
+        // is enough
+        scene.SetTextureStreamingView(float3(0.5f, 0.5f, 5.7f), 1.0f, 1000);
+
+        for (int i = 0; i < 1000 && streaming.GetStats().NumComplete == 0; i++)
+        {
+            UpdateScene();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        CHECK(streaming.ResidentMip(0) == 1);
+
+        // Finer mips are streamed in during scene updates once it's closer
+        scene.SetTextureStreamingView(float3(0.5f, 0.5f, 1.0f), 1.0f, 1000);
+
+        for (int i = 0; i < 1000 && streaming.ResidentMip(0) > 0; i++)
+        {
+            UpdateScene();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        CHECK(streaming.ResidentMip(0) == 0);
+        const auto stats = streaming.GetStats();
+        CHECK(stats.NumComplete == 1);
+        CHECK(stats.NumBytesLoaded == dataSize);
+        CHECK(stats.TimeToComplete >= 0.0);
+
+        // Not block compressed
+        header.ddspf = DDSPF_A8R8G8B8;
+        memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+        App::Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+        CHECK(!scene.AddStreamedTexture(path, 1235, desc, tail, firstTailMip));
+
+        App::Filesystem::RemoveFile(path);
+        App::Headless::Shutdown();
+    }
+
+    // Scaling of a scene update (instance transforms and bounds) and of scene loading
+    // (a BVH for each mesh) with the number of workers under each pinning policy. Both
+    // write their results to frame memory, so they run in separate frames to stay within
+    // the frame allocator's blocks.
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        constexpr int NUM_INSTANCES = 32 * 1024;
+        constexpr int NUM_MESHES = 32;
+        constexpr int NUM_TRIS = 4 * 1024;
+        constexpr int NUM_FRAMES = 10;
+
+        RNG rng(17);
+        SmallVector<float4x4a> locals;
+        SmallVector<AABB> localBounds;
+        locals.resize(NUM_INSTANCES);
+        localBounds.resize(NUM_INSTANCES);
+
+        for (int i = 0; i < NUM_INSTANCES; i++)
+        {
+            float3 scale(1.0f + rng.Uniform());
+            float4 rotation(0, 0, 0, 1);
+            float3 t(rng.Uniform() * 100.0f, rng.Uniform() * 100.0f, rng.Uniform() * 100.0f);
+            locals[i] = store(affineTransformation(scale, rotation, t));
+            localBounds[i] = AABB(float3(0.0f), float3(0.5f + rng.Uniform()));
+        }
+
+        SmallVector<BVHPrimSource> meshes;
+        meshes.resize(NUM_MESHES * NUM_TRIS);
+
+        for (auto& m : meshes)
+        {
+            m.Center = float3(rng.Uniform() * 50.0f, rng.Uniform() * 50.0f, rng.Uniform() * 50.0f);
+            m.Extent = 0.1f + rng.Uniform();
+        }
+
+        const THREAD_PINNING policies[] = { THREAD_PINNING::NONE, THREAD_PINNING::COMPACT, THREAD_PINNING::SPREAD };
+        const char* policyNames[] = { "none", "compact", "spread" };
+        const int maxNumWorkers = Min(App::GetProcessorInfo().NumLogicalCores, Min(ZETA_MAX_NUM_THREADS - 2,
+            TaskSet::MAX_NUM_TASKS));
+
+        // Powers of two, plus the maximum
+        int workerCounts[8];
+        int numWorkerCounts = 0;
+
+        for (int n = 1; n < maxNumWorkers; n *= 2)
+            workerCounts[numWorkerCounts++] = n;
+
+        workerCounts[numWorkerCounts++] = maxNumWorkers;
+
+        cpu_set_t prevSet;
+        REQUIRE(sched_getaffinity(0, sizeof(prevSet), &prevSet) == 0);
+
+        for (int p = 0; p < (int)ZetaArrayLen(policies); p++)
+        {
+            for (int w = 0; w < numWorkerCounts; w++)
+            {
+                const int numWorkers = workerCounts[w];
+                App::Headless::Init({ .NumWorkerThreads = numWorkers, .NumBackgroundThreads = 2,
+                    .Pinning = policies[p] });
+
+                double updateMs = 0.0;
+                double loadMs = 0.0;
+
+                // First frame is a warm up
+                for (int frame = 0; frame <= NUM_FRAMES; frame++)
+                {
+                    App::Headless::BeginFrame();
+
+                    TaskSet update;
+                    const int instancesPerTask = NUM_INSTANCES / numWorkers;
+
+                    for (int t = 0; t < numWorkers; t++)
+                    {
+                        const int begin = t * instancesPerTask;
+                        const int end = t == numWorkers - 1 ? NUM_INSTANCES : begin + instancesPerTask;
+
+                        update.EmplaceTask("Update", [&locals, &localBounds, begin, end]()
+                            {
+                                const v_float4x4 vParent = load4x4(store(identity()));
+                                constexpr int BATCH_SIZE = 4096;
+
+                                for (int b = begin; b < end; b += BATCH_SIZE)
+                                {
+                                    const int n = Min(BATCH_SIZE, end - b);
+                                    auto* toWorlds = reinterpret_cast<float4x4a*>(App::AllocateFrameAllocator(
+                                        sizeof(float4x4a) * n, alignof(float4x4a)));
+                                    auto* bounds = reinterpret_cast<AABB*>(App::AllocateFrameAllocator(
+                                        sizeof(AABB) * n, alignof(AABB)));
+
+                                    for (int i = 0; i < n; i++)
+                                    {
+                                        const v_float4x4 vW = mul(vParent, load4x4(locals[b + i]));
+                                        toWorlds[i] = store(vW);
+                                        bounds[i] = store(transform(vW, v_AABB(localBounds[b + i])));
+                                    }
+                                }
+                            });
+                    }
+
+                    update.Sort();
+                    update.Finalize();
+
+                    auto start = std::chrono::high_resolution_clock::now();
+                    App::Submit(ZetaMove(update));
+                    App::FlushWorkerThreadPool();
+                    auto end = std::chrono::high_resolution_clock::now();
+
+                    if (frame > 0)
+                        updateMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+                    App::Headless::BeginFrame();
+
+                    TaskSet load;
+                    const int meshesPerTask = (NUM_MESHES + numWorkers - 1) / numWorkers;
+
+                    for (int t = 0; t < numWorkers; t++)
+                    {
+                        const int begin = Min(t * meshesPerTask, NUM_MESHES);
+                        const int end = Min(begin + meshesPerTask, NUM_MESHES);
+
+                        load.EmplaceTask("Load", [&meshes, begin, end]()
+                            {
+                                SmallVector<BVHNode> nodes;
+
+                                for (int m = begin; m < end; m++)
+                                {
+                                    auto* prims = reinterpret_cast<BVHPrim*>(App::AllocateFrameAllocator(
+                                        sizeof(BVHPrim) * NUM_TRIS, alignof(BVHPrim)));
+
+                                    for (int i = 0; i < NUM_TRIS; i++)
+                                    {
+                                        const BVHPrimSource& src = meshes[m * NUM_TRIS + i];
+                                        prims[i].BoxMin = src.Center - src.Extent;
+                                        prims[i].BoxMax = src.Center + src.Extent;
+                                        prims[i].Centroid = src.Center;
+                                        prims[i].Index = i;
+                                    }
+
+                                    nodes.clear();
+                                    BuildBVH(MutableSpan(prims, NUM_TRIS), nodes, 4);
+                                }
+                            });
+                    }
+
+                    load.Sort();
+                    load.Finalize();
+
+                    start = std::chrono::high_resolution_clock::now();
+                    App::Submit(ZetaMove(load));
+                    App::FlushWorkerThreadPool();
+                    end = std::chrono::high_resolution_clock::now();
+
+                    if (frame > 0)
+                        loadMs += std::chrono::duration<double, std::milli>(end - start).count();
+                }
+
+                const CpuTopology& topology = App::GetCpuTopology();
+                MESSAGE(policyNames[p], ", ", numWorkers, " workers (", topology.NumPhysicalCores(), " cores, ",
+                    topology.NumNodes(), " nodes): update ", updateMs / NUM_FRAMES, " ms, load ",
+                    loadMs / NUM_FRAMES, " ms");
+
+                App::Headless::Shutdown();
+                sched_setaffinity(0, sizeof(prevSet), &prevSet);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include <RayTracing/LightBVH.h>
+#include <Math/Sampling.h>
+#include <Math/Color.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+#include <chrono>
+#include <thread>
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    float3 RandomDir(RNG& rng)
+    {
+        const float z = 1.0f - 2.0f * rng.Uniform();
+        const float r = sqrtf(Max(1.0f - z * z, 0.0f));
+        const float phi = TWO_PI * rng.Uniform();
+
+        return float3(r * cosf(phi), r * sinf(phi), z);
+    }
+
+    // Small triangles scattered in a [0, 100]^3 box
+    void RandomTriangles(RNG& rng, uint32_t n, SmallVector<EmissiveTriangle>& tris, SmallVector<float>& power)
+    {
+        tris.resize(n);
+        power.resize(n);
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const float3 v0(rng.Uniform() * 100.0f, rng.Uniform() * 100.0f, rng.Uniform() * 100.0f);
+            const float3 v1 = v0 + RandomDir(rng) * (0.05f + rng.Uniform());
+            const float3 v2 = v0 + RandomDir(rng) * (0.05f + rng.Uniform());
+
+            tris[i] = EmissiveTriangle(v0, v1, v2, float2(0.0f), float2(0.0f), float2(0.0f),
+                Float3ToRGB8(float3(1.0f)), 0, half(1.0f), i, rng.UniformUintBounded(4) == 0);
+            power[i] = rng.UniformUintBounded(10) == 0 ? 0.0f : 0.1f + rng.Uniform() * 10.0f;
+        }
+    }
+
+    void BuildMultithreaded(LightBVH& bvh, SmallVector<EmissiveTriangle>& tris, SmallVector<float>& power,
+        int numThreads)
+    {
+        const int numSubtrees = bvh.BeginBuild(tris, power, numThreads);
+
+        std::thread threads[LightBVH::MAX_NUM_SUBTREES];
+        for (int i = 0; i < numSubtrees; i++)
+            threads[i] = std::thread([&bvh, i]() { bvh.BuildSubtree(i); });
+
+        for (int i = 0; i < numSubtrees; i++)
+            threads[i].join();
+
+        bvh.EndBuild();
+    }
+
+    bool Contains(const LightBounds& outer, const float3& p)
+    {
+        constexpr float EPS = 1e-4f;
+
+        return p.x >= outer.BoxMin.x - EPS && p.y >= outer.BoxMin.y - EPS && p.z >= outer.BoxMin.z - EPS &&
+            p.x <= outer.BoxMax.x + EPS && p.y <= outer.BoxMax.y + EPS && p.z <= outer.BoxMax.z + EPS;
+    }
+
+    bool Contains(const LightBounds& outer, const LightBounds& inner)
+    {
+        return inner.Empty() || (Contains(outer, inner.BoxMin) && Contains(outer, inner.BoxMax));
+    }
+
+    // Every node bounds its children and every leaf bounds its triangles
+    bool ValidBounds(const LightBVH& bvh, SmallVector<EmissiveTriangle>& tris)
+    {
+        auto nodes = bvh.PackedNodes();
+        auto primTris = bvh.PrimTriIndices();
+        bool valid = true;
+
+        for (uint32_t i = 0; i < bvh.NumNodes(); i++)
+        {
+            if (nodes[i].Count == 0)
+            {
+                valid = valid && Contains(bvh.Bounds(i), bvh.Bounds(i + 1)) &&
+                    Contains(bvh.Bounds(i), bvh.Bounds(nodes[i].Offset));
+
+                continue;
+            }
+
+            for (uint32_t p = nodes[i].Offset; p < nodes[i].Offset + nodes[i].Count; p++)
+            {
+                __m128 v0;
+                __m128 v1;
+                __m128 v2;
+                tris[primTris[p]].LoadVertices(v0, v1, v2);
+
+                valid = valid && Contains(bvh.Bounds(i), storeFloat3(v0)) &&
+                    Contains(bvh.Bounds(i), storeFloat3(v1)) && Contains(bvh.Bounds(i), storeFloat3(v2));
+            }
+        }
+
+        return valid;
+    }
+
+    bool SamplesMatchPdf(const LightBVH& bvh, RNG& rng, int numPoints)
+    {
+        bool match = true;
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            const float3 p(rng.Uniform() * 120.0f - 10.0f, rng.Uniform() * 120.0f - 10.0f,
+                rng.Uniform() * 120.0f - 10.0f);
+            const float3 n = (i & 1) ? RandomDir(rng) : float3(0.0f);
+
+            for (int s = 0; s < 32; s++)
+            {
+                float pdf;
+                const uint32_t tri = bvh.Sample(p, n, rng.Uniform(), pdf);
+
+                if (tri == LightBVH::INVALID_TRI)
+                    continue;
+
+                const float expected = bvh.Pdf(p, n, tri);
+                match = match && pdf > 0.0f && fabsf(pdf - expected) <= 1e-4f * expected;
+            }
+        }
+
+        return match;
+    }
+
+    // Irradiance at p from a point light at the triangle's centroid
+    float Contribution(EmissiveTriangle& tri, float power, const float3& p, const float3& n)
+    {
+        __m128 vV0;
+        __m128 vV1;
+        __m128 vV2;
+        tri.LoadVertices(vV0, vV1, vV2);
+
+        const float3 v0 = storeFloat3(vV0);
+        const float3 v1 = storeFloat3(vV1);
+        const float3 v2 = storeFloat3(vV2);
+        const float3 c = (v0 + v1 + v2) / 3.0f;
+        float3 normal = (v1 - v0).cross(v2 - v0);
+        normal.normalize();
+
+        float3 wi = p - c;
+        const float dist2 = wi.dot(wi);
+        wi.normalize();
+
+        float cosLight = normal.dot(wi);
+        cosLight = tri.IsDoubleSided() ? fabsf(cosLight) : Max(cosLight, 0.0f);
+        const float cosSurface = Max(-wi.dot(n), 0.0f);
+
+        return power * cosLight * cosSurface / dist2;
+    }
+}
+
+TEST_SUITE("LightBVH")
+{
+    TEST_CASE("SampleMatchesPdf")
+    {
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        SmallVector<EmissiveTriangle> tris;
+        SmallVector<float> power;
+        RandomTriangles(rng, 1 + rng.UniformUintBounded(5000), tris, power);
+
+        LightBVH bvh;
+        bvh.Build(tris, power);
+
+        CHECK(ValidBounds(bvh, tris));
+        CHECK(SamplesMatchPdf(bvh, rng, 50));
+
+        // Pdfs can't sum to more than one. Sum can be less than one as sampling fails when 
+        // (conservative) bounds of a subtree contribute, but none of its triangles do.
+        bool sumsToOne = true;
+
+        for (int i = 0; i < 10; i++)
+        {
+            const float3 p(rng.Uniform() * 100.0f, rng.Uniform() * 100.0f, rng.Uniform() * 100.0f);
+            const float3 n = RandomDir(rng);
+            double sum = 0.0;
+
+            for (uint32_t t = 0; t < tris.size(); t++)
+                sum += bvh.Pdf(p, n, t);
+
+            sumsToOne = sumsToOne && sum <= 1.0 + 1e-3;
+        }
+
+        CHECK(sumsToOne);
+    }
+
+    TEST_CASE("ParallelMatchesSerial")
+    {
+        RNG rng(3);
+        SmallVector<EmissiveTriangle> tris;
+        SmallVector<float> power;
+        RandomTriangles(rng, 20000, tris, power);
+
+        LightBVH serial;
+        serial.Build(tris, power);
+
+        LightBVH parallel;
+        BuildMultithreaded(parallel, tris, power, LightBVH::MAX_NUM_SUBTREES);
+
+        // Top-level splits are the same as the ones a serial build would make
+        REQUIRE(serial.NumNodes() == parallel.NumNodes());
+        CHECK(memcmp(serial.PackedNodes().data(), parallel.PackedNodes().data(),
+            serial.NumNodes() * sizeof(LightBVHNode)) == 0);
+        CHECK(memcmp(serial.PrimTriIndices().data(), parallel.PrimTriIndices().data(),
+            tris.size() * sizeof(uint32_t)) == 0);
+    }
+
+    TEST_CASE("Refit")
+    {
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        SmallVector<EmissiveTriangle> tris;
+        SmallVector<float> power;
+        RandomTriangles(rng, 3000, tris, power);
+
+        LightBVH bvh;
+        BuildMultithreaded(bvh, tris, power, 4);
+
+        struct Range
+        {
+            uint32_t Base;
+            uint32_t Count;
+        };
+
+        // Move a few "instances" and change power of some triangles
+        Range ranges[3] = { { 10, 50 }, { 1000, 200 }, { 2990, 10 } };
+        for (auto& r : ranges)
+        {
+            const float3 offset = RandomDir(rng) * 30.0f;
+
+            for (uint32_t t = r.Base; t < r.Base + r.Count; t++)
+            {
+                __m128 v0;
+                __m128 v1;
+                __m128 v2;
+                tris[t].LoadVertices(v0, v1, v2);
+
+                const __m128 vOffset = loadFloat3(const_cast<float3&>(offset));
+                tris[t].StoreVertices(_mm_add_ps(v0, vOffset), _mm_add_ps(v1, vOffset), _mm_add_ps(v2, vOffset));
+                power[t] = rng.Uniform() * 20.0f;
+            }
+        }
+
+        bvh.Refit(tris, power, Span(ranges, 3));
+
+        CHECK(ValidBounds(bvh, tris));
+        CHECK(SamplesMatchPdf(bvh, rng, 50));
+
+        double totalPower = 0.0;
+        for (auto p : power)
+            totalPower += p;
+
+        CHECK(fabs(bvh.Bounds(0).Power - totalPower) <= 1e-4 * totalPower);
+    }
+
+    TEST_CASE("LowerVarianceThanPowerSampling")
+    {
+        RNG rng(11);
+        SmallVector<EmissiveTriangle> tris;
+        SmallVector<float> power;
+        RandomTriangles(rng, 10000, tris, power);
+
+        LightBVH bvh;
+        bvh.Build(tris, power);
+
+        DynamicDistribution powerDist;
+        powerDist.Init(power);
+
+        constexpr int NUM_SAMPLES = 4096;
+        double varianceRatio = 0.0;
+        int numPoints = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            const float3 p(rng.Uniform() * 100.0f, rng.Uniform() * 100.0f, rng.Uniform() * 100.0f);
+            const float3 n = RandomDir(rng);
+
+            double sumBvh = 0.0;
+            double sumBvh2 = 0.0;
+            double sumPower = 0.0;
+            double sumPower2 = 0.0;
+
+            for (int s = 0; s < NUM_SAMPLES; s++)
+            {
+                float pdf;
+                uint32_t t = bvh.Sample(p, n, rng.Uniform(), pdf);
+                const double fBvh = t == LightBVH::INVALID_TRI ? 0.0 : Contribution(tris[t], power[t], p, n) / pdf;
+
+                t = powerDist.Sample(rng.Uniform(), pdf);
+                const double fPower = Contribution(tris[t], power[t], p, n) / pdf;
+
+                sumBvh += fBvh;
+                sumBvh2 += fBvh * fBvh;
+                sumPower += fPower;
+                sumPower2 += fPower * fPower;
+            }
+
+            const double varBvh = sumBvh2 / NUM_SAMPLES - (sumBvh / NUM_SAMPLES) * (sumBvh / NUM_SAMPLES);
+            const double varPower = sumPower2 / NUM_SAMPLES - (sumPower / NUM_SAMPLES) * (sumPower / NUM_SAMPLES);
+
+            if (varPower > 0.0)
+            {
+                varianceRatio += varBvh / varPower;
+                numPoints++;
+            }
+        }
+
+        varianceRatio /= Max(numPoints, 1);
+        MESSAGE("Average variance of light BVH relative to power sampling: ", varianceRatio);
+        CHECK(varianceRatio < 1.0);
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        RNG rng(5);
+        SmallVector<EmissiveTriangle> tris;
+        SmallVector<float> power;
+        RandomTriangles(rng, 1'000'000, tris, power);
+
+        LightBVH bvh;
+        auto start = std::chrono::high_resolution_clock::now();
+        bvh.Build(tris, power);
+        auto end = std::chrono::high_resolution_clock::now();
+        const double serialMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        const int numThreads = (int)Min(std::thread::hardware_concurrency(), (unsigned int)LightBVH::MAX_NUM_SUBTREES);
+        start = std::chrono::high_resolution_clock::now();
+        BuildMultithreaded(bvh, tris, power, numThreads);
+        end = std::chrono::high_resolution_clock::now();
+        const double parallelMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        MESSAGE("1M triangles: serial build ", serialMs, " [ms], parallel (", numThreads, " threads) ",
+            parallelMs, " [ms], ", bvh.NumNodes(), " nodes");
+    }
+}
\ No newline at end of file
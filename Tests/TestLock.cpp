@@ -0,0 +1,259 @@
+#include <Support/Lock.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    void SleepMs(int ms)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+
+    const LockFrameStats* FindStats(const LockFrameStats* stats, int n, const char* name)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (strcmp(stats[i].Name, name) == 0)
+                return &stats[i];
+        }
+
+        return nullptr;
+    }
+
+    struct Pair
+    {
+        int64_t A;
+        int64_t B;
+    };
+}
+
+TEST_SUITE("Lock")
+{
+    TEST_CASE("Mutex")
+    {
+        auto lock = std::make_unique<Mutex>();
+        constexpr int NUM_THREADS = 8;
+        constexpr int NUM_ITERATIONS = 20000;
+        std::thread threads[NUM_THREADS];
+        int64_t counter = 0;
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads[t] = std::thread([&lock, &counter]()
+                {
+                    for (int i = 0; i < NUM_ITERATIONS; i++)
+                    {
+                        lock->Lock();
+                        counter++;
+                        lock->Unlock();
+                    }
+                });
+        }
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            threads[t].join();
+
+        CHECK(counter == NUM_THREADS * NUM_ITERATIONS);
+        CHECK(lock->Stats().NumAcquires.load() == NUM_THREADS * NUM_ITERATIONS);
+
+        CHECK(lock->TryLock());
+        CHECK(!lock->TryLock());
+        lock->Unlock();
+    }
+
+    TEST_CASE("RWLock")
+    {
+        auto lock = std::make_unique<RWLock>();
+        constexpr int NUM_READERS = 6;
+        constexpr int NUM_WRITERS = 2;
+        constexpr int NUM_ITERATIONS = 10000;
+        std::thread threads[NUM_READERS + NUM_WRITERS];
+        Pair data = { 0, 0 };
+        std::atomic_int32_t numTorn = 0;
+
+        for (int t = 0; t < NUM_WRITERS; t++)
+        {
+            threads[t] = std::thread([&lock, &data]()
+                {
+                    for (int i = 0; i < NUM_ITERATIONS; i++)
+                    {
+                        lock->LockExclusive();
+                        data.A++;
+                        data.B--;
+                        lock->UnlockExclusive();
+                    }
+                });
+        }
+
+        for (int t = 0; t < NUM_READERS; t++)
+        {
+            threads[NUM_WRITERS + t] = std::thread([&lock, &data, &numTorn]()
+                {
+                    for (int i = 0; i < NUM_ITERATIONS; i++)
+                    {
+                        lock->LockShared();
+                        if (data.A != -data.B)
+                            numTorn.fetch_add(1, std::memory_order_relaxed);
+                        lock->UnlockShared();
+                    }
+                });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(numTorn.load() == 0);
+        CHECK(data.A == NUM_WRITERS * NUM_ITERATIONS);
+    }
+
+    TEST_CASE("ConcurrentReaders")
+    {
+        auto lock = std::make_unique<RWLock>();
+        std::atomic_int32_t numInside = 0;
+        std::atomic_int32_t maxInside = 0;
+
+        std::thread threads[4];
+        for (auto& t : threads)
+        {
+            t = std::thread([&]()
+                {
+                    lock->LockShared();
+                    const int n = numInside.fetch_add(1) + 1;
+                    int m = maxInside.load();
+                    while (n > m && !maxInside.compare_exchange_weak(m, n));
+
+                    SleepMs(20);
+                    numInside.fetch_sub(1);
+                    lock->UnlockShared();
+                });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(maxInside.load() > 1);
+    }
+
+    TEST_CASE("Stats")
+    {
+        LockFrameStats stats[64];
+        // Drop the counters of locks from other tests
+        CollectLockStats(stats);
+
+        {
+            auto lock = std::make_unique<Mutex>("Test mutex");
+            auto rwLock = std::make_unique<RWLock>("Test RW lock");
+
+            // Unnamed locks aren't reported
+            Mutex unnamed;
+            unnamed.Lock();
+            unnamed.Unlock();
+
+            lock->Lock();
+            std::thread waiter([&lock]()
+                {
+                    // Parks after spinning
+                    lock->Lock();
+                    lock->Unlock();
+                });
+
+            SleepMs(20);
+            lock->Unlock();
+            waiter.join();
+
+            rwLock->LockShared();
+            rwLock->UnlockShared();
+
+            rwLock->LockShared();
+            std::thread writer([&rwLock]()
+                {
+                    rwLock->LockExclusive();
+                    rwLock->UnlockExclusive();
+                });
+
+            SleepMs(20);
+            rwLock->UnlockShared();
+            writer.join();
+
+            int n = CollectLockStats(stats);
+            const LockFrameStats* m = FindStats(stats, n, "Test mutex");
+            REQUIRE(m != nullptr);
+            CHECK(m->NumAcquires == 2);
+            CHECK(m->NumContended == 1);
+            CHECK(m->WaitMs >= 10.0f);
+
+            const LockFrameStats* rw = FindStats(stats, n, "Test RW lock");
+            REQUIRE(rw != nullptr);
+            CHECK(rw->NumAcquires == 3);
+            CHECK(rw->NumContended == 1);
+            CHECK(rw->WaitMs >= 10.0f);
+
+            // Counters are reset after collection, locks that weren't acquired are skipped
+            lock->Lock();
+            lock->Unlock();
+            n = CollectLockStats(stats);
+            REQUIRE(FindStats(stats, n, "Test mutex") != nullptr);
+            CHECK(FindStats(stats, n, "Test mutex")->NumAcquires == 1);
+            CHECK(FindStats(stats, n, "Test mutex")->NumContended == 0);
+            CHECK(FindStats(stats, n, "Test RW lock") == nullptr);
+
+            lock->Lock();
+            lock->Unlock();
+        }
+
+        // Destroyed locks are unregistered
+        const int n = CollectLockStats(stats);
+        CHECK(FindStats(stats, n, "Test mutex") == nullptr);
+    }
+
+    TEST_CASE("SeqLock")
+    {
+        auto lock = std::make_unique<SeqLock<Pair>>();
+        constexpr int NUM_READERS = 4;
+        constexpr int NUM_ITERATIONS = 50000;
+        std::thread threads[NUM_READERS];
+        std::atomic_bool done = false;
+        std::atomic_int32_t numTorn = 0;
+
+        for (auto& t : threads)
+        {
+            t = std::thread([&]()
+                {
+                    while (!done.load(std::memory_order_relaxed))
+                    {
+                        const Pair p = lock->Load();
+                        if (p.A != -p.B)
+                            numTorn.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+        }
+
+        for (int i = 1; i <= NUM_ITERATIONS; i++)
+            lock->Store(Pair{ .A = i, .B = -i });
+
+        done.store(true);
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(numTorn.load() == 0);
+        CHECK(lock->Load().A == NUM_ITERATIONS);
+
+        const int64_t prev = lock->Update([](Pair& p)
+            {
+                const int64_t a = p.A;
+                p.A = 0;
+                p.B = 0;
+
+                return a;
+            });
+
+        CHECK(prev == NUM_ITERATIONS);
+        CHECK(lock->Load().A == 0);
+    }
+}
\ No newline at end of file
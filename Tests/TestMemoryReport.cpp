@@ -0,0 +1,192 @@
+#include <Support/MemoryReport.h>
+#include <Scene/Animation.h>
+#include <RayTracing/LightBVH.h>
+#include <Math/Sampling.h>
+#include <Math/Color.h>
+#include <App/Filesystem.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <string.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Scene::Internal;
+
+namespace
+{
+    bool Contains(const SmallVector<char>& text, const char* str)
+    {
+        const size_t n = strlen(str);
+
+        for (size_t i = 0; i + n <= text.size(); i++)
+        {
+            if (memcmp(text.data() + i, str, n) == 0)
+                return true;
+        }
+
+        return false;
+    }
+}
+
+TEST_SUITE("MemoryReport")
+{
+    TEST_CASE("Containers")
+    {
+        auto report = std::make_unique<MemoryReport>();
+
+        SmallVector<uint64_t, SystemAllocator, 0> ids;
+        ids.reserve(100);
+        ids.resize(60);
+        report->Add("Scene", "IDs", ids);
+
+        CHECK(report->Containers().size() == 1);
+        const MemoryReport::Container* c = report->Find("Scene", "IDs");
+        REQUIRE(c);
+        CHECK(c->NumElements == 60);
+        CHECK(c->Capacity == ids.capacity());
+        CHECK(c->UsedBytes() == 60 * sizeof(uint64_t));
+        CHECK(c->ReservedBytes() == ids.capacity() * sizeof(uint64_t));
+
+        // Same owner and name are merged
+        SmallVector<uint64_t, SystemAllocator, 0> moreIDs;
+        moreIDs.resize(10);
+        report->Add("Scene", "IDs", moreIDs);
+        CHECK(report->Containers().size() == 1);
+        CHECK(report->Find("Scene", "IDs")->NumElements == 70);
+
+        // Every bucket of a hash table is reserved
+        HashTable<uint32_t> table;
+        for (uint64_t i = 0; i < 20; i++)
+            table.insert_or_assign(i, (uint32_t)i);
+
+        report->Add("Scene", "Table", table);
+        c = report->Find("Scene", "Table");
+        REQUIRE(c);
+        CHECK(c->NumElements == 20);
+        CHECK(c->Capacity == table.bucket_count());
+        CHECK(c->ElementSize == sizeof(HashTable<uint32_t>::Entry));
+
+        report->Add("Meshes", "Vertices", 5, 8, 32);
+        CHECK(report->Find("Meshes", "IDs") == nullptr);
+        CHECK(!report->IsFirstOfOwner(1));
+        CHECK(report->IsFirstOfOwner(2));
+
+        const MemoryReport::OwnerTotals meshes = report->Totals("Meshes");
+        CHECK(meshes.UsedBytes == 5 * 32);
+        CHECK(meshes.ReservedBytes == 8 * 32);
+        CHECK(meshes.NumContainers == 1);
+
+        const MemoryReport::OwnerTotals scene = report->Totals("Scene");
+        const MemoryReport::OwnerTotals total = report->Totals();
+        CHECK(total.UsedBytes == scene.UsedBytes + meshes.UsedBytes);
+        CHECK(total.ReservedBytes == scene.ReservedBytes + meshes.ReservedBytes);
+        CHECK(total.NumContainers == 3);
+
+        report->Clear();
+        CHECK(report->Containers().size() == 0);
+        CHECK(report->Totals().UsedBytes == 0);
+    }
+
+    TEST_CASE("Output")
+    {
+        auto report = std::make_unique<MemoryReport>();
+        report->Add("Scene", "m_IDs", 3, 4, 8);
+        report->Add("Scene", "m_\"quoted\"", 0, 2, 16);
+        report->Add("Meshes", "m_vertices", 1024, 2048, 32);
+
+        SmallVector<char> text;
+        report->Print(text);
+        CHECK(Contains(text, "m_vertices"));
+        // 1024 * 32 bytes used, 2048 * 32 reserved
+        CHECK(Contains(text, "32.0"));
+        CHECK(Contains(text, "64.0"));
+        CHECK(Contains(text, "Total"));
+
+        SmallVector<char> json;
+        report->ToJSON(json);
+        json.push_back('\0');
+
+        const char* expected = "{\"usedBytes\": 32792, \"reservedBytes\": 65600, \"owners\": ["
+            "{\"owner\": \"Scene\", \"usedBytes\": 24, \"reservedBytes\": 64}, "
+            "{\"owner\": \"Meshes\", \"usedBytes\": 32768, \"reservedBytes\": 65536}], \"containers\": ["
+            "{\"owner\": \"Scene\", \"name\": \"m_IDs\", \"numElements\": 3, \"capacity\": 4, "
+            "\"elementSize\": 8, \"usedBytes\": 24, \"reservedBytes\": 32}, "
+            "{\"owner\": \"Scene\", \"name\": \"m_\\\"quoted\\\"\", \"numElements\": 0, \"capacity\": 2, "
+            "\"elementSize\": 16, \"usedBytes\": 0, \"reservedBytes\": 32}, "
+            "{\"owner\": \"Meshes\", \"name\": \"m_vertices\", \"numElements\": 1024, \"capacity\": 2048, "
+            "\"elementSize\": 32, \"usedBytes\": 32768, \"reservedBytes\": 65536}]}";
+        CHECK(strcmp(json.data(), expected) == 0);
+
+        const char* path = "TestMemoryReport.json";
+        report->WriteJSON(path);
+        SmallVector<uint8_t> loaded;
+        App::Filesystem::LoadFromFile(path, loaded);
+        App::Filesystem::RemoveFile(path);
+        REQUIRE(loaded.size() == strlen(expected));
+        CHECK(memcmp(loaded.data(), expected, loaded.size()) == 0);
+    }
+
+    TEST_CASE("AnimationSet")
+    {
+        Keyframe keyframes[5];
+        for (int i = 0; i < 5; i++)
+        {
+            keyframes[i] = Keyframe::Identity();
+            keyframes[i].Time = (float)i;
+        }
+
+        AnimationSet animations;
+        animations.Add(1, Span(keyframes, 5), 0.0f, true);
+        animations.Add(2, Span(keyframes, 3), 0.0f, false);
+
+        MemoryReport report;
+        animations.ReportMemory(report);
+
+        const MemoryReport::Container* times = report.Find("AnimationSet", "m_times");
+        REQUIRE(times);
+        CHECK(times->NumElements == animations.NumKeyframes());
+        CHECK(times->ElementSize == sizeof(float));
+        CHECK(report.Find("AnimationSet", "m_rotations")->NumElements == 8);
+        CHECK(report.Totals("AnimationSet").UsedBytes > 0);
+        CHECK(report.Totals("AnimationSet").ReservedBytes >= report.Totals("AnimationSet").UsedBytes);
+    }
+
+    TEST_CASE("Emissives")
+    {
+        constexpr uint32_t N = 64;
+        SmallVector<EmissiveTriangle> tris;
+        SmallVector<float> power;
+        tris.resize(N);
+        power.resize(N);
+
+        for (uint32_t i = 0; i < N; i++)
+        {
+            const float3 v0((float)i, 0.0f, 0.0f);
+            tris[i] = EmissiveTriangle(v0, v0 + float3(0.5f, 0.0f, 0.0f), v0 + float3(0.0f, 0.5f, 0.0f),
+                float2(0.0f), float2(0.0f), float2(0.0f), Float3ToRGB8(float3(1.0f)), 0, half(1.0f), i, false);
+            power[i] = 1.0f + (float)i;
+        }
+
+        DynamicDistribution dist;
+        dist.Init(power);
+        LightBVH bvh;
+        bvh.Build(tris, power);
+
+        MemoryReport report;
+        dist.ReportMemory(report);
+        bvh.ReportMemory(report);
+
+        CHECK(report.Find("DynamicDistribution", "m_weights")->NumElements == N);
+        CHECK(report.Find("DynamicDistribution", "m_tree")->ElementSize == sizeof(double));
+
+        const MemoryReport::Container* nodes = report.Find("LightBVH", "m_nodes");
+        REQUIRE(nodes);
+        CHECK(nodes->NumElements == bvh.NumNodes());
+        CHECK(report.Find("LightBVH", "m_primTris")->NumElements == N);
+        CHECK(report.Totals("LightBVH").UsedBytes > 0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include <MipGenerator.h>
+#include <Math/Common.h>
+#include <Utility/RNG.h>
+#include <Utility/SmallVector.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::MipGen;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    void RandomImage(RNG& rng, uint32_t width, uint32_t height, SmallVector<uint8_t>& rgba)
+    {
+        rgba.resize(size_t(width) * height * 4);
+        for (auto& c : rgba)
+            c = (uint8_t)rng.UniformUintBounded(256);
+    }
+
+    // Non-streaming area-weighted resampling of a whole image
+    void ResampleReference(const float* src, int srcW, int srcH, float* dst, int dstW, int dstH)
+    {
+        const float sx = (float)srcW / dstW;
+        const float sy = (float)srcH / dstH;
+
+        for (int y = 0; y < dstH; y++)
+        {
+            for (int x = 0; x < dstW; x++)
+            {
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                float sumW = 0.0f;
+
+                for (int j = (int)(y * sy); j < Min((int)ceilf((y + 1) * sy), srcH); j++)
+                {
+                    const float wy = Min(j + 1.0f, (y + 1) * sy) - Max((float)j, y * sy);
+
+                    for (int i = (int)(x * sx); i < Min((int)ceilf((x + 1) * sx), srcW); i++)
+                    {
+                        const float w = wy * (Min(i + 1.0f, (x + 1) * sx) - Max((float)i, x * sx));
+                        for (int ch = 0; ch < 4; ch++)
+                            sum[ch] += w * src[(size_t(j) * srcW + i) * 4 + ch];
+
+                        sumW += w;
+                    }
+                }
+
+                for (int ch = 0; ch < 4; ch++)
+                    dst[(size_t(y) * dstW + x) * 4 + ch] = sum[ch] / sumW;
+            }
+        }
+    }
+}
+
+TEST_SUITE("MipGenerator")
+{
+    TEST_CASE("BoxMatchesReference")
+    {
+        RNG rng(17);
+        constexpr uint32_t SRC_W = 151;
+        constexpr uint32_t SRC_H = 97;
+        constexpr uint32_t W = 100;
+        constexpr uint32_t H = 68;
+
+        SmallVector<uint8_t> src;
+        RandomImage(rng, SRC_W, SRC_H, src);
+
+        Desc desc{ .Pixels = src.data(),
+            .SrcWidth = SRC_W,
+            .SrcHeight = SRC_H,
+            .Width = W,
+            .Height = H,
+            .Type = TEXTURE_TYPE::COLOR_LINEAR,
+            .Filter = FILTER::BOX };
+
+        SmallVector<uint8_t> mips;
+        mips.resize(MipChainSize(W, H));
+        Generate(desc, mips);
+
+        SmallVector<float> prev;
+        prev.resize(src.size());
+        for (size_t i = 0; i < src.size(); i++)
+            prev[i] = src[i] / 255.0f;
+
+        uint32_t prevW = SRC_W;
+        uint32_t prevH = SRC_H;
+        const uint8_t* curr = mips.data();
+        int maxDiff = 0;
+
+        for (uint32_t m = 0; m < NumMips(W, H); m++)
+        {
+            const uint32_t w = Max(W >> m, 1u);
+            const uint32_t h = Max(H >> m, 1u);
+
+            SmallVector<float> level;
+            level.resize(size_t(w) * h * 4);
+            ResampleReference(prev.data(), prevW, prevH, level.data(), w, h);
+
+            for (size_t i = 0; i < level.size(); i++)
+            {
+                const int expected = (int)(level[i] * 255.0f + 0.5f);
+                maxDiff = Max(maxDiff, abs(expected - (int)curr[i]));
+            }
+
+            curr += level.size();
+            prev.swap(level);
+            prevW = w;
+            prevH = h;
+        }
+
+        CHECK(maxDiff <= 1);
+    }
+
+    TEST_CASE("SRGB")
+    {
+        // Two black and two white texels, alpha is linear
+        const uint8_t src[] = {
+            0, 0, 0, 0,         255, 255, 255, 255,
+            255, 255, 255, 255, 0, 0, 0, 0 };
+
+        Desc desc{ .Pixels = src,
+            .SrcWidth = 2,
+            .SrcHeight = 2,
+            .Width = 2,
+            .Height = 2,
+            .Type = TEXTURE_TYPE::COLOR_SRGB,
+            .Filter = FILTER::BOX };
+
+        uint8_t mips[5 * 4];
+        Generate(desc, mips);
+
+        CHECK(memcmp(mips, src, sizeof(src)) == 0);
+        // sRGB encoding of 0.5
+        CHECK(mips[16] == 188);
+        CHECK(mips[17] == 188);
+        CHECK(mips[18] == 188);
+        CHECK(mips[19] == 128);
+    }
+
+    TEST_CASE("NormalMapsStayNormalized")
+    {
+        RNG rng(19);
+        constexpr uint32_t DIM = 64;
+        SmallVector<uint8_t> src;
+        src.resize(DIM * DIM * 4);
+
+        for (uint32_t i = 0; i < DIM * DIM; i++)
+        {
+            // Random directions in the upper hemisphere
+            float x = rng.Uniform() * 2.0f - 1.0f;
+            float y = rng.Uniform() * 2.0f - 1.0f;
+            float z = rng.Uniform() + 0.1f;
+            const float len = sqrtf(x * x + y * y + z * z);
+
+            src[i * 4 + 0] = (uint8_t)((x / len * 0.5f + 0.5f) * 255.0f + 0.5f);
+            src[i * 4 + 1] = (uint8_t)((y / len * 0.5f + 0.5f) * 255.0f + 0.5f);
+            src[i * 4 + 2] = (uint8_t)((z / len * 0.5f + 0.5f) * 255.0f + 0.5f);
+            src[i * 4 + 3] = 255;
+        }
+
+        for (auto filter : { FILTER::BOX, FILTER::KAISER })
+        {
+            Desc desc{ .Pixels = src.data(),
+                .SrcWidth = DIM,
+                .SrcHeight = DIM,
+                .Width = DIM,
+                .Height = DIM,
+                .Type = TEXTURE_TYPE::NORMAL_MAP,
+                .Filter = filter };
+
+            SmallVector<uint8_t> mips;
+            mips.resize(MipChainSize(DIM, DIM));
+            Generate(desc, mips);
+
+            float maxErr = 0.0f;
+            for (size_t i = 0; i < mips.size(); i += 4)
+            {
+                const float x = mips[i] / 127.5f - 1.0f;
+                const float y = mips[i + 1] / 127.5f - 1.0f;
+                const float z = mips[i + 2] / 127.5f - 1.0f;
+                maxErr = Max(maxErr, fabsf(sqrtf(x * x + y * y + z * z) - 1.0f));
+            }
+
+            CHECK(maxErr < 0.02f);
+        }
+    }
+
+    TEST_CASE("KaiserPreservesConstant")
+    {
+        constexpr uint32_t SRC_W = 90;
+        constexpr uint32_t SRC_H = 45;
+        SmallVector<uint8_t> src;
+        src.resize(SRC_W * SRC_H * 4);
+
+        for (size_t i = 0; i < src.size(); i += 4)
+        {
+            src[i] = 30;
+            src[i + 1] = 100;
+            src[i + 2] = 200;
+            src[i + 3] = 255;
+        }
+
+        Desc desc{ .Pixels = src.data(),
+            .SrcWidth = SRC_W,
+            .SrcHeight = SRC_H,
+            .Width = 64,
+            .Height = 32,
+            .Type = TEXTURE_TYPE::COLOR_SRGB,
+            .Filter = FILTER::KAISER };
+
+        SmallVector<uint8_t> mips;
+        mips.resize(MipChainSize(64, 32));
+        Generate(desc, mips);
+
+        for (size_t i = 0; i < mips.size(); i += 4)
+        {
+            REQUIRE(mips[i] == 30);
+            REQUIRE(mips[i + 1] == 100);
+            REQUIRE(mips[i + 2] == 200);
+            REQUIRE(mips[i + 3] == 255);
+        }
+    }
+
+    TEST_CASE("EncodeMatchesGenerate")
+    {
+        RNG rng(23);
+        constexpr uint32_t W = 300;
+        constexpr uint32_t H = 200;
+        SmallVector<uint8_t> src;
+        RandomImage(rng, 480, 333, src);
+
+        for (auto f : { BCn::FORMAT::BC5, BCn::FORMAT::BC7 })
+        {
+            Desc desc{ .Pixels = src.data(),
+                .SrcWidth = 480,
+                .SrcHeight = 333,
+                .Width = W,
+                .Height = H,
+                .Type = f == BCn::FORMAT::BC7 ? TEXTURE_TYPE::COLOR_SRGB : TEXTURE_TYPE::NORMAL_MAP,
+                .Filter = FILTER::KAISER };
+
+            SmallVector<uint8_t> streamed;
+            streamed.resize(CompressedMipChainSize(f, W, H));
+            EncodeStats stats;
+            GenerateAndEncode(desc, f, BCn::QUALITY::FAST, 4, streamed, &stats);
+
+            // Generate the whole chain first, then compress every level
+            SmallVector<uint8_t> mips;
+            mips.resize(MipChainSize(W, H));
+            Generate(desc, mips);
+
+            SmallVector<uint8_t> expected;
+            expected.resize(streamed.size());
+            const uint8_t* level = mips.data();
+            uint8_t* out = expected.data();
+
+            for (uint32_t m = 0; m < NumMips(W, H); m++)
+            {
+                const uint32_t w = Max(W >> m, 1u);
+                const uint32_t h = Max(H >> m, 1u);
+                const size_t size = BCn::CompressedSize(f, w, h);
+                BCn::EncodeImage(f, BCn::QUALITY::FAST, level, w, h, MutableSpan(out, size), 1);
+
+                if (m == 0)
+                {
+                    SmallVector<uint8_t> decoded;
+                    decoded.resize(size_t(w) * h * 4);
+                    BCn::DecodeImage(f, Span<uint8_t>(out, size), w, h, decoded);
+                    CHECK(stats.Mip0SquaredError == BCn::SquaredError(level, decoded.data(), w, h,
+                        f == BCn::FORMAT::BC5 ? 0x3 : 0xf));
+                }
+
+                level += size_t(w) * h * 4;
+                out += size;
+            }
+
+            CHECK(memcmp(streamed.data(), expected.data(), expected.size()) == 0);
+        }
+    }
+}
\ No newline at end of file
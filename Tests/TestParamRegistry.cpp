@@ -0,0 +1,286 @@
+#include <Support/ParamRegistry.h>
+#include <App/Filesystem.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    struct Listener
+    {
+        void OnChanged(const ParamVariant& p)
+        {
+            NumCalls++;
+            Last = p.ID();
+        }
+
+        int NumCalls = 0;
+        uint64_t Last = 0;
+    };
+
+    ParamVariant MakeFloat(Listener& l, const char* group, const char* subgroup, const char* name,
+        float val = 0.0f, const char* subsubgroup = nullptr)
+    {
+        ParamVariant p;
+        p.InitFloat(group, subgroup, name, fastdelegate::MakeDelegate(&l, &Listener::OnChanged),
+            val, -1.0f, 1.0f, 0.1f, subsubgroup);
+
+        return p;
+    }
+}
+
+TEST_SUITE("ParamRegistry")
+{
+    TEST_CASE("AddFindRemove")
+    {
+        auto reg = std::make_unique<ParamRegistry>();
+        Listener l;
+
+        reg->Add(MakeFloat(l, "Renderer", "Sky", "A"));
+        reg->Add(MakeFloat(l, "Renderer", "Sky", "B"));
+
+        // Nothing changes until updates are applied
+        CHECK(reg->NumParams() == 0);
+        CHECK(reg->Find("Renderer", "Sky", "A") == nullptr);
+
+        CHECK(reg->ApplyUpdates() == 0);
+        REQUIRE(reg->NumParams() == 2);
+
+        ParamVariant* a = reg->Find("Renderer", "Sky", "A");
+        REQUIRE(a != nullptr);
+        CHECK(strcmp(a->GetName(), "A") == 0);
+        CHECK(a->ID() == ParamVariant::ComputeID("Renderer", "Sky", "A"));
+        CHECK(reg->Find(a->ID()) == a);
+        CHECK(reg->Find("Renderer", "Sky", "C") == nullptr);
+        CHECK(reg->Find("Renderer", "SkyA", "") == nullptr);
+
+        // Add replaces, TryAdd doesn't
+        reg->Add(MakeFloat(l, "Renderer", "Sky", "A", 0.5f));
+        reg->TryAdd(MakeFloat(l, "Renderer", "Sky", "B", 0.5f));
+        reg->ApplyUpdates();
+        REQUIRE(reg->NumParams() == 2);
+        CHECK(reg->Find("Renderer", "Sky", "A")->GetFloat().m_value == 0.5f);
+        CHECK(reg->Find("Renderer", "Sky", "B")->GetFloat().m_value == 0.0f);
+
+        reg->Remove("Renderer", "Sky", "A");
+        // Unknown params are ignored
+        reg->Remove("Renderer", "Sky", "C");
+        reg->ApplyUpdates();
+        REQUIRE(reg->NumParams() == 1);
+        CHECK(reg->Find("Renderer", "Sky", "A") == nullptr);
+        CHECK(strcmp(reg->Find("Renderer", "Sky", "B")->GetName(), "B") == 0);
+
+        // Updates are applied in order
+        reg->Add(MakeFloat(l, "Renderer", "Sky", "C"));
+        reg->Remove("Renderer", "Sky", "C");
+        reg->Remove("Renderer", "Sky", "B");
+        reg->TryAdd(MakeFloat(l, "Renderer", "Sky", "B", 0.25f));
+        reg->ApplyUpdates();
+        REQUIRE(reg->NumParams() == 1);
+        CHECK(reg->Find("Renderer", "Sky", "C") == nullptr);
+        CHECK(reg->Find("Renderer", "Sky", "B")->GetFloat().m_value == 0.25f);
+    }
+
+    TEST_CASE("Order")
+    {
+        auto reg = std::make_unique<ParamRegistry>();
+        Listener l;
+
+        reg->Add(MakeFloat(l, "Scene", "Camera", "Z", 0.0f, "Lens"));
+        reg->Add(MakeFloat(l, "Renderer", "Sky", "B"));
+        reg->Add(MakeFloat(l, "Scene", "Camera", "A", 0.0f, "Motion"));
+        reg->Add(MakeFloat(l, "Renderer", "Sky", "A"));
+        reg->Add(MakeFloat(l, "Scene", "Camera", "M", 0.0f, "Lens"));
+        reg->Add(MakeFloat(l, "Renderer", "Display", "A"));
+        reg->ApplyUpdates();
+
+        const char* expected[][3] = {
+            { "Renderer", "Display", "A" },
+            { "Renderer", "Sky", "A" },
+            { "Renderer", "Sky", "B" },
+            { "Scene", "Camera", "M" },
+            { "Scene", "Camera", "Z" },
+            { "Scene", "Camera", "A" } };
+
+        auto params = reg->Params();
+        REQUIRE(params.size() == 6);
+
+        for (int i = 0; i < 6; i++)
+        {
+            CHECK(strcmp(params[i].GetGroup(), expected[i][0]) == 0);
+            CHECK(strcmp(params[i].GetSubGroup(), expected[i][1]) == 0);
+            CHECK(strcmp(params[i].GetName(), expected[i][2]) == 0);
+            // Index is consistent with the order
+            CHECK(reg->Find(expected[i][0], expected[i][1], expected[i][2]) == &params[i]);
+        }
+    }
+
+    TEST_CASE("SetValues")
+    {
+        auto reg = std::make_unique<ParamRegistry>();
+        Listener l;
+        auto dlg = fastdelegate::MakeDelegate(&l, &Listener::OnChanged);
+        const char* modes[] = { "Off", "Low", "High" };
+
+        ParamVariant p;
+        reg->Add(MakeFloat(l, "Test", "Values", "Float"));
+        p.InitInt("Test", "Values", "Int", dlg, 5, 0, 10, 1);
+        reg->Add(p);
+        p.InitFloat3("Test", "Values", "Float3", dlg, float3(0.0f), -10.0f, 10.0f, 1.0f);
+        reg->Add(p);
+        p.InitColor("Test", "Values", "Color", dlg, float3(0.0f));
+        reg->Add(p);
+        p.InitUnitDir("Test", "Values", "Dir", dlg, 0.0f, 0.0f);
+        reg->Add(p);
+        p.InitBool("Test", "Values", "Bool", dlg, false);
+        reg->Add(p);
+        p.InitEnum("Test", "Values", "Enum", dlg, modes, 3, 0);
+        reg->Add(p);
+        reg->ApplyUpdates();
+
+        const char* text =
+            "# Sweep settings\n"
+            "Test/Values/Float = 0.5\n"
+            "  Test / Values / Int = 42   # clamped\n"
+            "\n"
+            "Test/Values/Float3 = 1, 2.5 -3\r\n"
+            "Test/Values/Color = 0.25 2 -1\n"
+            "Test/Values/Dir = 1.0 2.0\n"
+            "Test/Values/Bool = On\n"
+            "Test/Values/Enum = high";
+
+        CHECK(reg->SetValues(text, strlen(text)));
+        CHECK(l.NumCalls == 0);
+        CHECK(reg->ApplyUpdates() == 0);
+        CHECK(l.NumCalls == 7);
+
+        CHECK(reg->Find("Test", "Values", "Float")->GetFloat().m_value == 0.5f);
+        CHECK(reg->Find("Test", "Values", "Int")->GetInt().m_value == 10);
+
+        const float3 f3 = reg->Find("Test", "Values", "Float3")->GetFloat3().m_value;
+        CHECK(f3.x == 1.0f);
+        CHECK(f3.y == 2.5f);
+        CHECK(f3.z == -3.0f);
+
+        const float3 c = reg->Find("Test", "Values", "Color")->GetColor().m_value;
+        CHECK(c.x == 0.25f);
+        CHECK(c.y == 1.0f);
+        CHECK(c.z == 0.0f);
+
+        const UnitDirParam& d = reg->Find("Test", "Values", "Dir")->GetUnitDir();
+        CHECK(d.m_pitch == 1.0f);
+        CHECK(d.m_yaw == 2.0f);
+
+        CHECK(reg->Find("Test", "Values", "Bool")->GetBool());
+        CHECK(reg->Find("Test", "Values", "Enum")->GetEnum().m_curr == 2);
+
+        reg->SetValue("Test", "Values", "Enum", "1");
+        reg->SetValue("Test", "Values", "Bool", "0");
+        CHECK(reg->ApplyUpdates() == 0);
+        CHECK(reg->Find("Test", "Values", "Enum")->GetEnum().m_curr == 1);
+        CHECK(!reg->Find("Test", "Values", "Bool")->GetBool());
+    }
+
+    TEST_CASE("InvalidValues")
+    {
+        auto reg = std::make_unique<ParamRegistry>();
+        Listener l;
+        const char* modes[] = { "Off", "On" };
+
+        ParamVariant p;
+        reg->Add(MakeFloat(l, "Test", "Invalid", "Float", 0.25f));
+        p.InitEnum("Test", "Invalid", "Enum", fastdelegate::MakeDelegate(&l, &Listener::OnChanged),
+            modes, 2, 0);
+        reg->Add(p);
+        reg->ApplyUpdates();
+
+        const char* text =
+            "Test/Invalid = 1\n"
+            "Test/Invalid/Float 1\n"
+            "Test/Invalid/Float =\n"
+            "Test/Invalid/Float = 0.5\n";
+
+        // Malformed lines are reported, the rest are still queued
+        CHECK(!reg->SetValues(text, strlen(text)));
+
+        reg->SetValue("Test", "Invalid", "Float", "abc");
+        reg->SetValue("Test", "Invalid", "Float", "0.5 0.5");
+        reg->SetValue("Test", "Invalid", "Enum", "2");
+        reg->SetValue("Test", "Invalid", "Enum", "Maybe");
+        reg->SetValue("Test", "Invalid", "Missing", "1");
+
+        CHECK(reg->ApplyUpdates() == 5);
+        CHECK(l.NumCalls == 1);
+        CHECK(reg->Find("Test", "Invalid", "Float")->GetFloat().m_value == 0.5f);
+        CHECK(reg->Find("Test", "Invalid", "Enum")->GetEnum().m_curr == 0);
+    }
+
+    TEST_CASE("File")
+    {
+        auto reg = std::make_unique<ParamRegistry>();
+        Listener l;
+
+        reg->Add(MakeFloat(l, "Test", "File", "A"));
+        reg->Add(MakeFloat(l, "Test", "File", "B"));
+        reg->ApplyUpdates();
+
+        const char* path = "TestParamRegistry.txt";
+        char text[] = "Test/File/A = -0.5\nTest/File/B = 2\n";
+        App::Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(text), (uint32_t)strlen(text));
+
+        CHECK(reg->SetValuesFromFile(path));
+        App::Filesystem::RemoveFile(path);
+
+        CHECK(reg->ApplyUpdates() == 0);
+        CHECK(reg->Find("Test", "File", "A")->GetFloat().m_value == -0.5f);
+        CHECK(reg->Find("Test", "File", "B")->GetFloat().m_value == 1.0f);
+
+        CHECK(!reg->SetValuesFromFile("Missing.txt"));
+    }
+
+    TEST_CASE("Concurrent")
+    {
+        auto reg = std::make_unique<ParamRegistry>();
+        constexpr int NUM_THREADS = 8;
+        constexpr int NUM_PARAMS = 64;
+        Listener listeners[NUM_THREADS];
+        std::thread threads[NUM_THREADS];
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads[t] = std::thread([&reg, &listeners, t]()
+                {
+                    char subgroup[16];
+                    char name[16];
+                    snprintf(subgroup, sizeof(subgroup), "Thread%d", t);
+
+                    for (int i = 0; i < NUM_PARAMS; i++)
+                    {
+                        snprintf(name, sizeof(name), "P%02d", i);
+                        reg->Add(MakeFloat(listeners[t], "Concurrent", subgroup, name));
+                        reg->SetValue("Concurrent", subgroup, name, "0.5");
+                    }
+                });
+        }
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            threads[t].join();
+
+        CHECK(reg->ApplyUpdates() == 0);
+        REQUIRE(reg->NumParams() == NUM_THREADS * NUM_PARAMS);
+
+        bool allSet = true;
+        for (auto& p : reg->Params())
+            allSet = allSet && p.GetFloat().m_value == 0.5f;
+
+        CHECK(allSet);
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            CHECK(listeners[t].NumCalls == NUM_PARAMS);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <Support/PipelineCacheIndex.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <string.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+using ACQUIRE = PipelineCacheIndex::ACQUIRE;
+
+TEST_SUITE("PipelineCacheIndex")
+{
+    TEST_CASE("HitAndMiss")
+    {
+        auto index = std::make_unique<PipelineCacheIndex>(4);
+
+        // First request compiles
+        CHECK(index->Acquire(0, 0x1234) == ACQUIRE::COMPILE);
+        index->Publish(0, 0x1234, true, "Shader_cs.cso");
+        CHECK(index->Key(0) == 0x1234);
+        CHECK(index->InLibrary(0));
+
+        // Same key is a hit
+        CHECK(index->Acquire(0, 0x1234) == ACQUIRE::HIT);
+        // Other slots are unaffected
+        CHECK(index->Acquire(1, 0x1234) == ACQUIRE::COMPILE);
+        index->Publish(1, 0x1234, false, nullptr);
+        CHECK(!index->InLibrary(1));
+
+        // Compiled slots can't be claimed
+        CHECK(!index->TryClaim(0));
+        CHECK(index->TryClaim(2));
+        CHECK(!index->TryClaim(2));
+        index->Publish(2, 0x99, false, nullptr);
+
+        // Clear() makes every slot compile again
+        index->Clear();
+        CHECK(index->Acquire(0, 0x1234) == ACQUIRE::COMPILE);
+        CHECK(index->Key(0) == 0);
+    }
+
+    TEST_CASE("Invalidation")
+    {
+        auto index = std::make_unique<PipelineCacheIndex>(2);
+
+        CHECK(index->Acquire(0, 1) == ACQUIRE::COMPILE);
+        index->Publish(0, 1, true, "A_cs.cso");
+        index->OnStoredInLibrary();
+
+        // Modified shader
+        CHECK(index->Acquire(0, 2) == ACQUIRE::STALE);
+        index->Publish(0, 2, true, "A_cs.cso");
+        index->OnStoredInLibrary();
+        CHECK(index->Acquire(0, 2) == ACQUIRE::HIT);
+
+        // Old PSO is still in the library
+        CHECK(index->NumLibraryPSOs() == 2);
+        CHECK(index->NumStale() == 1);
+        CHECK(!index->TooManyStale(1));
+
+        for (uint64_t key = 3; key < 3 + PipelineCacheIndex::MIN_NUM_STALE_BEFORE_REBUILD; key++)
+        {
+            CHECK(index->Acquire(0, key) == ACQUIRE::STALE);
+            index->Publish(0, key, true, "A_cs.cso");
+            index->OnStoredInLibrary();
+        }
+
+        CHECK(index->NumStale() == PipelineCacheIndex::MIN_NUM_STALE_BEFORE_REBUILD + 1);
+        CHECK(index->TooManyStale(1));
+        CHECK(!index->TooManyStale(PipelineCacheIndex::MIN_NUM_STALE_BEFORE_REBUILD + 1));
+
+        // Rebuild
+        index->OnLibraryReset();
+        CHECK(index->NumLibraryPSOs() == 0);
+        CHECK(!index->InLibrary(0));
+        index->SetInLibrary(0, true);
+        index->OnStoredInLibrary();
+        CHECK(index->NumStale() == 0);
+        CHECK(index->Acquire(0, 2 + PipelineCacheIndex::MIN_NUM_STALE_BEFORE_REBUILD) == ACQUIRE::HIT);
+    }
+
+    TEST_CASE("Wait")
+    {
+        auto index = std::make_unique<PipelineCacheIndex>(1);
+        CHECK(index->Acquire(0, 7) == ACQUIRE::COMPILE);
+
+        std::atomic_int result = -1;
+        std::thread waiter([&index, &result]()
+            {
+                result.store((int)index->Acquire(0, 7), std::memory_order_relaxed);
+            });
+
+        // Waiter is blocked until the PSO is published
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(result.load(std::memory_order_relaxed) == -1);
+
+        index->Publish(0, 7, false, nullptr);
+        waiter.join();
+        CHECK(result.load(std::memory_order_relaxed) == (int)ACQUIRE::HIT);
+    }
+
+    TEST_CASE("Serialize")
+    {
+        auto index = std::make_unique<PipelineCacheIndex>(8);
+
+        CHECK(index->Acquire(1, 0xabcd) == ACQUIRE::COMPILE);
+        index->Publish(1, 0xabcd, true, "Compute_cs.cso");
+        index->OnStoredInLibrary();
+        CHECK(index->Acquire(5, 0xef) == ACQUIRE::COMPILE);
+        index->Publish(5, 0xef, false, nullptr);
+
+        // Paths that don't fit aren't recorded
+        char longPath[PipelineCacheIndex::MAX_PATH_LEN + 8];
+        memset(longPath, 'a', sizeof(longPath) - 1);
+        longPath[sizeof(longPath) - 1] = '\0';
+        CHECK(index->Acquire(6, 0x42) == ACQUIRE::COMPILE);
+        index->Publish(6, 0x42, false, longPath);
+
+        SmallVector<uint8_t> data;
+        index->Serialize(data);
+
+        auto loaded = std::make_unique<PipelineCacheIndex>(8);
+        REQUIRE(loaded->Load(Span<const uint8_t>(data.data(), data.size())));
+        CHECK(loaded->Key(1) == 0xabcd);
+        CHECK(loaded->InLibrary(1));
+        CHECK(loaded->Key(5) == 0xef);
+        CHECK(loaded->Key(0) == 0);
+        CHECK(loaded->NumLibraryPSOs() == 1);
+        CHECK(loaded->HasWarmUpWork());
+
+        // Loaded slots haven't been compiled yet
+        char path[PipelineCacheIndex::MAX_PATH_LEN];
+        CHECK(loaded->NeedsWarmUp(1, path));
+        CHECK(strcmp(path, "Compute_cs.cso") == 0);
+        CHECK(!loaded->NeedsWarmUp(5, path));
+        CHECK(!loaded->NeedsWarmUp(6, path));
+
+        // Index from a build with fewer PSOs
+        auto smaller = std::make_unique<PipelineCacheIndex>(4);
+        REQUIRE(smaller->Load(Span<const uint8_t>(data.data(), data.size())));
+        CHECK(smaller->Key(1) == 0xabcd);
+
+        // Once claimed, slot no longer needs warm-up
+        CHECK(loaded->TryClaim(1));
+        CHECK(!loaded->NeedsWarmUp(1, path));
+        loaded->Publish(1, 0xabcd, true, "Compute_cs.cso");
+        CHECK(loaded->Acquire(1, 0xabcd) == ACQUIRE::HIT);
+
+        // Invalid data leaves the index empty
+        data[0] ^= 0xff;
+        CHECK(!loaded->Load(Span<const uint8_t>(data.data(), data.size())));
+        CHECK(loaded->Key(1) == 0);
+        CHECK(!loaded->HasWarmUpWork());
+
+        data[0] ^= 0xff;
+        data.pop_back();
+        CHECK(!loaded->Load(Span<const uint8_t>(data.data(), data.size())));
+        CHECK(!loaded->Load(Span<const uint8_t>(data.data(), 4)));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,519 @@
+#include <RayTracing/ReferencePathTracer.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::RT::BSDF;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Core;
+
+namespace
+{
+    float3 RandomDir(RNG& rng)
+    {
+        const float z = 1.0f - 2.0f * rng.Uniform();
+        const float r = sqrtf(Max(1.0f - z * z, 0.0f));
+        const float phi = TWO_PI * rng.Uniform();
+
+        return float3(r * cosf(phi), r * sinf(phi), z);
+    }
+
+    // Directional albedo is constant and equal to 0.5 everywhere -- not physically
+    // accurate, but enough for testing sampling against evaluation
+    void InitConstantRhoLUT(RhoLUT& rho)
+    {
+        SmallVector<uint16_t> texels;
+        texels.resize(RhoLUT::WIDTH * RhoLUT::HEIGHT * RhoLUT::DEPTH, UINT16_MAX / 2);
+        rho.Init(texels);
+    }
+
+    bool IsClose(double a, double b, double relTol)
+    {
+        return fabs(a - b) <= relTol * Max(fabs(b), 1e-6);
+    }
+
+    // Reference closest hit (Moller-Trumbore)
+    bool BruteForceIntersect(const SmallVector<float3>& positions, const Ray& ray, float& tClosest,
+        uint32_t& triClosest, float& minBarycentric)
+    {
+        tClosest = FLT_MAX;
+        triClosest = UINT32_MAX;
+
+        for (uint32_t t = 0; t < (uint32_t)positions.size() / 3; t++)
+        {
+            const float3 e1 = positions[3 * t + 1] - positions[3 * t];
+            const float3 e2 = positions[3 * t + 2] - positions[3 * t];
+            const float3 pv = ray.Dir.cross(e2);
+            const float det = e1.dot(pv);
+            if (fabsf(det) < 1e-12f)
+                continue;
+
+            const float invDet = 1.0f / det;
+            const float3 s = ray.Origin - positions[3 * t];
+            const float u = s.dot(pv) * invDet;
+            if (u < 0 || u > 1)
+                continue;
+
+            const float3 q = s.cross(e1);
+            const float v = ray.Dir.dot(q) * invDet;
+            if (v < 0 || u + v > 1)
+                continue;
+
+            const float hitT = e2.dot(q) * invDet;
+            if (hitT > 0 && hitT < tClosest)
+            {
+                tClosest = hitT;
+                triClosest = t;
+                minBarycentric = Min(Min(u, v), 1.0f - u - v);
+            }
+        }
+
+        return triClosest != UINT32_MAX;
+    }
+
+    // Two-triangle quad in the plane z = z0, facing -z
+    void Quad(float halfSize, float z0, Vertex (&vertices)[4])
+    {
+        const oct32 n(0.0f, 0.0f, -1.0f);
+        const oct32 t(1.0f, 0.0f, 0.0f);
+        vertices[0] = { .Position = float3(-halfSize, -halfSize, z0), .TexUV = float2(0.0f), .Normal = n, .Tangent = t };
+        vertices[1] = { .Position = float3(-halfSize, halfSize, z0), .TexUV = float2(0.0f), .Normal = n, .Tangent = t };
+        vertices[2] = { .Position = float3(halfSize, halfSize, z0), .TexUV = float2(0.0f), .Normal = n, .Tangent = t };
+        vertices[3] = { .Position = float3(halfSize, -halfSize, z0), .TexUV = float2(0.0f), .Normal = n, .Tangent = t };
+    }
+
+    float4x3 Translation(const float3& t)
+    {
+        float4x3 M;
+        M.m[0] = float3(1.0f, 0.0f, 0.0f);
+        M.m[1] = float3(0.0f, 1.0f, 0.0f);
+        M.m[2] = float3(0.0f, 0.0f, 1.0f);
+        M.m[3] = t;
+
+        return M;
+    }
+
+    void AddQuad(ReferencePathTracer& pt, float halfSize, float z0, const Material& mat)
+    {
+        Vertex vertices[4];
+        Quad(halfSize, z0, vertices);
+        const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+        pt.AddMesh(Span(vertices, 4), Span(indices, 6), Translation(float3(0.0f)), mat);
+    }
+
+    ReferencePathTracer::View LookDownZ()
+    {
+        return ReferencePathTracer::View{ .Pos = float3(0.0f),
+            .BasisX = float3(1.0f, 0.0f, 0.0f),
+            .BasisY = float3(0.0f, 1.0f, 0.0f),
+            .BasisZ = float3(0.0f, 0.0f, 1.0f),
+            .TanHalfFOV = 0.5f,
+            .AspectRatio = 1.0f };
+    }
+
+    ShadingData MakeSurface(const RhoLUT& rho, const Material& m, const float3& wo,
+        const float3& normal = float3(0.0f, 0.0f, 1.0f))
+    {
+        Material mat = m;
+        const float trDepth = mat.Transmissive() ? HalfToFloat(mat.GetTransmissionDepth().x) : 0.0f;
+
+        return ShadingData::Init(rho, normal, wo, mat.Metallic(),
+            mat.GetSpecularRoughness(), mat.GetBaseColorFactor(), ETA_AIR, mat.GetSpecularIOR(),
+            mat.Transmissive(), trDepth, mat.ThinWalled() ? mat.GetSubsurface() : 0.0f,
+            mat.GetCoatWeight(), mat.GetCoatColor(), mat.GetCoatRoughness(), mat.GetCoatIOR());
+    }
+
+    // Rough materials covering every lobe
+    SmallVector<Material> TestMaterials()
+    {
+        SmallVector<Material> mats;
+
+        Material m;
+        m.SetBaseColorFactor(float3(0.8f, 0.6f, 0.4f));
+        m.SetSpecularRoughness(0.5f);
+        mats.push_back(m);
+
+        m = Material();
+        m.SetBaseColorFactor(float3(0.9f, 0.7f, 0.3f));
+        m.SetMetallic(1.0f);
+        m.SetSpecularRoughness(0.4f);
+        mats.push_back(m);
+
+        m = Material();
+        m.SetTransmission(1.0f);
+        m.SetSpecularRoughness(0.4f);
+        mats.push_back(m);
+
+        m = Material();
+        m.SetBaseColorFactor(float3(0.5f, 0.8f, 0.5f));
+        m.SetThinWalled(true);
+        m.SetSubsurface(0.5f);
+        m.SetSpecularRoughness(0.6f);
+        mats.push_back(m);
+
+        m = Material();
+        m.SetBaseColorFactor(float3(0.2f, 0.3f, 0.8f));
+        m.SetSpecularRoughness(0.7f);
+        m.SetCoatWeight(1.0f);
+        m.SetCoatRoughness(0.3f);
+        mats.push_back(m);
+
+        return mats;
+    }
+}
+
+TEST_SUITE("ReferencePathTracer")
+{
+    TEST_CASE("BVHMatchesBruteForce")
+    {
+        RNG rng(7);
+        SmallVector<float3> positions;
+
+        for (int i = 0; i < 2000; i++)
+        {
+            const float3 v0(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f);
+            positions.push_back(v0);
+            positions.push_back(v0 + RandomDir(rng) * (0.1f + rng.Uniform()));
+            positions.push_back(v0 + RandomDir(rng) * (0.1f + rng.Uniform()));
+        }
+
+        TriangleBVH bvh;
+        bvh.Build(positions);
+        CHECK(bvh.NumTriangles() == 2000);
+
+        int numHits = 0;
+
+        for (int i = 0; i < 2000; i++)
+        {
+            const float3 origin(rng.Uniform() * 12.0f - 1.0f, rng.Uniform() * 12.0f - 1.0f,
+                rng.Uniform() * 12.0f - 1.0f);
+            const Ray ray(origin, RandomDir(rng));
+
+            float tRef;
+            uint32_t triRef;
+            float minBarycentric;
+            const bool hitRef = BruteForceIntersect(positions, ray, tRef, triRef, minBarycentric);
+
+            TriangleHit hit;
+            const bool hitBVH = bvh.Intersect(ray, FLT_MAX, hit);
+
+            // Hits close to triangle edges can go either way
+            if ((hitRef && minBarycentric < 1e-4f) ||
+                (hitBVH && Min(Min(hit.U, hit.V), 1.0f - hit.U - hit.V) < 1e-4f))
+            {
+                continue;
+            }
+
+            REQUIRE(hitRef == hitBVH);
+            REQUIRE(bvh.Occluded(ray, FLT_MAX) == hitBVH);
+
+            if (hitRef)
+            {
+                numHits++;
+                CHECK(fabsf(hit.T - tRef) <= 1e-3f * Max(tRef, 1.0f));
+                CHECK((hit.Tri == triRef || fabsf(hit.T - tRef) <= 1e-5f));
+
+                // Nothing is hit before the closest hit
+                CHECK(!bvh.Occluded(ray, hit.T * 0.999f));
+            }
+        }
+
+        CHECK(numHits > 100);
+    }
+
+    TEST_CASE("PdfIntegratesToOne")
+    {
+        RhoLUT rho;
+        InitConstantRhoLUT(rho);
+        ReferencePathTracer pt;
+        pt.Init(ReferencePathTracer::Options{ .Width = 16, .Height = 16 });
+        RNG rng(11);
+
+        const float3 normal(0.0f, 0.0f, 1.0f);
+        const float3 wo = Normalize(float3(0.3f, -0.2f, 0.8f));
+        const int N = 200000;
+
+        for (auto& mat : TestMaterials())
+        {
+            const ShadingData surface = MakeSurface(rho, mat, wo);
+
+            // Uniform sphere sampling, pdf = 1 / 4 pi
+            double sum = 0;
+            for (int i = 0; i < N; i++)
+                sum += pt.BSDFPdf(surface, normal, RandomDir(rng)) * 4.0 * PI;
+
+            CHECK(IsClose(sum / N, 1.0, 0.03));
+        }
+    }
+
+    TEST_CASE("SampleWeightMatchesEvaluation")
+    {
+        RhoLUT rho;
+        InitConstantRhoLUT(rho);
+        ReferencePathTracer pt;
+        pt.Init(ReferencePathTracer::Options{ .Width = 16, .Height = 16 });
+        RNG rng(13);
+
+        const float3 normal(0.0f, 0.0f, 1.0f);
+        const float3 wo = Normalize(float3(-0.4f, 0.1f, 0.7f));
+        const int N = 200000;
+
+        for (auto& mat : TestMaterials())
+        {
+            const ShadingData surface = MakeSurface(rho, mat, wo);
+
+            // Importance sampled estimate of directional albedo
+            float3 sampled(0.0f);
+            for (int i = 0; i < N; i++)
+            {
+                ReferencePathTracer::BSDFSample s;
+                if (pt.SampleBSDF(surface, normal, rng, s))
+                {
+                    CHECK(!s.Delta);
+                    sampled += s.Weight;
+                }
+            }
+
+            // Uniform sphere sampling estimate of the same
+            float3 uniform(0.0f);
+            for (int i = 0; i < N; i++)
+            {
+                ShadingData si = surface;
+                si.SetWi(RandomDir(rng), normal);
+                uniform += Unified(si).f * 4.0f * PI;
+            }
+
+            sampled /= (float)N;
+            uniform /= (float)N;
+
+            CHECK(IsClose(sampled.x, uniform.x, 0.03));
+            CHECK(IsClose(sampled.y, uniform.y, 0.03));
+            CHECK(IsClose(sampled.z, uniform.z, 0.03));
+        }
+    }
+
+    TEST_CASE("SpecularMirrorFurnace")
+    {
+        ReferencePathTracer pt;
+        pt.Init(ReferencePathTracer::Options{ .Width = 16, .Height = 16, .SamplesPerPixel = 4,
+            .SkyRadiance = float3(0.5f, 1.0f, 2.0f) });
+        InitConstantRhoLUT(pt.RhoLUT());
+
+        // White mirror reflects everything, the sky is seen unchanged
+        Material mirror;
+        mirror.SetMetallic(1.0f);
+        mirror.SetSpecularRoughness(0.0f);
+        AddQuad(pt, 10.0f, 1.0f, mirror);
+        pt.Commit();
+        pt.SetView(LookDownZ());
+
+        for (uint32_t i = 0; i < pt.NumTiles(); i++)
+            pt.RenderTile(i);
+
+        for (auto& p : pt.Image())
+        {
+            CHECK(IsClose(p.x, 0.5f, 1e-3));
+            CHECK(IsClose(p.y, 1.0f, 1e-3));
+            CHECK(IsClose(p.z, 2.0f, 1e-3));
+        }
+    }
+
+    TEST_CASE("DirectlyVisibleEmitter")
+    {
+        ReferencePathTracer pt;
+        pt.Init(ReferencePathTracer::Options{ .Width = 20, .Height = 20, .SamplesPerPixel = 2,
+            .MaxDepth = 1 });
+        InitConstantRhoLUT(pt.RhoLUT());
+
+        Material light;
+        light.SetBaseColorFactor(float3(0.0f));
+        light.SetEmissiveFactor(float3(1.0f, 0.5f, 0.25f));
+        light.SetEmissiveStrength(4.0f);
+        // Emissive factor is quantized
+        const float3 Le = light.GetEmissiveFactor() * HalfToFloat(light.GetEmissiveStrength().x);
+        AddQuad(pt, 10.0f, 1.0f, light);
+        pt.Commit();
+        CHECK(pt.NumEmissiveTriangles() == 2);
+
+        pt.SetView(LookDownZ());
+
+        for (uint32_t i = 0; i < pt.NumTiles(); i++)
+            pt.RenderTile(i);
+
+        for (auto& p : pt.Image())
+        {
+            CHECK(IsClose(p.x, Le.x, 1e-5));
+            CHECK(IsClose(p.y, Le.y, 1e-5));
+            CHECK(IsClose(p.z, Le.z, 1e-5));
+        }
+    }
+
+    TEST_CASE("DirectLightingMatchesNumericalIntegration")
+    {
+        // Diffuse floor lit by a small double-sided emitter, with paths of up to two
+        // segments, emitter is found by both light and BSDF sampling
+        ReferencePathTracer pt;
+        pt.Init(ReferencePathTracer::Options{ .Width = 4, .Height = 4, .MaxDepth = 2 });
+        InitConstantRhoLUT(pt.RhoLUT());
+
+        Material floor;
+        floor.SetBaseColorFactor(float3(0.75f));
+        floor.SetSpecularRoughness(1.0f);
+        AddQuad(pt, 5.0f, 2.0f, floor);
+
+        const float lightHalfSize = 0.2f;
+        const float3 Le(20.0f);
+        Material light;
+        light.SetBaseColorFactor(float3(0.0f));
+        light.SetEmissiveFactor(float3(1.0f));
+        light.SetEmissiveStrength(Le.x);
+        light.SetDoubleSided(true);
+        AddQuad(pt, lightHalfSize, 1.0f, light);
+
+        pt.Commit();
+
+        // Camera ray that reaches the floor without passing through the emitter
+        const float3 pos(1.5f, 1.0f, 2.0f);
+        const Ray ray(float3(0.0f), Normalize(pos));
+
+        RNG rng(17);
+        const int N = 100000;
+        float3 estimate(0.0f);
+        uint32_t numRays = 0;
+
+        for (int i = 0; i < N; i++)
+            estimate += pt.Li(ray, rng, numRays);
+
+        estimate /= (float)N;
+        CHECK(numRays >= 2 * N);
+
+        // Reference -- uniform sampling of emitter area
+        const float3 normal(0.0f, 0.0f, -1.0f);
+        const ShadingData surface = MakeSurface(pt.RhoLUT(), floor, -ray.Dir, normal);
+        const float area = 4.0f * lightHalfSize * lightHalfSize;
+        float3 reference(0.0f);
+
+        for (int i = 0; i < N; i++)
+        {
+            const float3 lightPos((2.0f * rng.Uniform() - 1.0f) * lightHalfSize,
+                (2.0f * rng.Uniform() - 1.0f) * lightHalfSize, 1.0f);
+            float3 wi = lightPos - pos;
+            const float t2 = wi.dot(wi);
+            wi = wi / sqrtf(t2);
+
+            ShadingData si = surface;
+            si.SetWi(wi, normal);
+            reference += Unified(si).f * Le * fabsf(wi.z) / t2;
+        }
+
+        reference *= area / N;
+
+        CHECK(reference.x > 0);
+        CHECK(IsClose(estimate.x, reference.x, 0.03));
+        CHECK(IsClose(estimate.y, reference.y, 0.03));
+        CHECK(IsClose(estimate.z, reference.z, 0.03));
+    }
+
+    TEST_CASE("SceneSourceMatchesAddMesh")
+    {
+        // Diffuse floor and an emitter that are instances of the same quad
+        Vertex vertices[4];
+        Quad(1.0f, 0.0f, vertices);
+        uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+        Material materials[2];
+        materials[0].SetBaseColorFactor(float3(0.75f));
+        materials[0].SetSpecularRoughness(1.0f);
+        materials[1].SetBaseColorFactor(float3(0.0f));
+        materials[1].SetEmissiveFactor(float3(1.0f));
+        materials[1].SetEmissiveStrength(10.0f);
+        materials[1].SetDoubleSided(true);
+
+        const float4x3 toWorlds[2] = { Translation(float3(0.0f, 0.0f, 3.0f)),
+            Translation(float3(0.5f, 0.5f, 1.5f)) };
+
+        ReferencePathTracer::SceneSource::Mesh meshes[2] = {
+            { .BaseVertex = 0, .NumVertices = 4, .BaseIndex = 0, .NumIndices = 6, .MatIdx = 0 },
+            { .BaseVertex = 0, .NumVertices = 4, .BaseIndex = 0, .NumIndices = 6, .MatIdx = 1 } };
+        ReferencePathTracer::SceneSource::Instance instances[2] = {
+            { .MeshIdx = 0, .ToWorld = toWorlds[0] },
+            { .MeshIdx = 1, .ToWorld = toWorlds[1] } };
+
+        const ReferencePathTracer::Options opts{ .Width = 16, .Height = 16, .SamplesPerPixel = 2,
+            .MaxDepth = 2 };
+        ReferencePathTracer fromMeshes;
+        fromMeshes.Init(opts);
+        InitConstantRhoLUT(fromMeshes.RhoLUT());
+
+        for (int i = 0; i < 2; i++)
+            fromMeshes.AddMesh(Span(vertices, 4), Span(indices, 6), toWorlds[i], materials[i]);
+
+        ReferencePathTracer fromSource;
+        fromSource.Init(opts);
+        InitConstantRhoLUT(fromSource.RhoLUT());
+        fromSource.AddScene(ReferencePathTracer::SceneSource{ .Vertices = Span(vertices, 4),
+            .Indices = Span(indices, 6),
+            .Meshes = Span(meshes, 2),
+            .Materials = Span(materials, 2),
+            .Instances = Span(instances, 2) });
+
+        ReferencePathTracer* tracers[2] = { &fromMeshes, &fromSource };
+
+        for (auto* pt : tracers)
+        {
+            pt->Commit();
+            pt->SetView(LookDownZ());
+
+            for (uint32_t i = 0; i < pt->NumTiles(); i++)
+                pt->RenderTile(i);
+        }
+
+        CHECK(fromSource.NumTriangles() == 4);
+        CHECK(fromSource.NumEmissiveTriangles() == 2);
+
+        float sum = 0.0f;
+
+        for (size_t i = 0; i < fromMeshes.Image().size(); i++)
+        {
+            CHECK(fromSource.Image()[i].x == fromMeshes.Image()[i].x);
+            CHECK(fromSource.Image()[i].y == fromMeshes.Image()[i].y);
+            CHECK(fromSource.Image()[i].z == fromMeshes.Image()[i].z);
+            sum += fromSource.Image()[i].x;
+        }
+
+        CHECK(sum > 0);
+    }
+
+    TEST_CASE("ComputedRhoLUT")
+    {
+        RhoLUT rho;
+        rho.Compute(4);
+        REQUIRE(rho.IsLoaded());
+
+        for (float u = 0.05f; u < 1.0f; u += 0.1f)
+        {
+            for (float w = 0.0f; w <= 1.0f; w += 0.25f)
+            {
+                const float r = rho.Sample(u, 0.5f, w);
+                CHECK(r >= 0.0f);
+                CHECK(r <= 1.0f);
+            }
+        }
+
+        // Nearly smooth surface, reduces to Fresnel reflectance. Sampled at texel centers.
+        const uint32_t x = 57;
+        const uint32_t z = 15;
+        const float ndotwo = (x + 0.5f) / RhoLUT::WIDTH;
+        const float eta = 0.5f + (z + 0.5f) / RhoLUT::DEPTH * (1.99f - 0.5f);
+        const float r = rho.Sample(ndotwo, 0.5f / RhoLUT::HEIGHT, (z + 0.5f) / RhoLUT::DEPTH);
+        CHECK(IsClose(r, Fresnel_Dielectric(ndotwo, 1.0f / eta), 0.02));
+
+        // Reflectance of a matched interface vanishes, more so when it's rough
+        const float etaOne = (1.0f - 0.5f) / (1.99f - 0.5f);
+        CHECK(rho.Sample(ndotwo, 1.0f, etaOne) < 0.01f);
+        CHECK(rho.Sample(ndotwo, 0.5f / RhoLUT::HEIGHT, 1.0f) > rho.Sample(ndotwo, 0.5f / RhoLUT::HEIGHT, etaOne));
+    }
+}
\ No newline at end of file
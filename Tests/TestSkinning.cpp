@@ -0,0 +1,324 @@
+#include <Scene/Skinning.h>
+#include <Math/MatrixFuncs.h>
+#include <Math/Quaternion.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Scene::Internal;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Core;
+
+namespace
+{
+    float3 RandomUnitVector(RNG& rng)
+    {
+        float3 v(rng.Uniform() - 0.5f, rng.Uniform() - 0.5f, rng.Uniform() - 0.5f);
+        v.normalize();
+
+        return v;
+    }
+
+    float4x3 RandomTransform(RNG& rng)
+    {
+        const float s = 0.5f + rng.Uniform();
+        float3 axis = RandomUnitVector(rng);
+        float4 q = storeFloat4(rotationQuaternion(axis, rng.Uniform() * TWO_PI));
+        float3 scale(s, s, s);
+        float3 tr(rng.Uniform() * 4.0f, rng.Uniform() * 4.0f, rng.Uniform() * 4.0f);
+
+        return float4x3(store(affineTransformation(scale, q, tr)));
+    }
+
+    void RandomVertices(RNG& rng, int n, Vertex* vertices)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            vertices[i].Position = float3(rng.Uniform() * 2.0f - 1.0f, rng.Uniform() * 2.0f - 1.0f,
+                rng.Uniform() * 2.0f - 1.0f);
+            vertices[i].TexUV = float2(rng.Uniform(), rng.Uniform());
+            vertices[i].Normal = oct32(RandomUnitVector(rng));
+            vertices[i].Tangent = oct32(RandomUnitVector(rng));
+        }
+    }
+
+    void RandomSkin(RNG& rng, int n, int numJoints, VertexSkin* skin)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            float sum = 0.0f;
+
+            for (int k = 0; k < MAX_NUM_JOINTS_PER_VERTEX; k++)
+            {
+                skin[i].Joints[k] = (uint16_t)rng.UniformUintBounded(numJoints);
+                skin[i].Weights[k] = rng.Uniform();
+                sum += skin[i].Weights[k];
+            }
+
+            for (int k = 0; k < MAX_NUM_JOINTS_PER_VERTEX; k++)
+                skin[i].Weights[k] /= sum;
+        }
+    }
+
+    // Scalar reference -- p' = sum_k w_k * p * M_k
+    float3 ReferencePosition(const float3& p, const VertexSkin& s, const float4x4a* joints)
+    {
+        float3 res(0.0f);
+
+        for (int k = 0; k < MAX_NUM_JOINTS_PER_VERTEX; k++)
+        {
+            const float4x4a& M = joints[s.Joints[k]];
+            float3 pk;
+            pk.x = p.x * M.m[0].x + p.y * M.m[1].x + p.z * M.m[2].x + M.m[3].x;
+            pk.y = p.x * M.m[0].y + p.y * M.m[1].y + p.z * M.m[2].y + M.m[3].y;
+            pk.z = p.x * M.m[0].z + p.y * M.m[1].z + p.z * M.m[2].z + M.m[3].z;
+
+            res += pk * s.Weights[k];
+        }
+
+        return res;
+    }
+
+    bool Equal(const float3& a, const float3& b, float eps = 1e-3f)
+    {
+        return fabsf(a.x - b.x) < eps && fabsf(a.y - b.y) < eps && fabsf(a.z - b.z) < eps;
+    }
+}
+
+TEST_SUITE("Skinning")
+{
+    TEST_CASE("LinearBlendSkinning")
+    {
+        constexpr int NUM_VERTICES = 301;
+        constexpr int NUM_JOINTS = 7;
+
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        Vertex vertices[NUM_VERTICES];
+        VertexSkin skin[NUM_VERTICES];
+        RandomVertices(rng, NUM_VERTICES, vertices);
+        RandomSkin(rng, NUM_VERTICES, NUM_JOINTS, skin);
+
+        uint64_t jointIDs[NUM_JOINTS];
+        float4x4a inverseBinds[NUM_JOINTS];
+        float4x3 jointToWorlds[NUM_JOINTS];
+        float4x4a expectedJoints[NUM_JOINTS];
+
+        const float4x3 meshToWorld = RandomTransform(rng);
+        const v_float4x4 vWorldToMesh = inverseSRT(load4x3(meshToWorld));
+
+        for (int j = 0; j < NUM_JOINTS; j++)
+        {
+            jointIDs[j] = j;
+            inverseBinds[j] = float4x4a(RandomTransform(rng));
+            jointToWorlds[j] = RandomTransform(rng);
+
+            v_float4x4 vM = mul(load4x4(inverseBinds[j]), load4x3(jointToWorlds[j]));
+            expectedJoints[j] = store(mul(vM, vWorldToMesh));
+        }
+
+        SkinnedMeshSet set;
+        set.Add(SkinnedMeshDesc{
+            .InstanceID = 5,
+            .Vertices = Span(vertices, NUM_VERTICES),
+            .Skin = Span(skin, NUM_VERTICES),
+            .JointIDs = Span(jointIDs, NUM_JOINTS),
+            .InverseBindMatrices = Span(inverseBinds, NUM_JOINTS) });
+
+        CHECK(set.NumMeshes() == 1);
+        CHECK(set.Find(5).value() == 0);
+        CHECK(!set.Find(6));
+
+        set.UpdateJointMatrices(0, meshToWorld, Span(jointToWorlds, NUM_JOINTS));
+        set.Deform(0);
+
+        auto deformed = set.DeformedVertices(0);
+        REQUIRE(deformed.size() == NUM_VERTICES);
+
+        float3 vMin(FLT_MAX);
+        float3 vMax(-FLT_MAX);
+        bool allEqual = true;
+
+        for (int i = 0; i < NUM_VERTICES; i++)
+        {
+            const float3 expected = ReferencePosition(vertices[i].Position, skin[i], expectedJoints);
+            Vertex v = deformed[i];
+
+            allEqual = allEqual && Equal(v.Position, expected);
+            allEqual = allEqual && v.TexUV.x == vertices[i].TexUV.x && v.TexUV.y == vertices[i].TexUV.y;
+            allEqual = allEqual && fabsf(v.Normal.decode().length() - 1.0f) < 1e-3f;
+
+            vMin = float3(Min(vMin.x, expected.x), Min(vMin.y, expected.y), Min(vMin.z, expected.z));
+            vMax = float3(Max(vMax.x, expected.x), Max(vMax.y, expected.y), Max(vMax.z, expected.z));
+        }
+
+        CHECK(allEqual);
+
+        const AABB& box = set.Bounds(0);
+        CHECK(Equal(box.Center, (vMin + vMax) * 0.5f));
+        CHECK(Equal(box.Extents, (vMax - vMin) * 0.5f));
+    }
+
+    TEST_CASE("RigidSkinIsRigidTransform")
+    {
+        // Every vertex fully bound to one joint with identity inverse bind -> mesh moves
+        // with the joint
+        Vertex vertices[3];
+        vertices[0].Position = float3(1, 0, 0);
+        vertices[1].Position = float3(0, 1, 0);
+        vertices[2].Position = float3(0, 0, 1);
+
+        for (auto& v : vertices)
+        {
+            v.Normal = oct32(0, 1, 0);
+            v.Tangent = oct32(1, 0, 0);
+        }
+
+        VertexSkin skin[3];
+        for (auto& s : skin)
+            s = VertexSkin{ .Joints = { 0, 0, 0, 0 }, .Weights = { 1, 0, 0, 0 } };
+
+        uint64_t jointID = 1;
+        float4x4a I = store(identity());
+        const float4x3 meshToWorld = float4x3(store(identity()));
+        const float4x3 jointToWorld = float4x3(store(translate(1.0f, 2.0f, 3.0f)));
+
+        SkinnedMeshSet set;
+        set.Add(SkinnedMeshDesc{
+            .InstanceID = 1,
+            .Vertices = Span(vertices, 3),
+            .Skin = Span(skin, 3),
+            .JointIDs = Span(&jointID, 1),
+            .InverseBindMatrices = Span(&I, 1) });
+
+        set.UpdateJointMatrices(0, meshToWorld, Span(&jointToWorld, 1));
+        set.Deform(0);
+
+        auto deformed = set.DeformedVertices(0);
+        CHECK(Equal(deformed[0].Position, float3(2, 2, 3)));
+        CHECK(Equal(deformed[1].Position, float3(1, 3, 3)));
+        CHECK(Equal(deformed[2].Position, float3(1, 2, 4)));
+
+        // Bounding box of the previous update is kept around
+        CHECK(Equal(set.PrevBounds(0).Center, float3(0.5f)));
+        CHECK(Equal(set.Bounds(0).Center, float3(1.5f, 2.5f, 3.5f)));
+    }
+
+    TEST_CASE("MorphTargets")
+    {
+        Vertex vertices[2];
+        vertices[0].Position = float3(0, 0, 0);
+        vertices[1].Position = float3(1, 1, 1);
+
+        for (auto& v : vertices)
+        {
+            v.Normal = oct32(0, 0, 1);
+            v.Tangent = oct32(1, 0, 0);
+        }
+
+        // Two targets
+        float3 deltas[4] = { float3(1, 0, 0), float3(0, 1, 0), float3(0, 0, 2), float3(0, 0, 0) };
+        float weights[2] = { 0.5f, 0.0f };
+        // Weights animation with two keys
+        float keyTimes[2] = { 0.0f, 1.0f };
+        float keys[4] = { 0.0f, 0.0f, 1.0f, 0.5f };
+
+        SkinnedMeshSet set;
+        set.Add(SkinnedMeshDesc{
+            .InstanceID = 1,
+            .Vertices = Span(vertices, 2),
+            .MorphPositionDeltas = Span(deltas, 4),
+            .MorphWeights = Span(weights, 2) });
+
+        set.Add(SkinnedMeshDesc{
+            .InstanceID = 2,
+            .Vertices = Span(vertices, 2),
+            .MorphPositionDeltas = Span(deltas, 4),
+            .MorphWeights = Span(weights, 2),
+            .MorphWeightKeyTimes = Span(keyTimes, 2),
+            .MorphWeightKeys = Span(keys, 4) });
+
+        CHECK(set.NumJoints(0) == 0);
+
+        set.Deform(0);
+        auto deformed = set.DeformedVertices(0);
+        CHECK(Equal(deformed[0].Position, float3(0.5f, 0, 0)));
+        CHECK(Equal(deformed[1].Position, float3(1, 1.5f, 1)));
+
+        // Halfway through -> weights = (0.5, 0.25)
+        set.UpdateMorphWeights(1, 0.5f);
+        set.Deform(1);
+        deformed = set.DeformedVertices(1);
+        CHECK(Equal(deformed[0].Position, float3(0.5f, 0, 0.5f)));
+        CHECK(Equal(deformed[1].Position, float3(1, 1.5f, 1)));
+
+        // Animation loops
+        set.UpdateMorphWeights(1, 1.25f);
+        set.Deform(1);
+        deformed = set.DeformedVertices(1);
+        CHECK(Equal(deformed[0].Position, float3(0.25f, 0, 0.25f)));
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        constexpr int NUM_MESHES = 64;
+        constexpr int NUM_VERTICES = 16 * 1024;
+        constexpr int NUM_JOINTS = 64;
+        constexpr int NUM_ITERATIONS = 20;
+
+        RNG rng(29);
+        SmallVector<Vertex> vertices;
+        SmallVector<VertexSkin> skin;
+        vertices.resize(NUM_VERTICES);
+        skin.resize(NUM_VERTICES);
+
+        uint64_t jointIDs[NUM_JOINTS];
+        float4x4a inverseBinds[NUM_JOINTS];
+        float4x3 jointToWorlds[NUM_JOINTS];
+
+        for (int j = 0; j < NUM_JOINTS; j++)
+        {
+            jointIDs[j] = j;
+            inverseBinds[j] = float4x4a(RandomTransform(rng));
+            jointToWorlds[j] = RandomTransform(rng);
+        }
+
+        SkinnedMeshSet set;
+
+        for (int m = 0; m < NUM_MESHES; m++)
+        {
+            RandomVertices(rng, NUM_VERTICES, vertices.data());
+            RandomSkin(rng, NUM_VERTICES, NUM_JOINTS, skin.data());
+
+            set.Add(SkinnedMeshDesc{
+                .InstanceID = (uint64_t)m,
+                .Vertices = vertices,
+                .Skin = skin,
+                .JointIDs = Span(jointIDs, NUM_JOINTS),
+                .InverseBindMatrices = Span(inverseBinds, NUM_JOINTS) });
+        }
+
+        const float4x3 meshToWorld = float4x3(store(identity()));
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < NUM_ITERATIONS; i++)
+        {
+            for (int m = 0; m < NUM_MESHES; m++)
+            {
+                set.UpdateJointMatrices(m, meshToWorld, Span(jointToWorlds, NUM_JOINTS));
+                set.Deform(m);
+            }
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        const double s = std::chrono::duration<double>(end - start).count();
+        const double numVertices = double(NUM_MESHES) * NUM_VERTICES * NUM_ITERATIONS;
+
+        MESSAGE("Skinned ", numVertices / s / 1e6, " M vertices/s (single thread)");
+    }
+}
\ No newline at end of file
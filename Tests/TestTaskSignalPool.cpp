@@ -0,0 +1,171 @@
+#include <Support/TaskSignalPool.h>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    void SleepMs(int ms)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+TEST_SUITE("TaskSignalPool")
+{
+    TEST_CASE("Growth")
+    {
+        auto pool = std::make_unique<TaskSignalPool>();
+        CHECK(pool->Capacity() == 0);
+
+        constexpr int N = TaskSignalPool::PAGE_SIZE * 2 + 1;
+        for (int i = 0; i < N; i++)
+            CHECK(pool->Register("Task") == i);
+
+        CHECK(pool->NumRegistered() == N);
+        CHECK(pool->Capacity() == TaskSignalPool::PAGE_SIZE * 3);
+
+        // Tasks without dependencies never block
+        pool->Wait(N - 1);
+        pool->Reset();
+
+        CHECK(pool->NumRegistered() == 0);
+        CHECK(pool->GetFrameStats().NumTasks == N);
+        CHECK(pool->GetFrameStats().NumBlocked == 0);
+        CHECK(pool->GetFrameStats().NumStalls == 0);
+
+        // Pages are kept for the next frame
+        CHECK(pool->Register("Task") == 0);
+        CHECK(pool->Capacity() == TaskSignalPool::PAGE_SIZE * 3);
+    }
+
+    TEST_CASE("ConcurrentRegister")
+    {
+        auto pool = std::make_unique<TaskSignalPool>();
+        constexpr int NUM_THREADS = 8;
+        constexpr int NUM_TASKS = 300;
+        std::thread threads[NUM_THREADS];
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads[t] = std::thread([&pool]()
+                {
+                    for (int i = 0; i < NUM_TASKS; i++)
+                        pool->Register("Task");
+                });
+        }
+
+        for (int t = 0; t < NUM_THREADS; t++)
+            threads[t].join();
+
+        CHECK(pool->NumRegistered() == NUM_THREADS * NUM_TASKS);
+        CHECK(pool->Capacity() >= NUM_THREADS * NUM_TASKS);
+    }
+
+    TEST_CASE("WaitSignal")
+    {
+        auto pool = std::make_unique<TaskSignalPool>();
+        const int a = pool->Register("A");
+        const int b = pool->Register("B");
+        const int c = pool->Register("C");
+        pool->Finalize(c, 2);
+
+        int order[3] = { -1, -1, -1 };
+        std::atomic_int32_t next = 0;
+
+        std::thread waiter([&]()
+            {
+                pool->Wait(c);
+                order[next.fetch_add(1)] = c;
+            });
+
+        // Dependencies finish while C's thread is parked
+        SleepMs(10);
+        order[next.fetch_add(1)] = a;
+        pool->Signal(Span<int>(&c, 1));
+        SleepMs(10);
+        order[next.fetch_add(1)] = b;
+        pool->Signal(Span<int>(&c, 1));
+
+        waiter.join();
+
+        CHECK(order[0] == a);
+        CHECK(order[1] == b);
+        CHECK(order[2] == c);
+
+        pool->Reset();
+        const TaskSignalStats& stats = pool->GetFrameStats();
+        CHECK(stats.NumTasks == 3);
+        CHECK(stats.NumBlocked == 1);
+        CHECK(stats.BlockedMs >= 15.0f);
+        REQUIRE(stats.NumStalls == 1);
+        CHECK(strcmp(stats.Stalls[0].Name, "C") == 0);
+        CHECK(stats.Stalls[0].BlockedMs == stats.BlockedMs);
+    }
+
+    TEST_CASE("SignalBeforeWait")
+    {
+        auto pool = std::make_unique<TaskSignalPool>();
+        const int a = pool->Register("A");
+        pool->Finalize(a, 1);
+        pool->Signal(Span<int>(&a, 1));
+
+        // Already ready, returns without blocking
+        pool->Wait(a);
+        pool->Reset();
+        CHECK(pool->GetFrameStats().NumBlocked == 0);
+    }
+
+    TEST_CASE("Batches")
+    {
+        auto pool = std::make_unique<TaskSignalPool>();
+        constexpr int N = 100;
+        int handles[N];
+
+        for (int i = 0; i < N; i++)
+        {
+            char name[16];
+            snprintf(name, sizeof(name), "Task%d", i);
+            handles[i] = pool->Register(name);
+            pool->Finalize(handles[i], 2);
+        }
+
+        std::thread threads[N];
+        for (int i = 0; i < N; i++)
+            threads[i] = std::thread([&pool, &handles, i]() { pool->Wait(handles[i]); });
+
+        SleepMs(10);
+        // The first call only decrements, the second one makes every task ready
+        pool->Signal(Span<int>(handles, N));
+        SleepMs(10);
+        pool->Signal(Span<int>(handles, N));
+
+        for (int i = 0; i < N; i++)
+            threads[i].join();
+
+        pool->Reset();
+        const TaskSignalStats& stats = pool->GetFrameStats();
+        CHECK(stats.NumTasks == N);
+        CHECK(stats.NumBlocked == N);
+        REQUIRE(stats.NumStalls == TaskSignalStats::MAX_NUM_STALLS);
+
+        bool sorted = true;
+        for (int i = 1; i < stats.NumStalls; i++)
+            sorted = sorted && stats.Stalls[i - 1].BlockedMs >= stats.Stalls[i].BlockedMs;
+
+        CHECK(sorted);
+        CHECK(stats.Stalls[0].BlockedMs >= 10.0f);
+
+        // Stats are per frame
+        pool->Register("Task");
+        pool->Reset();
+        CHECK(pool->GetFrameStats().NumTasks == 1);
+        CHECK(pool->GetFrameStats().NumBlocked == 0);
+        CHECK(pool->GetFrameStats().NumStalls == 0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include <Scene/TextureStreaming.h>
+#include <App/Filesystem.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Scene::Streaming;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    DDSTextureDesc BC7Desc(uint32_t width, uint32_t height)
+    {
+        uint16_t mipCount = 1;
+        while ((width >> mipCount) > 0 || (height >> mipCount) > 0)
+            mipCount++;
+
+        return DDSTextureDesc{ .Width = width,
+            .Height = height,
+            .MipCount = mipCount,
+            .BlockSize = 16,
+            .DataOffset = 128 };
+    }
+
+    void CompleteAll(MipScheduler& s, Span<MipScheduler::MipLoad> loads, double time)
+    {
+        for (auto& l : loads)
+            s.OnLoaded(l.Texture, time);
+    }
+}
+
+TEST_SUITE("TextureStreaming")
+{
+    TEST_CASE("TailFirst")
+    {
+        MipScheduler s;
+        s.Init(16, 128);
+
+        for (int i = 0; i < 3; i++)
+            s.AddTexture(BC7Desc(2048, 2048));
+
+        // 2048 >> 4 = 128
+        CHECK(s.FirstTailMip(0) == 4);
+        CHECK(!s.IsRenderable(0));
+        CHECK(s.ResidentMip(0) == 12);
+
+        SmallVector<MipScheduler::MipLoad> loads;
+        s.Schedule(0.0, UINT64_MAX, loads);
+
+        // Only the tails, even though the budget would allow for more
+        REQUIRE(loads.size() == 3);
+        const auto& desc = s.GetDesc(0);
+
+        for (auto& l : loads)
+        {
+            CHECK(l.FirstMip == 4);
+            CHECK(l.LastMip == 11);
+            CHECK(l.Offset == desc.MipOffset(4));
+            CHECK(l.Size == desc.MipOffset(12) - desc.MipOffset(4));
+        }
+
+        // Nothing else until the tails are resident
+        loads.clear();
+        s.Schedule(0.5, UINT64_MAX, loads);
+        CHECK(loads.empty());
+        CHECK(s.GetStats().NumLoading == 3);
+
+        s.OnLoaded(0, 1.0);
+        s.OnLoaded(1, 1.0);
+        s.OnLoaded(2, 2.0);
+
+        auto stats = s.GetStats();
+        CHECK(stats.NumRenderable == 3);
+        CHECK(stats.TimeToRenderable == 2.0);
+        CHECK(stats.TimeToComplete < 0.0);
+        CHECK(stats.MaxLoadLatency == 2.0);
+        CHECK(stats.NumBytesLoaded == 3 * (desc.MipOffset(12) - desc.MipOffset(4)));
+        CHECK(stats.NumBytesInFlight == 0);
+
+        // Then one mip at a time, coarse to fine
+        for (uint32_t mip = 3; mip != UINT32_MAX; mip--)
+        {
+            loads.clear();
+            s.Schedule(3.0, UINT64_MAX, loads);
+            REQUIRE(loads.size() == 3);
+
+            for (auto& l : loads)
+            {
+                CHECK(l.FirstMip == mip);
+                CHECK(l.LastMip == mip);
+                CHECK(l.Size == desc.MipSize(mip));
+            }
+
+            CompleteAll(s, loads, 4.0);
+        }
+
+        stats = s.GetStats();
+        CHECK(stats.NumComplete == 3);
+        CHECK(stats.TimeToComplete == 4.0);
+
+        loads.clear();
+        s.Schedule(5.0, UINT64_MAX, loads);
+        CHECK(loads.empty());
+    }
+
+    TEST_CASE("SmallTexture")
+    {
+        MipScheduler s;
+        s.Init(4, 128);
+
+        // Whole texture is the tail
+        s.AddTexture(BC7Desc(64, 32));
+        CHECK(s.FirstTailMip(0) == 0);
+
+        SmallVector<MipScheduler::MipLoad> loads;
+        s.Schedule(0.0, 1, loads);
+        REQUIRE(loads.size() == 1);
+        CHECK(loads[0].FirstMip == 0);
+        CHECK(loads[0].LastMip == 6);
+
+        CompleteAll(s, loads, 1.0);
+        CHECK(s.GetStats().NumComplete == 1);
+        CHECK(s.GetStats().TimeToComplete == 1.0);
+    }
+
+    TEST_CASE("PriorityAndBudget")
+    {
+        MipScheduler s;
+        s.Init(16, 128);
+
+        for (int i = 0; i < 4; i++)
+            s.AddTexture(BC7Desc(1024, 1024));
+
+        SmallVector<MipScheduler::MipLoad> loads;
+        s.Schedule(0.0, UINT64_MAX, loads);
+        CompleteAll(s, loads, 0.0);
+
+        const auto& desc = s.GetDesc(0);
+        CHECK(s.ResidentMip(0) == 3);
+
+        s.SetPriority(0, 0, 1.0f);
+        s.SetPriority(1, 0, 8.0f);
+        // Coarser desired mip, but otherwise the highest priority
+        s.SetPriority(2, 2, 10.0f);
+        s.SetPriority(3, 0, 4.0f);
+
+        // Budget for a bit more than two mip-2 loads. Keys are 3, 24, 10, and 12.
+        loads.clear();
+        s.Schedule(1.0, desc.MipSize(2) * 2 + 100, loads);
+        REQUIRE(loads.size() == 2);
+        CHECK(loads[0].Texture == 1);
+        CHECK(loads[1].Texture == 3);
+
+        // Budget is smaller than one load, yet one is always issued
+        loads.clear();
+        s.Schedule(1.0, 1, loads);
+        REQUIRE(loads.size() == 1);
+        CHECK(loads[0].Texture == 2);
+
+        CHECK(s.GetStats().NumBytesInFlight == 3 * desc.MipSize(2));
+
+        // Texture 2 is done after this load
+        s.OnLoaded(2, 2.0);
+        CHECK(s.GetStats().NumComplete == 1);
+
+        // Failed loads are retried
+        s.OnLoadFailed(1);
+        loads.clear();
+        s.Schedule(2.0, 1, loads);
+        REQUIRE(loads.size() == 1);
+        CHECK(loads[0].Texture == 1);
+        CHECK(loads[0].FirstMip == 2);
+
+        // Lowering the desired mip completes the texture
+        s.SetPriority(0, 3, 1.0f);
+        CHECK(s.GetStats().NumComplete == 2);
+    }
+
+    TEST_CASE("MaxLoadsInFlight")
+    {
+        MipScheduler s;
+        s.Init(3, 128);
+
+        for (int i = 0; i < 5; i++)
+            s.AddTexture(BC7Desc(512, 512));
+
+        SmallVector<MipScheduler::MipLoad> loads;
+        s.Schedule(0.0, UINT64_MAX, loads);
+        CHECK(loads.size() == 3);
+
+        loads.clear();
+        s.Schedule(0.0, UINT64_MAX, loads, 1);
+        CHECK(loads.empty());
+
+        s.OnLoaded(0, 1.0);
+        s.OnLoaded(1, 1.0);
+
+        // Remaining tails go before mips of texture 0 and 1
+        loads.clear();
+        s.Schedule(1.0, UINT64_MAX, loads, 1);
+        REQUIRE(loads.size() == 1);
+        CHECK(loads[0].Texture == 3);
+    }
+
+    TEST_CASE("Footprint")
+    {
+        auto desc = BC7Desc(1024, 1024);
+
+        CHECK(MipScheduler::DesiredMipFromFootprint(desc, 1024.0f * 1024.0f) == 0);
+        CHECK(MipScheduler::DesiredMipFromFootprint(desc, 4096.0f * 4096.0f) == 0);
+        CHECK(MipScheduler::DesiredMipFromFootprint(desc, 256.0f * 256.0f) == 2);
+        CHECK(MipScheduler::DesiredMipFromFootprint(desc, 0.0f) == 10);
+
+        // Halving the distance quadruples the area
+        const float a0 = MipScheduler::ScreenFootprint(1.0f, 10.0f, 1.0f, 1080);
+        const float a1 = MipScheduler::ScreenFootprint(1.0f, 5.0f, 1.0f, 1080);
+        CHECK(fabsf(a1 - a0 * 4.0f) < 1e-3f * a1);
+        CHECK(fabsf(a0 - PI * 54.0f * 54.0f) < 1e-3f * a0);
+    }
+
+    TEST_CASE("Random")
+    {
+        MipScheduler s;
+        s.Init(8, 64);
+        RNG rng(17);
+
+        constexpr int NUM_TEXTURES = 40;
+        for (int i = 0; i < NUM_TEXTURES; i++)
+        {
+            const uint32_t w = 1u << (4 + rng.UniformUintBounded(9));
+            const uint32_t h = 1u << (4 + rng.UniformUintBounded(9));
+            s.AddTexture(BC7Desc(w, h));
+        }
+
+        SmallVector<MipScheduler::MipLoad> inFlight;
+        SmallVector<MipScheduler::MipLoad> loads;
+        double time = 0.0;
+        int numIter = 0;
+
+        while (s.GetStats().NumComplete < NUM_TEXTURES)
+        {
+            REQUIRE(numIter++ < 10000);
+
+            for (int i = 0; i < 4; i++)
+            {
+                const uint32_t t = rng.UniformUintBounded(NUM_TEXTURES);
+                s.SetPriority(t, rng.UniformUintBounded(s.GetDesc(t).MipCount), rng.Uniform() * 100.0f);
+            }
+
+            loads.clear();
+            s.Schedule(time, 1024 * 1024, loads);
+            CHECK(s.GetStats().NumLoading <= 8);
+
+            for (auto& l : loads)
+            {
+                // Either the tail or the next finer mip
+                const uint32_t resident = s.ResidentMip(l.Texture);
+                if (resident == s.GetDesc(l.Texture).MipCount)
+                    CHECK(l.FirstMip == s.FirstTailMip(l.Texture));
+                else
+                {
+                    CHECK(s.IsRenderable(l.Texture));
+                    CHECK(l.FirstMip == resident - 1);
+                }
+
+                inFlight.push_back(l);
+            }
+
+            // Complete (or fail) about half of the loads in flight
+            for (size_t i = 0; i < inFlight.size();)
+            {
+                if (rng.UniformUintBounded(2))
+                {
+                    if (rng.UniformUintBounded(8) == 0)
+                        s.OnLoadFailed(inFlight[i].Texture);
+                    else
+                        s.OnLoaded(inFlight[i].Texture, time);
+
+                    inFlight[i] = inFlight.back();
+                    inFlight.pop_back();
+                }
+                else
+                    i++;
+            }
+
+            time += 1.0 / 60.0;
+        }
+
+        auto stats = s.GetStats();
+        CHECK(stats.NumRenderable == NUM_TEXTURES);
+        CHECK(stats.TimeToRenderable >= 0.0);
+        CHECK(stats.TimeToComplete >= stats.TimeToRenderable);
+        CHECK(stats.AvgLoadLatency <= stats.MaxLoadLatency);
+    }
+
+    TEST_CASE("ReadMips")
+    {
+        auto desc = BC7Desc(64, 64);
+        SmallVector<uint8_t> file;
+        file.resize(desc.MipOffset(desc.MipCount));
+
+        for (size_t i = 0; i < file.size(); i++)
+            file[i] = uint8_t(i * 7 + 3);
+
+        const char* path = "TestTextureStreaming.bin";
+        App::Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+
+        void* f = App::Filesystem::OpenFileForRead(path);
+        REQUIRE(f);
+
+        MipScheduler::MipLoad load{ .Texture = 0,
+            .FirstMip = 2,
+            .LastMip = 6,
+            .Offset = desc.MipOffset(2),
+            .Size = desc.MipOffset(7) - desc.MipOffset(2) };
+
+        SmallVector<uint8_t> data;
+        CHECK(MipStreamer::ReadMips(f, load, data));
+        REQUIRE(data.size() == load.Size);
+        CHECK(memcmp(data.data(), file.data() + load.Offset, load.Size) == 0);
+
+        // Past the end of file
+        load.Offset = file.size() - 8;
+        CHECK(!MipStreamer::ReadMips(f, load, data));
+
+        App::Filesystem::CloseFile(f);
+        App::Filesystem::RemoveFile(path);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include <RayTracing/TwoLevelBVH.h>
+#include <App/Headless.h>
+#include <Utility/RNG.h>
+#include <doctest/doctest.h>
+#include <chrono>
+#include <thread>
+
+using namespace ZetaRay;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    struct TestMesh
+    {
+        SmallVector<float3> Vertices;
+        SmallVector<uint32_t> Indices;
+    };
+
+    float3 RandomDir(RNG& rng)
+    {
+        const float z = 1.0f - 2.0f * rng.Uniform();
+        const float r = sqrtf(Max(1.0f - z * z, 0.0f));
+        const float phi = TWO_PI * rng.Uniform();
+
+        return float3(r * cosf(phi), r * sinf(phi), z);
+    }
+
+    // Random triangle soup inside the unit cube with shared vertices
+    void RandomMesh(RNG& rng, uint32_t numTris, TestMesh& mesh)
+    {
+        const uint32_t numVertices = numTris + 2;
+
+        for (uint32_t i = 0; i < numVertices; i++)
+            mesh.Vertices.push_back(float3(rng.Uniform(), rng.Uniform(), rng.Uniform()));
+
+        for (uint32_t t = 0; t < numTris; t++)
+        {
+            const uint32_t i0 = rng.UniformUintBounded(numVertices);
+            const float3 v0 = mesh.Vertices[i0];
+
+            // Keep triangles small relative to the mesh
+            uint32_t i1 = i0;
+            uint32_t i2 = i0;
+            for (int attempt = 0; attempt < 32 && (i1 == i0 || (mesh.Vertices[i1] - v0).length() > 0.3f); attempt++)
+                i1 = rng.UniformUintBounded(numVertices);
+            for (int attempt = 0; attempt < 32 && (i2 == i0 || i2 == i1 || (mesh.Vertices[i2] - v0).length() > 0.3f); attempt++)
+                i2 = rng.UniformUintBounded(numVertices);
+
+            mesh.Indices.push_back(i0);
+            mesh.Indices.push_back(i1);
+            mesh.Indices.push_back(i2);
+        }
+    }
+
+    // Rotation about a random axis (Rodrigues' formula), non-uniform scale and translation
+    float4x3 RandomTransform(RNG& rng, float extent)
+    {
+        const float3 axis = RandomDir(rng);
+        const float theta = TWO_PI * rng.Uniform();
+        const float c = cosf(theta);
+        const float s = sinf(theta);
+        const float3 scale(0.5f + 1.5f * rng.Uniform(), 0.5f + 1.5f * rng.Uniform(), 0.5f + 1.5f * rng.Uniform());
+
+        float3 rows[3];
+        const float3 e[3] = { float3(1, 0, 0), float3(0, 1, 0), float3(0, 0, 1) };
+
+        for (int i = 0; i < 3; i++)
+        {
+            float3 r = e[i] * c + axis.cross(e[i]) * s + axis * (axis.dot(e[i]) * (1.0f - c));
+            rows[i] = r * (i == 0 ? scale.x : (i == 1 ? scale.y : scale.z));
+        }
+
+        const float3 t(rng.Uniform() * extent, rng.Uniform() * extent, rng.Uniform() * extent);
+
+        return float4x3(rows[0], rows[1], rows[2], t);
+    }
+
+    float3 TransformPoint(const float4x3& M, const float3& p)
+    {
+        return M.m[0] * p.x + M.m[1] * p.y + M.m[2] * p.z + M.m[3];
+    }
+
+    // World-space triangles of every instance, in instance order
+    void Flatten(const SmallVector<TestMesh>& meshes, const SmallVector<uint32_t>& instanceMesh,
+        const SmallVector<float4x3>& transforms, SmallVector<float3>& positions)
+    {
+        positions.clear();
+
+        for (size_t i = 0; i < instanceMesh.size(); i++)
+        {
+            const TestMesh& mesh = meshes[instanceMesh[i]];
+
+            for (auto idx : mesh.Indices)
+                positions.push_back(TransformPoint(transforms[i], mesh.Vertices[idx]));
+        }
+    }
+
+    struct TestScene
+    {
+        SmallVector<TestMesh> Meshes;
+        SmallVector<uint32_t> InstanceMesh;
+        SmallVector<float4x3> Transforms;
+    };
+
+    void RandomScene(RNG& rng, int numMeshes, int numInstances, uint32_t maxTrisPerMesh, float extent,
+        TestScene& scene, TwoLevelBVH& bvh)
+    {
+        scene.Meshes.resize(numMeshes);
+
+        for (int m = 0; m < numMeshes; m++)
+        {
+            RandomMesh(rng, 1 + rng.UniformUintBounded(maxTrisPerMesh), scene.Meshes[m]);
+            bvh.AddMesh(scene.Meshes[m].Vertices.data(), sizeof(float3),
+                (uint32_t)scene.Meshes[m].Vertices.size(), scene.Meshes[m].Indices);
+        }
+
+        for (int i = 0; i < numInstances; i++)
+        {
+            const uint32_t mesh = rng.UniformUintBounded(numMeshes);
+            const float4x3 M = RandomTransform(rng, extent);
+            scene.InstanceMesh.push_back(mesh);
+            scene.Transforms.push_back(M);
+            bvh.AddInstance(mesh, M, 1000 + i);
+        }
+    }
+
+    // Compares closest hits against a single BVH over world-space triangles. Returns
+    // number of rays that hit something.
+    int CompareWithFlattened(RNG& rng, const TestScene& scene, const TwoLevelBVH& bvh, float extent,
+        int numRays)
+    {
+        SmallVector<float3> positions;
+        Flatten(scene.Meshes, scene.InstanceMesh, scene.Transforms, positions);
+
+        TriangleBVH ref;
+        ref.Build(positions);
+
+        // Flattened triangle index of first triangle of every instance
+        SmallVector<uint32_t> instanceTriOffset;
+        uint32_t offset = 0;
+        for (auto m : scene.InstanceMesh)
+        {
+            instanceTriOffset.push_back(offset);
+            offset += (uint32_t)scene.Meshes[m].Indices.size() / 3;
+        }
+
+        int numHits = 0;
+
+        for (int i = 0; i < numRays; i++)
+        {
+            const float3 origin(rng.Uniform() * (extent + 4.0f) - 2.0f, rng.Uniform() * (extent + 4.0f) - 2.0f,
+                rng.Uniform() * (extent + 4.0f) - 2.0f);
+            const Ray ray(origin, RandomDir(rng));
+
+            TriangleHit hitRef;
+            const bool foundRef = ref.Intersect(ray, FLT_MAX, hitRef);
+
+            TwoLevelHit hit;
+            const bool found = bvh.Intersect(ray, FLT_MAX, hit);
+
+            // Transforming to object space changes rounding, hits close to triangle edges
+            // can go either way
+            if ((foundRef && Min(Min(hitRef.U, hitRef.V), 1.0f - hitRef.U - hitRef.V) < 1e-4f) ||
+                (found && Min(Min(hit.U, hit.V), 1.0f - hit.U - hit.V) < 1e-4f))
+            {
+                continue;
+            }
+
+            REQUIRE(found == foundRef);
+            REQUIRE(bvh.Occluded(ray, FLT_MAX) == found);
+
+            if (found)
+            {
+                numHits++;
+                CHECK(fabsf(hit.T - hitRef.T) <= 1e-3f * Max(hitRef.T, 1.0f));
+                CHECK(hit.InstanceID == 1000 + hit.Instance);
+                CHECK(hit.Mesh == scene.InstanceMesh[hit.Instance]);
+
+                const bool sameTri = instanceTriOffset[hit.Instance] + hit.Tri == hitRef.Tri;
+                CHECK((sameTri || fabsf(hit.T - hitRef.T) <= 1e-4f * Max(hitRef.T, 1.0f)));
+
+                if (sameTri)
+                {
+                    CHECK(fabsf(hit.U - hitRef.U) < 1e-3f);
+                    CHECK(fabsf(hit.V - hitRef.V) < 1e-3f);
+                }
+
+                CHECK(!bvh.Occluded(ray, hit.T * 0.999f));
+            }
+        }
+
+        return numHits;
+    }
+}
+
+TEST_SUITE("TwoLevelBVH")
+{
+    TEST_CASE("MatchesFlattenedBVH")
+    {
+        // Build() runs on the worker threads
+        App::Headless::Init({ .NumWorkerThreads = 3, .Pinning = Support::THREAD_PINNING::NONE });
+
+        RNG rng(11);
+        const float extent = 20.0f;
+        TestScene scene;
+        TwoLevelBVH bvh;
+        RandomScene(rng, 8, 200, 300, extent, scene, bvh);
+        bvh.Build();
+
+        CHECK(bvh.NumMeshes() == 8);
+        CHECK(bvh.NumInstances() == 200);
+
+        const int numHits = CompareWithFlattened(rng, scene, bvh, extent, 2000);
+        CHECK(numHits > 200);
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("Refit")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = Support::THREAD_PINNING::NONE });
+
+        RNG rng(13);
+        const float extent = 20.0f;
+        TestScene scene;
+        TwoLevelBVH bvh;
+        RandomScene(rng, 4, 100, 200, extent, scene, bvh);
+        bvh.Build();
+
+        // Move half of the instances
+        for (uint32_t i = 0; i < bvh.NumInstances(); i += 2)
+        {
+            scene.Transforms[i] = RandomTransform(rng, extent);
+            bvh.SetTransform(i, scene.Transforms[i]);
+        }
+
+        const uint32_t numNodes = bvh.NumTLASNodes();
+        bvh.Refit();
+        CHECK(bvh.NumTLASNodes() == numNodes);
+
+        const int numHits = CompareWithFlattened(rng, scene, bvh, extent, 2000);
+        CHECK(numHits > 100);
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("ParallelBLASMatchesSerial")
+    {
+        App::Headless::Init({ .NumWorkerThreads = 2, .Pinning = Support::THREAD_PINNING::NONE });
+
+        RNG rng(17);
+        TestScene scene;
+        TwoLevelBVH serial;
+        RandomScene(rng, 6, 6, 2000, 10.0f, scene, serial);
+        serial.Build();
+
+        TwoLevelBVH parallel;
+        for (auto& mesh : scene.Meshes)
+        {
+            parallel.AddMesh(mesh.Vertices.data(), sizeof(float3), (uint32_t)mesh.Vertices.size(),
+                mesh.Indices);
+        }
+        for (size_t i = 0; i < scene.Transforms.size(); i++)
+            parallel.AddInstance(scene.InstanceMesh[i], scene.Transforms[i], 1000 + i);
+
+        std::thread threads[6];
+        for (uint32_t i = 0; i < 6; i++)
+            threads[i] = std::thread([&parallel, i]() { parallel.BuildBLAS(i); });
+        for (auto& t : threads)
+            t.join();
+
+        parallel.BuildTLAS();
+
+        for (uint32_t m = 0; m < 6; m++)
+        {
+            CHECK(parallel.BLAS(m).NumNodes() == serial.BLAS(m).NumNodes());
+            CHECK(parallel.BLAS(m).NumTriangles() == serial.BLAS(m).NumTriangles());
+        }
+
+        CHECK(parallel.NumTLASNodes() == serial.NumTLASNodes());
+        CHECK(parallel.NumInstancedTriangles() == serial.NumInstancedTriangles());
+
+        App::Headless::Shutdown();
+    }
+
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        RNG rng(19);
+        const float extent = 100.0f;
+        TestScene scene;
+        TwoLevelBVH bvh;
+        RandomScene(rng, 32, 2000, 20'000, extent, scene, bvh);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t m = 0; m < bvh.NumMeshes(); m++)
+            bvh.BuildBLAS(m);
+        bvh.BuildTLAS();
+        auto end = std::chrono::high_resolution_clock::now();
+        const double buildMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        constexpr int NUM_RAYS = 1'000'000;
+        SmallVector<Ray> rays;
+        rays.reserve(NUM_RAYS);
+
+        for (int i = 0; i < NUM_RAYS; i++)
+        {
+            const float3 origin(rng.Uniform() * extent, rng.Uniform() * extent, rng.Uniform() * extent);
+            rays.push_back(Ray(origin, RandomDir(rng)));
+        }
+
+        auto trace = [&bvh, &rays](int begin, int end, int& numHits)
+            {
+                numHits = 0;
+
+                for (int i = begin; i < end; i++)
+                {
+                    TwoLevelHit hit;
+                    numHits += bvh.Intersect(rays[i], FLT_MAX, hit);
+                }
+            };
+
+        int numHits;
+        start = std::chrono::high_resolution_clock::now();
+        trace(0, NUM_RAYS, numHits);
+        end = std::chrono::high_resolution_clock::now();
+        const double serialSec = std::chrono::duration<double>(end - start).count();
+
+        const int numThreads = (int)Max(std::thread::hardware_concurrency(), 1u);
+        SmallVector<std::thread> threads;
+        SmallVector<int> threadHits;
+        threadHits.resize(numThreads);
+        const int raysPerThread = (NUM_RAYS + numThreads - 1) / numThreads;
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numThreads; i++)
+        {
+            threads.emplace_back(trace, i * raysPerThread, Min((i + 1) * raysPerThread, NUM_RAYS),
+                std::ref(threadHits[i]));
+        }
+        for (auto& t : threads)
+            t.join();
+        end = std::chrono::high_resolution_clock::now();
+        const double parallelSec = std::chrono::duration<double>(end - start).count();
+
+        MESSAGE(bvh.NumInstancedTriangles(), " instanced triangles, BLAS + TLAS build ", buildMs, " [ms], ",
+            numHits, " hits");
+        MESSAGE("Closest hit: 1 thread ", NUM_RAYS / serialSec * 1e-6, " [Mrays/s], ", numThreads, " threads ",
+            NUM_RAYS / parallelSec * 1e-6, " [Mrays/s]");
+    }
+}
\ No newline at end of file
@@ -3,7 +3,14 @@
 #include <Support/MemoryArena.h>
 #include <algorithm>
 #include <Utility/Utility.h>
-#include "TexConv/texconv.h"
+#include <Utility/HashTable.h>
+#include <Core/dds.h>
+#include "MipGenerator.h"
+#include <xxHash/xxhash.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -12,14 +19,21 @@
 #define CGLTF_WRITE_IMPLEMENTATION
 #include <cgltf/cgltf_write.h>
 
+#ifdef _WIN32
+#include "TexConv/texconv.h"
 #include <wrl/client.h>
 using Microsoft::WRL::ComPtr;
+#else
+// Only the CPU path is available
+struct ID3D11Device;
+#endif
 
 using namespace ZetaRay;
 using namespace ZetaRay::App;
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Support;
 using namespace ZetaRay::Math;
+using namespace ZetaRay::Core::Direct3DUtil;
 
 namespace
 {
@@ -28,47 +42,37 @@ namespace
 
     static constexpr int DEFAULT_MAX_TEX_RES = 4096;
     static constexpr const char* COMPRESSED_DIR_NAME = "compressed";
+    static constexpr const char* MANIFEST_NAME = "manifest.txt";
 
-    namespace TEX_CONV_ARGV_NO_OVERWRITE_SRGB
-    {
-        static const char* CMD = " -w %d -h %d -m 0 -ft dds -f %s -srgb -nologo -o %s %s";
-        constexpr int NUM_ARGS = 16;
-    };
+#ifdef _WIN32
+    // DirectXTex expects backslashes
+    static constexpr bool USE_BACKSLASH = true;
+#else
+    static constexpr bool USE_BACKSLASH = false;
+#endif
 
-    namespace TEX_CONV_ARGV_OVERWRITE_SRGB
+#ifdef _WIN32
+    namespace TEX_CONV_ARGV_SRGB
     {
         static const char* CMD = " -w %d -h %d -m 0 -ft dds -f %s -srgb -nologo -y -o %s %s";
         constexpr int NUM_ARGS = 17;
     }
 
-    namespace TEX_CONV_ARGV_NO_OVERWRITE
-    {
-        static const char* CMD = " -w %d -h %d -m 0 -ft dds -f %s -nologo -o %s %s";
-        constexpr int NUM_ARGS = 15;
-    }
-
-    namespace TEX_CONV_ARGV_OVERWRITE
+    namespace TEX_CONV_ARGV
     {
         static const char* CMD = " -w %d -h %d -m 0 -ft dds -f %s -nologo -y -o %s %s";
         constexpr int NUM_ARGS = 16;
     }
 
-    namespace TEX_CONV_ARGV_NO_OVERWRITE_SWIZZLE
-    {
-        static const char* CMD = " -w %d -h %d -m 0 -ft dds -f %s -nologo -swizzle bg -o %s %s";
-        constexpr int NUM_ARGS = 17;
-    }
-
-    namespace TEX_CONV_ARGV_OVERWRITE_SWIZZLE
+    namespace TEX_CONV_ARGV_SWIZZLE
     {
         static const char* CMD = " -w %d -h %d -m 0 -ft dds -f %s -nologo -swizzle bg -y -o %s %s";
         constexpr int NUM_ARGS = 18;
     }
 
-    static constexpr int MAX_NUM_ARGS = Max(
-        Max(TEX_CONV_ARGV_NO_OVERWRITE_SRGB::NUM_ARGS, TEX_CONV_ARGV_OVERWRITE_SRGB::NUM_ARGS),
-        Max(Max(TEX_CONV_ARGV_NO_OVERWRITE::NUM_ARGS, TEX_CONV_ARGV_OVERWRITE::NUM_ARGS),
-            Max(TEX_CONV_ARGV_NO_OVERWRITE_SWIZZLE::NUM_ARGS, TEX_CONV_ARGV_OVERWRITE_SWIZZLE::NUM_ARGS)));
+    static constexpr int MAX_NUM_ARGS = Max(TEX_CONV_ARGV_SRGB::NUM_ARGS, 
+        Max(TEX_CONV_ARGV::NUM_ARGS, TEX_CONV_ARGV_SWIZZLE::NUM_ARGS));
+#endif
 
     enum TEXTURE_TYPE
     {
@@ -78,6 +82,7 @@ namespace
         EMISSIVE
     };
 
+#ifdef _WIN32
     const char* GetTexFormat(TEXTURE_TYPE t)
     {
         switch (t)
@@ -95,6 +100,7 @@ namespace
             return "";
         }
     }
+#endif
 
     ZetaInline void DecodeURI_Inplace(ArenaPathNoInline& str, MemoryArena& arena)
     {
@@ -183,14 +189,15 @@ namespace
 
             DecodeURI_Inplace(imgPath, arena);
 
-            // DirectXTex expects backslashes
-            imgPath.ConvertToBackslashes();
+            if (USE_BACKSLASH)
+                imgPath.ConvertToBackslashes();
             // Modify to decoded path
             Assert(!imgPath.HasInlineStorage(), "Bug");
             model.images[i].uri = imgPath.Get();
         }
     }
 
+#ifdef _WIN32
     void CreateDevice(ID3D11Device** pDevice)
     {
         Assert(pDevice, "invalid arg.");
@@ -229,32 +236,215 @@ namespace
             }
         }
     }
+#endif
+
+    BCn::FORMAT GetBCnFormat(TEXTURE_TYPE t)
+    {
+        return (t == BASE_COLOR || t == EMISSIVE) ? BCn::FORMAT::BC7 : BCn::FORMAT::BC5;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Manifest
+    //--------------------------------------------------------------------------------------
 
-    bool ConvertTextures(TEXTURE_TYPE texType, const ArenaPath& glTFPath, 
-        const ArenaPath& compressedDir, const char* compressedDirName,
-        cgltf_data& model, Span<int> textureMaps, MemoryArena& arena, ID3D11Device* device, 
-        bool srgb, bool forceOverwrite, int maxRes, Span<int> toSkip)
+    // Records the source-content hash and the settings that each compressed texture in the
+    // output directory was built from, so that only textures whose source or settings have
+    // changed are rebuilt. One line per texture: <content hash> <settings hash> <dds file name>.
+    struct Manifest
     {
-        const char* formatStr = srgb ?
-            (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SRGB::CMD : TEX_CONV_ARGV_NO_OVERWRITE_SRGB::CMD) :
-            (texType == METALNESS_ROUGHNESS ?
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SWIZZLE::CMD : TEX_CONV_ARGV_NO_OVERWRITE_SWIZZLE::CMD) :
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE::CMD : TEX_CONV_ARGV_NO_OVERWRITE::CMD));
+        struct Entry
+        {
+            uint64_t ContentHash;
+            uint64_t SettingsHash;
+            // Location of the name in Names
+            uint32_t NameOffset;
+            uint32_t NameLength;
+        };
+
+        void Load(const char* path)
+        {
+            if (!Filesystem::Exists(path))
+                return;
+
+            SmallVector<uint8_t> data;
+            Filesystem::LoadFromFile(path, data);
+
+            const char* curr = reinterpret_cast<const char*>(data.data());
+            const char* end = curr + data.size();
+
+            while (curr < end)
+            {
+                const char* lineEnd = curr;
+                while (lineEnd < end && *lineEnd != '\n')
+                    lineEnd++;
+
+                // 16 hex digits, space, 16 hex digits, space, at least one character
+                if (lineEnd - curr > 34)
+                {
+                    char* numEnd;
+                    const uint64_t contentHash = strtoull(curr, &numEnd, 16);
+                    const bool valid1 = numEnd == curr + 16;
+                    const uint64_t settingsHash = strtoull(curr + 17, &numEnd, 16);
+                    const bool valid2 = numEnd == curr + 33;
+
+                    if (valid1 && valid2)
+                    {
+                        const char* name = curr + 34;
+                        size_t len = lineEnd - name;
+                        if (len && name[len - 1] == '\r')
+                            len--;
+
+                        Set(StrView(name, len), contentHash, settingsHash);
+                    }
+                }
+
+                curr = lineEnd + 1;
+            }
+        }
+
+        void Save(const char* path)
+        {
+            SmallVector<char> text;
+            char line[40];
+
+            for (auto& e : Entries)
+            {
+                stbsp_snprintf(line, sizeof(line), "%016llx %016llx ", e.ContentHash, e.SettingsHash);
+                text.append_range(line, line + 34);
+
+                const char* name = Names.data() + e.NameOffset;
+                text.append_range(name, name + e.NameLength);
+                text.push_back('\n');
+            }
+
+            Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(text.data()), (uint32_t)text.size());
+        }
+
+        bool IsUpToDate(StrView name, uint64_t contentHash, uint64_t settingsHash) const
+        {
+            if (auto idx = Lookup.find(XXH3_64bits(name.data(), name.size())); idx)
+            {
+                const Entry& e = Entries[*idx.value()];
+                return e.ContentHash == contentHash && e.SettingsHash == settingsHash;
+            }
+
+            return false;
+        }
 
-        const int numArgs = srgb ?
-            (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SRGB::NUM_ARGS : TEX_CONV_ARGV_NO_OVERWRITE_SRGB::NUM_ARGS) :
-            (texType == METALNESS_ROUGHNESS ?
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SWIZZLE::NUM_ARGS : TEX_CONV_ARGV_NO_OVERWRITE_SWIZZLE::NUM_ARGS) :
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE::NUM_ARGS : TEX_CONV_ARGV_NO_OVERWRITE::NUM_ARGS));
+        void Set(StrView name, uint64_t contentHash, uint64_t settingsHash)
+        {
+            const uint64_t key = XXH3_64bits(name.data(), name.size());
+            if (auto idx = Lookup.find(key); idx)
+            {
+                Entry& e = Entries[*idx.value()];
+                e.ContentHash = contentHash;
+                e.SettingsHash = settingsHash;
 
-        const char* texFormat = GetTexFormat(texType);
+                return;
+            }
 
+            Lookup.insert_or_assign(key, Entries.size());
+            Entries.push_back(Entry{ .ContentHash = contentHash, .SettingsHash = settingsHash,
+                .NameOffset = (uint32_t)Names.size(), .NameLength = (uint32_t)name.size() });
+
+            Names.append_range(name.data(), name.data() + name.size());
+        }
+
+        // Entries from other glTF files that share the same output directory are preserved
+        SmallVector<Entry> Entries;
+        SmallVector<char> Names;
+        HashTable<size_t> Lookup;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Pipeline
+    //--------------------------------------------------------------------------------------
+
+    // Bump whenever the output of the CPU path changes so that existing textures are rebuilt
+    static constexpr uint32_t CPU_PIPELINE_VERSION = 2;
+
+    enum STAGE
+    {
+        READ_AND_HASH,
+        DECODE,
+        MIPMAP,
+        ENCODE,
+        WRITE,
+        COUNT
+    };
+
+    static constexpr const char* STAGE_NAMES[STAGE::COUNT] = { "Read & hash", "Decode", "Mipmap", "Encode", "Write" };
+    // Work is measured in megabytes for read & write and in megapixels otherwise
+    static constexpr const char* STAGE_UNITS[STAGE::COUNT] = { "MB/s", "MPixels/s", "MPixels/s", "MPixels/s", "MB/s" };
+
+    struct PipelineStats
+    {
+        void Add(STAGE s, std::chrono::high_resolution_clock::time_point start, uint64_t work)
+        {
+            auto end = std::chrono::high_resolution_clock::now();
+            Nanosec[s].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                std::memory_order_relaxed);
+            Work[s].fetch_add(work, std::memory_order_relaxed);
+        }
+
+        void Add(STAGE s, double sec, uint64_t work)
+        {
+            Nanosec[s].fetch_add((uint64_t)(sec * 1e9), std::memory_order_relaxed);
+            Work[s].fetch_add(work, std::memory_order_relaxed);
+        }
+
+        // Times are summed over all the threads, so throughput is per thread
+        void Report(double wallTimeSec)
+        {
+            printf("\n%-14s%12s%16s\n", "Stage", "Time [s]", "Throughput");
+
+            for (int s = 0; s < STAGE::COUNT; s++)
+            {
+                const double sec = Nanosec[s].load(std::memory_order_relaxed) * 1e-9;
+                const double work = Work[s].load(std::memory_order_relaxed) * 1e-6;
+                printf("%-14s%12.2f%12.2f %s\n", STAGE_NAMES[s], sec, work / Max(sec, 1e-9), STAGE_UNITS[s]);
+            }
+
+            printf("Total wall time: %.2f [s]\n", wallTimeSec);
+        }
+
+        std::atomic_uint64_t Nanosec[STAGE::COUNT] = {};
+        std::atomic_uint64_t Work[STAGE::COUNT] = {};
+    };
+
+    struct TextureJob
+    {
+        TEXTURE_TYPE Type;
+        int ImageIdx;
+        // Output dimensions of mip 0
+        int Width;
+        int Height;
+        const char* ImgPath;
+        const char* DDSPath;
+        // Points into DDSPath
+        const char* DDSFilename;
+        uint64_t SettingsHash;
+    };
+
+    // Creates one job for every distinct image. Paths are allocated from the arena here, so
+    // that worker threads don't need to touch it.
+    void CollectTextureJobs(TEXTURE_TYPE texType, const ArenaPath& glTFPath, const ArenaPath& compressedDir,
+        const cgltf_data& model, Span<int> textureMaps, Span<int> toSkip, MutableSpan<bool> seen, int maxRes,
+        bool useCpu, BCn::QUALITY quality, MipGen::FILTER mipFilter, MemoryArena& arena, 
+        SmallVector<TextureJob, ArenaAllocator>& jobs)
+    {
         for (auto tex : textureMaps)
         {
             auto idx = BinarySearch(toSkip, tex);
             if (idx != -1)
                 continue;
 
+            // Same image might be referenced by multiple materials
+            if (seen[tex])
+                continue;
+
+            seen[tex] = true;
+
             ArenaPath uriPath(model.images[tex].uri, arena);
 
             // URI paths are relative to gltf file
@@ -274,80 +464,314 @@ namespace
             filename[fnLen + 3] = 's';
             filename[fnLen + 4] = '\0';
 
-            ArenaPath ddsPath(compressedDir.GetView(), arena);
-            ddsPath.Append(filename.data());
+            ArenaPathNoInline ddsPath(compressedDir.GetView(), arena);
+            ddsPath.Append(filename.data(), USE_BACKSLASH);
 
-            if (forceOverwrite || !Filesystem::Exists(ddsPath.Get()))
-            {
-                Filesystem::Path imgPath(glTFPath.GetView());
-                imgPath.Directory();
-                imgPath.Append(model.images[tex].uri);
+            ArenaPathNoInline imgPath(glTFPath.GetView(), arena);
+            imgPath.Directory();
+            imgPath.Append(model.images[tex].uri, USE_BACKSLASH);
 
-                // DirectXTex expects backslashes
+            if (USE_BACKSLASH)
                 imgPath.ConvertToBackslashes();
 
-                int x;
-                int y;
-                int comp;
-                Check(stbi_info(imgPath.Get(), &x, &y, &comp), "stbi_info() for path %s failed: %s",
-                    imgPath.Get(), stbi_failure_reason());
-
-                int w = Min(x, maxRes);
-                int h = Min(y, maxRes);
-
-                // Direct3D requires BC image to be multiple of 4 in width & height
-                w = (int)AlignUp(w, 4);
-                h = (int)AlignUp(h, 4);
-
-                // Returns length without the null terminatir
-                const int len = stbsp_snprintf(nullptr, 0, formatStr, w, h, texFormat,
-                    compressedDir.GetView().data(), imgPath.Get());
-                // Now allocate a buffer large enough for the whole string plus
-                // null terminator
-                char* buffer = reinterpret_cast<char*>(arena.AllocateAligned(len + 1, 1));
-                stbsp_snprintf(buffer, len + 1, formatStr, w, h, texFormat,
-                    compressedDir.GetView().data(), imgPath.Get());
-
-                int wideStrLen = Common::CharToWideStrLen(buffer);
-                wchar_t* wideBuffer = reinterpret_cast<wchar_t*>(arena.AllocateAligned(wideStrLen));
-                Common::CharToWideStr(buffer, MutableSpan(wideBuffer, wideStrLen));
-
-                wchar_t* ptr = wideBuffer;
-                wchar_t* args[MAX_NUM_ARGS];
-                int currArg = 0;
-
-                while (ptr != wideBuffer + wideStrLen)
-                {
-                    args[currArg] = ptr;
+            int x;
+            int y;
+            int comp;
+            Check(stbi_info(imgPath.Get(), &x, &y, &comp), "stbi_info() for path %s failed: %s",
+                imgPath.Get(), stbi_failure_reason());
+
+            int w = Min(x, maxRes);
+            int h = Min(y, maxRes);
+
+            // Direct3D requires BC image to be multiple of 4 in width & height
+            w = (int)AlignUp(w, 4);
+            h = (int)AlignUp(h, 4);
+
+            const uint32_t settings[] = { (uint32_t)texType, (uint32_t)w, (uint32_t)h, (uint32_t)useCpu,
+                useCpu ? (uint32_t)quality : 0, useCpu ? (uint32_t)mipFilter : 0, useCpu ? CPU_PIPELINE_VERSION : 0 };
+
+            jobs.push_back(TextureJob{ .Type = texType,
+                .ImageIdx = tex,
+                .Width = w,
+                .Height = h,
+                .ImgPath = imgPath.Get(),
+                .DDSPath = ddsPath.Get(),
+                .DDSFilename = ddsPath.Get() + strlen(ddsPath.Get()) - (fnLen + 4),
+                .SettingsHash = XXH3_64bits(settings, sizeof(settings)) });
+        }
+    }
 
-                    // spaces are valid for last argument (file path)
-                    while ((currArg == numArgs - 1 || *ptr != ' ') && *ptr != '\0')
-                        ptr++;
+    // Decodes the image, then generates and compresses the full mip chain in one streaming pass
+    // (see MipGen::GenerateAndEncode()) and writes the result as a DDS file that can be read by
+    // GpuMemory::GetTexture2DFromDisk().
+    bool CompressTextureCPU(const TextureJob& job, Span<uint8_t> fileData, BCn::QUALITY quality,
+        MipGen::FILTER mipFilter, int numThreads, PipelineStats& stats, double& psnr)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
 
-                    *ptr++ = '\0';
-                    currArg++;
-                }
+        int x;
+        int y;
+        int comp;
+        uint8_t* pixels = stbi_load_from_memory(fileData.data(), (int)fileData.size(), &x, &y, &comp, 4);
+        if (!pixels)
+        {
+            printf("stbi_load() for path %s failed: %s\n", job.ImgPath, stbi_failure_reason());
+            return false;
+        }
+
+        stats.Add(STAGE::DECODE, start, (uint64_t)x * y);
+
+        const bool srgb = job.Type == BASE_COLOR || job.Type == EMISSIVE;
+        const BCn::FORMAT format = GetBCnFormat(job.Type);
+        const uint32_t w = job.Width;
+        const uint32_t h = job.Height;
+
+        MipGen::Desc desc{ .Pixels = pixels,
+            .SrcWidth = (uint32_t)x,
+            .SrcHeight = (uint32_t)y,
+            .Width = w,
+            .Height = h,
+            .Type = srgb ? MipGen::TEXTURE_TYPE::COLOR_SRGB :
+                (job.Type == NORMAL_MAP ? MipGen::TEXTURE_TYPE::NORMAL_MAP : MipGen::TEXTURE_TYPE::COLOR_LINEAR),
+            .Filter = mipFilter };
+
+        // Metalness is stored in the blue channel and roughness in the green channel -- move
+        // metalness to red so that BC5 can be used
+        if (job.Type == METALNESS_ROUGHNESS)
+        {
+            desc.Swizzle[0] = 2;
+            desc.Swizzle[2] = 0;
+        }
+
+        const uint32_t numMips = MipGen::NumMips(w, h);
+        const size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+        SmallVector<uint8_t> dds;
+        dds.resize(headerSize + MipGen::CompressedMipChainSize(format, w, h));
+
+        MipGen::EncodeStats encodeStats;
+        MipGen::GenerateAndEncode(desc, format, quality, numThreads,
+            MutableSpan<uint8_t>(dds.data() + headerSize, dds.size() - headerSize), &encodeStats);
 
-                auto success = TexConv(numArgs, args, device);
+        stbi_image_free(pixels);
 
-                if (success != 0)
+        // Filtering and compression are interleaved, so their timings are reported separately
+        const uint64_t numTexels = MipGen::MipChainSize(w, h) / 4;
+        stats.Add(STAGE::MIPMAP, encodeStats.FilterSec, numTexels);
+        stats.Add(STAGE::ENCODE, encodeStats.EncodeSec, numTexels);
+
+        // Only mip 0 is considered for PSNR
+        const uint64_t numSamples = (uint64_t)w * h * (format == BCn::FORMAT::BC5 ? 2 : 4);
+        psnr = BCn::PSNR(encodeStats.Mip0SquaredError, numSamples);
+
+        start = std::chrono::high_resolution_clock::now();
+
+        const uint32_t magic = DDS_MAGIC;
+        memcpy(dds.data(), &magic, sizeof(uint32_t));
+
+        DDS_HEADER header{};
+        header.size = sizeof(DDS_HEADER);
+        header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP | DDS_HEADER_FLAGS_LINEARSIZE;
+        header.height = h;
+        header.width = w;
+        header.pitchOrLinearSize = (uint32_t)BCn::CompressedSize(format, w, h);
+        header.mipMapCount = numMips;
+        header.ddspf = DDSPF_DX10;
+        header.caps = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
+        memcpy(dds.data() + sizeof(uint32_t), &header, sizeof(header));
+
+        DDS_HEADER_DXT10 dx10Header{};
+        dx10Header.dxgiFormat = srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC5_UNORM;
+        dx10Header.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+        dx10Header.arraySize = 1;
+        memcpy(dds.data() + sizeof(uint32_t) + sizeof(DDS_HEADER), &dx10Header, sizeof(dx10Header));
+
+        Filesystem::WriteToFile(job.DDSPath, dds.data(), (uint32_t)dds.size());
+        stats.Add(STAGE::WRITE, start, dds.size());
+
+        return true;
+    }
+
+#ifdef _WIN32
+    bool CompressTextureTexConv(const TextureJob& job, const ArenaPath& compressedDir, ID3D11Device* device,
+        MemoryArena& arena)
+    {
+        const bool srgb = job.Type == BASE_COLOR || job.Type == EMISSIVE;
+        // Whether the texture needs to be rebuilt has already been decided
+        const char* formatStr = srgb ? TEX_CONV_ARGV_SRGB::CMD :
+            (job.Type == METALNESS_ROUGHNESS ? TEX_CONV_ARGV_SWIZZLE::CMD : TEX_CONV_ARGV::CMD);
+        const int numArgs = srgb ? TEX_CONV_ARGV_SRGB::NUM_ARGS :
+            (job.Type == METALNESS_ROUGHNESS ? TEX_CONV_ARGV_SWIZZLE::NUM_ARGS : TEX_CONV_ARGV::NUM_ARGS);
+        const char* texFormat = GetTexFormat(job.Type);
+
+        // Returns length without the null terminatir
+        const int len = stbsp_snprintf(nullptr, 0, formatStr, job.Width, job.Height, texFormat,
+            compressedDir.GetView().data(), job.ImgPath);
+        // Now allocate a buffer large enough for the whole string plus
+        // null terminator
+        char* buffer = reinterpret_cast<char*>(arena.AllocateAligned(len + 1, 1));
+        stbsp_snprintf(buffer, len + 1, formatStr, job.Width, job.Height, texFormat,
+            compressedDir.GetView().data(), job.ImgPath);
+
+        int wideStrLen = Common::CharToWideStrLen(buffer);
+        wchar_t* wideBuffer = reinterpret_cast<wchar_t*>(arena.AllocateAligned(wideStrLen));
+        Common::CharToWideStr(buffer, MutableSpan(wideBuffer, wideStrLen));
+
+        wchar_t* ptr = wideBuffer;
+        wchar_t* args[MAX_NUM_ARGS];
+        int currArg = 0;
+
+        while (ptr != wideBuffer + wideStrLen)
+        {
+            args[currArg] = ptr;
+
+            // spaces are valid for last argument (file path)
+            while ((currArg == numArgs - 1 || *ptr != ' ') && *ptr != '\0')
+                ptr++;
+
+            *ptr++ = '\0';
+            currArg++;
+        }
+
+        return TexConv(numArgs, args, device) == 0;
+    }
+#endif
+
+    uint64_t ReadAndHash(const TextureJob& job, SmallVector<uint8_t>& fileData, PipelineStats& stats)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        Filesystem::LoadFromFile(job.ImgPath, fileData);
+        const uint64_t contentHash = XXH3_64bits(fileData.data(), fileData.size());
+
+        stats.Add(STAGE::READ_AND_HASH, start, fileData.size());
+
+        return contentHash;
+    }
+
+    bool NeedsRebuild(const TextureJob& job, const Manifest& manifest, uint64_t contentHash, bool forceOverwrite)
+    {
+        return forceOverwrite || !Filesystem::Exists(job.DDSPath) ||
+            !manifest.IsUpToDate(job.DDSFilename, contentHash, job.SettingsHash);
+    }
+
+    // Images are processed in parallel on the CPU path. TexConv shares one D3D11 device and
+    // runs serially.
+    bool CompressTextures(Span<TextureJob> jobs, const ArenaPath& compressedDir, Manifest& manifest,
+        ID3D11Device* device, bool useCpu, BCn::QUALITY quality, MipGen::FILTER mipFilter, bool forceOverwrite, 
+        MemoryArena& arena)
+    {
+        PipelineStats stats;
+        const int numJobs = (int)jobs.size();
+        std::atomic_int32_t nextJob = 0;
+        std::atomic_int32_t numDone = 0;
+        std::atomic_int32_t numRebuilt = 0;
+        std::atomic_bool failed = false;
+        std::mutex mtx;
+
+        auto wallStart = std::chrono::high_resolution_clock::now();
+
+        if (useCpu)
+        {
+            const int numHwThreads = (int)Max(std::thread::hardware_concurrency(), 1u);
+            const int numWorkers = Min(numJobs, Min(numHwThreads, ZETA_MAX_NUM_THREADS));
+            // Split the hardware threads between block compression and images. Large images
+            // still benefit from parallel block compression when there are only a few of them.
+            const int numEncodeThreads = Max(numHwThreads / Max(numWorkers, 1), 1);
+
+            auto worker = [&]()
+                {
+                    SmallVector<uint8_t> fileData;
+
+                    while (!failed.load(std::memory_order_relaxed))
+                    {
+                        const int i = nextJob.fetch_add(1, std::memory_order_relaxed);
+                        if (i >= numJobs)
+                            break;
+
+                        const TextureJob& job = jobs[i];
+                        const uint64_t contentHash = ReadAndHash(job, fileData, stats);
+                        bool rebuild;
+
+                        // Manifest is modified by other workers
+                        {
+                            std::unique_lock<std::mutex> lock(mtx);
+                            rebuild = NeedsRebuild(job, manifest, contentHash, forceOverwrite);
+                        }
+
+                        double psnr = 0.0;
+
+                        if (rebuild && !CompressTextureCPU(job, fileData, quality, mipFilter, numEncodeThreads, stats, psnr))
+                        {
+                            failed.store(true, std::memory_order_relaxed);
+                            break;
+                        }
+
+                        std::unique_lock<std::mutex> lock(mtx);
+                        const int done = numDone.fetch_add(1, std::memory_order_relaxed) + 1;
+
+                        if (rebuild)
+                        {
+                            manifest.Set(job.DDSFilename, contentHash, job.SettingsHash);
+                            numRebuilt.fetch_add(1, std::memory_order_relaxed);
+                            printf("[%d/%d] %s: %dx%d, PSNR %.2f [dB]\n", done, numJobs, job.DDSPath,
+                                job.Width, job.Height, psnr);
+                        }
+                        else
+                            printf("[%d/%d] %s is up to date. Skipping...\n", done, numJobs, job.DDSPath);
+                    }
+                };
+
+            SmallVector<std::thread> threads;
+            threads.reserve(numWorkers);
+            for (int i = 0; i < numWorkers - 1; i++)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (auto& t : threads)
+                t.join();
+        }
+#ifdef _WIN32
+        else
+        {
+            SmallVector<uint8_t> fileData;
+
+            for (int i = 0; i < numJobs; i++)
+            {
+                const TextureJob& job = jobs[i];
+                const uint64_t contentHash = ReadAndHash(job, fileData, stats);
+                numDone.fetch_add(1, std::memory_order_relaxed);
+
+                if (NeedsRebuild(job, manifest, contentHash, forceOverwrite))
                 {
-                    printf("TexConv for path %s failed. Exiting...\n", model.images[tex].uri);
-                    return false;
+                    auto start = std::chrono::high_resolution_clock::now();
+
+                    if (!CompressTextureTexConv(job, compressedDir, device, arena))
+                    {
+                        printf("TexConv for path %s failed. Exiting...\n", job.ImgPath);
+                        failed.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+
+                    // TexConv runs all the stages at once
+                    stats.Add(STAGE::ENCODE, start, (uint64_t)job.Width * job.Height);
+                    manifest.Set(job.DDSFilename, contentHash, job.SettingsHash);
+                    numRebuilt.fetch_add(1, std::memory_order_relaxed);
+                    printf("[%d/%d] %s\n", i + 1, numJobs, job.DDSPath);
                 }
+                else
+                    printf("[%d/%d] %s is up to date. Skipping...\n", i + 1, numJobs, job.DDSPath);
             }
-            else
-                printf("Compressed texture already exists in the path %s. Skipping...\n", ddsPath.Get());
+        }
+#endif
 
-            // Modify URI to dds path. URI paths are relative to gltf file.
-            ArenaPathNoInline ddsPathRelglTF(compressedDirName, arena);
-            ddsPathRelglTF.Append(filename.data());
-            ddsPathRelglTF.ConvertToForwardSlashes();
+        auto wallEnd = std::chrono::high_resolution_clock::now();
 
-            model.images[tex].uri = ddsPathRelglTF.Get();
-        }
+        printf("\n%d texture(s) rebuilt, %d up to date.\n", numRebuilt.load(),
+            numDone.load() - numRebuilt.load());
+        stats.Report(std::chrono::duration<double>(wallEnd - wallStart).count());
 
-        return true;
+        return !failed.load();
     }
 
     void WriteModifiedglTF(cgltf_data& model, const ArenaPath& gltfPath, MemoryArena& arena)
@@ -372,7 +796,7 @@ namespace
         filename[fnLen + 10] = '\0';
 
         Filesystem::Path convertedPath(gltfPath.GetView());
-        convertedPath.Directory().Append(StrView(filename.data(), filename.size()));
+        convertedPath.Directory().Append(StrView(filename.data(), filename.size()), USE_BACKSLASH);
 
         cgltf_options options = {};
         if (cgltf_write_file(&options, convertedPath.Get(), &model) != cgltf_result_success)
@@ -386,13 +810,16 @@ namespace
 
     ZetaInline void ReportUsageError()
     {
-        printf("Usage: BCnCompressglTF <path-to-glTF> [options]\n\nOptions:\n%5s%30s\n%5s%30s\n%18s%23s\n", "-y", "Force overwrite", "-sv", "Skip validation", "-mr <resolution>", "Max output resolution");
+        printf("Usage: BCnCompressglTF <path-to-glTF> [options]\n\nOptions:\n%5s%30s\n%5s%30s\n%18s%23s\n%6s%38s\n%26s%24s\n%21s%29s\n",
+            "-y", "Force overwrite", "-sv", "Skip validation", "-mr <resolution>", "Max output resolution",
+            "-cpu", "Compress on the CPU (no Direct3D)", "-q <fast|normal|slow>", "CPU compression quality",
+            "-mf <box|kaiser>", "CPU mipmap filter");
     }
 }
 
 int main(int argc, char* argv[])
 {
-    if (argc < 2 || argc > 5)
+    if (argc < 2 || argc > 11)
     {
         ReportUsageError();
         return 0;
@@ -409,6 +836,14 @@ int main(int argc, char* argv[])
     bool forceOverwrite = false;
     bool validate = true;
     int maxRes = -1;
+#ifdef _WIN32
+    bool useCpu = false;
+#else
+    // TexConv needs Direct3D 11
+    bool useCpu = true;
+#endif
+    BCn::QUALITY quality = BCn::QUALITY::NORMAL;
+    MipGen::FILTER mipFilter = MipGen::FILTER::BOX;
 
     for (int i = 2; i < argc; i++)
     {
@@ -433,6 +868,50 @@ int main(int argc, char* argv[])
             maxRes = Min(maxRes, DEFAULT_MAX_TEX_RES);
             i++;
         }
+        else if (strcmp(argv[i], "-cpu") == 0)
+            useCpu = true;
+        else if (strcmp(argv[i], "-q") == 0)
+        {
+            if (i == argc - 1)
+            {
+                ReportUsageError();
+                return 0;
+            }
+
+            if (strcmp(argv[i + 1], "fast") == 0)
+                quality = BCn::QUALITY::FAST;
+            else if (strcmp(argv[i + 1], "normal") == 0)
+                quality = BCn::QUALITY::NORMAL;
+            else if (strcmp(argv[i + 1], "slow") == 0)
+                quality = BCn::QUALITY::SLOW;
+            else
+            {
+                ReportUsageError();
+                return 0;
+            }
+
+            i++;
+        }
+        else if (strcmp(argv[i], "-mf") == 0)
+        {
+            if (i == argc - 1)
+            {
+                ReportUsageError();
+                return 0;
+            }
+
+            if (strcmp(argv[i + 1], "box") == 0)
+                mipFilter = MipGen::FILTER::BOX;
+            else if (strcmp(argv[i + 1], "kaiser") == 0)
+                mipFilter = MipGen::FILTER::KAISER;
+            else
+            {
+                ReportUsageError();
+                return 0;
+            }
+
+            i++;
+        }
     }
 
     maxRes = maxRes == -1 ? DEFAULT_MAX_TEX_RES : maxRes;
@@ -604,36 +1083,63 @@ int main(int argc, char* argv[])
         #emissive textures: %llu\n", model->images_count, model->textures_count, baseColorMaps.size(),
         normalMaps.size(), metalnessRoughnessMaps.size(), emissiveMaps.size());
 
+    // The CPU path doesn't need Direct3D or WIC
+#ifdef _WIN32
     ComPtr<ID3D11Device> device;
-    CreateDevice(device.GetAddressOf());
+    if (!useCpu)
+    {
+        CreateDevice(device.GetAddressOf());
+
+        // Initialize COM (needed for WIC)
+        auto hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        Check(hr == S_OK, "CoInitializeEx() failed with code %x.", hr);
+    }
 
-    // Initialize COM (needed for WIC)
-    auto hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    Check(hr == S_OK, "CoInitializeEx() failed with code %x.", hr);
+    ID3D11Device* d3dDevice = device.Get();
+#else
+    ID3D11Device* d3dDevice = nullptr;
+#endif
 
     ArenaPath compressedDir(gltfPath.Get(), arena);
-    compressedDir.Directory().Append(COMPRESSED_DIR_NAME);
+    compressedDir.Directory().Append(COMPRESSED_DIR_NAME, USE_BACKSLASH);
     Filesystem::CreateDirectoryIfNotExists(compressedDir.Get());
 
-    if (!ConvertTextures(TEXTURE_TYPE::BASE_COLOR, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, baseColorMaps, arena, device.Get(), true, forceOverwrite, maxRes, skip))
-    {
-        return 0;
-    }
-    if (!ConvertTextures(TEXTURE_TYPE::NORMAL_MAP, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, normalMaps, arena, device.Get(), false, forceOverwrite, maxRes, skip))
-    {
-        return 0;
-    }
-    if (!ConvertTextures(TEXTURE_TYPE::METALNESS_ROUGHNESS, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, metalnessRoughnessMaps, arena, device.Get(), false, forceOverwrite, maxRes, skip))
-    {
+    SmallVector<TextureJob, ArenaAllocator> jobs(arena);
+    SmallVector<bool, ArenaAllocator> seen(arena);
+    seen.resize(model->images_count, false);
+
+    CollectTextureJobs(TEXTURE_TYPE::BASE_COLOR, gltfPath, compressedDir, *model, baseColorMaps, skip, 
+        seen, maxRes, useCpu, quality, mipFilter, arena, jobs);
+    CollectTextureJobs(TEXTURE_TYPE::NORMAL_MAP, gltfPath, compressedDir, *model, normalMaps, skip, 
+        seen, maxRes, useCpu, quality, mipFilter, arena, jobs);
+    CollectTextureJobs(TEXTURE_TYPE::METALNESS_ROUGHNESS, gltfPath, compressedDir, *model, metalnessRoughnessMaps, 
+        skip, seen, maxRes, useCpu, quality, mipFilter, arena, jobs);
+    CollectTextureJobs(TEXTURE_TYPE::EMISSIVE, gltfPath, compressedDir, *model, emissiveMaps, skip, 
+        seen, maxRes, useCpu, quality, mipFilter, arena, jobs);
+
+    ArenaPath manifestPath(compressedDir.GetView(), arena);
+    manifestPath.Append(MANIFEST_NAME, USE_BACKSLASH);
+
+    Manifest manifest;
+    manifest.Load(manifestPath.Get());
+
+    const bool success = CompressTextures(jobs, compressedDir, manifest, d3dDevice, useCpu, quality,
+        mipFilter, forceOverwrite, arena);
+
+    // Record whatever was compressed, even after a failure
+    manifest.Save(manifestPath.Get());
+
+    if (!success)
         return 0;
-    }
-    if (!ConvertTextures(TEXTURE_TYPE::EMISSIVE, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, emissiveMaps, arena, device.Get(), true, forceOverwrite, maxRes, skip))
+
+    // Modify URIs to dds paths. URI paths are relative to gltf file.
+    for (auto& job : jobs)
     {
-        return 0;
+        ArenaPathNoInline ddsPathRelglTF(COMPRESSED_DIR_NAME, arena);
+        ddsPathRelglTF.Append(job.DDSFilename);
+        ddsPathRelglTF.ConvertToForwardSlashes();
+
+        model->images[job.ImageIdx].uri = ddsPathRelglTF.Get();
     }
 
     WriteModifiedglTF(*model, gltfPath, arena);
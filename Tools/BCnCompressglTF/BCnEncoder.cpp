@@ -0,0 +1,1426 @@
+#include "BCnEncoder.h"
+#include <Math/Common.h>
+#include <Utility/Error.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <immintrin.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::BCn;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    //--------------------------------------------------------------------------------------
+    // Common
+    //--------------------------------------------------------------------------------------
+
+    static constexpr uint32_t ALL_TEXELS = 0xffff;
+
+    // Texels in SoA layout -- C[channel][texel]
+    struct alignas(32) BlockF
+    {
+        float C[4][16];
+    };
+
+    ZetaInline void LoadBlock(const uint8_t texels[16][4], BlockF& b)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            b.C[0][i] = texels[i][0];
+            b.C[1][i] = texels[i][1];
+            b.C[2][i] = texels[i][2];
+            b.C[3][i] = texels[i][3];
+        }
+    }
+
+    ZetaInline __m256 LaneMask(uint32_t bits)
+    {
+        const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256i m = _mm256_and_si256(_mm256_set1_epi32((int)bits), laneBits);
+
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(m, laneBits));
+    }
+
+    ZetaInline float HorizontalSum(__m256 v)
+    {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+
+        return _mm_cvtss_f32(s);
+    }
+
+    // For every texel in mask, finds the palette entry with the smallest squared error.
+    // Eight texels are processed at a time. Returns the total error over texels in mask.
+    float SelectIndices(const BlockF& b, int numChannels, const float palette[][4], int numEntries,
+        uint32_t mask, uint8_t indices[16])
+    {
+        __m256 total = _mm256_setzero_ps();
+
+        for (int half = 0; half < 2; half++)
+        {
+            const uint32_t halfMask = (mask >> (8 * half)) & 0xff;
+            if (!halfMask)
+                continue;
+
+            __m256 c[4];
+            for (int ch = 0; ch < numChannels; ch++)
+                c[ch] = _mm256_load_ps(b.C[ch] + 8 * half);
+
+            __m256 best = _mm256_set1_ps(FLT_MAX);
+            __m256 bestIdx = _mm256_setzero_ps();
+
+            for (int k = 0; k < numEntries; k++)
+            {
+                __m256 d = _mm256_sub_ps(c[0], _mm256_set1_ps(palette[k][0]));
+                __m256 err = _mm256_mul_ps(d, d);
+
+                for (int ch = 1; ch < numChannels; ch++)
+                {
+                    d = _mm256_sub_ps(c[ch], _mm256_set1_ps(palette[k][ch]));
+                    err = _mm256_fmadd_ps(d, d, err);
+                }
+
+                const __m256 less = _mm256_cmp_ps(err, best, _CMP_LT_OQ);
+                best = _mm256_min_ps(err, best);
+                bestIdx = _mm256_blendv_ps(bestIdx, _mm256_castsi256_ps(_mm256_set1_epi32(k)), less);
+            }
+
+            total = _mm256_add_ps(total, _mm256_and_ps(best, LaneMask(halfMask)));
+
+            alignas(32) int32_t idx[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx), _mm256_castps_si256(bestIdx));
+
+            for (int i = 0; i < 8; i++)
+            {
+                if (halfMask & (1u << i))
+                    indices[8 * half + i] = (uint8_t)idx[i];
+            }
+        }
+
+        return HorizontalSum(total);
+    }
+
+    // Principal axis of texels in mask using power iteration. Returns the squared
+    // distance of texels to the line through mean along the axis.
+    float PrincipalAxis(const BlockF& b, int numChannels, uint32_t mask, float mean[4], float axis[4])
+    {
+        int n = 0;
+        for (int ch = 0; ch < 4; ch++)
+        {
+            mean[ch] = 0;
+            axis[ch] = 0;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (mask & (1u << i))
+            {
+                for (int ch = 0; ch < numChannels; ch++)
+                    mean[ch] += b.C[ch][i];
+
+                n++;
+            }
+        }
+
+        if (n == 0)
+            return 0;
+
+        for (int ch = 0; ch < numChannels; ch++)
+            mean[ch] /= n;
+
+        float cov[4][4] = {};
+        float total = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (!(mask & (1u << i)))
+                continue;
+
+            float d[4];
+            for (int ch = 0; ch < numChannels; ch++)
+                d[ch] = b.C[ch][i] - mean[ch];
+
+            for (int r = 0; r < numChannels; r++)
+            {
+                for (int c = 0; c < numChannels; c++)
+                    cov[r][c] += d[r] * d[c];
+            }
+        }
+
+        // Start from the column with the largest variance
+        int maxCol = 0;
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            total += cov[ch][ch];
+            if (cov[ch][ch] > cov[maxCol][maxCol])
+                maxCol = ch;
+        }
+
+        if (total < 1e-6f)
+        {
+            axis[0] = 1.0f;
+            return 0;
+        }
+
+        for (int ch = 0; ch < numChannels; ch++)
+            axis[ch] = cov[ch][maxCol];
+
+        for (int iter = 0; iter < 8; iter++)
+        {
+            float v[4] = {};
+            float maxComp = 0;
+
+            for (int r = 0; r < numChannels; r++)
+            {
+                for (int c = 0; c < numChannels; c++)
+                    v[r] += cov[r][c] * axis[c];
+
+                maxComp = Max(maxComp, fabsf(v[r]));
+            }
+
+            if (maxComp == 0)
+                break;
+
+            for (int ch = 0; ch < numChannels; ch++)
+                axis[ch] = v[ch] / maxComp;
+        }
+
+        float len2 = 0;
+        for (int ch = 0; ch < numChannels; ch++)
+            len2 += axis[ch] * axis[ch];
+
+        const float rcpLen = 1.0f / sqrtf(len2);
+        for (int ch = 0; ch < numChannels; ch++)
+            axis[ch] *= rcpLen;
+
+        float lambda = 0;
+        for (int r = 0; r < numChannels; r++)
+        {
+            for (int c = 0; c < numChannels; c++)
+                lambda += axis[r] * cov[r][c] * axis[c];
+        }
+
+        // Total variance minus variance along the axis
+        return Max(total - lambda, 0.0f);
+    }
+
+    // Endpoints at the extents of texels projected onto the principal axis
+    void FitEndpoints(const BlockF& b, int numChannels, uint32_t mask, float e0[4], float e1[4])
+    {
+        float mean[4];
+        float axis[4];
+        PrincipalAxis(b, numChannels, mask, mean, axis);
+
+        float tMin = FLT_MAX;
+        float tMax = -FLT_MAX;
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (!(mask & (1u << i)))
+                continue;
+
+            float t = 0;
+            for (int ch = 0; ch < numChannels; ch++)
+                t += (b.C[ch][i] - mean[ch]) * axis[ch];
+
+            tMin = Min(tMin, t);
+            tMax = Max(tMax, t);
+        }
+
+        if (tMin > tMax)
+            tMin = tMax = 0;
+
+        for (int ch = 0; ch < 4; ch++)
+        {
+            e0[ch] = Min(Max(mean[ch] + tMin * axis[ch], 0.0f), 255.0f);
+            e1[ch] = Min(Max(mean[ch] + tMax * axis[ch], 0.0f), 255.0f);
+        }
+    }
+
+    // Per-texel products of RGB channels -- rr, gg, bb, rg, rb, gb. Used to quickly
+    // estimate the covariance of many subsets of the same block.
+    struct alignas(32) BlockMoments
+    {
+        float P[6][16];
+    };
+
+    void ComputeMoments(const BlockF& b, BlockMoments& m)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            m.P[0][i] = b.C[0][i] * b.C[0][i];
+            m.P[1][i] = b.C[1][i] * b.C[1][i];
+            m.P[2][i] = b.C[2][i] * b.C[2][i];
+            m.P[3][i] = b.C[0][i] * b.C[1][i];
+            m.P[4][i] = b.C[0][i] * b.C[2][i];
+            m.P[5][i] = b.C[1][i] * b.C[2][i];
+        }
+    }
+
+    // Sums of channels and their products over texels in mask -- r, g, b, followed by
+    // the products in BlockMoments order
+    void MaskedMoments(const BlockF& b, const BlockMoments& m, uint32_t mask, float sums[9])
+    {
+        const __m256 m0 = LaneMask(mask & 0xff);
+        const __m256 m1 = LaneMask(mask >> 8);
+
+        auto maskedSum = [m0, m1](const float* v)
+            {
+                return HorizontalSum(_mm256_add_ps(_mm256_and_ps(_mm256_load_ps(v), m0),
+                    _mm256_and_ps(_mm256_load_ps(v + 8), m1)));
+            };
+
+        for (int ch = 0; ch < 3; ch++)
+            sums[ch] = maskedSum(b.C[ch]);
+
+        for (int i = 0; i < 6; i++)
+            sums[3 + i] = maskedSum(m.P[i]);
+    }
+
+    // Squared distance of texels to their best-fit line, i.e. total variance minus
+    // the largest eigenvalue of the covariance matrix
+    float LineFitError(const float sums[9], int n)
+    {
+        if (n < 2)
+            return 0;
+
+        const float rcpN = 1.0f / n;
+        const float cov[3][3] =
+        {
+            { sums[3] - sums[0] * sums[0] * rcpN, sums[6] - sums[0] * sums[1] * rcpN, sums[7] - sums[0] * sums[2] * rcpN },
+            { sums[6] - sums[0] * sums[1] * rcpN, sums[4] - sums[1] * sums[1] * rcpN, sums[8] - sums[1] * sums[2] * rcpN },
+            { sums[7] - sums[0] * sums[2] * rcpN, sums[8] - sums[1] * sums[2] * rcpN, sums[5] - sums[2] * sums[2] * rcpN }
+        };
+
+        const float trace = cov[0][0] + cov[1][1] + cov[2][2];
+        if (trace < 1e-6f)
+            return 0;
+
+        int maxCol = cov[1][1] > cov[0][0] ? 1 : 0;
+        maxCol = cov[2][2] > cov[maxCol][maxCol] ? 2 : maxCol;
+        float v[3] = { cov[0][maxCol], cov[1][maxCol], cov[2][maxCol] };
+
+        for (int iter = 0; iter < 4; iter++)
+        {
+            const float w[3] = { cov[0][0] * v[0] + cov[0][1] * v[1] + cov[0][2] * v[2],
+                cov[1][0] * v[0] + cov[1][1] * v[1] + cov[1][2] * v[2],
+                cov[2][0] * v[0] + cov[2][1] * v[1] + cov[2][2] * v[2] };
+            const float maxComp = Max(Max(fabsf(w[0]), fabsf(w[1])), fabsf(w[2]));
+            if (maxComp == 0)
+                return trace;
+
+            v[0] = w[0] / maxComp;
+            v[1] = w[1] / maxComp;
+            v[2] = w[2] / maxComp;
+        }
+
+        // Rayleigh quotient
+        const float cv[3] = { cov[0][0] * v[0] + cov[0][1] * v[1] + cov[0][2] * v[2],
+            cov[1][0] * v[0] + cov[1][1] * v[1] + cov[1][2] * v[2],
+            cov[2][0] * v[0] + cov[2][1] * v[1] + cov[2][2] * v[2] };
+        const float lambda = (v[0] * cv[0] + v[1] * cv[1] + v[2] * cv[2]) /
+            (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+        return Max(trace - lambda, 0.0f);
+    }
+
+    // Least-squares endpoints given the interpolation weight of every texel in mask.
+    // Negative weights exclude texels (e.g. BC4 entries with constant value).
+    bool RefineEndpoints(const BlockF& b, int numChannels, uint32_t mask, const uint8_t indices[16],
+        const float* weights, float e0[4], float e1[4])
+    {
+        float a = 0;
+        float ab = 0;
+        float bb = 0;
+        float x[4] = {};
+        float y[4] = {};
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (!(mask & (1u << i)))
+                continue;
+
+            const float w = weights[indices[i]];
+            if (w < 0)
+                continue;
+
+            const float wc = 1.0f - w;
+            a += wc * wc;
+            ab += wc * w;
+            bb += w * w;
+
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                x[ch] += wc * b.C[ch][i];
+                y[ch] += w * b.C[ch][i];
+            }
+        }
+
+        const float det = a * bb - ab * ab;
+        if (fabsf(det) < 1e-6f)
+            return false;
+
+        const float rcpDet = 1.0f / det;
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            e0[ch] = Min(Max((bb * x[ch] - ab * y[ch]) * rcpDet, 0.0f), 255.0f);
+            e1[ch] = Min(Max((a * y[ch] - ab * x[ch]) * rcpDet, 0.0f), 255.0f);
+        }
+
+        return true;
+    }
+
+    ZetaInline int NumRefinementIters(QUALITY q)
+    {
+        return q == QUALITY::FAST ? 1 : (q == QUALITY::NORMAL ? 2 : 4);
+    }
+
+    // Little-endian bit stream
+    struct BitWriter
+    {
+        explicit BitWriter(uint8_t* out, int numBytes)
+            : m_out(out)
+        {
+            memset(out, 0, numBytes);
+        }
+
+        ZetaInline void Write(uint32_t val, int numBits)
+        {
+            for (int i = 0; i < numBits; i++, m_pos++)
+            {
+                if (val & (1u << i))
+                    m_out[m_pos >> 3] |= uint8_t(1u << (m_pos & 7));
+            }
+        }
+
+    private:
+        uint8_t* m_out;
+        int m_pos = 0;
+    };
+
+    struct BitReader
+    {
+        explicit BitReader(const uint8_t* in)
+            : m_in(in)
+        {}
+
+        ZetaInline uint32_t Read(int numBits)
+        {
+            uint32_t val = 0;
+            for (int i = 0; i < numBits; i++, m_pos++)
+                val |= uint32_t((m_in[m_pos >> 3] >> (m_pos & 7)) & 1) << i;
+
+            return val;
+        }
+
+    private:
+        const uint8_t* m_in;
+        int m_pos = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // BC1
+    //--------------------------------------------------------------------------------------
+
+    ZetaInline uint16_t QuantizeRGB565(const float c[4])
+    {
+        const int r = Min((int)(c[0] * (31.0f / 255.0f) + 0.5f), 31);
+        const int g = Min((int)(c[1] * (63.0f / 255.0f) + 0.5f), 63);
+        const int b = Min((int)(c[2] * (31.0f / 255.0f) + 0.5f), 31);
+
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    ZetaInline void UnpackRGB565(uint16_t c, int rgb[3])
+    {
+        const int r = (c >> 11) & 31;
+        const int g = (c >> 5) & 63;
+        const int b = c & 31;
+
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Fourth entry of the three-color palette is transparent black
+    void BC1Palette(uint16_t c0, uint16_t c1, bool fourColor, int palette[4][4])
+    {
+        UnpackRGB565(c0, palette[0]);
+        UnpackRGB565(c1, palette[1]);
+        palette[0][3] = 255;
+        palette[1][3] = 255;
+
+        for (int ch = 0; ch < 3; ch++)
+        {
+            const int a = palette[0][ch];
+            const int b = palette[1][ch];
+
+            if (fourColor)
+            {
+                palette[2][ch] = (2 * a + b + 1) / 3;
+                palette[3][ch] = (a + 2 * b + 1) / 3;
+            }
+            else
+            {
+                palette[2][ch] = (a + b + 1) / 2;
+                palette[3][ch] = 0;
+            }
+        }
+
+        palette[2][3] = 255;
+        palette[3][3] = fourColor ? 255 : 0;
+    }
+
+    void EncodeBC1Color(const BlockF& b, uint32_t transparentMask, QUALITY q, uint8_t* out)
+    {
+        // Three-color mode with transparent texels mapped to the fourth entry
+        const bool threeColor = transparentMask != 0;
+        const uint32_t opaqueMask = ALL_TEXELS & ~transparentMask;
+        const float weights4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        const float weights3[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+
+        uint16_t bestC0 = 0;
+        uint16_t bestC1 = 0;
+        uint8_t bestIdx[16] = {};
+
+        if (opaqueMask)
+        {
+            float e0[4];
+            float e1[4];
+            FitEndpoints(b, 3, opaqueMask, e0, e1);
+
+            float bestErr = FLT_MAX;
+            const int numIters = NumRefinementIters(q);
+
+            for (int iter = 0; iter < numIters; iter++)
+            {
+                const uint16_t c0 = QuantizeRGB565(e0);
+                const uint16_t c1 = QuantizeRGB565(e1);
+
+                int palette[4][4];
+                BC1Palette(c0, c1, !threeColor, palette);
+
+                float paletteF[4][4];
+                for (int k = 0; k < 4; k++)
+                {
+                    for (int ch = 0; ch < 4; ch++)
+                        paletteF[k][ch] = (float)palette[k][ch];
+                }
+
+                uint8_t idx[16] = {};
+                const float err = SelectIndices(b, 3, paletteF, threeColor ? 3 : 4, opaqueMask, idx);
+
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    bestC0 = c0;
+                    bestC1 = c1;
+                    memcpy(bestIdx, idx, sizeof(idx));
+                }
+
+                if (err == 0 || !RefineEndpoints(b, 3, opaqueMask, idx, threeColor ? weights3 : weights4, e0, e1))
+                    break;
+            }
+        }
+
+        // Palette mode is implied by the endpoint order
+        if (threeColor)
+        {
+            if (bestC0 > bestC1)
+            {
+                std::swap(bestC0, bestC1);
+                for (int i = 0; i < 16; i++)
+                    bestIdx[i] = bestIdx[i] < 2 ? bestIdx[i] ^ 1 : bestIdx[i];
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                if (transparentMask & (1u << i))
+                    bestIdx[i] = 3;
+            }
+        }
+        else
+        {
+            if (bestC0 < bestC1)
+            {
+                std::swap(bestC0, bestC1);
+                for (int i = 0; i < 16; i++)
+                    bestIdx[i] ^= 1;
+            }
+            else if (bestC0 == bestC1)
+                memset(bestIdx, 0, sizeof(bestIdx));
+        }
+
+        uint32_t indices = 0;
+        for (int i = 0; i < 16; i++)
+            indices |= uint32_t(bestIdx[i]) << (2 * i);
+
+        memcpy(out, &bestC0, sizeof(uint16_t));
+        memcpy(out + 2, &bestC1, sizeof(uint16_t));
+        memcpy(out + 4, &indices, sizeof(uint32_t));
+    }
+
+    void DecodeBC1Color(const uint8_t* block, bool forceFourColor, uint8_t texels[16][4])
+    {
+        uint16_t c0;
+        uint16_t c1;
+        uint32_t indices;
+        memcpy(&c0, block, sizeof(uint16_t));
+        memcpy(&c1, block + 2, sizeof(uint16_t));
+        memcpy(&indices, block + 4, sizeof(uint32_t));
+
+        int palette[4][4];
+        BC1Palette(c0, c1, forceFourColor || c0 > c1, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int k = (indices >> (2 * i)) & 3;
+
+            for (int ch = 0; ch < 4; ch++)
+                texels[i][ch] = (uint8_t)palette[k][ch];
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // BC4
+    //--------------------------------------------------------------------------------------
+
+    // Eight-value mode when a0 > a1, otherwise six values plus 0 and 255
+    void BC4Palette(int a0, int a1, int palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+
+        if (a0 > a1)
+        {
+            for (int k = 2; k < 8; k++)
+                palette[k] = ((8 - k) * a0 + (k - 1) * a1 + 3) / 7;
+        }
+        else
+        {
+            for (int k = 2; k < 6; k++)
+                palette[k] = ((6 - k) * a0 + (k - 1) * a1 + 2) / 5;
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    float EvaluateBC4(const BlockF& b, int a0, int a1, uint8_t idx[16])
+    {
+        int palette[8];
+        BC4Palette(a0, a1, palette);
+
+        float paletteF[8][4];
+        for (int k = 0; k < 8; k++)
+            paletteF[k][0] = (float)palette[k];
+
+        return SelectIndices(b, 1, paletteF, 8, ALL_TEXELS, idx);
+    }
+
+    // Encodes channel 0 of the given block
+    void EncodeBC4Channel(const BlockF& b, QUALITY q, uint8_t* out)
+    {
+        float minVal = 255.0f;
+        float maxVal = 0.0f;
+        float minInterior = 255.0f;
+        float maxInterior = 0.0f;
+
+        for (int i = 0; i < 16; i++)
+        {
+            const float v = b.C[0][i];
+            minVal = Min(minVal, v);
+            maxVal = Max(maxVal, v);
+
+            if (v != 0.0f && v != 255.0f)
+            {
+                minInterior = Min(minInterior, v);
+                maxInterior = Max(maxInterior, v);
+            }
+        }
+
+        int bestA0 = (int)maxVal;
+        int bestA1 = (int)minVal;
+        uint8_t bestIdx[16] = {};
+        float bestErr = maxVal == minVal ? 0 : EvaluateBC4(b, bestA0, bestA1, bestIdx);
+
+        if (bestErr > 0)
+        {
+            // Eight-value mode with least-squares refinement
+            const float weights8[8] = { 0.0f, 1.0f, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f };
+            const int numIters = NumRefinementIters(q);
+            uint8_t idx[16];
+            memcpy(idx, bestIdx, sizeof(idx));
+
+            for (int iter = 1; iter < numIters; iter++)
+            {
+                float e0[4] = { maxVal };
+                float e1[4] = { minVal };
+                if (!RefineEndpoints(b, 1, ALL_TEXELS, idx, weights8, e0, e1))
+                    break;
+
+                const int a0 = (int)(Max(e0[0], e1[0]) + 0.5f);
+                const int a1 = (int)(Min(e0[0], e1[0]) + 0.5f);
+                if (a0 == a1)
+                    break;
+
+                const float err = EvaluateBC4(b, a0, a1, idx);
+                if (err >= bestErr)
+                    break;
+
+                bestErr = err;
+                bestA0 = a0;
+                bestA1 = a1;
+                memcpy(bestIdx, idx, sizeof(idx));
+            }
+
+            // Six-value mode represents 0 and 255 exactly
+            if (q != QUALITY::FAST && (minVal == 0.0f || maxVal == 255.0f))
+            {
+                const int a0 = minInterior <= maxInterior ? (int)minInterior : 0;
+                const int a1 = minInterior <= maxInterior ? (int)maxInterior : 0;
+
+                const float err = EvaluateBC4(b, a0, a1, idx);
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    bestA0 = a0;
+                    bestA1 = a1;
+                    memcpy(bestIdx, idx, sizeof(idx));
+                }
+            }
+        }
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 16; i++)
+            indices |= uint64_t(bestIdx[i]) << (3 * i);
+
+        out[0] = (uint8_t)bestA0;
+        out[1] = (uint8_t)bestA1;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = uint8_t(indices >> (8 * i));
+    }
+
+    void DecodeBC4Channel(const uint8_t* block, int channel, uint8_t texels[16][4])
+    {
+        int palette[8];
+        BC4Palette(block[0], block[1], palette);
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+            indices |= uint64_t(block[2 + i]) << (8 * i);
+
+        for (int i = 0; i < 16; i++)
+            texels[i][channel] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+    }
+
+    ZetaInline void EncodeChannelBC4(const BlockF& b, int channel, QUALITY q, uint8_t* out)
+    {
+        BlockF single;
+        memcpy(single.C[0], b.C[channel], sizeof(single.C[0]));
+        EncodeBC4Channel(single, q, out);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // BC7
+    //--------------------------------------------------------------------------------------
+
+    // Bit i is set when texel i belongs to the second subset
+    static constexpr uint16_t PARTITIONS_2[64] =
+    {
+        0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+        0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+        0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+        0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+        0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+        0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+        0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+        0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+    };
+
+    // Anchor texel of the second subset (anchor of the first subset is always texel 0)
+    static constexpr uint8_t ANCHORS_2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+        15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+        6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+    };
+
+    static constexpr int WEIGHTS_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static constexpr int WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Number of most promising partitions that are fully encoded
+    static constexpr int NUM_PARTITION_CANDIDATES_NORMAL = 8;
+    static constexpr int NUM_PARTITION_CANDIDATES_SLOW = 24;
+
+    struct BC7Mode
+    {
+        // Excluding the p-bit
+        int ColorBits;
+        int IndexBits;
+        int NumChannels;
+        bool SharedPBit;
+        const int* Weights;
+    };
+
+    // Mode 1: two subsets, RGB 6.6.6 with a shared p-bit per subset, 3-bit indices
+    static constexpr BC7Mode MODE_1 = { .ColorBits = 6, .IndexBits = 3, .NumChannels = 3, .SharedPBit = true,
+        .Weights = WEIGHTS_3 };
+    // Mode 6: one subset, RGBA 7.7.7.7 with a p-bit per endpoint, 4-bit indices
+    static constexpr BC7Mode MODE_6 = { .ColorBits = 7, .IndexBits = 4, .NumChannels = 4, .SharedPBit = false,
+        .Weights = WEIGHTS_4 };
+
+    struct BC7Subset
+    {
+        // Quantized endpoints excluding p-bits
+        int Q[2][4];
+        int P[2];
+    };
+
+    ZetaInline int UnquantizeBC7(int q, int p, int colorBits)
+    {
+        const int n = colorBits + 1;
+        const int x = ((q << 1) | p) << (8 - n);
+
+        return x | (x >> n);
+    }
+
+    ZetaInline int QuantizeBC7(float v, int p, int colorBits)
+    {
+        const int n = colorBits + 1;
+        const int maxQ = (1 << colorBits) - 1;
+        const int q0 = (int)((v * ((1 << n) - 1) / 255.0f - p) * 0.5f + 0.5f);
+
+        int best = 0;
+        float bestErr = FLT_MAX;
+
+        for (int q = Max(q0 - 1, 0); q <= Min(q0 + 1, maxQ); q++)
+        {
+            const float err = fabsf((float)UnquantizeBC7(q, p, colorBits) - v);
+            if (err < bestErr)
+            {
+                bestErr = err;
+                best = q;
+            }
+        }
+
+        return best;
+    }
+
+    // Tries every p-bit combination for the given endpoints and keeps the best
+    float QuantizeSubset(const BlockF& b, const BC7Mode& mode, uint32_t mask, const float e0[4],
+        const float e1[4], BC7Subset& subset, uint8_t indices[16])
+    {
+        const int numCombinations = mode.SharedPBit ? 2 : 4;
+        const int numEntries = 1 << mode.IndexBits;
+        float bestErr = FLT_MAX;
+
+        for (int c = 0; c < numCombinations; c++)
+        {
+            BC7Subset s;
+            s.P[0] = c & 1;
+            s.P[1] = mode.SharedPBit ? s.P[0] : (c >> 1);
+
+            int u[2][4];
+            for (int ch = 0; ch < 4; ch++)
+            {
+                s.Q[0][ch] = QuantizeBC7(e0[ch], s.P[0], mode.ColorBits);
+                s.Q[1][ch] = QuantizeBC7(e1[ch], s.P[1], mode.ColorBits);
+                u[0][ch] = UnquantizeBC7(s.Q[0][ch], s.P[0], mode.ColorBits);
+                u[1][ch] = UnquantizeBC7(s.Q[1][ch], s.P[1], mode.ColorBits);
+            }
+
+            float palette[16][4];
+            for (int k = 0; k < numEntries; k++)
+            {
+                const int w = mode.Weights[k];
+
+                for (int ch = 0; ch < 4; ch++)
+                    palette[k][ch] = (float)(((64 - w) * u[0][ch] + w * u[1][ch] + 32) >> 6);
+            }
+
+            uint8_t idx[16];
+            const float err = SelectIndices(b, mode.NumChannels, palette, numEntries, mask, idx);
+
+            if (err < bestErr)
+            {
+                bestErr = err;
+                subset = s;
+
+                for (int i = 0; i < 16; i++)
+                {
+                    if (mask & (1u << i))
+                        indices[i] = idx[i];
+                }
+            }
+        }
+
+        return bestErr;
+    }
+
+    float EncodeSubset(const BlockF& b, const BC7Mode& mode, uint32_t mask, QUALITY q, BC7Subset& subset,
+        uint8_t indices[16])
+    {
+        float e0[4];
+        float e1[4];
+        FitEndpoints(b, mode.NumChannels, mask, e0, e1);
+
+        // Opaque modes
+        if (mode.NumChannels == 3)
+        {
+            e0[3] = 255.0f;
+            e1[3] = 255.0f;
+        }
+
+        float weights[16];
+        for (int k = 0; k < (1 << mode.IndexBits); k++)
+            weights[k] = mode.Weights[k] / 64.0f;
+
+        float bestErr = QuantizeSubset(b, mode, mask, e0, e1, subset, indices);
+        const int numIters = NumRefinementIters(q);
+
+        for (int iter = 1; iter < numIters && bestErr > 0; iter++)
+        {
+            if (!RefineEndpoints(b, mode.NumChannels, mask, indices, weights, e0, e1))
+                break;
+
+            BC7Subset s;
+            uint8_t idx[16];
+            memcpy(idx, indices, sizeof(idx));
+            const float err = QuantizeSubset(b, mode, mask, e0, e1, s, idx);
+
+            if (err >= bestErr)
+                break;
+
+            bestErr = err;
+            subset = s;
+            memcpy(indices, idx, sizeof(idx));
+        }
+
+        return bestErr;
+    }
+
+    // Anchor texels store one less index bit, so their MSB must be zero. Swapping the
+    // endpoints and inverting the indices gives the same palette in reverse.
+    void FixAnchor(const BC7Mode& mode, uint32_t mask, int anchor, BC7Subset& subset, uint8_t indices[16])
+    {
+        const int maxIdx = (1 << mode.IndexBits) - 1;
+        if (!(indices[anchor] & (1 << (mode.IndexBits - 1))))
+            return;
+
+        for (int ch = 0; ch < 4; ch++)
+            std::swap(subset.Q[0][ch], subset.Q[1][ch]);
+
+        std::swap(subset.P[0], subset.P[1]);
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (mask & (1u << i))
+                indices[i] = uint8_t(maxIdx - indices[i]);
+        }
+    }
+
+    void WriteMode6(BC7Subset& s, uint8_t indices[16], uint8_t* out)
+    {
+        FixAnchor(MODE_6, ALL_TEXELS, 0, s, indices);
+
+        BitWriter w(out, 16);
+        w.Write(1 << 6, 7);
+
+        for (int ch = 0; ch < 4; ch++)
+        {
+            w.Write(s.Q[0][ch], 7);
+            w.Write(s.Q[1][ch], 7);
+        }
+
+        w.Write(s.P[0], 1);
+        w.Write(s.P[1], 1);
+
+        for (int i = 0; i < 16; i++)
+            w.Write(indices[i], i == 0 ? 3 : 4);
+    }
+
+    void WriteMode1(int partition, BC7Subset s[2], uint8_t indices[16], uint8_t* out)
+    {
+        const uint32_t mask1 = PARTITIONS_2[partition];
+        const uint32_t mask0 = ALL_TEXELS & ~mask1;
+        const int anchor1 = ANCHORS_2[partition];
+
+        FixAnchor(MODE_1, mask0, 0, s[0], indices);
+        FixAnchor(MODE_1, mask1, anchor1, s[1], indices);
+
+        BitWriter w(out, 16);
+        w.Write(1 << 1, 2);
+        w.Write(partition, 6);
+
+        for (int ch = 0; ch < 3; ch++)
+        {
+            for (int subset = 0; subset < 2; subset++)
+            {
+                w.Write(s[subset].Q[0][ch], 6);
+                w.Write(s[subset].Q[1][ch], 6);
+            }
+        }
+
+        w.Write(s[0].P[0], 1);
+        w.Write(s[1].P[0], 1);
+
+        for (int i = 0; i < 16; i++)
+            w.Write(indices[i], (i == 0 || i == anchor1) ? 2 : 3);
+    }
+
+    // A single color can't always be represented by an endpoint due to p-bits, but
+    // usually can be by interpolating between two nearby endpoints
+    void EncodeSolidBC7(const uint8_t color[4], uint8_t* out)
+    {
+        BC7Subset best = {};
+        int bestIdx = 0;
+        int bestErr = INT_MAX;
+
+        for (int k = 0; k < 16 && bestErr > 0; k++)
+        {
+            const int w = WEIGHTS_4[k];
+
+            for (int c = 0; c < 4 && bestErr > 0; c++)
+            {
+                BC7Subset s;
+                s.P[0] = c & 1;
+                s.P[1] = c >> 1;
+                int err = 0;
+
+                for (int ch = 0; ch < 4; ch++)
+                {
+                    const int v = color[ch];
+                    const int base = v >> 1;
+                    int bestChErr = INT_MAX;
+
+                    for (int q0 = Max(base - 2, 0); q0 <= Min(base + 2, 127); q0++)
+                    {
+                        const int u0 = UnquantizeBC7(q0, s.P[0], 7);
+
+                        for (int q1 = Max(base - 2, 0); q1 <= Min(base + 2, 127); q1++)
+                        {
+                            const int u1 = UnquantizeBC7(q1, s.P[1], 7);
+                            const int d = (((64 - w) * u0 + w * u1 + 32) >> 6) - v;
+
+                            if (d * d < bestChErr)
+                            {
+                                bestChErr = d * d;
+                                s.Q[0][ch] = q0;
+                                s.Q[1][ch] = q1;
+                            }
+                        }
+                    }
+
+                    err += bestChErr;
+                }
+
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    best = s;
+                    bestIdx = k;
+                }
+            }
+        }
+
+        uint8_t indices[16];
+        memset(indices, bestIdx, sizeof(indices));
+        WriteMode6(best, indices, out);
+    }
+
+    void EncodeBC7Block(const BlockF& b, bool opaque, QUALITY q, uint8_t* out)
+    {
+        BC7Subset s6;
+        uint8_t idx6[16];
+        const float err6 = EncodeSubset(b, MODE_6, ALL_TEXELS, q, s6, idx6);
+
+        if (q == QUALITY::FAST || !opaque || err6 == 0)
+        {
+            WriteMode6(s6, idx6, out);
+            return;
+        }
+
+        // Rank partitions by how well each subset fits a line
+        float estimates[64];
+        int candidates[64];
+        BlockMoments moments;
+        ComputeMoments(b, moments);
+        float sumAll[9];
+        MaskedMoments(b, moments, ALL_TEXELS, sumAll);
+
+        for (int p = 0; p < 64; p++)
+        {
+            const uint32_t mask1 = PARTITIONS_2[p];
+            float sum1[9];
+            float sum0[9];
+            MaskedMoments(b, moments, mask1, sum1);
+
+            for (int i = 0; i < 9; i++)
+                sum0[i] = sumAll[i] - sum1[i];
+
+            const int n1 = __popcnt16((uint16_t)mask1);
+            estimates[p] = LineFitError(sum0, 16 - n1) + LineFitError(sum1, n1);
+            candidates[p] = p;
+        }
+
+        const int numCandidates = q == QUALITY::NORMAL ? NUM_PARTITION_CANDIDATES_NORMAL :
+            NUM_PARTITION_CANDIDATES_SLOW;
+        std::partial_sort(candidates, candidates + numCandidates, candidates + 64,
+            [&estimates](int p1, int p2)
+            {
+                return estimates[p1] < estimates[p2];
+            });
+
+        float bestErr = err6;
+        int bestPartition = -1;
+        BC7Subset best1[2];
+        uint8_t bestIdx1[16];
+
+        for (int c = 0; c < numCandidates; c++)
+        {
+            const int p = candidates[c];
+            const uint32_t mask1 = PARTITIONS_2[p];
+            BC7Subset s[2];
+            uint8_t idx[16];
+
+            float err = EncodeSubset(b, MODE_1, ALL_TEXELS & ~mask1, q, s[0], idx);
+            if (err >= bestErr)
+                continue;
+
+            err += EncodeSubset(b, MODE_1, mask1, q, s[1], idx);
+            if (err < bestErr)
+            {
+                bestErr = err;
+                bestPartition = p;
+                best1[0] = s[0];
+                best1[1] = s[1];
+                memcpy(bestIdx1, idx, sizeof(idx));
+            }
+        }
+
+        if (bestPartition == -1)
+            WriteMode6(s6, idx6, out);
+        else
+            WriteMode1(bestPartition, best1, bestIdx1, out);
+    }
+
+    void DecodeBC7Block(const uint8_t* block, uint8_t texels[16][4])
+    {
+        BitReader r(block);
+        int mode = 0;
+        while (mode < 8 && r.Read(1) == 0)
+            mode++;
+
+        Check(mode == 1 || mode == 6, "BC7 mode %d is not supported.", mode);
+
+        if (mode == 6)
+        {
+            int q[2][4];
+            for (int ch = 0; ch < 4; ch++)
+            {
+                q[0][ch] = r.Read(7);
+                q[1][ch] = r.Read(7);
+            }
+
+            const int p0 = r.Read(1);
+            const int p1 = r.Read(1);
+
+            for (int i = 0; i < 16; i++)
+            {
+                const int w = WEIGHTS_4[r.Read(i == 0 ? 3 : 4)];
+
+                for (int ch = 0; ch < 4; ch++)
+                {
+                    const int u0 = UnquantizeBC7(q[0][ch], p0, 7);
+                    const int u1 = UnquantizeBC7(q[1][ch], p1, 7);
+                    texels[i][ch] = uint8_t(((64 - w) * u0 + w * u1 + 32) >> 6);
+                }
+            }
+
+            return;
+        }
+
+        const int partition = r.Read(6);
+        int q[2][2][3];
+
+        for (int ch = 0; ch < 3; ch++)
+        {
+            for (int subset = 0; subset < 2; subset++)
+            {
+                q[subset][0][ch] = r.Read(6);
+                q[subset][1][ch] = r.Read(6);
+            }
+        }
+
+        const int p[2] = { (int)r.Read(1), (int)r.Read(1) };
+        const int anchor1 = ANCHORS_2[partition];
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int subset = (PARTITIONS_2[partition] >> i) & 1;
+            const int w = WEIGHTS_3[r.Read((i == 0 || i == anchor1) ? 2 : 3)];
+
+            for (int ch = 0; ch < 3; ch++)
+            {
+                const int u0 = UnquantizeBC7(q[subset][0][ch], p[subset], 6);
+                const int u1 = UnquantizeBC7(q[subset][1][ch], p[subset], 6);
+                texels[i][ch] = uint8_t(((64 - w) * u0 + w * u1 + 32) >> 6);
+            }
+
+            texels[i][3] = 255;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Image
+    //--------------------------------------------------------------------------------------
+
+    // Texels past the image edges repeat the last row or column
+    ZetaInline void FetchBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by,
+        uint8_t texels[16][4])
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            const uint32_t row = Min(by * 4 + y, height - 1);
+
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint32_t col = Min(bx * 4 + x, width - 1);
+                memcpy(texels[y * 4 + x], rgba + (size_t(row) * width + col) * 4, 4);
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// BCn
+//--------------------------------------------------------------------------------------
+
+void BCn::EncodeBC1(const uint8_t texels[16][4], QUALITY q, uint8_t* out)
+{
+    BlockF b;
+    LoadBlock(texels, b);
+
+    uint32_t transparentMask = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (texels[i][3] < 128)
+            transparentMask |= 1u << i;
+    }
+
+    EncodeBC1Color(b, transparentMask, q, out);
+}
+
+void BCn::EncodeBC3(const uint8_t texels[16][4], QUALITY q, uint8_t* out)
+{
+    BlockF b;
+    LoadBlock(texels, b);
+
+    EncodeChannelBC4(b, 3, q, out);
+    // Color block of BC3 is always decoded as four colors
+    EncodeBC1Color(b, 0, q, out + 8);
+}
+
+void BCn::EncodeBC4(const uint8_t texels[16][4], QUALITY q, uint8_t* out)
+{
+    BlockF b;
+    LoadBlock(texels, b);
+
+    EncodeChannelBC4(b, 0, q, out);
+}
+
+void BCn::EncodeBC5(const uint8_t texels[16][4], QUALITY q, uint8_t* out)
+{
+    BlockF b;
+    LoadBlock(texels, b);
+
+    EncodeChannelBC4(b, 0, q, out);
+    EncodeChannelBC4(b, 1, q, out + 8);
+}
+
+void BCn::EncodeBC7(const uint8_t texels[16][4], QUALITY q, uint8_t* out)
+{
+    bool opaque = true;
+    bool solid = true;
+
+    for (int i = 0; i < 16; i++)
+    {
+        opaque = opaque && (texels[i][3] == 255);
+        solid = solid && (memcmp(texels[i], texels[0], 4) == 0);
+    }
+
+    if (solid)
+    {
+        EncodeSolidBC7(texels[0], out);
+        return;
+    }
+
+    BlockF b;
+    LoadBlock(texels, b);
+
+    EncodeBC7Block(b, opaque, q, out);
+}
+
+void BCn::EncodeBlock(FORMAT f, const uint8_t texels[16][4], QUALITY q, uint8_t* out)
+{
+    switch (f)
+    {
+    case FORMAT::BC1:
+        EncodeBC1(texels, q, out);
+        break;
+    case FORMAT::BC3:
+        EncodeBC3(texels, q, out);
+        break;
+    case FORMAT::BC4:
+        EncodeBC4(texels, q, out);
+        break;
+    case FORMAT::BC5:
+        EncodeBC5(texels, q, out);
+        break;
+    case FORMAT::BC7:
+        EncodeBC7(texels, q, out);
+        break;
+    default:
+        Check(false, "unreachable case.");
+    }
+}
+
+void BCn::DecodeBlock(FORMAT f, const uint8_t* block, uint8_t texels[16][4])
+{
+    switch (f)
+    {
+    case FORMAT::BC1:
+        DecodeBC1Color(block, false, texels);
+        break;
+    case FORMAT::BC3:
+        DecodeBC1Color(block + 8, true, texels);
+        DecodeBC4Channel(block, 3, texels);
+        break;
+    case FORMAT::BC4:
+        DecodeBC4Channel(block, 0, texels);
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i][1] = 0;
+            texels[i][2] = 0;
+            texels[i][3] = 255;
+        }
+        break;
+    case FORMAT::BC5:
+        DecodeBC4Channel(block, 0, texels);
+        DecodeBC4Channel(block + 8, 1, texels);
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i][2] = 0;
+            texels[i][3] = 255;
+        }
+        break;
+    case FORMAT::BC7:
+        DecodeBC7Block(block, texels);
+        break;
+    default:
+        Check(false, "unreachable case.");
+    }
+}
+
+void BCn::EncodeImage(FORMAT f, QUALITY q, const uint8_t* rgba, uint32_t width, uint32_t height,
+    MutableSpan<uint8_t> out, int numThreads)
+{
+    Check(out.size() >= CompressedSize(f, width, height), "Output buffer is too small.");
+
+    const uint32_t numBlocksX = (width + 3) / 4;
+    const uint32_t numBlocksY = (height + 3) / 4;
+    const uint32_t blockSize = BlockSize(f);
+    std::atomic_uint32_t nextRow = 0;
+
+    // Rows of blocks are handed out dynamically as cost per block varies a lot
+    auto encodeRows = [f, q, rgba, width, height, out, numBlocksX, numBlocksY, blockSize, &nextRow]()
+        {
+            uint32_t by;
+            while ((by = nextRow.fetch_add(1, std::memory_order_relaxed)) < numBlocksY)
+            {
+                uint8_t* dst = out.data() + size_t(by) * numBlocksX * blockSize;
+
+                for (uint32_t bx = 0; bx < numBlocksX; bx++)
+                {
+                    uint8_t texels[16][4];
+                    FetchBlock(rgba, width, height, bx, by, texels);
+                    EncodeBlock(f, texels, q, dst + bx * blockSize);
+                }
+            }
+        };
+
+    numThreads = (int)Min((uint32_t)Max(numThreads, 1), numBlocksY);
+
+    std::thread threads[ZETA_MAX_NUM_THREADS];
+    numThreads = Min(numThreads, ZETA_MAX_NUM_THREADS);
+
+    for (int i = 0; i < numThreads - 1; i++)
+        threads[i] = std::thread(encodeRows);
+
+    encodeRows();
+
+    for (int i = 0; i < numThreads - 1; i++)
+        threads[i].join();
+}
+
+void BCn::DecodeImage(FORMAT f, Span<uint8_t> blocks, uint32_t width, uint32_t height,
+    MutableSpan<uint8_t> rgba)
+{
+    Check(blocks.size() >= CompressedSize(f, width, height), "Invalid number of blocks.");
+    Check(rgba.size() >= size_t(width) * height * 4, "Output buffer is too small.");
+
+    const uint32_t numBlocksX = (width + 3) / 4;
+    const uint32_t numBlocksY = (height + 3) / 4;
+    const uint32_t blockSize = BlockSize(f);
+
+    for (uint32_t by = 0; by < numBlocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < numBlocksX; bx++)
+        {
+            uint8_t texels[16][4];
+            DecodeBlock(f, blocks.data() + (size_t(by) * numBlocksX + bx) * blockSize, texels);
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(rgba.data() + (size_t(by * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+            }
+        }
+    }
+}
+
+uint64_t BCn::SquaredError(const uint8_t* rgba1, const uint8_t* rgba2, uint32_t width, uint32_t height,
+    uint32_t channelMask)
+{
+    uint64_t err = 0;
+
+    for (size_t i = 0; i < size_t(width) * height; i++)
+    {
+        for (int ch = 0; ch < 4; ch++)
+        {
+            if (channelMask & (1u << ch))
+            {
+                const int d = int(rgba1[i * 4 + ch]) - int(rgba2[i * 4 + ch]);
+                err += uint64_t(d * d);
+            }
+        }
+    }
+
+    return err;
+}
+
+double BCn::PSNR(uint64_t squaredError, uint64_t numSamples)
+{
+    if (squaredError == 0 || numSamples == 0)
+        return INFINITY;
+
+    const double mse = double(squaredError) / double(numSamples);
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
\ No newline at end of file
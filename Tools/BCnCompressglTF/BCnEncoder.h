@@ -0,0 +1,69 @@
+// References:
+// 1. https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+// 2. https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc7-format
+// 3. J. M. P. van Waveren, "Real-Time DXT Compression," 2006.
+
+#pragma once
+
+#include <Utility/Span.h>
+
+namespace ZetaRay::BCn
+{
+    enum class FORMAT
+    {
+        BC1,
+        BC3,
+        // Single channel (R)
+        BC4,
+        // Two channels (R and G)
+        BC5,
+        BC7
+    };
+
+    enum class QUALITY
+    {
+        // BC7: mode 6 only
+        FAST,
+        // BC7: mode 6, plus mode 1 for the most promising partitions of opaque blocks
+        NORMAL,
+        // BC7: like NORMAL with more partitions. More endpoint refinement iterations for
+        // all formats.
+        SLOW
+    };
+
+    ZetaInline constexpr uint32_t BlockSize(FORMAT f)
+    {
+        return (f == FORMAT::BC1 || f == FORMAT::BC4) ? 8 : 16;
+    }
+
+    ZetaInline constexpr size_t CompressedSize(FORMAT f, uint32_t width, uint32_t height)
+    {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockSize(f);
+    }
+
+    // Block encoders take 4x4 RGBA texels in row-major order. BC1 uses 1-bit alpha for
+    // texels with alpha below 128, BC4 and BC5 ignore the unused channels.
+    void EncodeBC1(const uint8_t texels[16][4], QUALITY q, uint8_t* out);
+    void EncodeBC3(const uint8_t texels[16][4], QUALITY q, uint8_t* out);
+    void EncodeBC4(const uint8_t texels[16][4], QUALITY q, uint8_t* out);
+    void EncodeBC5(const uint8_t texels[16][4], QUALITY q, uint8_t* out);
+    void EncodeBC7(const uint8_t texels[16][4], QUALITY q, uint8_t* out);
+    void EncodeBlock(FORMAT f, const uint8_t texels[16][4], QUALITY q, uint8_t* out);
+
+    // Only BC7 modes emitted by the encoder (1 and 6) are supported
+    void DecodeBlock(FORMAT f, const uint8_t* block, uint8_t texels[16][4]);
+
+    // Encodes an RGBA8 image with rows packed tightly. Dimensions don't have to be multiples
+    // of four -- texels on the right and bottom edges are repeated. Rows of blocks are
+    // distributed among numThreads threads.
+    void EncodeImage(FORMAT f, QUALITY q, const uint8_t* rgba, uint32_t width, uint32_t height,
+        Util::MutableSpan<uint8_t> out, int numThreads);
+    void DecodeImage(FORMAT f, Util::Span<uint8_t> blocks, uint32_t width, uint32_t height,
+        Util::MutableSpan<uint8_t> rgba);
+
+    // Sum of squared differences over the given channels
+    uint64_t SquaredError(const uint8_t* rgba1, const uint8_t* rgba2, uint32_t width, uint32_t height,
+        uint32_t channelMask);
+    // Infinite when there's no error
+    double PSNR(uint64_t squaredError, uint64_t numSamples);
+}
\ No newline at end of file
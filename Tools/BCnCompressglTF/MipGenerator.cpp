@@ -0,0 +1,622 @@
+#include "MipGenerator.h"
+#include <Math/Common.h>
+#include <Utility/Error.h>
+#include <Utility/SmallVector.h>
+#include <chrono>
+#include <immintrin.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::MipGen;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    // Number of sinc lobes on either side of the center
+    static constexpr int KAISER_RADIUS = 3;
+    static constexpr float KAISER_ALPHA = 4.0f;
+    // Rows per strip that is handed to the block encoder. Multiple of 4 and large enough
+    // for rows of blocks to be distributed among threads.
+    static constexpr int STRIP_HEIGHT = 64;
+
+    //--------------------------------------------------------------------------------------
+    // Color conversion
+    //--------------------------------------------------------------------------------------
+
+    static constexpr int SRGB_GUESS_TABLE_SIZE = 4096;
+
+    struct ColorTables
+    {
+        ColorTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                const float c = i / 255.0f;
+                SRGBToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+
+            // Linear value where the (rounded) sRGB encoding switches from i to i + 1
+            for (int i = 0; i < 255; i++)
+            {
+                const float c = (i + 0.5f) / 255.0f;
+                LinearToSRGBThresholds[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+
+            LinearToSRGBThresholds[255] = INFINITY;
+
+            // Encoding of the previous bucket's lower bound. Thresholds are farther apart than 
+            // one bucket (the sRGB curve's slope is less than 3300 in units of 8-bit values), 
+            // so the exact encoding is at most two steps above.
+            int r = 0;
+            for (int i = 0; i < SRGB_GUESS_TABLE_SIZE; i++)
+            {
+                const float lower = Max(i - 1, 0) / float(SRGB_GUESS_TABLE_SIZE - 1);
+                while (LinearToSRGBThresholds[r] <= lower)
+                    r++;
+
+                SRGBGuess[i] = (uint8_t)r;
+            }
+        }
+
+        float SRGBToLinear[256];
+        float LinearToSRGBThresholds[256];
+        uint8_t SRGBGuess[SRGB_GUESS_TABLE_SIZE];
+    };
+
+    const ColorTables& GetColorTables()
+    {
+        static const ColorTables tables;
+        return tables;
+    }
+
+    // Exact, unlike approximations of pow()
+    ZetaInline uint8_t LinearToSRGB8(float v, const ColorTables& tables)
+    {
+        v = Min(Max(v, 0.0f), 1.0f);
+        int r = tables.SRGBGuess[(int)(v * (SRGB_GUESS_TABLE_SIZE - 1))];
+        r += tables.LinearToSRGBThresholds[r] <= v;
+        r += tables.LinearToSRGBThresholds[r] <= v;
+
+        return (uint8_t)r;
+    }
+
+    ZetaInline uint8_t UNorm8(float v)
+    {
+        return (uint8_t)(Min(Max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    void QuantizeRow(const float* row, uint32_t width, TEXTURE_TYPE type, uint8_t* out)
+    {
+        if (type == TEXTURE_TYPE::COLOR_SRGB)
+        {
+            const ColorTables& tables = GetColorTables();
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                out[x * 4 + 0] = LinearToSRGB8(row[x * 4 + 0], tables);
+                out[x * 4 + 1] = LinearToSRGB8(row[x * 4 + 1], tables);
+                out[x * 4 + 2] = LinearToSRGB8(row[x * 4 + 2], tables);
+                out[x * 4 + 3] = UNorm8(row[x * 4 + 3]);
+            }
+        }
+        else if (type == TEXTURE_TYPE::NORMAL_MAP)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                out[x * 4 + 0] = UNorm8(row[x * 4 + 0] * 0.5f + 0.5f);
+                out[x * 4 + 1] = UNorm8(row[x * 4 + 1] * 0.5f + 0.5f);
+                out[x * 4 + 2] = UNorm8(row[x * 4 + 2] * 0.5f + 0.5f);
+                out[x * 4 + 3] = UNorm8(row[x * 4 + 3]);
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < width * 4; i++)
+                out[i] = UNorm8(row[i]);
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Filter kernels
+    //--------------------------------------------------------------------------------------
+
+    // Separable 1D kernel for resampling srcSize texels to dstSize texels. Source indices are
+    // clamped to the edges.
+    struct Kernel
+    {
+        // First source texel and number of taps for every destination texel
+        SmallVector<int> Start;
+        SmallVector<int> Count;
+        // MaxTaps weights per destination texel
+        SmallVector<float> Weights;
+        int MaxTaps;
+    };
+
+    float BesselI0(float x)
+    {
+        // Power series -- converges quickly for the arguments used here
+        float sum = 1.0f;
+        float term = 1.0f;
+        const float x2 = x * x * 0.25f;
+
+        for (int k = 1; k < 32; k++)
+        {
+            term *= x2 / float(k * k);
+            sum += term;
+
+            if (term < sum * 1e-8f)
+                break;
+        }
+
+        return sum;
+    }
+
+    float KaiserSinc(float x)
+    {
+        const float t = x / KAISER_RADIUS;
+        if (fabsf(t) >= 1.0f)
+            return 0.0f;
+
+        const float window = BesselI0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / BesselI0(KAISER_ALPHA);
+        const float sinc = x == 0.0f ? 1.0f : sinf(PI * x) / (PI * x);
+
+        return sinc * window;
+    }
+
+    void BuildKernel(FILTER filter, int srcSize, int dstSize, Kernel& k)
+    {
+        k.Start.resize(dstSize);
+        k.Count.resize(dstSize);
+
+        if (srcSize == dstSize)
+        {
+            k.MaxTaps = 1;
+            k.Weights.resize(dstSize, 1.0f);
+
+            for (int i = 0; i < dstSize; i++)
+            {
+                k.Start[i] = i;
+                k.Count[i] = 1;
+            }
+
+            return;
+        }
+
+        const float scale = (float)srcSize / dstSize;
+        // Half-width of the filter in source texels. When upsampling, Kaiser becomes an
+        // interpolation filter.
+        const float support = filter == FILTER::BOX ? scale * 0.5f : KAISER_RADIUS * Max(scale, 1.0f);
+        k.MaxTaps = 2 * (int)ceilf(support) + 2;
+        k.Weights.resize((size_t)dstSize * k.MaxTaps, 0.0f);
+
+        SmallVector<float> taps;
+        taps.resize(k.MaxTaps, 0.0f);
+
+        for (int i = 0; i < dstSize; i++)
+        {
+            const float center = (i + 0.5f) * scale;
+            const int first = (int)floorf(center - support);
+            const int last = (int)ceilf(center + support);
+
+            int start = INT32_MAX;
+            int end = -1;
+            float sum = 0.0f;
+
+            for (int j = first; j <= last; j++)
+            {
+                float w;
+                if (filter == FILTER::BOX)
+                    w = Max(Min(j + 1.0f, center + support) - Max((float)j, center - support), 0.0f);
+                else
+                    w = KaiserSinc((j + 0.5f - center) / Max(scale, 1.0f));
+
+                if (w == 0.0f)
+                    continue;
+
+                const int src = Min(Max(j, 0), srcSize - 1);
+
+                // Source texels are visited in order, so clamped taps are always at either end
+                if (start == INT32_MAX)
+                    start = src;
+
+                taps[src - start] += w;
+                end = src;
+                sum += w;
+            }
+
+            Assert(end >= start && end - start < k.MaxTaps, "Invalid kernel.");
+
+            k.Start[i] = start;
+            k.Count[i] = end - start + 1;
+
+            float* weights = k.Weights.data() + (size_t)i * k.MaxTaps;
+            for (int t = 0; t < k.Count[i]; t++)
+            {
+                weights[t] = taps[t] / sum;
+                taps[t] = 0.0f;
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Streaming
+    //--------------------------------------------------------------------------------------
+
+    // Last Capacity rows of a level as RGBA float
+    struct RowRing
+    {
+        void Init(uint32_t width, uint32_t height, int capacity)
+        {
+            Width = width;
+            Height = height;
+            Capacity = capacity;
+            NumProduced = 0;
+            Data.resize((size_t)width * 4 * capacity);
+        }
+
+        ZetaInline float* Row(int y)
+        {
+            Assert(y < NumProduced && y > NumProduced - 1 - Capacity, "Row is not resident.");
+            return Data.data() + (size_t)(y % Capacity) * Width * 4;
+        }
+
+        SmallVector<float> Data;
+        uint32_t Width;
+        uint32_t Height;
+        int Capacity;
+        int NumProduced;
+    };
+
+    // Produces the rows of every mip level in order, while each level only keeps the few
+    // rows that the next level's filter needs. Level rows are produced on demand -- pulling
+    // the last row of the smallest mip pulls every row of every level exactly once. Each
+    // row is passed to Sink::OnRow() as soon as it's produced.
+    template<typename Sink>
+    class MipChainStream
+    {
+    public:
+        MipChainStream(const Desc& desc, Sink& sink)
+            : m_desc(desc),
+            m_sink(sink)
+        {
+            m_numMips = NumMips(desc.Width, desc.Height);
+
+            // Ring 0 holds the linearized source rows, ring m + 1 the rows of mip m
+            m_rings.resize(m_numMips + 1);
+            m_kernelsX.resize(m_numMips);
+            m_kernelsY.resize(m_numMips);
+            // Vertical pass output, as wide as the largest level
+            m_temp.resize(Max(desc.SrcWidth, desc.Width) * 4);
+
+            uint32_t prevW = desc.SrcWidth;
+            uint32_t prevH = desc.SrcHeight;
+
+            for (uint32_t m = 0; m < m_numMips; m++)
+            {
+                const uint32_t w = Max(desc.Width >> m, 1u);
+                const uint32_t h = Max(desc.Height >> m, 1u);
+
+                BuildKernel(desc.Filter, prevW, w, m_kernelsX[m]);
+                BuildKernel(desc.Filter, prevH, h, m_kernelsY[m]);
+
+                m_rings[m].Init(prevW, prevH, m_kernelsY[m].MaxTaps);
+
+                prevW = w;
+                prevH = h;
+            }
+
+            // Rows of the last mip aren't read by any filter
+            m_rings[m_numMips].Init(prevW, prevH, 1);
+        }
+
+        void Run()
+        {
+            EnsureRow(m_numMips, m_rings[m_numMips].Height - 1);
+
+            for (uint32_t m = 0; m <= m_numMips; m++)
+                Assert(m_rings[m].NumProduced == (int)m_rings[m].Height, "Every row should've been produced.");
+        }
+
+    private:
+        void EnsureRow(uint32_t ring, int y)
+        {
+            RowRing& r = m_rings[ring];
+
+            while (r.NumProduced <= y)
+            {
+                const int row = r.NumProduced;
+
+                // Make room before the previous level is pulled, so that Row() is valid
+                r.NumProduced++;
+
+                if (ring == 0)
+                    LinearizeSourceRow(row, r.Row(row));
+                else
+                    FilterRow(ring, row, r.Row(row));
+            }
+        }
+
+        void LinearizeSourceRow(int y, float* out)
+        {
+            const uint8_t* src = m_desc.Pixels + (size_t)y * m_desc.SrcWidth * 4;
+            const uint8_t* swizzle = m_desc.Swizzle;
+
+            if (m_desc.Type == TEXTURE_TYPE::COLOR_SRGB)
+            {
+                const float* toLinear = GetColorTables().SRGBToLinear;
+
+                for (uint32_t x = 0; x < m_desc.SrcWidth; x++)
+                {
+                    out[x * 4 + 0] = toLinear[src[x * 4 + swizzle[0]]];
+                    out[x * 4 + 1] = toLinear[src[x * 4 + swizzle[1]]];
+                    out[x * 4 + 2] = toLinear[src[x * 4 + swizzle[2]]];
+                    out[x * 4 + 3] = src[x * 4 + swizzle[3]] / 255.0f;
+                }
+            }
+            else if (m_desc.Type == TEXTURE_TYPE::NORMAL_MAP)
+            {
+                for (uint32_t x = 0; x < m_desc.SrcWidth; x++)
+                {
+                    out[x * 4 + 0] = src[x * 4 + swizzle[0]] * (2.0f / 255.0f) - 1.0f;
+                    out[x * 4 + 1] = src[x * 4 + swizzle[1]] * (2.0f / 255.0f) - 1.0f;
+                    out[x * 4 + 2] = src[x * 4 + swizzle[2]] * (2.0f / 255.0f) - 1.0f;
+                    out[x * 4 + 3] = src[x * 4 + swizzle[3]] / 255.0f;
+                }
+            }
+            else
+            {
+                for (uint32_t x = 0; x < m_desc.SrcWidth; x++)
+                {
+                    for (int ch = 0; ch < 4; ch++)
+                        out[x * 4 + ch] = src[x * 4 + swizzle[ch]] / 255.0f;
+                }
+            }
+        }
+
+        // Computes row y of mip (ring - 1) from the previous level
+        void FilterRow(uint32_t ring, int y, float* out)
+        {
+            const uint32_t mip = ring - 1;
+            const Kernel& ky = m_kernelsY[mip];
+            const Kernel& kx = m_kernelsX[mip];
+            const int start = ky.Start[y];
+            const int count = ky.Count[y];
+
+            EnsureRow(ring - 1, start + count - 1);
+
+            RowRing& prev = m_rings[ring - 1];
+            const float* wy = ky.Weights.data() + (size_t)y * ky.MaxTaps;
+            const int n = (int)prev.Width * 4;
+            float* temp = m_temp.data();
+
+            // Vertical pass -- 2 texels at a time
+            {
+                const float* row = prev.Row(start);
+                const __m256 w0 = _mm256_set1_ps(wy[0]);
+                int i = 0;
+
+                for (; i + 8 <= n; i += 8)
+                    _mm256_storeu_ps(temp + i, _mm256_mul_ps(w0, _mm256_loadu_ps(row + i)));
+
+                for (; i < n; i += 4)
+                    _mm_storeu_ps(temp + i, _mm_mul_ps(_mm256_castps256_ps128(w0), _mm_loadu_ps(row + i)));
+            }
+
+            for (int t = 1; t < count; t++)
+            {
+                const float* row = prev.Row(start + t);
+                const __m256 w = _mm256_set1_ps(wy[t]);
+                int i = 0;
+
+                for (; i + 8 <= n; i += 8)
+                {
+                    const __m256 acc = _mm256_loadu_ps(temp + i);
+                    _mm256_storeu_ps(temp + i, _mm256_fmadd_ps(w, _mm256_loadu_ps(row + i), acc));
+                }
+
+                for (; i < n; i += 4)
+                {
+                    const __m128 acc = _mm_loadu_ps(temp + i);
+                    _mm_storeu_ps(temp + i, _mm_fmadd_ps(_mm256_castps256_ps128(w), _mm_loadu_ps(row + i), acc));
+                }
+            }
+
+            // Horizontal pass -- one RGBA texel per SSE register
+            const uint32_t w = m_rings[ring].Width;
+            const bool normalize = m_desc.Type == TEXTURE_TYPE::NORMAL_MAP;
+
+            for (uint32_t x = 0; x < w; x++)
+            {
+                const float* wx = kx.Weights.data() + (size_t)x * kx.MaxTaps;
+                const float* src = temp + (size_t)kx.Start[x] * 4;
+                __m128 sum = _mm_setzero_ps();
+
+                for (int t = 0; t < kx.Count[x]; t++)
+                    sum = _mm_fmadd_ps(_mm_set1_ps(wx[t]), _mm_loadu_ps(src + t * 4), sum);
+
+                if (normalize)
+                {
+                    // Dot product of xyz
+                    const float lenSq = _mm_cvtss_f32(_mm_dp_ps(sum, sum, 0x71));
+                    if (lenSq > 1e-12f)
+                    {
+                        // Alpha is left as is
+                        const __m128 scale = _mm_set1_ps(1.0f / sqrtf(lenSq));
+                        sum = _mm_blend_ps(_mm_mul_ps(sum, scale), sum, 0x8);
+                    }
+                }
+
+                _mm_storeu_ps(out + x * 4, sum);
+            }
+
+            m_sink.OnRow(mip, y, out);
+        }
+
+        const Desc& m_desc;
+        Sink& m_sink;
+        uint32_t m_numMips;
+        SmallVector<RowRing> m_rings;
+        SmallVector<Kernel> m_kernelsX;
+        SmallVector<Kernel> m_kernelsY;
+        SmallVector<float> m_temp;
+    };
+
+    // Writes every level as RGBA8
+    struct RGBA8Sink
+    {
+        void OnRow(uint32_t mip, int y, const float* row)
+        {
+            const uint32_t w = Max(Tex.Width >> mip, 1u);
+            QuantizeRow(row, w, Tex.Type, Out + LevelOffsets[mip] + (size_t)y * w * 4);
+        }
+
+        const Desc& Tex;
+        uint8_t* Out;
+        size_t LevelOffsets[16];
+    };
+
+    // Quantizes rows into per-level strips and compresses every strip once it's full
+    struct EncodeSink
+    {
+        struct Level
+        {
+            SmallVector<uint8_t> Strip;
+            uint32_t Width;
+            uint32_t Height;
+            int StripStart;
+            size_t OutOffset;
+        };
+
+        void OnRow(uint32_t mip, int y, const float* row)
+        {
+            Level& l = Levels[mip];
+            const int rowInStrip = y - l.StripStart;
+            QuantizeRow(row, l.Width, Tex.Type, l.Strip.data() + (size_t)rowInStrip * l.Width * 4);
+
+            if (rowInStrip + 1 == STRIP_HEIGHT || y == (int)l.Height - 1)
+                Flush(mip, rowInStrip + 1);
+        }
+
+        void Flush(uint32_t mip, int numRows)
+        {
+            Level& l = Levels[mip];
+            const size_t numBlocksX = (l.Width + 3) / 4;
+            // Strips start at a multiple of 4
+            uint8_t* dst = Out + l.OutOffset + (l.StripStart / 4) * numBlocksX * BCn::BlockSize(Format);
+            const size_t size = BCn::CompressedSize(Format, l.Width, numRows);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            BCn::EncodeImage(Format, Quality, l.Strip.data(), l.Width, numRows, MutableSpan(dst, size), NumThreads);
+            auto end = std::chrono::high_resolution_clock::now();
+            EncodeSec += std::chrono::duration<double>(end - start).count();
+
+            if (mip == 0 && ComputeError)
+            {
+                Decoded.resize((size_t)l.Width * numRows * 4);
+                BCn::DecodeImage(Format, Span<uint8_t>(dst, size), l.Width, numRows, Decoded);
+
+                const uint32_t channelMask = Format == BCn::FORMAT::BC4 ? 0x1 :
+                    (Format == BCn::FORMAT::BC5 ? 0x3 : (Format == BCn::FORMAT::BC1 ? 0x7 : 0xf));
+                Mip0SquaredError += BCn::SquaredError(l.Strip.data(), Decoded.data(), l.Width, numRows, channelMask);
+            }
+
+            l.StripStart += numRows;
+        }
+
+        const Desc& Tex;
+        BCn::FORMAT Format;
+        BCn::QUALITY Quality;
+        int NumThreads;
+        uint8_t* Out;
+        bool ComputeError;
+        Level Levels[16];
+        SmallVector<uint8_t> Decoded;
+        uint64_t Mip0SquaredError = 0;
+        double EncodeSec = 0.0;
+    };
+}
+
+size_t MipGen::MipChainSize(uint32_t width, uint32_t height)
+{
+    const uint32_t numMips = NumMips(width, height);
+    size_t size = 0;
+
+    for (uint32_t m = 0; m < numMips; m++)
+        size += (size_t)Max(width >> m, 1u) * Max(height >> m, 1u) * 4;
+
+    return size;
+}
+
+size_t MipGen::CompressedMipChainSize(BCn::FORMAT f, uint32_t width, uint32_t height)
+{
+    const uint32_t numMips = NumMips(width, height);
+    size_t size = 0;
+
+    for (uint32_t m = 0; m < numMips; m++)
+        size += BCn::CompressedSize(f, Max(width >> m, 1u), Max(height >> m, 1u));
+
+    return size;
+}
+
+void MipGen::Generate(const Desc& desc, MutableSpan<uint8_t> rgba)
+{
+    const uint32_t numMips = NumMips(desc.Width, desc.Height);
+    Check(numMips <= 16, "Texture is too large.");
+
+    RGBA8Sink sink{ .Tex = desc, .Out = rgba.data() };
+    size_t offset = 0;
+
+    for (uint32_t m = 0; m < numMips; m++)
+    {
+        sink.LevelOffsets[m] = offset;
+        offset += (size_t)Max(desc.Width >> m, 1u) * Max(desc.Height >> m, 1u) * 4;
+    }
+
+    Check(rgba.size() >= MipChainSize(desc.Width, desc.Height), "Output buffer is too small.");
+
+    MipChainStream<RGBA8Sink> stream(desc, sink);
+    stream.Run();
+}
+
+void MipGen::GenerateAndEncode(const Desc& desc, BCn::FORMAT f, BCn::QUALITY q, int numThreads,
+    MutableSpan<uint8_t> out, EncodeStats* stats)
+{
+    const uint32_t numMips = NumMips(desc.Width, desc.Height);
+    Check(numMips <= 16, "Texture is too large.");
+    Check(out.size() >= CompressedMipChainSize(f, desc.Width, desc.Height), "Output buffer is too small.");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    EncodeSink sink{ .Tex = desc,
+        .Format = f,
+        .Quality = q,
+        .NumThreads = numThreads,
+        .Out = out.data(),
+        .ComputeError = stats != nullptr };
+
+    size_t offset = 0;
+
+    for (uint32_t m = 0; m < numMips; m++)
+    {
+        auto& l = sink.Levels[m];
+        l.Width = Max(desc.Width >> m, 1u);
+        l.Height = Max(desc.Height >> m, 1u);
+        l.StripStart = 0;
+        l.OutOffset = offset;
+        l.Strip.resize((size_t)l.Width * Min(l.Height, (uint32_t)STRIP_HEIGHT) * 4);
+
+        offset += BCn::CompressedSize(f, l.Width, l.Height);
+    }
+
+    MipChainStream<EncodeSink> stream(desc, sink);
+    stream.Run();
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    if (stats)
+    {
+        stats->Mip0SquaredError = sink.Mip0SquaredError;
+        stats->EncodeSec = sink.EncodeSec;
+        stats->FilterSec = std::chrono::duration<double>(end - start).count() - sink.EncodeSec;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+// References:
+// 1. J. F. Kaiser, "Nonrecursive Digital Filter Design Using the I0-sinh Window Function," 1974.
+// 2. https://www.realtimerendering.com/blog/the-ultimate-mipmap-filter/
+
+#pragma once
+
+#include "BCnEncoder.h"
+
+namespace ZetaRay::MipGen
+{
+    enum class TEXTURE_TYPE
+    {
+        // RGB is converted from sRGB to linear before filtering and back afterwards
+        COLOR_SRGB,
+        COLOR_LINEAR,
+        // XYZ is remapped from [0, 1] to [-1, 1] and renormalized after filtering
+        NORMAL_MAP
+    };
+
+    enum class FILTER
+    {
+        // Area-weighted average. Reduces to 2x2 box for power-of-two textures.
+        BOX,
+        // Kaiser-windowed sinc. Sharper than box without noticeable ringing.
+        KAISER
+    };
+
+    struct Desc
+    {
+        // Source image as RGBA8 with rows packed tightly
+        const uint8_t* Pixels;
+        uint32_t SrcWidth;
+        uint32_t SrcHeight;
+        // Dimensions of mip 0. Source is resampled when they're different.
+        uint32_t Width;
+        uint32_t Height;
+        TEXTURE_TYPE Type;
+        FILTER Filter;
+        // Source channel for every output channel
+        uint8_t Swizzle[4] = { 0, 1, 2, 3 };
+    };
+
+    struct EncodeStats
+    {
+        uint64_t Mip0SquaredError;
+        double FilterSec;
+        double EncodeSec;
+    };
+
+    ZetaInline uint32_t NumMips(uint32_t width, uint32_t height)
+    {
+        uint32_t n = 1;
+        while ((width >> n) > 0 || (height >> n) > 0)
+            n++;
+
+        return n;
+    }
+
+    // Size of the full mip chain as RGBA8
+    size_t MipChainSize(uint32_t width, uint32_t height);
+    // Size of the full compressed mip chain
+    size_t CompressedMipChainSize(BCn::FORMAT f, uint32_t width, uint32_t height);
+
+    // Generates the full mip chain and writes every level as RGBA8, one after another
+    void Generate(const Desc& desc, Util::MutableSpan<uint8_t> rgba);
+
+    // Generates the full mip chain and compresses it as it's being generated -- filtered rows
+    // are kept in small per-level ring buffers and handed to the block encoder in strips, so
+    // memory usage (besides the source image) is proportional to texture width rather than
+    // area. Levels are written one after another, which matches the DDS layout.
+    void GenerateAndEncode(const Desc& desc, BCn::FORMAT f, BCn::QUALITY q, int numThreads,
+        Util::MutableSpan<uint8_t> out, EncodeStats* stats = nullptr);
+}
\ No newline at end of file